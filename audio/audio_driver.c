@@ -49,9 +49,11 @@
 #include "../network/netplay/netplay.h"
 #endif
 
+#include "../benchmark.h"
 #include "../configuration.h"
 #include "../driver.h"
 #include "../frontend/frontend_driver.h"
+#include "../frame_telemetry.h"
 #include "../retroarch.h"
 #include "../list_special.h"
 #include "../file_path_special.h"
@@ -80,6 +82,50 @@ audio_driver_t audio_null = {
    NULL
 };
 
+/* Used instead of the configured driver by --benchmark.
+ * Accepts and discards all samples, so that the whole
+ * audio path still runs without an output device. */
+static void *audio_benchmark_init(const char *device, unsigned rate,
+      unsigned latency, unsigned block_frames, unsigned *new_rate)
+{
+   static uint8_t handle;
+   return &handle;
+}
+
+static ssize_t audio_benchmark_write(void *data, const void *buf, size_t size)
+{
+   return size;
+}
+
+static bool audio_benchmark_stop(void *data) { return true; }
+static bool audio_benchmark_start(void *data, bool is_shutdown) { return true; }
+static bool audio_benchmark_alive(void *data) { return true; }
+static void audio_benchmark_set_nonblock_state(void *data, bool toggle) { }
+static void audio_benchmark_free(void *data) { }
+static bool audio_benchmark_use_float(void *data) { return false; }
+
+/* Always half full, so that rate control has
+ * nothing to correct */
+#define AUDIO_BENCHMARK_BUFFER_SIZE 8192
+static size_t audio_benchmark_write_avail(void *data) { return AUDIO_BENCHMARK_BUFFER_SIZE / 2; }
+static size_t audio_benchmark_buffer_size(void *data) { return AUDIO_BENCHMARK_BUFFER_SIZE; }
+
+static audio_driver_t audio_benchmark = {
+   audio_benchmark_init,
+   audio_benchmark_write,
+   audio_benchmark_stop,
+   audio_benchmark_start,
+   audio_benchmark_alive,
+   audio_benchmark_set_nonblock_state,
+   audio_benchmark_free,
+   audio_benchmark_use_float,
+   "benchmark",
+   NULL,
+   NULL,
+   audio_benchmark_write_avail,
+   audio_benchmark_buffer_size
+};
+
 audio_driver_t *audio_drivers[] = {
 #ifdef HAVE_ALSA
    &audio_alsa,
@@ -167,6 +213,10 @@ audio_driver_t *audio_drivers[] = {
    &audio_switch_libnx_audren,
    &audio_switch_libnx_audren_thread,
 #endif
+#endif
+#ifdef HAVE_PIPEWIRE
+   /* Last, so it is never picked as a fallback */
+   &audio_pipewire,
 #endif
    &audio_null,
    NULL,
@@ -329,6 +379,10 @@ static void audio_driver_mixer_deinit(void)
       audio_driver_mixer_remove_stream(i);
    }
 
+   if (audio_mixer_get_underruns())
+      RARCH_LOG("[Audio]: Mixer ran out of decoded samples %u times.\n",
+            audio_mixer_get_underruns());
+
    audio_mixer_done();
 }
 #endif
@@ -355,7 +409,9 @@ bool audio_driver_find_driver(
          "audio_driver",
          settings->arrays.audio_driver);
 
-   if (i >= 0)
+   if (benchmark_is_enabled())
+      audio_driver_st.current_audio = &audio_benchmark;
+   else if (i >= 0)
       audio_driver_st.current_audio = (const audio_driver_t*)
          audio_drivers[i];
    else
@@ -401,6 +457,7 @@ static void audio_driver_flush(
       bool is_slowmotion, bool is_fastmotion)
 {
    struct resampler_data src_data;
+   retro_time_t flush_start          = frame_telemetry_begin();
    float audio_volume_gain           = (audio_st->mute_enable ||
          (audio_fastforward_mute && is_fastmotion))
                ? 0.0f 
@@ -495,8 +552,12 @@ static void audio_driver_flush(
     * trying to do anything. Just leave the ratio as-is,
     * and hope for the best... */
 
-   audio_st->resampler->process(
-         audio_st->resampler_data, &src_data);
+   {
+      retro_time_t resample_start = frame_telemetry_begin();
+      audio_st->resampler->process(
+            audio_st->resampler_data, &src_data);
+      frame_telemetry_end(FRAME_TELEMETRY_RESAMPLE, resample_start);
+   }
 
 #ifdef HAVE_AUDIOMIXER
    if (audio_st->mixer_active)
@@ -535,6 +596,8 @@ static void audio_driver_flush(
       audio_st->current_audio->write(audio_st->context_audio_data,
             output_data, output_frames * 2);
    }
+
+   frame_telemetry_end(FRAME_TELEMETRY_AUDIO, flush_start);
 }
 
 #ifdef HAVE_AUDIOMIXER
@@ -763,6 +826,10 @@ bool audio_driver_init_internal(
 
 #ifdef HAVE_AUDIOMIXER
    audio_mixer_init(settings->uints.audio_output_sample_rate);
+#ifdef HAVE_THREADS
+   if (!audio_mixer_start_decoder())
+      RARCH_WARN("[Audio]: Failed to start mixer decode thread, decoding inline.\n");
+#endif
 #endif
 
    /* Threaded driver is initially stopped. */
@@ -0,0 +1,492 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <spa/param/audio/format-utils.h>
+#include <spa/utils/ringbuffer.h>
+#include <pipewire/pipewire.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <rthreads/rthreads.h>
+#include <string/stdstring.h>
+
+#include "../audio_driver.h"
+#include "../../verbosity.h"
+
+#define PW_FRAME_SIZE (sizeof(float) * 2)
+
+/* Largest quantum the graph may force on us, in frames.
+ * The ring is sized to hold two of these whatever
+ * latency was asked for, so a graph that ignores our
+ * node.latency only costs latency, not underruns. */
+#define PW_MAX_QUANTUM 8192
+
+/* Smallest quantum worth asking for, in frames */
+#define PW_MIN_QUANTUM 32
+
+/* Samples written by pipewire_write() go to a single
+ * producer/single consumer ring, which the process
+ * callback copies straight into the graph's buffer
+ * from the data thread, without any lock. */
+typedef struct pipewire
+{
+   struct pw_thread_loop *loop;
+   struct pw_context *context;
+   struct pw_core *core;
+   struct pw_stream *stream;
+   struct spa_hook stream_listener;
+   struct spa_ringbuffer ring;
+   uint8_t *ring_data;
+   scond_t *cond;
+   slock_t *cond_lock;
+   uint32_t ring_size;        /* Power of two, in bytes */
+   size_t buffer_size;        /* Bytes of the ring in use */
+   unsigned rate;
+   unsigned quantum;          /* Frames asked for */
+   volatile unsigned graph_quantum; /* Frames last pulled */
+   volatile unsigned underruns;
+   volatile bool error;
+   bool has_data;
+   bool nonblock;
+   bool is_paused;
+} pipewire_t;
+
+static void pipewire_on_process(void *data)
+{
+   int32_t filled;
+   uint32_t index, size, to_read;
+   struct pw_buffer *b;
+   struct spa_buffer *buf;
+   uint8_t *dst;
+   pipewire_t *pw = (pipewire_t*)data;
+
+   if (!(b = pw_stream_dequeue_buffer(pw->stream)))
+      return;
+
+   buf = b->buffer;
+
+   if (!(dst = (uint8_t*)buf->datas[0].data))
+   {
+      pw_stream_queue_buffer(pw->stream, b);
+      return;
+   }
+
+   size = buf->datas[0].maxsize;
+#if PW_CHECK_VERSION(0, 3, 49)
+   /* Fill exactly one graph cycle, which is what keeps
+    * the latency down to the negotiated quantum */
+   if (b->requested)
+   {
+      size              = MIN(size, (uint32_t)(b->requested * PW_FRAME_SIZE));
+      pw->graph_quantum = (unsigned)b->requested;
+   }
+#endif
+   size    -= size % PW_FRAME_SIZE;
+
+   filled   = spa_ringbuffer_get_read_index(&pw->ring, &index);
+   to_read  = (filled > 0) ? MIN((uint32_t)filled, size) : 0;
+   to_read -= to_read % PW_FRAME_SIZE;
+
+   if (to_read)
+   {
+      spa_ringbuffer_read_data(&pw->ring, pw->ring_data, pw->ring_size,
+            index & (pw->ring_size - 1), dst, to_read);
+      spa_ringbuffer_read_update(&pw->ring, index + to_read);
+   }
+
+   if (to_read < size)
+   {
+      memset(dst + to_read, 0, size - to_read);
+      if (pw->has_data)
+         pw->underruns++;
+   }
+
+   buf->datas[0].chunk->offset = 0;
+   buf->datas[0].chunk->stride = PW_FRAME_SIZE;
+   buf->datas[0].chunk->size   = size;
+
+   pw_stream_queue_buffer(pw->stream, b);
+
+   scond_signal(pw->cond);
+}
+
+static void pipewire_on_state_changed(void *data,
+      enum pw_stream_state old, enum pw_stream_state state,
+      const char *error)
+{
+   pipewire_t *pw = (pipewire_t*)data;
+
+   if (state == PW_STREAM_STATE_ERROR)
+   {
+      RARCH_ERR("[PipeWire]: Stream error: %s.\n",
+            error ? error : "unknown");
+      pw->error = true;
+      scond_signal(pw->cond);
+   }
+
+   pw_thread_loop_signal(pw->loop, false);
+}
+
+static const struct pw_stream_events pipewire_stream_events = {
+   PW_VERSION_STREAM_EVENTS,
+   .state_changed = pipewire_on_state_changed,
+   .process       = pipewire_on_process,
+};
+
+static void pipewire_free(void *data)
+{
+   pipewire_t *pw = (pipewire_t*)data;
+
+   if (!pw)
+      return;
+
+   if (pw->loop)
+      pw_thread_loop_stop(pw->loop);
+
+   if (pw->underruns)
+      RARCH_LOG("[PipeWire]: %u underruns.\n", pw->underruns);
+
+   if (pw->stream)
+      pw_stream_destroy(pw->stream);
+   if (pw->core)
+      pw_core_disconnect(pw->core);
+   if (pw->context)
+      pw_context_destroy(pw->context);
+   if (pw->loop)
+      pw_thread_loop_destroy(pw->loop);
+
+   if (pw->ring_data)
+      free(pw->ring_data);
+   if (pw->cond_lock)
+      slock_free(pw->cond_lock);
+   if (pw->cond)
+      scond_free(pw->cond);
+
+   free(pw);
+   pw_deinit();
+}
+
+/* Largest power of two not above half the latency, so
+ * that two graph cycles fit in the buffer */
+static unsigned pipewire_find_quantum(unsigned latency, unsigned rate)
+{
+   unsigned frames  = latency * rate / 1000;
+   unsigned quantum = PW_MIN_QUANTUM;
+
+   while (quantum * 4 <= frames && quantum < PW_MAX_QUANTUM)
+      quantum *= 2;
+
+   return quantum;
+}
+
+static void *pipewire_init(const char *device, unsigned rate,
+      unsigned latency,
+      unsigned block_frames,
+      unsigned *new_rate)
+{
+   struct spa_audio_info_raw info;
+   const struct spa_pod *params[1];
+   uint8_t pod_buffer[1024];
+   struct spa_pod_builder builder;
+   struct pw_properties *props;
+   enum pw_stream_state state;
+   size_t ring_min;
+   pipewire_t *pw = (pipewire_t*)calloc(1, sizeof(*pw));
+
+   if (!pw)
+      return NULL;
+
+   pw_init(NULL, NULL);
+
+   pw->rate        = rate;
+   pw->quantum     = pipewire_find_quantum(latency, rate);
+   pw->buffer_size = MAX(latency * rate / 1000, pw->quantum * 2)
+      * PW_FRAME_SIZE;
+
+   ring_min        = MAX(pw->buffer_size, PW_MAX_QUANTUM * 2 * PW_FRAME_SIZE);
+   pw->ring_size   = 1;
+   while (pw->ring_size < ring_min)
+      pw->ring_size <<= 1;
+
+   pw->ring_data   = (uint8_t*)calloc(1, pw->ring_size);
+   pw->cond        = scond_new();
+   pw->cond_lock   = slock_new();
+   if (!pw->ring_data || !pw->cond || !pw->cond_lock)
+      goto error;
+   spa_ringbuffer_init(&pw->ring);
+
+   if (!(pw->loop = pw_thread_loop_new("RetroArch audio", NULL)))
+      goto error;
+   if (!(pw->context = pw_context_new(
+               pw_thread_loop_get_loop(pw->loop), NULL, 0)))
+      goto error;
+
+   /* Honours PIPEWIRE_REMOTE, which is how a private
+    * daemon is picked for headless runs */
+   if (!(pw->core = pw_context_connect(pw->context, NULL, 0)))
+   {
+      RARCH_ERR("[PipeWire]: Failed to connect to the daemon.\n");
+      goto error;
+   }
+
+   props = pw_properties_new(
+         PW_KEY_MEDIA_TYPE,     "Audio",
+         PW_KEY_MEDIA_CATEGORY, "Playback",
+         PW_KEY_MEDIA_ROLE,     "Game",
+         PW_KEY_APP_NAME,       "RetroArch",
+         PW_KEY_NODE_NAME,      "RetroArch",
+         NULL);
+   if (!props)
+      goto error;
+
+   /* Ask the graph for a quantum matching the requested
+    * latency; the session manager may still pick a bigger
+    * one if another client needs it */
+   pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u",
+         pw->quantum, rate);
+
+   /* Device is the name of a sink to connect to, e.g. a
+    * null sink set up for testing */
+   if (!string_is_empty(device))
+#ifdef PW_KEY_TARGET_OBJECT
+      pw_properties_set(props, PW_KEY_TARGET_OBJECT, device);
+#else
+      pw_properties_set(props, PW_KEY_NODE_TARGET, device);
+#endif
+
+   if (!(pw->stream = pw_stream_new(pw->core, "audio", props)))
+      goto error;
+
+   pw_stream_add_listener(pw->stream, &pw->stream_listener,
+         &pipewire_stream_events, pw);
+
+   memset(&info, 0, sizeof(info));
+   info.format      = SPA_AUDIO_FORMAT_F32;
+   info.rate        = rate;
+   info.channels    = 2;
+   info.position[0] = SPA_AUDIO_CHANNEL_FL;
+   info.position[1] = SPA_AUDIO_CHANNEL_FR;
+
+   spa_pod_builder_init(&builder, pod_buffer, sizeof(pod_buffer));
+   params[0] = spa_format_audio_raw_build(&builder,
+         SPA_PARAM_EnumFormat, &info);
+
+   pw_thread_loop_lock(pw->loop);
+
+   if (pw_thread_loop_start(pw->loop) < 0)
+      goto unlock_error;
+
+   if (pw_stream_connect(pw->stream, PW_DIRECTION_OUTPUT, PW_ID_ANY,
+            (enum pw_stream_flags)(PW_STREAM_FLAG_AUTOCONNECT
+            | PW_STREAM_FLAG_MAP_BUFFERS
+            | PW_STREAM_FLAG_RT_PROCESS),
+            params, 1) < 0)
+      goto unlock_error;
+
+   for (;;)
+   {
+      state = pw_stream_get_state(pw->stream, NULL);
+      if (     state != PW_STREAM_STATE_CONNECTING
+            && state != PW_STREAM_STATE_UNCONNECTED)
+         break;
+      pw_thread_loop_wait(pw->loop);
+   }
+
+   pw_thread_loop_unlock(pw->loop);
+
+   if (state == PW_STREAM_STATE_ERROR)
+      goto error;
+
+   RARCH_LOG("[PipeWire]: Requested %u frames quantum at %u Hz, "
+         "%u bytes buffer.\n",
+         pw->quantum, rate, (unsigned)pw->buffer_size);
+
+   return pw;
+
+unlock_error:
+   pw_thread_loop_unlock(pw->loop);
+error:
+   pipewire_free(pw);
+   return NULL;
+}
+
+static bool pipewire_start(void *data, bool is_shutdown);
+
+static ssize_t pipewire_write(void *data, const void *buf_, size_t size)
+{
+   pipewire_t     *pw = (pipewire_t*)data;
+   const uint8_t *buf = (const uint8_t*)buf_;
+   size_t     written = 0;
+
+   /* Same as pulse: a write while paused would
+    * otherwise never make progress */
+   if (pw->is_paused)
+      if (!pipewire_start(pw, false))
+         return -1;
+
+   while (size)
+   {
+      uint32_t index;
+      size_t avail, to_write;
+      int32_t filled;
+
+      if (pw->error)
+         return -1;
+
+      filled   = spa_ringbuffer_get_write_index(&pw->ring, &index);
+      avail    = ((size_t)filled < pw->buffer_size)
+            ? pw->buffer_size - filled : 0;
+      to_write = MIN(size, avail);
+      to_write -= to_write % PW_FRAME_SIZE;
+
+      if (to_write)
+      {
+         spa_ringbuffer_write_data(&pw->ring, pw->ring_data,
+               pw->ring_size, index & (pw->ring_size - 1),
+               buf, (uint32_t)to_write);
+         spa_ringbuffer_write_update(&pw->ring,
+               index + (uint32_t)to_write);
+
+         pw->has_data = true;
+         buf         += to_write;
+         size        -= to_write;
+         written     += to_write;
+      }
+      else if (!pw->nonblock)
+      {
+         /* Woken up every graph cycle; the timeout only
+          * matters if the graph stops pulling */
+         slock_lock(pw->cond_lock);
+         scond_wait_timeout(pw->cond, pw->cond_lock, 100000);
+         slock_unlock(pw->cond_lock);
+      }
+      else
+         break;
+   }
+
+   return written;
+}
+
+static bool pipewire_set_active(pipewire_t *pw, bool active)
+{
+   int ret;
+
+   pw_thread_loop_lock(pw->loop);
+   ret = pw_stream_set_active(pw->stream, active);
+   pw_thread_loop_unlock(pw->loop);
+
+   return ret >= 0;
+}
+
+static bool pipewire_stop(void *data)
+{
+   pipewire_t *pw = (pipewire_t*)data;
+
+   if (pw->is_paused)
+      return true;
+
+   RARCH_LOG("[PipeWire]: Pausing.\n");
+
+   pw->is_paused = true;
+   return pipewire_set_active(pw, false);
+}
+
+static bool pipewire_start(void *data, bool is_shutdown)
+{
+   pipewire_t *pw = (pipewire_t*)data;
+
+   if (!pw->is_paused)
+      return true;
+
+   RARCH_LOG("[PipeWire]: Unpausing.\n");
+
+   pw->is_paused = false;
+   return pipewire_set_active(pw, true);
+}
+
+static bool pipewire_alive(void *data)
+{
+   pipewire_t *pw = (pipewire_t*)data;
+
+   if (!pw)
+      return false;
+   return !pw->is_paused && !pw->error;
+}
+
+static void pipewire_set_nonblock_state(void *data, bool state)
+{
+   pipewire_t *pw = (pipewire_t*)data;
+   if (pw)
+      pw->nonblock = state;
+}
+
+static bool pipewire_use_float(void *data)
+{
+   return true;
+}
+
+static size_t pipewire_write_avail(void *data)
+{
+   uint32_t index;
+   int32_t filled;
+   pipewire_t *pw       = (pipewire_t*)data;
+   size_t graph_cycle   = pw->graph_quantum * PW_FRAME_SIZE;
+
+   /* The graph may run with a bigger quantum than the one
+    * asked for. Keep room for two of its cycles, so the
+    * rate control aims for a fill level that does not
+    * underrun every cycle. */
+   if (     (graph_cycle * 2 > pw->buffer_size)
+         && (graph_cycle * 2 <= pw->ring_size))
+   {
+      RARCH_LOG("[PipeWire]: Graph quantum is %u frames, "
+            "buffer raised to %u bytes.\n",
+            pw->graph_quantum, (unsigned)(graph_cycle * 2));
+      pw->buffer_size = graph_cycle * 2;
+      audio_driver_set_buffer_size(pw->buffer_size);
+   }
+
+   filled = spa_ringbuffer_get_write_index(&pw->ring, &index);
+
+   if ((size_t)filled >= pw->buffer_size)
+      return 0;
+   return pw->buffer_size - filled;
+}
+
+static size_t pipewire_buffer_size(void *data)
+{
+   pipewire_t *pw = (pipewire_t*)data;
+   return pw->buffer_size;
+}
+
+audio_driver_t audio_pipewire = {
+   pipewire_init,
+   pipewire_write,
+   pipewire_stop,
+   pipewire_start,
+   pipewire_alive,
+   pipewire_set_nonblock_state,
+   pipewire_free,
+   pipewire_use_float,
+   "pipewire",
+   NULL,
+   NULL,
+   pipewire_write_avail,
+   pipewire_buffer_size,
+};
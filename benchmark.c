@@ -0,0 +1,154 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <encodings/crc32.h>
+
+#include "benchmark.h"
+#include "core.h"
+#include "frame_telemetry.h"
+#include "verbosity.h"
+
+typedef struct
+{
+   uint32_t expected_crc;
+   bool enabled;
+   bool has_expected_crc;
+   bool finished;
+   bool failed;
+} benchmark_state_t;
+
+static benchmark_state_t benchmark_st;
+
+void benchmark_enable(void)
+{
+   benchmark_st.enabled = true;
+}
+
+bool benchmark_is_enabled(void)
+{
+   return benchmark_st.enabled;
+}
+
+void benchmark_set_expected_crc(uint32_t crc)
+{
+   benchmark_st.expected_crc     = crc;
+   benchmark_st.has_expected_crc = true;
+}
+
+/* Returns false if the core cannot serialize */
+static bool benchmark_state_crc(uint32_t *crc)
+{
+   retro_ctx_serialize_info_t serial_info;
+   retro_ctx_size_info_t info;
+   void *data = NULL;
+
+   info.size  = 0;
+   core_serialize_size(&info);
+
+   if (!info.size || !(data = malloc(info.size)))
+      return false;
+
+   serial_info.data = data;
+   serial_info.size = info.size;
+
+   if (!core_serialize(&serial_info))
+   {
+      free(data);
+      return false;
+   }
+
+   *crc = encoding_crc32(0, (const uint8_t*)data, info.size);
+   free(data);
+   return true;
+}
+
+static void benchmark_print_stages(void)
+{
+   unsigned i;
+   frame_telemetry_stats_t stats;
+   uint64_t frame_usec;
+
+   if (!frame_telemetry_get_stats(&stats))
+   {
+      printf("Benchmark: no frames were run.\n");
+      return;
+   }
+
+   frame_usec = stats.total[FRAME_TELEMETRY_FRAME];
+
+   printf("Benchmark: %u frames in %.2f ms (%.1f fps).\n",
+         (unsigned)stats.frames, frame_usec / 1000.0,
+         frame_usec ? stats.frames * 1000000.0 / frame_usec : 0.0);
+   printf("  %-10s %12s %10s %8s %8s %8s\n",
+         "stage", "total ms", "avg us", "p50 us", "p99 us", "max us");
+
+   for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST; i++)
+   {
+      const frame_telemetry_percentiles_t *pc = &stats.stage[i];
+
+      /* Percentiles only cover the telemetry window;
+       * totals and averages cover the whole run */
+      if (!stats.total[i])
+         continue;
+
+      printf("  %-10s %12.2f %10.2f %8u %8u %8u\n",
+            frame_telemetry_stage_name((enum frame_telemetry_stage)i),
+            stats.total[i] / 1000.0,
+            (double)stats.total[i] / stats.frames,
+            (unsigned)pc->p50, (unsigned)pc->p99, (unsigned)pc->max);
+   }
+}
+
+bool benchmark_finish(void)
+{
+   bool has_crc;
+   uint32_t crc          = 0;
+   benchmark_state_t *st = &benchmark_st;
+
+   if (!st->enabled || st->finished)
+      return !st->failed;
+
+   st->finished = true;
+
+   benchmark_print_stages();
+
+   has_crc      = benchmark_state_crc(&crc);
+
+   if (has_crc)
+      printf("Benchmark: final state CRC32: 0x%08x.\n", (unsigned)crc);
+   else
+      printf("Benchmark: final state CRC32: unavailable "
+            "(core does not support savestates).\n");
+
+   if (st->has_expected_crc && (!has_crc || crc != st->expected_crc))
+   {
+      RARCH_ERR("[Benchmark]: State CRC mismatch (expected 0x%08x).\n",
+            (unsigned)st->expected_crc);
+      printf("Benchmark: FAILED, expected CRC32 0x%08x.\n",
+            (unsigned)st->expected_crc);
+      st->failed = true;
+   }
+
+   fflush(stdout);
+   return !st->failed;
+}
+
+int benchmark_exit_status(void)
+{
+   return benchmark_st.failed ? 1 : 0;
+}
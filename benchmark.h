@@ -0,0 +1,52 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Headless benchmark (--benchmark)
+ * The content runs unthrottled on the null drivers,
+ * usually driven by a BSV movie so that every run is
+ * identical. When the runloop exits, the per-stage
+ * totals collected by frame telemetry are printed to
+ * stdout, together with the CRC32 of a savestate taken
+ * after the last frame. If an expected CRC was given,
+ * a mismatch makes the process exit with status 1. */
+
+void benchmark_enable(void);
+
+bool benchmark_is_enabled(void);
+
+void benchmark_set_expected_crc(uint32_t crc);
+
+/* Prints the report and checks the savestate CRC.
+ * Must be called while the core is still loaded;
+ * only the first call has any effect.
+ * Returns false if the CRC check failed. */
+bool benchmark_finish(void);
+
+/* Returns the status the process should exit with */
+int benchmark_exit_status(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -41,6 +41,7 @@
 #endif
 
 #include "cheat_manager.h"
+#include "cheat_search.h"
 
 #include "msg_hash.h"
 #include "configuration.h"
@@ -321,6 +322,8 @@ static void cheat_manager_free(void)
    if (cheat_st->memory_size_list)
       free(cheat_st->memory_size_list);
 
+   memory_map_free(&cheat_st->memory_map);
+
    cheat_st->cheats                    = NULL;
    cheat_st->size                      = 0;
    cheat_st->buf_size                  = 0;
@@ -797,6 +800,8 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
       cheat_st->memory_size_list = NULL;
    }
 
+   memory_map_free(&cheat_st->memory_map);
+
    if (system && system->mmaps.num_descriptors > 0)
    {
       for (i = 0; i < system->mmaps.num_descriptors; i++)
@@ -861,6 +866,24 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
 
    }
 
+   for (i = 0; i < cheat_st->num_memory_buffers; i++)
+   {
+      if (!memory_map_add(&cheat_st->memory_map, offset,
+               cheat_st->memory_buf_list[i],
+               cheat_st->memory_size_list[i], 0))
+         break;
+      offset += cheat_st->memory_size_list[i];
+   }
+
+   if (  i < cheat_st->num_memory_buffers
+      || !memory_map_build(&cheat_st->memory_map))
+   {
+      memory_map_free(&cheat_st->memory_map);
+      cheat_st->num_memory_buffers = 0;
+      runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_INIT_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      return 0;
+   }
+
    cheat_st->num_matches = (cheat_st->total_memory_size * 8) / (1 << cheat_st->search_bit_size);
 
 #if 0
@@ -877,8 +900,10 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
          cheat_st->prev_memory_buf = NULL;
       }
 
+      /* Padded, so that a last item running past the
+       * end of memory can be read in full */
       cheat_st->prev_memory_buf = (uint8_t*)calloc(
-            cheat_st->total_memory_size, sizeof(uint8_t));
+            cheat_st->total_memory_size + 3, sizeof(uint8_t));
 
       if (!cheat_st->prev_memory_buf)
       {
@@ -892,8 +917,9 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
          cheat_st->matches = NULL;
       }
 
-      cheat_st->matches = (uint8_t*)calloc(
-            cheat_st->total_memory_size, sizeof(uint8_t));
+      cheat_st->matches = (uint32_t*)calloc(
+            cheat_search_bitset_words(cheat_st->search_bit_size,
+               cheat_st->total_memory_size), sizeof(uint32_t));
 
       if (!cheat_st->matches)
       {
@@ -903,7 +929,9 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
          return 0;
       }
 
-      memset(cheat_st->matches, 0xFF, cheat_st->total_memory_size);
+      cheat_search_bitset_fill(cheat_st->matches,
+            cheat_st->search_bit_size, cheat_st->total_memory_size);
+      cheat_st->matches_bit_size = cheat_st->search_bit_size;
 
       offset = 0;
 
@@ -935,22 +963,15 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
 
 static unsigned translate_address(unsigned address, unsigned char **curr)
 {
-   unsigned             offset = 0;
-   unsigned                  i = 0;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
+   const memory_map_region_t *region =
+      memory_map_find_region(&cheat_st->memory_map, address);
 
-   for (i = 0; i < cheat_st->num_memory_buffers; i++)
-   {
-      if ((address >= offset) && (address < offset + cheat_st->memory_size_list[i]))
-      {
-         *curr = cheat_st->memory_buf_list[i];
-         break;
-      }
-      else
-         offset += cheat_st->memory_size_list[i];
-   }
+   if (!region)
+      return cheat_st->total_memory_size;
 
-   return offset;
+   *curr = region->data;
+   return region->start;
 }
 
 static void cheat_manager_setup_search_meta(
@@ -994,122 +1015,83 @@ static void cheat_manager_setup_search_meta(
    }
 }
 
+/* The search size can be changed without restarting
+ * the search, lay the matches out for the new size */
+static bool cheat_manager_sync_matches(cheat_manager_t *cheat_st)
+{
+   uint32_t *matches = NULL;
+
+   if (!cheat_st->matches)
+      return false;
+
+   if (cheat_st->matches_bit_size == cheat_st->search_bit_size)
+      return true;
+
+   if (!(matches = (uint32_t*)calloc(
+               cheat_search_bitset_words(cheat_st->search_bit_size,
+                  cheat_st->total_memory_size), sizeof(uint32_t))))
+      return false;
+
+   cheat_search_convert(cheat_st->matches, cheat_st->matches_bit_size,
+         matches, cheat_st->search_bit_size, cheat_st->total_memory_size);
+
+   free(cheat_st->matches);
+   cheat_st->matches          = matches;
+   cheat_st->matches_bit_size = cheat_st->search_bit_size;
+   return true;
+}
+
 static int cheat_manager_search(enum cheat_search_type search_type)
 {
    char msg[100];
+   cheat_search_params_t params;
+   size_t dropped              = 0;
+   unsigned threads            = 1;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char *curr         = cheat_st->curr_memory_buf;
-   unsigned char *prev         = cheat_st->prev_memory_buf;
-   unsigned int idx            = 0;
-   unsigned int curr_val       = 0;
-   unsigned int prev_val       = 0;
-   unsigned int mask           = 0;
-   unsigned int bytes_per_item = 1;
-   unsigned int bits           = 8;
    unsigned int offset         = 0;
    unsigned int i              = 0;
    bool refresh                = false;
 
-   if (cheat_st->num_memory_buffers == 0)
+   if (     cheat_st->num_memory_buffers == 0
+         || !cheat_st->prev_memory_buf
+         || !cheat_manager_sync_matches(cheat_st))
    {
       runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_NOT_INITIALIZED), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
       return 0;
    }
 
-   cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
+   params.type       = search_type;
+   params.bit_size   = cheat_st->search_bit_size;
+   params.big_endian = cheat_st->big_endian;
 
-   /* little endian FF000000 = 256 */
-   for (idx = 0; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
+   switch (search_type)
    {
-      unsigned byte_part;
-
-      offset = translate_address(idx, &curr);
-
-      switch (bytes_per_item)
-      {
-         case 2:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            prev_val = cheat_st->big_endian ?
-               (*(prev + idx) * 256) + *(prev + idx + 1) :
-               *(prev + idx) + (*(prev + idx + 1) * 256);
-            break;
-         case 4:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            prev_val = cheat_st->big_endian ?
-               (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-               *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr - offset + idx);
-            prev_val = *(prev + idx);
-            break;
-      }
-
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int curr_subval = (curr_val >> (byte_part * bits)) & mask;
-         unsigned int prev_subval = (prev_val >> (byte_part * bits)) & mask;
-         unsigned int prev_match;
-
-         if (bits < 8)
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-         else
-            prev_match = *(cheat_st->matches + idx);
+      case CHEAT_SEARCH_TYPE_EXACT:
+         params.value = cheat_st->search_exact_value;
+         break;
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         params.value = cheat_st->search_eqplus_value;
+         break;
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         params.value = cheat_st->search_eqminus_value;
+         break;
+      default:
+         params.value = 0;
+         break;
+   }
 
-         if (prev_match > 0)
-         {
-            bool match = false;
-            switch (search_type)
-            {
-               case CHEAT_SEARCH_TYPE_EXACT:
-                  match = (curr_subval == cheat_st->search_exact_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_LT:
-                  match = (curr_subval < prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GT:
-                  match = (curr_subval > prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_LTE:
-                  match = (curr_subval <= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GTE:
-                  match = (curr_subval >= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQ:
-                  match = (curr_subval == prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_NEQ:
-                  match = (curr_subval != prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQPLUS:
-                  match = (curr_subval == prev_subval + cheat_st->search_eqplus_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQMINUS:
-                  match = (curr_subval == prev_subval - cheat_st->search_eqminus_value);
-                  break;
-            }
+#ifdef HAVE_THREADS
+   threads = cpu_features_get_core_amount();
+#endif
 
-            if (!match)
-            {
-               if (bits < 8)
-                  *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                     ((~(mask << (byte_part * bits))) & 0xFF);
-               else
-                  memset(cheat_st->matches + idx, 0, bytes_per_item);
-               if (cheat_st->num_matches > 0)
-                  cheat_st->num_matches--;
-            }
-         }
-      }
-   }
+   dropped = cheat_search_filter(&params, &cheat_st->memory_map,
+         cheat_st->total_memory_size, cheat_st->prev_memory_buf,
+         cheat_st->matches, threads);
 
-   offset = 0;
+   if (dropped < cheat_st->num_matches)
+      cheat_st->num_matches -= (unsigned)dropped;
+   else
+      cheat_st->num_matches  = 0;
 
    for (i = 0; i < cheat_st->num_memory_buffers; i++)
    {
@@ -1202,17 +1184,15 @@ int cheat_manager_add_matches(const char *path,
       const char *label, unsigned type, size_t menuidx, size_t entry_idx)
 {
    char msg[100];
+   size_t                    n = 0;
+   size_t       num_candidates = 0;
    bool                refresh = false;
-   unsigned          byte_part = 0;
-   unsigned            int idx = 0;
+   unsigned             fields = 1;
    unsigned           int mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned           int bits = 8;
-   unsigned       int curr_val = 0;
    unsigned      int num_added = 0;
-   unsigned         int offset = 0;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char         *curr = cheat_st->curr_memory_buf;
 
    if (cheat_st->num_matches + cheat_st->size > 100)
    {
@@ -1221,61 +1201,30 @@ int cheat_manager_add_matches(const char *path,
    }
    cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
 
-   for (idx = 0; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
+   if (cheat_manager_sync_matches(cheat_st))
    {
-      offset = translate_address(idx, &curr);
+      fields         = cheat_search_fields(cheat_st->search_bit_size);
+      num_candidates = cheat_search_num_candidates(
+            cheat_st->search_bit_size, cheat_st->total_memory_size);
+   }
 
-      switch (bytes_per_item)
-      {
-         case 2:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            break;
-         case 4:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr - offset + idx);
-            break;
-      }
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
+   for (n = cheat_search_next(cheat_st->matches, num_candidates, 0);
+         n < num_candidates;
+         n = cheat_search_next(cheat_st->matches, num_candidates, n + 1))
+   {
+      unsigned idx      = (unsigned)(n / fields) * bytes_per_item;
+      unsigned curr_val = cheat_search_read(&cheat_st->memory_map,
+            cheat_st->total_memory_size, cheat_st->search_bit_size,
+            cheat_st->big_endian, idx);
+
+      if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx,
+               (bits < 8) ? (mask << ((n % fields) * bits)) : 0xFF,
+               cheat_st->big_endian, curr_val))
       {
-         unsigned int prev_match;
-
-         if (bits < 8)
-         {
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-            if (prev_match)
-            {
-               if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, (mask << (byte_part * bits)),
-                        cheat_st->big_endian, curr_val))
-               {
-                  runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                  return 0;
-               }
-               num_added++;
-            }
-         }
-         else
-         {
-            prev_match = *(cheat_st->matches + idx);
-            if (prev_match)
-            {
-               if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, 0xFF,
-                        cheat_st->big_endian, curr_val))
-               {
-                  runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                  return 0;
-               }
-               num_added++;
-            }
-         }
-
+         runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         return 0;
       }
+      num_added++;
    }
 
    snprintf(msg, sizeof(msg), msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_SUCCESS), cheat_st->num_matches);
@@ -1578,19 +1527,18 @@ void cheat_manager_apply_retro_cheats(void)
 void cheat_manager_match_action(enum cheat_match_action_type match_action, unsigned int target_match_idx, unsigned int *address, unsigned int *address_mask,
       unsigned int *prev_value, unsigned int *curr_value)
 {
-   unsigned int byte_part;
-   unsigned int idx;
-   unsigned int start_idx;
+   size_t                    n;
+   size_t       num_candidates;
+   unsigned int            idx;
+   unsigned int         fields;
    unsigned int           mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned int           bits = 8;
    unsigned int       curr_val = 0;
    unsigned int       prev_val = 0;
-   unsigned int         offset = 0;
+   unsigned int      field_mask;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char         *curr = cheat_st->curr_memory_buf;
    unsigned char         *prev = cheat_st->prev_memory_buf;
-   unsigned int curr_match_idx = 0;
 
    if (target_match_idx > cheat_st->num_matches - 1)
       return;
@@ -1601,137 +1549,63 @@ void cheat_manager_match_action(enum cheat_match_action_type match_action, unsig
    cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
 
    if (match_action == CHEAT_MATCH_ACTION_TYPE_BROWSE)
-      start_idx = *address;
-   else
-      start_idx = 0;
-
-   for (idx = start_idx; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
    {
-      offset = translate_address(idx, &curr);
+      idx = *address;
 
-      switch (bytes_per_item)
-      {
-      case 2:
-         curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-         if (prev)
-            prev_val = cheat_st->big_endian ?
-                  (*(prev + idx) * 256) + *(prev + idx + 1) :
-                  *(prev + idx) + (*(prev + idx + 1) * 256);
-         break;
-      case 4:
-         curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-         if (prev)
-            prev_val = cheat_st->big_endian ?
-                  (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-                  *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-         break;
-      case 1:
-      default:
-         curr_val = *(curr + idx - offset);
-         if (prev)
-            prev_val = *(prev + idx);
-         break;
-      }
-
-      if (match_action == CHEAT_MATCH_ACTION_TYPE_BROWSE)
-      {
-         *curr_value = curr_val;
-         *prev_value = prev_val;
+      if (idx >= cheat_st->total_memory_size)
          return;
-      }
 
-      if (!prev)
-         return;
+      *curr_value = cheat_search_read(&cheat_st->memory_map,
+            cheat_st->total_memory_size, cheat_st->search_bit_size,
+            cheat_st->big_endian, idx);
+      *prev_value = prev ? cheat_search_value(prev + idx,
+            cheat_st->search_bit_size, cheat_st->big_endian) : 0;
+      return;
+   }
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int prev_match;
+   if (!prev || !cheat_manager_sync_matches(cheat_st))
+      return;
 
-         if (bits < 8)
-         {
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-            if (prev_match)
-            {
-               if (target_match_idx == curr_match_idx)
-               {
-                  switch (match_action)
-                  {
-                  case CHEAT_MATCH_ACTION_TYPE_BROWSE:
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_VIEW:
-                     *address = idx;
-                     *address_mask = (mask << (byte_part * bits));
-                     *curr_value = curr_val;
-                     *prev_value = prev_val;
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_COPY:
-                     if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, (mask << (byte_part * bits)),
-                           cheat_st->big_endian, curr_val))
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     else
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_DELETE:
-                     if (bits < 8)
-                        *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                              ((~(mask << (byte_part * bits))) & 0xFF);
-                     else
-                        memset(cheat_st->matches + idx, 0, bytes_per_item);
-                     if (cheat_st->num_matches > 0)
-                        cheat_st->num_matches--;
-                     runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  }
-                  return;
-               }
-               curr_match_idx++;
-            }
-         }
-         else
-         {
-            prev_match = *(cheat_st->matches + idx);
-            if (prev_match)
-            {
-               if (target_match_idx == curr_match_idx)
-               {
-                  switch (match_action)
-                  {
-                  case CHEAT_MATCH_ACTION_TYPE_BROWSE:
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_VIEW:
-                     *address = idx;
-                     *address_mask = 0xFF;
-                     *curr_value = curr_val;
-                     *prev_value = prev_val;
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_COPY:
-                     if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, 0xFF,
-                           cheat_st->big_endian, curr_val))
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     else
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_DELETE:
-                     if (bits < 8)
-                        *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                              ((~(mask << (byte_part * bits))) & 0xFF);
-                     else
-                        memset(cheat_st->matches + idx, 0, bytes_per_item);
-                     if (cheat_st->num_matches > 0)
-                        cheat_st->num_matches--;
-                     runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  }
-               }
+   fields         = cheat_search_fields(cheat_st->search_bit_size);
+   num_candidates = cheat_search_num_candidates(
+         cheat_st->search_bit_size, cheat_st->total_memory_size);
+   n              = cheat_search_nth(cheat_st->matches,
+         num_candidates, target_match_idx);
 
-               curr_match_idx++;
-            }
-         }
-      }
+   if (n >= num_candidates)
+      return;
+
+   idx        = (unsigned)(n / fields) * bytes_per_item;
+   field_mask = (bits < 8) ? (mask << ((n % fields) * bits)) : 0xFF;
+   curr_val   = cheat_search_read(&cheat_st->memory_map,
+         cheat_st->total_memory_size, cheat_st->search_bit_size,
+         cheat_st->big_endian, idx);
+   prev_val   = cheat_search_value(prev + idx,
+         cheat_st->search_bit_size, cheat_st->big_endian);
+
+   switch (match_action)
+   {
+      case CHEAT_MATCH_ACTION_TYPE_VIEW:
+         *address      = idx;
+         *address_mask = field_mask;
+         *curr_value   = curr_val;
+         *prev_value   = prev_val;
+         break;
+      case CHEAT_MATCH_ACTION_TYPE_COPY:
+         if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, field_mask,
+               cheat_st->big_endian, curr_val))
+            runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         else
+            runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         break;
+      case CHEAT_MATCH_ACTION_TYPE_DELETE:
+         cheat_st->matches[n >> 5] &= ~(1u << (n & 31));
+         if (cheat_st->num_matches > 0)
+            cheat_st->num_matches--;
+         runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         break;
+      default:
+         break;
    }
 }
 
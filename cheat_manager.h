@@ -21,6 +21,7 @@
 #include <retro_common_api.h>
 
 #include "../setting_list.h"
+#include "memory_map.h"
 
 RETRO_BEGIN_DECLS
 
@@ -161,9 +162,14 @@ struct cheat_manager
    struct item_cheat *cheats;
    uint8_t *curr_memory_buf;
    uint8_t *prev_memory_buf;
-   uint8_t *matches;
+   /* Candidates still matching the search, one bit
+    * each (see cheat_search.h) */
+   uint32_t *matches;
    uint8_t **memory_buf_list;
    unsigned *memory_size_list;
+   /* Search address -> memory buffer, the buffers
+    * laid out back to back from address 0 */
+   memory_map_t memory_map;
    unsigned int delete_state;
    unsigned int loading_cheat_size;
    unsigned int loading_cheat_offset;
@@ -175,6 +181,8 @@ struct cheat_manager
    unsigned match_idx;
    unsigned match_action;
    unsigned search_bit_size;
+   /* search_bit_size the matches are laid out for */
+   unsigned matches_bit_size;
    unsigned dummy;
    unsigned search_exact_value;
    unsigned search_eqplus_value;
@@ -0,0 +1,730 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "cheat_search.h"
+
+/* Items compared per pass; the bitset is only looked
+ * at once per block, so blocks without candidates
+ * are skipped without reading memory */
+#define CHEAT_SEARCH_BLOCK      256
+
+/* Regions with fewer items are never split */
+#define CHEAT_SEARCH_THREAD_MIN (1 << 20)
+#define CHEAT_SEARCH_MAX_THREADS 8
+
+typedef void (*cheat_search_kernel_t)(const cheat_search_params_t *params,
+      const uint8_t *curr, const uint8_t *prev, size_t count, uint8_t *hits);
+
+typedef struct cheat_search_slice
+{
+   const cheat_search_params_t *params;
+   const uint8_t *curr;
+   const uint8_t *prev;
+   uint32_t *bitset;
+   size_t item;
+   size_t count;
+   size_t dropped;
+} cheat_search_slice_t;
+
+static INLINE unsigned cheat_search_popcount(uint32_t x)
+{
+#if defined(__GNUC__)
+   return (unsigned)__builtin_popcount(x);
+#else
+   x = x - ((x >> 1) & 0x55555555);
+   x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+   x = (x + (x >> 4)) & 0x0F0F0F0F;
+   return (x * 0x01010101) >> 24;
+#endif
+}
+
+static INLINE unsigned cheat_search_ctz(uint32_t x)
+{
+#if defined(__GNUC__)
+   return (unsigned)__builtin_ctz(x);
+#else
+   unsigned n = 0;
+   while (!(x & 1))
+   {
+      x >>= 1;
+      n++;
+   }
+   return n;
+#endif
+}
+
+unsigned cheat_search_item_size(unsigned bit_size)
+{
+   switch (bit_size)
+   {
+      case 4:
+         return 2;
+      case 5:
+         return 4;
+      default:
+         break;
+   }
+   return 1;
+}
+
+unsigned cheat_search_fields(unsigned bit_size)
+{
+   return (bit_size < 3) ? (8 >> bit_size) : 1;
+}
+
+size_t cheat_search_num_candidates(unsigned bit_size, size_t size)
+{
+   size_t item_size = cheat_search_item_size(bit_size);
+   return ((size + item_size - 1) / item_size)
+      * cheat_search_fields(bit_size);
+}
+
+size_t cheat_search_bitset_words(unsigned bit_size, size_t size)
+{
+   return (cheat_search_num_candidates(bit_size, size) + 31) >> 5;
+}
+
+void cheat_search_bitset_fill(uint32_t *bitset, unsigned bit_size,
+      size_t size)
+{
+   size_t num = cheat_search_num_candidates(bit_size, size);
+
+   memset(bitset, 0xFF, (num >> 5) * sizeof(*bitset));
+   if (num & 31)
+      bitset[num >> 5] = (1u << (num & 31)) - 1;
+}
+
+static INLINE bool cheat_search_bit(const uint32_t *bitset, size_t n)
+{
+   return (bitset[n >> 5] >> (n & 31)) & 1;
+}
+
+/* Field mask a byte keeps for the candidates of @bit_size */
+static uint8_t cheat_search_byte_mask(const uint32_t *bitset,
+      unsigned bit_size, size_t byte)
+{
+   unsigned f;
+   uint8_t mask;
+   unsigned fields;
+   unsigned bits;
+
+   if (bit_size >= 3)
+      return cheat_search_bit(bitset,
+            byte / cheat_search_item_size(bit_size)) ? 0xFF : 0;
+
+   fields = cheat_search_fields(bit_size);
+   bits   = 8 / fields;
+   mask   = 0;
+
+   for (f = 0; f < fields; f++)
+      if (cheat_search_bit(bitset, byte * fields + f))
+         mask |= ((1 << bits) - 1) << (f * bits);
+
+   return mask;
+}
+
+void cheat_search_convert(const uint32_t *src, unsigned src_bit_size,
+      uint32_t *dst, unsigned dst_bit_size, size_t size)
+{
+   size_t n;
+   unsigned fields    = cheat_search_fields(dst_bit_size);
+   unsigned item_size = cheat_search_item_size(dst_bit_size);
+   unsigned bits      = 8 / fields;
+   size_t num         = cheat_search_num_candidates(dst_bit_size, size);
+
+   memset(dst, 0, cheat_search_bitset_words(dst_bit_size, size)
+         * sizeof(*dst));
+
+   for (n = 0; n < num; n++)
+   {
+      size_t byte  = (n / fields) * item_size;
+      uint8_t mask = cheat_search_byte_mask(src, src_bit_size, byte);
+
+      if (dst_bit_size >= 3)
+      {
+         if (mask)
+            dst[n >> 5] |= 1u << (n & 31);
+      }
+      else if (mask & (((1 << bits) - 1) << ((n % fields) * bits)))
+         dst[n >> 5] |= 1u << (n & 31);
+   }
+}
+
+static INLINE uint32_t cheat_search_load(const uint8_t *data,
+      unsigned item_size, bool big_endian)
+{
+   switch (item_size)
+   {
+      case 2:
+         return big_endian
+            ? ((uint32_t)data[0] << 8) | data[1]
+            : ((uint32_t)data[1] << 8) | data[0];
+      case 4:
+         return big_endian
+            ? ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+            | ((uint32_t)data[2] << 8)  | data[3]
+            : ((uint32_t)data[3] << 24) | ((uint32_t)data[2] << 16)
+            | ((uint32_t)data[1] << 8)  | data[0];
+      default:
+         break;
+   }
+   return data[0];
+}
+
+uint32_t cheat_search_value(const uint8_t *data, unsigned bit_size,
+      bool big_endian)
+{
+   return cheat_search_load(data, cheat_search_item_size(bit_size),
+         big_endian);
+}
+
+uint32_t cheat_search_read(const memory_map_t *map, size_t size,
+      unsigned bit_size, bool big_endian, uint32_t address)
+{
+   unsigned i;
+   uint8_t bytes[4];
+   unsigned item_size = cheat_search_item_size(bit_size);
+
+   for (i = 0; i < item_size; i++)
+   {
+      const uint8_t *data = NULL;
+
+      if (address + i < size)
+         data = memory_map_find(map, address + i, NULL);
+      bytes[i] = data ? *data : 0;
+   }
+
+   return cheat_search_load(bytes, item_size, big_endian);
+}
+
+/* Sums are done on 32-bit unsigned values, so 'equal
+ * plus/minus' wrap around at 32 bits whatever the
+ * search size */
+static INLINE bool cheat_search_test(enum cheat_search_type type,
+      uint32_t curr, uint32_t prev, uint32_t value)
+{
+   switch (type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         return curr == value;
+      case CHEAT_SEARCH_TYPE_LT:
+         return curr < prev;
+      case CHEAT_SEARCH_TYPE_GT:
+         return curr > prev;
+      case CHEAT_SEARCH_TYPE_LTE:
+         return curr <= prev;
+      case CHEAT_SEARCH_TYPE_GTE:
+         return curr >= prev;
+      case CHEAT_SEARCH_TYPE_EQ:
+         return curr == prev;
+      case CHEAT_SEARCH_TYPE_NEQ:
+         return curr != prev;
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         return curr == prev + value;
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         return curr == prev - value;
+   }
+   return false;
+}
+
+/* Kernels set hits[i] to the fields of item i that
+ * match; whole items use 0xFF for a match */
+#define CHEAT_SEARCH_C_KERNEL(name, item_size, big_endian) \
+static void name(const cheat_search_params_t *params, \
+      const uint8_t *curr, const uint8_t *prev, size_t count, \
+      uint8_t *hits) \
+{ \
+   size_t i; \
+   enum cheat_search_type type = params->type; \
+   uint32_t value              = params->value; \
+   for (i = 0; i < count; i++) \
+      hits[i] = cheat_search_test(type, \
+            cheat_search_load(curr + i * item_size, item_size, big_endian), \
+            cheat_search_load(prev + i * item_size, item_size, big_endian), \
+            value) ? 0xFF : 0; \
+}
+
+CHEAT_SEARCH_C_KERNEL(cheat_search_hits_8,      1, false)
+CHEAT_SEARCH_C_KERNEL(cheat_search_hits_16le,   2, false)
+CHEAT_SEARCH_C_KERNEL(cheat_search_hits_16be,   2, true)
+CHEAT_SEARCH_C_KERNEL(cheat_search_hits_32le,   4, false)
+CHEAT_SEARCH_C_KERNEL(cheat_search_hits_32be,   4, true)
+
+static void cheat_search_hits_fields(const cheat_search_params_t *params,
+      const uint8_t *curr, const uint8_t *prev, size_t count,
+      uint8_t *hits)
+{
+   size_t i;
+   unsigned fields             = cheat_search_fields(params->bit_size);
+   unsigned bits               = 8 / fields;
+   uint32_t mask               = (1 << bits) - 1;
+   enum cheat_search_type type = params->type;
+   uint32_t value              = params->value;
+
+   for (i = 0; i < count; i++)
+   {
+      unsigned f;
+      uint8_t hit = 0;
+
+      for (f = 0; f < fields; f++)
+         if (cheat_search_test(type,
+                  (curr[i] >> (f * bits)) & mask,
+                  (prev[i] >> (f * bits)) & mask, value))
+            hit |= 1 << f;
+
+      hits[i] = hit;
+   }
+}
+
+#if __SSE2__
+/* Lane-wise versions of cheat_search_test(). Unsigned
+ * compares flip the sign bit; 'equal plus/minus' compare
+ * the difference and, below 32 bits, also require that
+ * it did not wrap. Only used when the value fits in a
+ * lane, otherwise the C kernels run. */
+#define CHEAT_SEARCH_SSE2_KERNEL(name, lane, item_size, swap, pack) \
+static void name(const cheat_search_params_t *params, \
+      const uint8_t *curr, const uint8_t *prev, size_t count, \
+      uint8_t *hits) \
+{ \
+   size_t i; \
+   const unsigned per    = 16 / item_size; \
+   const __m128i bias    = _mm_set1_epi32((lane == 8) \
+         ? (int)0x80808080 : (lane == 16) \
+         ? (int)0x80008000 : (int)0x80000000); \
+   const __m128i value   = _mm_set1_epi##lane((int)params->value); \
+   const __m128i ones    = _mm_set1_epi32(-1); \
+   for (i = 0; i + per <= count; i += per) \
+   { \
+      __m128i m; \
+      __m128i c  = _mm_loadu_si128((const __m128i*)(curr + i * item_size)); \
+      __m128i p  = _mm_loadu_si128((const __m128i*)(prev + i * item_size)); \
+      c          = swap(c); \
+      p          = swap(p); \
+      switch (params->type) \
+      { \
+         case CHEAT_SEARCH_TYPE_EXACT: \
+            m = _mm_cmpeq_epi##lane(c, value); \
+            break; \
+         case CHEAT_SEARCH_TYPE_LT: \
+            m = _mm_cmpgt_epi##lane(_mm_xor_si128(p, bias), \
+                  _mm_xor_si128(c, bias)); \
+            break; \
+         case CHEAT_SEARCH_TYPE_GT: \
+            m = _mm_cmpgt_epi##lane(_mm_xor_si128(c, bias), \
+                  _mm_xor_si128(p, bias)); \
+            break; \
+         case CHEAT_SEARCH_TYPE_LTE: \
+            m = _mm_xor_si128(ones, _mm_cmpgt_epi##lane( \
+                     _mm_xor_si128(c, bias), _mm_xor_si128(p, bias))); \
+            break; \
+         case CHEAT_SEARCH_TYPE_GTE: \
+            m = _mm_xor_si128(ones, _mm_cmpgt_epi##lane( \
+                     _mm_xor_si128(p, bias), _mm_xor_si128(c, bias))); \
+            break; \
+         case CHEAT_SEARCH_TYPE_EQ: \
+            m = _mm_cmpeq_epi##lane(c, p); \
+            break; \
+         case CHEAT_SEARCH_TYPE_NEQ: \
+            m = _mm_xor_si128(ones, _mm_cmpeq_epi##lane(c, p)); \
+            break; \
+         case CHEAT_SEARCH_TYPE_EQPLUS: \
+            m = _mm_cmpeq_epi##lane(_mm_sub_epi##lane(c, p), value); \
+            if (lane < 32) \
+               m = _mm_andnot_si128(_mm_cmpgt_epi##lane( \
+                        _mm_xor_si128(p, bias), _mm_xor_si128(c, bias)), m); \
+            break; \
+         case CHEAT_SEARCH_TYPE_EQMINUS: \
+         default: \
+            m = _mm_cmpeq_epi##lane(_mm_sub_epi##lane(p, c), value); \
+            if (lane < 32) \
+               m = _mm_andnot_si128(_mm_cmpgt_epi##lane( \
+                        _mm_xor_si128(c, bias), _mm_xor_si128(p, bias)), m); \
+            break; \
+      } \
+      pack(hits + i, m); \
+   } \
+   if (i < count) \
+      name##_c(params, curr + i * item_size, prev + i * item_size, \
+            count - i, hits + i); \
+}
+
+static INLINE __m128i cheat_search_swap_none(__m128i x)
+{
+   return x;
+}
+
+static INLINE __m128i cheat_search_swap16(__m128i x)
+{
+   return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+static INLINE __m128i cheat_search_swap32(__m128i x)
+{
+   x = cheat_search_swap16(x);
+   return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+}
+
+static INLINE void cheat_search_pack8(uint8_t *hits, __m128i m)
+{
+   _mm_storeu_si128((__m128i*)hits, m);
+}
+
+static INLINE void cheat_search_pack16(uint8_t *hits, __m128i m)
+{
+   _mm_storel_epi64((__m128i*)hits, _mm_packs_epi16(m, m));
+}
+
+static INLINE void cheat_search_pack32(uint8_t *hits, __m128i m)
+{
+   int32_t v;
+   m = _mm_packs_epi32(m, m);
+   v = _mm_cvtsi128_si32(_mm_packs_epi16(m, m));
+   memcpy(hits, &v, sizeof(v));
+}
+
+/* _mm_set1_epi8/16/32 and cmpgt/cmpeq/sub all exist
+ * for 8, 16 and 32-bit lanes */
+#define cheat_search_sse2_8_c      cheat_search_hits_8
+#define cheat_search_sse2_16le_c   cheat_search_hits_16le
+#define cheat_search_sse2_16be_c   cheat_search_hits_16be
+#define cheat_search_sse2_32le_c   cheat_search_hits_32le
+#define cheat_search_sse2_32be_c   cheat_search_hits_32be
+
+CHEAT_SEARCH_SSE2_KERNEL(cheat_search_sse2_8,    8,  1,
+      cheat_search_swap_none, cheat_search_pack8)
+CHEAT_SEARCH_SSE2_KERNEL(cheat_search_sse2_16le, 16, 2,
+      cheat_search_swap_none, cheat_search_pack16)
+CHEAT_SEARCH_SSE2_KERNEL(cheat_search_sse2_16be, 16, 2,
+      cheat_search_swap16,    cheat_search_pack16)
+CHEAT_SEARCH_SSE2_KERNEL(cheat_search_sse2_32le, 32, 4,
+      cheat_search_swap_none, cheat_search_pack32)
+CHEAT_SEARCH_SSE2_KERNEL(cheat_search_sse2_32be, 32, 4,
+      cheat_search_swap32,    cheat_search_pack32)
+#endif
+
+static cheat_search_kernel_t cheat_search_get_kernel(
+      const cheat_search_params_t *params)
+{
+#if __SSE2__
+   unsigned item_size = cheat_search_item_size(params->bit_size);
+   /* Lanes can not reproduce values wider than themselves */
+   bool fits          = (item_size == 4)
+      || (params->value >> (item_size * 8)) == 0;
+#endif
+
+   switch (params->bit_size)
+   {
+      case 3:
+#if __SSE2__
+         if (fits)
+            return cheat_search_sse2_8;
+#endif
+         return cheat_search_hits_8;
+      case 4:
+#if __SSE2__
+         if (fits)
+            return params->big_endian
+               ? cheat_search_sse2_16be : cheat_search_sse2_16le;
+#endif
+         return params->big_endian
+            ? cheat_search_hits_16be : cheat_search_hits_16le;
+      case 5:
+#if __SSE2__
+         if (fits)
+            return params->big_endian
+               ? cheat_search_sse2_32be : cheat_search_sse2_32le;
+#endif
+         return params->big_endian
+            ? cheat_search_hits_32be : cheat_search_hits_32le;
+      default:
+         break;
+   }
+
+   return cheat_search_hits_fields;
+}
+
+/* Drops the candidates of @count items starting at
+ * candidate @first whose hits are not set */
+static size_t cheat_search_fold(uint32_t *bitset, size_t first,
+      const uint8_t *hits, size_t count, unsigned fields)
+{
+   size_t i         = 0;
+   size_t dropped   = 0;
+   uint32_t fmask   = (fields == 8) ? 0xFF : ((1u << fields) - 1);
+
+   while (i < count)
+   {
+      uint32_t *word  = &bitset[first >> 5];
+      unsigned shift  = first & 31;
+      uint32_t keep   = 0;
+      uint32_t range  = 0;
+      uint32_t drop;
+
+      for (; shift < 32 && i < count; i++, shift += fields)
+      {
+         keep  |= (hits[i] & fmask) << shift;
+         range |= fmask << shift;
+      }
+
+      first   += (shift - (first & 31));
+      drop     = *word & range & ~keep;
+      *word   &= ~drop;
+      dropped += cheat_search_popcount(drop);
+   }
+
+   return dropped;
+}
+
+static bool cheat_search_any(const uint32_t *bitset,
+      size_t first, size_t last)
+{
+   size_t w;
+   for (w = first >> 5; w <= (last >> 5); w++)
+      if (bitset[w])
+         return true;
+   return false;
+}
+
+static size_t cheat_search_filter_items(
+      const cheat_search_params_t *params,
+      const uint8_t *curr, const uint8_t *prev,
+      size_t item, size_t count, uint32_t *bitset)
+{
+   uint8_t hits[CHEAT_SEARCH_BLOCK];
+   size_t dropped                = 0;
+   unsigned item_size            = cheat_search_item_size(params->bit_size);
+   unsigned fields               = cheat_search_fields(params->bit_size);
+   cheat_search_kernel_t kernel  = cheat_search_get_kernel(params);
+
+   while (count)
+   {
+      size_t block = MIN(count, CHEAT_SEARCH_BLOCK);
+      size_t first = item * fields;
+
+      if (cheat_search_any(bitset, first, first + block * fields - 1))
+      {
+         kernel(params, curr, prev, block, hits);
+         dropped += cheat_search_fold(bitset, first, hits, block, fields);
+      }
+
+      curr  += block * item_size;
+      prev  += block * item_size;
+      item  += block;
+      count -= block;
+   }
+
+   return dropped;
+}
+
+#ifdef HAVE_THREADS
+static void cheat_search_slice_work(void *data)
+{
+   cheat_search_slice_t *slice = (cheat_search_slice_t*)data;
+   slice->dropped = cheat_search_filter_items(slice->params,
+         slice->curr, slice->prev, slice->item, slice->count,
+         slice->bitset);
+}
+
+/* Slices start on a block boundary, so that no two of
+ * them share a bitset word */
+static size_t cheat_search_filter_threaded(
+      const cheat_search_params_t *params,
+      const uint8_t *curr, const uint8_t *prev,
+      size_t item, size_t count, uint32_t *bitset, unsigned threads)
+{
+   unsigned i;
+   cheat_search_slice_t slices[CHEAT_SEARCH_MAX_THREADS];
+   size_t dropped     = 0;
+   size_t end         = item + count;
+   size_t step        = count / threads;
+   unsigned item_size = cheat_search_item_size(params->bit_size);
+   tpool_t *pool      = tpool_create(threads - 1);
+
+   if (!pool)
+      return cheat_search_filter_items(params, curr, prev,
+            item, count, bitset);
+
+   for (i = 0; i < threads; i++)
+   {
+      size_t from = (i == 0) ? item
+         : ((item + i * step) & ~(size_t)(CHEAT_SEARCH_BLOCK - 1));
+      size_t to   = (i == threads - 1) ? end
+         : ((item + (i + 1) * step) & ~(size_t)(CHEAT_SEARCH_BLOCK - 1));
+
+      slices[i].params  = params;
+      slices[i].curr    = curr + (from - item) * item_size;
+      slices[i].prev    = prev + (from - item) * item_size;
+      slices[i].bitset  = bitset;
+      slices[i].item    = from;
+      slices[i].count   = to - from;
+      slices[i].dropped = 0;
+
+      /* The calling thread takes the last slice */
+      if (i < threads - 1)
+      {
+         if (!tpool_add_work(pool, cheat_search_slice_work, &slices[i]))
+            cheat_search_slice_work(&slices[i]);
+      }
+   }
+
+   cheat_search_slice_work(&slices[threads - 1]);
+   tpool_wait(pool);
+   tpool_destroy(pool);
+
+   for (i = 0; i < threads; i++)
+      dropped += slices[i].dropped;
+
+   return dropped;
+}
+#endif
+
+size_t cheat_search_filter(const cheat_search_params_t *params,
+      const memory_map_t *map, size_t size, const uint8_t *prev,
+      uint32_t *bitset, unsigned threads)
+{
+   unsigned i;
+   size_t dropped     = 0;
+   size_t last_split  = (size_t)-1;
+   unsigned item_size = cheat_search_item_size(params->bit_size);
+   size_t num_items   = (size + item_size - 1) / item_size;
+
+   if (threads > CHEAT_SEARCH_MAX_THREADS)
+      threads = CHEAT_SEARCH_MAX_THREADS;
+
+   for (i = 0; i < map->num_regions; i++)
+   {
+      const memory_map_region_t *region = &map->regions[i];
+      size_t start = region->start;
+      size_t end   = MIN((size_t)region->start + region->size, size);
+      size_t first = (start + item_size - 1) / item_size;
+      size_t last  = end / item_size;
+
+      if (start >= end || !region->data)
+         continue;
+
+      /* Items that lie entirely within the region */
+      if (last > first)
+      {
+         const uint8_t *curr = region->data
+            + (first * item_size - start);
+         size_t count        = last - first;
+
+#ifdef HAVE_THREADS
+         if (threads > 1 && count >= CHEAT_SEARCH_THREAD_MIN)
+            dropped += cheat_search_filter_threaded(params, curr,
+                  prev + first * item_size, first, count, bitset, threads);
+         else
+#endif
+            dropped += cheat_search_filter_items(params, curr,
+                  prev + first * item_size, first, count, bitset);
+      }
+
+      /* An item running into the next region (or past
+       * the end of the memory) is gathered byte by byte */
+      if (     (end % item_size)
+            && last < num_items
+            && last != last_split)
+      {
+         unsigned k;
+         uint8_t bytes[4];
+
+         for (k = 0; k < item_size; k++)
+         {
+            const uint8_t *data = NULL;
+            if (last * item_size + k < size)
+               data = memory_map_find(map,
+                     (uint32_t)(last * item_size + k), NULL);
+            bytes[k] = data ? *data : 0;
+         }
+
+         dropped   += cheat_search_filter_items(params, bytes,
+               prev + last * item_size, last, 1, bitset);
+         last_split = last;
+      }
+   }
+
+   return dropped;
+}
+
+size_t cheat_search_next(const uint32_t *bitset, size_t num_candidates,
+      size_t from)
+{
+   size_t w;
+   size_t words = (num_candidates + 31) >> 5;
+   uint32_t bits;
+
+   if (from >= num_candidates)
+      return num_candidates;
+
+   w    = from >> 5;
+   bits = bitset[w] & (~0u << (from & 31));
+
+   for (;;)
+   {
+      if (bits)
+      {
+         size_t n = (w << 5) + cheat_search_ctz(bits);
+         return (n < num_candidates) ? n : num_candidates;
+      }
+      if (++w >= words)
+         return num_candidates;
+      bits = bitset[w];
+   }
+}
+
+size_t cheat_search_nth(const uint32_t *bitset, size_t num_candidates,
+      size_t n)
+{
+   size_t w;
+   size_t words = (num_candidates + 31) >> 5;
+
+   for (w = 0; w < words; w++)
+   {
+      uint32_t bits  = bitset[w];
+      unsigned count = cheat_search_popcount(bits);
+
+      if (n >= count)
+      {
+         n -= count;
+         continue;
+      }
+
+      while (n--)
+         bits &= bits - 1;
+
+      return MIN((w << 5) + cheat_search_ctz(bits), num_candidates);
+   }
+
+   return num_candidates;
+}
@@ -0,0 +1,134 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CHEAT_SEARCH_H
+#define __CHEAT_SEARCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include "cheat_manager.h"
+#include "memory_map.h"
+
+RETRO_BEGIN_DECLS
+
+/* Cheat search engine.
+ *
+ * The searched memory is a flat address space (the
+ * regions of a memory_map_t laid out back to back) cut
+ * into items of 1, 2 or 4 bytes, starting at address 0.
+ * For searches narrower than a byte, every byte is one
+ * item holding 8, 4 or 2 fields. Each field of each item
+ * is a candidate: candidate n is field (n % fields) of
+ * item (n / fields), and the candidates still matching
+ * are kept as a bitset of 32-bit words.
+ *
+ * Whole regions are compared at once (with SSE2 where
+ * available) and large regions can be split across
+ * threads. Results are the same as comparing item by
+ * item, in the way cheat_manager did before. */
+
+typedef struct cheat_search_params
+{
+   enum cheat_search_type type;
+   /* Exact, 'equal plus' or 'equal minus' value */
+   uint32_t value;
+   /* cheat_manager_t search_bit_size:
+    * 0-2 for 1/2/4 bit fields, 3-5 for 1/2/4 byte items */
+   unsigned bit_size;
+   bool big_endian;
+} cheat_search_params_t;
+
+/* Bytes per item */
+unsigned cheat_search_item_size(unsigned bit_size);
+
+/* Candidates per item */
+unsigned cheat_search_fields(unsigned bit_size);
+
+size_t cheat_search_num_candidates(unsigned bit_size, size_t size);
+
+/* Number of bitset words needed for @size bytes */
+size_t cheat_search_bitset_words(unsigned bit_size, size_t size);
+
+/* Marks every candidate as matching */
+void cheat_search_bitset_fill(uint32_t *bitset, unsigned bit_size,
+      size_t size);
+
+/**
+ * cheat_search_convert:
+ * @src                 : Bitset laid out for @src_bit_size.
+ * @dst                 : Bitset laid out for @dst_bit_size.
+ * @size                : Size of the searched memory.
+ *
+ * Carries the candidates over when the search size changes
+ * without restarting the search. A byte is still a
+ * candidate for the new size if any of its fields or the
+ * item holding it was one.
+ **/
+void cheat_search_convert(const uint32_t *src, unsigned src_bit_size,
+      uint32_t *dst, unsigned dst_bit_size, size_t size);
+
+/* Returns the value of the item stored at @data */
+uint32_t cheat_search_value(const uint8_t *data, unsigned bit_size,
+      bool big_endian);
+
+/**
+ * cheat_search_read:
+ * @map                 : Searched memory.
+ * @size                : Size of the searched memory.
+ * @bit_size            : Search size.
+ * @big_endian          : Byte order of multi-byte items.
+ * @address             : Address of the item.
+ *
+ * Returns: value of the item at @address, bytes past
+ * the end of the memory read as 0.
+ **/
+uint32_t cheat_search_read(const memory_map_t *map, size_t size,
+      unsigned bit_size, bool big_endian, uint32_t address);
+
+/**
+ * cheat_search_filter:
+ * @params              : Search to run.
+ * @map                 : Current memory.
+ * @size                : Size of the searched memory.
+ * @prev                : Memory at the previous search, flat,
+ *                        padded with at least 3 bytes.
+ * @bitset              : Candidates, updated in place.
+ * @threads             : Number of threads to split large
+ *                        regions across.
+ *
+ * Drops every candidate that does not match the search.
+ *
+ * Returns: number of candidates dropped.
+ **/
+size_t cheat_search_filter(const cheat_search_params_t *params,
+      const memory_map_t *map, size_t size, const uint8_t *prev,
+      uint32_t *bitset, unsigned threads);
+
+/* Returns the first candidate >= @from, or @num_candidates */
+size_t cheat_search_next(const uint32_t *bitset, size_t num_candidates,
+      size_t from);
+
+/* Returns candidate number @n (counting from 0), or
+ * @num_candidates if there are not that many */
+size_t cheat_search_nth(const uint32_t *bitset, size_t num_candidates,
+      size_t n);
+
+RETRO_END_DECLS
+
+#endif
@@ -82,6 +82,7 @@ static rcheevos_locals_t rcheevos_locals =
    {0},  /* runtime */
    {0},  /* game */
    {{0}},/* memory */
+   {0},  /* memory_map */
 #ifdef HAVE_THREADS
    CMD_EVENT_NONE, /* queued_command */
 #endif
@@ -199,6 +200,30 @@ static int rcheevos_init_memory(rcheevos_locals_t* locals)
          rcheevos_get_core_memory_info, locals->game.console_id);
 
    free(descriptors);
+
+   /* Achievement addresses index the regions back to back */
+   memory_map_free(&locals->memory_map);
+   if (result)
+   {
+      uint32_t address = 0;
+
+      for (i = 0; i < locals->memory.count; ++i)
+      {
+         if (locals->memory.data[i] && !memory_map_add(
+                  &locals->memory_map, address, locals->memory.data[i],
+                  locals->memory.size[i], 0))
+            break;
+         address += (uint32_t)locals->memory.size[i];
+      }
+
+      if (     i < locals->memory.count
+            || !memory_map_build(&locals->memory_map))
+      {
+         CHEEVOS_ERR(RCHEEVOS_TAG "Failed to index core memory\n");
+         memory_map_free(&locals->memory_map);
+      }
+   }
+
    return result;
 }
 
@@ -208,14 +233,14 @@ uint8_t* rcheevos_patch_address(unsigned address)
     * (no achievements for this game?), try now */
    if (rcheevos_locals.memory.count == 0)
       rcheevos_init_memory(&rcheevos_locals);
-   return rc_libretro_memory_find(&rcheevos_locals.memory, address);
+   return memory_map_find(&rcheevos_locals.memory_map, address, NULL);
 }
 
 static unsigned rcheevos_peek(unsigned address,
       unsigned num_bytes, void* ud)
 {
-   uint8_t* data = rc_libretro_memory_find(
-         &rcheevos_locals.memory, address);
+   uint8_t* data = memory_map_find(
+         &rcheevos_locals.memory_map, address, NULL);
 
    if (data)
    {
@@ -637,6 +662,7 @@ bool rcheevos_unload(void)
 
    if (rcheevos_locals.memory.count > 0)
       rc_libretro_memory_destroy(&rcheevos_locals.memory);
+   memory_map_free(&rcheevos_locals.memory_map);
 
    if (rcheevos_locals.loaded)
    {
@@ -1057,8 +1083,8 @@ static void rcheevos_runtime_event_handler(
 
 static int rcheevos_runtime_address_validator(unsigned address)
 {
-   return rc_libretro_memory_find(
-            &rcheevos_locals.memory, address) != NULL;
+   return memory_map_find(
+            &rcheevos_locals.memory_map, address, NULL) != NULL;
 }
 
 static void rcheevos_validate_memrefs(rcheevos_locals_t* locals)
@@ -1080,6 +1106,7 @@ static void rcheevos_validate_memrefs(rcheevos_locals_t* locals)
          if (locals->memory.total_size != 0)
          {
             locals->memory.count = 0;
+            memory_map_free(&locals->memory_map);
             return;
          }
       }
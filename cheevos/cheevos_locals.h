@@ -30,6 +30,7 @@
 #include <retro_common_api.h>
 
 #include "../command.h"
+#include "../memory_map.h"
 #include "../verbosity.h"
 
 RETRO_BEGIN_DECLS
@@ -163,6 +164,7 @@ typedef struct rcheevos_locals_t
    rc_runtime_t runtime;              /* rcheevos runtime state */
    rcheevos_game_info_t game;         /* information about the current game */
    rc_libretro_memory_regions_t memory;/* achievement addresses to core memory mappings */
+   memory_map_t memory_map;           /* page table over the memory regions */
 
 #ifdef HAVE_THREADS
    enum event_command queued_command; /* action queued by background thread to be run on main thread */
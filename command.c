@@ -56,9 +56,12 @@
 #include "command.h"
 #include "core_info.h"
 #include "cheat_manager.h"
+#include "command_protocol.h"
 #include "content.h"
 #include "dynamic.h"
+#include "frame_telemetry.h"
 #include "list_special.h"
+#include "memory_map.h"
 #include "paths.h"
 #include "retroarch.h"
 #include "verbosity.h"
@@ -67,6 +70,53 @@
 
 #define CMD_BUF_SIZE           4096
 
+/* Fills in the region holding @address, from the memory
+ * map or, if it could not be built, from the first
+ * descriptor matching the address */
+static bool command_memory_find_region(const rarch_system_info_t *system,
+      uint32_t address, memory_map_region_t *region)
+{
+   const rarch_memory_descriptor_t *desc = system->mmaps.descriptors;
+   const rarch_memory_descriptor_t *end  = desc + system->mmaps.num_descriptors;
+
+   if (system->mmaps.map.pages)
+   {
+      const memory_map_region_t *found = memory_map_find_region(
+            &system->mmaps.map, address);
+      if (!found)
+         return false;
+      *region = *found;
+      return true;
+   }
+
+   for (; desc < end; desc++)
+   {
+      if (desc->core.select == 0)
+      {
+         /* if select is 0, attempt to explicitly match the address */
+         if (     address <  desc->core.start
+               || address >= desc->core.start + desc->core.len)
+            continue;
+      }
+      /* otherwise, attempt to match the address by matching the
+       * select bits, and make sure the descriptor is large enough
+       * to hold the target address */
+      else if (   ((desc->core.start ^ address) & desc->core.select)
+               || address - desc->core.start >= desc->core.len)
+         continue;
+
+      region->data  = desc->core.ptr
+         ? (uint8_t*)desc->core.ptr + desc->core.offset : NULL;
+      region->start = (uint32_t)desc->core.start;
+      region->size  = (uint32_t)desc->core.len;
+      region->flags = (desc->core.flags & RETRO_MEMDESC_CONST)
+         ? MEMORY_MAP_READONLY : 0;
+      return true;
+   }
+
+   return false;
+}
+
 #if defined(HAVE_COMMAND)
 
 /* Generic command parse utilities */
@@ -144,6 +194,761 @@ static void command_parse_msg(
    }
 }
 
+#if defined(HAVE_NETWORK_CMD) || defined(HAVE_LAKKA)
+/* Stream command sockets (TCP and Unix domain), see
+ * command_protocol.h for the binary framing */
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#define HAVE_COMMAND_EPOLL
+#endif
+
+#define COMMAND_STREAM_MAX_CLIENTS  4
+/* Bytes a client may have pending in either direction
+ * before it is dropped */
+#define COMMAND_STREAM_MAX_PENDING  (4 * (COMMAND_BINARY_HEADER_SIZE \
+         + COMMAND_BINARY_MAX_PAYLOAD))
+
+typedef struct
+{
+   /* Bytes at the previous frame */
+   uint8_t *last;
+   uint32_t address;
+   uint32_t size;
+   /* Sent at least once since WATCH */
+   bool primed;
+} command_watch_t;
+
+typedef struct
+{
+   /* Received bytes not parsed yet */
+   uint8_t *in;
+   /* Replies the socket did not take yet */
+   uint8_t *out;
+   command_watch_t *watches;
+   size_t in_len;
+   size_t in_cap;
+   size_t out_len;
+   size_t out_cap;
+   unsigned num_watches;
+   int fd;
+   bool binary;
+} command_stream_client_t;
+
+typedef struct
+{
+   command_stream_client_t clients[COMMAND_STREAM_MAX_CLIENTS];
+   /* Client the command being run replies to */
+   command_stream_client_t *current;
+   /* Listening socket */
+   int fd;
+#ifdef HAVE_COMMAND_EPOLL
+   int epoll_fd;
+#endif
+   bool tcp;
+} command_stream_t;
+
+static uint32_t command_binary_get32(const uint8_t *data)
+{
+   return  (uint32_t)data[0]        | ((uint32_t)data[1] << 8)
+         | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void command_binary_put32(uint8_t *data, uint32_t value)
+{
+   data[0] = (uint8_t)(value);
+   data[1] = (uint8_t)(value >> 8);
+   data[2] = (uint8_t)(value >> 16);
+   data[3] = (uint8_t)(value >> 24);
+}
+
+static void command_binary_put_header(uint8_t *data, uint8_t op,
+      uint8_t status, uint16_t count, uint32_t size)
+{
+   data[0] = op;
+   data[1] = status;
+   data[2] = (uint8_t)(count);
+   data[3] = (uint8_t)(count >> 8);
+   command_binary_put32(data + 4, size);
+}
+
+static bool command_stream_reserve(uint8_t **buf, size_t *cap, size_t len)
+{
+   uint8_t *tmp;
+   size_t new_cap = *cap ? *cap : 4096;
+
+   if (len <= *cap)
+      return true;
+   if (len > COMMAND_STREAM_MAX_PENDING + 4096)
+      return false;
+
+   while (new_cap < len)
+      new_cap *= 2;
+
+   if (!(tmp = (uint8_t*)realloc(*buf, new_cap)))
+      return false;
+
+   *buf = tmp;
+   *cap = new_cap;
+   return true;
+}
+
+static void command_stream_clear_watches(command_stream_client_t *client)
+{
+   unsigned i;
+
+   for (i = 0; i < client->num_watches; i++)
+      free(client->watches[i].last);
+   free(client->watches);
+
+   client->watches     = NULL;
+   client->num_watches = 0;
+}
+
+static void command_stream_close(command_stream_t *stream,
+      command_stream_client_t *client)
+{
+   if (client->fd < 0)
+      return;
+
+#ifdef HAVE_COMMAND_EPOLL
+   epoll_ctl(stream->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+#endif
+   socket_close(client->fd);
+   command_stream_clear_watches(client);
+   free(client->in);
+   free(client->out);
+
+   memset(client, 0, sizeof(*client));
+   client->fd = -1;
+}
+
+/* Returns pointer to a reply of @len bytes appended
+ * to the pending output, or NULL if the client fell
+ * too far behind */
+static uint8_t *command_stream_append(command_stream_client_t *client,
+      size_t len)
+{
+   uint8_t *data;
+
+   if (!command_stream_reserve(&client->out, &client->out_cap,
+            client->out_len + len))
+      return NULL;
+
+   data             = client->out + client->out_len;
+   client->out_len += len;
+   return data;
+}
+
+static void command_stream_write(command_stream_client_t *client,
+      const void *data, size_t len)
+{
+   uint8_t *out = command_stream_append(client, len);
+   if (out)
+      memcpy(out, data, len);
+}
+
+static void command_stream_flush(command_stream_t *stream,
+      command_stream_client_t *client)
+{
+   ssize_t ret = socket_send_all_nonblocking(client->fd,
+         client->out, client->out_len, true);
+
+   if (ret < 0)
+   {
+      command_stream_close(stream, client);
+      return;
+   }
+
+   memmove(client->out, client->out + ret, client->out_len - ret);
+   client->out_len -= ret;
+}
+
+/* Returns pointer to @address and clips @size to the end
+ * of its descriptor, or NULL if it can not be accessed */
+static uint8_t *command_binary_span(const rarch_system_info_t *system,
+      uint32_t address, uint32_t *size, bool for_write)
+{
+   uint32_t offset;
+   memory_map_region_t region;
+
+   if (     !command_memory_find_region(system, address, &region)
+         || !region.data)
+      return NULL;
+   if (for_write && (region.flags & MEMORY_MAP_READONLY))
+      return NULL;
+
+   offset = address - region.start;
+   if (*size > region.size - offset)
+      *size = region.size - offset;
+
+   return region.data + offset;
+}
+
+static void command_binary_status(command_stream_client_t *client,
+      uint8_t op, uint8_t status)
+{
+   uint8_t *out = command_stream_append(client, COMMAND_BINARY_HEADER_SIZE);
+   if (out)
+      command_binary_put_header(out, op, status, 0, 0);
+}
+
+static void command_binary_read(command_stream_client_t *client,
+      const rarch_system_info_t *system,
+      const uint8_t *payload, unsigned count)
+{
+   unsigned i;
+   uint8_t *out;
+   size_t size = 0;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t len = command_binary_get32(payload + i * 8 + 4);
+
+      size += 4;
+      if (command_binary_span(system,
+               command_binary_get32(payload + i * 8), &len, false))
+         size += len;
+
+      if (size > COMMAND_BINARY_MAX_PAYLOAD)
+      {
+         command_binary_status(client, COMMAND_BINARY_OP_READ,
+               COMMAND_BINARY_STATUS_TOO_LARGE);
+         return;
+      }
+   }
+
+   if (!(out = command_stream_append(client,
+               COMMAND_BINARY_HEADER_SIZE + size)))
+      return;
+
+   command_binary_put_header(out, COMMAND_BINARY_OP_READ,
+         COMMAND_BINARY_STATUS_OK, (uint16_t)count, (uint32_t)size);
+   out += COMMAND_BINARY_HEADER_SIZE;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t len        = command_binary_get32(payload + i * 8 + 4);
+      const uint8_t *data = command_binary_span(system,
+            command_binary_get32(payload + i * 8), &len, false);
+
+      if (!data)
+      {
+         command_binary_put32(out, COMMAND_BINARY_UNMAPPED);
+         out += 4;
+         continue;
+      }
+
+      command_binary_put32(out, len);
+      memcpy(out + 4, data, len);
+      out += 4 + len;
+   }
+}
+
+static void command_binary_write(command_stream_client_t *client,
+      const rarch_system_info_t *system,
+      const uint8_t *payload, unsigned count, uint32_t size)
+{
+   unsigned i;
+   uint8_t *out;
+   uint32_t pos  = 0;
+   bool written  = false;
+
+   /* Check the whole request before writing anything */
+   for (i = 0; i < count; i++)
+   {
+      if (size - pos < 8 || size - pos - 8
+            < command_binary_get32(payload + pos + 4))
+         break;
+      pos += 8 + command_binary_get32(payload + pos + 4);
+   }
+
+   if (i < count || pos != size)
+   {
+      command_binary_status(client, COMMAND_BINARY_OP_WRITE,
+            COMMAND_BINARY_STATUS_BAD_REQUEST);
+      return;
+   }
+
+   if (!(out = command_stream_append(client,
+               COMMAND_BINARY_HEADER_SIZE + count * 4)))
+      return;
+
+   command_binary_put_header(out, COMMAND_BINARY_OP_WRITE,
+         COMMAND_BINARY_STATUS_OK, (uint16_t)count, count * 4);
+   out += COMMAND_BINARY_HEADER_SIZE;
+
+   for (i = 0, pos = 0; i < count; i++, out += 4)
+   {
+      uint32_t requested = command_binary_get32(payload + pos + 4);
+      uint32_t len       = requested;
+      uint8_t *data      = command_binary_span(system,
+            command_binary_get32(payload + pos), &len, true);
+
+      if (data)
+      {
+         memcpy(data, payload + pos + 8, len);
+         command_binary_put32(out, len);
+         written = true;
+      }
+      else
+         command_binary_put32(out, COMMAND_BINARY_UNMAPPED);
+
+      pos += 8 + requested;
+   }
+
+#ifdef HAVE_CHEEVOS
+   if (written && rcheevos_hardcore_active())
+   {
+      RARCH_LOG("[Command]: Achievements hardcore mode disabled by binary memory write.\n");
+      rcheevos_pause_hardcore();
+   }
+#endif
+}
+
+static void command_binary_watch(command_stream_client_t *client,
+      const uint8_t *payload, unsigned count)
+{
+   unsigned i;
+   size_t total = 0;
+
+   if (count > COMMAND_BINARY_MAX_WATCHES)
+   {
+      command_binary_status(client, COMMAND_BINARY_OP_WATCH,
+            COMMAND_BINARY_STATUS_TOO_LARGE);
+      return;
+   }
+
+   /* CHANGED must fit in one frame even if every byte changed.
+    * Each length is checked before it is added, so that the sum
+    * can't wrap around even with a 32-bit size_t */
+   for (i = 0; i < count; i++)
+   {
+      uint32_t size = command_binary_get32(payload + i * 8 + 4);
+
+      if (     size > COMMAND_BINARY_MAX_PAYLOAD
+            || (total += 12 + size) > COMMAND_BINARY_MAX_PAYLOAD)
+      {
+         command_binary_status(client, COMMAND_BINARY_OP_WATCH,
+               COMMAND_BINARY_STATUS_TOO_LARGE);
+         return;
+      }
+   }
+
+   command_stream_clear_watches(client);
+
+   if (count)
+   {
+      if (!(client->watches = (command_watch_t*)calloc(count,
+                  sizeof(*client->watches))))
+         return;
+
+      for (i = 0; i < count; i++)
+      {
+         command_watch_t *watch = &client->watches[i];
+
+         watch->address = command_binary_get32(payload + i * 8);
+         watch->size    = command_binary_get32(payload + i * 8 + 4);
+
+         if (watch->size && !(watch->last = (uint8_t*)malloc(watch->size)))
+         {
+            client->num_watches = i;
+            command_stream_clear_watches(client);
+            return;
+         }
+      }
+
+      client->num_watches = count;
+   }
+
+   command_binary_status(client, COMMAND_BINARY_OP_WATCH,
+         COMMAND_BINARY_STATUS_OK);
+}
+
+static void command_binary_dispatch(command_stream_client_t *client,
+      const uint8_t *frame)
+{
+   uint8_t op                        = frame[0];
+   unsigned count                    = frame[2] | (frame[3] << 8);
+   uint32_t size                     = command_binary_get32(frame + 4);
+   const uint8_t *payload            = frame + COMMAND_BINARY_HEADER_SIZE;
+   runloop_state_t *runloop_st       = runloop_state_get_ptr();
+   const rarch_system_info_t *system = &runloop_st->system;
+
+   switch (op)
+   {
+      case COMMAND_BINARY_OP_READ:
+      case COMMAND_BINARY_OP_WRITE:
+      case COMMAND_BINARY_OP_WATCH:
+         break;
+      default:
+         command_binary_status(client, op,
+               COMMAND_BINARY_STATUS_UNKNOWN_OP);
+         return;
+   }
+
+   if (op != COMMAND_BINARY_OP_WRITE && size != count * 8)
+      command_binary_status(client, op, COMMAND_BINARY_STATUS_BAD_REQUEST);
+   else if (op == COMMAND_BINARY_OP_WATCH)
+      command_binary_watch(client, payload, count);
+   else if (system->mmaps.num_descriptors == 0)
+      command_binary_status(client, op,
+            COMMAND_BINARY_STATUS_NO_MEMORY_MAP);
+   else if (op == COMMAND_BINARY_OP_READ)
+      command_binary_read(client, system, payload, count);
+   else
+      command_binary_write(client, system, payload, count, size);
+}
+
+/* Pushes the watched spans that changed since the
+ * previous frame */
+static void command_binary_push_changes(command_stream_client_t *client)
+{
+   unsigned i;
+   size_t header_at;
+   unsigned count                    = 0;
+   runloop_state_t *runloop_st       = runloop_state_get_ptr();
+   const rarch_system_info_t *system = &runloop_st->system;
+
+   if (system->mmaps.num_descriptors == 0)
+      return;
+
+   header_at = client->out_len;
+   if (!command_stream_append(client, COMMAND_BINARY_HEADER_SIZE))
+      return;
+
+   for (i = 0; i < client->num_watches; i++)
+   {
+      uint8_t *out;
+      uint32_t first, last;
+      command_watch_t *watch = &client->watches[i];
+      uint32_t len           = watch->size;
+      const uint8_t *data    = command_binary_span(system,
+            watch->address, &len, false);
+
+      if (!data || !len)
+         continue;
+
+      if (!watch->primed)
+      {
+         first = 0;
+         last  = len - 1;
+      }
+      else
+      {
+         if (!memcmp(watch->last, data, len))
+            continue;
+         for (first = 0;   watch->last[first] == data[first]; first++);
+         for (last = len - 1; watch->last[last] == data[last]; last--);
+      }
+
+      if (!(out = command_stream_append(client, 12 + last - first + 1)))
+      {
+         client->out_len = header_at;
+         return;
+      }
+
+      command_binary_put32(out,     i);
+      command_binary_put32(out + 4, first);
+      command_binary_put32(out + 8, last - first + 1);
+      memcpy(out + 12, data + first, last - first + 1);
+      memcpy(watch->last + first, data + first, last - first + 1);
+
+      watch->primed = true;
+      count++;
+   }
+
+   if (!count)
+      client->out_len = header_at;
+   else
+      command_binary_put_header(client->out + header_at,
+            COMMAND_BINARY_OP_CHANGED, COMMAND_BINARY_STATUS_OK,
+            (uint16_t)count, (uint32_t)(client->out_len - header_at
+               - COMMAND_BINARY_HEADER_SIZE));
+}
+
+/* Runs the complete text lines and binary frames received
+ * so far. With @flush set, once the peer is done sending,
+ * trailing text without a newline is run too, as the
+ * datagram interface does. */
+static void command_stream_parse(command_t *handle,
+      command_stream_t *stream, command_stream_client_t *client, bool flush)
+{
+   size_t pos      = 0;
+
+   stream->current = client;
+
+   while (pos < client->in_len)
+   {
+      if (!client->binary)
+      {
+         char *line    = (char*)client->in + pos;
+         uint8_t *nl   = (uint8_t*)memchr(client->in + pos, '\n',
+               client->in_len - pos);
+         size_t end    = nl ? (size_t)(nl - client->in) : client->in_len;
+
+         if (!nl && !flush)
+            break;
+
+         /* There is always room for the terminator */
+         client->in[end] = '\0';
+         pos             = nl ? end + 1 : end;
+
+         if (string_is_equal(line, COMMAND_BINARY_MODE))
+         {
+            client->binary = true;
+            command_stream_write(client, "BINARY_MODE 1\n",
+                  STRLEN_CONST("BINARY_MODE 1\n"));
+         }
+         else if (*line)
+            command_parse_sub_msg(handle, line);
+      }
+      else
+      {
+         uint32_t size;
+
+         if (client->in_len - pos < COMMAND_BINARY_HEADER_SIZE)
+            break;
+
+         if ((size = command_binary_get32(client->in + pos + 4))
+               > COMMAND_BINARY_MAX_PAYLOAD)
+         {
+            command_stream_close(stream, client);
+            break;
+         }
+
+         if (client->in_len - pos < COMMAND_BINARY_HEADER_SIZE + size)
+            break;
+
+         command_binary_dispatch(client, client->in + pos);
+         pos += COMMAND_BINARY_HEADER_SIZE + size;
+      }
+   }
+
+   stream->current = NULL;
+
+   if (client->fd < 0)
+      return;
+
+   memmove(client->in, client->in + pos, client->in_len - pos);
+   client->in_len -= pos;
+
+   if (client->out_len > COMMAND_STREAM_MAX_PENDING)
+      command_stream_close(stream, client);
+}
+
+static void command_stream_read(command_t *handle,
+      command_stream_t *stream, command_stream_client_t *client)
+{
+   while (client->fd >= 0)
+   {
+      ssize_t ret;
+      bool error = false;
+
+      /* Keep one byte free to terminate text commands */
+      if (!command_stream_reserve(&client->in, &client->in_cap,
+               client->in_len + 4096 + 1))
+      {
+         command_stream_close(stream, client);
+         return;
+      }
+
+      ret = socket_receive_all_nonblocking(client->fd, &error,
+            client->in + client->in_len,
+            client->in_cap - client->in_len - 1);
+
+      if (error)
+      {
+         /* A command split across reads is only complete
+          * without its newline once the peer is done */
+         command_stream_parse(handle, stream, client, true);
+         if (client->fd >= 0)
+            command_stream_close(stream, client);
+         return;
+      }
+
+      if (ret <= 0)
+         break;
+
+      client->in_len += ret;
+      command_stream_parse(handle, stream, client, false);
+   }
+}
+
+static void command_stream_accept(command_stream_t *stream)
+{
+   unsigned i;
+   int fd = accept(stream->fd, NULL, NULL);
+
+   if (fd < 0)
+      return;
+
+   for (i = 0; i < COMMAND_STREAM_MAX_CLIENTS; i++)
+      if (stream->clients[i].fd < 0)
+         break;
+
+   if (i == COMMAND_STREAM_MAX_CLIENTS || !socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return;
+   }
+
+#ifdef TCP_NODELAY
+   if (stream->tcp)
+   {
+      int on = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+            (const char*)&on, sizeof(on));
+   }
+#endif
+
+#ifdef HAVE_COMMAND_EPOLL
+   {
+      struct epoll_event event;
+      event.events   = EPOLLIN;
+      event.data.u32 = i;
+      if (epoll_ctl(stream->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+      {
+         socket_close(fd);
+         return;
+      }
+   }
+#endif
+
+   stream->clients[i].fd = fd;
+}
+
+static void command_stream_poll(command_t *handle, command_stream_t *stream)
+{
+   unsigned i;
+#ifdef HAVE_COMMAND_EPOLL
+   int ret;
+   struct epoll_event events[COMMAND_STREAM_MAX_CLIENTS + 1];
+#else
+   fd_set fds;
+   struct timeval tmp_tv = {0};
+   int maxfd             = stream->fd;
+#endif
+
+   if (stream->fd < 0)
+      return;
+
+#ifdef HAVE_COMMAND_EPOLL
+   ret = epoll_wait(stream->epoll_fd, events, ARRAY_SIZE(events), 0);
+
+   for (i = 0; ret > 0 && i < (unsigned)ret; i++)
+   {
+      uint32_t slot = events[i].data.u32;
+
+      if (slot == COMMAND_STREAM_MAX_CLIENTS)
+         command_stream_accept(stream);
+      else
+         command_stream_read(handle, stream, &stream->clients[slot]);
+   }
+#else
+   FD_ZERO(&fds);
+   FD_SET(stream->fd, &fds);
+
+   for (i = 0; i < COMMAND_STREAM_MAX_CLIENTS; i++)
+   {
+      if (stream->clients[i].fd >= 0)
+      {
+         maxfd = MAX(stream->clients[i].fd, maxfd);
+         FD_SET(stream->clients[i].fd, &fds);
+      }
+   }
+
+   if (socket_select(maxfd + 1, &fds, NULL, NULL, &tmp_tv) > 0)
+   {
+      for (i = 0; i < COMMAND_STREAM_MAX_CLIENTS; i++)
+         if (     stream->clients[i].fd >= 0
+               && FD_ISSET(stream->clients[i].fd, &fds))
+            command_stream_read(handle, stream, &stream->clients[i]);
+
+      if (FD_ISSET(stream->fd, &fds))
+         command_stream_accept(stream);
+   }
+#endif
+
+   /* Once per frame: push watched memory and send what
+    * did not fit in the socket buffers before */
+   for (i = 0; i < COMMAND_STREAM_MAX_CLIENTS; i++)
+   {
+      command_stream_client_t *client = &stream->clients[i];
+
+      if (client->fd < 0)
+         continue;
+      if (client->num_watches)
+         command_binary_push_changes(client);
+      if (client->out_len)
+         command_stream_flush(stream, client);
+   }
+}
+
+static void command_stream_reply(command_stream_t *stream,
+      const char *data, size_t len)
+{
+   if (stream->current)
+      command_stream_write(stream->current, data, len);
+}
+
+/* Takes over the listening socket @fd, or sets up an
+ * inactive stream if it is negative */
+static bool command_stream_init(command_stream_t *stream, int fd, bool tcp)
+{
+   unsigned i;
+
+   memset(stream, 0, sizeof(*stream));
+   for (i = 0; i < COMMAND_STREAM_MAX_CLIENTS; i++)
+      stream->clients[i].fd = -1;
+   stream->fd  = fd;
+   stream->tcp = tcp;
+
+#ifdef HAVE_COMMAND_EPOLL
+   stream->epoll_fd = -1;
+
+   if (fd >= 0)
+   {
+      struct epoll_event event;
+
+      event.events   = EPOLLIN;
+      event.data.u32 = COMMAND_STREAM_MAX_CLIENTS;
+
+      if (     (stream->epoll_fd = epoll_create(COMMAND_STREAM_MAX_CLIENTS + 1)) < 0
+            || epoll_ctl(stream->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+      {
+         if (stream->epoll_fd >= 0)
+            close(stream->epoll_fd);
+         socket_close(fd);
+         stream->epoll_fd = -1;
+         stream->fd       = -1;
+         return false;
+      }
+   }
+#endif
+
+   return fd >= 0;
+}
+
+static void command_stream_deinit(command_stream_t *stream)
+{
+   unsigned i;
+
+   for (i = 0; i < COMMAND_STREAM_MAX_CLIENTS; i++)
+      command_stream_close(stream, &stream->clients[i]);
+
+   if (stream->fd >= 0)
+      socket_close(stream->fd);
+#ifdef HAVE_COMMAND_EPOLL
+   if (stream->epoll_fd >= 0)
+      close(stream->epoll_fd);
+#endif
+
+   stream->fd = -1;
+}
+#endif
+
 #if defined(HAVE_NETWORK_CMD)
 typedef struct
 {
@@ -153,6 +958,8 @@ typedef struct
    struct sockaddr_storage cmd_source;
    /* Size of the previous structure in use */
    socklen_t cmd_source_len;
+   /* Connections to the TCP port of the same number */
+   command_stream_t stream;
 } command_network_t;
 
 static void network_command_reply(
@@ -160,6 +967,13 @@ static void network_command_reply(
       const char * data, size_t len)
 {
    command_network_t *netcmd = (command_network_t*)cmd->userptr;
+
+   if (netcmd->stream.current)
+   {
+      command_stream_reply(&netcmd->stream, data, len);
+      return;
+   }
+
    /* Respond (fire and forget since it's UDP) */
    sendto(netcmd->net_fd, data, len, 0,
       (struct sockaddr*)&netcmd->cmd_source, netcmd->cmd_source_len);
@@ -171,12 +985,13 @@ static void network_command_free(command_t *handle)
 
    if (netcmd->net_fd >= 0)
       socket_close(netcmd->net_fd);
+   command_stream_deinit(&netcmd->stream);
 
    free(netcmd);
    free(handle);
 }
 
-static void command_network_poll(command_t *handle)
+static void command_network_poll_datagrams(command_t *handle)
 {
    fd_set fds;
    struct timeval       tmp_tv = {0};
@@ -214,8 +1029,18 @@ static void command_network_poll(command_t *handle)
    }
 }
 
-command_t* command_network_new(uint16_t port)
+static void command_network_poll(command_t *handle)
+{
+   command_network_t *netcmd = (command_network_t*)handle->userptr;
+
+   command_network_poll_datagrams(handle);
+   command_stream_poll(handle, &netcmd->stream);
+}
+
+command_t* command_network_new(uint16_t port, bool stream)
 {
+   int tcp_fd;
+   struct addrinfo *tcp_res  = NULL;
    struct addrinfo     *res  = NULL;
    command_t            *cmd = (command_t*)calloc(1, sizeof(command_t));
    command_network_t *netcmd = (command_network_t*)calloc(
@@ -227,6 +1052,8 @@ command_t* command_network_new(uint16_t port)
          msg_hash_to_str(MSG_BRINGING_UP_COMMAND_INTERFACE_ON_PORT),
          (unsigned short)port);
 
+   command_stream_init(&netcmd->stream, -1, true);
+
    if (fd < 0)
       goto error;
 
@@ -247,6 +1074,30 @@ command_t* command_network_new(uint16_t port)
    }
 
    freeaddrinfo_retro(res);
+
+   if (!stream)
+      return cmd;
+
+   /* Stream connections, for clients that need replies
+    * to arrive in order or want binary framing */
+   tcp_fd = socket_init((void**)&tcp_res, port, NULL, SOCKET_TYPE_STREAM);
+
+   if (     tcp_fd >= 0
+         && socket_nonblock(tcp_fd)
+         && socket_bind(tcp_fd, (void*)tcp_res)
+         && listen(tcp_fd, COMMAND_STREAM_MAX_CLIENTS) == 0)
+      command_stream_init(&netcmd->stream, tcp_fd, true);
+   else
+   {
+      if (tcp_fd >= 0)
+         socket_close(tcp_fd);
+      RARCH_WARN("[NetCMD]: Could not listen for stream connections on TCP port %hu.\n",
+            (unsigned short)port);
+   }
+
+   if (tcp_res)
+      freeaddrinfo_retro(tcp_res);
+
    return cmd;
 
 error:
@@ -385,34 +1236,16 @@ bool command_get_config_param(command_t *cmd, const char* arg)
 
 #if defined(HAVE_LAKKA)
 #include <sys/un.h>
-#define MAX_USER_CONNECTIONS  4
-typedef struct
-{
-   /* File descriptor for the domain socket */
-   int sfd;
-   /* Client sockets */
-   int userfd[MAX_USER_CONNECTIONS];
-   /* Last received user socket */
-   int last_fd;
-} command_uds_t;
-
 static void uds_command_reply(
       command_t *cmd,
       const char * data, size_t len)
 {
-   command_uds_t *subcmd = (command_uds_t*)cmd->userptr;
-   write(subcmd->last_fd, data, len);
+   command_stream_reply((command_stream_t*)cmd->userptr, data, len);
 }
 
 static void uds_command_free(command_t *handle)
 {
-   int i;
-   command_uds_t *udscmd = (command_uds_t*)handle->userptr;
-
-   for (i = 0; i < MAX_USER_CONNECTIONS; i++)
-      if (udscmd->userfd[i] >= 0)
-         socket_close(udscmd->userfd[i]);
-   socket_close(udscmd->sfd);
+   command_stream_deinit((command_stream_t*)handle->userptr);
 
    free(handle->userptr);
    free(handle);
@@ -420,80 +1253,13 @@ static void uds_command_free(command_t *handle)
 
 static void command_uds_poll(command_t *handle)
 {
-   int i;
-   fd_set fds;
-   command_uds_t *udscmd       = (command_uds_t*)handle->userptr;
-   int maxfd                   = udscmd->sfd;
-   struct timeval       tmp_tv = {0};
-
-   if (udscmd->sfd < 0)
-      return;
-
-   FD_ZERO(&fds);
-   FD_SET(udscmd->sfd, &fds);
-
-   for (i = 0; i < MAX_USER_CONNECTIONS; i++)
-   {
-      if (udscmd->userfd[i] >= 0)
-      {
-         maxfd = MAX(udscmd->userfd[i], maxfd);
-         FD_SET(udscmd->userfd[i], &fds);
-      }
-   }
-
-   if (socket_select(maxfd + 1, &fds, NULL, NULL, &tmp_tv) <= 0)
-      return;
-
-   /* Read data from clients and process commands */
-   for (i = 0; i < MAX_USER_CONNECTIONS; i++)
-   {
-      if (udscmd->userfd[i] >= 0 && FD_ISSET(udscmd->userfd[i], &fds))
-      {
-         while (1)
-         {
-            char buf[2048];
-            ssize_t ret = recv(udscmd->userfd[i], buf, sizeof(buf) - 1, 0);
-
-            if (ret < 0)
-               break;   /* no more data */
-            if (!ret)
-            {
-               socket_close(udscmd->userfd[i]);
-               udscmd->userfd[i] = -1;
-               break;
-            }
-
-            buf[ret] = 0;
-            udscmd->last_fd = udscmd->userfd[i];
-            command_parse_msg(handle, buf);
-         }
-      }
-   }
-
-   if (FD_ISSET(udscmd->sfd, &fds))
-   {
-      /* Accepts new connections from clients */
-      int cfd = accept(udscmd->sfd, NULL, NULL);
-      if (cfd >= 0) {
-         if (!socket_nonblock(cfd))
-            socket_close(cfd);
-         else {
-            for (i = 0; i < MAX_USER_CONNECTIONS; i++)
-               if (udscmd->userfd[i] < 0)
-               {
-                  udscmd->userfd[i] = cfd;
-                  break;
-               }
-         }
-      }
-   }
+   command_stream_poll(handle, (command_stream_t*)handle->userptr);
 }
 
 command_t* command_uds_new(void)
 {
-   int i;
    command_t *cmd;
-   command_uds_t *subcmd;
+   command_stream_t *stream;
    struct sockaddr_un addr;
    const char   *sp = "retroarch/cmd";
    socklen_t addrsz = offsetof(struct sockaddr_un, sun_path) + strlen(sp) + 1;
@@ -507,7 +1273,7 @@ command_t* command_uds_new(void)
    strcpy(&addr.sun_path[1], sp);
 
    if (bind(fd, (struct sockaddr*)&addr, addrsz) < 0 ||
-       listen(fd, MAX_USER_CONNECTIONS) < 0)
+       listen(fd, COMMAND_STREAM_MAX_CLIENTS) < 0)
    {
       socket_close(fd);
       return NULL;
@@ -520,13 +1286,16 @@ command_t* command_uds_new(void)
    }
 
    cmd             = (command_t*)calloc(1, sizeof(command_t));
-   subcmd          = (command_uds_t*)calloc(1, sizeof(command_uds_t));
-   subcmd->sfd     = fd;
-   subcmd->last_fd = -1;
-   for (i = 0; i < MAX_USER_CONNECTIONS; i++)
-      subcmd->userfd[i] = -1;
+   stream          = (command_stream_t*)calloc(1, sizeof(command_stream_t));
 
-   cmd->userptr = subcmd;
+   if (!command_stream_init(stream, fd, false))
+   {
+      free(stream);
+      free(cmd);
+      return NULL;
+   }
+
+   cmd->userptr = stream;
    cmd->poll    = command_uds_poll;
    cmd->replier = uds_command_reply;
    cmd->destroy = uds_command_free;
@@ -683,34 +1452,6 @@ bool command_version(command_t *cmd, const char* arg)
    return true;
 }
 
-static const rarch_memory_descriptor_t* command_memory_get_descriptor(const rarch_memory_map_t* mmap, unsigned address)
-{
-   const rarch_memory_descriptor_t* desc = mmap->descriptors;
-   const rarch_memory_descriptor_t* end  = desc + mmap->num_descriptors;
-
-   for (; desc < end; desc++)
-   {
-      if (desc->core.select == 0)
-      {
-         /* if select is 0, attempt to explicitly match the address */
-         if (address >= desc->core.start && address < desc->core.start + desc->core.len)
-            return desc;
-      }
-      else
-      {
-         /* otherwise, attempt to match the address by matching the select bits */
-         if (((desc->core.start ^ address) & desc->core.select) == 0)
-         {
-            /* sanity check - make sure the descriptor is large enough to hold the target address */
-            if (address - desc->core.start < desc->core.len)
-               return desc;
-         }
-      }
-   }
-
-   return NULL;
-}
-
 uint8_t *command_memory_get_pointer(
       const rarch_system_info_t* system,
       unsigned address,
@@ -723,18 +1464,18 @@ uint8_t *command_memory_get_pointer(
       strlcpy(reply_at, " -1 no memory map defined\n", len);
    else
    {
-      const rarch_memory_descriptor_t* desc = command_memory_get_descriptor(&system->mmaps, address);
-      if (!desc)
+      memory_map_region_t region;
+      if (!command_memory_find_region(system, address, &region))
          strlcpy(reply_at, " -1 no descriptor for address\n", len);
-      else if (!desc->core.ptr)
+      else if (!region.data)
          strlcpy(reply_at, " -1 no data for descriptor\n", len);
-      else if (for_write && (desc->core.flags & RETRO_MEMDESC_CONST))
+      else if (for_write && (region.flags & MEMORY_MAP_READONLY))
          strlcpy(reply_at, " -1 descriptor data is readonly\n", len);
       else
       {
-         const size_t offset = address - desc->core.start;
-         *max_bytes = (desc->core.len - offset);
-         return (uint8_t*)desc->core.ptr + desc->core.offset + offset;
+         const uint32_t offset = address - region.start;
+         *max_bytes = region.size - offset;
+         return region.data + offset;
       }
    }
 
@@ -779,6 +1520,109 @@ bool command_get_status(command_t *cmd, const char* arg)
    return true;
 }
 
+/* Replies with sliding window frame timing percentiles:
+ * GET_FRAME_STATS frames=<n> window=<n> stutters=<n> stutters_total=<n> <stage>=<p50>,<p95>,<p99>,<max> ...
+ * (all times in usec) */
+bool command_get_frame_stats(command_t *cmd, const char* arg)
+{
+   unsigned i;
+   frame_telemetry_stats_t stats;
+   /* Header, then at most 64 characters per stage */
+   char reply[128 + FRAME_TELEMETRY_STAGE_LAST * 64];
+   size_t _len;
+
+   if (!frame_telemetry_get_stats(&stats))
+   {
+      strcpy_literal(reply, "GET_FRAME_STATS -1 no data\n");
+      cmd->replier(cmd, reply, strlen(reply));
+      return true;
+   }
+
+   /* Leave room for the trailing newline */
+   _len = snprintf(reply, sizeof(reply) - 1,
+         "GET_FRAME_STATS frames=%u window=%u stutters=%u stutters_total=%u",
+         (unsigned)stats.frames, stats.samples,
+         stats.stutters, (unsigned)stats.stutters_total);
+
+   for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST && _len < sizeof(reply) - 1; i++)
+   {
+      const frame_telemetry_percentiles_t *pc = &stats.stage[i];
+      _len += snprintf(reply + _len, sizeof(reply) - 1 - _len,
+            " %s=%u,%u,%u,%u",
+            frame_telemetry_stage_name((enum frame_telemetry_stage)i),
+            (unsigned)pc->p50, (unsigned)pc->p95,
+            (unsigned)pc->p99, (unsigned)pc->max);
+   }
+
+   if (_len > sizeof(reply) - 2)
+      _len = sizeof(reply) - 2;
+   reply[_len++] = '\n';
+   reply[_len]   = '\0';
+   cmd->replier(cmd, reply, _len);
+
+   return true;
+}
+
+/* Exports the frame timing window as CSV. Since this
+ * is reachable over the network, the file name is
+ * fixed: frame_stats.csv in the log directory, or
+ * next to the config file if no log directory is set.
+ * Any argument is ignored.
+ * Replies EXPORT_FRAME_STATS 0 <path> on success */
+bool command_export_frame_stats(command_t *cmd, const char* arg)
+{
+   char dir[PATH_MAX_LENGTH];
+   char path[PATH_MAX_LENGTH];
+   char reply[PATH_MAX_LENGTH + 32];
+   settings_t *settings = config_get_ptr();
+   const char *config   = path_get(RARCH_PATH_CONFIG);
+
+   dir[0]  = '\0';
+   path[0] = '\0';
+
+   if (!string_is_empty(settings->paths.log_dir))
+      strlcpy(dir, settings->paths.log_dir, sizeof(dir));
+   else if (!string_is_empty(config))
+      fill_pathname_basedir(dir, config, sizeof(dir));
+
+   if (!string_is_empty(dir))
+   {
+      if (!path_is_directory(dir))
+         path_mkdir(dir);
+      fill_pathname_join(path, dir, "frame_stats.csv", sizeof(path));
+   }
+
+   if (!string_is_empty(path) && frame_telemetry_export_csv(path))
+      snprintf(reply, sizeof(reply), "EXPORT_FRAME_STATS 0 %s\n", path);
+   else
+      strcpy_literal(reply, "EXPORT_FRAME_STATS -1\n");
+
+   cmd->replier(cmd, reply, strlen(reply));
+
+   return true;
+}
+
+#ifdef HAVE_BSV_MOVIE
+/* Seeks the BSV2 movie being played back to <frame> */
+bool command_bsv_seek(command_t *cmd, const char* arg)
+{
+   char reply[64];
+   unsigned frame = 0;
+
+   if (!arg || sscanf(arg, "%u", &frame) != 1)
+      return false;
+
+   if (bsv_movie_seek(input_state_get_ptr(), frame))
+      snprintf(reply, sizeof(reply), "BSV_SEEK %u\n", frame);
+   else
+      snprintf(reply, sizeof(reply), "BSV_SEEK -1 %u\n", frame);
+
+   cmd->replier(cmd, reply, strlen(reply));
+
+   return true;
+}
+#endif
+
 bool command_read_memory(command_t *cmd, const char *arg)
 {
    unsigned i;
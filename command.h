@@ -286,7 +286,7 @@ struct rarch_state;
 bool command_event(enum event_command action, void *data);
 
 /* Constructors for the supported drivers */
-command_t* command_network_new(uint16_t port);
+command_t* command_network_new(uint16_t port, bool stream);
 command_t* command_stdin_new(void);
 command_t* command_uds_new(void);
 
@@ -308,18 +308,46 @@ struct bsv_state
 
 };
 
+struct bsv_movie_block
+{
+   uint64_t offset;
+   uint32_t first_frame;
+};
+
 struct bsv_movie
 {
    intfstream_t *file;
    uint8_t *state;
    /* A ring buffer keeping track of positions
-    * in the file for each frame. */
+    * in the file for each frame (BSV1 only). */
    size_t *frame_pos;
    size_t frame_mask;
    size_t frame_ptr;
    size_t min_file_pos;
    size_t state_size;
 
+   /* BSV2 only */
+   struct bsv_movie_block *blocks; /* Seek index */
+   uint8_t *input;           /* Input records of the current block */
+   uint8_t *zbuf;
+   uint32_t *frame_offsets;  /* Offset of each record in 'input' */
+   size_t blocks_count;
+   size_t blocks_cap;
+   size_t block;             /* Current block */
+   size_t input_size;
+   size_t input_cap;
+   size_t input_ptr;         /* Playback read position in 'input' */
+   size_t zbuf_size;
+   uint32_t version;
+   uint32_t interval;        /* Frames between keyframes */
+   uint32_t frame;           /* Next frame to play or record */
+   uint32_t frame_count;     /* Playback only */
+   uint32_t block_frames;    /* Frames held by the current block */
+   /* Values left to read from (playback) or
+    * written to (recording) the current frame */
+   uint32_t frame_values;
+   bool block_loaded;
+
    bool playback;
    bool first_rewind;
    bool did_rewind;
@@ -403,8 +431,13 @@ struct cmd_action_map
 
 bool command_version(command_t *cmd, const char* arg);
 bool command_get_status(command_t *cmd, const char* arg);
+bool command_get_frame_stats(command_t *cmd, const char* arg);
+bool command_export_frame_stats(command_t *cmd, const char* arg);
 bool command_get_config_param(command_t *cmd, const char* arg);
 bool command_show_osd_msg(command_t *cmd, const char* arg);
+#ifdef HAVE_BSV_MOVIE
+bool command_bsv_seek(command_t *cmd, const char* arg);
+#endif
 #ifdef HAVE_CHEEVOS
 bool command_read_ram(command_t *cmd, const char *arg);
 bool command_write_ram(command_t *cmd, const char *arg);
@@ -425,8 +458,13 @@ static const struct cmd_action_map action_map[] = {
 #endif
    { "VERSION",          command_version,          "No argument"},
    { "GET_STATUS",       command_get_status,       "No argument" },
+   { "GET_FRAME_STATS",  command_get_frame_stats,  "No argument" },
+   { "EXPORT_FRAME_STATS", command_export_frame_stats, "No argument" },
    { "GET_CONFIG_PARAM", command_get_config_param, "<param name>" },
    { "SHOW_MSG",         command_show_osd_msg,     "No argument" },
+#ifdef HAVE_BSV_MOVIE
+   { "BSV_SEEK",         command_bsv_seek,         "<frame>" },
+#endif
 #if defined(HAVE_CHEEVOS)
    /* These functions use achievement addresses and only work if a game with achievements is
     * loaded. READ_CORE_MEMORY and WRITE_CORE_MEMORY are preferred and use system addresses. */
@@ -0,0 +1,96 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __COMMAND_PROTOCOL_H
+#define __COMMAND_PROTOCOL_H
+
+/* Binary framing of the stream command sockets.
+ *
+ * Connections to the TCP command port (same number as the
+ * UDP one, only opened with network_cmd_stream_enable) and
+ * to the Unix domain command socket start out
+ * taking the usual text commands. Sending the line
+ * COMMAND_BINARY_MODE switches the connection to binary
+ * frames, after the text reply "BINARY_MODE 1".
+ *
+ * Every frame, in both directions, is a header followed
+ * by 'size' bytes of payload. All integers are little
+ * endian.
+ *
+ *   uint8_t  op      COMMAND_BINARY_OP_*
+ *   uint8_t  status  COMMAND_BINARY_STATUS_*, 0 in requests
+ *   uint16_t count   number of entries in the payload
+ *   uint32_t size    payload size in bytes
+ *
+ * Each request gets one reply frame with the same op, in
+ * order. Addresses are in the core's address space, as
+ * for READ_CORE_MEMORY.
+ *
+ * READ    request entries:  uint32_t address, uint32_t size
+ *         reply entries:    uint32_t size, then that many
+ *                           bytes, clipped to the end of
+ *                           the descriptor; size is
+ *                           COMMAND_BINARY_UNMAPPED and no
+ *                           bytes follow if the address
+ *                           can not be read.
+ *
+ * WRITE   request entries:  uint32_t address, uint32_t size,
+ *                           then that many bytes
+ *         reply entries:    uint32_t bytes written, or
+ *                           COMMAND_BINARY_UNMAPPED
+ *
+ * WATCH   request entries:  uint32_t address, uint32_t size
+ *         Replaces the watch list of the connection (no
+ *         entries clears it). Reply has no entries.
+ *
+ * CHANGED Sent by RetroArch, at most once per frame, when
+ *         watched memory changed since the previous frame,
+ *         and on the first frame after WATCH.
+ *         entries:          uint32_t watch index,
+ *                           uint32_t offset, uint32_t size,
+ *                           then that many bytes: the span
+ *                           from the first to the last
+ *                           changed byte of the watch. */
+
+#define COMMAND_BINARY_MODE            "BINARY_MODE"
+
+#define COMMAND_BINARY_HEADER_SIZE     8
+#define COMMAND_BINARY_UNMAPPED        0xFFFFFFFF
+
+/* Largest payload in either direction */
+#define COMMAND_BINARY_MAX_PAYLOAD     (1 << 20)
+#define COMMAND_BINARY_MAX_WATCHES     256
+
+enum command_binary_op
+{
+   COMMAND_BINARY_OP_READ    = 0x01,
+   COMMAND_BINARY_OP_WRITE   = 0x02,
+   COMMAND_BINARY_OP_WATCH   = 0x03,
+   COMMAND_BINARY_OP_CHANGED = 0x10
+};
+
+enum command_binary_status
+{
+   COMMAND_BINARY_STATUS_OK = 0,
+   /* Malformed payload */
+   COMMAND_BINARY_STATUS_BAD_REQUEST,
+   COMMAND_BINARY_STATUS_UNKNOWN_OP,
+   /* The core has not set a memory map */
+   COMMAND_BINARY_STATUS_NO_MEMORY_MAP,
+   /* Reply or watch list over the limits above */
+   COMMAND_BINARY_STATUS_TOO_LARGE
+};
+
+#endif
@@ -1267,6 +1267,9 @@ static const bool savestate_thumbnail_enable = false;
 /* Enable stdin/network command interface. */
 static const bool network_cmd_enable = false;
 static const uint16_t network_cmd_port = 55355;
+/* Also listen for stream connections on the TCP port
+ * with the same number as the network command port */
+static const bool network_cmd_stream_enable = false;
 static const bool stdin_cmd_enable = false;
 
 static const uint16_t network_remote_base_port = 55400;
@@ -1407,6 +1410,11 @@ static const bool input_autodetect_enable = true;
 #define DEFAULT_INPUT_SENSORS_ENABLE true
 #endif
 
+/* Read keyboard and mouse events on a thread of their
+ * own as they arrive, instead of once per frame.
+ * Only the udev and linuxraw input drivers support it. */
+#define DEFAULT_INPUT_THREADED false
+
 /* Automatically enable game focus when running or
  * resuming content */
 #define DEFAULT_INPUT_AUTO_GAME_FOCUS AUTO_GAME_FOCUS_OFF
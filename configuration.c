@@ -1920,6 +1920,7 @@ static struct config_bool_setting *populate_settings_bool(
 #endif
 #ifdef HAVE_COMMAND
    SETTING_BOOL("network_cmd_enable",           &settings->bools.network_cmd_enable, true, network_cmd_enable, false);
+   SETTING_BOOL("network_cmd_stream_enable",    &settings->bools.network_cmd_stream_enable, true, network_cmd_stream_enable, false);
    SETTING_BOOL("stdin_cmd_enable",             &settings->bools.stdin_cmd_enable, true, stdin_cmd_enable, false);
 #endif
 #ifdef HAVE_NETWORKGAMEPAD
@@ -1957,6 +1958,7 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("input_nowinkey_enable",        &settings->bools.input_nowinkey_enable, true, false, false);
 #endif
    SETTING_BOOL("input_sensors_enable",         &settings->bools.input_sensors_enable, true, DEFAULT_INPUT_SENSORS_ENABLE, false);
+   SETTING_BOOL("input_threaded",               &settings->bools.input_threaded, true, DEFAULT_INPUT_THREADED, false);
    SETTING_BOOL("audio_rate_control",           &settings->bools.audio_rate_control, true, DEFAULT_RATE_CONTROL, false);
 #ifdef HAVE_WASAPI
    SETTING_BOOL("audio_wasapi_exclusive_mode",  &settings->bools.audio_wasapi_exclusive_mode, true, DEFAULT_WASAPI_EXCLUSIVE_MODE, false);
@@ -590,6 +590,7 @@ typedef struct settings
       bool input_remap_binds_enable;
       bool input_autodetect_enable;
       bool input_sensors_enable;
+      bool input_threaded;
       bool input_overlay_enable;
       bool input_overlay_enable_autopreferred;
       bool input_overlay_behind_menu;
@@ -848,6 +849,7 @@ typedef struct settings
       bool save_file_compression;
       bool savestate_file_compression;
       bool network_cmd_enable;
+      bool network_cmd_stream_enable;
       bool stdin_cmd_enable;
       bool keymapper_enable;
       bool network_remote_enable;
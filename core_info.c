@@ -44,6 +44,14 @@
 #include "play_feature_delivery/play_feature_delivery.h"
 #endif
 
+#if defined(HAVE_CORE_INFO_CACHE) && defined(HAVE_MMAP) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#define CORE_INFO_CACHE_BIN_MMAP
+#endif
+
 /*************************/
 /* Core Info Cache START */
 /*************************/
@@ -63,6 +71,42 @@ typedef struct
    bool refresh;
 } core_info_cache_list_t;
 
+/* Binary info cache
+ * > Holds native core_info_t images followed by
+ *   the string lists, firmware entries and strings
+ *   they reference. Pointers are stored as offsets
+ *   from the start of the payload (0 == NULL) and
+ *   are fixed up in place after loading, so the
+ *   cache can be used directly as the core info
+ *   list without any per-field allocations
+ * > Struct sizes are recorded in the header; a
+ *   cache written by a different build/platform
+ *   is rejected and the JSON cache is used instead */
+#define CORE_INFO_CACHE_BIN_MAGIC   "RCIB"
+#define CORE_INFO_CACHE_BIN_VERSION 1
+#define CORE_INFO_CACHE_BIN_ENDIAN  0x01020304
+#define CORE_INFO_CACHE_BIN_ALIGN   8
+
+typedef struct
+{
+   char magic[4];
+   uint32_t version;
+   uint32_t endian;
+   uint32_t core_info_size;
+   uint32_t string_list_size;
+   uint32_t string_list_elem_size;
+   uint32_t firmware_size;
+   uint32_t count;
+   uint64_t payload_size;
+} core_info_cache_bin_header_t;
+
+typedef struct
+{
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+} core_info_cache_bin_buf_t;
+
 typedef struct
 {
    core_info_t *core_info;
@@ -82,6 +126,8 @@ static void core_info_free(core_info_t* info);
 static uint32_t core_info_hash_string(const char *str);
 #ifdef HAVE_CORE_INFO_CACHE
 static core_info_cache_list_t *core_info_cache_list_new(void);
+static void core_info_cache_bin_release(void *data, size_t size,
+      bool mapped);
 #endif
 static void core_info_cache_add(core_info_cache_list_t *list,
       core_info_t *info, bool transfer);
@@ -90,6 +136,7 @@ static core_info_state_t core_info_st = {
 #ifdef HAVE_COMPRESSION
    NULL,
 #endif
+   NULL,
    NULL,
    NULL,
    NULL
@@ -1749,6 +1796,318 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
+/* Extension/database dispatch tables
+ * > Every distinct supported extension is assigned
+ *   a bit index; each core carries a bitset of the
+ *   extensions it supports
+ * > Each database referenced by a core maps to the
+ *   union of the extension bitsets of all cores
+ *   that list it
+ * > Both tables are open-addressed hash maps with
+ *   case-insensitive keys, so content association
+ *   queries take constant time */
+
+typedef struct
+{
+   const char *ext;
+   uint32_t hash;
+   uint32_t bit;
+} core_info_ext_slot_t;
+
+typedef struct
+{
+   const char *name;
+   uint32_t *ext_mask;
+   uint32_t hash;
+   bool match_archive_member;
+} core_info_db_slot_t;
+
+struct core_info_ext_index
+{
+   core_info_ext_slot_t *ext_slots;
+   core_info_db_slot_t *db_slots;
+   uint32_t *masks;
+   /* Scratch mask of the extensions of the
+    * content currently being matched */
+   uint32_t *query_mask;
+   size_t ext_slot_mask;
+   size_t db_slot_mask;
+   size_t num_exts;
+   size_t mask_words;
+   /* True if any core lists an extension with
+    * a leading '.' (matched by the legacy
+    * string_list_find_elem_prefix() lookup) */
+   bool has_dot_prefix;
+};
+
+static uint32_t core_info_hash_string_noncase(const char *str)
+{
+   unsigned char c;
+   uint32_t hash = (uint32_t)0x811c9dc5;
+   while ((c = (unsigned char)*(str++)) != '\0')
+      hash = ((hash * (uint32_t)0x01000193) ^ (uint32_t)TOLOWER(c));
+   return (hash ? hash : 1);
+}
+
+static size_t core_info_ext_index_capacity(size_t count)
+{
+   size_t capacity = 16;
+   while (capacity < (count << 1))
+      capacity <<= 1;
+   return capacity;
+}
+
+static core_info_ext_slot_t *core_info_ext_index_find_ext(
+      const core_info_ext_index_t *index, const char *ext, uint32_t hash)
+{
+   size_t i = hash & index->ext_slot_mask;
+
+   for (;; i = (i + 1) & index->ext_slot_mask)
+   {
+      core_info_ext_slot_t *slot = &index->ext_slots[i];
+      if (!slot->ext)
+         return slot;
+      if (   (slot->hash == hash)
+          && string_is_equal_noncase(slot->ext, ext))
+         return slot;
+   }
+}
+
+static core_info_db_slot_t *core_info_ext_index_find_db(
+      const core_info_ext_index_t *index, const char *name, uint32_t hash)
+{
+   size_t i = hash & index->db_slot_mask;
+
+   for (;; i = (i + 1) & index->db_slot_mask)
+   {
+      core_info_db_slot_t *slot = &index->db_slots[i];
+      if (!slot->name)
+         return slot;
+      if (   (slot->hash == hash)
+          && string_is_equal_noncase(slot->name, name))
+         return slot;
+   }
+}
+
+/* Returns bit index of specified extension,
+ * or -1 if no core supports it */
+static int core_info_ext_index_get_bit(
+      const core_info_ext_index_t *index, const char *ext)
+{
+   const core_info_ext_slot_t *slot = NULL;
+
+   if (!index || string_is_empty(ext))
+      return -1;
+
+   slot = core_info_ext_index_find_ext(index, ext,
+         core_info_hash_string_noncase(ext));
+
+   if (!slot->ext && index->has_dot_prefix)
+   {
+      char prefixed[256];
+      prefixed[0] = '.';
+      strlcpy(prefixed + 1, ext, sizeof(prefixed) - 1);
+      slot = core_info_ext_index_find_ext(index, prefixed,
+            core_info_hash_string_noncase(prefixed));
+   }
+
+   return slot->ext ? (int)slot->bit : -1;
+}
+
+static INLINE bool core_info_ext_mask_test(const uint32_t *mask, int bit)
+{
+   return mask && (bit >= 0) && (mask[bit >> 5] & (1u << (bit & 31)));
+}
+
+static void core_info_ext_index_free(core_info_ext_index_t *index)
+{
+   if (!index)
+      return;
+
+   free(index->ext_slots);
+   free(index->db_slots);
+   free(index->masks);
+   free(index);
+}
+
+/* Builds extension and database dispatch tables
+ * for all cores in the list. Must be called once
+ * the list is fully populated; table keys point
+ * into the string lists of the list entries */
+static void core_info_list_resolve_ext_index(
+      core_info_list_t *core_info_list)
+{
+   size_t i, j, k;
+   size_t num_ext_elems        = 0;
+   size_t num_db_elems         = 0;
+   size_t num_dbs              = 0;
+   uint32_t *db_masks          = NULL;
+   core_info_ext_index_t *index = (core_info_ext_index_t*)
+         calloc(1, sizeof(*index));
+
+   if (!index)
+      return;
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const core_info_t *info = &core_info_list->list[i];
+      if (info->supported_extensions_list)
+         num_ext_elems += info->supported_extensions_list->size;
+      if (info->databases_list)
+         num_db_elems  += info->databases_list->size;
+   }
+
+   index->ext_slot_mask = core_info_ext_index_capacity(num_ext_elems) - 1;
+   index->db_slot_mask  = core_info_ext_index_capacity(num_db_elems) - 1;
+
+   if (   !(index->ext_slots = (core_info_ext_slot_t*)calloc(
+            index->ext_slot_mask + 1, sizeof(core_info_ext_slot_t)))
+       || !(index->db_slots  = (core_info_db_slot_t*)calloc(
+            index->db_slot_mask + 1, sizeof(core_info_db_slot_t))))
+      goto error;
+
+   /* Assign a bit to each distinct extension */
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const struct string_list *list =
+            core_info_list->list[i].supported_extensions_list;
+
+      if (!list)
+         continue;
+
+      for (j = 0; j < list->size; j++)
+      {
+         const char *ext = list->elems[j].data;
+         uint32_t hash;
+         core_info_ext_slot_t *slot;
+
+         if (string_is_empty(ext))
+            continue;
+
+         hash = core_info_hash_string_noncase(ext);
+         slot = core_info_ext_index_find_ext(index, ext, hash);
+
+         if (slot->ext)
+            continue;
+
+         slot->ext  = ext;
+         slot->hash = hash;
+         slot->bit  = (uint32_t)index->num_exts++;
+
+         if (*ext == '.')
+            index->has_dot_prefix = true;
+      }
+   }
+
+   /* Count distinct databases */
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const struct string_list *list =
+            core_info_list->list[i].databases_list;
+
+      if (!list)
+         continue;
+
+      for (j = 0; j < list->size; j++)
+      {
+         const char *name = list->elems[j].data;
+         uint32_t hash;
+         core_info_db_slot_t *slot;
+
+         if (string_is_empty(name))
+            continue;
+
+         hash = core_info_hash_string_noncase(name);
+         slot = core_info_ext_index_find_db(index, name, hash);
+
+         if (slot->name)
+            continue;
+
+         slot->name = name;
+         slot->hash = hash;
+         num_dbs++;
+      }
+   }
+
+   /* Allocate per-core and per-database
+    * extension masks in a single block */
+   index->mask_words = (index->num_exts + 31) >> 5;
+   if (index->mask_words < 1)
+      index->mask_words = 1;
+
+   if (!(index->masks = (uint32_t*)calloc(
+         (core_info_list->count + num_dbs + 1) * index->mask_words,
+         sizeof(uint32_t))))
+      goto error;
+
+   index->query_mask = index->masks
+      + core_info_list->count * index->mask_words;
+   db_masks          = index->query_mask + index->mask_words;
+   for (i = 0; i <= index->db_slot_mask; i++)
+   {
+      if (!index->db_slots[i].name)
+         continue;
+      index->db_slots[i].ext_mask = db_masks;
+      db_masks                   += index->mask_words;
+   }
+
+   /* Populate masks */
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      core_info_t *info              = &core_info_list->list[i];
+      const struct string_list *exts = info->supported_extensions_list;
+      const struct string_list *dbs  = info->databases_list;
+      uint32_t *mask                 = index->masks + i * index->mask_words;
+
+      info->supported_extensions_mask = mask;
+
+      if (exts)
+      {
+         for (j = 0; j < exts->size; j++)
+         {
+            const char *ext = exts->elems[j].data;
+            const core_info_ext_slot_t *slot;
+
+            if (string_is_empty(ext))
+               continue;
+
+            slot = core_info_ext_index_find_ext(index, ext,
+                  core_info_hash_string_noncase(ext));
+            mask[slot->bit >> 5] |= (1u << (slot->bit & 31));
+         }
+      }
+
+      if (!dbs)
+         continue;
+
+      for (j = 0; j < dbs->size; j++)
+      {
+         const char *name = dbs->elems[j].data;
+         core_info_db_slot_t *slot;
+
+         if (string_is_empty(name))
+            continue;
+
+         slot = core_info_ext_index_find_db(index, name,
+               core_info_hash_string_noncase(name));
+
+         for (k = 0; k < index->mask_words; k++)
+            slot->ext_mask[k] |= mask[k];
+
+         if (info->database_match_archive_member)
+            slot->match_archive_member = true;
+      }
+   }
+
+   core_info_list->ext_index = index;
+   return;
+
+error:
+   for (i = 0; i < core_info_list->count; i++)
+      core_info_list->list[i].supported_extensions_mask = NULL;
+   core_info_ext_index_free(index);
+}
+
 static void core_info_free(core_info_t* info)
 {
    size_t i;
@@ -1795,6 +2154,25 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    if (!core_info_list)
       return;
 
+   core_info_ext_index_free(core_info_list->ext_index);
+
+#ifdef HAVE_CORE_INFO_CACHE
+   /* If list was loaded from the binary info
+    * cache, only the core paths are owned by
+    * the list entries */
+   if (core_info_list->cache_data)
+   {
+      for (i = 0; i < core_info_list->count; i++)
+         free(core_info_list->list[i].path);
+
+      core_info_cache_bin_release(core_info_list->cache_data,
+            core_info_list->cache_size, core_info_list->cache_mapped);
+      free(core_info_list->all_ext);
+      free(core_info_list);
+      return;
+   }
+#endif
+
    for (i = 0; i < core_info_list->count; i++)
    {
       core_info_t *info = (core_info_t*)&core_info_list->list[i];
@@ -1806,6 +2184,597 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    free(core_info_list);
 }
 
+#ifdef HAVE_CORE_INFO_CACHE
+/* Binary Info Cache START */
+
+/* Reserves 'len' zero-initialised bytes in the
+ * cache buffer. Returns offset of reserved
+ * region, or (size_t)-1 on allocation failure */
+static size_t core_info_cache_bin_reserve(
+      core_info_cache_bin_buf_t *buf, size_t len)
+{
+   size_t offset = (buf->size + (CORE_INFO_CACHE_BIN_ALIGN - 1))
+         & ~(size_t)(CORE_INFO_CACHE_BIN_ALIGN - 1);
+
+   if (offset + len > buf->capacity)
+   {
+      size_t new_capacity = buf->capacity ? buf->capacity : 16384;
+      uint8_t *data       = NULL;
+
+      while (offset + len > new_capacity)
+         new_capacity <<= 1;
+
+      if (!(data = (uint8_t*)realloc(buf->data, new_capacity)))
+         return (size_t)-1;
+
+      buf->data     = data;
+      buf->capacity = new_capacity;
+   }
+
+   memset(buf->data + buf->size, 0, (offset + len) - buf->size);
+   buf->size = offset + len;
+
+   return offset;
+}
+
+/* Appends a string to the cache buffer. Returns
+ * offset of string, 0 if 'str' is NULL or
+ * (size_t)-1 on allocation failure */
+static size_t core_info_cache_bin_add_string(
+      core_info_cache_bin_buf_t *buf, const char *str)
+{
+   size_t len;
+   size_t offset;
+
+   if (!str)
+      return 0;
+
+   len    = strlen(str) + 1;
+   offset = core_info_cache_bin_reserve(buf, len);
+
+   if (offset != (size_t)-1)
+      memcpy(buf->data + offset, str, len);
+
+   return offset;
+}
+
+static size_t core_info_cache_bin_add_string_list(
+      core_info_cache_bin_buf_t *buf, const struct string_list *list)
+{
+   size_t i;
+   size_t list_offset;
+   size_t elems_offset;
+   struct string_list *bin_list = NULL;
+
+   if (!list)
+      return 0;
+
+   if ((list_offset  = core_info_cache_bin_reserve(buf,
+         sizeof(struct string_list))) == (size_t)-1)
+      return (size_t)-1;
+   if ((elems_offset = core_info_cache_bin_reserve(buf,
+         list->size * sizeof(struct string_list_elem))) == (size_t)-1)
+      return (size_t)-1;
+
+   for (i = 0; i < list->size; i++)
+   {
+      struct string_list_elem *elem = NULL;
+      size_t str_offset             = core_info_cache_bin_add_string(
+            buf, list->elems[i].data);
+
+      if (str_offset == (size_t)-1)
+         return (size_t)-1;
+
+      /* Buffer may have moved - always
+       * recalculate element address */
+      elem       = (struct string_list_elem*)(buf->data + elems_offset) + i;
+      elem->data = (char*)(uintptr_t)str_offset;
+      elem->attr = list->elems[i].attr;
+   }
+
+   bin_list        = (struct string_list*)(buf->data + list_offset);
+   bin_list->elems = (struct string_list_elem*)(uintptr_t)elems_offset;
+   bin_list->size  = list->size;
+   bin_list->cap   = list->size;
+
+   return list_offset;
+}
+
+static bool core_info_cache_bin_add_core(
+      core_info_cache_bin_buf_t *buf, size_t info_offset,
+      const core_info_t *src)
+{
+   size_t i;
+   core_info_t *dst;
+   size_t firmware_offset = 0;
+   size_t offsets[25];
+
+   offsets[0]  = core_info_cache_bin_add_string(buf, src->display_name);
+   offsets[1]  = core_info_cache_bin_add_string(buf, src->display_version);
+   offsets[2]  = core_info_cache_bin_add_string(buf, src->core_name);
+   offsets[3]  = core_info_cache_bin_add_string(buf, src->system_manufacturer);
+   offsets[4]  = core_info_cache_bin_add_string(buf, src->systemname);
+   offsets[5]  = core_info_cache_bin_add_string(buf, src->system_id);
+   offsets[6]  = core_info_cache_bin_add_string(buf, src->supported_extensions);
+   offsets[7]  = core_info_cache_bin_add_string(buf, src->authors);
+   offsets[8]  = core_info_cache_bin_add_string(buf, src->permissions);
+   offsets[9]  = core_info_cache_bin_add_string(buf, src->licenses);
+   offsets[10] = core_info_cache_bin_add_string(buf, src->categories);
+   offsets[11] = core_info_cache_bin_add_string(buf, src->databases);
+   offsets[12] = core_info_cache_bin_add_string(buf, src->notes);
+   offsets[13] = core_info_cache_bin_add_string(buf, src->required_hw_api);
+   offsets[14] = core_info_cache_bin_add_string(buf, src->description);
+   offsets[15] = core_info_cache_bin_add_string_list(buf, src->categories_list);
+   offsets[16] = core_info_cache_bin_add_string_list(buf, src->databases_list);
+   offsets[17] = core_info_cache_bin_add_string_list(buf, src->note_list);
+   offsets[18] = core_info_cache_bin_add_string_list(buf, src->supported_extensions_list);
+   offsets[19] = core_info_cache_bin_add_string_list(buf, src->authors_list);
+   offsets[20] = core_info_cache_bin_add_string_list(buf, src->permissions_list);
+   offsets[21] = core_info_cache_bin_add_string_list(buf, src->licenses_list);
+   offsets[22] = core_info_cache_bin_add_string_list(buf, src->required_hw_api_list);
+   offsets[23] = core_info_cache_bin_add_string(buf, src->core_file_id.str);
+   offsets[24] = 0;
+
+   for (i = 0; i < 24; i++)
+      if (offsets[i] == (size_t)-1)
+         return false;
+
+   if (src->firmware_count > 0)
+   {
+      if ((firmware_offset = core_info_cache_bin_reserve(buf,
+            src->firmware_count * sizeof(core_info_firmware_t))) == (size_t)-1)
+         return false;
+
+      for (i = 0; i < src->firmware_count; i++)
+      {
+         core_info_firmware_t *firmware = NULL;
+         size_t path_offset             = core_info_cache_bin_add_string(
+               buf, src->firmware[i].path);
+         size_t desc_offset             = core_info_cache_bin_add_string(
+               buf, src->firmware[i].desc);
+
+         if (   (path_offset == (size_t)-1)
+             || (desc_offset == (size_t)-1))
+            return false;
+
+         firmware           = (core_info_firmware_t*)
+               (buf->data + firmware_offset) + i;
+         firmware->path     = (char*)(uintptr_t)path_offset;
+         firmware->desc     = (char*)(uintptr_t)desc_offset;
+         firmware->optional = src->firmware[i].optional;
+      }
+   }
+
+   dst                                = (core_info_t*)(buf->data + info_offset);
+   dst->display_name                  = (char*)(uintptr_t)offsets[0];
+   dst->display_version               = (char*)(uintptr_t)offsets[1];
+   dst->core_name                     = (char*)(uintptr_t)offsets[2];
+   dst->system_manufacturer           = (char*)(uintptr_t)offsets[3];
+   dst->systemname                    = (char*)(uintptr_t)offsets[4];
+   dst->system_id                     = (char*)(uintptr_t)offsets[5];
+   dst->supported_extensions          = (char*)(uintptr_t)offsets[6];
+   dst->authors                       = (char*)(uintptr_t)offsets[7];
+   dst->permissions                   = (char*)(uintptr_t)offsets[8];
+   dst->licenses                      = (char*)(uintptr_t)offsets[9];
+   dst->categories                    = (char*)(uintptr_t)offsets[10];
+   dst->databases                     = (char*)(uintptr_t)offsets[11];
+   dst->notes                         = (char*)(uintptr_t)offsets[12];
+   dst->required_hw_api               = (char*)(uintptr_t)offsets[13];
+   dst->description                   = (char*)(uintptr_t)offsets[14];
+   dst->categories_list               = (struct string_list*)(uintptr_t)offsets[15];
+   dst->databases_list                = (struct string_list*)(uintptr_t)offsets[16];
+   dst->note_list                     = (struct string_list*)(uintptr_t)offsets[17];
+   dst->supported_extensions_list     = (struct string_list*)(uintptr_t)offsets[18];
+   dst->authors_list                  = (struct string_list*)(uintptr_t)offsets[19];
+   dst->permissions_list              = (struct string_list*)(uintptr_t)offsets[20];
+   dst->licenses_list                 = (struct string_list*)(uintptr_t)offsets[21];
+   dst->required_hw_api_list          = (struct string_list*)(uintptr_t)offsets[22];
+   dst->core_file_id.str              = (char*)(uintptr_t)offsets[23];
+   dst->core_file_id.hash             = src->core_file_id.hash;
+   dst->firmware                      = (core_info_firmware_t*)(uintptr_t)firmware_offset;
+   dst->firmware_count                = src->firmware_count;
+   dst->has_info                      = src->has_info;
+   dst->supports_no_game              = src->supports_no_game;
+   dst->database_match_archive_member = src->database_match_archive_member;
+   dst->is_experimental               = src->is_experimental;
+   /* Path, lock and install status are
+    * 'dynamic', and are set when loading */
+   dst->path                          = NULL;
+   dst->is_locked                     = false;
+   dst->is_installed                  = false;
+
+   return true;
+}
+
+static bool core_info_cache_bin_write(
+      core_info_cache_list_t *list, const char *info_dir)
+{
+   size_t i;
+   core_info_cache_bin_header_t header;
+   core_info_cache_bin_buf_t buf;
+   char file_path[PATH_MAX_LENGTH];
+   size_t info_offset = 0;
+   uint32_t count     = 0;
+   bool success       = false;
+   RFILE *file        = NULL;
+
+   buf.data     = NULL;
+   buf.size     = 0;
+   buf.capacity = 0;
+
+   if (!list)
+      return false;
+
+   for (i = 0; i < list->length; i++)
+      if (list->items[i].is_installed)
+         count++;
+
+   if (count < 1)
+      return false;
+
+   /* Core info images come first, so any non-NULL
+    * pointer offset is guaranteed to be non-zero */
+   if ((info_offset = core_info_cache_bin_reserve(&buf,
+         count * sizeof(core_info_t))) == (size_t)-1)
+      goto end;
+
+   for (i = 0; i < list->length; i++)
+   {
+      core_info_t *info = &list->items[i];
+
+      if (!info->is_installed)
+         continue;
+
+      if (!core_info_cache_bin_add_core(&buf, info_offset, info))
+         goto end;
+
+      info_offset += sizeof(core_info_t);
+   }
+
+   memcpy(header.magic, CORE_INFO_CACHE_BIN_MAGIC, sizeof(header.magic));
+   header.version               = CORE_INFO_CACHE_BIN_VERSION;
+   header.endian                = CORE_INFO_CACHE_BIN_ENDIAN;
+   header.core_info_size        = (uint32_t)sizeof(core_info_t);
+   header.string_list_size      = (uint32_t)sizeof(struct string_list);
+   header.string_list_elem_size = (uint32_t)sizeof(struct string_list_elem);
+   header.firmware_size         = (uint32_t)sizeof(core_info_firmware_t);
+   header.count                 = count;
+   header.payload_size          = buf.size;
+
+   if (string_is_empty(info_dir))
+      strlcpy(file_path, FILE_PATH_CORE_INFO_CACHE_BIN, sizeof(file_path));
+   else
+      fill_pathname_join(file_path, info_dir, FILE_PATH_CORE_INFO_CACHE_BIN,
+            sizeof(file_path));
+
+   if (!(file = filestream_open(file_path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_ERR("[Core Info] Failed to write to core info cache file: %s\n", file_path);
+      goto end;
+   }
+
+   success =
+         (filestream_write(file, &header, sizeof(header)) == sizeof(header))
+      && (filestream_write(file, buf.data, buf.size) == (int64_t)buf.size);
+
+   filestream_close(file);
+
+   if (success)
+      RARCH_LOG("[Core Info] Wrote to cache file: %s\n", file_path);
+   else
+      filestream_delete(file_path);
+
+end:
+   free(buf.data);
+   return success;
+}
+
+static bool core_info_cache_bin_fixup_string(char **str,
+      uint8_t *data, size_t size)
+{
+   size_t offset = (size_t)(uintptr_t)*str;
+
+   if (!offset)
+      return true;
+   if (   (offset >= size)
+       || !memchr(data + offset, '\0', size - offset))
+      return false;
+
+   *str = (char*)(data + offset);
+   return true;
+}
+
+static bool core_info_cache_bin_fixup_string_list(
+      struct string_list **list, uint8_t *data, size_t size)
+{
+   size_t i;
+   size_t offset = (size_t)(uintptr_t)*list;
+   size_t elems_offset;
+   struct string_list *bin_list;
+
+   if (!offset)
+      return true;
+   if (offset > size - sizeof(struct string_list))
+      return false;
+
+   bin_list     = (struct string_list*)(data + offset);
+   elems_offset = (size_t)(uintptr_t)bin_list->elems;
+
+   if (   (elems_offset > size)
+       || (bin_list->size > (size - elems_offset)
+            / sizeof(struct string_list_elem)))
+      return false;
+
+   bin_list->elems = (struct string_list_elem*)(data + elems_offset);
+
+   for (i = 0; i < bin_list->size; i++)
+   {
+      bin_list->elems[i].userdata = NULL;
+      if (!core_info_cache_bin_fixup_string(
+            &bin_list->elems[i].data, data, size))
+         return false;
+   }
+
+   *list = bin_list;
+   return true;
+}
+
+static bool core_info_cache_bin_fixup_core(core_info_t *info,
+      uint8_t *data, size_t size)
+{
+   size_t i;
+   size_t firmware_offset = (size_t)(uintptr_t)info->firmware;
+
+   if (   !core_info_cache_bin_fixup_string(&info->display_name,        data, size)
+       || !core_info_cache_bin_fixup_string(&info->display_version,     data, size)
+       || !core_info_cache_bin_fixup_string(&info->core_name,           data, size)
+       || !core_info_cache_bin_fixup_string(&info->system_manufacturer, data, size)
+       || !core_info_cache_bin_fixup_string(&info->systemname,          data, size)
+       || !core_info_cache_bin_fixup_string(&info->system_id,           data, size)
+       || !core_info_cache_bin_fixup_string(&info->supported_extensions,data, size)
+       || !core_info_cache_bin_fixup_string(&info->authors,             data, size)
+       || !core_info_cache_bin_fixup_string(&info->permissions,         data, size)
+       || !core_info_cache_bin_fixup_string(&info->licenses,            data, size)
+       || !core_info_cache_bin_fixup_string(&info->categories,          data, size)
+       || !core_info_cache_bin_fixup_string(&info->databases,           data, size)
+       || !core_info_cache_bin_fixup_string(&info->notes,               data, size)
+       || !core_info_cache_bin_fixup_string(&info->required_hw_api,     data, size)
+       || !core_info_cache_bin_fixup_string(&info->description,         data, size)
+       || !core_info_cache_bin_fixup_string(&info->core_file_id.str,    data, size)
+       || !core_info_cache_bin_fixup_string_list(&info->categories_list,           data, size)
+       || !core_info_cache_bin_fixup_string_list(&info->databases_list,            data, size)
+       || !core_info_cache_bin_fixup_string_list(&info->note_list,                 data, size)
+       || !core_info_cache_bin_fixup_string_list(&info->supported_extensions_list, data, size)
+       || !core_info_cache_bin_fixup_string_list(&info->authors_list,              data, size)
+       || !core_info_cache_bin_fixup_string_list(&info->permissions_list,          data, size)
+       || !core_info_cache_bin_fixup_string_list(&info->licenses_list,             data, size)
+       || !core_info_cache_bin_fixup_string_list(&info->required_hw_api_list,      data, size)
+       || string_is_empty(info->core_file_id.str))
+      return false;
+
+   info->firmware = NULL;
+
+   if (info->firmware_count > 0)
+   {
+      if (   (firmware_offset == 0)
+          || (firmware_offset > size)
+          || (info->firmware_count > (size - firmware_offset)
+               / sizeof(core_info_firmware_t)))
+         return false;
+
+      info->firmware = (core_info_firmware_t*)(data + firmware_offset);
+
+      for (i = 0; i < info->firmware_count; i++)
+      {
+         info->firmware[i].missing = false;
+         if (   !core_info_cache_bin_fixup_string(
+                  &info->firmware[i].path, data, size)
+             || !core_info_cache_bin_fixup_string(
+                  &info->firmware[i].desc, data, size))
+            return false;
+      }
+   }
+
+   return true;
+}
+
+static void core_info_cache_bin_release(void *data, size_t size,
+      bool mapped)
+{
+   if (!data)
+      return;
+#ifdef CORE_INFO_CACHE_BIN_MMAP
+   if (mapped)
+   {
+      munmap(data, size);
+      return;
+   }
+#endif
+   free(data);
+}
+
+/* Reads binary info cache into memory
+ * (copy-on-write mapping where supported).
+ * Returns pointer to header, or NULL if
+ * cache is missing or invalid */
+static core_info_cache_bin_header_t *core_info_cache_bin_open(
+      const char *file_path, size_t *size, bool *mapped)
+{
+   core_info_cache_bin_header_t *header = NULL;
+   void *data                           = NULL;
+   int64_t len                          = 0;
+
+   *mapped = false;
+
+#ifdef CORE_INFO_CACHE_BIN_MMAP
+   {
+      struct stat st;
+      int fd = open(file_path, O_RDONLY);
+
+      if (fd >= 0)
+      {
+         if (   (fstat(fd, &st) == 0)
+             && (st.st_size > (off_t)sizeof(core_info_cache_bin_header_t)))
+         {
+            data = mmap(NULL, (size_t)st.st_size,
+                  PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+               data = NULL;
+            else
+            {
+               len     = (int64_t)st.st_size;
+               *mapped = true;
+            }
+         }
+         close(fd);
+      }
+   }
+#endif
+
+   if (!data)
+   {
+      if (   !path_is_valid(file_path)
+          || !filestream_read_file(file_path, &data, &len))
+         return NULL;
+   }
+
+   header = (core_info_cache_bin_header_t*)data;
+
+   if (   (len < (int64_t)sizeof(*header))
+       || memcmp(header->magic, CORE_INFO_CACHE_BIN_MAGIC,
+               sizeof(header->magic))
+       || (header->version               != CORE_INFO_CACHE_BIN_VERSION)
+       || (header->endian                != CORE_INFO_CACHE_BIN_ENDIAN)
+       || (header->core_info_size        != sizeof(core_info_t))
+       || (header->string_list_size      != sizeof(struct string_list))
+       || (header->string_list_elem_size != sizeof(struct string_list_elem))
+       || (header->firmware_size         != sizeof(core_info_firmware_t))
+       || (header->payload_size          != (uint64_t)len - sizeof(*header))
+       || (header->count                 >  header->payload_size
+               / sizeof(core_info_t)))
+   {
+      core_info_cache_bin_release(data, (size_t)len, *mapped);
+      return NULL;
+   }
+
+   *size = (size_t)len;
+   return header;
+}
+
+/* Attempts to populate 'core_info_list' directly
+ * from the binary info cache. The cache is only
+ * used if it contains exactly the set of installed
+ * cores (matched by core file id); otherwise returns
+ * false, and the JSON cache must be used instead */
+static bool core_info_cache_bin_read(core_info_list_t *core_info_list,
+      core_path_list_t *path_list, const char *info_dir)
+{
+   size_t i, j;
+   size_t size                          = 0;
+   bool mapped                          = false;
+   core_info_cache_bin_header_t *header = NULL;
+   core_info_t *items                   = NULL;
+   uint8_t *payload                     = NULL;
+   size_t payload_size;
+   char file_path[PATH_MAX_LENGTH];
+
+   /* A 'force refresh' file invalidates
+    * all caches */
+   if (string_is_empty(info_dir))
+      strlcpy(file_path,
+            FILE_PATH_CORE_INFO_CACHE_REFRESH, sizeof(file_path));
+   else
+      fill_pathname_join(file_path,
+            info_dir, FILE_PATH_CORE_INFO_CACHE_REFRESH,
+            sizeof(file_path));
+
+   if (path_is_valid(file_path))
+      return false;
+
+   if (string_is_empty(info_dir))
+      strlcpy(file_path, FILE_PATH_CORE_INFO_CACHE_BIN, sizeof(file_path));
+   else
+      fill_pathname_join(file_path, info_dir, FILE_PATH_CORE_INFO_CACHE_BIN,
+            sizeof(file_path));
+
+   if (!(header = core_info_cache_bin_open(file_path, &size, &mapped)))
+      return false;
+
+   payload      = (uint8_t*)(header + 1);
+   payload_size = (size_t)header->payload_size;
+   items        = (core_info_t*)payload;
+
+   if (header->count != path_list->core_list->size)
+      goto error;
+
+   for (i = 0; i < header->count; i++)
+      items[i].path = NULL;
+
+   for (i = 0; i < header->count; i++)
+      if (!core_info_cache_bin_fixup_core(&items[i], payload, payload_size))
+         goto error;
+
+   /* Match every installed core against
+    * the cache */
+   for (i = 0; i < path_list->core_list->size; i++)
+   {
+      core_file_path_t *core_file = &path_list->core_list->list[i];
+      core_info_t *info           = NULL;
+      uint32_t hash;
+      char core_file_id[256];
+
+      core_file_id[0] = '\0';
+
+      if (!core_info_get_file_id(core_file->filename, core_file_id,
+               sizeof(core_file_id)))
+         goto error;
+
+      hash = core_info_hash_string(core_file_id);
+
+      for (j = 0; j < header->count; j++)
+      {
+         if (   (items[j].core_file_id.hash == hash)
+             && !items[j].path
+             && string_is_equal(items[j].core_file_id.str, core_file_id))
+         {
+            info = &items[j];
+            break;
+         }
+      }
+
+      if (!info || !(info->path = strdup(core_file->path)))
+         goto error;
+
+      info->is_locked    = core_info_path_is_locked(
+            path_list->lock_list, core_file->filename);
+      info->is_installed = true;
+
+      if (info->has_info)
+         core_info_list->info_count++;
+   }
+
+   core_info_list->list         = items;
+   core_info_list->count        = header->count;
+   core_info_list->cache_data   = header;
+   core_info_list->cache_size   = size;
+   core_info_list->cache_mapped = mapped;
+
+   return true;
+
+error:
+   for (i = 0; i < header->count; i++)
+      if (items[i].path)
+         free(items[i].path);
+   core_info_list->info_count = 0;
+   core_info_cache_bin_release(header, size, mapped);
+   return false;
+}
+
+/* Binary Info Cache END */
+#endif
+
 static core_info_list_t *core_info_list_new(const char *path,
       const char *libretro_info_dir,
       const char *exts,
@@ -1827,10 +2796,28 @@ static core_info_list_t *core_info_list_new(const char *path,
    if (!core_info_list)
       goto error;
 
-   core_info_list->list       = NULL;
-   core_info_list->count      = 0;
-   core_info_list->info_count = 0;
-   core_info_list->all_ext    = NULL;
+   core_info_list->list         = NULL;
+   core_info_list->count        = 0;
+   core_info_list->info_count   = 0;
+   core_info_list->all_ext      = NULL;
+   core_info_list->ext_index    = NULL;
+   core_info_list->cache_data   = NULL;
+   core_info_list->cache_size   = 0;
+   core_info_list->cache_mapped = false;
+
+#ifdef HAVE_CORE_INFO_CACHE
+   /* Use binary info cache in place, if it
+    * matches the set of installed cores */
+   if (     enable_cache
+         && core_info_cache_bin_read(core_info_list, path_list, info_dir))
+   {
+      core_info_list_resolve_all_extensions(core_info_list);
+      core_info_list_resolve_ext_index(core_info_list);
+      *cache_supported = true;
+      core_info_path_list_free(path_list);
+      return core_info_list;
+   }
+#endif
 
    core_info = (core_info_t*)calloc(path_list->core_list->size,
          sizeof(*core_info));
@@ -1938,6 +2925,7 @@ static core_info_list_t *core_info_list_new(const char *path,
    }
 
    core_info_list_resolve_all_extensions(core_info_list);
+   core_info_list_resolve_ext_index(core_info_list);
 
    /* If info cache is enabled
     * > Check whether any cached cores have been
@@ -1954,6 +2942,13 @@ static core_info_list_t *core_info_list_new(const char *path,
          *cache_supported = core_info_cache_write(
                core_info_cache_list, info_dir);
 
+#ifdef HAVE_CORE_INFO_CACHE
+      /* If we reach this point, the binary info
+       * cache is missing or stale - regenerate it */
+      if (*cache_supported)
+         core_info_cache_bin_write(core_info_cache_list, info_dir);
+#endif
+
       core_info_cache_list_free(core_info_cache_list);
    }
 
@@ -2019,21 +3014,43 @@ static bool core_info_does_support_file(
 
 /* qsort_r() is not in standard C, sadly. */
 
+/* Returns true if core supports the content
+ * currently being matched (either the content
+ * file itself, or any member of an archive) */
+static bool core_info_does_support_content(const core_info_t *core)
+{
+   core_info_state_t *p_coreinfo              = &core_info_st;
+   const core_info_ext_index_t *index         = p_coreinfo->tmp_ext_index;
+
+   if (index)
+   {
+      size_t i;
+
+      if (!core->supported_extensions_mask)
+         return false;
+
+      for (i = 0; i < index->mask_words; i++)
+         if (core->supported_extensions_mask[i] & index->query_mask[i])
+            return true;
+
+      return false;
+   }
+
+   if (core_info_does_support_file(core, p_coreinfo->tmp_path))
+      return true;
+#ifdef HAVE_COMPRESSION
+   if (core_info_does_support_any_file(core, p_coreinfo->tmp_list))
+      return true;
+#endif
+   return false;
+}
+
 static int core_info_qsort_cmp(const void *a_, const void *b_)
 {
-   core_info_state_t *p_coreinfo = &core_info_st;
    const core_info_t          *a = (const core_info_t*)a_;
    const core_info_t          *b = (const core_info_t*)b_;
-   int support_a                 = core_info_does_support_file(a,
-         p_coreinfo->tmp_path);
-   int support_b                 = core_info_does_support_file(b,
-         p_coreinfo->tmp_path);
-#ifdef HAVE_COMPRESSION
-   support_a            = support_a ||
-      core_info_does_support_any_file(a, p_coreinfo->tmp_list);
-   support_b            = support_b ||
-      core_info_does_support_any_file(b, p_coreinfo->tmp_list);
-#endif
+   int support_a                 = core_info_does_support_content(a);
+   int support_b                 = core_info_does_support_content(b);
 
    if (support_a != support_b)
       return support_b - support_a;
@@ -2122,6 +3139,7 @@ bool core_info_init_current_core(void)
    current->licenses_list                 = NULL;
    current->required_hw_api_list          = NULL;
    current->firmware                      = NULL;
+   current->supported_extensions_mask     = NULL;
    current->core_file_id.str              = NULL;
    current->core_file_id.hash             = 0;
 
@@ -2255,10 +3273,12 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
    struct string_list *list      = NULL;
 #endif
    core_info_state_t *p_coreinfo = &core_info_st;
+   core_info_ext_index_t *index  = NULL;
 
    if (!core_info_list)
       return;
 
+   index                         = core_info_list->ext_index;
    p_coreinfo->tmp_path          = path;
 
 #ifdef HAVE_COMPRESSION
@@ -2267,29 +3287,47 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
    p_coreinfo->tmp_list = list;
 #endif
 
+   /* Resolve content extension(s) once, so that
+    * per-core checks are simple mask tests */
+   if (index)
+   {
+      int bit;
+
+      memset(index->query_mask, 0,
+            index->mask_words * sizeof(uint32_t));
+
+      if (!string_is_empty(path) &&
+          (bit = core_info_ext_index_get_bit(index,
+               path_get_extension(path))) >= 0)
+         index->query_mask[bit >> 5] |= (1u << (bit & 31));
+
+#ifdef HAVE_COMPRESSION
+      if (list)
+      {
+         for (i = 0; i < list->size; i++)
+            if ((bit = core_info_ext_index_get_bit(index,
+                  path_get_extension(list->elems[i].data))) >= 0)
+               index->query_mask[bit >> 5] |= (1u << (bit & 31));
+      }
+#endif
+   }
+   p_coreinfo->tmp_ext_index = index;
+
    /* Let supported core come first in list so we can return
     * a pointer to them. */
    qsort(core_info_list->list, core_info_list->count,
          sizeof(core_info_t), core_info_qsort_cmp);
 
    for (i = 0; i < core_info_list->count; i++, supported++)
-   {
-      const core_info_t *core = &core_info_list->list[i];
-
-      if (core_info_does_support_file(core, path))
-         continue;
-
-#ifdef HAVE_COMPRESSION
-      if (core_info_does_support_any_file(core, list))
-         continue;
-#endif
+      if (!core_info_does_support_content(&core_info_list->list[i]))
+         break;
 
-      break;
-   }
+   p_coreinfo->tmp_ext_index = NULL;
 
 #ifdef HAVE_COMPRESSION
    if (list)
       string_list_free(list);
+   p_coreinfo->tmp_list = NULL;
 #endif
 
    *infos     = core_info_list->list;
@@ -2326,6 +3364,24 @@ bool core_info_core_file_id_is_equal(const char *core_path_a,
    return string_is_equal(core_file_id_a, core_file_id_b);
 }
 
+/* Returns database dispatch table entry for
+ * specified database path, or NULL if no core
+ * references the database */
+static const core_info_db_slot_t *core_info_ext_index_get_db(
+      const core_info_ext_index_t *index, const char *database_name)
+{
+   const core_info_db_slot_t *slot = NULL;
+   char database[PATH_MAX_LENGTH];
+
+   strlcpy(database, database_name, sizeof(database));
+   path_remove_extension(database);
+
+   slot = core_info_ext_index_find_db(index, database,
+         core_info_hash_string_noncase(database));
+
+   return slot->name ? slot : NULL;
+}
+
 bool core_info_database_match_archive_member(const char *database_path)
 {
    char      *database           = NULL;
@@ -2335,14 +3391,24 @@ bool core_info_database_match_archive_member(const char *database_path)
 
    if (string_is_empty(new_path))
       return false;
+
+   p_coreinfo                     = &core_info_st;
+
+   if (!p_coreinfo->curr_list)
+      return false;
+
+   if (p_coreinfo->curr_list->ext_index)
+   {
+      const core_info_db_slot_t *db = core_info_ext_index_get_db(
+            p_coreinfo->curr_list->ext_index, new_path);
+      return db && db->match_archive_member;
+   }
+
    if (!(database = strdup(new_path)))
       return false;
 
    path_remove_extension(database);
 
-   p_coreinfo                     = &core_info_st;
-
-   if (p_coreinfo->curr_list)
    {
       size_t i;
 
@@ -2374,14 +3440,38 @@ bool core_info_database_supports_content_path(
 
    if (string_is_empty(new_path))
       return false;
+
+   p_coreinfo                    = &core_info_st;
+
+   if (!p_coreinfo->curr_list)
+      return false;
+
+   if (p_coreinfo->curr_list->ext_index)
+   {
+      const core_info_ext_index_t *index = p_coreinfo->curr_list->ext_index;
+      const core_info_db_slot_t *db      = core_info_ext_index_get_db(
+            index, new_path);
+      /* Note: unlike content association, database
+       * matching does not accept dot-prefixed
+       * extensions; this mirrors the previous
+       * string_list_find_elem() lookup */
+      const char *ext                    = path_get_extension(path);
+      const core_info_ext_slot_t *slot   = NULL;
+
+      if (!db || string_is_empty(ext))
+         return false;
+
+      slot = core_info_ext_index_find_ext(index, ext,
+            core_info_hash_string_noncase(ext));
+
+      return slot->ext && core_info_ext_mask_test(db->ext_mask, (int)slot->bit);
+   }
+
    if (!(database = strdup(new_path)))
       return false;
 
    path_remove_extension(database);
 
-   p_coreinfo                    = &core_info_st;
-
-   if (p_coreinfo->curr_list)
    {
       size_t i;
 
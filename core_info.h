@@ -82,6 +82,9 @@ typedef struct
    struct string_list *licenses_list;
    struct string_list *required_hw_api_list;
    core_info_firmware_t *firmware;
+   /* Bitset of supported extensions, indexed via
+    * the owning list's extension dispatch table */
+   uint32_t *supported_extensions_mask;
    core_file_id_t core_file_id; /* ptr alignment */
    size_t firmware_count;
    bool has_info;
@@ -102,12 +105,23 @@ typedef struct
    bool is_experimental;
 } core_updater_info_t;
 
+/* Extension -> core and database -> extension
+ * dispatch tables, built when a core info list
+ * is loaded */
+typedef struct core_info_ext_index core_info_ext_index_t;
+
 typedef struct
 {
    core_info_t *list;
    char *all_ext;
+   core_info_ext_index_t *ext_index;
+   /* If non-NULL, 'list' resides inside this
+    * binary info cache buffer */
+   void *cache_data;
+   size_t cache_size;
    size_t count;
    size_t info_count;
+   bool cache_mapped;
 } core_info_list_t;
 
 typedef struct core_info_ctx_firmware
@@ -125,6 +139,7 @@ struct core_info_state
    const struct string_list *tmp_list;
 #endif
    const char *tmp_path;
+   const core_info_ext_index_t *tmp_ext_index;
    core_info_t *current;
    core_info_list_t *curr_list;
 };
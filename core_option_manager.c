@@ -612,6 +612,76 @@ static uint32_t core_option_manager_hash_string(const char *str)
    return (hash ? hash : 1);
 }
 
+/* Builds the key -> option index hash table.
+ * Must be called once all options have been parsed.
+ * If a core registers the same key twice, the first
+ * option wins (as with a linear search) */
+static bool core_option_manager_build_key_index(
+      core_option_manager_t *opt)
+{
+   size_t i;
+   size_t capacity = 8;
+
+   /* Keep load factor at or below 50% */
+   while (capacity < opt->size * 2)
+      capacity <<= 1;
+
+   if (!(opt->key_index = (size_t*)calloc(capacity, sizeof(size_t))))
+      return false;
+
+   opt->key_index_mask = capacity - 1;
+
+   for (i = 0; i < opt->size; i++)
+   {
+      struct core_option *option = &opt->opts[i];
+      size_t slot                = option->key_hash & opt->key_index_mask;
+
+      if (string_is_empty(option->key))
+         continue;
+
+      for (; opt->key_index[slot];
+             slot = (slot + 1) & opt->key_index_mask)
+      {
+         struct core_option *other = &opt->opts[opt->key_index[slot] - 1];
+
+         if ((other->key_hash == option->key_hash) &&
+             string_is_equal(other->key, option->key))
+            break;
+      }
+
+      if (!opt->key_index[slot])
+         opt->key_index[slot] = i + 1;
+   }
+
+   return true;
+}
+
+/* Returns the option matching @key, or NULL */
+static struct core_option *core_option_manager_find(
+      core_option_manager_t *opt, const char *key)
+{
+   size_t slot;
+   uint32_t key_hash;
+
+   if (!opt->key_index)
+      return NULL;
+
+   key_hash = core_option_manager_hash_string(key);
+
+   for (slot = key_hash & opt->key_index_mask;
+        opt->key_index[slot];
+        slot = (slot + 1) & opt->key_index_mask)
+   {
+      struct core_option *option = &opt->opts[opt->key_index[slot] - 1];
+
+      if ((key_hash == option->key_hash) &&
+          string_is_equal(key, option->key))
+         return option;
+   }
+
+   return NULL;
+}
+
 /* Sanitises a core option value label, handling the case
  * where an explicit label is not provided and performing
  * conversion of various true/false identifiers to
@@ -834,7 +904,10 @@ core_option_manager_t *core_option_manager_new_vars(
    opt->opts                        = NULL;
    opt->size                        = 0;
    opt->option_map                  = nested_list_init();
-   opt->updated                     = false;
+   opt->key_index                   = NULL;
+   opt->key_index_mask              = 0;
+   opt->generation                  = 0;
+   opt->read_generation             = 0;
 
    if (!opt->option_map)
       goto error;
@@ -896,6 +969,9 @@ core_option_manager_t *core_option_manager_new_vars(
          goto error;
    }
 
+   if (!core_option_manager_build_key_index(opt))
+      goto error;
+
    if (config_src)
       config_file_free(config_src);
 
@@ -1125,7 +1201,10 @@ core_option_manager_t *core_option_manager_new(
    opt->opts                         = NULL;
    opt->size                         = 0;
    opt->option_map                   = nested_list_init();
-   opt->updated                      = false;
+   opt->key_index                    = NULL;
+   opt->key_index_mask               = 0;
+   opt->generation                   = 0;
+   opt->read_generation              = 0;
 
    if (!opt->option_map)
       goto error;
@@ -1234,6 +1313,9 @@ core_option_manager_t *core_option_manager_new(
          goto error;
    }
 
+   if (!core_option_manager_build_key_index(opt))
+      goto error;
+
    if (config_src)
       config_file_free(config_src);
 
@@ -1306,6 +1388,8 @@ void core_option_manager_free(core_option_manager_t *opt)
    if (opt->option_map)
       nested_list_free(opt->option_map);
 
+   free(opt->key_index);
+
    if (opt->conf)
       config_file_free(opt->conf);
 
@@ -1478,30 +1562,18 @@ bool core_option_manager_get_category_visible(core_option_manager_t *opt,
 bool core_option_manager_get_idx(core_option_manager_t *opt,
       const char *key, size_t *idx)
 {
-   uint32_t key_hash;
-   size_t i;
+   struct core_option *option = NULL;
 
    if (!opt ||
        string_is_empty(key) ||
        !idx)
       return false;
 
-   key_hash = core_option_manager_hash_string(key);
-
-   for (i = 0; i < opt->size; i++)
-   {
-      struct core_option *option = &opt->opts[i];
-
-      if ((key_hash == option->key_hash) &&
-          !string_is_empty(option->key) &&
-          string_is_equal(key, option->key))
-      {
-         *idx = i;
-         return true;
-      }
-   }
+   if (!(option = core_option_manager_find(opt, key)))
+      return false;
 
-   return false;
+   *idx = (size_t)(option - opt->opts);
+   return true;
 }
 
 /**
@@ -1744,7 +1816,7 @@ void core_option_manager_set_val(core_option_manager_t *opt,
 
    option        = (struct core_option*)&opt->opts[idx];
    option->index = val_idx % option->vals->size;
-   opt->updated  = true;
+   core_option_manager_mark_changed(opt, idx);
 
 #ifdef HAVE_CHEEVOS
    rcheevos_validate_config_settings();
@@ -1796,7 +1868,7 @@ void core_option_manager_adjust_val(core_option_manager_t* opt,
 
    option        = (struct core_option*)&opt->opts[idx];
    option->index = (option->index + option->vals->size + adjustment) % option->vals->size;
-   opt->updated  = true;
+   core_option_manager_mark_changed(opt, idx);
 
 #ifdef HAVE_CHEEVOS
    rcheevos_validate_config_settings();
@@ -1842,7 +1914,7 @@ void core_option_manager_set_default(core_option_manager_t *opt,
       return;
 
    opt->opts[idx].index = opt->opts[idx].default_index;
-   opt->updated         = true;
+   core_option_manager_mark_changed(opt, idx);
 
 #ifdef HAVE_CHEEVOS
    rcheevos_validate_config_settings();
@@ -1862,6 +1934,28 @@ void core_option_manager_set_default(core_option_manager_t *opt,
 #endif
 }
 
+/**
+ * core_option_manager_mark_changed:
+ *
+ * @opt : options manager handle
+ * @idx : core option index
+ *
+ * Bumps the generation counter after the value
+ * of the core option at index @idx has been
+ * modified directly (i.e. without going through
+ * one of the setters above), so that the core
+ * sees the update.
+ **/
+void core_option_manager_mark_changed(core_option_manager_t *opt,
+      size_t idx)
+{
+   if (!opt ||
+       (idx >= opt->size))
+      return;
+
+   opt->generation++;
+}
+
 /**
  * core_option_manager_set_visible:
  *
@@ -1877,26 +1971,13 @@ void core_option_manager_set_default(core_option_manager_t *opt,
 void core_option_manager_set_visible(core_option_manager_t *opt,
       const char *key, bool visible)
 {
-   uint32_t key_hash;
-   size_t i;
+   struct core_option *option = NULL;
 
    if (!opt || string_is_empty(key))
       return;
 
-   key_hash = core_option_manager_hash_string(key);
-
-   for (i = 0; i < opt->size; i++)
-   {
-      struct core_option *option = &opt->opts[i];
-
-      if ((key_hash == option->key_hash) &&
-          !string_is_empty(option->key) &&
-          string_is_equal(key, option->key))
-      {
-         option->visible = visible;
-         return;
-      }
-   }
+   if ((option = core_option_manager_find(opt, key)))
+      option->visible = visible;
 }
 
 /**********************/
@@ -71,11 +71,23 @@ struct core_option_manager
    struct core_catagory *cats;
    struct core_option *opts;
    nested_list_t *option_map;
+   /* Open addressed hash table of option
+    * key -> (option index + 1), 0 marks an
+    * empty slot. Size is key_index_mask + 1,
+    * a power of two */
+   size_t *key_index;
 
    size_t cats_size;
    size_t size;
-
-   bool updated;
+   size_t key_index_mask;
+
+   /* Incremented every time an option value
+    * changes */
+   uint32_t generation;
+   /* Value of 'generation' when the core last
+    * read an option. Values have been updated
+    * since then if the two differ */
+   uint32_t read_generation;
 };
 
 typedef struct core_option_manager core_option_manager_t;
@@ -280,6 +292,29 @@ bool core_option_manager_get_category_visible(core_option_manager_t *opt,
 bool core_option_manager_get_idx(core_option_manager_t *opt,
       const char *key, size_t *idx);
 
+/**
+ * core_option_manager_is_updated:
+ *
+ * @opt : options manager handle
+ *
+ * Returns: true if any option value has changed
+ * since core_option_manager_mark_read() was last
+ * called (i.e. RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE).
+ **/
+#define core_option_manager_is_updated(opt) \
+   ((opt)->generation != (opt)->read_generation)
+
+/**
+ * core_option_manager_mark_read:
+ *
+ * @opt : options manager handle
+ *
+ * Records that the core has read the current
+ * option values.
+ **/
+#define core_option_manager_mark_read(opt) \
+   ((opt)->read_generation = (opt)->generation)
+
 /**
  * core_option_manager_get_val_idx:
  *
@@ -460,6 +495,21 @@ void core_option_manager_adjust_val(core_option_manager_t* opt,
 void core_option_manager_set_default(core_option_manager_t *opt,
       size_t idx, bool refresh_menu);
 
+/**
+ * core_option_manager_mark_changed:
+ *
+ * @opt : options manager handle
+ * @idx : core option index
+ *
+ * Bumps the generation counter after the value
+ * of the core option at index @idx has been
+ * modified directly (i.e. without going through
+ * one of the setters above), so that the core
+ * sees the update.
+ **/
+void core_option_manager_mark_changed(core_option_manager_t *opt,
+      size_t idx);
+
 /**
  * core_option_manager_set_visible:
  *
@@ -24,6 +24,7 @@
 #include "driver.h"
 #include "retroarch.h"
 #include "runloop.h"
+#include "startup_trace.h"
 #include "verbosity.h"
 
 #ifdef HAVE_BLUETOOTH
@@ -440,6 +441,7 @@ void drivers_init(
       *location_st             = location_state_get_ptr();
    bool video_is_threaded      = VIDEO_DRIVER_IS_THREADED_INTERNAL(video_st);
    gfx_display_t *p_disp       = disp_get_ptr();
+   int trace_phase             = -1;
 #if defined(HAVE_GFX_WIDGETS)
    bool video_font_enable      = settings->bools.video_font_enable;
    bool menu_enable_widgets    = settings->bools.menu_enable_widgets;
@@ -470,6 +472,7 @@ void drivers_init(
          VIDEO_DRIVER_GET_HW_CONTEXT_INTERNAL(video_st);
 
       video_st->frame_time_count = 0;
+      trace_phase                = startup_trace_begin("video_init");
 
       video_driver_lock_new();
 #ifdef HAVE_VIDEO_FILTER
@@ -485,11 +488,13 @@ void drivers_init(
          hwr->context_reset();
       video_st->cache_context_ack = false;
       runloop_st->frame_time_last = 0;
+      startup_trace_end(trace_phase);
    }
 
    /* Initialize audio driver */
    if (flags & DRIVER_AUDIO_MASK)
    {
+      trace_phase = startup_trace_begin("audio_init");
       audio_driver_init_internal(
             settings,
             audio_st->callback.callback != NULL);
@@ -499,6 +504,7 @@ void drivers_init(
          audio_st->devices_list = (struct string_list*)
             audio_st->current_audio->device_list_new(
                   audio_st->context_audio_data);
+      startup_trace_end(trace_phase);
    }
 
    /* Regular display refresh rate startup autoswitch based on content av_info */
@@ -597,6 +603,7 @@ void drivers_init(
       bool video_is_fullscreen    = settings->bools.video_fullscreen ||
             rarch_force_fullscreen;
 
+      trace_phase                 = startup_trace_begin("widgets_init");
       dispwidget_get_ptr()->active= gfx_widgets_init(
             p_disp,
             anim_get_ptr(),
@@ -608,6 +615,7 @@ void drivers_init(
             video_is_fullscreen,
             settings->paths.directory_assets,
             settings->paths.path_font);
+      startup_trace_end(trace_phase);
    }
    else
 #endif
@@ -621,8 +629,10 @@ void drivers_init(
       /* Initialize menu driver */
       if (flags & DRIVER_MENU_MASK)
       {
+         trace_phase = startup_trace_begin("menu_driver_init");
          if (!menu_driver_init(video_is_threaded))
              RARCH_ERR("Unable to init menu driver.\n");
+         startup_trace_end(trace_phase);
 
 #ifdef HAVE_LIBRETRODB
          menu_explore_context_init();
@@ -112,6 +112,7 @@ RETRO_BEGIN_DECLS
 #define FILE_PATH_DEFAULT_OVERLAY "gamepads/neo-retropad/neo-retropad.cfg"
 #endif
 #define FILE_PATH_CORE_INFO_CACHE "core_info.cache"
+#define FILE_PATH_CORE_INFO_CACHE_BIN "core_info.bin"
 #define FILE_PATH_CORE_INFO_CACHE_REFRESH "core_info.refresh"
 
 enum application_special_type
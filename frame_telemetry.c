@@ -0,0 +1,313 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "frame_telemetry.h"
+#include "verbosity.h"
+
+/* Histogram layout: values below 2^FRAME_TELEMETRY_LINEAR_BITS
+ * usec get one bucket each, every power of two above
+ * that is split into 2^FRAME_TELEMETRY_SUB_BITS buckets
+ * (i.e. percentiles are accurate to within ~3%) */
+#define FRAME_TELEMETRY_LINEAR_BITS 5
+#define FRAME_TELEMETRY_SUB_BITS    4
+#define FRAME_TELEMETRY_BUCKETS     ((1 << FRAME_TELEMETRY_LINEAR_BITS) + \
+      ((32 - FRAME_TELEMETRY_LINEAR_BITS) << FRAME_TELEMETRY_SUB_BITS))
+
+typedef struct
+{
+   uint32_t usec[FRAME_TELEMETRY_STAGE_LAST];
+   bool stutter;
+} frame_telemetry_record_t;
+
+typedef struct
+{
+   frame_telemetry_record_t ring[FRAME_TELEMETRY_WINDOW];
+   uint16_t histogram[FRAME_TELEMETRY_STAGE_LAST][FRAME_TELEMETRY_BUCKETS];
+   uint64_t total[FRAME_TELEMETRY_STAGE_LAST];
+   retro_time_t accum[FRAME_TELEMETRY_STAGE_LAST];
+   retro_time_t frame_start;
+   retro_time_t frame_interval; /* -1 if unknown */
+   uint64_t frames;             /* Ring write counter */
+   uint64_t stutters_total;
+   unsigned stutters;
+   bool committed;
+} frame_telemetry_state_t;
+
+static frame_telemetry_state_t frame_telemetry_st;
+
+static const char *frame_telemetry_stage_names[FRAME_TELEMETRY_STAGE_LAST] = {
+   "frame",
+   "core_run",
+   "video",
+   "audio",
+   "input",
+   "runahead",
+   "rewind",
+   "serialize",
+   "resample",
+   "convert"
+};
+
+static unsigned frame_telemetry_bucket(uint32_t v)
+{
+   unsigned msb = 0;
+   uint32_t tmp = v;
+
+   if (v < (1 << FRAME_TELEMETRY_LINEAR_BITS))
+      return v;
+
+   if (tmp >= (1U << 16)) { tmp >>= 16; msb += 16; }
+   if (tmp >= (1U << 8))  { tmp >>= 8;  msb += 8;  }
+   if (tmp >= (1U << 4))  { tmp >>= 4;  msb += 4;  }
+   if (tmp >= (1U << 2))  { tmp >>= 2;  msb += 2;  }
+   if (tmp >= (1U << 1))  {             msb += 1;  }
+
+   return (1 << FRAME_TELEMETRY_LINEAR_BITS)
+      + ((msb - FRAME_TELEMETRY_LINEAR_BITS) << FRAME_TELEMETRY_SUB_BITS)
+      + ((v >> (msb - FRAME_TELEMETRY_SUB_BITS))
+            & ((1 << FRAME_TELEMETRY_SUB_BITS) - 1));
+}
+
+/* Returns the midpoint of the values held by 'bucket' */
+static uint32_t frame_telemetry_bucket_value(unsigned bucket)
+{
+   unsigned k, shift;
+   uint32_t low;
+
+   if (bucket < (1 << FRAME_TELEMETRY_LINEAR_BITS))
+      return bucket;
+
+   k     = bucket - (1 << FRAME_TELEMETRY_LINEAR_BITS);
+   shift = (k >> FRAME_TELEMETRY_SUB_BITS)
+      + FRAME_TELEMETRY_LINEAR_BITS - FRAME_TELEMETRY_SUB_BITS;
+   low   = ((1U << FRAME_TELEMETRY_SUB_BITS)
+         + (k & ((1 << FRAME_TELEMETRY_SUB_BITS) - 1))) << shift;
+
+   return low + ((1U << shift) >> 1);
+}
+
+void frame_telemetry_reset(void)
+{
+   memset(&frame_telemetry_st, 0, sizeof(frame_telemetry_st));
+   frame_telemetry_st.frame_interval = -1;
+}
+
+void frame_telemetry_iterate(void)
+{
+   frame_telemetry_state_t *st = &frame_telemetry_st;
+   retro_time_t now            = cpu_features_get_time_usec();
+
+   if (st->committed)
+      st->frame_interval = now - st->frame_start;
+   else
+   {
+      memset(st->accum, 0, sizeof(st->accum));
+      st->frame_interval = -1;
+   }
+
+   st->frame_start     = now;
+   st->committed       = false;
+}
+
+void frame_telemetry_end(enum frame_telemetry_stage stage,
+      retro_time_t start)
+{
+   frame_telemetry_st.accum[stage] += cpu_features_get_time_usec() - start;
+}
+
+void frame_telemetry_commit(retro_time_t target_usec)
+{
+   unsigned i;
+   frame_telemetry_record_t *rec;
+   frame_telemetry_state_t *st = &frame_telemetry_st;
+   bool first_frame            = st->frame_interval < 0;
+
+   st->committed               = true;
+
+   /* The first frame after a discontinuity has no
+    * interval to compare against - drop it */
+   if (first_frame)
+   {
+      memset(st->accum, 0, sizeof(st->accum));
+      return;
+   }
+
+   st->accum[FRAME_TELEMETRY_FRAME] = st->frame_interval;
+
+   rec = &st->ring[st->frames & (FRAME_TELEMETRY_WINDOW - 1)];
+
+   /* Evict oldest record from the window */
+   if (st->frames >= FRAME_TELEMETRY_WINDOW)
+   {
+      for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST; i++)
+         st->histogram[i][frame_telemetry_bucket(rec->usec[i])]--;
+      if (rec->stutter)
+         st->stutters--;
+   }
+
+   for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST; i++)
+   {
+      retro_time_t usec = st->accum[i];
+
+      if (usec < 0)
+         usec = 0;
+      else if (usec > 0xFFFFFFFF)
+         usec = 0xFFFFFFFF;
+
+      rec->usec[i]  = (uint32_t)usec;
+      st->total[i] += rec->usec[i];
+      st->histogram[i][frame_telemetry_bucket(rec->usec[i])]++;
+   }
+
+   rec->stutter = target_usec > 0 &&
+      st->frame_interval > target_usec * FRAME_TELEMETRY_STUTTER_RATIO;
+   if (rec->stutter)
+   {
+      st->stutters++;
+      st->stutters_total++;
+   }
+
+   st->frames++;
+   memset(st->accum, 0, sizeof(st->accum));
+}
+
+bool frame_telemetry_get_stats(frame_telemetry_stats_t *stats)
+{
+   unsigned i;
+   frame_telemetry_state_t *st = &frame_telemetry_st;
+   unsigned samples            = (st->frames < FRAME_TELEMETRY_WINDOW)
+      ? (unsigned)st->frames
+      : FRAME_TELEMETRY_WINDOW;
+   /* Ranks of the requested percentiles (rounded up) */
+   unsigned rank_p50           = (samples * 50 + 99) / 100;
+   unsigned rank_p95           = (samples * 95 + 99) / 100;
+   unsigned rank_p99           = (samples * 99 + 99) / 100;
+
+   memset(stats, 0, sizeof(*stats));
+
+   if (!samples)
+      return false;
+
+   stats->frames         = st->frames;
+   stats->stutters_total = st->stutters_total;
+   stats->samples        = samples;
+   stats->stutters       = st->stutters;
+   memcpy(stats->total, st->total, sizeof(stats->total));
+
+   for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST; i++)
+   {
+      unsigned j;
+      unsigned count                    = 0;
+      const uint16_t *histogram         = st->histogram[i];
+      frame_telemetry_percentiles_t *pc = &stats->stage[i];
+
+      for (j = 0; j < FRAME_TELEMETRY_BUCKETS; j++)
+      {
+         unsigned prev;
+         uint32_t value;
+
+         if (!histogram[j])
+            continue;
+
+         prev   = count;
+         count += histogram[j];
+         value  = frame_telemetry_bucket_value(j);
+
+         if (prev < rank_p50 && count >= rank_p50)
+            pc->p50 = value;
+         if (prev < rank_p95 && count >= rank_p95)
+            pc->p95 = value;
+         if (prev < rank_p99 && count >= rank_p99)
+            pc->p99 = value;
+         pc->max = value;
+      }
+   }
+
+   return true;
+}
+
+void frame_telemetry_log(void)
+{
+   unsigned i;
+   frame_telemetry_stats_t stats;
+
+   if (!frame_telemetry_get_stats(&stats))
+      return;
+
+   RARCH_LOG("[PERF]: Frame timing (last %u of %u frames, usec):\n",
+         stats.samples, (unsigned)stats.frames);
+
+   for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST; i++)
+   {
+      const frame_telemetry_percentiles_t *pc = &stats.stage[i];
+      RARCH_LOG("[PERF]:    %-10s p50: %7u, p95: %7u, p99: %7u, max: %7u\n",
+            frame_telemetry_stage_names[i],
+            (unsigned)pc->p50, (unsigned)pc->p95,
+            (unsigned)pc->p99, (unsigned)pc->max);
+   }
+
+   RARCH_LOG("[PERF]: Stutters: %u in window, %u total.\n",
+         stats.stutters, (unsigned)stats.stutters_total);
+}
+
+const char *frame_telemetry_stage_name(enum frame_telemetry_stage stage)
+{
+   if (stage >= FRAME_TELEMETRY_STAGE_LAST)
+      return NULL;
+   return frame_telemetry_stage_names[stage];
+}
+
+bool frame_telemetry_export_csv(const char *path)
+{
+   unsigned i;
+   uint64_t n;
+   RFILE *file                 = NULL;
+   frame_telemetry_state_t *st = &frame_telemetry_st;
+   uint64_t first              = (st->frames > FRAME_TELEMETRY_WINDOW)
+      ? st->frames - FRAME_TELEMETRY_WINDOW
+      : 0;
+
+   if (string_is_empty(path))
+      return false;
+
+   if (!(file = filestream_open(path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   filestream_printf(file, "index");
+   for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST; i++)
+      filestream_printf(file, ",%s_usec", frame_telemetry_stage_names[i]);
+   filestream_printf(file, ",stutter\n");
+
+   for (n = first; n < st->frames; n++)
+   {
+      const frame_telemetry_record_t *rec =
+         &st->ring[n & (FRAME_TELEMETRY_WINDOW - 1)];
+
+      filestream_printf(file, "%u", (unsigned)n);
+      for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST; i++)
+         filestream_printf(file, ",%u", (unsigned)rec->usec[i]);
+      filestream_printf(file, ",%d\n", rec->stutter ? 1 : 0);
+   }
+
+   filestream_close(file);
+   return true;
+}
@@ -0,0 +1,143 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FRAME_TELEMETRY_H
+#define _FRAME_TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+#include <features/features_cpu.h>
+
+RETRO_BEGIN_DECLS
+
+/* Number of frames held by the sliding window
+ * (must be a power of two, and no more than 65535) */
+#define FRAME_TELEMETRY_WINDOW 1024
+
+/* Frame intervals longer than the target frame
+ * time multiplied by this factor count as stutters */
+#define FRAME_TELEMETRY_STUTTER_RATIO 1.5f
+
+enum frame_telemetry_stage
+{
+   /* Interval between the starts of consecutive frames */
+   FRAME_TELEMETRY_FRAME = 0,
+   /* Time spent running the core (includes the
+    * video, audio and input stages below, and
+    * the whole of run-ahead when it is active) */
+   FRAME_TELEMETRY_CORE_RUN,
+   FRAME_TELEMETRY_VIDEO,
+   FRAME_TELEMETRY_AUDIO,
+   FRAME_TELEMETRY_INPUT,
+   FRAME_TELEMETRY_RUNAHEAD,
+   /* Includes the serialization of rewind states */
+   FRAME_TELEMETRY_REWIND,
+   /* Time spent in retro_serialize(), whichever
+    * feature asked for the state */
+   FRAME_TELEMETRY_SERIALIZE,
+   /* Audio resampling (part of the audio stage) */
+   FRAME_TELEMETRY_RESAMPLE,
+   /* Pixel format conversion and software filtering
+    * (part of the video stage) */
+   FRAME_TELEMETRY_CONVERT,
+
+   FRAME_TELEMETRY_STAGE_LAST
+};
+
+typedef struct
+{
+   /* All values in usec */
+   uint32_t p50;
+   uint32_t p95;
+   uint32_t p99;
+   uint32_t max;
+} frame_telemetry_percentiles_t;
+
+typedef struct
+{
+   frame_telemetry_percentiles_t stage[FRAME_TELEMETRY_STAGE_LAST];
+   /* Time spent in each stage over all frames
+    * recorded since the last reset, in usec */
+   uint64_t total[FRAME_TELEMETRY_STAGE_LAST];
+   /* Total number of frames recorded */
+   uint64_t frames;
+   /* Total number of stutters recorded */
+   uint64_t stutters_total;
+   /* Number of frames currently in the window */
+   unsigned samples;
+   /* Number of stutters currently in the window */
+   unsigned stutters;
+} frame_telemetry_stats_t;
+
+/* Frame telemetry
+ * Records the time spent in each stage of every
+ * frame run by the core into a fixed size ring.
+ * A log-bucketed histogram is kept in step with
+ * the ring, so that sliding window percentiles
+ * can be read at any time in constant time, without
+ * sorting. Recording and reading must both happen
+ * on the main thread; the ring has a single writer
+ * and takes no locks. */
+
+/* Discards all recorded frames */
+void frame_telemetry_reset(void);
+
+/* Must be called at the start of each runloop
+ * iteration. Stage time accumulated during an
+ * iteration that did not end in
+ * frame_telemetry_commit() (e.g. while the menu
+ * is open or the core is paused) is discarded,
+ * and the following frame does not contribute
+ * a frame interval. */
+void frame_telemetry_iterate(void);
+
+/* Returns a timestamp to be passed to frame_telemetry_end() */
+#define frame_telemetry_begin() cpu_features_get_time_usec()
+
+/* Adds the time elapsed since 'start' to 'stage'
+ * of the current frame. May be called more than
+ * once per frame for the same stage. */
+void frame_telemetry_end(enum frame_telemetry_stage stage,
+      retro_time_t start);
+
+/* Ends the current frame and pushes it into the ring.
+ * 'target_usec' is the expected frame interval, used
+ * for stutter detection (0 disables detection for
+ * this frame). */
+void frame_telemetry_commit(retro_time_t target_usec);
+
+/* Fills 'stats' with the current sliding window
+ * statistics. Returns false if no frame has been
+ * recorded yet. */
+bool frame_telemetry_get_stats(frame_telemetry_stats_t *stats);
+
+/* Prints the current sliding window statistics to the log */
+void frame_telemetry_log(void);
+
+/* Returns short, lowercase identifier of 'stage' */
+const char *frame_telemetry_stage_name(enum frame_telemetry_stage stage);
+
+/* Writes all frames in the window to 'path' as CSV,
+ * oldest first (one row per frame, one column per
+ * stage, in usec). Returns false on failure. */
+bool frame_telemetry_export_csv(const char *path);
+
+RETRO_END_DECLS
+
+#endif
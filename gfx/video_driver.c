@@ -44,6 +44,10 @@
 #include "../menu/menu_driver.h"
 #endif
 
+#ifdef HAVE_INPUT_THREAD
+#include "../input/common/input_thread.h"
+#endif
+
 #ifdef _WIN32
 #include "common/win32_common.h"
 #endif
@@ -54,6 +58,7 @@
 #include "../ui/ui_companion_driver.h"
 #include "../driver.h"
 #include "../file_path_special.h"
+#include "../frame_telemetry.h"
 #include "../list_special.h"
 #include "../retroarch.h"
 #include "../verbosity.h"
@@ -3613,6 +3618,7 @@ void video_driver_frame(const void *data, unsigned width,
    {
       data                = video_st->scaler_ptr->scaler_out;
       pitch               = video_st->scaler_ptr->scaler->out_stride;
+      frame_telemetry_end(FRAME_TELEMETRY_CONVERT, new_time);
    }
 
    video_driver_build_info(&video_info);
@@ -3777,15 +3783,18 @@ void video_driver_frame(const void *data, unsigned width,
       unsigned output_width                             = 0;
       unsigned output_height                            = 0;
       unsigned output_pitch                             = 0;
+      retro_time_t filter_start;
 
       rarch_softfilter_get_output_size(video_st->state_filter,
             &output_width, &output_height, width, height);
 
       output_pitch = (output_width) * video_st->state_out_bpp;
 
+      filter_start = frame_telemetry_begin();
       rarch_softfilter_process(video_st->state_filter,
             video_st->state_buffer, output_pitch,
             data, width, height, pitch);
+      frame_telemetry_end(FRAME_TELEMETRY_CONVERT, filter_start);
 
       if (video_info.post_filter_record
             && recording_st->data
@@ -3917,6 +3926,44 @@ void video_driver_frame(const void *data, unsigned width,
             av_info->timing.fps,
             av_info->timing.sample_rate);
 
+      {
+         frame_telemetry_stats_t frame_stats;
+
+         if (frame_telemetry_get_stats(&frame_stats))
+         {
+            unsigned i;
+            char line[128];
+
+            strlcat(video_info.stat_text,
+                  "Frame Pacing (p50/p95/p99 ms):\n",
+                  sizeof(video_info.stat_text));
+
+            for (i = 0; i < FRAME_TELEMETRY_STAGE_LAST; i++)
+            {
+               const frame_telemetry_percentiles_t *pc = &frame_stats.stage[i];
+
+               /* Skip stages that are not in use
+                * (e.g. run-ahead, rewind) */
+               if (!pc->max)
+                  continue;
+
+               snprintf(line, sizeof(line),
+                     " -%s: %.2f / %.2f / %.2f\n",
+                     frame_telemetry_stage_name((enum frame_telemetry_stage)i),
+                     pc->p50 / 1000.0f,
+                     pc->p95 / 1000.0f,
+                     pc->p99 / 1000.0f);
+               strlcat(video_info.stat_text, line,
+                     sizeof(video_info.stat_text));
+            }
+
+            snprintf(line, sizeof(line),
+                  " -Stutters: %u in last %u frames\n",
+                  frame_stats.stutters, frame_stats.samples);
+            strlcat(video_info.stat_text, line, sizeof(video_info.stat_text));
+         }
+      }
+
       /* TODO/FIXME - add OSD chat text here */
    }
 
@@ -3927,6 +3974,10 @@ void video_driver_frame(const void *data, unsigned width,
             video_info.menu_screensaver_active || video_info.notifications_hidden ? "" : video_driver_msg,
             &video_info);
 
+#ifdef HAVE_INPUT_THREAD
+   input_thread_note_present();
+#endif
+
    video_st->frame_count++;
 
    /* Display the status text, with a higher priority. */
@@ -3994,6 +4045,8 @@ void video_driver_frame(const void *data, unsigned width,
    else if (!video_info.crt_switch_resolution)
 #endif
       video_st->crt_switching_active = false;
+
+   frame_telemetry_end(FRAME_TELEMETRY_VIDEO, new_time);
 }
 
 static void video_driver_reinit_context(settings_t *settings, int flags)
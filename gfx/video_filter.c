@@ -60,49 +60,273 @@ struct rarch_softfilter
    unsigned threads;
 
 #ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
+   struct softfilter_pool *pool;
 #endif
 };
 
 #ifdef HAVE_THREADS
+#include <retro_atomic.h>
 #include <rthreads/rthreads.h>
 
-struct filter_thread_data
+/* Work packets are claimed through an atomic counter, so that
+ * threads only need to take the pool lock to go to sleep and
+ * wake up, once per frame. */
+#ifdef RETRO_ATOMIC_LOCK_FREE
+#define SOFTFILTER_POOL_LOCKFREE
+#define softfilter_atomic_fetch_inc(p) retro_atomic_fetch_add((p), 1)
+#define softfilter_atomic_dec(p)       (retro_atomic_fetch_add((p), -1) - 1)
+#endif
+
+/* Maximum number of worker threads in the pool.
+ * The thread running a frame works alongside them */
+#define SOFTFILTER_POOL_MAX_WORKERS 15
+
+/* Frame-level worker pool, shared by all softfilter instances */
+struct softfilter_pool
 {
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
+   sthread_t *workers[SOFTFILTER_POOL_MAX_WORKERS];
+   /* Serializes frames of concurrent softfilter instances */
+   slock_t *run_lock;
    slock_t *lock;
+   /* Signalled when a frame is posted */
+   scond_t *cond_work;
+   /* Signalled when the last packet of a frame is done,
+    * and when the last worker leaves a frame */
+   scond_t *cond_done;
+
+   const struct softfilter_work_packet *packets;
    void *userdata;
+
+   /* Next packet to claim */
+   retro_atomic_uint_t next;
+   /* Packets of the current frame not done yet */
+   retro_atomic_uint_t remaining;
+   /* Workers that have joined the current frame
+    * and may still try to claim a packet */
+   retro_atomic_uint_t active;
+   retro_atomic_uint_t count;
+#ifndef SOFTFILTER_POOL_LOCKFREE
+   slock_t *atomic_lock;
+#endif
+
+   unsigned num_workers;
+   unsigned frame;
+   unsigned refs;
    bool die;
-   bool done;
 };
 
-static void filter_thread_loop(void *data)
+static struct softfilter_pool *softfilter_pool_st = NULL;
+
+#ifndef SOFTFILTER_POOL_LOCKFREE
+static retro_atomic_uint_t softfilter_atomic_fetch_inc_locked(
+      struct softfilter_pool *pool, retro_atomic_uint_t *p)
+{
+   retro_atomic_uint_t ret;
+   slock_lock(pool->atomic_lock);
+   ret = (*p)++;
+   slock_unlock(pool->atomic_lock);
+   return ret;
+}
+
+static retro_atomic_uint_t softfilter_atomic_dec_locked(
+      struct softfilter_pool *pool, retro_atomic_uint_t *p)
+{
+   retro_atomic_uint_t ret;
+   slock_lock(pool->atomic_lock);
+   ret = --(*p);
+   slock_unlock(pool->atomic_lock);
+   return ret;
+}
+
+#define softfilter_atomic_fetch_inc(p) softfilter_atomic_fetch_inc_locked(pool, (p))
+#define softfilter_atomic_dec(p)       softfilter_atomic_dec_locked(pool, (p))
+#endif
+
+/* Claims and runs packets of the current frame until none are left */
+static void softfilter_pool_work(struct softfilter_pool *pool)
+{
+   for (;;)
+   {
+      const struct softfilter_work_packet *packet;
+      int i = (int)softfilter_atomic_fetch_inc(&pool->next);
+
+      if (i >= (int)pool->count)
+         break;
+
+      packet = &pool->packets[i];
+      if (packet->work)
+         packet->work(pool->userdata, packet->thread_data);
+
+      if (softfilter_atomic_dec(&pool->remaining) == 0)
+      {
+         slock_lock(pool->lock);
+         scond_signal(pool->cond_done);
+         slock_unlock(pool->lock);
+      }
+   }
+}
+
+static void softfilter_pool_worker(void *data)
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   struct softfilter_pool *pool = (struct softfilter_pool*)data;
+   unsigned frame               = 0;
 
    for (;;)
    {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
+      slock_lock(pool->lock);
+      while (pool->frame == frame && !pool->die)
+         scond_wait(pool->cond_work, pool->lock);
+      if (pool->die)
+      {
+         slock_unlock(pool->lock);
          break;
+      }
+      frame = pool->frame;
+      softfilter_atomic_fetch_inc(&pool->active);
+      slock_unlock(pool->lock);
 
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
+      softfilter_pool_work(pool);
 
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
+      if (softfilter_atomic_dec(&pool->active) == 0)
+      {
+         slock_lock(pool->lock);
+         scond_signal(pool->cond_done);
+         slock_unlock(pool->lock);
+      }
    }
 }
+
+static void softfilter_pool_free(struct softfilter_pool *pool)
+{
+   unsigned i;
+
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->die = true;
+      if (pool->cond_work)
+         scond_broadcast(pool->cond_work);
+      slock_unlock(pool->lock);
+   }
+
+   for (i = 0; i < pool->num_workers; i++)
+      sthread_join(pool->workers[i]);
+
+   if (pool->cond_work)
+      scond_free(pool->cond_work);
+   if (pool->cond_done)
+      scond_free(pool->cond_done);
+   if (pool->lock)
+      slock_free(pool->lock);
+   if (pool->run_lock)
+      slock_free(pool->run_lock);
+#ifndef SOFTFILTER_POOL_LOCKFREE
+   if (pool->atomic_lock)
+      slock_free(pool->atomic_lock);
+#endif
+   free(pool);
+}
+
+/* Returns a reference to the shared pool, creating it on first use */
+static struct softfilter_pool *softfilter_pool_ref(void)
+{
+   unsigned i, num_workers;
+   struct softfilter_pool *pool = softfilter_pool_st;
+
+   if (pool)
+   {
+      pool->refs++;
+      return pool;
+   }
+
+   num_workers = cpu_features_get_core_amount();
+   num_workers = (num_workers > 1) ? num_workers - 1 : 1;
+   if (num_workers > SOFTFILTER_POOL_MAX_WORKERS)
+      num_workers = SOFTFILTER_POOL_MAX_WORKERS;
+
+   if (!(pool = (struct softfilter_pool*)calloc(1, sizeof(*pool))))
+      return NULL;
+
+   pool->run_lock  = slock_new();
+   pool->lock      = slock_new();
+   pool->cond_work = scond_new();
+   pool->cond_done = scond_new();
+#ifndef SOFTFILTER_POOL_LOCKFREE
+   if (!(pool->atomic_lock = slock_new()))
+   {
+      softfilter_pool_free(pool);
+      return NULL;
+   }
+#endif
+
+   if (     !pool->run_lock || !pool->lock
+         || !pool->cond_work || !pool->cond_done)
+   {
+      softfilter_pool_free(pool);
+      return NULL;
+   }
+
+   for (i = 0; i < num_workers; i++)
+   {
+      if (!(pool->workers[i] = sthread_create(
+                  softfilter_pool_worker, pool)))
+         break;
+      pool->num_workers++;
+   }
+
+   if (!pool->num_workers)
+   {
+      softfilter_pool_free(pool);
+      return NULL;
+   }
+
+   RARCH_LOG("[SoftFilter]: Started worker pool with %u threads.\n",
+         pool->num_workers);
+
+   pool->refs         = 1;
+   softfilter_pool_st = pool;
+   return pool;
+}
+
+static void softfilter_pool_unref(struct softfilter_pool *pool)
+{
+   if (--pool->refs)
+      return;
+   softfilter_pool_free(pool);
+   softfilter_pool_st = NULL;
+}
+
+/* Runs all packets of a frame, on the calling thread
+ * and the pool's workers, and waits for them */
+static void softfilter_pool_run(struct softfilter_pool *pool,
+      void *userdata, const struct softfilter_work_packet *packets,
+      unsigned count)
+{
+   slock_lock(pool->run_lock);
+
+   slock_lock(pool->lock);
+   /* Workers that joined the previous frame late may
+    * still be about to fail to claim a packet */
+   while (retro_atomic_load(&pool->active))
+      scond_wait(pool->cond_done, pool->lock);
+   pool->packets   = packets;
+   pool->userdata  = userdata;
+   pool->count     = (retro_atomic_uint_t)count;
+   pool->remaining = (retro_atomic_uint_t)count;
+   pool->next      = 0;
+   pool->frame++;
+   scond_broadcast(pool->cond_work);
+   slock_unlock(pool->lock);
+
+   softfilter_pool_work(pool);
+
+   slock_lock(pool->lock);
+   while (retro_atomic_load(&pool->remaining))
+      scond_wait(pool->cond_done, pool->lock);
+   slock_unlock(pool->lock);
+
+   slock_unlock(pool->run_lock);
+}
 #endif
 
 static const struct softfilter_implementation *
@@ -238,30 +462,9 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    }
 
 #ifdef HAVE_THREADS
+   /* Without a pool, packets simply run one after another */
    if (filt->threads > 1)
-   {
-      filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data));
-      if (!filt->thread_data)
-         return false;
-
-      for (i = 0; i < threads; i++)
-      {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done     = true;
-
-         filt->thread_data[i].lock     = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond     = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread   = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
-      }
-   }
+      filt->pool = softfilter_pool_ref();
 #endif
 
    return true;
@@ -501,24 +704,8 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
 #endif
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!&filt->thread_data[i])
-            continue;
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
+   if (filt->pool)
+      softfilter_pool_unref(filt->pool);
 #endif
 
    if (filt->conf)
@@ -564,32 +751,10 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
             output, output_stride, input, width, height, input_stride);
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   if (filt->pool)
    {
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
-      }
+      softfilter_pool_run(filt->pool, filt->impl_data,
+            filt->packets, filt->threads);
       return;
    }
 #endif
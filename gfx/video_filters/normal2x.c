@@ -17,6 +17,7 @@
 /* Compile: gcc -o normal2x.so -shared normal2x.c -std=c99 -O3 -Wall -pedantic -fPIC */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -39,13 +40,148 @@ struct softfilter_thread_data
    int last;
 };
 
+typedef void (*normal2x_row_xrgb8888_t)(uint32_t *out0, uint32_t *out1,
+      const uint32_t *in, unsigned width);
+typedef void (*normal2x_row_rgb565_t)(uint16_t *out0, uint16_t *out1,
+      const uint16_t *in, unsigned width);
+
 struct filter_data
 {
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   normal2x_row_xrgb8888_t row_xrgb8888;
+   normal2x_row_rgb565_t row_rgb565;
 };
 
+/* Scalar implementation, processes source pixels [x, width)
+ * of a line. Also used for the tails of the SIMD rows */
+static void normal2x_span_xrgb8888(uint32_t *out0, uint32_t *out1,
+      const uint32_t *in, unsigned x, unsigned width)
+{
+   for (; x < width; x++)
+   {
+      uint32_t color = in[x];
+      uint32_t row_color[2];
+
+      row_color[0] = color;
+      row_color[1] = color;
+
+      /* Row 1 */
+      memcpy(out0 + (x << 1), row_color, sizeof(row_color));
+      /* Row 2 */
+      memcpy(out1 + (x << 1), row_color, sizeof(row_color));
+   }
+}
+
+static void normal2x_span_rgb565(uint16_t *out0, uint16_t *out1,
+      const uint16_t *in, unsigned x, unsigned width)
+{
+   for (; x < width; x++)
+   {
+      uint16_t color = in[x];
+      uint16_t row_color[2];
+
+      row_color[0] = color;
+      row_color[1] = color;
+
+      /* Row 1 */
+      memcpy(out0 + (x << 1), row_color, sizeof(row_color));
+      /* Row 2 */
+      memcpy(out1 + (x << 1), row_color, sizeof(row_color));
+   }
+}
+
+static void normal2x_row_xrgb8888(uint32_t *out0, uint32_t *out1,
+      const uint32_t *in, unsigned width)
+{
+   normal2x_span_xrgb8888(out0, out1, in, 0, width);
+}
+
+static void normal2x_row_rgb565(uint16_t *out0, uint16_t *out1,
+      const uint16_t *in, unsigned width)
+{
+   normal2x_span_rgb565(out0, out1, in, 0, width);
+}
+
+#ifdef SOFTFILTER_HAVE_SSE2
+static SOFTFILTER_TARGET_SSE2 void normal2x_row_xrgb8888_sse2(
+      uint32_t *out0, uint32_t *out1, const uint32_t *in, unsigned width)
+{
+   unsigned x = 0;
+
+   for (; x + 4 <= width; x += 4)
+   {
+      __m128i v  = _mm_loadu_si128((const __m128i*)(in + x));
+      __m128i lo = _mm_unpacklo_epi32(v, v);
+      __m128i hi = _mm_unpackhi_epi32(v, v);
+
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1)),     lo);
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 4), hi);
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)),     lo);
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 4), hi);
+   }
+
+   normal2x_span_xrgb8888(out0, out1, in, x, width);
+}
+
+static SOFTFILTER_TARGET_SSE2 void normal2x_row_rgb565_sse2(
+      uint16_t *out0, uint16_t *out1, const uint16_t *in, unsigned width)
+{
+   unsigned x = 0;
+
+   for (; x + 8 <= width; x += 8)
+   {
+      __m128i v  = _mm_loadu_si128((const __m128i*)(in + x));
+      __m128i lo = _mm_unpacklo_epi16(v, v);
+      __m128i hi = _mm_unpackhi_epi16(v, v);
+
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1)),     lo);
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 8), hi);
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)),     lo);
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 8), hi);
+   }
+
+   normal2x_span_rgb565(out0, out1, in, x, width);
+}
+#endif
+
+#ifdef SOFTFILTER_HAVE_NEON
+static void normal2x_row_xrgb8888_neon(uint32_t *out0, uint32_t *out1,
+      const uint32_t *in, unsigned width)
+{
+   unsigned x = 0;
+
+   for (; x + 4 <= width; x += 4)
+   {
+      uint32x4x2_t row;
+      row.val[0] = vld1q_u32(in + x);
+      row.val[1] = row.val[0];
+      vst2q_u32(out0 + (x << 1), row);
+      vst2q_u32(out1 + (x << 1), row);
+   }
+
+   normal2x_span_xrgb8888(out0, out1, in, x, width);
+}
+
+static void normal2x_row_rgb565_neon(uint16_t *out0, uint16_t *out1,
+      const uint16_t *in, unsigned width)
+{
+   unsigned x = 0;
+
+   for (; x + 8 <= width; x += 8)
+   {
+      uint16x8x2_t row;
+      row.val[0] = vld1q_u16(in + x);
+      row.val[1] = row.val[0];
+      vst2q_u16(out0 + (x << 1), row);
+      vst2q_u16(out1 + (x << 1), row);
+   }
+
+   normal2x_span_rgb565(out0, out1, in, x, width);
+}
+#endif
+
 static unsigned normal2x_generic_input_fmts(void)
 {
    return SOFTFILTER_FMT_XRGB8888 | SOFTFILTER_FMT_RGB565;
@@ -68,22 +204,38 @@ static void *normal2x_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
 
-   if (!filt) {
+   if (!filt)
       return NULL;
-   }
-   /* Apparently the code is not thread-safe,
-    * so force single threaded operation... */
-   filt->workers = (struct softfilter_thread_data*)calloc(1, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->workers = (struct softfilter_thread_data*)
+      calloc(threads, sizeof(struct softfilter_thread_data));
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
-   if (!filt->workers) {
+   if (!filt->workers)
+   {
       free(filt);
       return NULL;
    }
+
+   filt->row_xrgb8888 = normal2x_row_xrgb8888;
+   filt->row_rgb565   = normal2x_row_rgb565;
+#ifdef SOFTFILTER_HAVE_SSE2
+   if (simd & SOFTFILTER_SIMD_SSE2)
+   {
+      filt->row_xrgb8888 = normal2x_row_xrgb8888_sse2;
+      filt->row_rgb565   = normal2x_row_rgb565_sse2;
+   }
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+   if (simd & SOFTFILTER_SIMD_NEON)
+   {
+      filt->row_xrgb8888 = normal2x_row_xrgb8888_neon;
+      filt->row_rgb565   = normal2x_row_rgb565_neon;
+   }
+#endif
+
    return filt;
 }
 
@@ -107,34 +259,17 @@ static void normal2x_generic_destroy(void *data)
 
 static void normal2x_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt           = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    const uint32_t *input              = (const uint32_t*)thr->in_data;
    uint32_t *output                   = (uint32_t*)thr->out_data;
-   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
-   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
-   uint32_t x, y;
+   size_t in_stride                   = thr->in_pitch >> 2;
+   size_t out_stride                  = thr->out_pitch >> 2;
+   unsigned y;
 
    for (y = 0; y < thr->height; ++y)
    {
-      uint32_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
-      {
-         uint32_t *out_line_ptr = out_ptr;
-         uint32_t color         = *(input + x);
-         uint32_t row_color[2];
-
-         row_color[0] = color;
-         row_color[1] = color;
-
-         /* Row 1 */
-         memcpy(out_line_ptr, row_color, sizeof(row_color));
-         out_line_ptr += out_stride;
-
-         /* Row 2 */
-         memcpy(out_line_ptr, row_color, sizeof(row_color));
-
-         out_ptr += 2;
-      }
+      filt->row_xrgb8888(output, output + out_stride, input, thr->width);
 
       input  += in_stride;
       output += out_stride << 1;
@@ -143,34 +278,17 @@ static void normal2x_work_cb_xrgb8888(void *data, void *thread_data)
 
 static void normal2x_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt           = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    const uint16_t *input              = (const uint16_t*)thr->in_data;
    uint16_t *output                   = (uint16_t*)thr->out_data;
-   uint16_t in_stride                 = (uint16_t)(thr->in_pitch >> 1);
-   uint16_t out_stride                = (uint16_t)(thr->out_pitch >> 1);
-   uint16_t x, y;
+   size_t in_stride                   = thr->in_pitch >> 1;
+   size_t out_stride                  = thr->out_pitch >> 1;
+   unsigned y;
 
    for (y = 0; y < thr->height; ++y)
    {
-      uint16_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
-      {
-         uint16_t *out_line_ptr = out_ptr;
-         uint16_t color         = *(input + x);
-         uint16_t row_color[2];
-
-         row_color[0] = color;
-         row_color[1] = color;
-
-         /* Row 1 */
-         memcpy(out_line_ptr, row_color, sizeof(row_color));
-         out_line_ptr += out_stride;
-
-         /* Row 2 */
-         memcpy(out_line_ptr, row_color, sizeof(row_color));
-
-         out_ptr += 2;
-      }
+      filt->row_rgb565(output, output + out_stride, input, thr->width);
 
       input  += in_stride;
       output += out_stride << 1;
@@ -182,27 +300,29 @@ static void normal2x_generic_packets(void *data,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height, size_t input_stride)
 {
-   /* We are guaranteed single threaded operation
-    * (filt->threads = 1) so we don't need to loop
-    * over threads and can cull some code. This only
-    * makes the tiniest performance difference, but
-    * every little helps when running on an o3DS... */
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)data;
-   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)&filt->workers[0];
-
-   thr->out_data = (uint8_t*)output;
-   thr->in_data = (const uint8_t*)input;
-   thr->out_pitch = output_stride;
-   thr->in_pitch = input_stride;
-   thr->width = width;
-   thr->height = height;
-
-   if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
-      packets[0].work = normal2x_work_cb_xrgb8888;
-   } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
-      packets[0].work = normal2x_work_cb_rgb565;
+
+   for (i = 0; i < filt->threads; i++)
+   {
+      struct softfilter_thread_data *thr =
+         (struct softfilter_thread_data*)&filt->workers[i];
+      unsigned y_start = (height * i) / filt->threads;
+      unsigned y_end   = (height * (i + 1)) / filt->threads;
+
+      thr->out_data  = (uint8_t*)output + y_start * (output_stride << 1);
+      thr->in_data   = (const uint8_t*)input + y_start * input_stride;
+      thr->out_pitch = output_stride;
+      thr->in_pitch  = input_stride;
+      thr->width     = width;
+      thr->height    = y_end - y_start;
+
+      if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
+         packets[i].work = normal2x_work_cb_xrgb8888;
+      else if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
+         packets[i].work = normal2x_work_cb_rgb565;
+      packets[i].thread_data = thr;
    }
-   packets[0].thread_data = thr;
 }
 
 static const struct softfilter_implementation normal2x_generic = {
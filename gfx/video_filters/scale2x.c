@@ -17,6 +17,7 @@
 /* Compile: gcc -o scale2x.so -shared scale2x.c -std=c99 -O3 -Wall -pedantic -fPIC */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -39,13 +40,255 @@ struct softfilter_thread_data
    int last;
 };
 
+typedef void (*scale2x_row_xrgb8888_t)(uint32_t *out0, uint32_t *out1,
+      const uint32_t *prev, const uint32_t *cur, const uint32_t *next,
+      unsigned width);
+typedef void (*scale2x_row_rgb565_t)(uint16_t *out0, uint16_t *out1,
+      const uint16_t *prev, const uint16_t *cur, const uint16_t *next,
+      unsigned width);
+
 struct filter_data
 {
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   scale2x_row_xrgb8888_t row_xrgb8888;
+   scale2x_row_rgb565_t row_rgb565;
 };
 
+/* Scalar implementation, processes source pixels [x, x_end)
+ * of a line. Also used for the edges of the SIMD rows */
+static void scale2x_span_xrgb8888(uint32_t *out0, uint32_t *out1,
+      const uint32_t *prev, const uint32_t *cur, const uint32_t *next,
+      unsigned x, unsigned x_end, unsigned width)
+{
+   for (; x < x_end; x++)
+   {
+      /* Get sample points */
+      uint32_t A = prev[x];
+      uint32_t B = (x > 0) ? cur[x - 1] : cur[x];
+      uint32_t C = cur[x];
+      uint32_t D = (x < width - 1) ? cur[x + 1] : cur[x];
+      uint32_t E = next[x];
+
+      /* Apply pixel expansion algorithm */
+      if (A != E && B != D)
+      {
+         out0[(x << 1)    ] = (A == B ? A : C);
+         out0[(x << 1) + 1] = (A == D ? A : C);
+         out1[(x << 1)    ] = (E == B ? E : C);
+         out1[(x << 1) + 1] = (E == D ? E : C);
+      }
+      else
+      {
+         out0[(x << 1)    ] = C;
+         out0[(x << 1) + 1] = C;
+         out1[(x << 1)    ] = C;
+         out1[(x << 1) + 1] = C;
+      }
+   }
+}
+
+static void scale2x_span_rgb565(uint16_t *out0, uint16_t *out1,
+      const uint16_t *prev, const uint16_t *cur, const uint16_t *next,
+      unsigned x, unsigned x_end, unsigned width)
+{
+   for (; x < x_end; x++)
+   {
+      /* Get sample points */
+      uint16_t A = prev[x];
+      uint16_t B = (x > 0) ? cur[x - 1] : cur[x];
+      uint16_t C = cur[x];
+      uint16_t D = (x < width - 1) ? cur[x + 1] : cur[x];
+      uint16_t E = next[x];
+
+      /* Apply pixel expansion algorithm */
+      if (A != E && B != D)
+      {
+         out0[(x << 1)    ] = (A == B ? A : C);
+         out0[(x << 1) + 1] = (A == D ? A : C);
+         out1[(x << 1)    ] = (E == B ? E : C);
+         out1[(x << 1) + 1] = (E == D ? E : C);
+      }
+      else
+      {
+         out0[(x << 1)    ] = C;
+         out0[(x << 1) + 1] = C;
+         out1[(x << 1)    ] = C;
+         out1[(x << 1) + 1] = C;
+      }
+   }
+}
+
+static void scale2x_row_xrgb8888(uint32_t *out0, uint32_t *out1,
+      const uint32_t *prev, const uint32_t *cur, const uint32_t *next,
+      unsigned width)
+{
+   scale2x_span_xrgb8888(out0, out1, prev, cur, next, 0, width, width);
+}
+
+static void scale2x_row_rgb565(uint16_t *out0, uint16_t *out1,
+      const uint16_t *prev, const uint16_t *cur, const uint16_t *next,
+      unsigned width)
+{
+   scale2x_span_rgb565(out0, out1, prev, cur, next, 0, width, width);
+}
+
+/* The SIMD rows handle the first and last pixel of each
+ * line (the only ones with clamped neighbours) with the
+ * scalar code, and everything in between in vectors.
+ *
+ * For each pixel, 'keep' is set where the expansion does
+ * not apply (A == E or B == D); the output is then
+ * A/E where the neighbours match and expansion applies,
+ * C otherwise. */
+
+#ifdef SOFTFILTER_HAVE_SSE2
+#define SCALE2X_SEL_SSE2(mask, a, b) \
+   _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b))
+
+static SOFTFILTER_TARGET_SSE2 void scale2x_row_xrgb8888_sse2(
+      uint32_t *out0, uint32_t *out1,
+      const uint32_t *prev, const uint32_t *cur, const uint32_t *next,
+      unsigned width)
+{
+   unsigned x = 1;
+
+   scale2x_span_xrgb8888(out0, out1, prev, cur, next, 0, 1, width);
+
+   for (; x + 4 < width; x += 4)
+   {
+      __m128i A    = _mm_loadu_si128((const __m128i*)(prev + x));
+      __m128i B    = _mm_loadu_si128((const __m128i*)(cur  + x - 1));
+      __m128i C    = _mm_loadu_si128((const __m128i*)(cur  + x));
+      __m128i D    = _mm_loadu_si128((const __m128i*)(cur  + x + 1));
+      __m128i E    = _mm_loadu_si128((const __m128i*)(next + x));
+      __m128i keep = _mm_or_si128(_mm_cmpeq_epi32(A, E),
+            _mm_cmpeq_epi32(B, D));
+      __m128i e0   = SCALE2X_SEL_SSE2(
+            _mm_andnot_si128(keep, _mm_cmpeq_epi32(A, B)), A, C);
+      __m128i e1   = SCALE2X_SEL_SSE2(
+            _mm_andnot_si128(keep, _mm_cmpeq_epi32(A, D)), A, C);
+      __m128i e2   = SCALE2X_SEL_SSE2(
+            _mm_andnot_si128(keep, _mm_cmpeq_epi32(E, B)), E, C);
+      __m128i e3   = SCALE2X_SEL_SSE2(
+            _mm_andnot_si128(keep, _mm_cmpeq_epi32(E, D)), E, C);
+
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1)),
+            _mm_unpacklo_epi32(e0, e1));
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 4),
+            _mm_unpackhi_epi32(e0, e1));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)),
+            _mm_unpacklo_epi32(e2, e3));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 4),
+            _mm_unpackhi_epi32(e2, e3));
+   }
+
+   scale2x_span_xrgb8888(out0, out1, prev, cur, next, x, width, width);
+}
+
+static SOFTFILTER_TARGET_SSE2 void scale2x_row_rgb565_sse2(
+      uint16_t *out0, uint16_t *out1,
+      const uint16_t *prev, const uint16_t *cur, const uint16_t *next,
+      unsigned width)
+{
+   unsigned x = 1;
+
+   scale2x_span_rgb565(out0, out1, prev, cur, next, 0, 1, width);
+
+   for (; x + 8 < width; x += 8)
+   {
+      __m128i A    = _mm_loadu_si128((const __m128i*)(prev + x));
+      __m128i B    = _mm_loadu_si128((const __m128i*)(cur  + x - 1));
+      __m128i C    = _mm_loadu_si128((const __m128i*)(cur  + x));
+      __m128i D    = _mm_loadu_si128((const __m128i*)(cur  + x + 1));
+      __m128i E    = _mm_loadu_si128((const __m128i*)(next + x));
+      __m128i keep = _mm_or_si128(_mm_cmpeq_epi16(A, E),
+            _mm_cmpeq_epi16(B, D));
+      __m128i e0   = SCALE2X_SEL_SSE2(
+            _mm_andnot_si128(keep, _mm_cmpeq_epi16(A, B)), A, C);
+      __m128i e1   = SCALE2X_SEL_SSE2(
+            _mm_andnot_si128(keep, _mm_cmpeq_epi16(A, D)), A, C);
+      __m128i e2   = SCALE2X_SEL_SSE2(
+            _mm_andnot_si128(keep, _mm_cmpeq_epi16(E, B)), E, C);
+      __m128i e3   = SCALE2X_SEL_SSE2(
+            _mm_andnot_si128(keep, _mm_cmpeq_epi16(E, D)), E, C);
+
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1)),
+            _mm_unpacklo_epi16(e0, e1));
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 8),
+            _mm_unpackhi_epi16(e0, e1));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)),
+            _mm_unpacklo_epi16(e2, e3));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 8),
+            _mm_unpackhi_epi16(e2, e3));
+   }
+
+   scale2x_span_rgb565(out0, out1, prev, cur, next, x, width, width);
+}
+#endif
+
+#ifdef SOFTFILTER_HAVE_NEON
+static void scale2x_row_xrgb8888_neon(uint32_t *out0, uint32_t *out1,
+      const uint32_t *prev, const uint32_t *cur, const uint32_t *next,
+      unsigned width)
+{
+   unsigned x = 1;
+
+   scale2x_span_xrgb8888(out0, out1, prev, cur, next, 0, 1, width);
+
+   for (; x + 4 < width; x += 4)
+   {
+      uint32x4x2_t row;
+      uint32x4_t A    = vld1q_u32(prev + x);
+      uint32x4_t B    = vld1q_u32(cur  + x - 1);
+      uint32x4_t C    = vld1q_u32(cur  + x);
+      uint32x4_t D    = vld1q_u32(cur  + x + 1);
+      uint32x4_t E    = vld1q_u32(next + x);
+      uint32x4_t keep = vorrq_u32(vceqq_u32(A, E), vceqq_u32(B, D));
+
+      /* vst2 interleaves the left and right output pixels */
+      row.val[0] = vbslq_u32(vbicq_u32(vceqq_u32(A, B), keep), A, C);
+      row.val[1] = vbslq_u32(vbicq_u32(vceqq_u32(A, D), keep), A, C);
+      vst2q_u32(out0 + (x << 1), row);
+      row.val[0] = vbslq_u32(vbicq_u32(vceqq_u32(E, B), keep), E, C);
+      row.val[1] = vbslq_u32(vbicq_u32(vceqq_u32(E, D), keep), E, C);
+      vst2q_u32(out1 + (x << 1), row);
+   }
+
+   scale2x_span_xrgb8888(out0, out1, prev, cur, next, x, width, width);
+}
+
+static void scale2x_row_rgb565_neon(uint16_t *out0, uint16_t *out1,
+      const uint16_t *prev, const uint16_t *cur, const uint16_t *next,
+      unsigned width)
+{
+   unsigned x = 1;
+
+   scale2x_span_rgb565(out0, out1, prev, cur, next, 0, 1, width);
+
+   for (; x + 8 < width; x += 8)
+   {
+      uint16x8x2_t row;
+      uint16x8_t A    = vld1q_u16(prev + x);
+      uint16x8_t B    = vld1q_u16(cur  + x - 1);
+      uint16x8_t C    = vld1q_u16(cur  + x);
+      uint16x8_t D    = vld1q_u16(cur  + x + 1);
+      uint16x8_t E    = vld1q_u16(next + x);
+      uint16x8_t keep = vorrq_u16(vceqq_u16(A, E), vceqq_u16(B, D));
+
+      row.val[0] = vbslq_u16(vbicq_u16(vceqq_u16(A, B), keep), A, C);
+      row.val[1] = vbslq_u16(vbicq_u16(vceqq_u16(A, D), keep), A, C);
+      vst2q_u16(out0 + (x << 1), row);
+      row.val[0] = vbslq_u16(vbicq_u16(vceqq_u16(E, B), keep), E, C);
+      row.val[1] = vbslq_u16(vbicq_u16(vceqq_u16(E, D), keep), E, C);
+      vst2q_u16(out1 + (x << 1), row);
+   }
+
+   scale2x_span_rgb565(out0, out1, prev, cur, next, x, width, width);
+}
+#endif
+
 static unsigned scale2x_generic_input_fmts(void)
 {
    return SOFTFILTER_FMT_XRGB8888 | SOFTFILTER_FMT_RGB565;
@@ -68,22 +311,38 @@ static void *scale2x_generic_create(const struct softfilter_config *config,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
 
-   if (!filt) {
+   if (!filt)
       return NULL;
-   }
-   /* Apparently the code is not thread-safe,
-    * so force single threaded operation... */
-   filt->workers = (struct softfilter_thread_data*)calloc(1, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->workers = (struct softfilter_thread_data*)
+      calloc(threads, sizeof(struct softfilter_thread_data));
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
-   if (!filt->workers) {
+   if (!filt->workers)
+   {
       free(filt);
       return NULL;
    }
+
+   filt->row_xrgb8888 = scale2x_row_xrgb8888;
+   filt->row_rgb565   = scale2x_row_rgb565;
+#ifdef SOFTFILTER_HAVE_SSE2
+   if (simd & SOFTFILTER_SIMD_SSE2)
+   {
+      filt->row_xrgb8888 = scale2x_row_xrgb8888_sse2;
+      filt->row_rgb565   = scale2x_row_rgb565_sse2;
+   }
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+   if (simd & SOFTFILTER_SIMD_NEON)
+   {
+      filt->row_xrgb8888 = scale2x_row_xrgb8888_neon;
+      filt->row_rgb565   = scale2x_row_rgb565_neon;
+   }
+#endif
+
    return filt;
 }
 
@@ -105,99 +364,56 @@ static void scale2x_generic_destroy(void *data)
    free(filt);
 }
 
+/* Slices read the lines just outside of their own
+ * range from the input, only the top and bottom
+ * lines of the frame have clamped neighbours */
 static void scale2x_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt           = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
-   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
-   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
+   size_t in_stride                   = thr->in_pitch >> 2;
+   size_t out_stride                  = thr->out_pitch >> 2;
    const uint32_t *input              = (const uint32_t*)thr->in_data;
-   uint32_t *output0                  = (uint32_t*)thr->out_data;
-   uint32_t *output1                  = (uint32_t*)thr->out_data + out_stride;
-   uint16_t x, y;
+   uint32_t *output                   = (uint32_t*)thr->out_data;
+   unsigned y;
 
    for (y = 0; y < thr->height; y++)
    {
-      /* Determine offsets of previous/next source lines */
-      uint32_t line_prev = (y == 0)               ? 0 : in_stride;
-      uint32_t line_next = (y == thr->height - 1) ? 0 : in_stride;
+      const uint32_t *prev = (thr->first && y == 0)
+         ? input : input - in_stride;
+      const uint32_t *next = (thr->last  && y == thr->height - 1)
+         ? input : input + in_stride;
 
-      for (x = 0; x < thr->width; x++)
-      {
-         /* Get sample points */
-         uint32_t A = *(input - line_prev);
-         uint32_t B = (x > 0) ? *(input - 1) : *input;
-         uint32_t C = *input;
-         uint32_t D = (x < thr->width - 1) ? *(input + 1) : *input;
-         uint32_t E = *(input++ + line_next);
-
-         /* Apply pixel expansion algorithm */
-         if (A != E && B != D)
-         {
-            *output0++ = (A == B ? A : C);
-            *output0++ = (A == D ? A : C);
-            *output1++ = (E == B ? E : C);
-            *output1++ = (E == D ? E : C);
-         }
-         else
-         {
-            *output0++ = C;
-            *output0++ = C;
-            *output1++ = C;
-            *output1++ = C;
-         }
-      }
+      filt->row_xrgb8888(output, output + out_stride,
+            prev, input, next, thr->width);
 
-      input   += in_stride - thr->width;
-      output0 += (out_stride << 1) - (thr->width << 1);
-      output1 += (out_stride << 1) - (thr->width << 1);
+      input  += in_stride;
+      output += out_stride << 1;
    }
 }
 
 static void scale2x_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt           = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
-   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 1);
-   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 1);
+   size_t in_stride                   = thr->in_pitch >> 1;
+   size_t out_stride                  = thr->out_pitch >> 1;
    const uint16_t *input              = (const uint16_t*)thr->in_data;
-   uint16_t *output0                  = (uint16_t*)thr->out_data;
-   uint16_t *output1                  = (uint16_t*)thr->out_data + out_stride;
-   uint16_t x, y;
+   uint16_t *output                   = (uint16_t*)thr->out_data;
+   unsigned y;
 
    for (y = 0; y < thr->height; y++)
    {
-      /* Determine offsets of previous/next source lines */
-      uint32_t line_prev = (y == 0)               ? 0 : in_stride;
-      uint32_t line_next = (y == thr->height - 1) ? 0 : in_stride;
+      const uint16_t *prev = (thr->first && y == 0)
+         ? input : input - in_stride;
+      const uint16_t *next = (thr->last  && y == thr->height - 1)
+         ? input : input + in_stride;
 
-      for (x = 0; x < thr->width; x++)
-      {
-         /* Get sample points */
-         uint16_t A = *(input - line_prev);
-         uint16_t B = (x > 0) ? *(input - 1) : *input;
-         uint16_t C = *input;
-         uint16_t D = (x < thr->width - 1) ? *(input + 1) : *input;
-         uint16_t E = *(input++ + line_next);
-
-         /* Apply pixel expansion algorithm */
-         if (A != E && B != D)
-         {
-            *output0++ = (A == B ? A : C);
-            *output0++ = (A == D ? A : C);
-            *output1++ = (E == B ? E : C);
-            *output1++ = (E == D ? E : C);
-         }
-         else
-         {
-            *output0++ = C;
-            *output0++ = C;
-            *output1++ = C;
-            *output1++ = C;
-         }
-      }
+      filt->row_rgb565(output, output + out_stride,
+            prev, input, next, thr->width);
 
-      input   += in_stride - thr->width;
-      output0 += (out_stride << 1) - (thr->width << 1);
-      output1 += (out_stride << 1) - (thr->width << 1);
+      input  += in_stride;
+      output += out_stride << 1;
    }
 }
 
@@ -206,27 +422,31 @@ static void scale2x_generic_packets(void *data,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height, size_t input_stride)
 {
-   /* We are guaranteed single threaded operation
-    * (filt->threads = 1) so we don't need to loop
-    * over threads and can cull some code. This only
-    * makes the tiniest performance difference, but
-    * every little helps when running on an o3DS... */
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)data;
-   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)&filt->workers[0];
-
-   thr->out_data = (uint8_t*)output;
-   thr->in_data = (const uint8_t*)input;
-   thr->out_pitch = output_stride;
-   thr->in_pitch = input_stride;
-   thr->width = width;
-   thr->height = height;
-
-   if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
-      packets[0].work = scale2x_work_cb_xrgb8888;
-   } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
-      packets[0].work = scale2x_work_cb_rgb565;
+
+   for (i = 0; i < filt->threads; i++)
+   {
+      struct softfilter_thread_data *thr =
+         (struct softfilter_thread_data*)&filt->workers[i];
+      unsigned y_start = (height * i) / filt->threads;
+      unsigned y_end   = (height * (i + 1)) / filt->threads;
+
+      thr->out_data  = (uint8_t*)output + y_start * (output_stride << 1);
+      thr->in_data   = (const uint8_t*)input + y_start * input_stride;
+      thr->out_pitch = output_stride;
+      thr->in_pitch  = input_stride;
+      thr->width     = width;
+      thr->height    = y_end - y_start;
+      thr->first     = y_start == 0;
+      thr->last      = y_end == height;
+
+      if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
+         packets[i].work = scale2x_work_cb_xrgb8888;
+      else if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
+         packets[i].work = scale2x_work_cb_rgb565;
+      packets[i].thread_data = thr;
    }
-   packets[0].thread_data = thr;
 }
 
 static const struct softfilter_implementation scale2x_generic = {
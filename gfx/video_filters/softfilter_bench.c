@@ -0,0 +1,364 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Softfilter benchmark.
+ * Loads the filter plugs found next to each .filt preset,
+ * runs the preset on a reference frame in every input format
+ * it supports and reports throughput (single threaded).
+ * With -c, the frame is also run with SIMD disabled and the
+ * outputs are compared.
+ *
+ * Build: make build=release bench
+ * Usage: ./softfilter_bench [-c] [-f frames] [-m simd_mask]
+ *                           [-s WIDTHxHEIGHT] file.filt... */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <retro_dirent.h>
+#include <retro_miscellaneous.h>
+#include <dynamic/dylib.h>
+#include <file/file_path.h>
+#include <file/config_file.h>
+#include <file/config_file_userdata.h>
+#include <features/features_cpu.h>
+#include <string/stdstring.h>
+
+#include "softfilter.h"
+
+#if defined(_WIN32)
+#define SOFTFILTER_BENCH_EXT "dll"
+#elif defined(__APPLE__)
+#define SOFTFILTER_BENCH_EXT "dylib"
+#else
+#define SOFTFILTER_BENCH_EXT "so"
+#endif
+
+struct softfilter_bench_run
+{
+   void *output;
+   size_t output_stride;
+   double usec;
+   unsigned out_width;
+   unsigned out_height;
+};
+
+static const struct softfilter_config softfilter_bench_config = {
+   config_userdata_get_float,
+   config_userdata_get_int,
+   config_userdata_get_hex,
+   config_userdata_get_float_array,
+   config_userdata_get_int_array,
+   config_userdata_get_string,
+   config_userdata_free,
+};
+
+/* Looks for a plug implementing 'ident' in 'dir'.
+ * The library stays loaded until the process exits */
+static const struct softfilter_implementation *softfilter_bench_find(
+      const char *dir, const char *ident, softfilter_simd_mask_t simd)
+{
+   const struct softfilter_implementation *impl = NULL;
+   struct RDIR *rdir                            = retro_opendir(dir);
+
+   if (!rdir)
+      return NULL;
+
+   while (!impl && retro_readdir(rdir))
+   {
+      char path[PATH_MAX_LENGTH];
+      softfilter_get_implementation_t cb;
+      dylib_t lib;
+      const char *name = retro_dirent_get_name(rdir);
+
+      if (!string_is_equal(path_get_extension(name), SOFTFILTER_BENCH_EXT))
+         continue;
+
+      fill_pathname_join(path, dir, name, sizeof(path));
+      if (!(lib = dylib_load(path)))
+         continue;
+
+      cb = (softfilter_get_implementation_t)
+         dylib_proc(lib, "softfilter_get_implementation");
+      if (cb && (impl = cb(simd))
+            && (impl->api_version != SOFTFILTER_API_VERSION
+               || !string_is_equal(impl->short_ident, ident)))
+         impl = NULL;
+
+      if (!impl)
+         dylib_close(lib);
+   }
+
+   retro_closedir(rdir);
+   return impl;
+}
+
+/* Pixel art-like reference frame: flat 8x8 tiles from a
+ * small palette, crossed by single pixel diagonals */
+static void *softfilter_bench_frame(unsigned fmt,
+      unsigned width, unsigned height, size_t *stride)
+{
+   unsigned x, y;
+   static const uint32_t palette[8] = {
+      0x000000, 0xffffff, 0xd82800, 0xfc9838,
+      0x0058f8, 0x00a800, 0x787878, 0xf8d878
+   };
+   uint32_t seed = 12345;
+   unsigned bpp  = (fmt == SOFTFILTER_FMT_XRGB8888)
+      ? SOFTFILTER_BPP_XRGB8888 : SOFTFILTER_BPP_RGB565;
+   uint8_t *data = (uint8_t*)malloc(width * height * bpp);
+   uint8_t *tile = (uint8_t*)malloc(((width + 7) >> 3) * ((height + 7) >> 3));
+
+   if (!data || !tile)
+   {
+      free(data);
+      free(tile);
+      return NULL;
+   }
+
+   for (x = 0; x < ((width + 7) >> 3) * ((height + 7) >> 3); x++)
+   {
+      seed    = seed * 1103515245 + 12345;
+      tile[x] = (seed >> 16) & 7;
+   }
+
+   for (y = 0; y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         uint32_t color = palette[((x + y) % 23 == 0)
+            ? 1 : tile[(y >> 3) * ((width + 7) >> 3) + (x >> 3)]];
+
+         if (fmt == SOFTFILTER_FMT_XRGB8888)
+            ((uint32_t*)data)[y * width + x] = color;
+         else
+            ((uint16_t*)data)[y * width + x] = (uint16_t)(
+                    ((color >> 8) & 0xf800)
+                  | ((color >> 5) & 0x07e0)
+                  | ((color >> 3) & 0x001f));
+      }
+   }
+
+   free(tile);
+   *stride = width * bpp;
+   return data;
+}
+
+static bool softfilter_bench_run(const struct softfilter_implementation *impl,
+      struct config_file_userdata *userdata, softfilter_simd_mask_t simd,
+      unsigned fmt, const void *input, size_t input_stride,
+      unsigned width, unsigned height, unsigned frames,
+      struct softfilter_bench_run *run)
+{
+   unsigned i, threads;
+   retro_time_t start;
+   struct softfilter_work_packet *packets = NULL;
+   unsigned bpp                           = (fmt == SOFTFILTER_FMT_XRGB8888)
+      ? SOFTFILTER_BPP_XRGB8888 : SOFTFILTER_BPP_RGB565;
+   void *data                             = impl->create(
+         &softfilter_bench_config, fmt, fmt, width, height,
+         1, simd, userdata);
+
+   if (!data)
+      return false;
+
+   threads = impl->query_num_threads(data);
+   impl->query_output_size(data, &run->out_width, &run->out_height,
+         width, height);
+
+   run->output_stride = run->out_width * bpp;
+   run->output        = calloc(run->out_height, run->output_stride);
+   packets            = (struct softfilter_work_packet*)
+      calloc(threads, sizeof(*packets));
+
+   if (!run->output || !packets)
+   {
+      free(packets);
+      impl->destroy(data);
+      return false;
+   }
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < frames; i++)
+   {
+      unsigned j;
+      impl->get_work_packets(data, packets,
+            run->output, run->output_stride,
+            input, width, height, input_stride);
+      for (j = 0; j < threads; j++)
+         packets[j].work(data, packets[j].thread_data);
+   }
+   run->usec = (double)(cpu_features_get_time_usec() - start);
+
+   free(packets);
+   impl->destroy(data);
+   return true;
+}
+
+static bool softfilter_bench_filt(const char *filt_path,
+      softfilter_simd_mask_t simd, unsigned width, unsigned height,
+      unsigned frames, bool check)
+{
+   unsigned i;
+   char dir[PATH_MAX_LENGTH];
+   struct config_file_userdata userdata;
+   const struct softfilter_implementation *impl        = NULL;
+   const struct softfilter_implementation *impl_scalar = NULL;
+   char *ident                                         = NULL;
+   config_file_t *conf                                 = config_file_new(filt_path);
+   bool ret                                            = true;
+   static const unsigned fmts[2] = {
+      SOFTFILTER_FMT_XRGB8888, SOFTFILTER_FMT_RGB565
+   };
+
+   if (!conf)
+   {
+      fprintf(stderr, "%s: Failed to load preset.\n", filt_path);
+      return false;
+   }
+
+   /* Presets without a filter (i.e. NULL.filt) disable filtering */
+   if (!config_get_string(conf, "filter", &ident))
+   {
+      config_file_free(conf);
+      return true;
+   }
+
+   fill_pathname_basedir(dir, filt_path, sizeof(dir));
+   if (string_is_empty(dir))
+      strlcpy(dir, ".", sizeof(dir));
+
+   impl        = softfilter_bench_find(dir, ident, simd);
+   impl_scalar = check ? softfilter_bench_find(dir, ident, 0) : NULL;
+
+   if (!impl || (check && !impl_scalar))
+   {
+      fprintf(stderr, "%s: Filter \"%s\" not found in \"%s\".\n",
+            filt_path, ident, dir);
+      free(ident);
+      config_file_free(conf);
+      return false;
+   }
+
+   userdata.conf      = conf;
+   userdata.prefix[0] = "filter";
+   userdata.prefix[1] = impl->short_ident;
+
+   for (i = 0; i < 2; i++)
+   {
+      size_t input_stride;
+      struct softfilter_bench_run run;
+      void *input = NULL;
+
+      if (!(impl->query_input_formats() & fmts[i]))
+         continue;
+
+      if (!(input = softfilter_bench_frame(fmts[i], width, height,
+                  &input_stride)))
+         continue;
+
+      memset(&run, 0, sizeof(run));
+
+      if (softfilter_bench_run(impl, &userdata, simd, fmts[i],
+               input, input_stride, width, height, frames, &run))
+      {
+         double ms_per_frame = run.usec / frames / 1000.0;
+
+         printf("%-36s %-8s %4ux%-4u -> %4ux%-4u %9.3f ms/frame %9.1f Mpix/s",
+               path_basename(filt_path),
+               fmts[i] == SOFTFILTER_FMT_XRGB8888 ? "XRGB8888" : "RGB565",
+               width, height, run.out_width, run.out_height,
+               ms_per_frame,
+               (double)width * height * frames / run.usec);
+
+         if (check)
+         {
+            struct softfilter_bench_run ref;
+
+            memset(&ref, 0, sizeof(ref));
+
+            if (softfilter_bench_run(impl_scalar, &userdata, 0, fmts[i],
+                     input, input_stride, width, height, frames, &ref))
+            {
+               bool match = ref.out_height == run.out_height
+                  && ref.output_stride == run.output_stride
+                  && !memcmp(ref.output, run.output,
+                        run.out_height * run.output_stride);
+
+               printf(" (scalar %9.3f ms/frame, x%.2f)%s",
+                     ref.usec / frames / 1000.0, ref.usec / run.usec,
+                     match ? "" : " MISMATCH");
+               if (!match)
+                  ret = false;
+               free(ref.output);
+            }
+         }
+
+         printf("\n");
+         free(run.output);
+      }
+      else
+      {
+         fprintf(stderr, "%s: Failed to create filter.\n", filt_path);
+         ret = false;
+      }
+
+      free(input);
+   }
+
+   free(ident);
+   config_file_free(conf);
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned width              = 256;
+   unsigned height             = 224;
+   unsigned frames             = 200;
+   bool check                  = false;
+   bool ret                    = true;
+   softfilter_simd_mask_t simd = (softfilter_simd_mask_t)cpu_features_get();
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i++)
+   {
+      if (string_is_equal(argv[i], "-c"))
+         check = true;
+      else if (string_is_equal(argv[i], "-f") && i + 1 < argc)
+         frames = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (string_is_equal(argv[i], "-m") && i + 1 < argc)
+         simd  &= (softfilter_simd_mask_t)strtoul(argv[++i], NULL, 0);
+      else if (!string_is_equal(argv[i], "-s") || i + 1 >= argc
+            || sscanf(argv[++i], "%ux%u", &width, &height) != 2)
+         break;
+   }
+
+   if (i >= argc || argv[i][0] == '-' || !width || !height || !frames)
+   {
+      fprintf(stderr, "Usage: %s [-c] [-f frames] [-m simd_mask] "
+            "[-s WIDTHxHEIGHT] file.filt...\n", argv[0]);
+      return 1;
+   }
+
+   for (; i < argc; i++)
+      ret = softfilter_bench_filt(argv[i], simd,
+            width, height, frames, check) && ret;
+
+   return ret ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOFTFILTER_SIMD_H__
+#define SOFTFILTER_SIMD_H__
+
+/* Compile-time availability of the SIMD kernels used by
+ * filters. Kernels are built for every instruction set
+ * the compiler can target, regardless of the flags the
+ * filter itself is built with, and are picked at runtime
+ * from the softfilter_simd_mask_t passed to create().
+ *
+ * SOFTFILTER_TARGET_* must prefix the definition of every
+ * function using the matching intrinsics. */
+
+#if (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))) \
+   && (defined(__x86_64__) || defined(__i386__))
+#define SOFTFILTER_HAVE_SSE2
+#define SOFTFILTER_TARGET_SSE2 __attribute__((target("sse2")))
+#include <emmintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define SOFTFILTER_HAVE_SSE2
+#define SOFTFILTER_TARGET_SSE2
+#include <emmintrin.h>
+#endif
+
+/* NEON kernels are only built when the whole filter
+ * is compiled for NEON */
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SOFTFILTER_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#endif
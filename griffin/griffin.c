@@ -27,6 +27,10 @@
 #define HAVE_COMPRESSION 1
 #endif
 
+#if defined(__linux__) && !defined(ANDROID) && defined(HAVE_THREADS)
+#define HAVE_INPUT_THREAD 1
+#endif
+
 #if defined(HAVE_OPENGL) && defined(HAVE_ANGLE)
 #ifndef HAVE_OPENGLES
 #define HAVE_OPENGLES  1
@@ -226,6 +230,7 @@ CHEATS
 ============================================================ */
 #ifdef HAVE_CHEATS
 #include "../cheat_manager.c"
+#include "../cheat_search.c"
 #endif
 #include "../libretro-common/hash/lrc_hash.c"
 
@@ -776,6 +781,9 @@ INPUT
 
 #if defined(__linux__) && !defined(ANDROID)
 #include "../input/common/linux_common.c"
+#ifdef HAVE_INPUT_THREAD
+#include "../input/common/input_thread.c"
+#endif
 #include "../input/drivers/linuxraw_input.c"
 #include "../input/drivers_joypad/linuxraw_joypad.c"
 #endif
@@ -971,6 +979,10 @@ AUDIO
 #include "../audio/drivers/pulse.c"
 #endif
 
+#ifdef HAVE_PIPEWIRE
+#include "../audio/drivers/pipewire.c"
+#endif
+
 #ifdef HAVE_AL
 #include "../audio/drivers/openal.c"
 #endif
@@ -1221,6 +1233,11 @@ RETROARCH
 #include "../runloop.c"
 #include "../command.c"
 #include "../driver.c"
+#include "../frame_telemetry.c"
+#include "../startup_trace.c"
+#include "../benchmark.c"
+#include "../memory_map.c"
+#include "../sram_blocks.c"
 #include "../midi_driver.c"
 #include "../location_driver.c"
 #include "../ui/ui_companion_driver.c"
@@ -1285,6 +1302,7 @@ RECORDING
 ============================================================ */
 #include "../record/record_driver.c"
 #ifdef HAVE_FFMPEG
+#include "../record/record_ring.c"
 #include "../record/drivers/record_ffmpeg.c"
 #endif
 
@@ -1298,8 +1316,10 @@ THREAD
 #endif
 
 #include "../libretro-common/rthreads/rthreads.c"
+#include "../libretro-common/rthreads/tpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
+#include "../state_writer.c"
 #endif
 
 /* needed for playlists, netplay lobbies and achievements */
@@ -1393,6 +1413,7 @@ MENU
 #ifdef HAVE_MENU
 #include "../menu/menu_driver.c"
 #include "../menu/menu_setting.c"
+#include "../menu/menu_search_index.c"
 #if defined(HAVE_MATERIALUI) || defined(HAVE_XMB) || defined(HAVE_OZONE)
 #include "../menu/menu_screensaver.c"
 #endif
@@ -1422,6 +1443,7 @@ MENU
 #endif
 
 #ifdef HAVE_RGUI
+#include "../menu/drivers/rgui_blit.c"
 #include "../menu/drivers/rgui.c"
 #endif
 
@@ -0,0 +1,377 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <compat/strl.h>
+#include <retro_atomic.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+
+#include "input_thread.h"
+
+#include "../../verbosity.h"
+
+/* Latency histograms have buckets this many
+ * microseconds wide, the last one also holding
+ * everything beyond the range */
+#define INPUT_THREAD_BUCKET_USEC 100
+#define INPUT_THREAD_BUCKETS     512
+
+/* The thread sleeps once fewer slots than this
+ * fraction of the queue are free */
+#define INPUT_THREAD_LOW_WATER(capacity) ((capacity) / 4)
+
+/* Microseconds to sleep on a full queue before
+ * checking again, in case a wakeup was missed */
+#define INPUT_THREAD_FULL_WAIT 100000
+
+typedef struct input_thread_histogram
+{
+   uint64_t buckets[INPUT_THREAD_BUCKETS];
+   uint64_t count;
+   retro_time_t max;
+} input_thread_histogram_t;
+
+struct input_thread
+{
+   input_thread_drain_t drain;
+   void *userdata;
+   uint8_t *ring;
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   /* Written by the input thread only */
+   retro_atomic_uint_t head;
+   /* Written by the main thread only */
+   retro_atomic_uint_t tail;
+   size_t mask;
+   size_t slot_size;
+   size_t event_size;
+   int fd;
+   int wake[2];
+   retro_atomic_uint_t alive;
+   char name[32];
+};
+
+static struct
+{
+   input_thread_histogram_t event_to_poll;
+   input_thread_histogram_t poll_to_present;
+   /* Time of the last latch that applied events
+    * and whose frame has not been presented yet */
+   retro_time_t poll_time;
+} input_thread_stats;
+
+static void input_thread_record(input_thread_histogram_t *hist,
+      retro_time_t usec)
+{
+   size_t bucket;
+
+   if (usec < 0)
+      usec = 0;
+
+   bucket = (size_t)(usec / INPUT_THREAD_BUCKET_USEC);
+   if (bucket >= INPUT_THREAD_BUCKETS)
+      bucket = INPUT_THREAD_BUCKETS - 1;
+
+   hist->buckets[bucket]++;
+   hist->count++;
+   if (usec > hist->max)
+      hist->max = usec;
+}
+
+static retro_time_t input_thread_percentile(
+      const input_thread_histogram_t *hist, unsigned percent)
+{
+   size_t i;
+   uint64_t seen   = 0;
+   uint64_t target = (hist->count * percent + 99) / 100;
+
+   if (!hist->count)
+      return 0;
+
+   for (i = 0; i < INPUT_THREAD_BUCKETS; i++)
+   {
+      seen += hist->buckets[i];
+      if (seen >= target)
+      {
+         /* Upper bound of the bucket, never above
+          * what was actually seen */
+         retro_time_t usec = (retro_time_t)(i + 1)
+               * INPUT_THREAD_BUCKET_USEC;
+         if (i == INPUT_THREAD_BUCKETS - 1 || usec > hist->max)
+            return hist->max;
+         return usec;
+      }
+   }
+
+   return hist->max;
+}
+
+static void input_thread_fill_percentiles(
+      const input_thread_histogram_t *hist, retro_time_t *out)
+{
+   out[INPUT_THREAD_P50] = input_thread_percentile(hist, 50);
+   out[INPUT_THREAD_P90] = input_thread_percentile(hist, 90);
+   out[INPUT_THREAD_P99] = input_thread_percentile(hist, 99);
+   out[INPUT_THREAD_MAX] = hist->max;
+}
+
+void input_thread_get_latency(input_thread_latency_t *latency)
+{
+   input_thread_fill_percentiles(&input_thread_stats.event_to_poll,
+         latency->event_to_poll);
+   input_thread_fill_percentiles(&input_thread_stats.poll_to_present,
+         latency->poll_to_present);
+   latency->events = input_thread_stats.event_to_poll.count;
+   latency->frames = input_thread_stats.poll_to_present.count;
+}
+
+void input_thread_note_present(void)
+{
+   if (!input_thread_stats.poll_time)
+      return;
+
+   input_thread_record(&input_thread_stats.poll_to_present,
+         cpu_features_get_time_usec() - input_thread_stats.poll_time);
+   input_thread_stats.poll_time = 0;
+}
+
+size_t input_thread_space(const input_thread_t *thread)
+{
+   retro_atomic_uint_t tail = retro_atomic_load(&thread->tail);
+   return thread->mask + 1 - (size_t)(thread->head - tail);
+}
+
+bool input_thread_push(input_thread_t *thread,
+      const void *event, retro_time_t time)
+{
+   uint8_t *slot;
+
+   if (!input_thread_space(thread))
+      return false;
+
+   slot = thread->ring + (thread->head & thread->mask) * thread->slot_size;
+   memcpy(slot, &time, sizeof(time));
+   memcpy(slot + sizeof(time), event, thread->event_size);
+
+   /* Publishes the slot along with the new head */
+   retro_atomic_store(&thread->head, thread->head + 1);
+   return true;
+}
+
+size_t input_thread_latch(input_thread_t *thread,
+      input_thread_apply_t apply, void *userdata)
+{
+   retro_time_t now;
+   retro_atomic_uint_t tail = thread->tail;
+   retro_atomic_uint_t head = retro_atomic_load(&thread->head);
+   size_t n                 = head - tail;
+
+   if (!n)
+      return 0;
+
+   now = cpu_features_get_time_usec();
+
+   for (; tail != head; tail++)
+   {
+      retro_time_t time;
+      const uint8_t *slot = thread->ring
+            + (tail & thread->mask) * thread->slot_size;
+
+      memcpy(&time, slot, sizeof(time));
+      apply(slot + sizeof(time), time, userdata);
+      input_thread_record(&input_thread_stats.event_to_poll, now - time);
+   }
+
+   retro_atomic_store(&thread->tail, tail);
+   input_thread_stats.poll_time = now;
+
+   /* The thread may be sleeping on a full queue */
+   scond_signal(thread->cond);
+
+   return n;
+}
+
+void input_thread_lock(input_thread_t *thread)
+{
+   slock_lock(thread->lock);
+}
+
+void input_thread_unlock(input_thread_t *thread)
+{
+   slock_unlock(thread->lock);
+}
+
+static bool input_thread_is_alive(input_thread_t *thread)
+{
+   return retro_atomic_load(&thread->alive) != 0;
+}
+
+static void input_thread_loop(void *data)
+{
+   input_thread_t *thread = (input_thread_t*)data;
+   size_t low_water       = INPUT_THREAD_LOW_WATER(thread->mask + 1);
+   struct pollfd fds[2];
+
+   fds[0].fd     = thread->fd;
+   fds[0].events = POLLIN;
+   fds[1].fd     = thread->wake[0];
+   fds[1].events = POLLIN;
+
+   while (input_thread_is_alive(thread))
+   {
+      /* Nothing is read while the main thread is behind,
+       * the kernel buffers events meanwhile */
+      if (input_thread_space(thread) < low_water)
+      {
+         slock_lock(thread->lock);
+         if (input_thread_is_alive(thread)
+               && input_thread_space(thread) < low_water)
+            scond_wait_timeout(thread->cond, thread->lock,
+                  INPUT_THREAD_FULL_WAIT);
+         slock_unlock(thread->lock);
+         continue;
+      }
+
+      fds[0].revents = 0;
+      fds[1].revents = 0;
+
+      if (poll(fds, 2, -1) <= 0)
+         continue;
+
+      if (fds[1].revents || (fds[0].revents & POLLNVAL))
+         break;
+
+      if (fds[0].revents)
+      {
+         slock_lock(thread->lock);
+         thread->drain(thread, thread->userdata);
+         slock_unlock(thread->lock);
+      }
+   }
+}
+
+input_thread_t *input_thread_new(const char *name, int fd,
+      size_t event_size, size_t capacity,
+      input_thread_drain_t drain, void *userdata)
+{
+   size_t size             = 1;
+   input_thread_t *thread  = (input_thread_t*)
+      calloc(1, sizeof(*thread));
+
+   if (!thread)
+      return NULL;
+
+   while (size < capacity)
+      size <<= 1;
+
+   thread->fd         = fd;
+   thread->drain      = drain;
+   thread->userdata   = userdata;
+   thread->mask       = size - 1;
+   thread->event_size = event_size;
+   /* Keeps the timestamp of every slot aligned */
+   thread->slot_size  = (sizeof(retro_time_t) + event_size
+         + sizeof(retro_time_t) - 1) & ~(sizeof(retro_time_t) - 1);
+   thread->wake[0]    = -1;
+   thread->wake[1]    = -1;
+   thread->alive      = 1;
+   strlcpy(thread->name, name, sizeof(thread->name));
+
+   if (!(thread->ring = (uint8_t*)malloc(size * thread->slot_size)))
+      goto error;
+   if (!(thread->lock = slock_new()))
+      goto error;
+   if (!(thread->cond = scond_new()))
+      goto error;
+   if (pipe(thread->wake) < 0)
+   {
+      thread->wake[0] = -1;
+      thread->wake[1] = -1;
+      goto error;
+   }
+   fcntl(thread->wake[0], F_SETFL, O_NONBLOCK);
+   fcntl(thread->wake[1], F_SETFL, O_NONBLOCK);
+
+   if (!(thread->thread = sthread_create(input_thread_loop, thread)))
+      goto error;
+
+   RARCH_LOG("[Input]: Threaded %s input, %u event queue.\n",
+         thread->name, (unsigned)size);
+
+   return thread;
+
+error:
+   RARCH_ERR("[Input]: Failed to start %s input thread.\n", name);
+   input_thread_free(thread);
+   return NULL;
+}
+
+void input_thread_free(input_thread_t *thread)
+{
+   if (!thread)
+      return;
+
+   if (thread->thread)
+   {
+      char c = 0;
+
+      retro_atomic_store(&thread->alive, 0);
+      if (write(thread->wake[1], &c, 1) < 0) { }
+      slock_lock(thread->lock);
+      scond_signal(thread->cond);
+      slock_unlock(thread->lock);
+      sthread_join(thread->thread);
+
+      if (input_thread_stats.event_to_poll.count)
+      {
+         input_thread_latency_t latency;
+         input_thread_get_latency(&latency);
+         RARCH_LOG("[Input]: %s event to poll latency (usec):"
+               " p50 %d, p90 %d, p99 %d, max %d over %u events.\n",
+               thread->name,
+               (int)latency.event_to_poll[INPUT_THREAD_P50],
+               (int)latency.event_to_poll[INPUT_THREAD_P90],
+               (int)latency.event_to_poll[INPUT_THREAD_P99],
+               (int)latency.event_to_poll[INPUT_THREAD_MAX],
+               (unsigned)latency.events);
+         RARCH_LOG("[Input]: %s poll to present latency (usec):"
+               " p50 %d, p90 %d, p99 %d, max %d over %u frames.\n",
+               thread->name,
+               (int)latency.poll_to_present[INPUT_THREAD_P50],
+               (int)latency.poll_to_present[INPUT_THREAD_P90],
+               (int)latency.poll_to_present[INPUT_THREAD_P99],
+               (int)latency.poll_to_present[INPUT_THREAD_MAX],
+               (unsigned)latency.frames);
+      }
+   }
+
+   if (thread->wake[0] >= 0)
+      close(thread->wake[0]);
+   if (thread->wake[1] >= 0)
+      close(thread->wake[1]);
+   if (thread->cond)
+      scond_free(thread->cond);
+   if (thread->lock)
+      slock_free(thread->lock);
+   free(thread->ring);
+   free(thread);
+}
@@ -0,0 +1,123 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INPUT_THREAD_H
+#define __INPUT_THREAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Reads input events on a thread of its own as soon as
+ * the kernel has them, instead of once per frame.
+ *
+ * Events are queued with their arrival time in a single
+ * producer, single consumer ring that needs no lock, and
+ * are applied to the driver state by the main thread in
+ * input_thread_latch(), called from the driver's poll
+ * just before the core runs. Driver state is therefore
+ * only ever touched by the main thread, and a frame sees
+ * exactly the events that arrived before it was polled. */
+
+typedef struct input_thread input_thread_t;
+
+/* Called on the input thread whenever @fd is readable,
+ * with the thread lock held. Reads what it can and
+ * queues it with input_thread_push(), stopping when
+ * input_thread_space() is too low. */
+typedef void (*input_thread_drain_t)(input_thread_t *thread,
+      void *userdata);
+
+/* Called on the main thread for every queued event, in
+ * arrival order */
+typedef void (*input_thread_apply_t)(const void *event,
+      retro_time_t time, void *userdata);
+
+/* Latency percentiles in microseconds */
+typedef struct input_thread_latency
+{
+   /* From the event reaching the kernel to the poll
+    * that handed it to the core */
+   retro_time_t event_to_poll[4];
+   /* From that poll to the frame it produced being
+    * presented */
+   retro_time_t poll_to_present[4];
+   uint64_t events;
+   uint64_t frames;
+} input_thread_latency_t;
+
+/* Indices into input_thread_latency_t arrays */
+enum input_thread_percentile
+{
+   INPUT_THREAD_P50 = 0,
+   INPUT_THREAD_P90,
+   INPUT_THREAD_P99,
+   INPUT_THREAD_MAX
+};
+
+/**
+ * input_thread_new:
+ * @name                : Driver name, for logging.
+ * @fd                  : Descriptor to wait on.
+ * @event_size          : Size of a queued event.
+ * @capacity            : Number of events the queue holds,
+ *                        rounded up to a power of two.
+ * @drain               : Reads @fd, see input_thread_drain_t.
+ * @userdata            : Passed to @drain.
+ *
+ * Returns: the running thread, or NULL on failure.
+ **/
+input_thread_t *input_thread_new(const char *name, int fd,
+      size_t event_size, size_t capacity,
+      input_thread_drain_t drain, void *userdata);
+
+/* Stops the thread. Events still queued are dropped. */
+void input_thread_free(input_thread_t *thread);
+
+/* Free slots in the queue. Input thread only. */
+size_t input_thread_space(const input_thread_t *thread);
+
+/* Queues @event, stamped with @time from
+ * cpu_features_get_time_usec()'s clock. Input thread
+ * only. Returns false if the queue is full. */
+bool input_thread_push(input_thread_t *thread,
+      const void *event, retro_time_t time);
+
+/* Keeps @drain from running, so the main thread can
+ * change what it reads from, e.g. on hotplug */
+void input_thread_lock(input_thread_t *thread);
+void input_thread_unlock(input_thread_t *thread);
+
+/* Applies every queued event with @apply. Main thread
+ * only, may be called with the thread lock held.
+ * Returns the number of events applied. */
+size_t input_thread_latch(input_thread_t *thread,
+      input_thread_apply_t apply, void *userdata);
+
+/* Marks the frame produced since the last latch as
+ * presented, for the poll to present latency */
+void input_thread_note_present(void);
+
+/* Latencies since the first thread was started */
+void input_thread_get_latency(input_thread_latency_t *latency);
+
+RETRO_END_DECLS
+
+#endif
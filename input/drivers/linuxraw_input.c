@@ -32,14 +32,67 @@
 #include "../input_keymaps.h"
 #include "../input_driver.h"
 
+#ifdef HAVE_INPUT_THREAD
+#include <features/features_cpu.h>
+
+#include "../common/input_thread.h"
+#include "../../configuration.h"
+#endif
+
 /* TODO/FIXME -
  * fix game focus toggle */
 
 typedef struct linuxraw_input
 {
+#ifdef HAVE_INPUT_THREAD
+   input_thread_t *thread;
+#endif
    bool state[0x80];
 } linuxraw_input_t;
 
+/* Reads a scancode, skipping extended ones */
+static bool linuxraw_input_read(uint8_t *c)
+{
+   while (read(STDIN_FILENO, c, 1) > 0)
+   {
+      uint16_t t;
+
+      if (*c & ~0x80)
+         return true;
+
+      /* ignore extended scancodes */
+      read(STDIN_FILENO, &t, 2);
+   }
+
+   return false;
+}
+
+static void linuxraw_input_handle_scancode(
+      linuxraw_input_t *linuxraw, uint8_t c)
+{
+   if (c == KEY_C && (linuxraw->state[KEY_LEFTCTRL] || linuxraw->state[KEY_RIGHTCTRL]))
+      kill(getpid(), SIGINT);
+
+   linuxraw->state[c & ~0x80] = !(c & 0x80);
+}
+
+#ifdef HAVE_INPUT_THREAD
+static void linuxraw_input_drain(input_thread_t *thread, void *data)
+{
+   uint8_t c;
+
+   while (input_thread_space(thread) && linuxraw_input_read(&c))
+      input_thread_push(thread, &c, cpu_features_get_time_usec());
+}
+
+static void linuxraw_input_apply(const void *event,
+      retro_time_t time, void *data)
+{
+   linuxraw_input_handle_scancode((linuxraw_input_t*)data,
+         *(const uint8_t*)event);
+}
+#endif
+
 static void *linuxraw_input_init(const char *joypad_driver)
 {
    linuxraw_input_t *linuxraw  = NULL;
@@ -69,6 +122,12 @@ static void *linuxraw_input_init(const char *joypad_driver)
 
    linux_terminal_claim_stdin();
 
+#ifdef HAVE_INPUT_THREAD
+   if (config_get_ptr()->bools.input_threaded)
+      linuxraw->thread = input_thread_new("linuxraw", STDIN_FILENO,
+            sizeof(uint8_t), 256, linuxraw_input_drain, linuxraw);
+#endif
+
    return linuxraw;
 }
 
@@ -166,6 +225,9 @@ static void linuxraw_input_free(void *data)
    if (!linuxraw)
       return;
 
+#ifdef HAVE_INPUT_THREAD
+   input_thread_free(linuxraw->thread);
+#endif
    linux_terminal_restore_input();
    free(data);
 }
@@ -175,23 +237,16 @@ static void linuxraw_input_poll(void *data)
    uint8_t c;
    linuxraw_input_t *linuxraw = (linuxraw_input_t*)data;
 
-   while (read(STDIN_FILENO, &c, 1) > 0)
+#ifdef HAVE_INPUT_THREAD
+   if (linuxraw->thread)
    {
-      bool pressed;
-      uint16_t t;
-
-      if (c == KEY_C && (linuxraw->state[KEY_LEFTCTRL] || linuxraw->state[KEY_RIGHTCTRL]))
-         kill(getpid(), SIGINT);
-
-      pressed  = !(c & 0x80);
-      c       &= ~0x80;
-
-      /* ignore extended scancodes */
-      if (!c)
-         read(STDIN_FILENO, &t, 2);
-      else
-         linuxraw->state[c] = pressed;
+      input_thread_latch(linuxraw->thread, linuxraw_input_apply, linuxraw);
+      return;
    }
+#endif
+
+   while (linuxraw_input_read(&c))
+      linuxraw_input_handle_scancode(linuxraw, c);
 }
 
 static uint64_t linuxraw_get_capabilities(void *data)
@@ -72,6 +72,18 @@
 
 #include "../common/linux_common.h"
 
+#if defined(HAVE_INPUT_THREAD) && defined(HAVE_EPOLL)
+#define UDEV_INPUT_THREAD
+#endif
+
+#ifdef UDEV_INPUT_THREAD
+#include <time.h>
+
+#include <features/features_cpu.h>
+
+#include "../common/input_thread.h"
+#endif
+
 #include "../../configuration.h"
 #include "../../retroarch.h"
 #include "../../verbosity.h"
@@ -133,6 +145,10 @@ struct udev_input_device
    enum udev_input_dev_type type;
    char devnode[NAME_MAX_LENGTH];
    char ident[255]; /* could be mouse or keyboards store here */
+#ifdef UDEV_INPUT_THREAD
+   /* Events are stamped with CLOCK_MONOTONIC */
+   bool monotonic;
+#endif
 };
 
 typedef void (*device_handle_cb)(void *data,
@@ -156,8 +172,28 @@ struct udev_input
 #ifdef UDEV_XKB_HANDLING
    bool xkb_handling;
 #endif
+#ifdef UDEV_INPUT_THREAD
+   input_thread_t *thread;
+   bool threaded;
+#endif
 };
 
+#ifdef UDEV_INPUT_THREAD
+/* What the input thread queues */
+typedef struct udev_input_record
+{
+   udev_input_device_t *device;
+   struct input_event event;
+} udev_input_record_t;
+
+#define UDEV_INPUT_THREAD_QUEUE 1024
+
+#ifndef input_event_sec
+#define input_event_sec  time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+#endif
+
 #ifdef UDEV_XKB_HANDLING
 int init_xkb(int fd, size_t size);
 void free_xkb(void);
@@ -580,6 +616,16 @@ static int udev_input_add_device(udev_input_t *udev,
    if (ioctl(fd, EVIOCGNAME(sizeof(device->ident)), device->ident) < 0)
       device->ident[0] = '\0';
 
+#if defined(UDEV_INPUT_THREAD) && defined(EVIOCSCLOCKID)
+   /* Same clock as cpu_features_get_time_usec(), so the
+    * kernel timestamps give the full input latency */
+   if (udev->threaded)
+   {
+      int clock = CLOCK_MONOTONIC;
+      device->monotonic = ioctl(fd, EVIOCSCLOCKID, &clock) == 0;
+   }
+#endif
+
    /* UDEV_INPUT_MOUSE may report in absolute coords too */
    if (type == UDEV_INPUT_MOUSE || type == UDEV_INPUT_TOUCHPAD )
    {
@@ -695,10 +741,79 @@ end:
    return ret;
 }
 
+#ifdef UDEV_INPUT_THREAD
+static void udev_input_apply(const void *event,
+      retro_time_t time, void *data)
+{
+   const udev_input_record_t *record = (const udev_input_record_t*)event;
+   record->device->handle_cb(data, &record->event, record->device);
+}
+
+static retro_time_t udev_input_event_time(const udev_input_device_t *device,
+      const struct input_event *event)
+{
+   if (device->monotonic)
+      return (retro_time_t)event->input_event_sec * 1000000
+         + event->input_event_usec;
+   return cpu_features_get_time_usec();
+}
+
+/* Input thread: queues whatever the devices have. Events
+ * that do not fit stay in the kernel until the next call. */
+static void udev_input_drain(input_thread_t *thread, void *data)
+{
+   int i, ret;
+   struct epoll_event events[32];
+   struct input_event input_events[32];
+   udev_input_t *udev = (udev_input_t*)data;
+
+   ret = epoll_wait(udev->fd, events, ARRAY_SIZE(events), 0);
+
+   for (i = 0; i < ret; i++)
+   {
+      int j, len;
+      udev_input_record_t record;
+
+      record.device = (udev_input_device_t*)events[i].data.ptr;
+
+      /* Unplugged, stop listening until the hotplug
+       * monitor removes it on the main thread */
+      if (events[i].events & (EPOLLERR | EPOLLHUP))
+      {
+         epoll_ctl(udev->fd, EPOLL_CTL_DEL, record.device->fd, NULL);
+         continue;
+      }
+
+      while (input_thread_space(thread) >= ARRAY_SIZE(input_events)
+            && (len = read(record.device->fd,
+                  input_events, sizeof(input_events))) > 0)
+      {
+         len /= sizeof(*input_events);
+         for (j = 0; j < len; j++)
+         {
+            record.event = input_events[j];
+            input_thread_push(thread, &record,
+                  udev_input_event_time(record.device, &input_events[j]));
+         }
+      }
+   }
+}
+#endif
+
 static void udev_input_remove_device(udev_input_t *udev, const char *devnode)
 {
    unsigned i;
 
+#ifdef UDEV_INPUT_THREAD
+   /* Queued events may belong to the device, and the
+    * thread must not read it while it goes away */
+   if (udev->thread)
+   {
+      input_thread_lock(udev->thread);
+      input_thread_latch(udev->thread, udev_input_apply, udev);
+   }
+#endif
+
    for (i = 0; i < udev->num_devices; i++)
    {
       if (!string_is_equal(devnode, udev->devices[i]->devnode))
@@ -710,6 +825,11 @@ static void udev_input_remove_device(udev_input_t *udev, const char *devnode)
             (udev->num_devices - (i + 1)) * sizeof(*udev->devices));
       udev->num_devices--;
    }
+
+#ifdef UDEV_INPUT_THREAD
+   if (udev->thread)
+      input_thread_unlock(udev->thread);
+#endif
 }
 
 static void udev_input_handle_hotplug(udev_input_t *udev)
@@ -884,6 +1004,14 @@ static void udev_input_poll(void *data)
    while (udev->monitor && udev_input_poll_hotplug_available(udev->monitor))
       udev_input_handle_hotplug(udev);
 
+#ifdef UDEV_INPUT_THREAD
+   if (udev->thread)
+   {
+      input_thread_latch(udev->thread, udev_input_apply, udev);
+      return;
+   }
+#endif
+
 #if defined(HAVE_EPOLL)
    ret = epoll_wait(udev->fd, events, ARRAY_SIZE(events), 0);
 #elif defined(HAVE_KQUEUE)
@@ -1318,6 +1446,11 @@ static void udev_input_free(void *data)
    if (!data || !udev)
       return;
 
+#ifdef UDEV_INPUT_THREAD
+   input_thread_free(udev->thread);
+   udev->thread = NULL;
+#endif
+
    if (udev->fd >= 0)
       close(udev->fd);
 
@@ -1438,6 +1571,10 @@ static void *udev_input_init(const char *joypad_driver)
 
    udev->fd  = fd;
 
+#ifdef UDEV_INPUT_THREAD
+   udev->threaded = config_get_ptr()->bools.input_threaded;
+#endif
+
    if (!open_devices(udev, UDEV_INPUT_KEYBOARD, udev_handle_keyboard))
       goto error;
 
@@ -1458,6 +1595,15 @@ static void *udev_input_init(const char *joypad_driver)
    linux_terminal_disable_input();
 #endif
 
+#ifdef UDEV_INPUT_THREAD
+   /* Hotplugged devices are added to the epoll set,
+    * so the thread picks them up as well */
+   if (udev->threaded)
+      udev->thread = input_thread_new("udev", udev->fd,
+            sizeof(udev_input_record_t), UDEV_INPUT_THREAD_QUEUE,
+            udev_input_drain, udev);
+#endif
+
 #ifndef HAVE_X11
    /* TODO/FIXME - this can't be hidden behind a compile-time ifdef */
    RARCH_WARN("[udev]: Full-screen pointer won't be available.\n");
@@ -50,9 +50,14 @@
 #include "../retroarch.h"
 #include "../verbosity.h"
 #include "../configuration.h"
+#include "../frame_telemetry.h"
 #include "../list_special.h"
 #include "../performance_counters.h"
 #ifdef HAVE_BSV_MOVIE
+#include <streams/trans_stream.h>
+
+#include "../audio/audio_driver.h"
+#include "../gfx/video_driver.h"
 #include "../tasks/task_content.h"
 #endif
 #include "../tasks/tasks_internal.h"
@@ -3102,6 +3107,7 @@ void input_driver_init_command(
 {
    bool input_network_cmd_enable     = settings->bools.network_cmd_enable;
    unsigned network_cmd_port         = settings->uints.network_cmd_port;
+   bool network_cmd_stream_enable    = settings->bools.network_cmd_stream_enable;
 #ifdef HAVE_STDIN_CMD
    bool input_stdin_cmd_enable       = settings->bools.stdin_cmd_enable;
 
@@ -3130,7 +3136,8 @@ void input_driver_init_command(
 #ifdef HAVE_NETWORK_CMD
    if (input_network_cmd_enable)
    {
-      input_st->command[1] = command_network_new(network_cmd_port);
+      input_st->command[1] = command_network_new(network_cmd_port,
+            network_cmd_stream_enable);
       if (!input_st->command[1])
          RARCH_ERR("Failed to initialize the network command interface.\n");
    }
@@ -4007,6 +4014,7 @@ void input_driver_poll(void)
 #endif
    bool input_remap_binds_enable  = settings->bools.input_remap_binds_enable;
    uint8_t max_users              = (uint8_t)settings->uints.input_max_users;
+   retro_time_t poll_start        = frame_telemetry_begin();
 
    if (     joypad && joypad->poll)
       joypad->poll();
@@ -4016,6 +4024,8 @@ void input_driver_poll(void)
          && input_st->current_driver->poll)
       input_st->current_driver->poll(input_st->current_data);
 
+   frame_telemetry_end(FRAME_TELEMETRY_INPUT, poll_start);
+
    input_st->turbo_btns.count++;
 
    if (input_st->block_libretro_input)
@@ -4443,8 +4453,618 @@ void input_driver_poll(void)
 #define SERIALIZER_INDEX   1
 #define CRC_INDEX          2
 #define STATE_SIZE_INDEX   3
+/* BSV2 only */
+#define INTERVAL_INDEX     4
+#define FRAME_COUNT_INDEX  5
+#define INDEX_OFFSET_INDEX 6 /* 64-bit, low word first */
 
 #define BSV_MAGIC          0x42535631
+#define BSV2_MAGIC         0x42535632
+#define BSV2_BLOCK_MAGIC   0x4B455946
+#define BSV2_INDEX_MAGIC   0x49445832
+
+/* Frames between two keyframes. Bounds the number of
+ * frames to emulate when seeking to an arbitrary frame. */
+#define BSV2_KEYFRAME_INTERVAL 600
+
+/* BSV2 layout (all words little-endian, except for the
+ * magic which reads "BSV2" in a hex editor):
+ *
+ * header:  magic, 0, content CRC, state size,
+ *          keyframe interval, frame count, index offset (64-bit)
+ * blocks:  magic, first frame, frames, state size, stored
+ *          state size, input size, stored input size, 0,
+ *          keyframe, input records of every frame
+ * index:   magic, block count, block count * (first frame,
+ *          block offset (64-bit))
+ *
+ * Keyframes and input records are deflated, unless that
+ * does not make them smaller (i.e. stored size == size).
+ * An input record is the number of values read by the
+ * core during the frame (16-bit) followed by the values.
+ * Frame count and index offset are only written when
+ * recording ends; they are rebuilt from the blocks if
+ * they are missing. */
+
+static void bsv_movie_swap_words(uint32_t *words, size_t count)
+{
+   size_t i;
+   for (i = 0; i < count; i++)
+      words[i] = swap_if_big32(words[i]);
+}
+
+static bool bsv_movie_reserve(uint8_t **buf, size_t *cap, size_t size)
+{
+   uint8_t *tmp;
+   size_t new_cap = *cap ? *cap : 4096;
+
+   if (size <= *cap)
+      return true;
+
+   while (new_cap < size)
+      new_cap <<= 1;
+
+   if (!(tmp = (uint8_t*)realloc(*buf, new_cap)))
+      return false;
+
+   *buf = tmp;
+   *cap = new_cap;
+   return true;
+}
+
+/* Copies 'in' to handle->zbuf + offset, deflated if that
+ * makes it smaller. Returns the number of bytes written. */
+static size_t bsv_movie_pack(bsv_movie_t *handle, size_t offset,
+      const uint8_t *in, size_t len)
+{
+   uint8_t *out = handle->zbuf + offset;
+#ifdef HAVE_ZLIB
+   const struct trans_stream_backend *backend =
+      trans_stream_get_zlib_deflate_backend();
+   void *stream                               = len
+      ? backend->stream_new() : NULL;
+
+   if (stream)
+   {
+      uint32_t rd                 = 0;
+      uint32_t wn                 = 0;
+      enum trans_stream_error err = TRANS_STREAM_ERROR_OTHER;
+
+      backend->set_in(stream, in, (uint32_t)len);
+      backend->set_out(stream, out, (uint32_t)len);
+      /* Output not fitting in 'len' bytes
+       * is not an error here; store it as is */
+      if (     backend->trans(stream, true, &rd, &wn, &err)
+            && err == TRANS_STREAM_ERROR_NONE
+            && rd  == len
+            && wn  <  len)
+      {
+         backend->stream_free(stream);
+         return wn;
+      }
+      backend->stream_free(stream);
+   }
+#endif
+
+   memcpy(out, in, len);
+   return len;
+}
+
+static bool bsv_movie_unpack(const uint8_t *in, size_t stored,
+      uint8_t *out, size_t len)
+{
+   if (stored == len)
+   {
+      memcpy(out, in, len);
+      return true;
+   }
+#ifdef HAVE_ZLIB
+   {
+      uint32_t rd                 = 0;
+      uint32_t wn                 = 0;
+      bool ret                    = false;
+      const struct trans_stream_backend *backend =
+         trans_stream_get_zlib_inflate_backend();
+      void *stream                = backend->stream_new();
+
+      if (!stream)
+         return false;
+
+      backend->set_in(stream, in, (uint32_t)stored);
+      backend->set_out(stream, out, (uint32_t)len);
+      ret = backend->trans(stream, true, &rd, &wn, NULL) && wn == len;
+      backend->stream_free(stream);
+      return ret;
+   }
+#else
+   return false;
+#endif
+}
+
+static bool bsv_movie_push_block(bsv_movie_t *handle,
+      uint32_t first_frame, uint64_t offset)
+{
+   struct bsv_movie_block *block;
+
+   if (handle->blocks_count == handle->blocks_cap)
+   {
+      size_t cap                    = handle->blocks_cap
+         ? handle->blocks_cap * 2 : 64;
+      struct bsv_movie_block *tmp   = (struct bsv_movie_block*)
+         realloc(handle->blocks, cap * sizeof(*tmp));
+
+      if (!tmp)
+         return false;
+
+      handle->blocks     = tmp;
+      handle->blocks_cap = cap;
+   }
+
+   block              = &handle->blocks[handle->blocks_count++];
+   block->offset      = offset;
+   block->first_frame = first_frame;
+   return true;
+}
+
+/* Returns the index of the block holding 'frame' */
+static size_t bsv_movie_find_block(bsv_movie_t *handle, uint32_t frame)
+{
+   size_t lo = 0;
+   size_t hi = handle->blocks_count;
+
+   while (hi - lo > 1)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      if (handle->blocks[mid].first_frame <= frame)
+         lo = mid;
+      else
+         hi = mid;
+   }
+
+   return lo;
+}
+
+static void bsv_movie_capture_keyframe(bsv_movie_t *handle)
+{
+   retro_ctx_serialize_info_t serial_info;
+
+   if (!handle->state_size)
+      return;
+
+   serial_info.data = handle->state;
+   serial_info.size = handle->state_size;
+   core_serialize(&serial_info);
+}
+
+/* Puts the core back into the state held by the
+ * loaded block. Fails when the core can't take it. */
+static bool bsv_movie_restore_keyframe(bsv_movie_t *handle)
+{
+   retro_ctx_size_info_t info;
+   retro_ctx_serialize_info_t serial_info;
+
+   if (!handle->state_size)
+      return true;
+
+   core_serialize_size(&info);
+
+   if (info.size != handle->state_size)
+   {
+      RARCH_WARN("%s\n",
+            msg_hash_to_str(MSG_MOVIE_FORMAT_DIFFERENT_SERIALIZER_VERSION));
+      return false;
+   }
+
+   serial_info.data_const = handle->state;
+   serial_info.size       = handle->state_size;
+   return core_unserialize(&serial_info);
+}
+
+/* Makes block 'idx' the current block. If 'restore' is set,
+ * its keyframe is also loaded into the core. */
+static bool bsv_movie_load_block(bsv_movie_t *handle, size_t idx,
+      bool restore)
+{
+   uint32_t i;
+   size_t pos                    = 0;
+   uint32_t header[8]            = {0};
+   struct bsv_movie_block *block = &handle->blocks[idx];
+
+   if (     intfstream_seek(handle->file, (int64_t)block->offset,
+               SEEK_SET) < 0
+         || intfstream_read(handle->file, header, sizeof(header))
+               != sizeof(header))
+      return false;
+
+   bsv_movie_swap_words(header, 8);
+
+   if (     header[0] != BSV2_BLOCK_MAGIC
+         || header[1] != block->first_frame
+         || header[2] >  handle->interval
+         || header[3] != handle->state_size
+         || header[4] >  header[3]
+         || header[6] >  header[5])
+      return false;
+
+   if (     !bsv_movie_reserve(&handle->zbuf, &handle->zbuf_size,
+               header[4] + header[6])
+         || !bsv_movie_reserve(&handle->input, &handle->input_cap,
+               header[5])
+         || intfstream_read(handle->file, handle->zbuf,
+               header[4] + header[6]) != header[4] + header[6]
+         || !bsv_movie_unpack(handle->zbuf, header[4],
+               handle->state, header[3])
+         || !bsv_movie_unpack(handle->zbuf + header[4], header[6],
+               handle->input, header[5]))
+      return false;
+
+   for (i = 0; i < header[2]; i++)
+   {
+      uint16_t count;
+
+      if (pos + 2 > header[5])
+         return false;
+
+      memcpy(&count, handle->input + pos, 2);
+      handle->frame_offsets[i] = (uint32_t)pos;
+      pos                     += 2 + 2 * (size_t)swap_if_big16(count);
+   }
+
+   if (pos > header[5])
+      return false;
+
+   handle->block        = idx;
+   handle->block_frames = header[2];
+   handle->input_size   = header[5];
+   handle->block_loaded = true;
+
+   if (restore)
+      return bsv_movie_restore_keyframe(handle);
+
+   return true;
+}
+
+/* Writes out the current block, leaving the file
+ * position right after it */
+static bool bsv_movie_flush_block(bsv_movie_t *handle)
+{
+   size_t state_stored, input_stored;
+   uint32_t header[8];
+   struct bsv_movie_block *block = &handle->blocks[handle->block];
+
+   if (!bsv_movie_reserve(&handle->zbuf, &handle->zbuf_size,
+            handle->state_size + handle->input_size))
+      return false;
+
+   state_stored = bsv_movie_pack(handle, 0,
+         handle->state, handle->state_size);
+   input_stored = bsv_movie_pack(handle, state_stored,
+         handle->input, handle->input_size);
+
+   header[0]    = BSV2_BLOCK_MAGIC;
+   header[1]    = block->first_frame;
+   header[2]    = handle->block_frames;
+   header[3]    = (uint32_t)handle->state_size;
+   header[4]    = (uint32_t)state_stored;
+   header[5]    = (uint32_t)handle->input_size;
+   header[6]    = (uint32_t)input_stored;
+   header[7]    = 0;
+   bsv_movie_swap_words(header, 8);
+
+   return intfstream_seek(handle->file, (int64_t)block->offset,
+            SEEK_SET) >= 0
+      && intfstream_write(handle->file, header, sizeof(header))
+            == sizeof(header)
+      && intfstream_write(handle->file, handle->zbuf,
+            state_stored + input_stored)
+            == (int64_t)(state_stored + input_stored);
+}
+
+/* Starts a new block at the current frame, with the
+ * current core state as keyframe */
+static bool bsv_movie_begin_block(bsv_movie_t *handle, uint64_t offset)
+{
+   if (!bsv_movie_push_block(handle, handle->frame, offset))
+      return false;
+
+   handle->block        = handle->blocks_count - 1;
+   handle->block_frames = 0;
+   handle->input_size   = 0;
+   handle->block_loaded = true;
+
+   bsv_movie_capture_keyframe(handle);
+   return true;
+}
+
+/* Drops everything recorded from the current frame on,
+ * after a rewind */
+static bool bsv_movie_truncate(bsv_movie_t *handle)
+{
+   uint32_t idx;
+
+   if (handle->frame < handle->blocks[handle->block].first_frame)
+   {
+      size_t block = bsv_movie_find_block(handle, handle->frame);
+
+      if (!bsv_movie_load_block(handle, block, false))
+         return false;
+
+      handle->blocks_count = block + 1;
+   }
+
+   idx                  = handle->frame
+      - handle->blocks[handle->block].first_frame;
+   handle->input_size   = handle->frame_offsets[idx];
+   handle->block_frames = idx;
+
+   /* Mirror BSV1: rewinding to the start of a
+    * block resets its starting point */
+   if (!idx)
+      bsv_movie_capture_keyframe(handle);
+
+   return true;
+}
+
+static void bsv_movie_begin_frame_v2(bsv_movie_t *handle)
+{
+   uint32_t idx;
+   struct bsv_movie_block *block;
+
+   handle->frame_values = 0;
+
+   if (handle->playback)
+   {
+      uint16_t count;
+
+      if (handle->frame >= handle->frame_count)
+         return;
+
+      block = &handle->blocks[handle->block];
+
+      if (     !handle->block_loaded
+            || handle->frame <  block->first_frame
+            || handle->frame >= block->first_frame + handle->block_frames)
+      {
+         if (!bsv_movie_load_block(handle,
+                  bsv_movie_find_block(handle, handle->frame), false))
+         {
+            RARCH_ERR("[BSV]: Movie is corrupt at frame %u.\n",
+                  handle->frame);
+            handle->frame_count = handle->frame;
+            return;
+         }
+         block = &handle->blocks[handle->block];
+      }
+
+      /* A block can be shorter than the interval
+       * if it was recorded last */
+      if (handle->frame >= block->first_frame + handle->block_frames)
+      {
+         handle->frame_count = handle->frame;
+         return;
+      }
+
+      idx                  = handle->frame - block->first_frame;
+      handle->input_ptr    = handle->frame_offsets[idx] + 2;
+      memcpy(&count, handle->input + handle->frame_offsets[idx], 2);
+      handle->frame_values = swap_if_big16(count);
+      return;
+   }
+
+   if (handle->frame < handle->blocks[handle->block].first_frame
+         + handle->block_frames)
+      bsv_movie_truncate(handle);
+
+   block = &handle->blocks[handle->block];
+
+   if (handle->frame - block->first_frame >= handle->interval)
+   {
+      if (  !bsv_movie_flush_block(handle)
+          || !bsv_movie_begin_block(handle,
+             (uint64_t)intfstream_tell(handle->file)))
+         RARCH_ERR("[BSV]: Failed to write movie block.\n");
+      block = &handle->blocks[handle->block];
+   }
+
+   idx = handle->frame - block->first_frame;
+
+   if (!bsv_movie_reserve(&handle->input, &handle->input_cap,
+            handle->input_size + 2))
+      return;
+
+   handle->frame_offsets[idx]  = (uint32_t)handle->input_size;
+   handle->input_size         += 2;
+}
+
+static void bsv_movie_end_frame_v2(bsv_movie_t *handle)
+{
+   if (!handle->playback)
+   {
+      uint32_t idx   = handle->frame
+         - handle->blocks[handle->block].first_frame;
+      uint16_t count = swap_if_big16((uint16_t)handle->frame_values);
+
+      memcpy(handle->input + handle->frame_offsets[idx], &count, 2);
+      handle->block_frames = idx + 1;
+   }
+   else if (handle->frame >= handle->frame_count)
+      return;
+
+   handle->frame++;
+}
+
+static bool bsv_movie_read_input(bsv_movie_t *handle, int16_t *value)
+{
+   if (handle->version == 2)
+   {
+      int16_t v = 0;
+
+      if (handle->frame >= handle->frame_count)
+         return false;
+
+      /* The core reads more than it did
+       * when recording; it must have desynced */
+      if (handle->frame_values)
+      {
+         memcpy(&v, handle->input + handle->input_ptr, 2);
+         handle->input_ptr += 2;
+         handle->frame_values--;
+      }
+
+      *value = swap_if_big16(v);
+      return true;
+   }
+
+   if (intfstream_read(handle->file, value, 2) != 2)
+      return false;
+
+   *value = swap_if_big16(*value);
+   return true;
+}
+
+static void bsv_movie_write_input(bsv_movie_t *handle, int16_t value)
+{
+   value = swap_if_big16(value);
+
+   if (handle->version != 2)
+   {
+      intfstream_write(handle->file, &value, 2);
+      return;
+   }
+
+   if (     handle->frame_values >= 0xFFFF
+         || !bsv_movie_reserve(&handle->input, &handle->input_cap,
+            handle->input_size + 2))
+      return;
+
+   memcpy(handle->input + handle->input_size, &value, 2);
+   handle->input_size += 2;
+   handle->frame_values++;
+}
+
+/* Rebuilds the index of a movie whose recording was
+ * not ended properly */
+static bool bsv_movie_scan_blocks(bsv_movie_t *handle)
+{
+   uint64_t offset = handle->min_file_pos;
+
+   handle->frame_count = 0;
+
+   for (;;)
+   {
+      uint32_t header[8];
+
+      if (     intfstream_seek(handle->file, (int64_t)offset, SEEK_SET) < 0
+            || intfstream_read(handle->file, header, sizeof(header))
+                  != sizeof(header))
+         break;
+
+      bsv_movie_swap_words(header, 8);
+
+      if (     header[0] != BSV2_BLOCK_MAGIC
+            || header[1] != handle->frame_count
+            || !bsv_movie_push_block(handle, header[1], offset))
+         break;
+
+      handle->frame_count = header[1] + header[2];
+      offset             += sizeof(header) + header[4] + header[6];
+
+      /* The next block would start on the same frame */
+      if (!header[2])
+         break;
+   }
+
+   return handle->blocks_count > 0;
+}
+
+static bool bsv_movie_read_index(bsv_movie_t *handle, uint64_t offset)
+{
+   uint32_t i;
+   uint32_t header[2];
+
+   if (     intfstream_seek(handle->file, (int64_t)offset, SEEK_SET) < 0
+         || intfstream_read(handle->file, header, sizeof(header))
+               != sizeof(header))
+      return false;
+
+   bsv_movie_swap_words(header, 2);
+
+   if (header[0] != BSV2_INDEX_MAGIC || !header[1])
+      return false;
+
+   for (i = 0; i < header[1]; i++)
+   {
+      uint32_t entry[3];
+
+      if (intfstream_read(handle->file, entry, sizeof(entry))
+            != sizeof(entry))
+         return false;
+
+      bsv_movie_swap_words(entry, 3);
+
+      /* Blocks are looked up by bisection */
+      if (     (!handle->blocks_count && entry[0])
+            || (handle->blocks_count && entry[0] <=
+               handle->blocks[handle->blocks_count - 1].first_frame))
+         return false;
+
+      if (!bsv_movie_push_block(handle, entry[0],
+               entry[1] | ((uint64_t)entry[2] << 32)))
+         return false;
+   }
+
+   return true;
+}
+
+static bool bsv_movie_init_playback_v2(bsv_movie_t *handle,
+      const uint32_t *header)
+{
+   uint32_t ext[4];
+   uint64_t index_offset;
+
+   if (intfstream_read(handle->file, ext, sizeof(ext)) != sizeof(ext))
+      return false;
+
+   bsv_movie_swap_words(ext, 4);
+
+   handle->version      = 2;
+   handle->state_size   = swap_if_big32(header[STATE_SIZE_INDEX]);
+   handle->interval     = ext[INTERVAL_INDEX - 4];
+   handle->frame_count  = ext[FRAME_COUNT_INDEX - 4];
+   handle->min_file_pos = 8 * sizeof(uint32_t);
+   index_offset         = ext[INDEX_OFFSET_INDEX - 4]
+      | ((uint64_t)ext[INDEX_OFFSET_INDEX - 3] << 32);
+
+   if (!handle->interval || handle->interval > (1 << 20))
+      return false;
+
+   if (     (handle->state_size
+            && !(handle->state = (uint8_t*)malloc(handle->state_size)))
+         || !(handle->frame_offsets = (uint32_t*)malloc(
+               handle->interval * sizeof(uint32_t))))
+      return false;
+
+   if (!index_offset || !bsv_movie_read_index(handle, index_offset))
+   {
+      RARCH_WARN("[BSV]: Movie has no index, recording was not "
+            "ended properly. Scanning blocks.\n");
+      handle->blocks_count = 0;
+      if (!bsv_movie_scan_blocks(handle))
+         return false;
+   }
+
+   if (!bsv_movie_load_block(handle, 0, false))
+   {
+      RARCH_ERR("%s\n", msg_hash_to_str(MSG_COULD_NOT_READ_STATE_FROM_MOVIE));
+      return false;
+   }
+
+   /* Like BSV1, play on from the current state when
+    * the core can't take the one the movie starts from */
+   bsv_movie_restore_keyframe(handle);
+
+   return true;
+}
 
 static bool bsv_movie_init_playback(
       bsv_movie_t *handle, const char *path)
@@ -4452,6 +5072,7 @@ static bool bsv_movie_init_playback(
    uint32_t state_size       = 0;
    uint32_t content_crc      = 0;
    uint32_t header[4]        = {0};
+   bool bsv2                 = false;
    intfstream_t *file        = intfstream_open_file(path,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
@@ -4466,9 +5087,12 @@ static bool bsv_movie_init_playback(
    handle->playback          = true;
 
    intfstream_read(handle->file, header, sizeof(uint32_t) * 4);
+   bsv2                      =
+      swap_if_little32(header[MAGIC_INDEX]) == BSV2_MAGIC;
    /* Compatibility with old implementation that
     * used incorrect documentation. */
-   if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
+   if (     !bsv2
+         && swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
          && swap_if_big32(header[MAGIC_INDEX]) != BSV_MAGIC)
    {
       RARCH_ERR("%s\n", msg_hash_to_str(MSG_MOVIE_FILE_IS_NOT_A_VALID_BSV1_FILE));
@@ -4481,6 +5105,10 @@ static bool bsv_movie_init_playback(
       if (swap_if_big32(header[CRC_INDEX]) != content_crc)
          RARCH_WARN("%s.\n", msg_hash_to_str(MSG_CRC32_CHECKSUM_MISMATCH));
 
+   if (bsv2)
+      return bsv_movie_init_playback_v2(handle, header);
+
+   handle->version           = 1;
    state_size = swap_if_big32(header[STATE_SIZE_INDEX]);
 
 #if 0
@@ -4530,11 +5158,11 @@ static bool bsv_movie_init_record(
       bsv_movie_t *handle, const char *path)
 {
    retro_ctx_size_info_t info;
-   uint32_t state_size       = 0;
    uint32_t content_crc      = 0;
-   uint32_t header[4]        = {0};
+   uint32_t header[8]        = {0};
+   /* Blocks are read back when rewinding */
    intfstream_t *file        = intfstream_open_file(path,
-         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
    if (!file)
@@ -4544,54 +5172,106 @@ static bool bsv_movie_init_record(
    }
 
    handle->file             = file;
+   handle->version          = 2;
+   handle->interval         = BSV2_KEYFRAME_INTERVAL;
 
    content_crc              = content_get_crc();
 
    /* This value is supposed to show up as
-    * BSV1 in a HEX editor, big-endian. */
-   header[MAGIC_INDEX]      = swap_if_little32(BSV_MAGIC);
+    * BSV2 in a HEX editor, big-endian. */
+   header[MAGIC_INDEX]      = swap_if_little32(BSV2_MAGIC);
    header[CRC_INDEX]        = swap_if_big32(content_crc);
 
    core_serialize_size(&info);
 
-   state_size               = (unsigned)info.size;
+   handle->state_size       = info.size;
 
-   header[STATE_SIZE_INDEX] = swap_if_big32(state_size);
+   header[STATE_SIZE_INDEX] = swap_if_big32((uint32_t)handle->state_size);
+   header[INTERVAL_INDEX]   = swap_if_big32(handle->interval);
 
-   intfstream_write(handle->file, header, 4 * sizeof(uint32_t));
+   if (intfstream_write(handle->file, header, sizeof(header))
+         != sizeof(header))
+      return false;
 
-   handle->min_file_pos     = sizeof(header) + state_size;
-   handle->state_size       = state_size;
+   handle->min_file_pos     = sizeof(header);
 
-   if (state_size)
-   {
-      retro_ctx_serialize_info_t serial_info;
-      uint8_t *st      = (uint8_t*)malloc(state_size);
+   if (     (handle->state_size
+            && !(handle->state = (uint8_t*)malloc(handle->state_size)))
+         || !(handle->frame_offsets = (uint32_t*)malloc(
+               handle->interval * sizeof(uint32_t))))
+      return false;
 
-      if (!st)
-         return false;
+   return bsv_movie_begin_block(handle, handle->min_file_pos);
+}
 
-      handle->state    = st;
+/* Writes the last block and the index, and fills in
+ * the header fields only known at the end */
+static bool bsv_movie_finish_record(bsv_movie_t *handle)
+{
+   size_t i;
+   int64_t index_offset;
+   uint32_t words[3];
 
-      serial_info.data = handle->state;
-      serial_info.size = state_size;
+   if (     handle->frame < handle->blocks[handle->block].first_frame
+            + handle->block_frames
+         && !bsv_movie_truncate(handle))
+      return false;
 
-      core_serialize(&serial_info);
+   if (!bsv_movie_flush_block(handle))
+      return false;
 
-      intfstream_write(handle->file,
-            handle->state, state_size);
+   if ((index_offset = intfstream_tell(handle->file)) < 0)
+      return false;
+
+   words[0] = BSV2_INDEX_MAGIC;
+   words[1] = (uint32_t)handle->blocks_count;
+   bsv_movie_swap_words(words, 2);
+
+   if (intfstream_write(handle->file, words, 2 * sizeof(uint32_t))
+         != 2 * sizeof(uint32_t))
+      return false;
+
+   for (i = 0; i < handle->blocks_count; i++)
+   {
+      words[0] = handle->blocks[i].first_frame;
+      words[1] = (uint32_t)handle->blocks[i].offset;
+      words[2] = (uint32_t)(handle->blocks[i].offset >> 32);
+      bsv_movie_swap_words(words, 3);
+
+      if (intfstream_write(handle->file, words, sizeof(words))
+            != sizeof(words))
+         return false;
    }
 
-   return true;
+   words[0] = handle->frame;
+   words[1] = (uint32_t)index_offset;
+   words[2] = (uint32_t)((uint64_t)index_offset >> 32);
+   bsv_movie_swap_words(words, 3);
+
+   return intfstream_seek(handle->file,
+            FRAME_COUNT_INDEX * sizeof(uint32_t), SEEK_SET) >= 0
+      && intfstream_write(handle->file, words, sizeof(words))
+            == sizeof(words);
 }
 
 static void bsv_movie_free(bsv_movie_t *handle)
 {
+   if (     handle->file
+         && handle->version == 2
+         && !handle->playback
+         && handle->blocks_count
+         && !bsv_movie_finish_record(handle))
+      RARCH_ERR("[BSV]: Failed to finalize movie file.\n");
+
    intfstream_close(handle->file);
    free(handle->file);
 
    free(handle->state);
    free(handle->frame_pos);
+   free(handle->blocks);
+   free(handle->input);
+   free(handle->zbuf);
+   free(handle->frame_offsets);
    free(handle);
 }
 
@@ -4612,6 +5292,10 @@ static bsv_movie_t *bsv_movie_init_internal(const char *path,
    else if (!bsv_movie_init_record(handle, path))
       goto error;
 
+   /* BSV2 tracks frames itself */
+   if (handle->version == 2)
+      return handle;
+
    /* Just pick something really large
     * ~1 million frames rewind should do the trick. */
    if (!(frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
@@ -4686,6 +5370,16 @@ void bsv_movie_frame_rewind(void)
 
    handle->did_rewind = true;
 
+   if (handle->version == 2)
+   {
+      /* Same as below; the block holding the frame
+       * is loaded when the frame starts */
+      uint32_t frames = handle->first_rewind ? 1 : 2;
+      handle->frame   = (handle->frame > frames)
+         ? handle->frame - frames : 0;
+      return;
+   }
+
    if (     (handle->frame_ptr <= 1)
          && (handle->frame_pos[0] == handle->min_file_pos))
    {
@@ -4732,6 +5426,87 @@ void bsv_movie_frame_rewind(void)
    }
 }
 
+void bsv_movie_begin_frame(input_driver_state_t *input_st)
+{
+   bsv_movie_t *handle = input_st->bsv_movie_state_handle;
+
+   if (!handle)
+      return;
+
+   if (handle->version == 2)
+      bsv_movie_begin_frame_v2(handle);
+   else /* Used for rewinding while playback/record. */
+      handle->frame_pos[handle->frame_ptr] =
+         intfstream_tell(handle->file);
+}
+
+void bsv_movie_end_frame(input_driver_state_t *input_st)
+{
+   bsv_movie_t *handle = input_st->bsv_movie_state_handle;
+
+   if (!handle)
+      return;
+
+   if (handle->version == 2)
+      bsv_movie_end_frame_v2(handle);
+   else
+      handle->frame_ptr  = (handle->frame_ptr + 1) & handle->frame_mask;
+
+   handle->first_rewind  = !handle->did_rewind;
+   handle->did_rewind    = false;
+}
+
+bool bsv_movie_seek(input_driver_state_t *input_st, uint32_t frame)
+{
+   size_t block;
+   bool video_active, audio_suspended;
+   video_driver_state_t *video_st = video_state_get_ptr();
+   audio_driver_state_t *audio_st = audio_state_get_ptr();
+   bsv_movie_t *handle            = input_st->bsv_movie_state_handle;
+
+   if (     !handle
+         || !handle->playback
+         || handle->version != 2
+         || frame > handle->frame_count)
+      return false;
+
+   block = bsv_movie_find_block(handle, frame);
+
+   if (!bsv_movie_load_block(handle, block, true))
+      return false;
+
+   handle->frame       = handle->blocks[block].first_frame;
+
+   /* Run up to the requested frame from the keyframe,
+    * without presenting anything */
+   video_active        = video_st->active;
+   audio_suspended     = audio_st->suspended;
+   video_st->active    = false;
+   audio_st->suspended = true;
+
+   while (handle->frame < frame)
+   {
+      /* A corrupt block cuts the movie short at the
+       * frame it starts on, so the target may never come */
+      if (handle->frame >= handle->frame_count)
+         break;
+      bsv_movie_begin_frame_v2(handle);
+      if (handle->frame >= handle->frame_count)
+         break;
+      core_run();
+      bsv_movie_end_frame_v2(handle);
+   }
+
+   video_st->active    = video_active;
+   audio_st->suspended = audio_suspended;
+
+   /* States held for rewinding are from before the seek */
+   command_event(CMD_EVENT_REWIND_DEINIT, NULL);
+   command_event(CMD_EVENT_REWIND_INIT, NULL);
+
+   return handle->frame == frame;
+}
+
 bool bsv_movie_init(input_driver_state_t *input_st)
 {
    bsv_movie_t *state = NULL;
@@ -5022,16 +5797,6 @@ int16_t input_state_internal(unsigned port, unsigned device,
          result |= port_result;
    }
 
-#ifdef HAVE_BSV_MOVIE
-   /* Save input to BSV record, if enabled */
-   if (BSV_MOVIE_IS_PLAYBACK_OFF())
-   {
-      result = swap_if_big16(result);
-      intfstream_write(
-            input_st->bsv_movie_state_handle->file, &result, 2);
-   }
-#endif
-
    return result;
 }
 
@@ -5046,14 +5811,13 @@ int16_t input_driver_state_wrapper(unsigned port, unsigned device,
    if (BSV_MOVIE_IS_PLAYBACK_ON())
    {
       int16_t bsv_result = 0;
-      if (intfstream_read(
-               input_st->bsv_movie_state_handle->file,
-               &bsv_result, 2) == 2)
+      if (bsv_movie_read_input(
+               input_st->bsv_movie_state_handle, &bsv_result))
       {
 #ifdef HAVE_CHEEVOS
          rcheevos_pause_hardcore();
 #endif
-         return swap_if_big16(bsv_result);
+         return bsv_result;
       }
 
       input_st->bsv_movie_state.movie_end = true;
@@ -5073,10 +5837,7 @@ int16_t input_driver_state_wrapper(unsigned port, unsigned device,
 #ifdef HAVE_BSV_MOVIE
    /* Save input to BSV record, if enabled */
    if (BSV_MOVIE_IS_PLAYBACK_OFF())
-   {
-      result = swap_if_big16(result);
-      intfstream_write(input_st->bsv_movie_state_handle->file, &result, 2);
-   }
+      bsv_movie_write_input(input_st->bsv_movie_state_handle, result);
 #endif
 
    return result;
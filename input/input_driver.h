@@ -992,6 +992,17 @@ int16_t input_state_device(
 #ifdef HAVE_BSV_MOVIE
 void bsv_movie_frame_rewind(void);
 
+/* Must bracket every frame run while a movie is
+ * played back or recorded */
+void bsv_movie_begin_frame(input_driver_state_t *input_st);
+
+void bsv_movie_end_frame(input_driver_state_t *input_st);
+
+/* Restores the keyframe preceding 'frame' and runs the
+ * core up to it. Only BSV2 movies being played back can
+ * be seeked. Returns false on failure. */
+bool bsv_movie_seek(input_driver_state_t *input_st, uint32_t frame);
+
 bool bsv_movie_init(input_driver_state_t *input_st);
 
 void bsv_movie_deinit(input_driver_state_t *input_st);
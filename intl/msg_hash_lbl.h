@@ -2016,6 +2016,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_NETWORK_CMD_PORT,
    "network_cmd_port"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETWORK_CMD_STREAM_ENABLE,
+   "network_cmd_stream_enable"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_NETWORK_INFORMATION,
    "network_information"
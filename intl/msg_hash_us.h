@@ -5439,6 +5439,14 @@ MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETWORK_CMD_PORT,
    "Network Command Port"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETWORK_CMD_STREAM_ENABLE,
+   "Network Command Stream Connections"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETWORK_CMD_STREAM_ENABLE,
+   "Also accept commands over TCP on the network command port, for clients that need replies in order or binary memory access."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETWORK_REMOTE_ENABLE,
    "Network RetroPad"
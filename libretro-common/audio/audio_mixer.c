@@ -31,12 +31,28 @@
 #include <formats/rwav.h>
 #endif
 #include <memalign.h>
+#include <compat/strl.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define AUDIO_MIXER_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AUDIO_MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+/* The decode thread hands PCM over to audio_mixer_mix()
+ * through lock-free rings, which need atomics */
+#if defined(HAVE_THREADS) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define AUDIO_MIXER_DECODE_THREAD
+#include <rthreads/rthreads.h>
+#endif
+
 #ifdef HAVE_STB_VORBIS
 #define STB_VORBIS_NO_PUSHDATA_API
 #define STB_VORBIS_NO_STDIO
@@ -75,6 +91,12 @@ struct audio_mixer_sound
          /* wav */
          const float* pcm;
          unsigned frames;
+         /* Sample rate of 'pcm' if it was left to be
+          * resampled on playback, 0 if already at the
+          * mixer rate */
+         unsigned rate;
+         enum resampler_quality quality;
+         char resampler_ident[32];
       } wav;
 
 #ifdef HAVE_STB_VORBIS
@@ -122,6 +144,13 @@ struct audio_mixer_voice
       struct
       {
          unsigned position;
+         /* Only used when resampling on playback */
+         void        *resampler_data;
+         const retro_resampler_t *resampler;
+         float       *buffer;
+         unsigned    buf_position;
+         unsigned    buf_samples;
+         float       ratio;
       } wav;
 
 #ifdef HAVE_STB_VORBIS
@@ -189,6 +218,165 @@ struct audio_mixer_voice
 /* TODO/FIXME - static globals */
 static struct audio_mixer_voice s_voices[AUDIO_MIXER_MAX_VOICES] = {0};
 static unsigned s_rate = 0;
+static unsigned s_underruns = 0;
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+/* Size of the PCM ring of each streamed voice, in samples
+ * (must be a power of two). ~170ms of stereo at 48kHz. */
+#define AUDIO_MIXER_RING_SAMPLES  16384
+/* Samples decoded by the thread at a time */
+#define AUDIO_MIXER_DECODE_CHUNK  2048
+/* Ring top-up interval while any voice is streaming */
+#define AUDIO_MIXER_DECODE_PERIOD 10000
+
+#if defined(_MSC_VER)
+#include <windows.h>
+typedef LONG audio_mixer_atomic_t;
+#define audio_mixer_atomic_add(p, v) InterlockedExchangeAdd((p), (LONG)(v))
+#else
+typedef unsigned audio_mixer_atomic_t;
+#define audio_mixer_atomic_add(p, v) __sync_fetch_and_add((p), (v))
+#endif
+/* Full barriers on both */
+#define audio_mixer_atomic_load(p)   ((unsigned)audio_mixer_atomic_add((p), 0))
+
+/* A voice decoded on the thread.
+ *
+ * All decoding happens on 'decoder', a private voice that
+ * the thread runs through the regular mixing functions, into
+ * 'ring'. The thread is the only writer of 'write', 'repeats'
+ * and 'finished', audio_mixer_mix() the only writer of 'read'.
+ * 'decoder' and 'active' are only touched with s_decode_lock
+ * held. */
+struct audio_mixer_stream
+{
+   struct audio_mixer_voice decoder;
+   float *ring;
+   audio_mixer_atomic_t write;
+   audio_mixer_atomic_t read;
+   audio_mixer_atomic_t repeats;
+   audio_mixer_atomic_t finished;
+   enum audio_mixer_type decoder_type;
+   unsigned repeats_seen;
+   bool active;
+   bool started;
+};
+
+static struct audio_mixer_stream s_streams[AUDIO_MIXER_MAX_VOICES];
+static sthread_t *s_decode_thread                 = NULL;
+static slock_t *s_decode_lock                     = NULL;
+static scond_t *s_decode_cond                     = NULL;
+static struct audio_mixer_stream *s_decode_stream = NULL;
+static bool s_decode_quit                         = false;
+#endif
+
+/* Adds 'samples' samples of 'in' scaled by 'volume' to 'out' */
+static void audio_mixer_mix_pcm(float *out, const float *in,
+      unsigned samples, float volume)
+{
+   unsigned i = 0;
+#if defined(AUDIO_MIXER_SSE)
+   __m128 vol = _mm_set1_ps(volume);
+
+   for (; i + 4 <= samples; i += 4)
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i),
+               _mm_mul_ps(_mm_loadu_ps(in + i), vol)));
+#elif defined(AUDIO_MIXER_NEON)
+   float32x4_t vol = vdupq_n_f32(volume);
+
+   for (; i + 4 <= samples; i += 4)
+      vst1q_f32(out + i, vmlaq_f32(vld1q_f32(out + i),
+               vld1q_f32(in + i), vol));
+#endif
+
+   for (; i < samples; i++)
+      out[i] += in[i] * volume;
+}
+
+static void audio_mixer_free_wav(audio_mixer_voice_t* voice)
+{
+   if (voice->types.wav.resampler && voice->types.wav.resampler_data)
+      voice->types.wav.resampler->free(voice->types.wav.resampler_data);
+   if (voice->types.wav.buffer)
+      memalign_free(voice->types.wav.buffer);
+
+   voice->types.wav.resampler      = NULL;
+   voice->types.wav.resampler_data = NULL;
+   voice->types.wav.buffer         = NULL;
+}
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+/* Frees whatever the last sound played on 'stream' left
+ * in its decoder. Must be called with s_decode_lock held. */
+static void audio_mixer_stream_free(struct audio_mixer_stream *stream)
+{
+   audio_mixer_voice_t *decoder = &stream->decoder;
+
+   switch (stream->decoder_type)
+   {
+      case AUDIO_MIXER_TYPE_WAV:
+         audio_mixer_free_wav(decoder);
+         break;
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         if (decoder->types.ogg.stream)
+            stb_vorbis_close(decoder->types.ogg.stream);
+         if (decoder->types.ogg.resampler && decoder->types.ogg.resampler_data)
+            decoder->types.ogg.resampler->free(decoder->types.ogg.resampler_data);
+         if (decoder->types.ogg.buffer)
+            memalign_free(decoder->types.ogg.buffer);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         if (decoder->types.mod.stream)
+            dispose_replay(decoder->types.mod.stream);
+         if (decoder->types.mod.buffer)
+            memalign_free(decoder->types.mod.buffer);
+         if (decoder->types.mod.module)
+            dispose_module(decoder->types.mod.module);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         if (decoder->types.flac.stream)
+            drflac_close(decoder->types.flac.stream);
+         if (decoder->types.flac.resampler && decoder->types.flac.resampler_data)
+            decoder->types.flac.resampler->free(decoder->types.flac.resampler_data);
+         if (decoder->types.flac.buffer)
+            memalign_free(decoder->types.flac.buffer);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         if (decoder->types.mp3.stream.pData)
+            drmp3_uninit(&decoder->types.mp3.stream);
+         if (decoder->types.mp3.resampler && decoder->types.mp3.resampler_data)
+            decoder->types.mp3.resampler->free(decoder->types.mp3.resampler_data);
+         if (decoder->types.mp3.buffer)
+            memalign_free(decoder->types.mp3.buffer);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_NONE:
+         break;
+   }
+
+   memset(decoder, 0, sizeof(*decoder));
+   stream->decoder_type = AUDIO_MIXER_TYPE_NONE;
+}
+
+/* Takes 'stream' away from the decode thread */
+static void audio_mixer_stream_release(struct audio_mixer_stream *stream)
+{
+   if (!stream->active && stream->decoder_type == AUDIO_MIXER_TYPE_NONE)
+      return;
+
+   slock_lock(s_decode_lock);
+   audio_mixer_stream_free(stream);
+   stream->active = false;
+   slock_unlock(s_decode_lock);
+}
+#endif
 
 #ifdef HAVE_RWAV
 static bool wav_to_float(const rwav_t* wav, float** pcm, size_t samples_out)
@@ -314,14 +502,6 @@ void audio_mixer_init(unsigned rate)
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
 }
 
-void audio_mixer_done(void)
-{
-   unsigned i;
-
-   for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
-      s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
-}
-
 audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size,
       const char *resampler_ident, enum resampler_quality quality)
 {
@@ -331,6 +511,8 @@ audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size,
    /* WAV samples converted to float */
    float* pcm                 = NULL;
    size_t samples             = 0;
+   /* Rate to resample from on playback */
+   unsigned rate              = 0;
    /* Result */
    audio_mixer_sound_t* sound = NULL;
 
@@ -349,6 +531,13 @@ audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size,
    if (!wav_to_float(&wav, &pcm, samples))
       return NULL;
 
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   /* With the decode thread running, resampling is
+    * left to it on playback instead */
+   if (wav.samplerate != s_rate && s_decode_thread)
+      rate = wav.samplerate;
+   else
+#endif
    if (wav.samplerate != s_rate)
    {
       float* resampled           = NULL;
@@ -374,6 +563,15 @@ audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size,
    sound->types.wav.frames = (unsigned)(samples / 2);
    sound->types.wav.pcm    = pcm;
 
+   if (rate)
+   {
+      sound->types.wav.rate    = rate;
+      sound->types.wav.quality = quality;
+      if (resampler_ident)
+         strlcpy(sound->types.wav.resampler_ident, resampler_ident,
+               sizeof(sound->types.wav.resampler_ident));
+   }
+
    rwav_free(&wav);
 
    return sound;
@@ -457,9 +655,20 @@ audio_mixer_sound_t* audio_mixer_load_mod(void *buffer, int32_t size)
 void audio_mixer_destroy(audio_mixer_sound_t* sound)
 {
    void *handle = NULL;
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   unsigned i;
+#endif
    if (!sound)
       return;
 
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   /* The thread may still be decoding it */
+   if (s_decode_thread)
+      for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+         if (s_streams[i].decoder.sound == sound)
+            audio_mixer_stream_release(&s_streams[i]);
+#endif
+
    switch (sound->type)
    {
       case AUDIO_MIXER_TYPE_WAV:
@@ -506,7 +715,47 @@ static bool audio_mixer_play_wav(audio_mixer_sound_t* sound,
       audio_mixer_voice_t* voice, bool repeat, float volume,
       audio_mixer_stop_cb_t stop_cb)
 {
-   voice->types.wav.position = 0;
+   float ratio                     = 1.0f;
+   unsigned samples                = 0;
+   void *wav_buffer                = NULL;
+   void *resampler_data            = NULL;
+   const retro_resampler_t* resamp = NULL;
+
+   voice->types.wav.position       = 0;
+   voice->types.wav.resampler      = NULL;
+   voice->types.wav.resampler_data = NULL;
+   voice->types.wav.buffer         = NULL;
+   voice->types.wav.buf_position   = 0;
+   voice->types.wav.buf_samples    = 0;
+   voice->types.wav.ratio          = 1.0f;
+
+   if (!sound->types.wav.rate)
+      return true;
+
+   ratio = (double)s_rate / (double)sound->types.wav.rate;
+
+   if (!retro_resampler_realloc(&resampler_data,
+            &resamp, *sound->types.wav.resampler_ident
+            ? sound->types.wav.resampler_ident : NULL,
+            sound->types.wav.quality, ratio))
+      return false;
+
+   /* See audio_mixer_play_ogg() */
+   samples                         = (unsigned)(AUDIO_MIXER_TEMP_BUFFER * ratio);
+   wav_buffer                      = (float*)memalign_alloc(16,
+         (((samples + 16) + 15) & ~15) * sizeof(float));
+
+   if (!wav_buffer)
+   {
+      resamp->free(resampler_data);
+      return false;
+   }
+
+   voice->types.wav.resampler      = resamp;
+   voice->types.wav.resampler_data = resampler_data;
+   voice->types.wav.buffer         = (float*)wav_buffer;
+   voice->types.wav.ratio          = ratio;
+
    return true;
 }
 
@@ -811,6 +1060,116 @@ error:
 }
 #endif
 
+#ifdef AUDIO_MIXER_DECODE_THREAD
+/* Stop callback of the decoders, called on the decode thread */
+static void audio_mixer_stream_event(audio_mixer_sound_t* sound,
+      unsigned reason)
+{
+   if (reason == AUDIO_MIXER_SOUND_REPEATED)
+      audio_mixer_atomic_add(&s_decode_stream->repeats, 1);
+}
+
+/* Whether 'sound' is decoded on the thread; WAVs only need
+ * to be when they are resampled on playback */
+static bool audio_mixer_stream_wanted(const audio_mixer_sound_t* sound)
+{
+   switch (sound->type)
+   {
+      case AUDIO_MIXER_TYPE_WAV:
+         return sound->types.wav.rate != 0;
+      case AUDIO_MIXER_TYPE_OGG:
+      case AUDIO_MIXER_TYPE_MOD:
+      case AUDIO_MIXER_TYPE_FLAC:
+      case AUDIO_MIXER_TYPE_MP3:
+         return true;
+      case AUDIO_MIXER_TYPE_NONE:
+         break;
+   }
+
+   return false;
+}
+
+static bool audio_mixer_play_stream(audio_mixer_sound_t* sound,
+      struct audio_mixer_stream *stream, bool repeat,
+      const char *resampler_ident,
+      enum resampler_quality quality)
+{
+   bool res                     = false;
+   audio_mixer_voice_t *decoder = &stream->decoder;
+
+   if (!stream->ring)
+   {
+      stream->ring = (float*)memalign_alloc(16,
+            AUDIO_MIXER_RING_SAMPLES * sizeof(float));
+      if (!stream->ring)
+         return false;
+   }
+
+   slock_lock(s_decode_lock);
+
+   audio_mixer_stream_free(stream);
+   stream->active = false;
+
+   switch (sound->type)
+   {
+      case AUDIO_MIXER_TYPE_WAV:
+         res = audio_mixer_play_wav(sound, decoder, repeat, 1.0f, NULL);
+         break;
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         res = audio_mixer_play_ogg(sound, decoder, repeat, 1.0f,
+               resampler_ident, quality, NULL);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         res = audio_mixer_play_mod(sound, decoder, repeat, 1.0f, NULL);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         res = audio_mixer_play_flac(sound, decoder, repeat, 1.0f,
+               resampler_ident, quality, NULL);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         res = audio_mixer_play_mp3(sound, decoder, repeat, 1.0f,
+               resampler_ident, quality, NULL);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_NONE:
+         break;
+   }
+
+   if (res)
+   {
+      decoder->type          = sound->type;
+      decoder->repeat        = repeat;
+      decoder->volume        = 1.0f;
+      decoder->sound         = sound;
+      decoder->stop_cb       = audio_mixer_stream_event;
+
+      stream->decoder_type   = (enum audio_mixer_type)sound->type;
+      stream->write          = 0;
+      stream->read           = 0;
+      stream->repeats        = 0;
+      stream->finished       = 0;
+      stream->repeats_seen   = 0;
+      stream->started        = false;
+      stream->active         = true;
+
+      scond_signal(s_decode_cond);
+   }
+   else /* Drop whatever a failed play left behind */
+      memset(decoder, 0, sizeof(*decoder));
+
+   slock_unlock(s_decode_lock);
+
+   return res;
+}
+#endif
+
 audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound,
       bool repeat, float volume,
       const char *resampler_ident,
@@ -829,6 +1188,20 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound,
       if (voice->type != AUDIO_MIXER_TYPE_NONE)
          continue;
 
+#ifdef AUDIO_MIXER_DECODE_THREAD
+      if (s_decode_thread)
+      {
+         if (audio_mixer_stream_wanted(sound))
+         {
+            res = audio_mixer_play_stream(sound, &s_streams[i], repeat,
+                  resampler_ident, quality);
+            break;
+         }
+
+         audio_mixer_stream_release(&s_streams[i]);
+      }
+#endif
+
       switch (sound->type)
       {
          case AUDIO_MIXER_TYPE_WAV:
@@ -888,6 +1261,13 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
       stop_cb     = voice->stop_cb;
       sound       = voice->sound;
 
+#ifdef AUDIO_MIXER_DECODE_THREAD
+      if (s_decode_thread)
+         audio_mixer_stream_release(&s_streams[voice - s_voices]);
+#endif
+      if (voice->type == AUDIO_MIXER_TYPE_WAV)
+         audio_mixer_free_wav(voice);
+
       voice->type = AUDIO_MIXER_TYPE_NONE;
 
       if (stop_cb)
@@ -895,11 +1275,83 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
    }
 }
 
-static void audio_mixer_mix_wav(float* buffer, size_t num_frames,
+/* The audio_mixer_mix_*() functions below return the number
+ * of samples left unfilled in 'buffer' when the voice ends */
+
+/* Resamples 'sound' into the voice buffer as it plays */
+static unsigned audio_mixer_mix_wav_resampled(float* buffer,
+      size_t num_frames, audio_mixer_voice_t* voice, float volume)
+{
+   unsigned buf_free                = (unsigned)(num_frames * 2);
+   const audio_mixer_sound_t* sound = voice->sound;
+
+   while (buf_free)
+   {
+      unsigned samples = voice->types.wav.buf_samples
+         - voice->types.wav.buf_position;
+
+      if (!samples)
+      {
+         struct resampler_data info;
+         unsigned pcm_available = sound->types.wav.frames * 2
+            - voice->types.wav.position;
+
+         if (pcm_available > AUDIO_MIXER_TEMP_BUFFER)
+            pcm_available = AUDIO_MIXER_TEMP_BUFFER;
+
+         if (!pcm_available)
+         {
+            if (voice->repeat && sound->types.wav.frames)
+            {
+               if (voice->stop_cb)
+                  voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+
+               voice->types.wav.position = 0;
+               continue;
+            }
+
+            if (voice->stop_cb)
+               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+
+            voice->type = AUDIO_MIXER_TYPE_NONE;
+            audio_mixer_free_wav(voice);
+            return buf_free;
+         }
+
+         info.data_in                  = sound->types.wav.pcm
+            + voice->types.wav.position;
+         info.data_out                 = voice->types.wav.buffer;
+         info.input_frames             = pcm_available / 2;
+         info.output_frames            = 0;
+         info.ratio                    = voice->types.wav.ratio;
+
+         voice->types.wav.resampler->process(
+               voice->types.wav.resampler_data, &info);
+
+         voice->types.wav.position    += pcm_available;
+         voice->types.wav.buf_position = 0;
+         voice->types.wav.buf_samples  = (unsigned)(info.output_frames * 2);
+         continue;
+      }
+
+      if (samples > buf_free)
+         samples = buf_free;
+
+      audio_mixer_mix_pcm(buffer, voice->types.wav.buffer
+            + voice->types.wav.buf_position, samples, volume);
+
+      buffer                        += samples;
+      buf_free                      -= samples;
+      voice->types.wav.buf_position += samples;
+   }
+
+   return 0;
+}
+
+static unsigned audio_mixer_mix_wav(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
    unsigned buf_free                = (unsigned)(num_frames * 2);
    const audio_mixer_sound_t* sound = voice->sound;
    unsigned pcm_available           = sound->types.wav.frames
@@ -907,18 +1359,22 @@ static void audio_mixer_mix_wav(float* buffer, size_t num_frames,
    const float* pcm                 = sound->types.wav.pcm +
       voice->types.wav.position;
 
+   if (voice->types.wav.resampler)
+      return audio_mixer_mix_wav_resampled(buffer, num_frames,
+            voice, volume);
+
 again:
    if (pcm_available < buf_free)
    {
-      for (i = pcm_available; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      audio_mixer_mix_pcm(buffer, pcm, pcm_available, volume);
+      buffer   += pcm_available;
+      buf_free -= pcm_available;
 
       if (voice->repeat)
       {
          if (voice->stop_cb)
             voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
 
-         buf_free                  -= pcm_available;
          pcm_available              = sound->types.wav.frames * 2;
          pcm                        = sound->types.wav.pcm;
          voice->types.wav.position  = 0;
@@ -929,25 +1385,23 @@ again:
          voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
       voice->type = AUDIO_MIXER_TYPE_NONE;
+      return buf_free;
    }
-   else
-   {
-      for (i = buf_free; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
 
-      voice->types.wav.position += buf_free;
-   }
+   audio_mixer_mix_pcm(buffer, pcm, buf_free, volume);
+   voice->types.wav.position += buf_free;
+   return 0;
 }
 
 #ifdef HAVE_STB_VORBIS
-static void audio_mixer_mix_ogg(float* buffer, size_t num_frames,
+static unsigned audio_mixer_mix_ogg(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
    float* temp_buffer = NULL;
    unsigned buf_free                = (unsigned)(num_frames * 2);
    unsigned temp_samples            = 0;
+   unsigned left                    = 0;
    float* pcm                       = NULL;
 
    if (voice->types.ogg.position == voice->types.ogg.samples)
@@ -975,6 +1429,7 @@ again:
             voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
          voice->type = AUDIO_MIXER_TYPE_NONE;
+         left        = buf_free;
          goto cleanup;
       }
 
@@ -989,28 +1444,27 @@ again:
 
          voice->types.ogg.resampler->process(
                voice->types.ogg.resampler_data, &info);
+         temp_samples = (unsigned)(info.output_frames * 2);
       }
       else
          memcpy(voice->types.ogg.buffer, temp_buffer,
                temp_samples * sizeof(float));
 
       voice->types.ogg.position = 0;
-      voice->types.ogg.samples  = voice->types.ogg.buf_samples;
+      voice->types.ogg.samples  = temp_samples;
    }
 
    pcm = voice->types.ogg.buffer + voice->types.ogg.position;
 
    if (voice->types.ogg.samples < buf_free)
    {
-      for (i = voice->types.ogg.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
+      audio_mixer_mix_pcm(buffer, pcm, voice->types.ogg.samples, volume);
+      buffer   += voice->types.ogg.samples;
       buf_free -= voice->types.ogg.samples;
       goto again;
    }
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
+   audio_mixer_mix_pcm(buffer, pcm, buf_free, volume);
 
    voice->types.ogg.position += buf_free;
    voice->types.ogg.samples  -= buf_free;
@@ -1018,11 +1472,12 @@ again:
 cleanup:
    if (temp_buffer != NULL)
       free(temp_buffer);
+   return left;
 }
 #endif
 
 #ifdef HAVE_IBXM
-static void audio_mixer_mix_mod(float* buffer, size_t num_frames,
+static unsigned audio_mixer_mix_mod(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
@@ -1053,7 +1508,7 @@ again:
             voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
          voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
+         return buf_free;
       }
 
       voice->types.mod.position = 0;
@@ -1083,15 +1538,15 @@ again:
 
    voice->types.mod.position += buf_free;
    voice->types.mod.samples  -= buf_free;
+   return 0;
 }
 #endif
 
 #ifdef HAVE_DR_FLAC
-static void audio_mixer_mix_flac(float* buffer, size_t num_frames,
+static unsigned audio_mixer_mix_flac(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
    struct resampler_data info;
    float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
    unsigned buf_free                = (unsigned)(num_frames * 2);
@@ -1117,7 +1572,7 @@ again:
             voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
          voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
+         return buf_free;
       }
 
       info.data_in              = temp_buffer;
@@ -1127,39 +1582,40 @@ again:
       info.ratio                = voice->types.flac.ratio;
 
       if (voice->types.flac.resampler)
+      {
          voice->types.flac.resampler->process(
                voice->types.flac.resampler_data, &info);
+         temp_samples = (unsigned)(info.output_frames * 2);
+      }
       else
          memcpy(voice->types.flac.buffer, temp_buffer, temp_samples * sizeof(float));
       voice->types.flac.position = 0;
-      voice->types.flac.samples  = voice->types.flac.buf_samples;
+      voice->types.flac.samples  = temp_samples;
    }
 
    pcm = voice->types.flac.buffer + voice->types.flac.position;
 
    if (voice->types.flac.samples < buf_free)
    {
-      for (i = voice->types.flac.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
+      audio_mixer_mix_pcm(buffer, pcm, voice->types.flac.samples, volume);
+      buffer   += voice->types.flac.samples;
       buf_free -= voice->types.flac.samples;
       goto again;
    }
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
+   audio_mixer_mix_pcm(buffer, pcm, buf_free, volume);
 
    voice->types.flac.position += buf_free;
    voice->types.flac.samples  -= buf_free;
+   return 0;
 }
 #endif
 
 #ifdef HAVE_DR_MP3
-static void audio_mixer_mix_mp3(float* buffer, size_t num_frames,
+static unsigned audio_mixer_mix_mp3(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
    struct resampler_data info;
    float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
    unsigned buf_free                = (unsigned)(num_frames * 2);
@@ -1188,7 +1644,7 @@ again:
             voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
          voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
+         return buf_free;
       }
 
       info.data_in              = temp_buffer;
@@ -1198,31 +1654,205 @@ again:
       info.ratio                = voice->types.mp3.ratio;
 
       if (voice->types.mp3.resampler)
+      {
          voice->types.mp3.resampler->process(
                voice->types.mp3.resampler_data, &info);
+         temp_samples = (unsigned)(info.output_frames * 2);
+      }
       else
          memcpy(voice->types.mp3.buffer, temp_buffer,
                temp_samples * sizeof(float));
       voice->types.mp3.position = 0;
-      voice->types.mp3.samples  = voice->types.mp3.buf_samples;
+      voice->types.mp3.samples  = temp_samples;
    }
 
    pcm = voice->types.mp3.buffer + voice->types.mp3.position;
 
    if (voice->types.mp3.samples < buf_free)
    {
-      for (i = voice->types.mp3.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
+      audio_mixer_mix_pcm(buffer, pcm, voice->types.mp3.samples, volume);
+      buffer   += voice->types.mp3.samples;
       buf_free -= voice->types.mp3.samples;
       goto again;
    }
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
+   audio_mixer_mix_pcm(buffer, pcm, buf_free, volume);
 
    voice->types.mp3.position += buf_free;
    voice->types.mp3.samples  -= buf_free;
+   return 0;
+}
+#endif
+
+static unsigned audio_mixer_mix_voice(float* buffer, size_t num_frames,
+      audio_mixer_voice_t* voice, float volume)
+{
+   switch (voice->type)
+   {
+      case AUDIO_MIXER_TYPE_WAV:
+         return audio_mixer_mix_wav(buffer, num_frames, voice, volume);
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         return audio_mixer_mix_ogg(buffer, num_frames, voice, volume);
+#else
+         break;
+#endif
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         return audio_mixer_mix_mod(buffer, num_frames, voice, volume);
+#else
+         break;
+#endif
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         return audio_mixer_mix_flac(buffer, num_frames, voice, volume);
+#else
+         break;
+#endif
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         return audio_mixer_mix_mp3(buffer, num_frames, voice, volume);
+#else
+         break;
+#endif
+      case AUDIO_MIXER_TYPE_NONE:
+         break;
+   }
+
+   return 0;
+}
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+/* Mixes 'voice' out of the ring of 'stream' */
+static void audio_mixer_mix_stream(float* buffer, size_t num_frames,
+      audio_mixer_voice_t* voice, struct audio_mixer_stream *stream,
+      float volume)
+{
+   unsigned samples                 = (unsigned)(num_frames * 2);
+   /* 'finished' and 'repeats' are read before 'write',
+    * so that everything they refer to is in the ring */
+   unsigned finished                = audio_mixer_atomic_load(&stream->finished);
+   unsigned repeats                 = audio_mixer_atomic_load(&stream->repeats);
+   unsigned read                    = (unsigned)stream->read;
+   unsigned avail                   = audio_mixer_atomic_load(&stream->write)
+      - read;
+   unsigned consumed                = 0;
+
+   while (samples && avail)
+   {
+      unsigned offset = read & (AUDIO_MIXER_RING_SAMPLES - 1);
+      unsigned count  = AUDIO_MIXER_RING_SAMPLES - offset;
+
+      if (count > avail)
+         count = avail;
+      if (count > samples)
+         count = samples;
+
+      audio_mixer_mix_pcm(buffer, stream->ring + offset, count, volume);
+
+      buffer   += count;
+      samples  -= count;
+      avail    -= count;
+      read     += count;
+      consumed += count;
+   }
+
+   if (consumed)
+   {
+      audio_mixer_atomic_add(&stream->read, consumed);
+      stream->started = true;
+   }
+
+   while (stream->repeats_seen != repeats)
+   {
+      stream->repeats_seen++;
+      if (voice->stop_cb)
+         voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+   }
+
+   if (!samples)
+      return;
+
+   if (finished && !avail)
+   {
+      audio_mixer_stop_cb_t stop_cb = voice->stop_cb;
+
+      voice->type = AUDIO_MIXER_TYPE_NONE;
+
+      /* May start another sound on this voice */
+      if (stop_cb)
+         stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+   }
+   else if (stream->started)
+      s_underruns++;
+}
+
+static void audio_mixer_decode_thread(void *data)
+{
+   static float chunk[AUDIO_MIXER_DECODE_CHUNK];
+
+   slock_lock(s_decode_lock);
+
+   while (!s_decode_quit)
+   {
+      unsigned i;
+      bool decoded   = false;
+      bool streaming = false;
+
+      for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+      {
+         unsigned left, samples, offset, count, write;
+         struct audio_mixer_stream *stream = &s_streams[i];
+
+         if (!stream->active || stream->finished)
+            continue;
+
+         streaming = true;
+         write     = (unsigned)stream->write;
+
+         if (AUDIO_MIXER_RING_SAMPLES - (write
+                  - audio_mixer_atomic_load(&stream->read))
+               < AUDIO_MIXER_DECODE_CHUNK)
+            continue;
+
+         memset(chunk, 0, sizeof(chunk));
+
+         s_decode_stream = stream;
+         left            = audio_mixer_mix_voice(chunk,
+               AUDIO_MIXER_DECODE_CHUNK / 2, &stream->decoder, 1.0f);
+         samples         = AUDIO_MIXER_DECODE_CHUNK - left;
+         offset          = write & (AUDIO_MIXER_RING_SAMPLES - 1);
+         count           = AUDIO_MIXER_RING_SAMPLES - offset;
+
+         if (count > samples)
+            count = samples;
+
+         memcpy(stream->ring + offset, chunk, count * sizeof(float));
+         memcpy(stream->ring, chunk + count,
+               (samples - count) * sizeof(float));
+
+         audio_mixer_atomic_add(&stream->write, samples);
+
+         if (stream->decoder.type == AUDIO_MIXER_TYPE_NONE)
+            audio_mixer_atomic_add(&stream->finished, 1);
+
+         decoded = true;
+      }
+
+      /* Let play/stop in between passes */
+      if (decoded)
+      {
+         slock_unlock(s_decode_lock);
+         slock_lock(s_decode_lock);
+      }
+      else if (streaming)
+         scond_wait_timeout(s_decode_cond, s_decode_lock,
+               AUDIO_MIXER_DECODE_PERIOD);
+      else
+         scond_wait(s_decode_cond, s_decode_lock);
+   }
+
+   slock_unlock(s_decode_lock);
 }
 #endif
 
@@ -1231,50 +1861,128 @@ void audio_mixer_mix(float* buffer, size_t num_frames,
 {
    unsigned i;
    size_t j                   = 0;
-   float* sample              = NULL;
    audio_mixer_voice_t* voice = s_voices;
+#if defined(AUDIO_MIXER_SSE)
+   __m128 min                 = _mm_set1_ps(-1.0f);
+   __m128 max                 = _mm_set1_ps(1.0f);
+#elif defined(AUDIO_MIXER_NEON)
+   float32x4_t min            = vdupq_n_f32(-1.0f);
+   float32x4_t max            = vdupq_n_f32(1.0f);
+#endif
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++, voice++)
    {
       float volume = (override) ? volume_override : voice->volume;
 
-      switch (voice->type)
+      if (voice->type == AUDIO_MIXER_TYPE_NONE)
+         continue;
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+      if (s_streams[i].active)
       {
-         case AUDIO_MIXER_TYPE_WAV:
-            audio_mixer_mix_wav(buffer, num_frames, voice, volume);
-            break;
-         case AUDIO_MIXER_TYPE_OGG:
-#ifdef HAVE_STB_VORBIS
-            audio_mixer_mix_ogg(buffer, num_frames, voice, volume);
-#endif
-            break;
-         case AUDIO_MIXER_TYPE_MOD:
-#ifdef HAVE_IBXM
-            audio_mixer_mix_mod(buffer, num_frames, voice, volume);
+         audio_mixer_mix_stream(buffer, num_frames, voice,
+               &s_streams[i], volume);
+         continue;
+      }
 #endif
-            break;
-         case AUDIO_MIXER_TYPE_FLAC:
-#ifdef HAVE_DR_FLAC
-            audio_mixer_mix_flac(buffer, num_frames, voice, volume);
+
+      audio_mixer_mix_voice(buffer, num_frames, voice, volume);
+   }
+
+#if defined(AUDIO_MIXER_SSE)
+   for (; j + 4 <= num_frames * 2; j += 4)
+      _mm_storeu_ps(buffer + j, _mm_min_ps(max,
+               _mm_max_ps(min, _mm_loadu_ps(buffer + j))));
+#elif defined(AUDIO_MIXER_NEON)
+   for (; j + 4 <= num_frames * 2; j += 4)
+      vst1q_f32(buffer + j, vminq_f32(max,
+               vmaxq_f32(min, vld1q_f32(buffer + j))));
 #endif
-            break;
-            case AUDIO_MIXER_TYPE_MP3:
-#ifdef HAVE_DR_MP3
-            audio_mixer_mix_mp3(buffer, num_frames, voice, volume);
+
+   for (; j < num_frames * 2; j++)
+   {
+      if (buffer[j] < -1.0f)
+         buffer[j] = -1.0f;
+      else if (buffer[j] > 1.0f)
+         buffer[j] = 1.0f;
+   }
+}
+
+bool audio_mixer_start_decoder(void)
+{
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   if (s_decode_thread)
+      return true;
+
+   if (!(s_decode_lock = slock_new()))
+      return false;
+
+   if (!(s_decode_cond = scond_new()))
+      goto error;
+
+   s_decode_quit = false;
+
+   if (!(s_decode_thread = sthread_create(
+               audio_mixer_decode_thread, NULL)))
+      goto error;
+
+   return true;
+
+error:
+   if (s_decode_cond)
+      scond_free(s_decode_cond);
+   slock_free(s_decode_lock);
+   s_decode_cond = NULL;
+   s_decode_lock = NULL;
 #endif
-            break;
-         case AUDIO_MIXER_TYPE_NONE:
-            break;
-      }
+   return false;
+}
+
+unsigned audio_mixer_get_underruns(void)
+{
+   return s_underruns;
+}
+
+void audio_mixer_done(void)
+{
+   unsigned i;
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   if (s_decode_thread)
+   {
+      slock_lock(s_decode_lock);
+      s_decode_quit = true;
+      scond_signal(s_decode_cond);
+      slock_unlock(s_decode_lock);
+
+      sthread_join(s_decode_thread);
+      scond_free(s_decode_cond);
+      slock_free(s_decode_lock);
+
+      s_decode_thread = NULL;
+      s_decode_cond   = NULL;
+      s_decode_lock   = NULL;
+   }
+
+   for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+   {
+      struct audio_mixer_stream *stream = &s_streams[i];
+
+      audio_mixer_stream_free(stream);
+      if (stream->ring)
+         memalign_free(stream->ring);
+      memset(stream, 0, sizeof(*stream));
    }
+#endif
 
-   for (j = 0, sample = buffer; j < num_frames * 2; j++, sample++)
+   for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
    {
-      if (*sample < -1.0f)
-         *sample = -1.0f;
-      else if (*sample > 1.0f)
-         *sample = 1.0f;
+      if (s_voices[i].type == AUDIO_MIXER_TYPE_WAV)
+         audio_mixer_free_wav(&s_voices[i]);
+      s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
    }
+
+   s_underruns = 0;
 }
 
 float audio_mixer_voice_get_volume(audio_mixer_voice_t *voice)
@@ -29,6 +29,153 @@
 #include <gfx/scaler/scaler_int.h>
 #include <gfx/scaler/filter.h>
 #include <gfx/scaler/pixconv.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+
+/* Upper bound on threads a scaler context can use */
+#define SCALER_MAX_THREADS 16
+
+enum scaler_pass
+{
+   SCALER_PASS_HORIZ = 0,
+   SCALER_PASS_VERT
+};
+
+struct scaler_slice
+{
+   struct scaler_ctx *ctx;
+   const void *input;
+   void *output;
+   enum scaler_pass pass;
+   int first;
+   int last;
+};
+
+struct scaler_workers
+{
+   tpool_t *pool;
+   struct scaler_slice slices[SCALER_MAX_THREADS];
+   unsigned count;
+};
+#endif
+
+/* Input pixel conversion and horizontal filter
+ * of input rows [first, last) */
+static void scaler_ctx_scale_horiz(struct scaler_ctx *ctx,
+      const void *input, int first, int last)
+{
+   const void *input_frame = input;
+   int input_stride        = ctx->in_stride;
+
+   if (!ctx->scaler_horiz)
+      return;
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   {
+      ctx->in_pixconv(
+            (uint8_t*)ctx->input.frame + first * ctx->input.stride,
+            (const uint8_t*)input + first * ctx->in_stride,
+            ctx->in_width, last - first,
+            ctx->input.stride, ctx->in_stride);
+
+      input_frame       = ctx->input.frame;
+      input_stride      = ctx->input.stride;
+   }
+
+   ctx->scaler_horiz(ctx, input_frame, input_stride, first, last);
+}
+
+/* Vertical filter and output pixel conversion
+ * of output rows [first, last) */
+static void scaler_ctx_scale_vert(struct scaler_ctx *ctx,
+      void *output, int first, int last)
+{
+   if (!ctx->scaler_vert)
+      return;
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+   {
+      ctx->scaler_vert(ctx, ctx->output.frame, ctx->output.stride,
+            first, last);
+      ctx->out_pixconv(
+            (uint8_t*)output + first * ctx->out_stride,
+            (const uint8_t*)ctx->output.frame + first * ctx->output.stride,
+            ctx->out_width, last - first,
+            ctx->out_stride, ctx->output.stride);
+   }
+   else
+      ctx->scaler_vert(ctx, output, ctx->out_stride, first, last);
+}
+
+#ifdef HAVE_THREADS
+static void scaler_slice_work(void *data)
+{
+   struct scaler_slice *slice = (struct scaler_slice*)data;
+
+   if (slice->pass == SCALER_PASS_HORIZ)
+      scaler_ctx_scale_horiz(slice->ctx, slice->input,
+            slice->first, slice->last);
+   else
+      scaler_ctx_scale_vert(slice->ctx, slice->output,
+            slice->first, slice->last);
+}
+
+/* Splits 'rows' rows of a pass evenly across all workers.
+ * The last slice runs on the calling thread. */
+static void scaler_workers_run(struct scaler_ctx *ctx,
+      enum scaler_pass pass, void *output, const void *input, int rows)
+{
+   unsigned i;
+   struct scaler_workers *workers = ctx->workers;
+
+   for (i = 0; i < workers->count; i++)
+   {
+      struct scaler_slice *slice = &workers->slices[i];
+
+      slice->ctx    = ctx;
+      slice->input  = input;
+      slice->output = output;
+      slice->pass   = pass;
+      slice->first  = (int)(rows * i / workers->count);
+      slice->last   = (int)(rows * (i + 1) / workers->count);
+
+      if (     i + 1 == workers->count
+            || !tpool_add_work(workers->pool, scaler_slice_work, slice))
+         scaler_slice_work(slice);
+   }
+
+   tpool_wait(workers->pool);
+}
+
+static void scaler_workers_free(struct scaler_workers *workers)
+{
+   if (workers->pool)
+      tpool_destroy(workers->pool);
+   free(workers);
+}
+
+static struct scaler_workers *scaler_workers_new(unsigned threads)
+{
+   struct scaler_workers *workers = (struct scaler_workers*)
+      calloc(1, sizeof(*workers));
+
+   if (!workers)
+      return NULL;
+
+   workers->count = (threads > SCALER_MAX_THREADS)
+      ? SCALER_MAX_THREADS : threads;
+
+   if (!(workers->pool = tpool_create(workers->count - 1)))
+   {
+      scaler_workers_free(workers);
+      return NULL;
+   }
+
+   return workers;
+}
+#endif
 
 static bool allocate_frames(struct scaler_ctx *ctx)
 {
@@ -78,7 +225,12 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 {
    scaler_ctx_gen_reset(ctx);
 
+   ctx->scaler_horiz   = NULL;
+   ctx->scaler_vert    = NULL;
    ctx->scaler_special = NULL;
+   ctx->in_pixconv     = NULL;
+   ctx->out_pixconv    = NULL;
+   ctx->direct_pixconv = NULL;
    ctx->unscaled       = false;
 
    if (!allocate_frames(ctx))
@@ -204,8 +356,7 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
    }
    else
    {
-      ctx->scaler_horiz = scaler_argb8888_horiz;
-      ctx->scaler_vert  = scaler_argb8888_vert;
+      scaler_argb8888_select(ctx, cpu_features_get());
 
       switch (ctx->in_fmt)
       {
@@ -261,6 +412,12 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 
       if (!scaler_gen_filter(ctx))
          return false;
+
+#ifdef HAVE_THREADS
+      /* The point filter takes a single pass special path */
+      if (ctx->threads > 1 && !ctx->scaler_special)
+         ctx->workers = scaler_workers_new(ctx->threads);
+#endif
    }
 
    return true;
@@ -282,6 +439,10 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
       free(ctx->input.frame);
    if (ctx->output.frame)
       free(ctx->output.frame);
+#ifdef HAVE_THREADS
+   if (ctx->workers)
+      scaler_workers_free(ctx->workers);
+#endif
 
    ctx->horiz.filter        = NULL;
    ctx->horiz.filter_len    = 0;
@@ -303,6 +464,8 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 
    ctx->output.frame        = NULL;
    ctx->output.stride       = 0;
+
+   ctx->workers             = NULL;
 }
 
 /**
@@ -321,6 +484,27 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
    int input_stride        = ctx->in_stride;
    int output_stride       = ctx->out_stride;
 
+   /* Take generic filter path. */
+   if (!ctx->scaler_special)
+   {
+#ifdef HAVE_THREADS
+      if (ctx->workers)
+      {
+         /* Every output row depends on several scaled rows,
+          * so the horizontal pass has to complete first */
+         scaler_workers_run(ctx, SCALER_PASS_HORIZ,
+               output, input, ctx->in_height);
+         scaler_workers_run(ctx, SCALER_PASS_VERT,
+               output, input, ctx->out_height);
+         return;
+      }
+#endif
+      scaler_ctx_scale_horiz(ctx, input, 0, ctx->in_height);
+      scaler_ctx_scale_vert(ctx, output, 0, ctx->out_height);
+      return;
+   }
+
+   /* Take some special, and (hopefully) more optimized path. */
    if (ctx->in_fmt != SCALER_FMT_ARGB8888)
    {
       ctx->in_pixconv(ctx->input.frame, input,
@@ -337,20 +521,10 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
       output_stride = ctx->output.stride;
    }
 
-   /* Take some special, and (hopefully) more optimized path. */
-   if (ctx->scaler_special)
-      ctx->scaler_special(ctx, output_frame, input_frame,
-            ctx->out_width, ctx->out_height,
-            ctx->in_width, ctx->in_height,
-            output_stride, input_stride);
-   else
-   {
-      /* Take generic filter path. */
-      if (ctx->scaler_horiz)
-         ctx->scaler_horiz(ctx, input_frame, input_stride);
-      if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
-   }
+   ctx->scaler_special(ctx, output_frame, input_frame,
+         ctx->out_width, ctx->out_height,
+         ctx->in_width, ctx->in_height,
+         output_stride, input_stride);
 
    if (ctx->out_fmt != SCALER_FMT_ARGB8888)
       ctx->out_pixconv(output, ctx->output.frame,
@@ -23,6 +23,7 @@
 #include <gfx/scaler/scaler_int.h>
 
 #include <retro_inline.h>
+#include <libretro.h>
 
 #ifdef SCALER_NO_SIMD
 #undef __SSE2__
@@ -35,6 +36,20 @@
 #endif
 #endif
 
+/* AVX2 kernels are built whenever the compiler can target
+ * AVX2, and are picked at runtime by scaler_argb8888_select() */
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__)) \
+   && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define SCALER_HAVE_AVX2
+#define SCALER_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+#if !defined(SCALER_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define SCALER_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
 /* ARGB8888 scaler is split in two:
  *
  * First, horizontal scaler is applied.
@@ -62,173 +77,443 @@
  * SIMD code for testing purposes.
  */
 
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+/* Row kernels.
+ *
+ * Vertical rows are filtered two pixels (SSE2, NEON) or four pixels
+ * (AVX2) at a time, straight from the scaled frame.
+ * Horizontal rows are filtered two taps at a time, for two output
+ * pixels (SSE2, AVX2) or one output pixel (NEON) at a time.
+ *
+ * Remaining pixels at the end of each row go through the C kernel.
+ */
+
+typedef void (*scaler_vert_row_t)(const struct scaler_ctx *ctx,
+      uint32_t *output, int h);
+typedef void (*scaler_horiz_row_t)(const struct scaler_ctx *ctx,
+      const uint32_t *input, uint64_t *output);
+
+static INLINE void scaler_argb8888_vert_row_c(const struct scaler_ctx *ctx,
+      uint32_t *output, int h, int w)
 {
-   int h, w, y;
-   const uint64_t      *input = ctx->scaled.frame;
-   uint32_t           *output = (uint32_t*)output_;
+   int y;
+   int input_stride           = ctx->scaled.stride >> 3;
+   const int16_t *filter_vert = ctx->vert.filter + h * ctx->vert.filter_stride;
+   const uint64_t *input_base = ctx->scaled.frame
+      + ctx->vert.filter_pos[h] * input_stride;
 
-   const int16_t *filter_vert = ctx->vert.filter;
+   for (; w < ctx->out_width; w++)
+   {
+      const uint64_t *input_base_y = input_base + w;
+      int16_t res_a                = 0;
+      int16_t res_r                = 0;
+      int16_t res_g                = 0;
+      int16_t res_b                = 0;
+
+      for (y = 0; y < ctx->vert.filter_len; y++,
+            input_base_y += input_stride)
+      {
+         uint64_t col   = *input_base_y;
+
+         int16_t a      = (col >> 48) & 0xffff;
+         int16_t r      = (col >> 32) & 0xffff;
+         int16_t g      = (col >> 16) & 0xffff;
+         int16_t b      = (col >>  0) & 0xffff;
+
+         int16_t coeff  = filter_vert[y];
 
-   for (h = 0; h < ctx->out_height; h++,
-         filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+         res_a         += (a * coeff) >> 16;
+         res_r         += (r * coeff) >> 16;
+         res_g         += (g * coeff) >> 16;
+         res_b         += (b * coeff) >> 16;
+      }
+
+      res_a           >>= (7 - 2 - 2);
+      res_r           >>= (7 - 2 - 2);
+      res_g           >>= (7 - 2 - 2);
+      res_b           >>= (7 - 2 - 2);
+
+      output[w]         =
+         (clamp_8bit(res_a) << 24) |
+         (clamp_8bit(res_r) << 16) |
+         (clamp_8bit(res_g) << 8)  |
+         (clamp_8bit(res_b) << 0);
+   }
+}
+
+static INLINE void scaler_argb8888_horiz_row_c(const struct scaler_ctx *ctx,
+      const uint32_t *input, uint64_t *output, int w)
+{
+   int x;
+   const int16_t *filter_horiz = ctx->horiz.filter
+      + w * ctx->horiz.filter_stride;
+
+   for (; w < ctx->scaled.width; w++,
+         filter_horiz += ctx->horiz.filter_stride)
    {
-      const uint64_t *input_base = input + ctx->vert.filter_pos[h]
-         * (ctx->scaled.stride >> 3);
+      const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+      int16_t res_a                = 0;
+      int16_t res_r                = 0;
+      int16_t res_g                = 0;
+      int16_t res_b                = 0;
 
-      for (w = 0; w < ctx->out_width; w++)
+      for (x = 0; x < ctx->horiz.filter_len; x++)
       {
-         const uint64_t *input_base_y = input_base + w;
+         uint32_t col   = input_base_x[x];
+
+         int16_t a      = (col >> (24 - 7)) & (0xff << 7);
+         int16_t r      = (col >> (16 - 7)) & (0xff << 7);
+         int16_t g      = (col >> ( 8 - 7)) & (0xff << 7);
+         int16_t b      = (col << ( 0 + 7)) & (0xff << 7);
+
+         int16_t coeff  = filter_horiz[x];
+
+         res_a         += (a * coeff) >> 16;
+         res_r         += (r * coeff) >> 16;
+         res_g         += (g * coeff) >> 16;
+         res_b         += (b * coeff) >> 16;
+      }
+
+      /* Negative channels (filter undershoot) must not
+       * sign extend into their neighbours */
+      output[w]         =
+            ((uint64_t)(uint16_t)res_a << 48) |
+            ((uint64_t)(uint16_t)res_r << 32) |
+            ((uint64_t)(uint16_t)res_g << 16) |
+            ((uint64_t)(uint16_t)res_b << 0);
+   }
+}
+
+static void scaler_argb8888_vert_row_generic(const struct scaler_ctx *ctx,
+      uint32_t *output, int h)
+{
+   scaler_argb8888_vert_row_c(ctx, output, h, 0);
+}
+
+static void scaler_argb8888_horiz_row_generic(const struct scaler_ctx *ctx,
+      const uint32_t *input, uint64_t *output)
+{
+   scaler_argb8888_horiz_row_c(ctx, input, output, 0);
+}
+
 #if defined(__SSE2__)
-         __m128i final;
-         __m128i res = _mm_setzero_si128();
-
-         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2,
-               input_base_y += (ctx->scaled.stride >> 2))
-         {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
-
-            res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
-
-         for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
-         {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
-
-            res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
-
-         res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
-         res       = _mm_srai_epi16(res, (7 - 2 - 2));
-
-         final     = _mm_packus_epi16(res, res);
-
-         output[w] = _mm_cvtsi128_si32(final);
-#else
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
-
-         for (y = 0; y < ctx->vert.filter_len; y++,
-               input_base_y += (ctx->scaled.stride >> 3))
-         {
-            uint64_t col   = *input_base_y;
-
-            int16_t a      = (col >> 48) & 0xffff;
-            int16_t r      = (col >> 32) & 0xffff;
-            int16_t g      = (col >> 16) & 0xffff;
-            int16_t b      = (col >>  0) & 0xffff;
-
-            int16_t coeff  = filter_vert[y];
-
-            res_a         += (a * coeff) >> 16;
-            res_r         += (r * coeff) >> 16;
-            res_g         += (g * coeff) >> 16;
-            res_b         += (b * coeff) >> 16;
-         }
-
-         res_a           >>= (7 - 2 - 2);
-         res_r           >>= (7 - 2 - 2);
-         res_g           >>= (7 - 2 - 2);
-         res_b           >>= (7 - 2 - 2);
-
-         output[w]         =
-            (clamp_8bit(res_a) << 24) |
-            (clamp_8bit(res_r) << 16) |
-            (clamp_8bit(res_g) << 8)  |
-            (clamp_8bit(res_b) << 0);
+/* Returns the filter taps x and x + 1 of two output pixels, each
+ * broadcast to the four channels: (c0[x] x4, c0[x+1] x4) in
+ * 'coeff_0', (c1[x] x4, c1[x+1] x4) in 'coeff_1' */
+#define SCALER_COEFF_PAIRS_SSE2(filter_0, filter_1, x, coeff_0, coeff_1) \
+{ \
+   __m128i pairs = _mm_unpacklo_epi32( \
+         _mm_cvtsi32_si128((uint16_t)(filter_0)[(x)] \
+            | ((uint32_t)(uint16_t)(filter_0)[(x) + 1] << 16)), \
+         _mm_cvtsi32_si128((uint16_t)(filter_1)[(x)] \
+            | ((uint32_t)(uint16_t)(filter_1)[(x) + 1] << 16))); \
+   pairs   = _mm_unpacklo_epi16(pairs, pairs); \
+   coeff_0 = _mm_unpacklo_epi32(pairs, pairs); \
+   coeff_1 = _mm_unpackhi_epi32(pairs, pairs); \
+}
+
+static void scaler_argb8888_vert_row_sse2(const struct scaler_ctx *ctx,
+      uint32_t *output, int h)
+{
+   int w, y;
+   int filter_len             = ctx->vert.filter_len;
+   int input_stride           = ctx->scaled.stride >> 3;
+   const int16_t *filter_vert = ctx->vert.filter + h * ctx->vert.filter_stride;
+   const uint64_t *input_base = ctx->scaled.frame
+      + ctx->vert.filter_pos[h] * input_stride;
+
+   for (w = 0; (w + 1) < ctx->out_width; w += 2)
+   {
+      const uint64_t *input_base_y = input_base + w;
+      __m128i res                  = _mm_setzero_si128();
+
+      for (y = 0; y < filter_len; y++, input_base_y += input_stride)
+      {
+         __m128i coeff = _mm_set1_epi16(filter_vert[y]);
+         __m128i col   = _mm_loadu_si128((const __m128i*)input_base_y);
+
+         res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+      }
+
+      res = _mm_srai_epi16(res, (7 - 2 - 2));
+      _mm_storel_epi64((__m128i*)(output + w), _mm_packus_epi16(res, res));
+   }
+
+   if (w < ctx->out_width)
+      scaler_argb8888_vert_row_c(ctx, output, h, w);
+}
+
+static void scaler_argb8888_horiz_row_sse2(const struct scaler_ctx *ctx,
+      const uint32_t *input, uint64_t *output)
+{
+   int w, x;
+   int filter_len              = ctx->horiz.filter_len;
+   int filter_stride           = ctx->horiz.filter_stride;
+   const int16_t *filter_horiz = ctx->horiz.filter;
+   __m128i zero                = _mm_setzero_si128();
+
+   for (w = 0; (w + 1) < ctx->scaled.width; w += 2,
+         filter_horiz += filter_stride << 1)
+   {
+      const int16_t *filter_horiz_1 = filter_horiz + filter_stride;
+      const uint32_t *input_0       = input + ctx->horiz.filter_pos[w + 0];
+      const uint32_t *input_1       = input + ctx->horiz.filter_pos[w + 1];
+      __m128i res_0                 = _mm_setzero_si128();
+      __m128i res_1                 = _mm_setzero_si128();
+      __m128i res;
+
+      for (x = 0; (x + 1) < filter_len; x += 2)
+      {
+         __m128i coeff_0, coeff_1;
+         __m128i col   = _mm_unpacklo_epi64(
+               _mm_loadl_epi64((const __m128i*)(input_0 + x)),
+               _mm_loadl_epi64((const __m128i*)(input_1 + x)));
+         __m128i col_0 = _mm_slli_epi16(_mm_unpacklo_epi8(col, zero), 7);
+         __m128i col_1 = _mm_slli_epi16(_mm_unpackhi_epi8(col, zero), 7);
+
+         SCALER_COEFF_PAIRS_SSE2(filter_horiz, filter_horiz_1, x,
+               coeff_0, coeff_1);
+
+         res_0         = _mm_adds_epi16(_mm_mulhi_epi16(col_0, coeff_0), res_0);
+         res_1         = _mm_adds_epi16(_mm_mulhi_epi16(col_1, coeff_1), res_1);
+      }
+
+      res = _mm_adds_epi16(
+            _mm_unpackhi_epi64(res_0, res_1),
+            _mm_unpacklo_epi64(res_0, res_1));
+
+      for (; x < filter_len; x++)
+      {
+         __m128i coeff = _mm_unpacklo_epi64(
+               _mm_set1_epi16(filter_horiz[x]),
+               _mm_set1_epi16(filter_horiz_1[x]));
+         __m128i col   = _mm_unpacklo_epi32(
+               _mm_cvtsi32_si128(input_0[x]),
+               _mm_cvtsi32_si128(input_1[x]));
+
+         col           = _mm_slli_epi16(_mm_unpacklo_epi8(col, zero), 7);
+         res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+      }
+
+      _mm_storeu_si128((__m128i*)(output + w), res);
+   }
+
+   if (w < ctx->scaled.width)
+      scaler_argb8888_horiz_row_c(ctx, input, output, w);
+}
 #endif
+
+#ifdef SCALER_HAVE_AVX2
+SCALER_TARGET_AVX2
+static void scaler_argb8888_vert_row_avx2(const struct scaler_ctx *ctx,
+      uint32_t *output, int h)
+{
+   int w, y;
+   int filter_len             = ctx->vert.filter_len;
+   int input_stride           = ctx->scaled.stride >> 3;
+   const int16_t *filter_vert = ctx->vert.filter + h * ctx->vert.filter_stride;
+   const uint64_t *input_base = ctx->scaled.frame
+      + ctx->vert.filter_pos[h] * input_stride;
+
+   for (w = 0; (w + 3) < ctx->out_width; w += 4)
+   {
+      const uint64_t *input_base_y = input_base + w;
+      __m256i res                  = _mm256_setzero_si256();
+
+      for (y = 0; y < filter_len; y++, input_base_y += input_stride)
+      {
+         __m256i coeff = _mm256_set1_epi16(filter_vert[y]);
+         __m256i col   = _mm256_loadu_si256((const __m256i*)input_base_y);
+
+         res           = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
       }
+
+      /* Packing is done per 128-bit lane, gather the
+       * low halves of both lanes */
+      res = _mm256_srai_epi16(res, (7 - 2 - 2));
+      res = _mm256_permute4x64_epi64(_mm256_packus_epi16(res, res), 0x08);
+      _mm_storeu_si128((__m128i*)(output + w), _mm256_castsi256_si128(res));
    }
+
+   if (w < ctx->out_width)
+      scaler_argb8888_vert_row_c(ctx, output, h, w);
 }
+#endif
 
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+#ifdef SCALER_HAVE_NEON
+/* (a * b) >> 16 on each 16-bit lane, as _mm_mulhi_epi16 */
+#define SCALER_MULHI_NEON(col, coeff_lo, coeff_hi) \
+   vcombine_s16( \
+         vshrn_n_s32(vmull_n_s16(vget_low_s16(col), (coeff_lo)), 16), \
+         vshrn_n_s32(vmull_n_s16(vget_high_s16(col), (coeff_hi)), 16))
+
+static void scaler_argb8888_vert_row_neon(const struct scaler_ctx *ctx,
+      uint32_t *output, int h)
 {
-   int h, w, x;
-   const uint32_t *input = (uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
+   int w, y;
+   int filter_len             = ctx->vert.filter_len;
+   int input_stride           = ctx->scaled.stride >> 3;
+   const int16_t *filter_vert = ctx->vert.filter + h * ctx->vert.filter_stride;
+   const uint64_t *input_base = ctx->scaled.frame
+      + ctx->vert.filter_pos[h] * input_stride;
+
+   for (w = 0; (w + 1) < ctx->out_width; w += 2)
+   {
+      const uint64_t *input_base_y = input_base + w;
+      int16x8_t res                = vdupq_n_s16(0);
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2,
-         output += ctx->scaled.stride >> 3)
+      for (y = 0; y < filter_len; y++, input_base_y += input_stride)
+      {
+         int16x8_t col = vld1q_s16((const int16_t*)input_base_y);
+         res           = vqaddq_s16(SCALER_MULHI_NEON(col,
+                  filter_vert[y], filter_vert[y]), res);
+      }
+
+      vst1_u8((uint8_t*)(output + w),
+            vqmovun_s16(vshrq_n_s16(res, (7 - 2 - 2))));
+   }
+
+   if (w < ctx->out_width)
+      scaler_argb8888_vert_row_c(ctx, output, h, w);
+}
+
+static void scaler_argb8888_horiz_row_neon(const struct scaler_ctx *ctx,
+      const uint32_t *input, uint64_t *output)
+{
+   int w, x;
+   int filter_len              = ctx->horiz.filter_len;
+   const int16_t *filter_horiz = ctx->horiz.filter;
+
+   for (w = 0; w < ctx->scaled.width; w++,
+         filter_horiz += ctx->horiz.filter_stride)
    {
-      const int16_t *filter_horiz = ctx->horiz.filter;
+      const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+      int16x8_t res                = vdupq_n_s16(0);
+      int16x4_t sum;
 
-      for (w = 0; w < ctx->scaled.width; w++,
-            filter_horiz += ctx->horiz.filter_stride)
+      for (x = 0; (x + 1) < filter_len; x += 2)
       {
-         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+         int16x8_t col = vreinterpretq_s16_u16(vshll_n_u8(
+                  vld1_u8((const uint8_t*)(input_base_x + x)), 7));
+         res           = vqaddq_s16(SCALER_MULHI_NEON(col,
+                  filter_horiz[x], filter_horiz[x + 1]), res);
+      }
+
+      sum = vqadd_s16(vget_high_s16(res), vget_low_s16(res));
+
+      for (; x < filter_len; x++)
+      {
+         int16x4_t col = vget_low_s16(vreinterpretq_s16_u16(vshll_n_u8(
+                     vreinterpret_u8_u32(vdup_n_u32(input_base_x[x])), 7)));
+         sum           = vqadd_s16(vshrn_n_s32(
+                  vmull_n_s16(col, filter_horiz[x]), 16), sum);
+      }
+
+      vst1_s16((int16_t*)(output + w), sum);
+   }
+}
+#endif
+
+static INLINE void scaler_argb8888_vert_rows(const struct scaler_ctx *ctx,
+      void *output_, int stride, int first, int last, scaler_vert_row_t row)
+{
+   int h;
+   uint32_t *output = (uint32_t*)output_ + first * (stride >> 2);
+
+   for (h = first; h < last; h++, output += stride >> 2)
+      row(ctx, output, h);
+}
+
+static INLINE void scaler_argb8888_horiz_rows(const struct scaler_ctx *ctx,
+      const void *input_, int stride, int first, int last,
+      scaler_horiz_row_t row)
+{
+   int h;
+   const uint32_t *input = (const uint32_t*)input_ + first * (stride >> 2);
+   uint64_t *output      = ctx->scaled.frame + first * (ctx->scaled.stride >> 3);
+
+   for (h = first; h < last; h++, input += stride >> 2,
+         output += ctx->scaled.stride >> 3)
+      row(ctx, input, output);
+}
+
+static void scaler_argb8888_vert_generic(const struct scaler_ctx *ctx,
+      void *output, int stride, int first, int last)
+{
+   scaler_argb8888_vert_rows(ctx, output, stride, first, last,
+         scaler_argb8888_vert_row_generic);
+}
+
+static void scaler_argb8888_horiz_generic(const struct scaler_ctx *ctx,
+      const void *input, int stride, int first, int last)
+{
+   scaler_argb8888_horiz_rows(ctx, input, stride, first, last,
+         scaler_argb8888_horiz_row_generic);
+}
+
 #if defined(__SSE2__)
-         __m128i res = _mm_setzero_si128();
-#ifndef __x86_64__
-         union
-         {
-            uint32_t *u32;
-            uint64_t *u64;
-         } u;
+static void scaler_argb8888_vert_sse2(const struct scaler_ctx *ctx,
+      void *output, int stride, int first, int last)
+{
+   scaler_argb8888_vert_rows(ctx, output, stride, first, last,
+         scaler_argb8888_vert_row_sse2);
+}
+
+static void scaler_argb8888_horiz_sse2(const struct scaler_ctx *ctx,
+      const void *input, int stride, int first, int last)
+{
+   scaler_argb8888_horiz_rows(ctx, input, stride, first, last,
+         scaler_argb8888_horiz_row_sse2);
+}
+#endif
+
+#ifdef SCALER_HAVE_AVX2
+static void scaler_argb8888_vert_avx2(const struct scaler_ctx *ctx,
+      void *output, int stride, int first, int last)
+{
+   scaler_argb8888_vert_rows(ctx, output, stride, first, last,
+         scaler_argb8888_vert_row_avx2);
+}
 #endif
-         for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
-         {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
-
-            __m128i col   = _mm_unpacklo_epi8(_mm_set_epi64x(0,
-                     ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
-
-            col           = _mm_slli_epi16(col, 7);
-            res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
-
-         for (; x < ctx->horiz.filter_len; x++)
-         {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
-            __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
-
-            col           = _mm_slli_epi16(col, 7);
-            res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
-
-         res              = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
-
-#ifdef __x86_64__
-         output[w]        = _mm_cvtsi128_si64(res);
-#else /* 32-bit doesn't have si64. Do it in two steps. */
-         u.u64    = output + w;
-         u.u32[0] = _mm_cvtsi128_si32(res);
-         u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
+
+#ifdef SCALER_HAVE_NEON
+static void scaler_argb8888_vert_neon(const struct scaler_ctx *ctx,
+      void *output, int stride, int first, int last)
+{
+   scaler_argb8888_vert_rows(ctx, output, stride, first, last,
+         scaler_argb8888_vert_row_neon);
+}
+
+static void scaler_argb8888_horiz_neon(const struct scaler_ctx *ctx,
+      const void *input, int stride, int first, int last)
+{
+   scaler_argb8888_horiz_rows(ctx, input, stride, first, last,
+         scaler_argb8888_horiz_row_neon);
+}
+#endif
+
+void scaler_argb8888_select(struct scaler_ctx *ctx, uint64_t simd)
+{
+   ctx->scaler_horiz = scaler_argb8888_horiz_generic;
+   ctx->scaler_vert  = scaler_argb8888_vert_generic;
+
+#if defined(__SSE2__)
+   if (simd & RETRO_SIMD_SSE2)
+   {
+      ctx->scaler_horiz = scaler_argb8888_horiz_sse2;
+      ctx->scaler_vert  = scaler_argb8888_vert_sse2;
+   }
 #endif
-#else
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
-
-         for (x = 0; x < ctx->horiz.filter_len; x++)
-         {
-            uint32_t col   = input_base_x[x];
-
-            int16_t a      = (col >> (24 - 7)) & (0xff << 7);
-            int16_t r      = (col >> (16 - 7)) & (0xff << 7);
-            int16_t g      = (col >> ( 8 - 7)) & (0xff << 7);
-            int16_t b      = (col << ( 0 + 7)) & (0xff << 7);
-
-            int16_t coeff  = filter_horiz[x];
-
-            res_a         += (a * coeff) >> 16;
-            res_r         += (r * coeff) >> 16;
-            res_g         += (g * coeff) >> 16;
-            res_b         += (b * coeff) >> 16;
-         }
-
-         output[w]         = (
-               (uint64_t)res_a  << 48)  |
-               ((uint64_t)res_r << 32)  |
-               ((uint64_t)res_g << 16)  |
-               ((uint64_t)res_b << 0);
+#ifdef SCALER_HAVE_AVX2
+   if (simd & RETRO_SIMD_AVX2)
+      ctx->scaler_vert  = scaler_argb8888_vert_avx2;
 #endif
-      }
+#ifdef SCALER_HAVE_NEON
+   if (simd & RETRO_SIMD_NEON)
+   {
+      ctx->scaler_horiz = scaler_argb8888_horiz_neon;
+      ctx->scaler_vert  = scaler_argb8888_vert_neon;
    }
+#endif
 }
 
 void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
@@ -62,6 +62,22 @@ void audio_mixer_init(unsigned rate);
 
 void audio_mixer_done(void);
 
+/* Moves decoding and resampling of OGG, FLAC, MP3 and
+ * MOD voices (and of WAVs that need resampling) to a
+ * thread, which keeps a PCM ring per voice topped up;
+ * audio_mixer_mix() then only mixes the rings. Affects
+ * sounds loaded and voices started afterwards.
+ * audio_mixer_play(), audio_mixer_stop() and
+ * audio_mixer_mix() must still be called from a single
+ * thread. The thread is stopped by audio_mixer_done().
+ *
+ * Returns false if threads are not available. */
+bool audio_mixer_start_decoder(void);
+
+/* Number of times audio_mixer_mix() ran out of decoded
+ * samples for a voice since audio_mixer_init() */
+unsigned audio_mixer_get_underruns(void);
+
 audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size,
       const char *resampler_ident, enum resampler_quality quality);
 audio_mixer_sound_t* audio_mixer_load_ogg(void *buffer, int32_t size);
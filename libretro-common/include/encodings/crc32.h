@@ -30,7 +30,55 @@
 
 RETRO_BEGIN_DECLS
 
+/**
+ * encoding_crc32:
+ * @crc          : CRC32 of any preceding data (0 if none)
+ * @buf          : data to checksum
+ * @len          : size of @buf in bytes
+ *
+ * Computes the standard (zlib/PNG) CRC32 of @buf, continuing
+ * from @crc. Uses the fastest implementation available on
+ * the running CPU (PCLMULQDQ on x86, the CRC32 instructions
+ * on ARMv8, slicing-by-8 otherwise).
+ *
+ * Returns: updated CRC32.
+ **/
 uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len);
+
+/**
+ * encoding_crc32_combine:
+ * @crc1         : CRC32 of the first block
+ * @crc2         : CRC32 of the second block
+ * @len2         : size of the second block in bytes
+ *
+ * Returns: CRC32 of the two blocks concatenated, i.e.
+ * encoding_crc32(crc1, block2, len2), in O(log(len2)) time.
+ **/
+uint32_t encoding_crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+/**
+ * encoding_crc32_parallel:
+ *
+ * Same as encoding_crc32(), but splits large buffers
+ * into stripes checksummed on separate threads, and
+ * joins the results with encoding_crc32_combine().
+ * Falls back to encoding_crc32() for small buffers,
+ * single core systems and builds without threads.
+ **/
+uint32_t encoding_crc32_parallel(uint32_t crc,
+      const uint8_t *buf, size_t len);
+
+/**
+ * encoding_crc32_threads:
+ * @count        : number of threads to use
+ *
+ * Same as encoding_crc32_parallel(), but with an explicit
+ * thread count instead of one per core. Stripes are at
+ * least 4 MB long, so fewer threads may be used.
+ **/
+uint32_t encoding_crc32_threads(uint32_t crc,
+      const uint8_t *buf, size_t len, unsigned count);
+
 uint32_t file_crc32(uint32_t crc, const char *path);
 
 RETRO_END_DECLS
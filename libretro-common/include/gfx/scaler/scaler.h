@@ -59,12 +59,16 @@ struct scaler_filter
    int      filter_stride;
 };
 
+struct scaler_workers;
+
 struct scaler_ctx
 {
+   /* Filter rows [first, last) of the scaled (horizontal)
+    * or output (vertical) frame */
    void (*scaler_horiz)(const struct scaler_ctx*,
-         const void*, int);
+         const void*, int, int first, int last);
    void (*scaler_vert)(const struct scaler_ctx*,
-         void*, int);
+         void*, int, int first, int last);
    void (*scaler_special)(const struct scaler_ctx*,
          void*, const void*, int, int, int, int, int, int);
 
@@ -93,6 +97,8 @@ struct scaler_ctx
       int stride;
    } output;
 
+   struct scaler_workers *workers;
+
    int in_width;
    int in_height;
    int in_stride;
@@ -105,6 +111,12 @@ struct scaler_ctx
    enum scaler_pix_fmt out_fmt;
    enum scaler_type scaler_type;
 
+   /* Number of threads the filter passes are split
+    * across (0 or 1 for none). Must be set before
+    * scaler_ctx_gen_filter(), and is ignored unless
+    * built with HAVE_THREADS. */
+   unsigned threads;
+
    bool unscaled;
 };
 
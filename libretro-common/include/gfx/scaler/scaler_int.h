@@ -29,11 +29,15 @@
 
 RETRO_BEGIN_DECLS
 
-void scaler_argb8888_vert(const struct scaler_ctx *ctx,
-      void *output, int stride);
-
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx,
-      const void *input, int stride);
+/**
+ * scaler_argb8888_select:
+ * @ctx          : pointer to scaler context object.
+ * @simd         : mask of RETRO_SIMD_* features to pick kernels from.
+ *
+ * Binds the fastest horizontal and vertical ARGB8888 kernels
+ * available for @simd to @ctx. All kernels give the same output.
+ **/
+void scaler_argb8888_select(struct scaler_ctx *ctx, uint64_t simd);
 
 void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
       void *output, const void *input,
@@ -0,0 +1,79 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_atomic.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_ATOMIC_H
+#define __LIBRETRO_SDK_ATOMIC_H
+
+/* Atomic operations on a retro_atomic_uint_t, an unsigned
+ * 32-bit value that wraps around on overflow:
+ *
+ * retro_atomic_load(p)         : reads *p
+ * retro_atomic_store(p, v)     : sets *p to v
+ * retro_atomic_fetch_add(p, v) : adds v to *p, returns
+ *                                the value *p had before
+ *
+ * These are sequentially consistent, and only exist as such
+ * when RETRO_ATOMIC_LOCK_FREE is defined. Without it,
+ * retro_atomic_load() and retro_atomic_store() are plain
+ * volatile accesses with no ordering at all, and
+ * retro_atomic_fetch_add() is not defined: callers must then
+ * serialize through a lock.
+ *
+ * retro_atomic_load_ptr() and retro_atomic_store_ptr() read
+ * and write a pointer, including a function pointer, without
+ * tearing, everywhere. They do not order anything else. */
+
+typedef unsigned retro_atomic_uint_t;
+
+#if defined(__ATOMIC_SEQ_CST)
+/* GCC 4.7+, Clang */
+#define RETRO_ATOMIC_LOCK_FREE
+#define retro_atomic_load(p)          __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define retro_atomic_store(p, v)      __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define retro_atomic_fetch_add(p, v)  __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define retro_atomic_load_ptr(p)      __atomic_load_n((p), __ATOMIC_RELAXED)
+#define retro_atomic_store_ptr(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define RETRO_ATOMIC_LOCK_FREE
+#define retro_atomic_load(p)          ((retro_atomic_uint_t)_InterlockedCompareExchange((long volatile*)(p), 0, 0))
+#define retro_atomic_store(p, v)      ((void)_InterlockedExchange((long volatile*)(p), (long)(v)))
+#define retro_atomic_fetch_add(p, v)  ((retro_atomic_uint_t)_InterlockedExchangeAdd((long volatile*)(p), (long)(v)))
+#elif defined(__GNUC__)
+/* Older GCC, where the __sync builtins are full barriers */
+#define RETRO_ATOMIC_LOCK_FREE
+#define retro_atomic_load(p)          __sync_fetch_and_add((retro_atomic_uint_t*)(p), 0)
+#define retro_atomic_store(p, v)      (__sync_synchronize(), (void)(*(p) = (v)), __sync_synchronize())
+#define retro_atomic_fetch_add(p, v)  __sync_fetch_and_add((p), (v))
+#else
+#define retro_atomic_load(p)          (*(volatile retro_atomic_uint_t*)(p))
+#define retro_atomic_store(p, v)      ((void)(*(volatile retro_atomic_uint_t*)(p) = (v)))
+#endif
+
+#ifndef retro_atomic_load_ptr
+/* Aligned pointers are read and written whole
+ * on every platform built for */
+#define retro_atomic_load_ptr(p)      (*(p))
+#define retro_atomic_store_ptr(p, v)  ((void)(*(p) = (v)))
+#endif
+
+#endif
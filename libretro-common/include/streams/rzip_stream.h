@@ -117,6 +117,37 @@ bool rzipstream_read_file(const char *path, void **buf, int64_t *len);
 
 /* File Write */
 
+/* Compression level of written files
+ * > zlib default of 6 provides the best
+ *   balance between file size and
+ *   compression speed */
+#define RZIP_COMPRESSION_LEVEL 6
+
+/* Default chunk size: 128kb */
+#define RZIP_DEFAULT_CHUNK_SIZE 131072
+
+/* Header sizes (in bytes) */
+#define RZIP_HEADER_SIZE 20
+#define RZIP_CHUNK_HEADER_SIZE 4
+
+/* Fills 'header_bytes' with the RZIP_HEADER_SIZE
+ * bytes of the header of a file holding 'size'
+ * bytes of uncompressed data, in chunks of
+ * 'chunk_size' bytes.
+ * The header is followed by every chunk, each
+ * compressed on its own with zlib and preceded
+ * by the header from rzipstream_encode_chunk_header().
+ * Lets writers that compress and write on their
+ * own (e.g. on separate threads) produce RZIP files */
+void rzipstream_encode_header(uint8_t *header_bytes,
+      uint32_t chunk_size, uint64_t size);
+
+/* Fills 'chunk_header_bytes' with the
+ * RZIP_CHUNK_HEADER_SIZE bytes preceding a
+ * chunk of 'compressed_size' bytes */
+void rzipstream_encode_chunk_header(uint8_t *chunk_header_bytes,
+      uint32_t compressed_size);
+
 /* Writes 'len' bytes to an RZIP file.
  * Returns actual number of bytes written, or -1
  * in the event of an error */
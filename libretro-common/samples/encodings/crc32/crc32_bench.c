@@ -0,0 +1,118 @@
+/* Copyright  (C) 2010-2021 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (crc32_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+
+/* Measures the throughput of encoding_crc32() and
+ * encoding_crc32_parallel(), and compares both
+ * against a byte at a time table lookup */
+
+#define BENCH_SIZE (64 * 1024 * 1024)
+
+static uint32_t crc32_reference_table[256];
+
+static void crc32_reference_init(void)
+{
+   unsigned i, k;
+   for (i = 0; i < 256; i++)
+   {
+      uint32_t c = i;
+      for (k = 0; k < 8; k++)
+         c = (c & 1) ? (c >> 1) ^ 0xedb88320 : c >> 1;
+      crc32_reference_table[i] = c;
+   }
+}
+
+static uint32_t crc32_reference(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   crc = ~crc;
+   while (len--)
+      crc = crc32_reference_table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+   return ~crc;
+}
+
+static double bench_gbps(size_t len, retro_time_t usec)
+{
+   if (usec <= 0)
+      usec = 1;
+   return (double)len / (double)usec / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   retro_time_t start;
+   uint32_t crc_ref, crc_fast, crc_par;
+   retro_time_t t_ref, t_fast, t_par;
+   size_t len   = BENCH_SIZE;
+   uint8_t *buf = NULL;
+
+   if (argc > 1)
+      len = (size_t)strtoul(argv[1], NULL, 0);
+
+   if (!len || !(buf = (uint8_t*)malloc(len)))
+      return 1;
+
+   srand(1);
+   for (i = 0; i < len; i++)
+      buf[i] = (uint8_t)rand();
+
+   crc32_reference_init();
+   /* Warm up, initialise dispatch */
+   encoding_crc32(0, buf, 1);
+
+   start    = cpu_features_get_time_usec();
+   crc_ref  = crc32_reference(0, buf, len);
+   t_ref    = cpu_features_get_time_usec() - start;
+
+   start    = cpu_features_get_time_usec();
+   crc_fast = encoding_crc32(0, buf, len);
+   t_fast   = cpu_features_get_time_usec() - start;
+
+   start    = cpu_features_get_time_usec();
+   crc_par  = encoding_crc32_parallel(0, buf, len);
+   t_par    = cpu_features_get_time_usec() - start;
+
+   printf("Buffer size: %u bytes, %u cores\n",
+         (unsigned)len, cpu_features_get_core_amount());
+   printf("bytewise: %08x %8.2f GB/s\n",
+         (unsigned)crc_ref, bench_gbps(len, t_ref));
+   printf("crc32:    %08x %8.2f GB/s\n",
+         (unsigned)crc_fast, bench_gbps(len, t_fast));
+   printf("parallel: %08x %8.2f GB/s\n",
+         (unsigned)crc_par, bench_gbps(len, t_par));
+
+   free(buf);
+
+   if (crc_fast != crc_ref || crc_par != crc_ref)
+   {
+      printf("MISMATCH\n");
+      return 1;
+   }
+
+   return 0;
+}
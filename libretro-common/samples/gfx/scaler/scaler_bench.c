@@ -0,0 +1,185 @@
+/* Copyright  (C) 2010-2021 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (scaler_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <gfx/scaler/scaler.h>
+#include <gfx/scaler/scaler_int.h>
+#include <features/features_cpu.h>
+
+/* Measures scaler_ctx_scale() throughput on typical
+ * upscales, with the C kernels, with the SIMD kernels
+ * picked for this CPU, and with the SIMD kernels split
+ * across threads, and checks all three give the same
+ * output.
+ *
+ * Usage: scaler_bench [frames] [threads] */
+
+struct bench_case
+{
+   int in_width;
+   int in_height;
+   int out_width;
+   int out_height;
+   enum scaler_pix_fmt in_fmt;
+   enum scaler_pix_fmt out_fmt;
+   enum scaler_type type;
+};
+
+static const struct bench_case bench_cases[] = {
+   {  256,  240, 1920, 1080, SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888, SCALER_TYPE_BILINEAR },
+   {  256,  240, 1920, 1080, SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888, SCALER_TYPE_SINC     },
+   {  256,  240, 1920, 1080, SCALER_FMT_RGB565,   SCALER_FMT_BGR24,    SCALER_TYPE_BILINEAR },
+   { 1920, 1080, 3840, 2160, SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888, SCALER_TYPE_BILINEAR },
+   { 1920, 1080, 3840, 2160, SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888, SCALER_TYPE_SINC     },
+   {  641,  479,  383,  217, SCALER_FMT_RGB565,   SCALER_FMT_ARGB8888, SCALER_TYPE_SINC     },
+};
+
+static const char *bench_type_names[] = {
+   "unknown", "point", "bilinear", "sinc"
+};
+
+static int bench_bpp(enum scaler_pix_fmt fmt)
+{
+   switch (fmt)
+   {
+      case SCALER_FMT_RGB565:
+         return 2;
+      case SCALER_FMT_BGR24:
+         return 3;
+      default:
+         break;
+   }
+   return 4;
+}
+
+/* Scales 'input' 'frames' times, returns the time
+ * per frame in usec or a negative value on failure */
+static double bench_run(const struct bench_case *c,
+      const void *input, void *output,
+      uint64_t simd, unsigned threads, unsigned frames)
+{
+   unsigned i;
+   retro_time_t start;
+   struct scaler_ctx ctx;
+
+   memset(&ctx, 0, sizeof(ctx));
+
+   ctx.in_width    = c->in_width;
+   ctx.in_height   = c->in_height;
+   ctx.in_stride   = c->in_width * bench_bpp(c->in_fmt);
+   ctx.in_fmt      = c->in_fmt;
+   ctx.out_width   = c->out_width;
+   ctx.out_height  = c->out_height;
+   ctx.out_stride  = c->out_width * bench_bpp(c->out_fmt);
+   ctx.out_fmt     = c->out_fmt;
+   ctx.scaler_type = c->type;
+   ctx.threads     = threads;
+
+   if (!scaler_ctx_gen_filter(&ctx))
+   {
+      scaler_ctx_gen_reset(&ctx);
+      return -1.0;
+   }
+
+   scaler_argb8888_select(&ctx, simd);
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < frames; i++)
+      scaler_ctx_scale(&ctx, output, input);
+
+   scaler_ctx_gen_reset(&ctx);
+
+   return (double)(cpu_features_get_time_usec() - start) / frames;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   unsigned frames  = 20;
+   unsigned threads = cpu_features_get_core_amount();
+   uint64_t simd    = cpu_features_get();
+   bool ret         = true;
+
+   if (argc > 1)
+      frames  = (unsigned)strtoul(argv[1], NULL, 0);
+   if (argc > 2)
+      threads = (unsigned)strtoul(argv[2], NULL, 0);
+
+   if (!frames)
+      return 1;
+
+   printf("%u cores, %u threads\n",
+         cpu_features_get_core_amount(), threads);
+
+   for (i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++)
+   {
+      size_t j;
+      double t_ref, t_simd, t_thr;
+      const struct bench_case *c = &bench_cases[i];
+      size_t in_size             = (size_t)c->in_width
+         * c->in_height * bench_bpp(c->in_fmt);
+      size_t out_size            = (size_t)c->out_width
+         * c->out_height * bench_bpp(c->out_fmt);
+      uint8_t *input             = (uint8_t*)malloc(in_size);
+      uint8_t *out_ref           = (uint8_t*)calloc(1, out_size);
+      uint8_t *out_simd          = (uint8_t*)calloc(1, out_size);
+      uint8_t *out_thr           = (uint8_t*)calloc(1, out_size);
+
+      if (!input || !out_ref || !out_simd || !out_thr)
+         return 1;
+
+      srand(i + 1);
+      for (j = 0; j < in_size; j++)
+         input[j] = (uint8_t)rand();
+
+      t_ref  = bench_run(c, input, out_ref,  0,    1,       frames);
+      t_simd = bench_run(c, input, out_simd, simd, 1,       frames);
+      t_thr  = bench_run(c, input, out_thr,  simd, threads, frames);
+
+      printf("%4dx%-4d -> %4dx%-4d %-8s C: %8.2f ms, SIMD: %8.2f ms, "
+            "threaded: %8.2f ms",
+            c->in_width, c->in_height, c->out_width, c->out_height,
+            bench_type_names[c->type],
+            t_ref / 1000.0, t_simd / 1000.0, t_thr / 1000.0);
+
+      if (     t_ref < 0 || t_simd < 0 || t_thr < 0
+            || memcmp(out_ref, out_simd, out_size)
+            || memcmp(out_ref, out_thr,  out_size))
+      {
+         printf(" MISMATCH");
+         ret = false;
+      }
+      printf("\n");
+
+      free(input);
+      free(out_ref);
+      free(out_simd);
+      free(out_thr);
+   }
+
+   return ret ? 0 : 1;
+}
@@ -31,19 +31,6 @@
 /* Current RZIP file format version */
 #define RZIP_VERSION 1
 
-/* Compression level
- * > zlib default of 6 provides the best
- *   balance between file size and
- *   compression speed */
-#define RZIP_COMPRESSION_LEVEL 6
-
-/* Default chunk size: 128kb */
-#define RZIP_DEFAULT_CHUNK_SIZE 131072
-
-/* Header sizes (in bytes) */
-#define RZIP_HEADER_SIZE 20
-#define RZIP_CHUNK_HEADER_SIZE 4
-
 /* Holds all metadata for an RZIP file stream */
 struct rzipstream
 {
@@ -147,14 +134,10 @@ file_uncompressed:
 /* Writes header information to RZIP file
  * > ID 'magic numbers' + uncompressed
  *   file/chunk sizes */
-static bool rzipstream_write_file_header(rzipstream_t *stream)
+void rzipstream_encode_header(uint8_t *header_bytes,
+      uint32_t chunk_size, uint64_t size)
 {
    unsigned i;
-   int64_t length;
-   uint8_t header_bytes[RZIP_HEADER_SIZE];
-
-   if (!stream)
-      return false;
 
    /* Populate header array */
    for (i = 0; i < RZIP_HEADER_SIZE; i++)
@@ -171,20 +154,32 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
    header_bytes[7]    =        35;    /* # */
 
    /* > Uncompressed chunk size - next 4 bytes */
-   header_bytes[11]   = (stream->chunk_size >> 24) & 0xFF;
-   header_bytes[10]   = (stream->chunk_size >> 16) & 0xFF;
-   header_bytes[9]    = (stream->chunk_size >>  8) & 0xFF;
-   header_bytes[8]    =  stream->chunk_size        & 0xFF;
+   header_bytes[11]   = (chunk_size >> 24) & 0xFF;
+   header_bytes[10]   = (chunk_size >> 16) & 0xFF;
+   header_bytes[9]    = (chunk_size >>  8) & 0xFF;
+   header_bytes[8]    =  chunk_size        & 0xFF;
 
    /* > Total uncompressed data size - next 8 bytes */
-   header_bytes[19]   = (stream->size >> 56) & 0xFF;
-   header_bytes[18]   = (stream->size >> 48) & 0xFF;
-   header_bytes[17]   = (stream->size >> 40) & 0xFF;
-   header_bytes[16]   = (stream->size >> 32) & 0xFF;
-   header_bytes[15]   = (stream->size >> 24) & 0xFF;
-   header_bytes[14]   = (stream->size >> 16) & 0xFF;
-   header_bytes[13]   = (stream->size >>  8) & 0xFF;
-   header_bytes[12]   =  stream->size        & 0xFF;
+   header_bytes[19]   = (size >> 56) & 0xFF;
+   header_bytes[18]   = (size >> 48) & 0xFF;
+   header_bytes[17]   = (size >> 40) & 0xFF;
+   header_bytes[16]   = (size >> 32) & 0xFF;
+   header_bytes[15]   = (size >> 24) & 0xFF;
+   header_bytes[14]   = (size >> 16) & 0xFF;
+   header_bytes[13]   = (size >>  8) & 0xFF;
+   header_bytes[12]   =  size        & 0xFF;
+}
+
+static bool rzipstream_write_file_header(rzipstream_t *stream)
+{
+   int64_t length;
+   uint8_t header_bytes[RZIP_HEADER_SIZE];
+
+   if (!stream)
+      return false;
+
+   rzipstream_encode_header(header_bytes,
+         stream->chunk_size, stream->size);
 
    /* Reset file to start */
    filestream_seek(stream->file, 0, SEEK_SET);
@@ -741,11 +736,20 @@ error:
 
 /* File Write */
 
+/* Header of a compressed chunk, see rzip_stream.h */
+void rzipstream_encode_chunk_header(uint8_t *chunk_header_bytes,
+      uint32_t compressed_size)
+{
+   chunk_header_bytes[3] = (compressed_size >> 24) & 0xFF;
+   chunk_header_bytes[2] = (compressed_size >> 16) & 0xFF;
+   chunk_header_bytes[1] = (compressed_size >>  8) & 0xFF;
+   chunk_header_bytes[0] =  compressed_size        & 0xFF;
+}
+
 /* Compresses currently cached data and writes it
  * as the next RZIP file chunk */
 static bool rzipstream_write_chunk(rzipstream_t *stream)
 {
-   unsigned i;
    int64_t length;
    uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
    uint32_t deflate_read;
@@ -754,9 +758,6 @@ static bool rzipstream_write_chunk(rzipstream_t *stream)
    if (!stream || !stream->deflate_backend || !stream->deflate_stream)
       return false;
 
-   for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
-      chunk_header_bytes[i] = 0;
-
    /* Compress data currently held in input buffer */
    stream->deflate_backend->set_in(
          stream->deflate_stream,
@@ -784,10 +785,7 @@ static bool rzipstream_write_chunk(rzipstream_t *stream)
       return false;
 
    /* Write compressed chunk size to file */
-   chunk_header_bytes[3] = (deflate_written >> 24) & 0xFF;
-   chunk_header_bytes[2] = (deflate_written >> 16) & 0xFF;
-   chunk_header_bytes[1] = (deflate_written >>  8) & 0xFF;
-   chunk_header_bytes[0] =  deflate_written        & 0xFF;
+   rzipstream_encode_chunk_header(chunk_header_bytes, deflate_written);
 
    length = filestream_write(
          stream->file, chunk_header_bytes, sizeof(chunk_header_bytes));
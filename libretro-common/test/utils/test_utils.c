@@ -70,6 +70,93 @@ START_TEST (test_crc32)
 }
 END_TEST
 
+/* Bit at a time reference implementation */
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   crc = ~crc;
+   while (len--)
+   {
+      unsigned k;
+      crc ^= *buf++;
+      for (k = 0; k < 8; k++)
+         crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+   }
+   return ~crc;
+}
+
+START_TEST (test_crc32_long)
+{
+   size_t i, len;
+   uint8_t *buf = (uint8_t*)malloc(4096 + 16);
+
+   ck_assert(buf != NULL);
+   for (i = 0; i < 4096 + 16; i++)
+      buf[i] = (uint8_t)(i * 131 + (i >> 8));
+
+   /* Cover all code path boundaries and alignments */
+   for (len = 0; len < 300; len++)
+      for (i = 0; i < 16; i++)
+         ck_assert_uint_eq(encoding_crc32(0, buf + i, len),
+               crc32_bitwise(0, buf + i, len));
+
+   ck_assert_uint_eq(encoding_crc32(0, buf + 3, 4096),
+         crc32_bitwise(0, buf + 3, 4096));
+   ck_assert_uint_eq(encoding_crc32_parallel(0, buf, 4096),
+         crc32_bitwise(0, buf, 4096));
+
+   /* Incremental updates */
+   ck_assert_uint_eq(
+         encoding_crc32(encoding_crc32(0, buf, 1000), buf + 1000, 3096),
+         crc32_bitwise(0, buf, 4096));
+
+   free(buf);
+}
+END_TEST
+
+START_TEST (test_crc32_threads)
+{
+   /* Large enough for four 4 MB stripes, with an
+    * odd tail so the last stripe is longer */
+   size_t i, len = 16 * 1024 * 1024 + 13;
+   uint8_t *buf  = (uint8_t*)malloc(len);
+   uint32_t crc;
+
+   ck_assert(buf != NULL);
+   for (i = 0; i < len; i++)
+      buf[i] = (uint8_t)(i * 131 + (i >> 8));
+
+   crc = encoding_crc32(0, buf, len);
+
+   ck_assert_uint_eq(encoding_crc32_threads(0, buf, len, 4), crc);
+   ck_assert_uint_eq(encoding_crc32_threads(0, buf, len, 3), crc);
+   ck_assert_uint_eq(encoding_crc32_threads(0, buf, len, 2), crc);
+   ck_assert_uint_eq(encoding_crc32_parallel(0, buf, len), crc);
+
+   /* Continuing from a previous CRC */
+   ck_assert_uint_eq(encoding_crc32_threads(
+            encoding_crc32(0, buf, 1000), buf + 1000, len - 1000, 4),
+         crc);
+
+   free(buf);
+}
+END_TEST
+
+START_TEST (test_crc32_combine)
+{
+   char buf[] = "The quick brown fox jumps over the lazy dog";
+   size_t len = strlen(buf);
+   size_t i;
+
+   for (i = 0; i <= len; i++)
+   {
+      uint32_t crc1 = encoding_crc32(0, (uint8_t*)buf, i);
+      uint32_t crc2 = encoding_crc32(0, (uint8_t*)buf + i, len - i);
+      ck_assert_uint_eq(encoding_crc32_combine(crc1, crc2, len - i),
+            0x414fa339);
+   }
+}
+END_TEST
+
 START_TEST (test_crc32_file)
 {
    char tmpfile[512];
@@ -94,6 +181,9 @@ Suite *create_suite(void)
    TCase *tc_core = tcase_create("Core");
    tcase_add_test(tc_core, test_md5);
    tcase_add_test(tc_core, test_crc32);
+   tcase_add_test(tc_core, test_crc32_long);
+   tcase_add_test(tc_core, test_crc32_threads);
+   tcase_add_test(tc_core, test_crc32_combine);
    tcase_add_test(tc_core, test_crc32_file);
    suite_add_tcase(s, tc_core);
 
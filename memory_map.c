@@ -0,0 +1,287 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory_map.h"
+
+/* Region sizes are 32-bit, so the very last byte of
+ * the address space can not be mapped */
+#define MEMORY_MAP_ADDRESS_END  ((uint64_t)0xFFFFFFFF)
+
+/* Upper bound on the mirrors a single descriptor may
+ * be split into by its select bits */
+#define MEMORY_MAP_MAX_BLOCKS   4096
+
+static bool memory_map_insert(memory_map_t *map, unsigned idx,
+      uint64_t start, uint64_t end, uint8_t *data, unsigned flags)
+{
+   memory_map_region_t *region;
+
+   if (map->num_regions >= MEMORY_MAP_MAX_REGIONS)
+      return false;
+
+   if (map->num_regions == map->cap_regions)
+   {
+      unsigned cap                 = map->cap_regions
+         ? map->cap_regions * 2 : 16;
+      memory_map_region_t *regions = (memory_map_region_t*)realloc(
+            map->regions, cap * sizeof(*regions));
+
+      if (!regions)
+         return false;
+
+      map->regions     = regions;
+      map->cap_regions = cap;
+   }
+
+   memmove(&map->regions[idx + 1], &map->regions[idx],
+         (map->num_regions - idx) * sizeof(*map->regions));
+
+   region        = &map->regions[idx];
+   region->data  = data;
+   region->start = (uint32_t)start;
+   region->size  = (uint32_t)(end - start);
+   region->flags = flags;
+   map->num_regions++;
+
+   return true;
+}
+
+static void memory_map_free_pages(memory_map_t *map)
+{
+   unsigned i;
+
+   for (i = 0; i < map->num_leaves; i++)
+      free(map->leaves[i]);
+
+   free(map->leaves);
+   free(map->pages);
+
+   map->leaves     = NULL;
+   map->pages      = NULL;
+   map->num_leaves = 0;
+   map->cap_leaves = 0;
+}
+
+bool memory_map_add(memory_map_t *map, uint32_t start,
+      void *data, size_t size, unsigned flags)
+{
+   unsigned i;
+   uint64_t cur = start;
+   uint64_t end = (uint64_t)start + size;
+
+   /* Lookups must not see a half-updated region list */
+   memory_map_free_pages(map);
+
+   if (end > MEMORY_MAP_ADDRESS_END)
+      end = MEMORY_MAP_ADDRESS_END;
+
+   for (i = 0; i < map->num_regions && cur < end; i++)
+   {
+      const memory_map_region_t *region = &map->regions[i];
+      uint64_t region_end = (uint64_t)region->start + region->size;
+
+      if (region_end <= cur)
+         continue;
+      if (region->start >= end)
+         break;
+
+      /* Claim the gap in front of this region */
+      if (region->start > cur)
+      {
+         if (!memory_map_insert(map, i, cur, region->start,
+                  data ? (uint8_t*)data + (cur - start) : NULL, flags))
+            return false;
+         i++;
+      }
+
+      cur = region_end;
+   }
+
+   if (cur < end)
+      return memory_map_insert(map, i, cur, end,
+            data ? (uint8_t*)data + (cur - start) : NULL, flags);
+
+   return true;
+}
+
+bool memory_map_add_descriptor(memory_map_t *map,
+      const struct retro_memory_descriptor *desc)
+{
+   uint64_t addr;
+   uint64_t block;
+   uint64_t start       = desc->start;
+   uint64_t end         = start + desc->len;
+   uint64_t run_start   = start;
+   uint64_t run_end     = start;
+   uint32_t select      = (uint32_t)desc->select;
+   uint8_t *data        = desc->ptr
+      ? (uint8_t*)desc->ptr + desc->offset : NULL;
+   unsigned flags       = (desc->flags & RETRO_MEMDESC_CONST)
+      ? MEMORY_MAP_READONLY : 0;
+
+   if (!desc->len || start >= MEMORY_MAP_ADDRESS_END)
+      return true;
+
+   if (end > MEMORY_MAP_ADDRESS_END)
+      end = MEMORY_MAP_ADDRESS_END;
+
+   if (!(block = select & ~(select - 1)))
+      return memory_map_add(map, (uint32_t)start, data,
+            (size_t)(end - start), flags);
+
+   /* Addresses in a block aligned to the lowest select
+    * bit agree on every select bit, so such a block either
+    * matches start entirely or not at all */
+   addr = start & ~(block - 1);
+
+   if ((end - addr + block - 1) / block > MEMORY_MAP_MAX_BLOCKS)
+      return false;
+
+   for (; addr < end; addr += block)
+   {
+      uint64_t lo = (addr < start) ? start : addr;
+      uint64_t hi = (addr + block < end) ? addr + block : end;
+
+      if ((addr ^ start) & select)
+         continue;
+
+      if (run_end != lo)
+      {
+         if (run_end > run_start && !memory_map_add(map,
+                  (uint32_t)run_start,
+                  data ? data + (run_start - start) : NULL,
+                  (size_t)(run_end - run_start), flags))
+            return false;
+         run_start = lo;
+      }
+
+      run_end = hi;
+   }
+
+   if (run_end > run_start)
+      return memory_map_add(map, (uint32_t)run_start,
+            data ? data + (run_start - start) : NULL,
+            (size_t)(run_end - run_start), flags);
+
+   return true;
+}
+
+static uint16_t *memory_map_new_leaf(memory_map_t *map, uint16_t fill)
+{
+   unsigned i;
+   uint16_t *leaf = NULL;
+
+   if (map->num_leaves == map->cap_leaves)
+   {
+      unsigned cap      = map->cap_leaves ? map->cap_leaves * 2 : 16;
+      uint16_t **leaves = (uint16_t**)realloc(map->leaves,
+            cap * sizeof(*leaves));
+
+      if (!leaves)
+         return NULL;
+
+      map->leaves     = leaves;
+      map->cap_leaves = cap;
+   }
+
+   if (!(leaf = (uint16_t*)calloc(MEMORY_MAP_LEAF_PAGES, sizeof(*leaf))))
+      return NULL;
+
+   if (fill)
+      for (i = 0; i < MEMORY_MAP_LEAF_PAGES; i++)
+         leaf[i] = fill;
+
+   map->leaves[map->num_leaves++] = leaf;
+   return leaf;
+}
+
+bool memory_map_build(memory_map_t *map)
+{
+   unsigned i;
+
+   memory_map_free_pages(map);
+
+   if (!map->num_regions)
+      return true;
+
+   if (!(map->pages = (uint16_t**)calloc(MEMORY_MAP_DIR_SIZE,
+               sizeof(*map->pages))))
+      return false;
+
+   for (i = 0; i < map->num_regions; i++)
+   {
+      uint64_t d;
+      const memory_map_region_t *region = &map->regions[i];
+      uint64_t start   = region->start;
+      uint64_t end     = start + region->size;
+      uint16_t entry   = (uint16_t)(i + 1);
+      uint16_t *filled = NULL;
+
+      for (d = start >> MEMORY_MAP_LEAF_SHIFT;
+            d <= (end - 1) >> MEMORY_MAP_LEAF_SHIFT; d++)
+      {
+         uint64_t p;
+         uint64_t leaf_start = d << MEMORY_MAP_LEAF_SHIFT;
+         uint64_t leaf_end   = leaf_start + (1 << MEMORY_MAP_LEAF_SHIFT);
+         uint16_t *leaf      = map->pages[d];
+
+         /* Regions do not overlap, so a leaf this region
+          * covers entirely belongs to it alone and all of
+          * them can share one filled leaf */
+         if (start <= leaf_start && end >= leaf_end)
+         {
+            if (!filled && !(filled = memory_map_new_leaf(map, entry)))
+               goto error;
+            map->pages[d] = filled;
+            continue;
+         }
+
+         if (!leaf && !(leaf = map->pages[d] =
+                  memory_map_new_leaf(map, 0)))
+            goto error;
+
+         /* Regions are sorted, so an earlier region that
+          * already claimed a page starts before this one */
+         for (p = ((start > leaf_start) ? start : leaf_start)
+               >> MEMORY_MAP_PAGE_SHIFT;
+               p <= (((end < leaf_end) ? end : leaf_end) - 1)
+               >> MEMORY_MAP_PAGE_SHIFT; p++)
+         {
+            uint16_t *page = &leaf[p & (MEMORY_MAP_LEAF_PAGES - 1)];
+            if (!*page)
+               *page = entry;
+         }
+      }
+   }
+
+   return true;
+
+error:
+   memory_map_free_pages(map);
+   return false;
+}
+
+void memory_map_free(memory_map_t *map)
+{
+   memory_map_free_pages(map);
+   free(map->regions);
+
+   map->regions     = NULL;
+   map->num_regions = 0;
+   map->cap_regions = 0;
+}
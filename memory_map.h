@@ -0,0 +1,184 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MEMORY_MAP_H
+#define _MEMORY_MAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <retro_inline.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Guest address to host pointer translation.
+ *
+ * A map is a set of non-overlapping regions in a 32-bit
+ * guest address space, plus a two-level page table that
+ * holds, for every 1 KB page, the first region touching
+ * that page. A lookup is one directory load, one page
+ * load and a bounds check; only pages shared by several
+ * small regions walk to the next region.
+ *
+ * Regions are added in priority order (a region only
+ * keeps the addresses no earlier region claimed) and
+ * the page table is built by memory_map_build(). The
+ * map is not thread-safe and must be rebuilt whenever
+ * the core moves its memory. */
+
+#define MEMORY_MAP_PAGE_SHIFT   10
+#define MEMORY_MAP_LEAF_SHIFT   20
+#define MEMORY_MAP_LEAF_PAGES   (1 << (MEMORY_MAP_LEAF_SHIFT - MEMORY_MAP_PAGE_SHIFT))
+#define MEMORY_MAP_DIR_SIZE     (1 << (32 - MEMORY_MAP_LEAF_SHIFT))
+#define MEMORY_MAP_MAX_REGIONS  0xFFFF
+
+/* Region can not be written through the command interface */
+#define MEMORY_MAP_READONLY     (1 << 0)
+
+typedef struct memory_map_region
+{
+   /* NULL if the core declared the range without
+    * exposing its data */
+   uint8_t *data;
+   uint32_t start;
+   uint32_t size;
+   unsigned flags;
+} memory_map_region_t;
+
+typedef struct memory_map
+{
+   memory_map_region_t *regions;      /* sorted by start */
+   uint16_t **pages;                  /* MEMORY_MAP_DIR_SIZE leaves */
+   uint16_t **leaves;                 /* allocated leaves */
+   unsigned num_regions;
+   unsigned cap_regions;
+   unsigned num_leaves;
+   unsigned cap_leaves;
+} memory_map_t;
+
+/**
+ * memory_map_add:
+ * @map                 : Memory map.
+ * @start               : First guest address of the range.
+ * @data                : Host pointer of @start, may be NULL.
+ * @size                : Size of the range in bytes.
+ * @flags               : MEMORY_MAP_* flags.
+ *
+ * Adds the parts of the range that are not already
+ * claimed by an earlier region. Invalidates the page
+ * table until the next memory_map_build().
+ *
+ * Returns: false if the map ran out of memory or regions.
+ **/
+bool memory_map_add(memory_map_t *map, uint32_t start,
+      void *data, size_t size, unsigned flags);
+
+/**
+ * memory_map_add_descriptor:
+ * @map                 : Memory map.
+ * @desc                : Preprocessed libretro memory descriptor.
+ *
+ * Adds the guest addresses matched by @desc the same way
+ * as a sequential descriptor search does: the address
+ * must lie in [start, start + len) and agree with start
+ * on every select bit.
+ *
+ * Returns: false if the map ran out of memory or regions,
+ * or @desc splits into too many blocks, in which case the
+ * caller should fall back to searching the descriptors.
+ **/
+bool memory_map_add_descriptor(memory_map_t *map,
+      const struct retro_memory_descriptor *desc);
+
+/**
+ * memory_map_build:
+ * @map                 : Memory map.
+ *
+ * (Re)builds the page table from the current regions.
+ **/
+bool memory_map_build(memory_map_t *map);
+
+/**
+ * memory_map_free:
+ * @map                 : Memory map.
+ *
+ * Releases every region and the page table. The map
+ * is left empty and can be filled again.
+ **/
+void memory_map_free(memory_map_t *map);
+
+static INLINE const memory_map_region_t *memory_map_find_region(
+      const memory_map_t *map, uint32_t address)
+{
+   const memory_map_region_t *region = NULL;
+   const memory_map_region_t *end    = NULL;
+   const uint16_t *leaf              = NULL;
+   unsigned entry;
+
+   if (!map->pages
+         || !(leaf = map->pages[address >> MEMORY_MAP_LEAF_SHIFT]))
+      return NULL;
+
+   if (!(entry = leaf[(address >> MEMORY_MAP_PAGE_SHIFT)
+            & (MEMORY_MAP_LEAF_PAGES - 1)]))
+      return NULL;
+
+   region = &map->regions[entry - 1];
+   end    = map->regions + map->num_regions;
+
+   /* Only taken when several regions share the page */
+   while (address - region->start >= region->size)
+   {
+      if (address < region->start || ++region == end)
+         return NULL;
+   }
+
+   return region;
+}
+
+/**
+ * memory_map_find:
+ * @map                 : Memory map.
+ * @address             : Guest address.
+ * @avail               : Optional, set to the number of bytes
+ *                        that are contiguous in host memory
+ *                        starting at @address.
+ *
+ * Returns: host pointer of @address, or NULL if it is not
+ * mapped or the region has no data.
+ **/
+static INLINE uint8_t *memory_map_find(const memory_map_t *map,
+      uint32_t address, uint32_t *avail)
+{
+   const memory_map_region_t *region = memory_map_find_region(map, address);
+
+   if (!region || !region->data)
+   {
+      if (avail)
+         *avail = 0;
+      return NULL;
+   }
+
+   if (avail)
+      *avail = region->size - (address - region->start);
+   return region->data + (address - region->start);
+}
+
+RETRO_END_DECLS
+
+#endif
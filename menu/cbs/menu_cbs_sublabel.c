@@ -631,6 +631,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_stateless_mode,        MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_check_frames,          MENU_ENUM_SUBLABEL_NETPLAY_CHECK_FRAMES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_nat_traversal,         MENU_ENUM_SUBLABEL_NETPLAY_NAT_TRAVERSAL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_stdin_cmd_enable,              MENU_ENUM_SUBLABEL_STDIN_CMD_ENABLE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_network_cmd_stream_enable,     MENU_ENUM_SUBLABEL_NETWORK_CMD_STREAM_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_mouse_enable,                  MENU_ENUM_SUBLABEL_MOUSE_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_pointer_enable,                MENU_ENUM_SUBLABEL_POINTER_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_thumbnails,                    MENU_ENUM_SUBLABEL_THUMBNAILS)
@@ -3008,6 +3009,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_STDIN_CMD_ENABLE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_stdin_cmd_enable);
             break;
+         case MENU_ENUM_LABEL_NETWORK_CMD_STREAM_ENABLE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_network_cmd_stream_enable);
+            break;
          case MENU_ENUM_LABEL_NETPLAY_PUBLIC_ANNOUNCE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_public_announce);
             break;
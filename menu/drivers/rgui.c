@@ -53,6 +53,7 @@
 #include "../../configuration.h"
 #include "../../gfx/drivers_font_renderer/bitmap.h"
 #include "../../gfx/drivers_font_renderer/bitmapfont_10x10.h"
+#include "rgui_blit.h"
 
 /* Thumbnail additions */
 #include "../../gfx/gfx_thumbnail_path.h"
@@ -1023,6 +1024,11 @@ typedef struct
    frame_buf_t frame_buf;
    frame_buf_t background_buf;
    frame_buf_t upscale_buf;
+   /* Copy of the frame last passed to
+    * video_driver_set_texture_frame(), diffed
+    * against frame_buf to find changed tiles */
+   frame_buf_t uploaded_buf;
+   uint8_t *dirty_tiles;
 
    thumbnail_t fs_thumbnail;
    thumbnail_t mini_thumbnail;
@@ -1047,6 +1053,8 @@ typedef struct
    unsigned menu_aspect_ratio;
    unsigned menu_aspect_ratio_lock;
    unsigned language;
+   unsigned upload_width;
+   unsigned upload_height;
 
    rgui_term_layout_t term_layout;
 
@@ -1066,6 +1074,9 @@ typedef struct
    char menu_title[255]; /* Must be a fixed length array... */
    char menu_sublabel[MENU_SUBLABEL_MAX_LENGTH]; /* Must be a fixed length array... */
 
+   /* Regular font glyphs, one bitmask per row */
+   uint8_t glyph_rows[RGUI_NUM_FONT_GLYPHS_EXTENDED][FONT_HEIGHT];
+
    bool bg_modified;
    bool force_redraw;
    bool force_menu_refresh;
@@ -1087,6 +1098,7 @@ typedef struct
    bool thumbnail_load_pending;
    bool show_wallpaper;
    bool aspect_update_pending;
+   bool uploaded_valid;
 #ifdef HAVE_GFX_WIDGETS
    bool widgets_supported;
 #endif
@@ -1591,6 +1603,7 @@ static void rgui_fonts_free(rgui_t *rgui)
 
 static bool rgui_fonts_init(rgui_t *rgui)
 {
+   unsigned i, j, k;
 #ifdef HAVE_LANGEXTRA
    unsigned language = *msg_hash_get_uint(MSG_HASH_USER_LANGUAGE);
 
@@ -1702,6 +1715,24 @@ english:
       return false;
    }
 
+   /* Pack the glyphs into row bitmasks for
+    * rgui_blit_glyph() */
+   for (i = 0; i < RGUI_NUM_FONT_GLYPHS_EXTENDED; i++)
+   {
+      bool *symbol_lut = rgui->fonts.regular->lut[i];
+
+      for (j = 0; j < FONT_HEIGHT; j++)
+      {
+         uint8_t row = 0;
+
+         for (k = 0; k < FONT_WIDTH; k++)
+            if (symbol_lut[k + (j * FONT_WIDTH)])
+               row |= (uint8_t)(1 << k);
+
+         rgui->glyph_rows[i][j] = row;
+      }
+   }
+
    rgui->font_width         = FONT_WIDTH;
    rgui->font_height        = FONT_HEIGHT;
    rgui->font_width_stride  = FONT_WIDTH_STRIDE;
@@ -1720,137 +1751,41 @@ static void rgui_fill_rect(
       uint16_t dark_color, uint16_t light_color,
       bool thickness)
 {
-   unsigned x_index, y_index;
+   unsigned i, j;
    unsigned x_start = x <= fb_width  ? x : fb_width;
    unsigned y_start = y <= fb_height ? y : fb_height;
    unsigned x_end   = x + width;
    unsigned y_end   = y + height;
-   size_t x_size;
-   uint16_t scanline_even[RGUI_MAX_FB_WIDTH]; /* Initial values don't matter here */
-   uint16_t scanline_odd[RGUI_MAX_FB_WIDTH];
+   uint16_t patterns[16];
 
    /* Note: unlike rgui_color_rect() and rgui_draw_particle(),
-    * this function is frequently used to fill large areas.
-    * We therefore gain significant performance benefits
-    * from using memcpy() tricks... */
+    * this function is frequently used to fill large areas,
+    * so the rows go through rgui_blit_fill_rect() */
 
    x_end  = x_end <= fb_width  ? x_end : fb_width;
    y_end  = y_end <= fb_height ? y_end : fb_height;
-   x_size = (x_end - x_start) * sizeof(uint16_t);
 
    /* Sanity check */
-   if (x_size == 0)
+   if (x_end <= x_start)
       return;
 
-   /* If dark_color and light_color are the same,
-    * perform a solid fill */
-   if (dark_color == light_color)
-   {
-      uint16_t *src = scanline_even + x_start;
-      uint16_t *dst = data + x_start;
-
-      /* Populate source array */
-      for (x_index = x_start; x_index < x_end; x_index++)
-         *(scanline_even + x_index) = dark_color;
-
-      /* Fill destination array */
-      for (y_index = y_start; y_index < y_end; y_index++)
-         memcpy(dst + (y_index * fb_width), src, x_size);
-   }
-   else if (thickness)
+   /* The checkerboard repeats every 4 pixels both ways */
+   for (j = 0; j < 4; j++)
    {
-      uint16_t *src_a      = NULL;
-      uint16_t *src_b      = NULL;
-      uint16_t *src_c      = NULL;
-      uint16_t *src_d      = NULL;
-      uint16_t *dst        = data + x_start;
-
-      /* Determine in which order the source arrays
-       * should be copied */
-      switch (y_start & 0x3)
-      {
-         case 0x1:
-            src_a = scanline_even + x_start;
-            src_b = scanline_odd  + x_start;
-            src_c = src_b;
-            src_d = src_a;
-            break;
-         case 0x2:
-            src_a = scanline_odd  + x_start;
-            src_b = src_a;
-            src_c = scanline_even + x_start;
-            src_d = src_c;
-            break;
-         case 0x3:
-            src_a = scanline_odd  + x_start;
-            src_b = scanline_even + x_start;
-            src_c = src_b;
-            src_d = src_a;
-            break;
-         case 0x0:
-         default:
-            src_a = scanline_even + x_start;
-            src_b = src_a;
-            src_c = scanline_odd  + x_start;
-            src_d = src_c;
-            break;
-      }
-
-      /* Populate source arrays */
-      for (x_index = x_start; x_index < x_end; x_index++)
+      for (i = 0; i < 4; i++)
       {
-         bool x_is_even = (((x_index >> 1) & 1) == 0);
-         *(scanline_even + x_index) = x_is_even ? dark_color  : light_color;
-         *(scanline_odd  + x_index) = x_is_even ? light_color : dark_color;
+         unsigned x_index = x_start + i;
+         unsigned y_index = y_start + j;
+         /* Thick checks are 2x2 pixels, thin ones 1x1 */
+         bool is_dark     = thickness
+               ? ((((x_index >> 1) ^ (y_index >> 1)) & 1) == 0)
+               : (((x_index ^ y_index) & 1) == 0);
+         patterns[(j << 2) + i] = is_dark ? dark_color : light_color;
       }
-
-      /* Fill destination array */
-      for (y_index = y_start    ; y_index < y_end; y_index += 4)
-         memcpy(dst + (y_index * fb_width), src_a, x_size);
-
-      for (y_index = y_start + 1; y_index < y_end; y_index += 4)
-         memcpy(dst + (y_index * fb_width), src_b, x_size);
-
-      for (y_index = y_start + 2; y_index < y_end; y_index += 4)
-         memcpy(dst + (y_index * fb_width), src_c, x_size);
-
-      for (y_index = y_start + 3; y_index < y_end; y_index += 4)
-         memcpy(dst + (y_index * fb_width), src_d, x_size);
    }
-   else
-   {
-      uint16_t *src_a      = NULL;
-      uint16_t *src_b      = NULL;
-      uint16_t *dst        = data + x_start;
-
-      /* Determine in which order the source arrays
-       * should be copied */
-      if ((y_start & 1) == 0)
-      {
-         src_a = scanline_even + x_start;
-         src_b = scanline_odd  + x_start;
-      }
-      else
-      {
-         src_a = scanline_odd  + x_start;
-         src_b = scanline_even + x_start;
-      }
 
-      /* Populate source arrays */
-      for (x_index = x_start; x_index < x_end; x_index++)
-      {
-         bool x_is_even = ((x_index & 1) == 0);
-         *(scanline_even + x_index) = x_is_even ? dark_color  : light_color;
-         *(scanline_odd  + x_index) = x_is_even ? light_color : dark_color;
-      }
-
-      /* Fill destination array */
-      for (y_index = y_start    ; y_index < y_end; y_index += 2)
-         memcpy(dst + (y_index * fb_width), src_a, x_size);
-
-      for (y_index = y_start + 1; y_index < y_end; y_index += 2)
-         memcpy(dst + (y_index * fb_width), src_b, x_size);
-   }
+   rgui_blit_fill_rect(data + (y_start * fb_width) + x_start,
+         fb_width, x_end - x_start, y_end - y_start, patterns);
 }
 
 static void rgui_color_rect(
@@ -1860,21 +1795,24 @@ static void rgui_color_rect(
       unsigned width, unsigned height,
       uint16_t color)
 {
-   unsigned x_index, y_index;
+   unsigned i;
    unsigned x_start = x <= fb_width  ? x : fb_width;
    unsigned y_start = y <= fb_height ? y : fb_height;
    unsigned x_end   = x + width;
    unsigned y_end   = y + height;
+   uint16_t patterns[16];
 
    x_end = x_end <= fb_width  ? x_end : fb_width;
    y_end = y_end <= fb_height ? y_end : fb_height;
 
-   for (y_index = y_start; y_index < y_end; y_index++)
-   {
-      uint16_t *data_ptr = data + (y_index * fb_width);
-      for (x_index = x_start; x_index < x_end; x_index++)
-         *(data_ptr + x_index) = color;
-   }
+   if (x_end <= x_start)
+      return;
+
+   for (i = 0; i < 16; i++)
+      patterns[i] = color;
+
+   rgui_blit_fill_rect(data + (y_start * fb_width) + x_start,
+         fb_width, x_end - x_start, y_end - y_start, patterns);
 }
 
 static void rgui_render_border(rgui_t *rgui, uint16_t *data,
@@ -3279,37 +3217,32 @@ static void prepare_rgui_colors(rgui_t *rgui, settings_t *settings)
 
 /* blit_line() */
 
+/* Pixels from the glyph at @x to the end of its row,
+ * or 0 if it does not start inside the row */
+static INLINE size_t rgui_glyph_room(unsigned fb_width, int x)
+{
+   return ((x >= 0) && ((unsigned)x < fb_width))
+         ? fb_width - (unsigned)x : 0;
+}
+
 static void blit_line_regular(
       rgui_t *rgui,
       unsigned fb_width, int x, int y,
       const char *message, uint16_t color, uint16_t shadow_color)
 {
    uint16_t *frame_buf_data = rgui->frame_buf.data;
-   bool **lut               = rgui->fonts.regular->lut;
 
    while (!string_is_empty(message))
    {
-      unsigned i, j;
       uint8_t symbol = (uint8_t)*message++;
 
       if (symbol >= RGUI_NUM_FONT_GLYPHS_REGULAR)
          continue;
 
       if (symbol != ' ')
-      {
-         bool *symbol_lut = lut[symbol];
-
-         for (j = 0; j < FONT_HEIGHT; j++)
-         {
-            unsigned buff_offset = ((y + j) * fb_width) + x;
-
-            for (i = 0; i < FONT_WIDTH; i++)
-            {
-               if (*(symbol_lut + i + (j * FONT_WIDTH)))
-                  *(frame_buf_data + buff_offset + i) = color;
-            }
-         }
-      }
+         rgui_blit_glyph(frame_buf_data + (y * fb_width) + x,
+               fb_width, rgui_glyph_room(fb_width, x),
+               rgui->glyph_rows[symbol], FONT_HEIGHT, color);
 
       x += FONT_WIDTH_STRIDE;
    }
@@ -3321,48 +3254,19 @@ static void blit_line_regular_shadow(
       const char *message, uint16_t color, uint16_t shadow_color)
 {
    uint16_t *frame_buf_data = rgui->frame_buf.data;
-   bool **lut               = rgui->fonts.regular->lut;
-   uint16_t color_buf[2];
-   uint16_t shadow_color_buf[2];
-
-   color_buf[0] = color;
-   color_buf[1] = shadow_color;
-
-   shadow_color_buf[0] = shadow_color;
-   shadow_color_buf[1] = shadow_color;
 
    while (!string_is_empty(message))
    {
-      unsigned i, j;
       uint8_t symbol = (uint8_t)*message++;
 
       if (symbol >= RGUI_NUM_FONT_GLYPHS_REGULAR)
          continue;
 
       if (symbol != ' ')
-      {
-         bool *symbol_lut = lut[symbol];
-
-         for (j = 0; j < FONT_HEIGHT; j++)
-         {
-            unsigned buff_offset = ((y + j) * fb_width) + x;
-
-            for (i = 0; i < FONT_WIDTH; i++)
-            {
-               if (*(symbol_lut + i + (j * FONT_WIDTH)))
-               {
-                  uint16_t *frame_buf_ptr = frame_buf_data + buff_offset + i;
-
-                  /* Text pixel + right shadow */
-                  memcpy(frame_buf_ptr, color_buf, sizeof(color_buf));
-
-                  /* Bottom shadow */
-                  frame_buf_ptr += fb_width;
-                  memcpy(frame_buf_ptr, shadow_color_buf, sizeof(shadow_color_buf));
-               }
-            }
-         }
-      }
+         rgui_blit_glyph_shadow(frame_buf_data + (y * fb_width) + x,
+               fb_width, rgui_glyph_room(fb_width, x),
+               rgui->glyph_rows[symbol], FONT_HEIGHT,
+               color, shadow_color);
 
       x += FONT_WIDTH_STRIDE;
    }
@@ -3374,7 +3278,6 @@ static void blit_line_extended(
       const char *message, uint16_t color, uint16_t shadow_color)
 {
    uint16_t *frame_buf_data = rgui->frame_buf.data;
-   bool **lut               = rgui->fonts.regular->lut;
 
    while (!string_is_empty(message))
    {
@@ -3383,8 +3286,6 @@ static void blit_line_extended(
          message++;
       else
       {
-         unsigned i, j;
-         bool *symbol_lut;
          uint32_t symbol = utf8_walk(&message);
 
          /* Stupid cretinous hack: 'oe' ligatures are not
@@ -3400,18 +3301,9 @@ static void blit_line_extended(
          if (symbol >= RGUI_NUM_FONT_GLYPHS_EXTENDED)
             continue;
 
-         symbol_lut = lut[symbol];
-
-         for (j = 0; j < FONT_HEIGHT; j++)
-         {
-            unsigned buff_offset = ((y + j) * fb_width) + x;
-
-            for (i = 0; i < FONT_WIDTH; i++)
-            {
-               if (*(symbol_lut + i + (j * FONT_WIDTH)))
-                  *(frame_buf_data + buff_offset + i) = color;
-            }
-         }
+         rgui_blit_glyph(frame_buf_data + (y * fb_width) + x,
+               fb_width, rgui_glyph_room(fb_width, x),
+               rgui->glyph_rows[symbol], FONT_HEIGHT, color);
       }
 
       x += FONT_WIDTH_STRIDE;
@@ -3424,15 +3316,6 @@ static void blit_line_extended_shadow(
       const char *message, uint16_t color, uint16_t shadow_color)
 {
    uint16_t *frame_buf_data = rgui->frame_buf.data;
-   bool **lut               = rgui->fonts.regular->lut;
-   uint16_t color_buf[2];
-   uint16_t shadow_color_buf[2];
-
-   color_buf[0] = color;
-   color_buf[1] = shadow_color;
-
-   shadow_color_buf[0] = shadow_color;
-   shadow_color_buf[1] = shadow_color;
 
    while (!string_is_empty(message))
    {
@@ -3441,8 +3324,6 @@ static void blit_line_extended_shadow(
          message++;
       else
       {
-         unsigned i, j;
-         bool *symbol_lut;
          uint32_t symbol = utf8_walk(&message);
 
          /* Stupid cretinous hack: 'oe' ligatures are not
@@ -3458,27 +3339,10 @@ static void blit_line_extended_shadow(
          if (symbol >= RGUI_NUM_FONT_GLYPHS_EXTENDED)
             continue;
 
-         symbol_lut = lut[symbol];
-
-         for (j = 0; j < FONT_HEIGHT; j++)
-         {
-            unsigned buff_offset = ((y + j) * fb_width) + x;
-
-            for (i = 0; i < FONT_WIDTH; i++)
-            {
-               if (*(symbol_lut + i + (j * FONT_WIDTH)))
-               {
-                  uint16_t *frame_buf_ptr = frame_buf_data + buff_offset + i;
-
-                  /* Text pixel + right shadow */
-                  memcpy(frame_buf_ptr, color_buf, sizeof(color_buf));
-
-                  /* Bottom shadow */
-                  frame_buf_ptr += fb_width;
-                  memcpy(frame_buf_ptr, shadow_color_buf, sizeof(shadow_color_buf));
-               }
-            }
-         }
+         rgui_blit_glyph_shadow(frame_buf_data + (y * fb_width) + x,
+               fb_width, rgui_glyph_room(fb_width, x),
+               rgui->glyph_rows[symbol], FONT_HEIGHT,
+               color, shadow_color);
       }
 
       x += FONT_WIDTH_STRIDE;
@@ -5244,6 +5108,22 @@ static void rgui_framebuffer_free(frame_buf_t *framebuffer)
    framebuffer->data   = NULL;
 }
 
+static void rgui_invalidate_upload(rgui_t *rgui)
+{
+   if (!rgui)
+      return;
+
+   rgui_framebuffer_free(&rgui->uploaded_buf);
+
+   if (rgui->dirty_tiles)
+      free(rgui->dirty_tiles);
+   rgui->dirty_tiles    = NULL;
+
+   rgui->upload_width   = 0;
+   rgui->upload_height  = 0;
+   rgui->uploaded_valid = false;
+}
+
 static void rgui_thumbnail_free(thumbnail_t *thumbnail)
 {
    if (!thumbnail)
@@ -5941,15 +5821,63 @@ static void rgui_free(void *data)
    rgui_framebuffer_free(&rgui->frame_buf);
    rgui_framebuffer_free(&rgui->background_buf);
    rgui_framebuffer_free(&rgui->upscale_buf);
+   rgui_invalidate_upload(rgui);
 
    rgui_thumbnail_free(&rgui->fs_thumbnail);
    rgui_thumbnail_free(&rgui->mini_thumbnail);
    rgui_thumbnail_free(&rgui->mini_left_thumbnail);
 }
 
+/* Diffs the framebuffer against the last uploaded frame.
+ * Returns the number of tiles that changed; when this is
+ * not known (first frame, size change, out of memory)
+ * every tile is flagged and the tile count returned.
+ * rgui->dirty_tiles is NULL if the diff could not be
+ * allocated at all. */
+static size_t rgui_update_dirty_tiles(rgui_t *rgui,
+      unsigned fb_width, unsigned fb_height)
+{
+   frame_buf_t *uploaded_buf = &rgui->uploaded_buf;
+   size_t num_tiles          = rgui_blit_num_tiles(fb_width, fb_height);
+
+   if (  (uploaded_buf->width  != fb_width)  ||
+         (uploaded_buf->height != fb_height) ||
+         !uploaded_buf->data)
+   {
+      rgui_invalidate_upload(rgui);
+
+      uploaded_buf->data = (uint16_t*)
+            malloc(fb_width * fb_height * sizeof(uint16_t));
+      rgui->dirty_tiles  = (uint8_t*)malloc(num_tiles);
+
+      if (!uploaded_buf->data || !rgui->dirty_tiles)
+      {
+         rgui_invalidate_upload(rgui);
+         return num_tiles;
+      }
+
+      uploaded_buf->width  = fb_width;
+      uploaded_buf->height = fb_height;
+   }
+
+   if (!rgui->uploaded_valid)
+   {
+      memcpy(uploaded_buf->data, rgui->frame_buf.data,
+            fb_width * fb_height * sizeof(uint16_t));
+      memset(rgui->dirty_tiles, 1, num_tiles);
+      rgui->uploaded_valid = true;
+      return num_tiles;
+   }
+
+   return rgui_blit_update_tiles(rgui->frame_buf.data,
+         uploaded_buf->data, fb_width, fb_height, rgui->dirty_tiles);
+}
+
 static void rgui_set_texture(void *data)
 {
    unsigned fb_width, fb_height;
+   unsigned out_width, out_height;
+   size_t num_dirty;
    settings_t            *settings = config_get_ptr();
    gfx_display_t          *p_disp  = disp_get_ptr();
 #if defined(DINGUX)
@@ -5965,15 +5893,12 @@ static void rgui_set_texture(void *data)
 
    fb_width               = p_disp->framebuf_width;
    fb_height              = p_disp->framebuf_height;
+   out_width              = fb_width;
+   out_height             = fb_height;
 
    p_disp->framebuf_dirty = false;
 
-   if (internal_upscale_level == RGUI_UPSCALE_NONE)
-   {
-      video_driver_set_texture_frame(rgui->frame_buf.data,
-         false, fb_width, fb_height, 1.0f);
-   }
-   else
+   if (internal_upscale_level != RGUI_UPSCALE_NONE)
    {
       struct video_viewport vp;
       
@@ -5982,21 +5907,8 @@ static void rgui_set_texture(void *data)
       
       /* If viewport is currently the same size (or smaller)
        * than the menu framebuffer, no scaling is required */
-      if ((vp.width <= fb_width) && (vp.height <= fb_height))
-      {
-         video_driver_set_texture_frame(rgui->frame_buf.data,
-            false, fb_width, fb_height, 1.0f);
-      }
-      else
+      if ((vp.width > fb_width) || (vp.height > fb_height))
       {
-         unsigned out_width;
-         unsigned out_height;
-         uint32_t x_ratio, y_ratio;
-         unsigned x_src, y_src;
-         unsigned x_dst, y_dst;
-         frame_buf_t *frame_buf   = &rgui->frame_buf;
-         frame_buf_t *upscale_buf = &rgui->upscale_buf;
-         
          /* Determine output size */
          if (internal_upscale_level == RGUI_UPSCALE_AUTO)
          {
@@ -6008,58 +5920,79 @@ static void rgui_set_texture(void *data)
             out_width  = internal_upscale_level * fb_width;
             out_height = internal_upscale_level * fb_height;
          }
+      }
+   }
+
+   /* Much of the time the menu is redrawn without any
+    * visible change (e.g. a ticker waiting for its next
+    * step), in which case the texture the video driver
+    * holds is still current */
+   num_dirty = rgui_update_dirty_tiles(rgui, fb_width, fb_height);
+
+   if (     (num_dirty == 0)
+         && (rgui->upload_width  == out_width)
+         && (rgui->upload_height == out_height))
+      return;
+
+   if ((out_width == fb_width) && (out_height == fb_height))
+      video_driver_set_texture_frame(rgui->frame_buf.data,
+         false, fb_width, fb_height, 1.0f);
+   else
+   {
+      frame_buf_t *frame_buf   = &rgui->frame_buf;
+      frame_buf_t *upscale_buf = &rgui->upscale_buf;
+      bool full_upscale        = !rgui->dirty_tiles ||
+            (rgui->upload_width  != out_width) ||
+            (rgui->upload_height != out_height);
+      
+      /* Allocate upscaling buffer, if required */
+      if (  (upscale_buf->width  != out_width)  ||
+            (upscale_buf->height != out_height) ||
+            !upscale_buf->data)
+      {
+         upscale_buf->width = out_width;
+         upscale_buf->height = out_height;
+         full_upscale       = true;
          
-         /* Allocate upscaling buffer, if required */
-         if (  (upscale_buf->width  != out_width)  ||
-               (upscale_buf->height != out_height) ||
-               !upscale_buf->data)
+         if (upscale_buf->data)
          {
-            upscale_buf->width = out_width;
-            upscale_buf->height = out_height;
-            
-            if (upscale_buf->data)
-            {
-               free(upscale_buf->data);
-               upscale_buf->data = NULL;
-            }
-            
-            upscale_buf->data = (uint16_t*)
-                  calloc(out_width * out_height, sizeof(uint16_t));
-            if (!upscale_buf->data)
-            {
-               /* Uh oh... This could mean we don't have enough
-                * memory, so disable upscaling and draw the usual
-                * framebuffer... */
-               configuration_set_uint(settings,
-                     settings->uints.menu_rgui_internal_upscale_level,
-                     RGUI_UPSCALE_NONE);
-               video_driver_set_texture_frame(frame_buf->data,
-                     false, fb_width, fb_height, 1.0f);
-               return;
-            }
+            free(upscale_buf->data);
+            upscale_buf->data = NULL;
          }
          
-         /* Perform nearest neighbour upscaling
-          * NB: We're duplicating code here, but trying to handle
-          * this with a polymorphic function is too much of a drag... */
-         x_ratio = ((fb_width  << 16) / out_width);
-         y_ratio = ((fb_height << 16) / out_height);
-
-         for (y_dst = 0; y_dst < out_height; y_dst++)
+         upscale_buf->data = (uint16_t*)
+               calloc(out_width * out_height, sizeof(uint16_t));
+         if (!upscale_buf->data)
          {
-            y_src = (y_dst * y_ratio) >> 16;
-            for (x_dst = 0; x_dst < out_width; x_dst++)
-            {
-               x_src = (x_dst * x_ratio) >> 16;
-               upscale_buf->data[(y_dst * out_width) + x_dst] = frame_buf->data[(y_src * fb_width) + x_src];
-            }
+            /* Uh oh... This could mean we don't have enough
+             * memory, so disable upscaling and draw the usual
+             * framebuffer... */
+            configuration_set_uint(settings,
+                  settings->uints.menu_rgui_internal_upscale_level,
+                  RGUI_UPSCALE_NONE);
+            video_driver_set_texture_frame(frame_buf->data,
+                  false, fb_width, fb_height, 1.0f);
+            rgui->upload_width  = fb_width;
+            rgui->upload_height = fb_height;
+            return;
          }
-         
-         /* Draw upscaled texture */
-         video_driver_set_texture_frame(upscale_buf->data,
-            false, out_width, out_height, 1.0f);
       }
+      
+      /* Perform nearest neighbour upscaling. Unless the
+       * output size changed, upscale_buf still holds the
+       * previous frame and only the changed tiles need
+       * to be scaled again */
+      rgui_blit_upscale(frame_buf->data, fb_width, fb_height,
+            upscale_buf->data, out_width, out_height,
+            full_upscale ? NULL : rgui->dirty_tiles);
+      
+      /* Draw upscaled texture */
+      video_driver_set_texture_frame(upscale_buf->data,
+         false, out_width, out_height, 1.0f);
    }
+
+   rgui->upload_width  = out_width;
+   rgui->upload_height = out_height;
 }
 
 static void rgui_navigation_clear(void *data, bool pending_push)
@@ -6870,6 +6803,11 @@ static void rgui_toggle(void *userdata, bool menu_on)
       free(rgui->upscale_buf.data);
       rgui->upscale_buf.data = NULL;
    }
+
+   /* Same for the copy of the last upload - and the
+    * texture has to be sent again next time anyway */
+   if (!menu_on)
+      rgui_invalidate_upload(rgui);
 }
 
 static void rgui_context_reset(void *data, bool is_threaded)
@@ -6879,6 +6817,9 @@ static void rgui_context_reset(void *data, bool is_threaded)
    if (!rgui)
       return;
 
+   /* New context, new (empty) menu texture */
+   rgui_invalidate_upload(rgui);
+
 #ifdef HAVE_GFX_WIDGETS
    if (rgui->widgets_supported)
    {
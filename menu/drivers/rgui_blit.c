@@ -0,0 +1,367 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <retro_inline.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RGUI_BLIT_NEON
+#endif
+
+#include "rgui_blit.h"
+
+void rgui_blit_fill_span(uint16_t *dst, size_t count,
+      const uint16_t *pattern)
+{
+   size_t i = 0;
+
+#if defined(__SSE2__)
+   if (count >= 8)
+   {
+      __m128i value = _mm_set_epi16(
+            (short)pattern[3], (short)pattern[2],
+            (short)pattern[1], (short)pattern[0],
+            (short)pattern[3], (short)pattern[2],
+            (short)pattern[1], (short)pattern[0]);
+
+      /* Eight pixels are two whole periods, so the
+       * pattern stays in phase from one store to the next */
+      for (; i + 8 <= count; i += 8)
+         _mm_storeu_si128((__m128i*)(dst + i), value);
+   }
+#elif defined(RGUI_BLIT_NEON)
+   if (count >= 8)
+   {
+      uint16x4_t period = vld1_u16(pattern);
+      uint16x8_t value  = vcombine_u16(period, period);
+
+      for (; i + 8 <= count; i += 8)
+         vst1q_u16(dst + i, value);
+   }
+#endif
+
+   for (; i < count; i++)
+      dst[i] = pattern[i & 3];
+}
+
+void rgui_blit_fill_rect(uint16_t *dst, size_t stride,
+      unsigned width, unsigned height, const uint16_t *patterns)
+{
+   unsigned y;
+
+   if (!width)
+      return;
+
+   for (y = 0; y < height; y++, dst += stride)
+   {
+#if !defined(__SSE2__) && !defined(RGUI_BLIT_NEON)
+      /* Without vector stores, copying the row one period
+       * up is faster than building it again */
+      if (y >= 4)
+      {
+         memcpy(dst, dst - 4 * stride, width * sizeof(uint16_t));
+         continue;
+      }
+#endif
+      rgui_blit_fill_span(dst, width, patterns + ((y & 3) << 2));
+   }
+}
+
+#if defined(__SSE2__)
+/* Lanes whose bit is set in @bits are all ones */
+static INLINE __m128i rgui_blit_lane_mask(unsigned bits, __m128i lane_bits)
+{
+   return _mm_cmpeq_epi16(
+         _mm_and_si128(_mm_set1_epi16((short)bits), lane_bits),
+         lane_bits);
+}
+#elif defined(RGUI_BLIT_NEON)
+static const uint16_t rgui_blit_lane_bits[8] = {
+   0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
+};
+
+/* Lanes whose bit is set in @bits are all ones */
+static INLINE uint16x8_t rgui_blit_lane_mask(unsigned bits,
+      uint16x8_t lane_bits)
+{
+   return vtstq_u16(vdupq_n_u16((uint16_t)bits), lane_bits);
+}
+#endif
+
+void rgui_blit_glyph(uint16_t *dst, size_t stride, size_t room,
+      const uint8_t *rows, unsigned height, uint16_t color)
+{
+   unsigned r;
+
+#if defined(__SSE2__)
+   if (room >= 8)
+   {
+      __m128i lane_bits = _mm_set_epi16(
+            0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+      __m128i text      = _mm_set1_epi16((short)color);
+
+      for (r = 0; r < height; r++, dst += stride)
+      {
+         __m128i mask, pixels;
+
+         if (!rows[r])
+            continue;
+
+         mask   = rgui_blit_lane_mask(rows[r], lane_bits);
+         pixels = _mm_loadu_si128((const __m128i*)dst);
+         pixels = _mm_or_si128(_mm_and_si128(mask, text),
+               _mm_andnot_si128(mask, pixels));
+         _mm_storeu_si128((__m128i*)dst, pixels);
+      }
+      return;
+   }
+#elif defined(RGUI_BLIT_NEON)
+   if (room >= 8)
+   {
+      uint16x8_t lane_bits = vld1q_u16(rgui_blit_lane_bits);
+      uint16x8_t text      = vdupq_n_u16(color);
+
+      for (r = 0; r < height; r++, dst += stride)
+      {
+         if (!rows[r])
+            continue;
+
+         vst1q_u16(dst, vbslq_u16(
+                  rgui_blit_lane_mask(rows[r], lane_bits),
+                  text, vld1q_u16(dst)));
+      }
+      return;
+   }
+#endif
+
+   for (r = 0; r < height; r++, dst += stride)
+   {
+      unsigned bits = rows[r];
+      unsigned i;
+
+      for (i = 0; bits; i++, bits >>= 1)
+         if (bits & 1)
+            dst[i] = color;
+   }
+}
+
+void rgui_blit_glyph_shadow(uint16_t *dst, size_t stride, size_t room,
+      const uint8_t *rows, unsigned height,
+      uint16_t color, uint16_t shadow_color)
+{
+   unsigned r;
+   unsigned prev = 0;
+#if defined(__SSE2__)
+   __m128i lane_bits = _mm_set_epi16(
+         0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+   __m128i text      = _mm_set1_epi16((short)color);
+   __m128i shadow    = _mm_set1_epi16((short)shadow_color);
+#elif defined(RGUI_BLIT_NEON)
+   uint16x8_t lane_bits = vld1q_u16(rgui_blit_lane_bits);
+   uint16x8_t text      = vdupq_n_u16(color);
+   uint16x8_t shadow    = vdupq_n_u16(shadow_color);
+#endif
+
+   /* Each text pixel casts a shadow on its right, bottom
+    * and bottom right neighbours, and text always wins
+    * over shadow. The shadow of a row is therefore its
+    * own mask shifted right by a pixel plus the row above
+    * and the row above shifted, minus the text itself. */
+   for (r = 0; r <= height; r++, dst += stride)
+   {
+      unsigned cur   = (r < height) ? rows[r] : 0;
+      unsigned shade = ((cur << 1) | prev | (prev << 1)) & ~cur;
+
+      prev = cur;
+
+      if (!(cur | shade))
+         continue;
+
+#if defined(__SSE2__)
+      if (room >= 8)
+      {
+         __m128i text_mask   = rgui_blit_lane_mask(cur,   lane_bits);
+         __m128i shadow_mask = rgui_blit_lane_mask(shade, lane_bits);
+         __m128i pixels      = _mm_loadu_si128((const __m128i*)dst);
+
+         pixels = _mm_andnot_si128(
+               _mm_or_si128(text_mask, shadow_mask), pixels);
+         pixels = _mm_or_si128(pixels,
+               _mm_and_si128(text_mask, text));
+         pixels = _mm_or_si128(pixels,
+               _mm_and_si128(shadow_mask, shadow));
+         _mm_storeu_si128((__m128i*)dst, pixels);
+         continue;
+      }
+#elif defined(RGUI_BLIT_NEON)
+      if (room >= 8)
+      {
+         /* The masks never overlap, so the order of
+          * the two blends does not matter */
+         uint16x8_t pixels = vld1q_u16(dst);
+
+         pixels = vbslq_u16(rgui_blit_lane_mask(shade, lane_bits),
+               shadow, pixels);
+         pixels = vbslq_u16(rgui_blit_lane_mask(cur, lane_bits),
+               text, pixels);
+         vst1q_u16(dst, pixels);
+         continue;
+      }
+#endif
+
+      {
+         unsigned i;
+
+         for (i = 0; cur | shade; i++, cur >>= 1, shade >>= 1)
+         {
+            if (cur & 1)
+               dst[i] = color;
+            else if (shade & 1)
+               dst[i] = shadow_color;
+         }
+      }
+   }
+}
+
+size_t rgui_blit_num_tiles(unsigned width, unsigned height)
+{
+   size_t tiles_x = (width  + RGUI_TILE_SIZE - 1) / RGUI_TILE_SIZE;
+   size_t tiles_y = (height + RGUI_TILE_SIZE - 1) / RGUI_TILE_SIZE;
+   return tiles_x * tiles_y;
+}
+
+size_t rgui_blit_update_tiles(const uint16_t *src, uint16_t *copy,
+      unsigned width, unsigned height, uint8_t *dirty)
+{
+   unsigned tx, ty;
+   unsigned tiles_x = (width + RGUI_TILE_SIZE - 1) / RGUI_TILE_SIZE;
+   size_t changed   = 0;
+
+   for (ty = 0; ty * RGUI_TILE_SIZE < height; ty++)
+   {
+      unsigned y0 = ty * RGUI_TILE_SIZE;
+      unsigned y1 = (y0 + RGUI_TILE_SIZE < height)
+            ? y0 + RGUI_TILE_SIZE : height;
+
+      for (tx = 0; tx < tiles_x; tx++)
+      {
+         unsigned x0     = tx * RGUI_TILE_SIZE;
+         unsigned x1     = (x0 + RGUI_TILE_SIZE < width)
+               ? x0 + RGUI_TILE_SIZE : width;
+         size_t   len    = (x1 - x0) * sizeof(uint16_t);
+         uint8_t *flag   = &dirty[ty * tiles_x + tx];
+         unsigned y;
+
+         *flag = 0;
+
+         /* Rows are compared until the first difference,
+          * the rest of the tile is then copied blindly */
+         for (y = y0; y < y1; y++)
+         {
+            size_t offset = (size_t)y * width + x0;
+            if (memcmp(src + offset, copy + offset, len))
+               break;
+         }
+
+         if (y == y1)
+            continue;
+
+         for (; y < y1; y++)
+         {
+            size_t offset = (size_t)y * width + x0;
+            memcpy(copy + offset, src + offset, len);
+         }
+
+         *flag = 1;
+         changed++;
+      }
+   }
+
+   return changed;
+}
+
+void rgui_blit_upscale(const uint16_t *src,
+      unsigned src_width, unsigned src_height,
+      uint16_t *dst, unsigned dst_width, unsigned dst_height,
+      const uint8_t *dirty)
+{
+   unsigned x_dst, y_dst;
+   unsigned tiles_x = (src_width + RGUI_TILE_SIZE - 1) / RGUI_TILE_SIZE;
+   uint32_t x_ratio = ((src_width  << 16) / dst_width);
+   uint32_t y_ratio = ((src_height << 16) / dst_height);
+   unsigned y_last  = (unsigned)-1;
+   bool row_dirty   = true;
+
+   for (y_dst = 0; y_dst < dst_height; y_dst++)
+   {
+      unsigned y_src          = (y_dst * y_ratio) >> 16;
+      const uint16_t *src_row = src + (size_t)y_src * src_width;
+      uint16_t *dst_row       = dst + (size_t)y_dst * dst_width;
+
+      /* Every output row sampling the same source row
+       * is identical to the first one */
+      if (y_src == y_last)
+      {
+         if (row_dirty)
+            memcpy(dst_row, dst_row - dst_width,
+                  dst_width * sizeof(uint16_t));
+         continue;
+      }
+      y_last = y_src;
+
+      if (!dirty)
+      {
+         for (x_dst = 0; x_dst < dst_width; x_dst++)
+            dst_row[x_dst] = src_row[(x_dst * x_ratio) >> 16];
+      }
+      else
+      {
+         const uint8_t *flags = dirty +
+               (y_src / RGUI_TILE_SIZE) * tiles_x;
+         unsigned tx;
+
+         row_dirty = false;
+         for (tx = 0; tx < tiles_x && !row_dirty; tx++)
+            row_dirty = flags[tx] != 0;
+
+         if (!row_dirty)
+            continue;
+
+         for (tx = 0; tx < tiles_x; tx++)
+         {
+            uint64_t x_start, x_end;
+
+            if (!flags[tx])
+               continue;
+
+            /* First output pixels sampling this tile
+             * and the next one */
+            x_start = (((uint64_t)tx * RGUI_TILE_SIZE << 16)
+                  + x_ratio - 1) / x_ratio;
+            x_end   = (((uint64_t)(tx + 1) * RGUI_TILE_SIZE << 16)
+                  + x_ratio - 1) / x_ratio;
+            if (x_end > dst_width)
+               x_end = dst_width;
+
+            for (x_dst = (unsigned)x_start; x_dst < x_end; x_dst++)
+               dst_row[x_dst] = src_row[(x_dst * x_ratio) >> 16];
+         }
+      }
+   }
+}
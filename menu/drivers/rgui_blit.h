@@ -0,0 +1,107 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RGUI_BLIT_H
+#define __RGUI_BLIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Pixel routines for the 16-bit RGUI framebuffer, with
+ * SSE2 and NEON versions where available. Every routine
+ * writes exactly the pixels the plain per-pixel loops it
+ * replaces wrote. */
+
+/* Side of the square tiles used to track which parts of
+ * the framebuffer changed between uploads */
+#define RGUI_TILE_SIZE 16
+
+/* Glyph rows are bitmasks, bit i set for a pixel in
+ * column i. Glyphs with a drop shadow must be at most
+ * 7 pixels wide. */
+#define RGUI_GLYPH_MAX_WIDTH 7
+
+/* Sets @dst[i] to @pattern[i % 4] for i < @count */
+void rgui_blit_fill_span(uint16_t *dst, size_t count,
+      const uint16_t *pattern);
+
+/* Fills a @width x @height rectangle, row y with
+ * rgui_blit_fill_span() and pattern @patterns[(y % 4) * 4] */
+void rgui_blit_fill_rect(uint16_t *dst, size_t stride,
+      unsigned width, unsigned height, const uint16_t *patterns);
+
+/**
+ * rgui_blit_glyph:
+ * @dst                 : Top left pixel of the glyph.
+ * @stride              : Framebuffer width in pixels.
+ * @room                : Pixels from @dst to the end of its row.
+ * @rows                : Glyph bitmap, one mask per row.
+ * @height              : Number of rows.
+ * @color               : Text color.
+ *
+ * Draws the set pixels of a glyph.
+ **/
+void rgui_blit_glyph(uint16_t *dst, size_t stride, size_t room,
+      const uint8_t *rows, unsigned height, uint16_t color);
+
+/* As rgui_blit_glyph(), with a shadow one pixel right of
+ * and below every set pixel. Draws @height + 1 rows. */
+void rgui_blit_glyph_shadow(uint16_t *dst, size_t stride, size_t room,
+      const uint8_t *rows, unsigned height,
+      uint16_t color, uint16_t shadow_color);
+
+/* Number of tiles covering a @width x @height frame */
+size_t rgui_blit_num_tiles(unsigned width, unsigned height);
+
+/**
+ * rgui_blit_update_tiles:
+ * @src                 : Frame just drawn.
+ * @copy                : Previous frame, updated in place.
+ * @width               : Frame width.
+ * @height              : Frame height.
+ * @dirty               : One flag per tile, row by row.
+ *
+ * Compares @src with @copy tile by tile, flags the tiles
+ * that differ and copies them over.
+ *
+ * Returns: number of tiles that changed.
+ **/
+size_t rgui_blit_update_tiles(const uint16_t *src, uint16_t *copy,
+      unsigned width, unsigned height, uint8_t *dirty);
+
+/**
+ * rgui_blit_upscale:
+ * @src                 : Frame to scale.
+ * @dst                 : Scaled frame.
+ * @dirty               : Tile flags from rgui_blit_update_tiles(),
+ *                        or NULL to scale the whole frame.
+ *
+ * Nearest neighbour upscaling. With @dirty set, only the
+ * output pixels taken from changed tiles are written,
+ * the rest of @dst must hold the previous result.
+ **/
+void rgui_blit_upscale(const uint16_t *src,
+      unsigned src_width, unsigned src_height,
+      uint16_t *dst, unsigned dst_width, unsigned dst_height,
+      const uint8_t *dirty);
+
+RETRO_END_DECLS
+
+#endif
@@ -875,6 +875,7 @@ static unsigned menu_displaylist_parse_core_manager_list(
    if (core_info_list)
    {
       menu_search_terms_t *search_terms= menu_entries_search_get_terms();
+      uint8_t *search_hits             = NULL;
       core_info_t *core_info           = NULL;
       size_t menu_index                = 0;
       size_t i;
@@ -882,6 +883,26 @@ static unsigned menu_displaylist_parse_core_manager_list(
       /* Sort cores alphabetically */
       core_info_qsort(core_info_list, CORE_INFO_LIST_SORT_DISPLAY_NAME);
 
+      /* If a search is active, match all terms
+       * against an index of the core names */
+      if (search_terms)
+      {
+         menu_search_index_t *search_index =
+               menu_search_index_new(core_info_list->count);
+
+         for (i = 0; i < core_info_list->count; i++)
+         {
+            core_info = core_info_get(core_info_list, i);
+            if (core_info)
+               menu_search_index_add(search_index,
+                     core_info->display_name, i);
+         }
+
+         search_hits = menu_entries_search_filter(search_index,
+               core_info_list->count);
+         menu_search_index_free(search_index);
+      }
+
       /* Loop through cores */
       for (i = 0; i < core_info_list->count; i++)
       {
@@ -891,28 +912,14 @@ static unsigned menu_displaylist_parse_core_manager_list(
          if (core_info)
          {
             /* If a search is active, skip non-matching
-             * entries */
-            if (search_terms)
-            {
-               bool entry_valid = true;
-               size_t j;
-
-               for (j = 0; j < search_terms->size; j++)
-               {
-                  const char *search_term = search_terms->terms[j];
-
-                  if (!string_is_empty(search_term) &&
-                      !string_is_empty(core_info->display_name) &&
-                      !strcasestr(core_info->display_name, search_term))
-                  {
-                     entry_valid = false;
-                     break;
-                  }
-               }
-
-               if (!entry_valid)
-                  continue;
-            }
+             * entries (cores without a name are always
+             * shown) */
+            if (     search_terms
+                  && !string_is_empty(core_info->display_name)
+                  && !(search_hits
+                        ? search_hits[i]
+                        : menu_entries_search_match(core_info->display_name)))
+               continue;
 
             if (menu_entries_append_enum(info->list,
                      core_info->path,
@@ -929,6 +936,8 @@ static unsigned menu_displaylist_parse_core_manager_list(
             }
          }
       }
+
+      free(search_hits);
    }
 
    /* Add 'sideload core' entry */
@@ -1210,7 +1219,7 @@ static unsigned menu_displaylist_parse_supported_cores(menu_displaylist_info_t *
 
       /* If cores were found, sort the displaylist now */
       if (core_available)
-         file_list_sort_on_alt(info->list);
+         menu_entries_sort_on_alt(info->list);
 
       /* If we have a 'pending' entry, prepended it
        * to the displaylist */
@@ -1808,6 +1817,54 @@ static unsigned menu_displaylist_parse_system_info(file_list_t *list)
    return count;
 }
 
+/* Builds the menu label of a playlist entry */
+static void menu_displaylist_playlist_entry_label(
+      const struct playlist_entry *entry,
+      void (*sanitization)(char*),
+      bool show_inline_core_name, const char *label_spacer,
+      char *s, size_t len)
+{
+   s[0] = '\0';
+
+   if (!string_is_empty(entry->path))
+   {
+      /* Standard playlist entry
+       * > Base menu entry label is always playlist label
+       *   > If playlist label is NULL, fallback to playlist entry file name
+       * > If required, add currently associated core (if any), otherwise
+       *   no further action is necessary */
+
+      if (string_is_empty(entry->label))
+         fill_short_pathname_representation(s, entry->path, len);
+      else
+         strlcpy(s, entry->label, len);
+
+      if (sanitization)
+         (*sanitization)(s);
+
+      if (show_inline_core_name)
+      {
+         /* Both core name and core path must be valid */
+         if (!string_is_empty(entry->core_name) && !string_is_equal(entry->core_name, "DETECT") &&
+             !string_is_empty(entry->core_path) && !string_is_equal(entry->core_path, "DETECT"))
+         {
+            strlcat(s, label_spacer, len);
+            strlcat(s, entry->core_name, len);
+         }
+      }
+   }
+   else
+   {
+      /* Playlist entry without content
+       * > Use label if available, otherwise core name
+       * > If both are missing, add an empty menu entry */
+      if (!string_is_empty(entry->label))
+         strlcpy(s, entry->label, len);
+      else if (!string_is_empty(entry->core_name))
+         strlcpy(s, entry->core_name, len);
+   }
+}
+
 static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
       playlist_t *playlist,
       settings_t *settings,
@@ -1819,6 +1876,7 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
    bool show_inline_core_name        = false;
    const char *menu_driver           = menu_driver_ident();
    menu_search_terms_t *search_terms = menu_entries_search_get_terms();
+   uint8_t *search_hits              = NULL;
    unsigned pl_show_inline_core_name = settings->uints.playlist_show_inline_core_name;
    bool pl_show_sublabels            = settings->bools.playlist_show_sublabels;
    void (*sanitization)(char*);
@@ -1905,89 +1963,72 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
          sanitization = NULL;
    }
 
-   for (i = 0; i < list_size; i++)
+   /* If a search is active, match all terms against
+    * an index of the entry labels first */
+   if (search_terms)
    {
-      char menu_entry_label[PATH_MAX_LENGTH];
-      const struct playlist_entry *entry = NULL;
-      const char *entry_path             = NULL;
-      bool entry_valid                   = true;
-
-      menu_entry_label[0] = '\0';
-
-      /* Read playlist entry */
-      playlist_get_index(playlist, i, &entry);
+      menu_search_index_t *search_index = menu_search_index_new(list_size);
 
-      if (!string_is_empty(entry->path))
+      if (search_index)
       {
-         /* Standard playlist entry
-          * > Base menu entry label is always playlist label
-          *   > If playlist label is NULL, fallback to playlist entry file name
-          * > If required, add currently associated core (if any), otherwise
-          *   no further action is necessary */
-
-         if (string_is_empty(entry->label))
-            fill_short_pathname_representation(menu_entry_label, entry->path, sizeof(menu_entry_label));
-         else
-            strlcpy(menu_entry_label, entry->label, sizeof(menu_entry_label));
-
-         if (sanitization)
-            (*sanitization)(menu_entry_label);
-
-         if (show_inline_core_name)
+         for (i = 0; i < list_size; i++)
          {
-            /* Both core name and core path must be valid */
-            if (!string_is_empty(entry->core_name) && !string_is_equal(entry->core_name, "DETECT") &&
-                !string_is_empty(entry->core_path) && !string_is_equal(entry->core_path, "DETECT"))
-            {
-               strlcat(menu_entry_label, label_spacer, sizeof(menu_entry_label));
-               strlcat(menu_entry_label, entry->core_name, sizeof(menu_entry_label));
-            }
+            char menu_entry_label[PATH_MAX_LENGTH];
+            const struct playlist_entry *entry = NULL;
+
+            playlist_get_index(playlist, i, &entry);
+            menu_displaylist_playlist_entry_label(entry, sanitization,
+                  show_inline_core_name, label_spacer,
+                  menu_entry_label, sizeof(menu_entry_label));
+            menu_search_index_add(search_index, menu_entry_label, i);
          }
 
-         entry_path = entry->path;
-      }
-      else
-      {
-         /* Playlist entry without content...
-          * This is useless/broken, but have to include
-          * it otherwise synchronisation between the menu
-          * and the underlying playlist will be lost...
-          * > Use label if available, otherwise core name
-          * > If both are missing, add an empty menu entry */
-         if (!string_is_empty(entry->label))
-            strlcpy(menu_entry_label, entry->label, sizeof(menu_entry_label));
-         else if (!string_is_empty(entry->core_name))
-            strlcpy(menu_entry_label, entry->core_name, sizeof(menu_entry_label));
-
-         entry_path = path_playlist;
+         search_hits = menu_entries_search_filter(search_index, list_size);
+         menu_search_index_free(search_index);
       }
+   }
 
-      /* Check whether entry matches search terms,
-       * if required */
-      if (search_terms)
-      {
-         size_t j;
+   for (i = 0; i < list_size; i++)
+   {
+      char menu_entry_label[PATH_MAX_LENGTH];
+      const struct playlist_entry *entry = NULL;
+      const char *entry_path             = NULL;
 
-         for (j = 0; j < search_terms->size; j++)
-         {
-            const char *search_term = search_terms->terms[j];
+      /* Skip entries not matching the search terms */
+      if (search_hits && !search_hits[i])
+         continue;
 
-            if (!string_is_empty(search_term) &&
-                !strcasestr(menu_entry_label, search_term))
-            {
-               entry_valid = false;
-               break;
-            }
-         }
-      }
+      /* Read playlist entry */
+      playlist_get_index(playlist, i, &entry);
+
+      menu_displaylist_playlist_entry_label(entry, sanitization,
+            show_inline_core_name, label_spacer,
+            menu_entry_label, sizeof(menu_entry_label));
+
+      /* Playlist entries without content are
+       * useless/broken, but have to be included
+       * otherwise synchronisation between the menu
+       * and the underlying playlist will be lost */
+      entry_path = string_is_empty(entry->path)
+         ? path_playlist
+         : entry->path;
+
+      /* Without an index, check whether entry
+       * matches search terms, if required */
+      if (     search_terms
+            && !search_hits
+            && !menu_entries_search_match(menu_entry_label))
+         continue;
 
       /* Add menu entry */
-      if (entry_valid && menu_entries_append_enum(info->list,
+      if (menu_entries_append_enum(info->list,
             menu_entry_label, entry_path,
             MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_RPL_ENTRY, 0, i))
          info->count++;
    }
 
+   free(search_hits);
+
    if (info->count < 1)
       goto error;
 
@@ -4980,7 +5021,7 @@ bool menu_displaylist_process(menu_displaylist_info_t *info)
    }
 
    if (info->need_sort)
-      file_list_sort_on_alt(info->list);
+      menu_entries_sort_on_alt(info->list);
 
 #if defined(HAVE_NETWORKING)
 #if defined(__WINRT__) || defined(WINAPI_FAMILY) && WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP
@@ -7374,6 +7415,10 @@ unsigned menu_displaylist_build_list(
                         MENU_ENUM_LABEL_NETWORK_CMD_PORT,
                         PARSE_ONLY_UINT, false) != -1)
                   count++;
+               if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
+                        MENU_ENUM_LABEL_NETWORK_CMD_STREAM_ENABLE,
+                        PARSE_ONLY_BOOL, false) != -1)
+                  count++;
             }
 
             if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
@@ -9915,7 +9960,7 @@ static unsigned print_buf_lines(file_list_t *list, char *buf,
    }
 
    if (append && type != FILE_TYPE_DOWNLOAD_LAKKA)
-      file_list_sort_on_alt(list);
+      menu_entries_sort_on_alt(list);
    /* If the buffer was completely full, and didn't end
     * with a newline, just ignore the partial last line. */
 
@@ -11129,10 +11174,32 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
 
             if (core_list)
             {
-               size_t menu_index = 0;
+               size_t list_size     = core_updater_list_size(core_list);
+               uint8_t *search_hits = NULL;
+               size_t menu_index    = 0;
                size_t i;
 
-               for (i = 0; i < core_updater_list_size(core_list); i++)
+               /* If a search is active, match all terms
+                * against an index of the core names */
+               if (search_terms)
+               {
+                  menu_search_index_t *search_index =
+                        menu_search_index_new(list_size);
+
+                  for (i = 0; i < list_size; i++)
+                  {
+                     const core_updater_list_entry_t *entry = NULL;
+                     if (core_updater_list_get_index(core_list, i, &entry))
+                        menu_search_index_add(search_index,
+                              entry->display_name, i);
+                  }
+
+                  search_hits = menu_entries_search_filter(search_index,
+                        list_size);
+                  menu_search_index_free(search_index);
+               }
+
+               for (i = 0; i < list_size; i++)
                {
                   const core_updater_list_entry_t *entry = NULL;
 
@@ -11148,28 +11215,14 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
                         continue;
 
                      /* If a search is active, skip non-matching
-                      * entries */
-                     if (search_terms)
-                     {
-                        bool entry_valid = true;
-                        size_t j;
-
-                        for (j = 0; j < search_terms->size; j++)
-                        {
-                           const char *search_term = search_terms->terms[j];
-
-                           if (!string_is_empty(search_term) &&
-                               !string_is_empty(entry->display_name) &&
-                               !strcasestr(entry->display_name, search_term))
-                           {
-                              entry_valid = false;
-                              break;
-                           }
-                        }
-
-                        if (!entry_valid)
-                           continue;
-                     }
+                      * entries (cores without a name are always
+                      * shown) */
+                     if (     search_terms
+                           && !string_is_empty(entry->display_name)
+                           && !(search_hits
+                                 ? search_hits[i]
+                                 : menu_entries_search_match(entry->display_name)))
+                        continue;
 
                      if (menu_entries_append_enum(info->list,
                            entry->remote_filename,
@@ -11185,6 +11238,8 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
                      }
                   }
                }
+
+               free(search_hits);
             }
 
             if (selection >= count)
@@ -49,6 +49,7 @@
 #include "../driver.h"
 #include "../list_special.h"
 #include "../paths.h"
+#include "../startup_trace.h"
 #include "../tasks/task_powerstate.h"
 #include "../tasks/tasks_internal.h"
 #include "../verbosity.h"
@@ -533,29 +534,35 @@ menu_search_terms_t *menu_entries_search_get_terms_internal(void)
    return &cbs->search;
 }
 
-/* Searches current menu list for specified 'needle'
- * string. If string is found, returns true and sets
- * 'idx' to the matching list entry index. */
-bool menu_entries_list_search(const char *needle, size_t *idx)
+static void menu_entries_search_index_free(struct menu_state *menu_st)
+{
+   menu_search_index_free(menu_st->search.index);
+   menu_st->search.index = NULL;
+   menu_st->search.list  = NULL;
+}
+
+/* Discards the cached search index if it
+ * refers to the specified list */
+static INLINE void menu_entries_search_index_invalidate(
+      struct menu_state *menu_st, const file_list_t *list)
+{
+   if (menu_st->search.list == list)
+      menu_entries_search_index_free(menu_st);
+}
+
+static menu_search_index_t *menu_entries_search_index_get(
+      struct menu_state *menu_st, file_list_t *list)
 {
-   struct menu_state *menu_st  = &menu_driver_state;
-   menu_list_t *menu_list      = menu_st->entries.list;
-   file_list_t *list           = MENU_LIST_GET_SELECTION(menu_list, (unsigned)0);
-   bool match_found            = false;
-   bool char_search            = false;
-   char needle_char            = 0;
    size_t i;
+   menu_search_index_t *index = menu_st->search.index;
 
-   if (   !list
-       || string_is_empty(needle)
-       || !idx)
-      return match_found;
+   if (index && (menu_st->search.list == list))
+      return index;
 
-   /* Check if we are searching for a single
-    * Latin alphabet character */
-   char_search    = ((needle[1] == '\0') && (ISALPHA(needle[0])));
-   if (char_search)
-      needle_char = TOLOWER(needle[0]);
+   menu_entries_search_index_free(menu_st);
+
+   if (!(index = menu_search_index_new(list->size)))
+      return NULL;
 
    for (i = 0; i < list->size; i++)
    {
@@ -588,48 +595,59 @@ bool menu_entries_list_search(const char *needle, size_t *idx)
       else
          entry_label = entry.path;
 
-      if (string_is_empty(entry_label))
-         continue;
+      menu_search_index_add(index, entry_label, i);
+   }
 
-      /* If we are performing a single character
-       * search, jump to the first entry whose
-       * first character matches */
-      if (char_search)
-      {
-         if (needle_char == TOLOWER(entry_label[0]))
-         {
-            *idx        = i;
-            match_found = true;
-            break;
-         }
-      }
-      /* Otherwise perform an exhaustive string
-       * comparison */
-      else
-      {
-         const char *found_str = (const char *)strcasestr(entry_label, needle);
+   menu_st->search.index = index;
+   menu_st->search.list  = list;
 
-         /* Found a match with the first characters
-          * of the label -> best possible match,
-          * so quit immediately */
-         if (found_str == entry_label)
-         {
-            *idx        = i;
-            match_found = true;
-            break;
-         }
-         /* Found a mid-string match; this is a valid
-          * result, but keep searching for the best
-          * possible match */
-         else if (found_str)
-         {
-            *idx        = i;
-            match_found = true;
-         }
-      }
-   }
+   return index;
+}
 
-   return match_found;
+/* Sorts 'list' by alt label. Any search index
+ * built for the list refers to the old order, so
+ * it is discarded */
+void menu_entries_sort_on_alt(file_list_t *list)
+{
+   menu_entries_search_index_invalidate(&menu_driver_state, list);
+   file_list_sort_on_alt(list);
+}
+
+/* Searches current menu list for specified 'needle'
+ * string. If string is found, returns true and sets
+ * 'idx' to the matching list entry index.
+ * Displayed labels are indexed on the first search,
+ * so repeated searches of the same list only have
+ * to consult the index. */
+bool menu_entries_list_search(const char *needle, size_t *idx)
+{
+   struct menu_state *menu_st  = &menu_driver_state;
+   menu_list_t *menu_list      = menu_st->entries.list;
+   file_list_t *list           = MENU_LIST_GET_SELECTION(menu_list, (unsigned)0);
+   menu_search_index_t *index  = NULL;
+   menu_search_result_t result;
+
+   if (   !list
+       || string_is_empty(needle)
+       || !idx)
+      return false;
+
+   if (!(index = menu_entries_search_index_get(menu_st, list)))
+      return false;
+
+   if (!menu_search_index_find(index, needle, &result, 1))
+      return false;
+
+   /* If we are searching for a single Latin
+    * alphabet character, only jump to an entry
+    * whose first character matches */
+   if (     (needle[1] == '\0')
+         && ISALPHA(needle[0])
+         && (result.type > MENU_SEARCH_MATCH_PREFIX))
+      return false;
+
+   *idx = result.id;
+   return true;
 }
 
 /* Time format strings with AM-PM designation require special
@@ -3326,6 +3344,7 @@ void menu_entries_list_deinit(
       const menu_ctx_driver_t *menu_driver_ctx,
       struct menu_state *menu_st)
 {
+   menu_entries_search_index_free(menu_st);
    if (menu_st->entries.list)
       menu_list_free(menu_driver_ctx, menu_st->entries.list);
    menu_st->entries.list          = NULL;
@@ -3703,6 +3722,60 @@ menu_search_terms_t *menu_entries_search_get_terms(void)
    return search;
 }
 
+/* Returns true if 'label' contains every
+ * current search term */
+bool menu_entries_search_match(const char *label)
+{
+   menu_search_terms_t *search = menu_entries_search_get_terms();
+   size_t i;
+
+   if (!search)
+      return true;
+
+   for (i = 0; i < search->size; i++)
+   {
+      const char *search_term = search->terms[i];
+
+      if (   !string_is_empty(search_term)
+          && (string_is_empty(label) || !strcasestr(label, search_term)))
+         return false;
+   }
+
+   return true;
+}
+
+/* Filters the labels of 'index' by the current
+ * search terms. Returns a newly allocated array of
+ * 'len' flags, set for each id whose label contains
+ * every term, or NULL if no search is active or the
+ * array cannot be allocated */
+uint8_t *menu_entries_search_filter(menu_search_index_t *index, size_t len)
+{
+   menu_search_terms_t *search = menu_entries_search_get_terms();
+   uint8_t *hits               = NULL;
+   uint8_t num_terms           = 0;
+   size_t i;
+
+   if (!search || !index || !len)
+      return NULL;
+
+   if (!(hits = (uint8_t*)calloc(len, sizeof(uint8_t))))
+      return NULL;
+
+   for (i = 0; i < search->size; i++)
+   {
+      if (string_is_empty(search->terms[i]))
+         continue;
+      menu_search_index_tally(index, search->terms[i], hits);
+      num_terms++;
+   }
+
+   for (i = 0; i < len; i++)
+      hits[i] = (hits[i] == num_terms);
+
+   return hits;
+}
+
 void menu_entries_search_append_terms_string(char *s, size_t len)
 {
    menu_search_terms_t *search = menu_entries_search_get_terms_internal();
@@ -4364,6 +4437,8 @@ void menu_entries_append(
    if (!list || !label)
       return;
 
+   menu_entries_search_index_invalidate(menu_st, list);
+
    file_list_append(list, path, label, type, directory_ptr, entry_idx);
    file_list_get_last(MENU_LIST_GET(menu_st->entries.list, 0),
          &menu_path, NULL, NULL, NULL);
@@ -4452,6 +4527,8 @@ bool menu_entries_append_enum(
    if (!list || !label)
       return false;
 
+   menu_entries_search_index_invalidate(menu_st, list);
+
    file_list_append(list, path, label, type, directory_ptr, entry_idx);
    file_list_get_last(MENU_LIST_GET(menu_st->entries.list, 0),
          &menu_path, NULL, NULL, NULL);
@@ -4542,6 +4619,8 @@ void menu_entries_prepend(file_list_t *list,
    if (!list || !label)
       return;
 
+   menu_entries_search_index_invalidate(menu_st, list);
+
    file_list_prepend(list, path, label, type, directory_ptr, entry_idx);
    file_list_get_last(MENU_LIST_GET(menu_st->entries.list, 0),
          &menu_path, NULL, NULL, NULL);
@@ -4739,6 +4818,8 @@ bool menu_entries_ctl(enum menu_entries_ctl_state state, void *data)
             if (!list)
                return false;
 
+            menu_entries_search_index_invalidate(menu_st, list);
+
             /* Clear all the menu lists. */
             if (menu_st->driver_ctx->list_clear)
                menu_st->driver_ctx->list_clear(list);
@@ -5234,20 +5315,29 @@ bool menu_driver_init(bool video_is_threaded)
    gfx_display_t            *p_disp  = disp_get_ptr();
    settings_t             *settings  = config_get_ptr();
    struct menu_state       *menu_st  = &menu_driver_state;
+   int trace_phase                   = -1;
+   bool menu_inited                  = false;
 
    command_event(CMD_EVENT_CORE_INFO_INIT, NULL);
    command_event(CMD_EVENT_LOAD_CORE_PERSIST, NULL);
 
-   if (  menu_st->driver_data ||
+   trace_phase = startup_trace_begin("menu_init");
+   menu_inited = menu_st->driver_data ||
          menu_driver_init_internal(
             p_disp,
             settings,
-            video_is_threaded))
+            video_is_threaded);
+   startup_trace_end(trace_phase);
+
+   if (menu_inited)
    {
       if (menu_st->driver_ctx && menu_st->driver_ctx->context_reset)
       {
+         /* Loads fonts and textures */
+         trace_phase = startup_trace_begin("menu_context_reset");
          menu_st->driver_ctx->context_reset(menu_st->userdata,
                video_is_threaded);
+         startup_trace_end(trace_phase);
          return true;
       }
    }
@@ -40,6 +40,7 @@
 #include "menu_input_bind_dialog.h"
 #include "menu_entries.h"
 #include "menu_shader.h"
+#include "menu_search_index.h"
 #include "../gfx/gfx_animation.h"
 #include "../gfx/gfx_display.h"
 
@@ -453,6 +454,14 @@ struct menu_state
       menu_list_t *list;
       size_t begin;
    } entries;
+   /* Search index for the current selection list,
+    * built on the first search and discarded when
+    * the list is modified */
+   struct
+   {
+      menu_search_index_t *index;
+      const file_list_t *list;
+   } search;
    size_t   selection_ptr;
 
    /* Quick jumping indices with L/R.
@@ -27,6 +27,7 @@
 #include "menu_setting.h"
 #include "menu_input.h"
 #include "menu_displaylist.h"
+#include "menu_search_index.h"
 
 RETRO_BEGIN_DECLS
 
@@ -200,12 +201,20 @@ bool menu_entries_search_pop(void);
 
 menu_search_terms_t *menu_entries_search_get_terms(void);
 
+bool menu_entries_search_match(const char *label);
+
+uint8_t *menu_entries_search_filter(menu_search_index_t *index, size_t len);
+
 /* Convenience function: Appends list of current
  * search terms to specified string */
 void menu_entries_search_append_terms_string(char *s, size_t len);
 
 menu_search_terms_t *menu_entries_search_get_terms_internal(void);
 
+/* Sorts 'list' by alt label, discarding its
+ * search index */
+void menu_entries_sort_on_alt(file_list_t *list);
+
 /* Searches current menu list for specified 'needle'
  * string. If string is found, returns true and sets
  * 'idx' to the matching list entry index. */
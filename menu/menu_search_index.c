@@ -0,0 +1,618 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <compat/strl.h>
+#include <string/stdstring.h>
+
+#include "menu_search_index.h"
+
+/* Trigram postings are only worth building once
+ * a list is large enough that a linear scan of the
+ * case folded labels becomes noticeable */
+#define MENU_SEARCH_INDEX_TRIGRAM_MIN  256
+/* Trigrams are hashed into a fixed number of
+ * buckets; collisions only cost extra verification */
+#define MENU_SEARCH_INDEX_TRIGRAM_BITS 12
+#define MENU_SEARCH_INDEX_TRIGRAM_SIZE (1 << MENU_SEARCH_INDEX_TRIGRAM_BITS)
+#define MENU_SEARCH_INDEX_NEEDLE_MAX   256
+#define MENU_SEARCH_INDEX_SCORE_SHIFT  24
+#define MENU_SEARCH_INDEX_SCORE_MASK   ((1 << MENU_SEARCH_INDEX_SCORE_SHIFT) - 1)
+
+typedef struct
+{
+   size_t id;
+   size_t offset;       /* Folded label offset in string pool */
+   uint64_t char_mask;  /* Set of characters present in label */
+} menu_search_entry_t;
+
+typedef struct
+{
+   uint32_t entry;
+   uint32_t score;
+} menu_search_match_t;
+
+struct menu_search_index
+{
+   menu_search_entry_t *entries;
+   char *pool;
+
+   /* Trigram postings, stored as a compressed
+    * sparse row: entries of bucket 'i' are
+    * tri_postings[tri_offsets[i]..tri_offsets[i + 1]) */
+   uint32_t *tri_offsets;
+   uint32_t *tri_postings;
+
+   /* Incremental search state: 'candidates' holds
+    * every entry matching 'last_needle' */
+   uint32_t *candidates;
+   menu_search_match_t *matches;
+
+   size_t size;
+   size_t capacity;
+   size_t pool_size;
+   size_t pool_capacity;
+   size_t num_candidates;
+   size_t work_capacity;
+
+   char last_needle[MENU_SEARCH_INDEX_NEEDLE_MAX];
+
+   /* True if 'candidates' contains all fuzzy
+    * (subsequence) matches of 'last_needle',
+    * rather than just substring matches */
+   bool candidates_fuzzy;
+   bool candidates_valid;
+};
+
+/*********************/
+/* Utility functions */
+/*********************/
+
+static uint64_t menu_search_index_char_bit(unsigned char c)
+{
+   if (c >= 'a' && c <= 'z')
+      return (uint64_t)1 << (c - 'a');
+   if (c >= '0' && c <= '9')
+      return (uint64_t)1 << (26 + (c - '0'));
+   /* Whitespace does not constrain fuzzy matches */
+   if (ISSPACE(c))
+      return 0;
+   return (uint64_t)1 << (36 + (c % 28));
+}
+
+/* Case folds 'src' into 'dst', returning the
+ * number of characters written and accumulating
+ * the character set into 'mask' */
+static size_t menu_search_index_fold(char *dst, const char *src,
+      size_t len, uint64_t *mask)
+{
+   size_t i;
+   uint64_t m = 0;
+
+   for (i = 0; src[i] != '\0' && i < len; i++)
+   {
+      unsigned char c = (unsigned char)TOLOWER(src[i]);
+      dst[i]          = (char)c;
+      m              |= menu_search_index_char_bit(c);
+   }
+
+   dst[i] = '\0';
+
+   if (mask)
+      *mask = m;
+
+   return i;
+}
+
+static INLINE unsigned menu_search_index_trigram(const char *s)
+{
+   unsigned h = ((unsigned)(unsigned char)s[0] * 961)
+              + ((unsigned)(unsigned char)s[1] * 31)
+              +  (unsigned)(unsigned char)s[2];
+   return (h ^ (h >> MENU_SEARCH_INDEX_TRIGRAM_BITS))
+      & (MENU_SEARCH_INDEX_TRIGRAM_SIZE - 1);
+}
+
+static void menu_search_index_invalidate(menu_search_index_t *index)
+{
+   if (index->tri_offsets)
+      free(index->tri_offsets);
+   if (index->tri_postings)
+      free(index->tri_postings);
+
+   index->tri_offsets      = NULL;
+   index->tri_postings     = NULL;
+   index->candidates_valid = false;
+}
+
+/* Builds trigram postings for all labels currently
+ * held by the index. Each entry is recorded at most
+ * once per bucket. Returns false on allocation failure */
+static bool menu_search_index_build_trigrams(menu_search_index_t *index)
+{
+   size_t i;
+   uint32_t total     = 0;
+   uint32_t *offsets  = NULL;
+   uint32_t *postings = NULL;
+   uint32_t *last     = (uint32_t*)malloc(
+         MENU_SEARCH_INDEX_TRIGRAM_SIZE * sizeof(uint32_t));
+
+   if (!last)
+      return false;
+
+   if (!(offsets = (uint32_t*)calloc(
+         MENU_SEARCH_INDEX_TRIGRAM_SIZE + 1, sizeof(uint32_t))))
+      goto error;
+
+   /* Pass 1: count postings per bucket */
+   memset(last, 0xFF, MENU_SEARCH_INDEX_TRIGRAM_SIZE * sizeof(uint32_t));
+   for (i = 0; i < index->size; i++)
+   {
+      const char *s = index->pool + index->entries[i].offset;
+
+      for (; s[0] && s[1] && s[2]; s++)
+      {
+         unsigned bucket = menu_search_index_trigram(s);
+         if (last[bucket] == (uint32_t)i)
+            continue;
+         last[bucket] = (uint32_t)i;
+         offsets[bucket + 1]++;
+         total++;
+      }
+   }
+
+   for (i = 0; i < MENU_SEARCH_INDEX_TRIGRAM_SIZE; i++)
+      offsets[i + 1] += offsets[i];
+
+   if (!(postings = (uint32_t*)malloc((total + 1) * sizeof(uint32_t))))
+      goto error;
+
+   /* Pass 2: fill buckets. Since entries are
+    * processed in order, each bucket ends up
+    * sorted by entry index */
+   memset(last, 0xFF, MENU_SEARCH_INDEX_TRIGRAM_SIZE * sizeof(uint32_t));
+   for (i = 0; i < index->size; i++)
+   {
+      const char *s = index->pool + index->entries[i].offset;
+
+      for (; s[0] && s[1] && s[2]; s++)
+      {
+         unsigned bucket = menu_search_index_trigram(s);
+         if (last[bucket] == (uint32_t)i)
+            continue;
+         last[bucket]                = (uint32_t)i;
+         postings[offsets[bucket]++] = (uint32_t)i;
+      }
+   }
+
+   /* Pass 2 advanced each offset to the end of its
+    * bucket; shift back to restore bucket starts */
+   for (i = MENU_SEARCH_INDEX_TRIGRAM_SIZE; i > 0; i--)
+      offsets[i] = offsets[i - 1];
+   offsets[0] = 0;
+
+   free(last);
+   index->tri_offsets  = offsets;
+   index->tri_postings = postings;
+   return true;
+
+error:
+   if (offsets)
+      free(offsets);
+   free(last);
+   return false;
+}
+
+/* Returns the score of a substring match of 'needle'
+ * within 'label', or 0 if there is none */
+static uint32_t menu_search_index_match_substring(
+      const char *label, const char *needle, size_t needle_len,
+      enum menu_search_match_type *type)
+{
+   const char *found = strstr(label, needle);
+   const char *first = found;
+   size_t pos;
+
+   if (!found)
+      return 0;
+
+   if (found == label)
+   {
+      *type = (label[needle_len] == '\0')
+         ? MENU_SEARCH_MATCH_EXACT
+         : MENU_SEARCH_MATCH_PREFIX;
+      return ((uint32_t)*type << MENU_SEARCH_INDEX_SCORE_SHIFT) + 1;
+   }
+
+   /* Prefer an occurrence at the start of a word,
+    * even if an earlier mid-word occurrence exists */
+   do
+   {
+      if (!ISALNUM(found[-1]))
+      {
+         pos   = (size_t)(found - label);
+         *type = MENU_SEARCH_MATCH_WORD;
+         goto end;
+      }
+   } while ((found = strstr(found + 1, needle)));
+
+   pos   = (size_t)(first - label);
+   *type = MENU_SEARCH_MATCH_SUBSTRING;
+
+end:
+   if (pos > MENU_SEARCH_INDEX_SCORE_MASK - 1)
+      pos = MENU_SEARCH_INDEX_SCORE_MASK - 1;
+   return ((uint32_t)*type << MENU_SEARCH_INDEX_SCORE_SHIFT) + (uint32_t)pos + 1;
+}
+
+/* Returns the score of a fuzzy match of 'needle'
+ * within 'label' (all needle characters present, in
+ * order), or 0 if there is none. Matches with fewer
+ * skipped characters score better */
+static uint32_t menu_search_index_match_fuzzy(
+      const char *label, const char *needle)
+{
+   const char *s     = label;
+   const char *start = NULL;
+   size_t gaps;
+
+   for (; *needle; needle++)
+   {
+      if (ISSPACE(*needle))
+         continue;
+      if (!(s = strchr(s, *needle)))
+         return 0;
+      if (!start)
+         start = s;
+      s++;
+   }
+
+   if (!start)
+      return 0;
+
+   gaps = (size_t)(s - start);
+   if (gaps > MENU_SEARCH_INDEX_SCORE_MASK - 1)
+      gaps = MENU_SEARCH_INDEX_SCORE_MASK - 1;
+   return ((uint32_t)MENU_SEARCH_MATCH_FUZZY << MENU_SEARCH_INDEX_SCORE_SHIFT)
+      + (uint32_t)gaps + 1;
+}
+
+static int menu_search_index_match_cmp(const void *a, const void *b)
+{
+   const menu_search_match_t *ma = (const menu_search_match_t*)a;
+   const menu_search_match_t *mb = (const menu_search_match_t*)b;
+
+   if (ma->score != mb->score)
+      return (ma->score < mb->score) ? -1 : 1;
+   if (ma->entry != mb->entry)
+      return (ma->entry < mb->entry) ? -1 : 1;
+   return 0;
+}
+
+/* Scans the entries listed in 'src' (or all entries,
+ * if 'src' is NULL), appending matches to index->matches.
+ * Returns number of matches */
+static size_t menu_search_index_scan(menu_search_index_t *index,
+      const uint32_t *src, size_t src_len,
+      const char *needle, size_t needle_len, uint64_t needle_mask,
+      bool fuzzy)
+{
+   size_t i;
+   size_t count = 0;
+
+   if (!src)
+      src_len = index->size;
+
+   for (i = 0; i < src_len; i++)
+   {
+      enum menu_search_match_type type;
+      uint32_t entry                   = src ? src[i] : (uint32_t)i;
+      const menu_search_entry_t *e     = &index->entries[entry];
+      const char *label                = index->pool + e->offset;
+      uint32_t score;
+
+      /* Cheap rejection: label must contain every
+       * character present in the needle */
+      if ((needle_mask & e->char_mask) != needle_mask)
+         continue;
+
+      if (fuzzy)
+         score = menu_search_index_match_fuzzy(label, needle);
+      else
+         score = menu_search_index_match_substring(
+               label, needle, needle_len, &type);
+
+      if (!score)
+         continue;
+
+      index->matches[count].entry = entry;
+      index->matches[count].score = score;
+      count++;
+   }
+
+   return count;
+}
+
+/******************/
+/* Initialisation */
+/******************/
+
+menu_search_index_t *menu_search_index_new(size_t capacity)
+{
+   menu_search_index_t *index = (menu_search_index_t*)
+      calloc(1, sizeof(*index));
+
+   if (!index)
+      return NULL;
+
+   if (capacity > 0)
+   {
+      index->entries = (menu_search_entry_t*)
+         malloc(capacity * sizeof(menu_search_entry_t));
+      if (!index->entries)
+      {
+         free(index);
+         return NULL;
+      }
+      index->capacity = capacity;
+   }
+
+   return index;
+}
+
+void menu_search_index_free(menu_search_index_t *index)
+{
+   if (!index)
+      return;
+
+   menu_search_index_invalidate(index);
+
+   if (index->entries)
+      free(index->entries);
+   if (index->pool)
+      free(index->pool);
+   if (index->candidates)
+      free(index->candidates);
+   if (index->matches)
+      free(index->matches);
+
+   free(index);
+}
+
+bool menu_search_index_add(menu_search_index_t *index,
+      const char *label, size_t id)
+{
+   size_t len;
+   menu_search_entry_t *entry = NULL;
+
+   if (!index || string_is_empty(label))
+      return false;
+
+   len = strlen(label);
+
+   if (index->size >= index->capacity)
+   {
+      size_t new_capacity           = index->capacity ? index->capacity * 2 : 64;
+      menu_search_entry_t *entries  = (menu_search_entry_t*)realloc(
+            index->entries, new_capacity * sizeof(menu_search_entry_t));
+      if (!entries)
+         return false;
+      index->entries  = entries;
+      index->capacity = new_capacity;
+   }
+
+   if (index->pool_size + len + 1 > index->pool_capacity)
+   {
+      size_t new_capacity = index->pool_capacity ? index->pool_capacity : 4096;
+      char *pool          = NULL;
+
+      while (index->pool_size + len + 1 > new_capacity)
+         new_capacity *= 2;
+
+      if (!(pool = (char*)realloc(index->pool, new_capacity)))
+         return false;
+      index->pool          = pool;
+      index->pool_capacity = new_capacity;
+   }
+
+   entry         = &index->entries[index->size];
+   entry->id     = id;
+   entry->offset = index->pool_size;
+   menu_search_index_fold(index->pool + index->pool_size,
+         label, len, &entry->char_mask);
+
+   index->pool_size += len + 1;
+   index->size++;
+
+   /* Any cached search state is now stale */
+   menu_search_index_invalidate(index);
+
+   return true;
+}
+
+size_t menu_search_index_size(menu_search_index_t *index)
+{
+   if (!index)
+      return 0;
+   return index->size;
+}
+
+/**********/
+/* Search */
+/**********/
+
+/* Collects every match of 'needle' into index->matches,
+ * narrowing the search down to previous candidates or
+ * a trigram bucket where possible. Fuzzy matches are
+ * only considered if 'allow_fuzzy' is set and there is
+ * no substring match. Returns number of matches */
+static size_t menu_search_index_collect(menu_search_index_t *index,
+      const char *needle, bool allow_fuzzy)
+{
+   size_t i;
+   size_t needle_len;
+   size_t count;
+   uint64_t needle_mask;
+   char folded[MENU_SEARCH_INDEX_NEEDLE_MAX];
+   const uint32_t *src = NULL;
+   size_t src_len      = 0;
+   bool src_fuzzy      = true;
+   bool fuzzy          = false;
+
+   needle_len = menu_search_index_fold(folded, needle,
+         sizeof(folded) - 1, &needle_mask);
+
+   /* Lazily (re)allocate working buffers */
+   if (index->work_capacity < index->size)
+   {
+      menu_search_match_t *matches = (menu_search_match_t*)realloc(
+            index->matches, index->capacity * sizeof(menu_search_match_t));
+      uint32_t *candidates         = NULL;
+
+      if (!matches)
+         return 0;
+      index->matches = matches;
+
+      if (!(candidates = (uint32_t*)realloc(
+            index->candidates, index->capacity * sizeof(uint32_t))))
+         return 0;
+      index->candidates    = candidates;
+      index->work_capacity = index->capacity;
+   }
+
+   /* Select candidate source:
+    * - If the needle extends the previous search
+    *   term, any match must be one of the previous
+    *   candidates
+    * - Otherwise, use the trigram bucket with the
+    *   fewest entries (substring matches only)
+    * - Otherwise, examine every entry */
+   if (     index->candidates_valid
+         && string_starts_with(folded, index->last_needle))
+   {
+      src       = index->candidates;
+      src_len   = index->num_candidates;
+      src_fuzzy = index->candidates_fuzzy;
+   }
+   else if (needle_len >= 3
+         && index->size >= MENU_SEARCH_INDEX_TRIGRAM_MIN
+         && (index->tri_offsets || menu_search_index_build_trigrams(index)))
+   {
+      const char *t = folded;
+      size_t best   = (size_t)-1;
+
+      for (; t[2]; t++)
+      {
+         unsigned bucket = menu_search_index_trigram(t);
+         size_t n        = index->tri_offsets[bucket + 1]
+            - index->tri_offsets[bucket];
+         if (n < best)
+         {
+            best    = n;
+            src     = index->tri_postings + index->tri_offsets[bucket];
+            src_len = n;
+         }
+      }
+      src_fuzzy = false;
+   }
+
+   count = menu_search_index_scan(index, src, src_len,
+         folded, needle_len, needle_mask, false);
+
+   /* No substring matches: fall back to fuzzy
+    * matching. If the current source only holds
+    * substring candidates, widen to all entries */
+   if (!count && allow_fuzzy)
+   {
+      if (!src_fuzzy)
+         src = NULL;
+      count = menu_search_index_scan(index, src, src_len,
+            folded, needle_len, needle_mask, true);
+      fuzzy = true;
+   }
+
+   /* Record candidates for the next search */
+   for (i = 0; i < count; i++)
+      index->candidates[i]  = index->matches[i].entry;
+   index->num_candidates    = count;
+   index->candidates_fuzzy  = fuzzy;
+   index->candidates_valid  = true;
+   strlcpy(index->last_needle, folded, sizeof(index->last_needle));
+
+   return count;
+}
+
+size_t menu_search_index_find(menu_search_index_t *index,
+      const char *needle, menu_search_result_t *s, size_t len)
+{
+   size_t i;
+   size_t count;
+
+   if (!index || !index->size || string_is_empty(needle))
+      return 0;
+
+   count = menu_search_index_collect(index, needle, true);
+
+   if (!s || !len || !count)
+      return count;
+
+   /* Rank results. For the common 'jump to best
+    * match' case, a linear scan suffices */
+   if (len == 1)
+   {
+      menu_search_match_t *best = &index->matches[0];
+      for (i = 1; i < count; i++)
+         if (menu_search_index_match_cmp(&index->matches[i], best) < 0)
+            best = &index->matches[i];
+      s[0].id    = index->entries[best->entry].id;
+      s[0].score = best->score;
+      s[0].type  = (enum menu_search_match_type)
+         (best->score >> MENU_SEARCH_INDEX_SCORE_SHIFT);
+      return count;
+   }
+
+   qsort(index->matches, count, sizeof(menu_search_match_t),
+         menu_search_index_match_cmp);
+
+   for (i = 0; i < count && i < len; i++)
+   {
+      s[i].id    = index->entries[index->matches[i].entry].id;
+      s[i].score = index->matches[i].score;
+      s[i].type  = (enum menu_search_match_type)
+         (index->matches[i].score >> MENU_SEARCH_INDEX_SCORE_SHIFT);
+   }
+
+   return count;
+}
+
+size_t menu_search_index_tally(menu_search_index_t *index,
+      const char *needle, uint8_t *hits)
+{
+   size_t i;
+   size_t count;
+
+   if (!index || !index->size || string_is_empty(needle) || !hits)
+      return 0;
+
+   count = menu_search_index_collect(index, needle, false);
+
+   for (i = 0; i < count; i++)
+      hits[index->entries[index->matches[i].entry].id]++;
+
+   return count;
+}
@@ -0,0 +1,105 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MENU_SEARCH_INDEX_H
+#define _MENU_SEARCH_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/* Prevent direct access to menu_search_index_t members */
+typedef struct menu_search_index menu_search_index_t;
+
+/* Match classes, in order of decreasing relevance */
+enum menu_search_match_type
+{
+   MENU_SEARCH_MATCH_EXACT = 0,
+   MENU_SEARCH_MATCH_PREFIX,
+   MENU_SEARCH_MATCH_WORD,
+   MENU_SEARCH_MATCH_SUBSTRING,
+   MENU_SEARCH_MATCH_FUZZY
+};
+
+typedef struct
+{
+   /* Caller-supplied id of the matching label,
+    * as passed to menu_search_index_add() */
+   size_t id;
+   /* Lower is better; results are sorted by
+    * score, then by insertion order */
+   uint32_t score;
+   enum menu_search_match_type type;
+} menu_search_result_t;
+
+/******************/
+/* Initialisation */
+/******************/
+
+/* Creates a new, empty search index. 'capacity' is
+ * a hint for the expected number of labels (may be 0).
+ * Returned object must be freed using menu_search_index_free().
+ * Returns NULL in the event of an error. */
+menu_search_index_t *menu_search_index_new(size_t capacity);
+
+/* Frees specified search index */
+void menu_search_index_free(menu_search_index_t *index);
+
+/* Adds a label to the index. Labels are case folded
+ * and stored internally, so 'label' does not need to
+ * persist after this call. 'id' is returned verbatim
+ * in search results (typically a list offset).
+ * Empty labels are ignored. */
+bool menu_search_index_add(menu_search_index_t *index,
+      const char *label, size_t id);
+
+/* Returns number of labels held by the index */
+size_t menu_search_index_size(menu_search_index_t *index);
+
+/**********/
+/* Search */
+/**********/
+
+/* Searches the index for 'needle' (case insensitive).
+ * Substring matches are ranked exact > prefix >
+ * word start > mid-string; if no substring match
+ * exists, labels containing the characters of
+ * 'needle' in order are returned as fuzzy matches.
+ * If 'needle' extends the previous search term, only
+ * the previous candidates are re-examined, so typing
+ * a search string one character at a time is cheap.
+ * Up to 'len' best results are written to 's'.
+ * Returns total number of matches found (which may
+ * exceed 'len'). */
+size_t menu_search_index_find(menu_search_index_t *index,
+      const char *needle, menu_search_result_t *s, size_t len);
+
+/* Filters the index by 'needle', as a case insensitive
+ * substring (no fuzzy matching): increments 'hits[id]'
+ * for the id of every label containing it. 'hits' must
+ * cover every id passed to menu_search_index_add().
+ * Tallying several terms into the same array selects
+ * the labels holding all of them. Returns number of
+ * matching labels. */
+size_t menu_search_index_tally(menu_search_index_t *index,
+      const char *needle, uint8_t *hits);
+
+RETRO_END_DECLS
+
+#endif
@@ -19617,6 +19617,21 @@ static bool setting_append_list(
             menu_settings_list_current_add_range(list, list_info, 1, 99999, 1, true, true);
             SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.network_cmd_stream_enable,
+                  MENU_ENUM_LABEL_NETWORK_CMD_STREAM_ENABLE,
+                  MENU_ENUM_LABEL_VALUE_NETWORK_CMD_STREAM_ENABLE,
+                  network_cmd_stream_enable,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_ADVANCED);
+
             CONFIG_BOOL(
                   list, list_info,
                   &settings->bools.network_remote_enable,
@@ -2204,6 +2204,7 @@ enum msg_hash_enums
 
    MENU_LABEL(NETWORK_CMD_ENABLE),
    MENU_LABEL(NETWORK_CMD_PORT),
+   MENU_LABEL(NETWORK_CMD_STREAM_ENABLE),
    MENU_LABEL(STDIN_CMD_ENABLE),
    MENU_LABEL(NETWORK_REMOTE_ENABLE),
    MENU_LABEL(NETWORK_REMOTE_PORT),
@@ -896,6 +896,473 @@ static void netplay_deinit_socket_buffer(struct socket_buffer *sbuf)
 }
 
 
+/**
+ * netplay_force_future
+ * @netplay              : pointer to netplay object
+ *
+ * Force netplay to ignore all past input, typically because we've just loaded
+ * a state or reset.
+ */
+static void netplay_force_future(netplay_t *netplay)
+{
+   /* Wherever we're inputting, that's where we consider our state to be loaded */
+   netplay->run_ptr         = netplay->self_ptr;
+   netplay->run_frame_count = netplay->self_frame_count;
+
+   /* We need to ignore any intervening data from the other side,
+    * and never rewind past this */
+   netplay_update_unread_ptr(netplay);
+
+   if (netplay->unread_frame_count < netplay->run_frame_count)
+   {
+      uint32_t client;
+      for (client = 0; client < MAX_CLIENTS; client++)
+      {
+         if (!(netplay->connected_players & (1 << client)))
+            continue;
+
+         if (netplay->read_frame_count[client] < netplay->run_frame_count)
+         {
+            netplay->read_ptr[client] = netplay->run_ptr;
+            netplay->read_frame_count[client] = netplay->run_frame_count;
+         }
+      }
+      if (netplay->server_frame_count < netplay->run_frame_count)
+      {
+         netplay->server_ptr = netplay->run_ptr;
+         netplay->server_frame_count = netplay->run_frame_count;
+      }
+      netplay_update_unread_ptr(netplay);
+   }
+   if (netplay->other_frame_count < netplay->run_frame_count)
+   {
+      netplay->other_ptr = netplay->run_ptr;
+      netplay->other_frame_count = netplay->run_frame_count;
+   }
+}
+
+/**
+ * netplay_state_xfer_blocks
+ *
+ * Number of incremental transfer blocks in a savestate.
+ */
+static size_t netplay_state_xfer_blocks(netplay_t *netplay)
+{
+   return (netplay->state_size + NETPLAY_STATE_XFER_BLOCK_SIZE - 1)
+      / NETPLAY_STATE_XFER_BLOCK_SIZE;
+}
+
+static size_t netplay_state_xfer_block_len(netplay_t *netplay, size_t block)
+{
+   size_t len = netplay->state_size - block * NETPLAY_STATE_XFER_BLOCK_SIZE;
+   return (len > NETPLAY_STATE_XFER_BLOCK_SIZE)
+      ? NETPLAY_STATE_XFER_BLOCK_SIZE
+      : len;
+}
+
+/**
+ * netplay_state_xfer_usable
+ *
+ * Can we take part in incremental savestate transfers at all?
+ * Cores that can't be serialized from the start keep using
+ * whole savestates.
+ */
+static bool netplay_state_xfer_usable(netplay_t *netplay)
+{
+   return netplay->state_size && netplay->zbuffer &&
+      !(netplay->quirks & (NETPLAY_QUIRK_NO_SAVESTATES
+            | NETPLAY_QUIRK_NO_TRANSMISSION
+            | NETPLAY_QUIRK_INITIALIZATION));
+}
+
+/**
+ * netplay_state_xfer_buffer
+ *
+ * Get the buffer holding uncompressed transfer payloads, which is
+ * big enough for every block of a savestate plus their indices.
+ */
+static uint8_t *netplay_state_xfer_buffer(netplay_t *netplay)
+{
+   if (!netplay->xfer_buffer)
+      netplay->xfer_buffer = (uint8_t*)malloc(netplay->state_size
+            + netplay_state_xfer_blocks(netplay) * sizeof(uint32_t));
+   return netplay->xfer_buffer;
+}
+
+static void netplay_state_xfer_free(struct netplay_state_xfer *xfer)
+{
+   free(xfer->base);
+   free(xfer->dirty);
+   free(xfer->hashes);
+   free(xfer->ref);
+   xfer->base        = NULL;
+   xfer->dirty       = NULL;
+   xfer->hashes      = NULL;
+   xfer->ref         = NULL;
+   xfer->have_hashes = false;
+   xfer->sending     = false;
+}
+
+static bool netplay_state_xfer_init_send(netplay_t *netplay,
+      struct netplay_state_xfer *xfer)
+{
+   size_t blocks = netplay_state_xfer_blocks(netplay);
+
+   if (!xfer->base)
+      xfer->base   = (uint8_t*)malloc(netplay->state_size);
+   if (!xfer->dirty)
+      xfer->dirty  = (uint8_t*)malloc(blocks);
+   if (!xfer->hashes)
+      xfer->hashes = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+
+   return xfer->base && xfer->dirty && xfer->hashes
+      && netplay_state_xfer_buffer(netplay);
+}
+
+static void netplay_state_xfer_hash(netplay_t *netplay,
+      const uint8_t *state, uint32_t *hashes)
+{
+   size_t i;
+   size_t blocks = netplay_state_xfer_blocks(netplay);
+
+   for (i = 0; i < blocks; i++)
+      hashes[i] = encoding_crc32(0L,
+            state + i * NETPLAY_STATE_XFER_BLOCK_SIZE,
+            netplay_state_xfer_block_len(netplay, i));
+}
+
+/**
+ * netplay_state_xfer_restart
+ *
+ * (Re)start streaming the current transfer from the first block,
+ * skipping every block that the peer already holds.
+ */
+static void netplay_state_xfer_restart(netplay_t *netplay,
+      struct netplay_state_xfer *xfer)
+{
+   size_t i;
+   size_t blocks = netplay_state_xfer_blocks(netplay);
+
+   for (i = 0; i < blocks; i++)
+      xfer->dirty[i] = !xfer->have_hashes ||
+         xfer->hashes[i] != encoding_crc32(0L,
+               xfer->base + i * NETPLAY_STATE_XFER_BLOCK_SIZE,
+               netplay_state_xfer_block_len(netplay, i));
+
+   xfer->next_block = 0;
+}
+
+/**
+ * netplay_state_xfer_pack
+ *
+ * Append a block of the given state to a transfer payload, as its
+ * index followed by its data. Returns the number of bytes written.
+ */
+static size_t netplay_state_xfer_pack(netplay_t *netplay, uint8_t *out,
+      const uint8_t *state, size_t block)
+{
+   uint32_t index = htonl((uint32_t)block);
+   size_t len     = netplay_state_xfer_block_len(netplay, block);
+
+   memcpy(out, &index, sizeof(index));
+   memcpy(out + sizeof(index),
+         state + block * NETPLAY_STATE_XFER_BLOCK_SIZE, len);
+
+   return sizeof(index) + len;
+}
+
+static struct compression_transcoder *netplay_state_xfer_transcoder(
+      netplay_t *netplay, struct netplay_connection *connection)
+{
+   if (connection->compression_supported == NETPLAY_COMPRESSION_ZLIB)
+      return &netplay->compress_zlib;
+   return &netplay->compress_nil;
+}
+
+/**
+ * netplay_state_xfer_send
+ *
+ * Compress the first raw_size bytes of netplay->xfer_buffer and send
+ * them as the payload of cmd, following the given (already byte
+ * swapped) header words.
+ */
+static bool netplay_state_xfer_send(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t cmd,
+      const uint32_t *header, size_t header_size, size_t raw_size)
+{
+   uint32_t cmdbuf[2];
+   uint32_t rd;
+   uint32_t wn                      = 0;
+   struct compression_transcoder *z =
+      netplay_state_xfer_transcoder(netplay, connection);
+
+   /* An empty payload is sent as is */
+   if (raw_size)
+   {
+      z->compression_backend->set_in(z->compression_stream,
+            netplay->xfer_buffer, (uint32_t)raw_size);
+      z->compression_backend->set_out(z->compression_stream,
+            netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+      if (!z->compression_backend->trans(z->compression_stream, true, &rd,
+            &wn, NULL))
+         return false;
+   }
+
+   cmdbuf[0] = htonl(cmd);
+   cmdbuf[1] = htonl((uint32_t)(header_size + wn));
+
+   return netplay_send(&connection->send_packet_buffer, connection->fd,
+            cmdbuf, sizeof(cmdbuf))
+      && netplay_send(&connection->send_packet_buffer, connection->fd,
+            header, header_size)
+      && netplay_send(&connection->send_packet_buffer, connection->fd,
+            netplay->zbuffer, wn);
+}
+
+/**
+ * netplay_state_xfer_apply
+ *
+ * Decompress a received transfer payload from netplay->zbuffer and
+ * patch its blocks into our reference state. Returns false if the
+ * payload is malformed.
+ */
+static bool netplay_state_xfer_apply(netplay_t *netplay,
+      struct netplay_connection *connection, size_t zsize, size_t raw_size,
+      uint32_t *blocks_applied)
+{
+   uint32_t rd, wn;
+   size_t pos                       = 0;
+   size_t blocks                    = netplay_state_xfer_blocks(netplay);
+   struct netplay_state_xfer *xfer  = &connection->xfer;
+   struct compression_transcoder *z =
+      netplay_state_xfer_transcoder(netplay, connection);
+   uint8_t *raw                     = netplay_state_xfer_buffer(netplay);
+
+   if (!raw || raw_size > netplay->state_size + blocks * sizeof(uint32_t))
+      return false;
+
+   if (!xfer->ref)
+   {
+      if (!(xfer->ref = (uint8_t*)calloc(netplay->state_size, 1)))
+         return false;
+   }
+
+   *blocks_applied = 0;
+   if (!raw_size)
+      return !zsize;
+
+   z->decompression_backend->set_in(z->decompression_stream,
+         netplay->zbuffer, (uint32_t)zsize);
+   z->decompression_backend->set_out(z->decompression_stream,
+         raw, (uint32_t)raw_size);
+   if (!z->decompression_backend->trans(z->decompression_stream, true,
+         &rd, &wn, NULL) || wn != raw_size)
+      return false;
+
+   while (pos < raw_size)
+   {
+      uint32_t index;
+      size_t len;
+
+      if (raw_size - pos < sizeof(index))
+         return false;
+      memcpy(&index, raw + pos, sizeof(index));
+      index = ntohl(index);
+      pos  += sizeof(index);
+
+      if (index >= blocks)
+         return false;
+      len = netplay_state_xfer_block_len(netplay, index);
+      if (raw_size - pos < len)
+         return false;
+
+      memcpy(xfer->ref + (size_t)index * NETPLAY_STATE_XFER_BLOCK_SIZE,
+            raw + pos, len);
+      pos += len;
+      (*blocks_applied)++;
+   }
+
+   return true;
+}
+
+/**
+ * netplay_state_xfer_send_hashes
+ *
+ * Make our newest savestate the reference state that the peer's
+ * transfers are applied to, and send the peer its block hashes,
+ * optionally requesting a savestate. Without a savestate to offer,
+ * no hashes are sent and the peer will send every block.
+ */
+static bool netplay_state_xfer_send_hashes(netplay_t *netplay,
+      struct netplay_connection *connection, bool request)
+{
+   size_t i;
+   size_t blocks                   = 0;
+   struct netplay_state_xfer *xfer = &connection->xfer;
+   uint32_t *payload               = (uint32_t*)
+      netplay_state_xfer_buffer(netplay);
+
+   if (!payload)
+      return false;
+
+   if (netplay->state_head_ptr != NETPLAY_STATE_NONE)
+   {
+      if (!xfer->ref)
+         xfer->ref = (uint8_t*)malloc(netplay->state_size);
+      if (xfer->ref)
+      {
+         memcpy(xfer->ref, netplay->state_head, netplay->state_size);
+         blocks = netplay_state_xfer_blocks(netplay);
+         netplay_state_xfer_hash(netplay, xfer->ref, payload + 3);
+         for (i = 0; i < blocks; i++)
+            payload[3 + i] = htonl(payload[3 + i]);
+      }
+   }
+
+   /* Anything the peer sent for the previous reference is now stale */
+   xfer->ref_id++;
+
+   payload[0] = htonl(xfer->ref_id);
+   payload[1] = htonl(request ? NETPLAY_CMD_STATE_HASHES_BIT_REQUEST : 0);
+   payload[2] = htonl(blocks ? (uint32_t)netplay->state_size : 0);
+
+   return netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_STATE_HASHES,
+         payload, (3 + blocks) * sizeof(uint32_t));
+}
+
+/**
+ * netplay_state_xfer_begin
+ *
+ * Start sending a savestate to a peer. Only the blocks that differ
+ * from the peer's reference state are streamed, a few per frame
+ * (see netplay_state_xfer_pump), after which the state is loaded
+ * by netplay_state_xfer_commit.
+ */
+static void netplay_state_xfer_begin(netplay_t *netplay,
+      struct netplay_connection *connection, const void *state, size_t size)
+{
+   struct netplay_state_xfer *xfer = &connection->xfer;
+
+   if (size > netplay->state_size)
+      return;
+
+   if (!netplay_state_xfer_init_send(netplay, xfer))
+   {
+      /* Fall back to sending whole savestates */
+      RARCH_WARN("[Netplay] Out of memory for incremental savestate transfers.\n");
+      xfer->supported               = false;
+      netplay->force_send_savestate = true;
+      return;
+   }
+
+   memcpy(xfer->base, state, size);
+   memset(xfer->base + size, 0, netplay->state_size - size);
+
+   xfer->sending  = true;
+   xfer->streamed = 0;
+   xfer->frames   = 0;
+   netplay_state_xfer_restart(netplay, xfer);
+}
+
+/**
+ * netplay_state_xfer_ready
+ *
+ * Is any transfer in progress, and have all of them streamed all
+ * of their blocks? Transfers are committed together, so that every
+ * peer loads the state at the same frame.
+ */
+static bool netplay_state_xfer_ready(netplay_t *netplay)
+{
+   size_t i;
+   bool ready    = false;
+   size_t blocks = netplay_state_xfer_blocks(netplay);
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active || !connection->xfer.sending)
+         continue;
+      if (connection->xfer.next_block < blocks)
+         return false;
+      ready = true;
+   }
+
+   return ready;
+}
+
+/**
+ * netplay_state_xfer_commit
+ * @state                : our savestate for the current frame
+ *
+ * Complete every transfer that streamed all of its blocks: send the
+ * blocks in which the current state differs from the streamed one,
+ * which the peer loads at the current frame like a whole savestate.
+ */
+static void netplay_state_xfer_commit(netplay_t *netplay,
+      const uint8_t *state)
+{
+   size_t i, j;
+   size_t blocks  = netplay_state_xfer_blocks(netplay);
+   uint32_t crc;
+
+   if (!netplay_state_xfer_ready(netplay))
+      return;
+
+   /* As with whole savestates, the peers load it where we're inputting
+    * (see netplay_load_savestate) */
+   netplay_force_future(netplay);
+
+   crc = encoding_crc32(0L, state, netplay->state_size);
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      uint32_t header[5];
+      uint32_t committed                    = 0;
+      size_t raw_size                       = 0;
+      struct netplay_connection *connection = &netplay->connections[i];
+      struct netplay_state_xfer *xfer       = &connection->xfer;
+
+      if (!connection->active || !xfer->sending)
+         continue;
+
+      for (j = 0; j < blocks; j++)
+      {
+         size_t offset = j * NETPLAY_STATE_XFER_BLOCK_SIZE;
+         if (memcmp(state + offset, xfer->base + offset,
+                  netplay_state_xfer_block_len(netplay, j)))
+         {
+            raw_size += netplay_state_xfer_pack(netplay,
+                  netplay->xfer_buffer + raw_size, state, j);
+            committed++;
+         }
+      }
+
+      header[0] = htonl(netplay->run_frame_count);
+      header[1] = htonl((uint32_t)netplay->state_size);
+      header[2] = htonl(xfer->send_id);
+      header[3] = htonl(crc);
+      header[4] = htonl((uint32_t)raw_size);
+
+      if (!netplay_state_xfer_send(netplay, connection,
+               NETPLAY_CMD_LOAD_STATE_DELTA, header, sizeof(header),
+               raw_size))
+      {
+         netplay_hangup(netplay, connection);
+         continue;
+      }
+
+      RARCH_LOG("[Netplay] Sent savestate over %u frames: "
+            "%u of %u blocks streamed, %u committed.\n",
+            (unsigned)xfer->frames, (unsigned)xfer->streamed,
+            (unsigned)blocks, (unsigned)committed);
+
+      /* The peer's reference state now matches ours */
+      netplay_state_xfer_hash(netplay, state, xfer->hashes);
+      xfer->have_hashes = true;
+      xfer->sending     = false;
+   }
+}
+
 /**
  * netplay_handshake_init_send
  *
@@ -909,7 +1376,9 @@ bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(NETPLAY_MAGIC);
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED |
+         (netplay_state_xfer_usable(netplay)
+          ? NETPLAY_STATE_XFER_SUPPORTED : 0));
 
    if (netplay->is_server)
    {
@@ -1160,6 +1629,10 @@ bool netplay_handshake_init(netplay_t *netplay,
    }
 
 
+   /* Incremental savestate transfers need both sides to support them */
+   connection->xfer.supported = netplay_state_xfer_usable(netplay) &&
+      (ntohl(header[2]) & NETPLAY_STATE_XFER_SUPPORTED);
+
    /* Check what compression is supported */
    compression  = ntohl(header[2]);
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
@@ -1273,6 +1746,12 @@ static void netplay_handshake_ready(netplay_t *netplay,
       snprintf(msg, sizeof(msg), "%s: \"%s\"",
             msg_hash_to_str(MSG_CONNECTED_TO),
             connection->nick);
+
+      /* Offer our current state as the reference for the
+       * savestate we're about to be sent */
+      if (     connection->xfer.supported
+            && netplay->state_head_ptr != NETPLAY_STATE_NONE)
+         netplay_state_xfer_send_hashes(netplay, connection, false);
    }
 
    RARCH_LOG("[Netplay] %s\n", msg);
@@ -2091,9 +2570,18 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
          return false;
    }
 
-   delta->used  = true;
-   delta->frame = frame;
-   delta->crc   = 0;
+   delta->used       = true;
+   delta->frame      = frame;
+   delta->crc        = 0;
+   delta->have_state = false;
+
+   netplay->state_delta_total -= delta->state_delta_size;
+   delta->state_delta_size     = 0;
+
+   if (netplay->state_head_ptr == (size_t)(delta - netplay->buffer))
+      netplay->state_head_ptr = NETPLAY_STATE_NONE;
+   if (netplay->state_work_ptr == (size_t)(delta - netplay->buffer))
+      netplay->state_work_ptr = NETPLAY_STATE_NONE;
 
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
    {
@@ -2107,6 +2595,259 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
    return true;
 }
 
+/* Returns true if frame 'a' comes after frame 'b' */
+#define NETPLAY_FRAME_AFTER(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) > 0)
+
+/**
+ * netplay_state_diff
+ *
+ * Stores the blocks of 'state' that differ from 'base'
+ * as the delta of frame 'ptr', based on frame 'base_ptr'.
+ *
+ * Returns: false on allocation failure, in which case the
+ * frame is left without a state.
+ */
+static bool netplay_state_diff(netplay_t *netplay, size_t ptr,
+      const uint8_t *state, const uint8_t *base, size_t base_ptr)
+{
+   size_t offset;
+   struct delta_frame *delta = &netplay->buffer[ptr];
+   size_t size               = 0;
+
+   netplay->state_delta_total -= delta->state_delta_size;
+   delta->state_delta_size     = 0;
+   delta->have_state           = false;
+
+   for (offset = 0; offset < netplay->state_size;
+         offset += NETPLAY_STATE_BLOCK_SIZE)
+   {
+      uint32_t block;
+      size_t len = netplay->state_size - offset;
+
+      if (len > NETPLAY_STATE_BLOCK_SIZE)
+         len = NETPLAY_STATE_BLOCK_SIZE;
+
+      if (!memcmp(state + offset, base + offset, len))
+         continue;
+
+      if (size + sizeof(block) + len > delta->state_delta_capacity)
+      {
+         size_t capacity = delta->state_delta_capacity
+            ? delta->state_delta_capacity * 2
+            : 4 * (sizeof(block) + NETPLAY_STATE_BLOCK_SIZE);
+         uint8_t *tmp    = (uint8_t*)realloc(delta->state_delta, capacity);
+
+         if (!tmp)
+            return false;
+
+         delta->state_delta          = tmp;
+         delta->state_delta_capacity = capacity;
+      }
+
+      block = (uint32_t)(offset / NETPLAY_STATE_BLOCK_SIZE);
+      memcpy(delta->state_delta + size, &block, sizeof(block));
+      memcpy(delta->state_delta + size + sizeof(block), state + offset, len);
+      size += sizeof(block) + len;
+   }
+
+   delta->state_delta_size     = size;
+   delta->state_base_ptr       = base_ptr;
+   delta->state_base_frame     = netplay->buffer[base_ptr].frame;
+   delta->have_state           = true;
+   netplay->state_delta_total += size;
+   netplay->state_stats.delta += size;
+
+   return true;
+}
+
+/* Applies the delta of 'delta' to 'state', turning
+ * the state of its base frame into its own */
+static void netplay_state_patch(netplay_t *netplay,
+      const struct delta_frame *delta, uint8_t *state)
+{
+   const uint8_t *data = delta->state_delta;
+   const uint8_t *end  = data + delta->state_delta_size;
+
+   while (data < end)
+   {
+      uint32_t block;
+      size_t offset, len;
+
+      memcpy(&block, data, sizeof(block));
+      offset = (size_t)block * NETPLAY_STATE_BLOCK_SIZE;
+      len    = netplay->state_size - offset;
+      if (len > NETPLAY_STATE_BLOCK_SIZE)
+         len = NETPLAY_STATE_BLOCK_SIZE;
+
+      memcpy(state + offset, data + sizeof(block), len);
+      data  += sizeof(block) + len;
+   }
+
+   netplay->state_stats.reconstructed += delta->state_delta_size;
+}
+
+/**
+ * netplay_state_get
+ *
+ * Get the serialized state of frame 'ptr', rebuilding it from
+ * the frame deltas if it is not the newest one. The returned
+ * buffer is valid until the next call to netplay_state_get()
+ * or netplay_state_store().
+ *
+ * Returns: the state, or NULL if no (complete) state is stored
+ * for this frame.
+ */
+static const uint8_t *netplay_state_get(netplay_t *netplay, size_t ptr)
+{
+   size_t cur;
+   size_t len = 0;
+
+   if (!netplay->state_size || !netplay->buffer[ptr].have_state)
+      return NULL;
+
+   if (ptr == netplay->state_head_ptr)
+      return netplay->state_head;
+   if (ptr == netplay->state_work_ptr)
+      return netplay->state_work;
+
+   /* Follow the chain of bases up to a state we hold in full */
+   for (cur = ptr;
+        cur != netplay->state_head_ptr && cur != netplay->state_work_ptr; )
+   {
+      const struct delta_frame *delta = &netplay->buffer[cur];
+      const struct delta_frame *base;
+
+      if (     !delta->have_state
+            || delta->state_base_ptr == NETPLAY_STATE_NONE
+            || len >= netplay->buffer_size)
+         return NULL;
+
+      base = &netplay->buffer[delta->state_base_ptr];
+      if (!base->have_state || base->frame != delta->state_base_frame)
+         return NULL;
+
+      netplay->state_chain[len++] = cur;
+      cur                         = delta->state_base_ptr;
+   }
+
+   if (cur == netplay->state_head_ptr)
+   {
+      memcpy(netplay->state_work, netplay->state_head, netplay->state_size);
+      netplay->state_stats.reconstructed += netplay->state_size;
+   }
+
+   while (len--)
+      netplay_state_patch(netplay,
+            &netplay->buffer[netplay->state_chain[len]], netplay->state_work);
+
+   netplay->state_work_ptr = ptr;
+   netplay->state_stats.reconstructions++;
+
+   return netplay->state_work;
+}
+
+/**
+ * netplay_state_store
+ *
+ * Stores the state held in netplay->state_scratch as the
+ * state of frame 'ptr'. The newest state is kept in full, and
+ * the previous newest state is reduced to its difference from
+ * this one, so storing one frame after another only writes
+ * the blocks that changed. Storing an older frame (when
+ * replaying) drops all newer states, which are about to be
+ * stored again.
+ */
+static void netplay_state_store(netplay_t *netplay, size_t ptr)
+{
+   uint8_t *tmp;
+   size_t i;
+   struct delta_frame *delta = &netplay->buffer[ptr];
+   size_t head_ptr           = netplay->state_head_ptr;
+
+   netplay->state_stats.stores++;
+   netplay->state_stats.serialized += netplay->state_size;
+
+   if (netplay->state_work_ptr == ptr)
+      netplay->state_work_ptr = NETPLAY_STATE_NONE;
+
+   if (head_ptr != NETPLAY_STATE_NONE && head_ptr != ptr
+         && NETPLAY_FRAME_AFTER(delta->frame,
+            netplay->buffer[head_ptr].frame))
+   {
+      /* Next frame: the previous head keeps only what
+       * differs from this state */
+      netplay_state_diff(netplay, head_ptr,
+            netplay->state_head, netplay->state_scratch, ptr);
+   }
+   else if (head_ptr != NETPLAY_STATE_NONE)
+   {
+      /* Rewriting the head or an older frame. The frame
+       * based on this one must be rebased onto the new state */
+      const uint8_t *old_state = netplay_state_get(netplay, ptr);
+
+      for (i = 0; i < netplay->buffer_size; i++)
+      {
+         struct delta_frame *prev = &netplay->buffer[i];
+
+         if (     i == ptr
+               || !prev->have_state
+               || prev->state_base_ptr   != ptr
+               || prev->state_base_frame != delta->frame)
+            continue;
+
+         if (old_state)
+         {
+            /* Rebuild it in the old head buffer, whose
+             * content is no longer needed */
+            if (old_state != netplay->state_head)
+               memcpy(netplay->state_head, old_state, netplay->state_size);
+            netplay_state_patch(netplay, prev, netplay->state_head);
+            netplay_state_diff(netplay, i,
+                  netplay->state_head, netplay->state_scratch, ptr);
+         }
+         else
+            prev->have_state = false;
+         break;
+      }
+
+      /* Newer frames can no longer be rebuilt */
+      if (head_ptr != ptr)
+         netplay->buffer[head_ptr].have_state = false;
+      netplay->state_work_ptr = NETPLAY_STATE_NONE;
+   }
+
+   netplay->state_delta_total -= delta->state_delta_size;
+   delta->state_delta_size     = 0;
+   delta->state_base_ptr       = NETPLAY_STATE_NONE;
+   delta->have_state           = true;
+
+   tmp                         = netplay->state_head;
+   netplay->state_head         = netplay->state_scratch;
+   netplay->state_scratch      = tmp;
+   netplay->state_head_ptr     = ptr;
+}
+
+static void netplay_state_log_stats(netplay_t *netplay)
+{
+   const struct netplay_state_stats *stats = &netplay->state_stats;
+
+   if (!stats->stores)
+      return;
+
+   RARCH_LOG("[Netplay] Savestate ring: %u states stored, "
+         "%u bytes serialized and %u bytes of delta per state, "
+         "%u rebuilds (%u bytes copied).\n",
+         (unsigned)stats->stores,
+         (unsigned)(stats->serialized / stats->stores),
+         (unsigned)(stats->delta      / stats->stores),
+         (unsigned)stats->reconstructions,
+         (unsigned)stats->reconstructed);
+   RARCH_LOG("[Netplay] Savestate ring: %u KB held (%u KB as full states).\n",
+         (unsigned)((netplay->state_delta_total
+               + 3 * netplay->state_size) / 1024),
+         (unsigned)(netplay->buffer_size * netplay->state_size / 1024));
+}
+
 /**
  * netplay_delta_frame_crc
  *
@@ -2115,8 +2856,13 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
 static uint32_t netplay_delta_frame_crc(netplay_t *netplay,
       struct delta_frame *delta)
 {
-   return encoding_crc32(0L, (const unsigned char*)delta->state,
-         netplay->state_size);
+   const uint8_t *state = netplay_state_get(netplay,
+         delta - netplay->buffer);
+
+   if (!state)
+      return 0;
+
+   return encoding_crc32(0L, state, netplay->state_size);
 }
 
 /*
@@ -2144,10 +2890,10 @@ static void netplay_delta_frame_free(struct delta_frame *delta)
 {
    uint32_t i;
 
-   if (delta->state)
+   if (delta->state_delta)
    {
-      free(delta->state);
-      delta->state = NULL;
+      free(delta->state_delta);
+      delta->state_delta = NULL;
    }
 
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
@@ -2635,6 +3381,62 @@ static bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    return success;
 }
 
+/**
+ * netplay_state_xfer_pump
+ *
+ * Stream the next dirty blocks of every transfer in progress. A
+ * connection whose send buffer hasn't drained since the last call
+ * is skipped, so transfers never block on the socket.
+ */
+static void netplay_state_xfer_pump(netplay_t *netplay)
+{
+   size_t i;
+   size_t blocks = netplay_state_xfer_blocks(netplay);
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      uint32_t header[2];
+      size_t raw_size                       = 0;
+      struct netplay_connection *connection = &netplay->connections[i];
+      struct netplay_state_xfer *xfer       = &connection->xfer;
+
+      if (     !connection->active
+            || connection->mode < NETPLAY_CONNECTION_CONNECTED
+            || !xfer->sending
+            || xfer->next_block >= blocks)
+         continue;
+
+      xfer->frames++;
+
+      if (buf_used(&connection->send_packet_buffer)
+            >= NETPLAY_STATE_XFER_FRAME_BUDGET)
+         continue;
+
+      while (xfer->next_block < blocks
+            && raw_size < NETPLAY_STATE_XFER_FRAME_BUDGET)
+      {
+         if (xfer->dirty[xfer->next_block])
+         {
+            raw_size += netplay_state_xfer_pack(netplay,
+                  netplay->xfer_buffer + raw_size,
+                  xfer->base, xfer->next_block);
+            xfer->streamed++;
+         }
+         xfer->next_block++;
+      }
+
+      if (!raw_size)
+         continue;
+
+      header[0] = htonl(xfer->send_id);
+      header[1] = htonl((uint32_t)raw_size);
+
+      if (!netplay_state_xfer_send(netplay, connection,
+               NETPLAY_CMD_STATE_BLOCKS, header, sizeof(header), raw_size))
+         netplay_hangup(netplay, connection);
+   }
+}
+
 /**
  * netplay_cmd_request_savestate
  *
@@ -2649,6 +3451,9 @@ static bool netplay_cmd_request_savestate(netplay_t *netplay)
    if (netplay->savestate_request_outstanding)
       return true;
    netplay->savestate_request_outstanding = true;
+   if (netplay->connections[0].xfer.supported)
+      return netplay_state_xfer_send_hashes(netplay,
+            &netplay->connections[0], true);
    return netplay_send_raw_cmd(netplay, &netplay->connections[0],
       NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
 }
@@ -3465,10 +4270,9 @@ bool netplay_sync_pre_frame(netplay_t *netplay, bool *disconnect)
             &netplay->buffer[netplay->run_ptr], netplay->run_frame_count))
    {
       serial_info.data_const = NULL;
-      serial_info.data       = netplay->buffer[netplay->run_ptr].state;
+      serial_info.data       = netplay->state_scratch;
       serial_info.size       = netplay->state_size;
 
-      memset(serial_info.data, 0, serial_info.size);
       if ((netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
             || netplay->run_frame_count == 0)
       {
@@ -3477,24 +4281,33 @@ bool netplay_sync_pre_frame(netplay_t *netplay, bool *disconnect)
       else if (!(netplay->quirks & NETPLAY_QUIRK_NO_SAVESTATES)
             && core_serialize(&serial_info))
       {
-         if (netplay->force_send_savestate && !netplay->stall
-               && !netplay->remote_paused)
+         netplay_state_store(netplay, netplay->run_ptr);
+
+         if ((netplay->force_send_savestate
+                  || netplay_state_xfer_ready(netplay))
+               && !netplay->stall && !netplay->remote_paused)
          {
             /* Bring our running frame and input frames into
              * parity so we don't send old info. */
             if (netplay->run_ptr != netplay->self_ptr)
             {
-               memcpy(netplay->buffer[netplay->self_ptr].state,
-                  netplay->buffer[netplay->run_ptr].state,
+               memcpy(netplay->state_scratch, netplay->state_head,
                   netplay->state_size);
+               netplay_state_store(netplay, netplay->self_ptr);
                netplay->run_ptr         = netplay->self_ptr;
                netplay->run_frame_count = netplay->self_frame_count;
             }
 
             /* Send this along to the other side */
-            serial_info.data_const = netplay->buffer[netplay->run_ptr].state;
-            netplay_load_savestate(netplay, &serial_info, false);
-            netplay->force_send_savestate = false;
+            if (netplay->force_send_savestate)
+            {
+               serial_info.data_const = netplay->state_head;
+               netplay_load_savestate(netplay, &serial_info, false);
+               netplay->force_send_savestate = false;
+            }
+
+            /* Have those peers whose transfer is complete load it */
+            netplay_state_xfer_commit(netplay, netplay->state_head);
          }
       }
       else
@@ -3514,6 +4327,9 @@ bool netplay_sync_pre_frame(netplay_t *netplay, bool *disconnect)
          netplay->stall = NETPLAY_STALL_NO_CONNECTION;
    }
 
+   /* Stream savestates in progress */
+   netplay_state_xfer_pump(netplay);
+
    if (netplay->is_server)
    {
       int new_fd        = -1;
@@ -3733,10 +4549,10 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          netplay_wait_and_init_serialization(netplay);
 
       serial_info.data       = NULL;
-      serial_info.data_const = netplay->buffer[netplay->replay_ptr].state;
+      serial_info.data_const = netplay_state_get(netplay, netplay->replay_ptr);
       serial_info.size       = netplay->state_size;
 
-      if (!core_unserialize(&serial_info))
+      if (!serial_info.data_const || !core_unserialize(&serial_info))
       {
          RARCH_ERR("[Netplay] Netplay savestate loading failed: Prepare for desync!\n");
       }
@@ -3746,15 +4562,15 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          retro_time_t start, tm;
          struct delta_frame *ptr = &netplay->buffer[netplay->replay_ptr];
 
-         serial_info.data        = ptr->state;
+         serial_info.data        = netplay->state_scratch;
          serial_info.size        = netplay->state_size;
          serial_info.data_const  = NULL;
 
          start                   = cpu_features_get_time_usec();
 
          /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
          core_serialize(&serial_info);
+         netplay_state_store(netplay, netplay->replay_ptr);
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
 
@@ -3780,9 +4596,9 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
             else
                RARCH_LOG("INP  %X %X\n", ptr->self_state[0], ptr->real_input_state[0]);
             ptr = &netplay->buffer[netplay->replay_ptr];
-            serial_info.data = ptr->state;
-            memset(serial_info.data, 0, serial_info.size);
+            serial_info.data = netplay->state_scratch;
             core_serialize(&serial_info);
+            netplay_state_store(netplay, netplay->replay_ptr);
             RARCH_LOG("POST %u: %X\n", netplay->replay_frame_count-1, netplay->state_size ? netplay_delta_frame_crc(netplay, ptr) : 0);
          }
 #endif
@@ -4033,6 +4849,7 @@ void netplay_hangup(netplay_t *netplay,
    connection->active = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+   netplay_state_xfer_free(&connection->xfer);
 
    if (!netplay->is_server)
    {
@@ -5711,7 +6528,93 @@ static bool netplay_get_cmd(netplay_t *netplay,
          netplay->force_send_savestate = true;
          break;
 
+      case NETPLAY_CMD_STATE_HASHES:
+         {
+            uint32_t header[3];
+            size_t i, blocks;
+            struct netplay_state_xfer *xfer = &connection->xfer;
+
+            if (!xfer->supported)
+            {
+               RARCH_ERR("[Netplay] Received unexpected savestate hashes.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            blocks = netplay_state_xfer_blocks(netplay);
+
+            if (cmd_size != sizeof(header) &&
+                cmd_size != sizeof(header) + blocks * sizeof(uint32_t))
+            {
+               RARCH_ERR("[Netplay] CMD_STATE_HASHES received an unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(header, sizeof(header))
+               return false;
+
+            if (cmd_size > sizeof(header))
+            {
+               if (     ntohl(header[2]) != netplay->state_size
+                     || !netplay_state_xfer_init_send(netplay, xfer))
+               {
+                  RARCH_ERR("[Netplay] CMD_STATE_HASHES received an unexpected save state size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               RECV(xfer->hashes, blocks * sizeof(uint32_t))
+                  return false;
+
+               for (i = 0; i < blocks; i++)
+                  xfer->hashes[i] = ntohl(xfer->hashes[i]);
+            }
+
+            xfer->have_hashes = (cmd_size > sizeof(header));
+            xfer->send_id     = ntohl(header[0]);
+
+            /* Delay until next frame so we don't send the savestate
+             * after the input. A transfer already in progress only
+             * has to be redirected to the new reference */
+            if (ntohl(header[1]) & NETPLAY_CMD_STATE_HASHES_BIT_REQUEST)
+               netplay->force_send_savestate = true;
+            else if (xfer->sending)
+               netplay_state_xfer_restart(netplay, xfer);
+            break;
+         }
+
+      case NETPLAY_CMD_STATE_BLOCKS:
+         {
+            uint32_t header[2];
+            uint32_t applied;
+
+            if (!connection->xfer.supported ||
+                cmd_size < sizeof(header) ||
+                cmd_size > netplay->zbuffer_size + sizeof(header))
+            {
+               RARCH_ERR("[Netplay] CMD_STATE_BLOCKS received an unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(header, sizeof(header))
+               return false;
+
+            RECV(netplay->zbuffer, cmd_size - sizeof(header))
+               return false;
+
+            /* Blocks of a superseded reference state are ignored */
+            if (ntohl(header[0]) != connection->xfer.ref_id)
+               break;
+
+            if (!netplay_state_xfer_apply(netplay, connection,
+                     cmd_size - sizeof(header), ntohl(header[1]), &applied))
+            {
+               RARCH_ERR("[Netplay] CMD_STATE_BLOCKS received invalid blocks.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+            break;
+         }
+
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_STATE_DELTA:
       case NETPLAY_CMD_RESET:
          {
             uint32_t frame;
@@ -5769,6 +6672,9 @@ static bool netplay_get_cmd(netplay_t *netplay,
             /* Check the payload size */
             if ((cmd == NETPLAY_CMD_LOAD_SAVESTATE &&
                  (cmd_size < 2*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 2*sizeof(uint32_t))) ||
+                (cmd == NETPLAY_CMD_LOAD_STATE_DELTA &&
+                 (!connection->xfer.supported ||
+                  cmd_size < 5*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 5*sizeof(uint32_t))) ||
                 (cmd == NETPLAY_CMD_RESET && cmd_size != sizeof(frame)))
             {
                RARCH_ERR("[Netplay] CMD_LOAD_SAVESTATE received an unexpected payload size.\n");
@@ -5832,10 +6738,67 @@ static bool netplay_get_cmd(netplay_t *netplay,
                ctrans->decompression_backend->set_in(ctrans->decompression_stream,
                   netplay->zbuffer, cmd_size - 2*sizeof(uint32_t));
                ctrans->decompression_backend->set_out(ctrans->decompression_stream,
-                  (uint8_t*)netplay->buffer[load_ptr].state,
+                  netplay->state_scratch,
                   (unsigned)netplay->state_size);
                ctrans->decompression_backend->trans(ctrans->decompression_stream,
                   true, &rd, &wn, NULL);
+               netplay_state_store(netplay, load_ptr);
+
+               /* Force a rewind to the relevant frame */
+               netplay->force_rewind = true;
+            }
+            else if (cmd == NETPLAY_CMD_LOAD_STATE_DELTA)
+            {
+               /* Savestate size, reference id, CRC-32 and raw size */
+               uint32_t dheader[4];
+               uint32_t applied               = 0;
+               struct netplay_state_xfer *xfer = &connection->xfer;
+
+               RECV(dheader, sizeof(dheader))
+                  return false;
+
+               if (ntohl(dheader[0]) != netplay->state_size)
+               {
+                  RARCH_ERR("[Netplay] CMD_LOAD_STATE_DELTA received an unexpected save state size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               RECV(netplay->zbuffer, cmd_size - 5*sizeof(uint32_t))
+                  return false;
+
+               if (ntohl(dheader[1]) != xfer->ref_id)
+               {
+                  /* Built on a superseded reference state. Our request
+                   * for a new one is already underway, or about to be */
+                  RARCH_WARN("[Netplay] Ignoring outdated savestate.\n");
+                  netplay->savestate_request_outstanding = true;
+                  netplay_state_xfer_send_hashes(netplay, connection, true);
+                  break;
+               }
+
+               if (!netplay_state_xfer_apply(netplay, connection,
+                        cmd_size - 5*sizeof(uint32_t), ntohl(dheader[3]),
+                        &applied))
+               {
+                  RARCH_ERR("[Netplay] CMD_LOAD_STATE_DELTA received invalid blocks.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               if (encoding_crc32(0L, xfer->ref, netplay->state_size)
+                     != ntohl(dheader[2]))
+               {
+                  /* A block hash collided, start over */
+                  RARCH_WARN("[Netplay] Incrementally received savestate is corrupt, requesting it again.\n");
+                  netplay->savestate_request_outstanding = true;
+                  netplay_state_xfer_send_hashes(netplay, connection, true);
+                  break;
+               }
+
+               memcpy(netplay->state_scratch, xfer->ref, netplay->state_size);
+               netplay_state_store(netplay, load_ptr);
+
+               RARCH_LOG("[Netplay] Loaded savestate, %u blocks committed.\n",
+                     (unsigned)applied);
 
                /* Force a rewind to the relevant frame */
                netplay->force_rewind = true;
@@ -6638,7 +7601,6 @@ static bool netplay_init_socket_buffers(netplay_t *netplay)
 
 static bool netplay_init_serialization(netplay_t *netplay)
 {
-   unsigned i;
    retro_ctx_size_info_t info;
 
    if (netplay->state_size)
@@ -6649,19 +7611,31 @@ static bool netplay_init_serialization(netplay_t *netplay)
    if (!info.size)
       return false;
 
-   netplay->state_size = info.size;
-
-   for (i = 0; i < netplay->buffer_size; i++)
-   {
-      netplay->buffer[i].state = calloc(netplay->state_size, 1);
-
-      if (!netplay->buffer[i].state)
-      {
-         netplay->quirks |= NETPLAY_QUIRK_NO_SAVESTATES;
-         return false;
-      }
+   netplay->state_head    = (uint8_t*)calloc(info.size, 1);
+   netplay->state_work    = (uint8_t*)calloc(info.size, 1);
+   netplay->state_scratch = (uint8_t*)calloc(info.size, 1);
+   netplay->state_chain   = (size_t*)calloc(netplay->buffer_size,
+         sizeof(*netplay->state_chain));
+
+   if (     !netplay->state_head
+         || !netplay->state_work
+         || !netplay->state_scratch
+         || !netplay->state_chain)
+   {
+      free(netplay->state_head);
+      free(netplay->state_work);
+      free(netplay->state_scratch);
+      free(netplay->state_chain);
+      netplay->state_head    = NULL;
+      netplay->state_work    = NULL;
+      netplay->state_scratch = NULL;
+      netplay->state_chain   = NULL;
+      netplay->quirks |= NETPLAY_QUIRK_NO_SAVESTATES;
+      return false;
    }
 
+   netplay->state_size = info.size;
+
    netplay->zbuffer_size = netplay->state_size * 2;
    netplay->zbuffer = (uint8_t *) calloc(netplay->zbuffer_size, 1);
    if (!netplay->zbuffer)
@@ -6693,12 +7667,14 @@ bool netplay_try_init_serialization(netplay_t *netplay)
 
    /* Check if we can actually save */
    serial_info.data_const = NULL;
-   serial_info.data       = netplay->buffer[netplay->run_ptr].state;
+   serial_info.data       = netplay->state_scratch;
    serial_info.size       = netplay->state_size;
 
    if (!core_serialize(&serial_info))
       return false;
 
+   netplay_state_store(netplay, netplay->run_ptr);
+
    /* Once initialized, we no longer exhibit this quirk */
    netplay->quirks &= ~((uint64_t) NETPLAY_QUIRK_INITIALIZATION);
 
@@ -6757,7 +7733,9 @@ static bool netplay_init_buffers(netplay_t *netplay)
    if (!delta_frames)
       return false;
 
-   netplay->buffer = delta_frames;
+   netplay->buffer         = delta_frames;
+   netplay->state_head_ptr = NETPLAY_STATE_NONE;
+   netplay->state_work_ptr = NETPLAY_STATE_NONE;
 
    if (!(netplay->quirks & (NETPLAY_QUIRK_NO_SAVESTATES|NETPLAY_QUIRK_INITIALIZATION)))
       netplay_init_serialization(netplay);
@@ -6948,6 +7926,7 @@ void netplay_free(netplay_t *netplay)
          socket_close(connection->fd);
          netplay_deinit_socket_buffer(&connection->send_packet_buffer);
          netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+         netplay_state_xfer_free(&connection->xfer);
       }
    }
 
@@ -6956,15 +7935,24 @@ void netplay_free(netplay_t *netplay)
 
    if (netplay->buffer)
    {
+      netplay_state_log_stats(netplay);
+
       for (i = 0; i < netplay->buffer_size; i++)
          netplay_delta_frame_free(&netplay->buffer[i]);
 
       free(netplay->buffer);
    }
 
+   free(netplay->state_head);
+   free(netplay->state_work);
+   free(netplay->state_scratch);
+   free(netplay->state_chain);
+
    if (netplay->zbuffer)
       free(netplay->zbuffer);
 
+   free(netplay->xfer_buffer);
+
    if (netplay->compress_nil.compression_stream)
       netplay->compress_nil.compression_backend->stream_free(
             netplay->compress_nil.compression_stream);
@@ -7001,6 +7989,19 @@ static void netplay_send_savestate(netplay_t *netplay,
    uint32_t rd, wn;
    size_t i;
 
+   /* Don't bother compressing it if no peer needs it */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (     connection->active
+            && connection->mode >= NETPLAY_CONNECTION_CONNECTED
+            && connection->compression_supported == cx
+            && !connection->xfer.supported)
+         break;
+   }
+   if (i == netplay->connections_size)
+      return;
+
    /* Compress it */
    z->compression_backend->set_in(z->compression_stream,
       (const uint8_t*)serial_info->data_const, (uint32_t)serial_info->size);
@@ -7026,7 +8027,8 @@ static void netplay_send_savestate(netplay_t *netplay,
       struct netplay_connection *connection = &netplay->connections[i];
       if (!connection->active ||
           connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+          connection->compression_supported != cx ||
+          connection->xfer.supported) continue;
 
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
             sizeof(header)) ||
@@ -7080,52 +8082,6 @@ void netplay_frontend_paused(netplay_t *netplay, bool paused)
    }
 }
 
-/**
- * netplay_force_future
- * @netplay              : pointer to netplay object
- *
- * Force netplay to ignore all past input, typically because we've just loaded
- * a state or reset.
- */
-static void netplay_force_future(netplay_t *netplay)
-{
-   /* Wherever we're inputting, that's where we consider our state to be loaded */
-   netplay->run_ptr         = netplay->self_ptr;
-   netplay->run_frame_count = netplay->self_frame_count;
-
-   /* We need to ignore any intervening data from the other side,
-    * and never rewind past this */
-   netplay_update_unread_ptr(netplay);
-
-   if (netplay->unread_frame_count < netplay->run_frame_count)
-   {
-      uint32_t client;
-      for (client = 0; client < MAX_CLIENTS; client++)
-      {
-         if (!(netplay->connected_players & (1 << client)))
-            continue;
-
-         if (netplay->read_frame_count[client] < netplay->run_frame_count)
-         {
-            netplay->read_ptr[client] = netplay->run_ptr;
-            netplay->read_frame_count[client] = netplay->run_frame_count;
-         }
-      }
-      if (netplay->server_frame_count < netplay->run_frame_count)
-      {
-         netplay->server_ptr = netplay->run_ptr;
-         netplay->server_frame_count = netplay->run_frame_count;
-      }
-      netplay_update_unread_ptr(netplay);
-   }
-   if (netplay->other_frame_count < netplay->run_frame_count)
-   {
-      netplay->other_ptr = netplay->run_ptr;
-      netplay->other_frame_count = netplay->run_frame_count;
-   }
-}
-
-
 void netplay_core_reset(netplay_t *netplay)
 {
    size_t i;
@@ -7154,6 +8110,7 @@ void netplay_core_reset(netplay_t *netplay)
 void netplay_load_savestate(netplay_t *netplay,
       retro_ctx_serialize_info_t *serial_info, bool save)
 {
+   size_t i;
    retro_ctx_serialize_info_t tmp_serial_info;
 
    netplay_force_future(netplay);
@@ -7169,17 +8126,23 @@ void netplay_load_savestate(netplay_t *netplay,
       if (!serial_info)
       {
          tmp_serial_info.size = netplay->state_size;
-         tmp_serial_info.data = netplay->buffer[netplay->run_ptr].state;
+         tmp_serial_info.data = netplay->state_scratch;
          if (!core_serialize(&tmp_serial_info))
             return;
-         tmp_serial_info.data_const = tmp_serial_info.data;
+         netplay_state_store(netplay, netplay->run_ptr);
+         tmp_serial_info.data_const = netplay->state_head;
          serial_info = &tmp_serial_info;
       }
       else
       {
          if (serial_info->size <= netplay->state_size)
-            memcpy(netplay->buffer[netplay->run_ptr].state,
+         {
+            memcpy(netplay->state_scratch,
                   serial_info->data_const, serial_info->size);
+            memset(netplay->state_scratch + serial_info->size, 0,
+                  netplay->state_size - serial_info->size);
+            netplay_state_store(netplay, netplay->run_ptr);
+         }
       }
    }
 
@@ -7193,7 +8156,18 @@ void netplay_load_savestate(netplay_t *netplay,
             | NETPLAY_QUIRK_NO_TRANSMISSION))
       return;
 
-   /* Send this to every peer */
+   /* Peers that support it get the state incrementally */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (     connection->active
+            && connection->mode >= NETPLAY_CONNECTION_CONNECTED
+            && connection->xfer.supported)
+         netplay_state_xfer_begin(netplay, connection,
+               serial_info->data_const, serial_info->size);
+   }
+
+   /* Send this to every other peer */
    if (netplay->compress_nil.compression_backend)
       netplay_send_savestate(netplay, serial_info, 0, &netplay->compress_nil);
    if (netplay->compress_zlib.compression_backend)
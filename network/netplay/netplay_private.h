@@ -51,6 +51,16 @@ typedef uint32_t client_bitmap_t;
 
 #define NETPLAY_MAX_STALL_FRAMES       60
 #define NETPLAY_FRAME_RUN_TIME_WINDOW  120
+
+/* Granularity of the savestate frame deltas */
+#define NETPLAY_STATE_BLOCK_SIZE 64
+#define NETPLAY_STATE_NONE       ((size_t)-1)
+
+/* Granularity of incremental savestate transfers */
+#define NETPLAY_STATE_XFER_BLOCK_SIZE   4096
+/* Block data streamed to each peer per frame */
+#define NETPLAY_STATE_XFER_FRAME_BUDGET (64 * 1024)
+
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
@@ -92,6 +102,10 @@ typedef uint32_t client_bitmap_t;
 #define NETPLAY_COMPRESSION_SUPPORTED 0
 #endif
 
+/* Sent alongside the supported compression protocols in the
+ * handshake header; peers that don't know it mask it out */
+#define NETPLAY_STATE_XFER_SUPPORTED (1<<16)
+
 enum netplay_cmd
 {
    /* Basic commands */
@@ -163,6 +177,17 @@ enum netplay_cmd
    /* Sends over cheats enabled on client (unsupported) */
    NETPLAY_CMD_CHEATS         = 0x0047,
 
+   /* Send the block hashes of our reference state, optionally
+    * requesting a savestate */
+   NETPLAY_CMD_STATE_HASHES   = 0x0048,
+
+   /* Stream blocks of a savestate into the peer's reference state */
+   NETPLAY_CMD_STATE_BLOCKS   = 0x0049,
+
+   /* Send the blocks of a savestate that differ from the streamed
+    * ones, for the peer to load */
+   NETPLAY_CMD_LOAD_STATE_DELTA = 0x004A,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -202,6 +227,7 @@ enum netplay_cmd
 #define NETPLAY_CMD_MODE_BIT_YOU       (1U<<31)
 #define NETPLAY_CMD_MODE_BIT_PLAYING   (1U<<30)
 #define NETPLAY_CMD_MODE_BIT_SLAVE     (1U<<29)
+#define NETPLAY_CMD_STATE_HASHES_BIT_REQUEST (1U<<0)
 
 /* These are the reasons given for mode changes to be rejected */
 enum netplay_cmd_mode_reasons
@@ -328,8 +354,18 @@ struct delta_frame
     * it's a real simulation, not real input. */
    netplay_input_state_t simlated_input[MAX_INPUT_DEVICES];
 
-   /* The serialized state of the core at this frame, before input */
-   void *state;
+   /* The serialized state of the core at this frame, before input.
+    * Only the newest stored state is held in full (in
+    * netplay->state_head); every other frame holds the blocks of
+    * its state that differ from the state it is based on, i.e.
+    * that of the next newer stored frame (see netplay_state_store) */
+   uint8_t *state_delta;
+   size_t state_delta_size;
+   size_t state_delta_capacity;
+   /* Buffer index of the base state, or NETPLAY_STATE_NONE */
+   size_t state_base_ptr;
+   /* Frame number of the base state, to detect reuse of its slot */
+   uint32_t state_base_frame;
 
    uint32_t frame;
 
@@ -345,6 +381,24 @@ struct delta_frame
    /* A bit derpy, but this is how we know if the delta
     * has been used at all. */
    bool used;
+
+   /* Is a serialized state stored for this frame? */
+   bool have_state;
+};
+
+/* Savestate ring memory traffic, in bytes */
+struct netplay_state_stats
+{
+   /* Number of states stored */
+   uint64_t stores;
+   /* Bytes written by the core while serializing */
+   uint64_t serialized;
+   /* Bytes written to frame deltas */
+   uint64_t delta;
+   /* Number of older states rebuilt from deltas */
+   uint64_t reconstructions;
+   /* Bytes copied while rebuilding older states */
+   uint64_t reconstructed;
 };
 
 struct socket_buffer
@@ -356,6 +410,45 @@ struct socket_buffer
    size_t read;
 };
 
+/* Incremental savestate transfer (see netplay_state_xfer_begin) */
+struct netplay_state_xfer
+{
+   /* Sending side: the state being sent. The peer's reference
+    * state matches it once every dirty block has been streamed */
+   uint8_t *base;
+   /* One flag per block: not yet known to the peer */
+   uint8_t *dirty;
+   /* Block hashes of the peer's reference state */
+   uint32_t *hashes;
+
+   /* Receiving side: our reference state, which the blocks
+    * streamed by the peer are applied to */
+   uint8_t *ref;
+
+   /* Next block to consider for streaming */
+   size_t next_block;
+
+   /* Blocks and frames spent streaming the current transfer */
+   uint32_t streamed;
+   uint32_t frames;
+
+   /* Identifier of the peer's reference state, as announced
+    * with its hashes */
+   uint32_t send_id;
+
+   /* Identifier of our reference state */
+   uint32_t ref_id;
+
+   /* Does the peer support incremental transfers? */
+   bool supported;
+
+   /* Are 'hashes' valid? */
+   bool have_hashes;
+
+   /* Is a transfer in progress? */
+   bool sending;
+};
+
 /* Each connection gets a connection struct */
 struct netplay_connection
 {
@@ -384,6 +477,9 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* Incremental savestate transfers to and from this peer */
+   struct netplay_state_xfer xfer;
+
    /* For the server: When was the last time we requested 
     * this client to stall?
     * For the client: How many frames of stall do we have left? */
@@ -488,9 +584,29 @@ struct netplay
 
    struct delta_frame *buffer;
 
+   /* Savestate ring (see netplay_state_store):
+    * the newest stored state, in full */
+   uint8_t *state_head;
+   /* An older state, rebuilt from the frame deltas */
+   uint8_t *state_work;
+   /* Target of core serialization */
+   uint8_t *state_scratch;
+   /* Buffer indices of the states held by state_head and
+    * state_work, or NETPLAY_STATE_NONE */
+   size_t state_head_ptr;
+   size_t state_work_ptr;
+   /* buffer_size entries, used while rebuilding states */
+   size_t *state_chain;
+   /* Total size of all frame deltas */
+   size_t state_delta_total;
+   struct netplay_state_stats state_stats;
+
    /* A buffer into which to compress frames for transfer */
    uint8_t *zbuffer;
 
+   /* Uncompressed payload of incremental state transfers */
+   uint8_t *xfer_buffer;
+
    size_t connections_size;
    size_t buffer_size;
    size_t zbuffer_size;
@@ -121,6 +121,8 @@ HAVE_COREAUDIO=auto        # CoreAudio support
 HAVE_COREAUDIO3=no         # CoreAudio3 support
 HAVE_PULSE=auto            # PulseAudio support
 C89_PULSE=no
+HAVE_PIPEWIRE=no           # PipeWire support (experimental)
+C89_PIPEWIRE=no
 HAVE_FREETYPE=auto         # FreeType support
 HAVE_STB_FONT=yes          # stb_truetype font support
 HAVE_STB_IMAGE=yes         # stb image loading support
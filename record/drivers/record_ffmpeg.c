@@ -19,15 +19,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <retro_assert.h>
+#include <retro_miscellaneous.h>
 #include <compat/msvc.h>
 #include <compat/strl.h>
 
 #include <boolean.h>
-#include <queues/fifo_queue.h>
 #include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
+#include <features/features_cpu.h>
 #include <file/config_file.h>
 #include <audio/audio_resampler.h>
 #include <string/stdstring.h>
@@ -43,6 +44,7 @@
 #endif
 
 #include "../record_driver.h"
+#include "../record_ring.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -127,6 +129,23 @@ extern "C" {
 #define av_frame_free avcodec_free_frame
 #endif
 
+/* Most bands libswscale conversions are split into */
+#define FFMPEG_MAX_SWS_BANDS 16
+/* Fewest rows a band is given */
+#define FFMPEG_MIN_SWS_BAND_ROWS 32
+
+/* One band of a frame converted by libswscale,
+ * with a context of its own */
+struct ff_sws_band
+{
+   struct SwsContext *sws;
+   const uint8_t *in;
+   uint8_t *out[4];
+   int out_stride[4];
+   int in_stride;
+   int rows;
+};
+
 struct ff_video_info
 {
    AVCodecContext *codec;
@@ -134,8 +153,18 @@ struct ff_video_info
 
    AVFrame *conv_frame;
    uint8_t *conv_frame_buf;
+   /* Points into a ring slot when the input needs
+    * neither scaling nor conversion */
+   AVFrame *pass_frame;
    int64_t frame_cnt;
 
+   /* Ring slots the encoder thread keeps, 1 while
+    * pass_frame is the last frame encoded */
+   unsigned held;
+   /* Frames dropped on a full ring since the last
+    * one queued. Main thread only. */
+   unsigned repeats;
+
    uint8_t *outbuf;
    size_t outbuf_size;
 
@@ -154,6 +183,13 @@ struct ff_video_info
 
    struct scaler_ctx scaler;
    struct SwsContext *sws;
+
+   /* Frames whose height is not scaled are converted by
+    * libswscale in bands across a pool */
+   tpool_t *sws_pool;
+   struct ff_sws_band sws_bands[FFMPEG_MAX_SWS_BANDS];
+   unsigned sws_band_count;
+
    bool use_sws;
 };
 
@@ -211,11 +247,18 @@ struct ff_config_param
    char format[64];
    enum PixelFormat out_pix_fmt;
    unsigned threads;
+   /* Threads scaling and converting frames, 0 for one
+    * per core */
+   unsigned scale_threads;
    unsigned frame_drop_ratio;
    unsigned sample_rate;
    float scale_factor;
 
    bool audio_enable;
+   /* Drop frames instead of stalling the main thread when
+    * the encoder falls behind. Dropped frames are encoded
+    * as repeats of the frame before them. */
+   bool drop_frames;
    /* Keep same naming conventions as libavcodec. */
    bool audio_qscale;
    int audio_global_quality;
@@ -228,25 +271,40 @@ struct ff_config_param
    AVDictionary *audio_opts;
 };
 
+/* How the main thread and the encoder thread kept up
+ * with each other */
+struct ff_handoff_stats
+{
+   retro_time_t video_wait_usec;
+   retro_time_t audio_wait_usec;
+   unsigned frames;
+   unsigned dropped;
+   unsigned video_waits;
+   unsigned audio_waits;
+   unsigned max_queued;
+};
+
 typedef struct ffmpeg
 {
    struct ff_video_info video;
    struct ff_audio_info audio;
    struct ff_muxer_info muxer;
    struct ff_config_param config;
+   struct ff_handoff_stats stats;
 
    struct record_params params;
 
-   scond_t *cond;
-   slock_t *cond_lock;
-   slock_t *lock;
-   fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
+   /* Filled by the main thread, encoded from by the
+    * thread */
+   record_ring_t *video_ring;
+   record_ring_t *audio_ring;
+   /* The thread sleeps on 'work' when both rings are
+    * empty, the main thread on 'space' when one is full */
+   record_signal_t *work;
+   record_signal_t *space;
    sthread_t *thread;
 
    volatile bool alive;
-   volatile bool can_sleep;
 } ffmpeg_t;
 
 AVFormatContext *ctx;
@@ -429,6 +487,7 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle, const char *audio_resampler)
 static bool ffmpeg_init_video(ffmpeg_t *handle)
 {
    size_t size;
+   unsigned scale_threads;
    struct ff_config_param *params  = &handle->config;
    struct ff_video_info *video     = &handle->video;
    struct record_params *param     = &handle->params;
@@ -509,6 +568,20 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
          return false;
    }
 
+   /* Frames are scaled up to the output size on every
+    * push, split scaling across all cores by default */
+   scale_threads         = params->scale_threads
+      ? params->scale_threads : cpu_features_get_core_amount();
+   video->scaler.threads = scale_threads;
+
+   if (video->use_sws && scale_threads > 1)
+   {
+      video->sws_band_count = MIN(scale_threads, FFMPEG_MAX_SWS_BANDS);
+      /* The encoder thread converts the last band itself */
+      if (!(video->sws_pool = tpool_create(video->sws_band_count - 1)))
+         video->sws_band_count = 0;
+   }
+
    video->codec = avcodec_alloc_context3(codec);
 
    /* Useful to set scale_factor to 2 for chroma subsampled formats to
@@ -562,6 +635,9 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    video->conv_frame->height = param->out_height;
    video->conv_frame->format = video->pix_fmt;
 
+   if (video->in_pix_fmt == video->pix_fmt)
+      video->pass_frame = av_frame_alloc();
+
    return true;
 }
 
@@ -722,6 +798,10 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params,
          break;
    }
 
+   /* A stream has to keep up, a recording can make the
+    * game wait */
+   params->drop_frames = preset >= RECORD_CONFIG_TYPE_STREAMING_LOW_QUALITY;
+
    if (preset <= RECORD_CONFIG_TYPE_RECORDING_LOSSLESS_QUALITY)
    {
       if (!video_gpu_record)
@@ -827,6 +907,8 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
          sizeof(params->format));
 
    config_get_uint(params->conf, "threads", &params->threads);
+   config_get_uint(params->conf, "scale_threads", &params->scale_threads);
+   config_get_bool(params->conf, "drop_frames", &params->drop_frames);
 
    if (!config_get_uint(params->conf, "frame_drop_ratio",
             &params->frame_drop_ratio) || !params->frame_drop_ratio)
@@ -925,74 +1007,108 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
 }
 
 #define MAX_FRAMES 32
+/* Audio ring slots, each holding up to
+ * FFMPEG_AUDIO_SLOT_FRAMES frames of one push */
+#define FFMPEG_AUDIO_SLOTS       64
+#define FFMPEG_AUDIO_SLOT_FRAMES 1024
+
+/* Ring slot headers, padded so that pixels and samples
+ * start on a cache line */
+struct ffmpeg_video_slot
+{
+   /* Tightly packed, data unused */
+   struct record_video_data attr;
+   /* Frames dropped just before this one */
+   unsigned repeats;
+};
+
+struct ffmpeg_audio_slot
+{
+   size_t frames;
+};
+
+#define FFMPEG_SLOT_HEADER(type) ((sizeof(type) + 63) & ~(size_t)63)
+#define FFMPEG_VIDEO_SLOT_DATA(slot) ((uint8_t*)(slot) \
+      + FFMPEG_SLOT_HEADER(struct ffmpeg_video_slot))
+#define FFMPEG_AUDIO_SLOT_DATA(slot) ((int16_t*)((uint8_t*)(slot) \
+      + FFMPEG_SLOT_HEADER(struct ffmpeg_audio_slot)))
 
 static void ffmpeg_thread(void *data);
 
 static bool init_thread(ffmpeg_t *handle)
 {
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
-   handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
-         handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
-
-   handle->alive = true;
-   handle->can_sleep = true;
-   handle->thread = sthread_create(ffmpeg_thread, handle);
-
-   retro_assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   /* Frames are scaled straight from their slot, and
+    * FFmpeg has a tendency to crash if we don't
+    * overallocate a bit. Pad slots with a spare row. */
+   handle->video_ring = record_ring_new(MAX_FRAMES,
+         FFMPEG_SLOT_HEADER(struct ffmpeg_video_slot)
+         + (handle->params.fb_height + 1) * handle->params.fb_width
+         * handle->video.pix_size);
+   handle->audio_ring = record_ring_new(FFMPEG_AUDIO_SLOTS,
+         FFMPEG_SLOT_HEADER(struct ffmpeg_audio_slot)
+         + FFMPEG_AUDIO_SLOT_FRAMES * handle->params.channels
+         * sizeof(int16_t));
+   handle->work       = record_signal_new();
+   handle->space      = record_signal_new();
+
+   if (     !handle->video_ring || !handle->audio_ring
+         || !handle->work       || !handle->space)
+      return false;
+
+   handle->alive      = true;
+
+   if (!(handle->thread = sthread_create(ffmpeg_thread, handle)))
+   {
+      handle->alive   = false;
+      return false;
+   }
 
    return true;
 }
 
 static void deinit_thread(ffmpeg_t *handle)
 {
-   if (!handle->thread)
-      return;
-
-   slock_lock(handle->cond_lock);
-   handle->alive = false;
-   handle->can_sleep = false;
-   slock_unlock(handle->cond_lock);
-
-   scond_signal(handle->cond);
-   sthread_join(handle->thread);
-
-   slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
-
-   handle->thread = NULL;
+   if (handle->thread)
+   {
+      handle->alive = false;
+      record_signal_broadcast(handle->work);
+      sthread_join(handle->thread);
+      handle->thread = NULL;
+   }
 }
 
+/* Also frees the signals, which popping the
+ * rings still notifies after the thread is gone */
 static void deinit_thread_buf(ffmpeg_t *handle)
 {
-   if (handle->audio_fifo)
+   if (handle->work)
    {
-      fifo_free(handle->audio_fifo);
-      handle->audio_fifo = NULL;
+      record_signal_free(handle->work);
+      handle->work = NULL;
    }
 
-   if (handle->attr_fifo)
+   if (handle->space)
    {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
+      record_signal_free(handle->space);
+      handle->space = NULL;
    }
 
-   if (handle->video_fifo)
+   if (handle->audio_ring)
    {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
+      record_ring_free(handle->audio_ring);
+      handle->audio_ring = NULL;
+   }
+
+   if (handle->video_ring)
+   {
+      record_ring_free(handle->video_ring);
+      handle->video_ring = NULL;
    }
 }
 
 static void ffmpeg_free(void *data)
 {
+   unsigned i;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    if (!handle)
       return;
@@ -1015,6 +1131,7 @@ static void ffmpeg_free(void *data)
    }
 
    av_frame_free(&handle->video.conv_frame);
+   av_frame_free(&handle->video.pass_frame);
    av_free(handle->video.conv_frame_buf);
 
    scaler_ctx_gen_reset(&handle->video.scaler);
@@ -1022,6 +1139,13 @@ static void ffmpeg_free(void *data)
    if (handle->video.sws)
       sws_freeContext(handle->video.sws);
 
+   if (handle->video.sws_pool)
+      tpool_destroy(handle->video.sws_pool);
+
+   for (i = 0; i < FFMPEG_MAX_SWS_BANDS; i++)
+      if (handle->video.sws_bands[i].sws)
+         sws_freeContext(handle->video.sws_bands[i].sws);
+
    if (handle->config.conf)
       config_file_free(handle->config.conf);
    if (handle->config.video_opts)
@@ -1057,6 +1181,8 @@ static void *ffmpeg_new(const struct record_params *params)
    {
       case RECORD_CONFIG_TYPE_RECORDING_CUSTOM:
       case RECORD_CONFIG_TYPE_STREAMING_CUSTOM:
+         handle->config.drop_frames = params->preset
+            == RECORD_CONFIG_TYPE_STREAMING_CUSTOM;
          if (!ffmpeg_init_config(
                   &handle->config,
                   params->config))
@@ -1099,11 +1225,50 @@ error:
    return NULL;
 }
 
+static bool ffmpeg_video_space_ready(void *data)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+   return !handle->alive || record_ring_acquire(handle->video_ring);
+}
+
+static bool ffmpeg_audio_space_ready(void *data)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+   return !handle->alive || record_ring_acquire(handle->audio_ring);
+}
+
+/* Blocks the main thread until the encoder thread
+ * releases a slot of @ring */
+static void ffmpeg_wait_space(ffmpeg_t *handle, record_ring_t *ring,
+      unsigned *waits, retro_time_t *wait_usec)
+{
+   retro_time_t start = cpu_features_get_time_usec();
+
+   record_signal_wait(handle->space, (ring == handle->video_ring)
+         ? ffmpeg_video_space_ready : ffmpeg_audio_space_ready, handle);
+
+   *wait_usec += cpu_features_get_time_usec() - start;
+   (*waits)++;
+}
+
+static void ffmpeg_publish(ffmpeg_t *handle, record_ring_t *ring)
+{
+   unsigned queued;
+
+   record_ring_publish(ring);
+   record_signal_notify(handle->work);
+
+   queued = record_ring_count(ring);
+   if (ring == handle->video_ring && queued > handle->stats.max_queued)
+      handle->stats.max_queued = queued;
+}
+
 static bool ffmpeg_push_video(void *data,
       const struct record_video_data *vid)
 {
    unsigned y;
-   struct record_video_data attr_data;
+   uint8_t *pixels;
+   struct ffmpeg_video_slot *slot;
    bool drop_frame  = false;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    int       offset = 0;
@@ -1119,53 +1284,50 @@ static bool ffmpeg_push_video(void *data,
    if (drop_frame)
       return true;
 
-   for (;;)
+   if (!handle->alive)
+      return false;
+
+   if (!(slot = (struct ffmpeg_video_slot*)
+            record_ring_acquire(handle->video_ring)))
    {
-      unsigned avail;
+      if (handle->config.drop_frames)
+      {
+         handle->video.repeats++;
+         handle->stats.dropped++;
+         return true;
+      }
 
-      slock_lock(handle->lock);
-      avail = FIFO_WRITE_AVAIL(handle->attr_fifo);
-      slock_unlock(handle->lock);
+      ffmpeg_wait_space(handle, handle->video_ring,
+            &handle->stats.video_waits, &handle->stats.video_wait_usec);
 
       if (!handle->alive)
          return false;
 
-      if (avail >= sizeof(*vid))
-         break;
-
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
-
-      slock_unlock(handle->cond_lock);
+      slot = (struct ffmpeg_video_slot*)
+         record_ring_acquire(handle->video_ring);
    }
 
-   slock_lock(handle->lock);
-
    /* Tightly pack our frame to conserve memory.
     * libretro tends to use a very large pitch.
     */
-   attr_data = *vid;
+   slot->attr         = *vid;
+   slot->attr.data    = NULL;
+   slot->repeats      = handle->video.repeats;
+   handle->video.repeats = 0;
 
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
+   if (slot->attr.is_dupe)
+      slot->attr.width = slot->attr.height = slot->attr.pitch = 0;
    else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
+      slot->attr.pitch = slot->attr.width * handle->video.pix_size;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+   pixels = FFMPEG_VIDEO_SLOT_DATA(slot);
 
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+   for (y = 0; y < slot->attr.height; y++, offset += vid->pitch)
+      memcpy(pixels + y * slot->attr.pitch,
+            (const uint8_t*)vid->data + offset, slot->attr.pitch);
 
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   handle->stats.frames++;
+   ffmpeg_publish(handle, handle->video_ring);
 
    return true;
 }
@@ -1173,6 +1335,7 @@ static bool ffmpeg_push_video(void *data,
 static bool ffmpeg_push_audio(void *data,
       const struct record_audio_data *audio_data)
 {
+   size_t pushed    = 0;
    ffmpeg_t *handle = (ffmpeg_t*)data;
 
    if (!handle || !audio_data)
@@ -1181,39 +1344,35 @@ static bool ffmpeg_push_audio(void *data,
    if (!handle->config.audio_enable)
       return true;
 
-   for (;;)
+   /* Audio is never dropped, large pushes span slots */
+   while (pushed < audio_data->frames)
    {
-      unsigned avail;
-
-      slock_lock(handle->lock);
-      avail = FIFO_WRITE_AVAIL(handle->audio_fifo);
-      slock_unlock(handle->lock);
+      size_t frames;
+      struct ffmpeg_audio_slot *slot;
 
       if (!handle->alive)
          return false;
 
-      if (avail >= audio_data->frames * handle->params.channels
-            * sizeof(int16_t))
-         break;
-
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
+      if (!(slot = (struct ffmpeg_audio_slot*)
+               record_ring_acquire(handle->audio_ring)))
       {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
+         ffmpeg_wait_space(handle, handle->audio_ring,
+               &handle->stats.audio_waits,
+               &handle->stats.audio_wait_usec);
+         continue;
       }
-      else
-         scond_signal(handle->cond);
 
-      slock_unlock(handle->cond_lock);
-   }
+      frames       = MIN(audio_data->frames - pushed,
+            FFMPEG_AUDIO_SLOT_FRAMES);
+      slot->frames = frames;
+      memcpy(FFMPEG_AUDIO_SLOT_DATA(slot),
+            (const int16_t*)audio_data->data
+            + pushed * handle->params.channels,
+            frames * handle->params.channels * sizeof(int16_t));
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, audio_data->data,
-         audio_data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+      pushed      += frames;
+      ffmpeg_publish(handle, handle->audio_ring);
+   }
 
    return true;
 }
@@ -1276,6 +1435,84 @@ static bool encode_video(ffmpeg_t *handle, AVFrame *frame)
    return true;
 }
 
+static void ffmpeg_sws_band_work(void *data)
+{
+   struct ff_sws_band *band = (struct ff_sws_band*)data;
+
+   sws_scale(band->sws, &band->in, &band->in_stride, 0, band->rows,
+         band->out, band->out_stride);
+}
+
+/* Converts @vid in bands of rows, when its height is
+ * not scaled and the output format has no palette, so
+ * that every band maps to whole output rows and chroma
+ * rows. Returns false when it cannot. */
+static bool ffmpeg_sws_scale_bands(ffmpeg_t *handle,
+      const struct record_video_data *vid, int flags)
+{
+   unsigned i, count;
+   int align;
+   struct ff_video_info *video    = &handle->video;
+   AVFrame *frame                 = video->conv_frame;
+   const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(video->pix_fmt);
+
+   if (     !video->sws_band_count
+         || !desc
+         || vid->height != handle->params.out_height
+         || (desc->flags & AV_PIX_FMT_FLAG_PAL))
+      return false;
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+   if (desc->flags & AV_PIX_FMT_FLAG_PSEUDOPAL)
+      return false;
+#endif
+
+   align = 1 << desc->log2_chroma_h;
+   count = MIN(video->sws_band_count,
+         vid->height / FFMPEG_MIN_SWS_BAND_ROWS);
+
+   if (count < 2)
+      return false;
+
+   for (i = 0; i < count; i++)
+   {
+      unsigned p;
+      struct ff_sws_band *band = &video->sws_bands[i];
+      int first                = (int)(vid->height * i / count)
+         & ~(align - 1);
+      int last                 = (i + 1 == count) ? (int)vid->height
+         : (int)(vid->height * (i + 1) / count) & ~(align - 1);
+
+      band->rows      = last - first;
+      band->sws       = sws_getCachedContext(band->sws,
+            vid->width, band->rows, video->in_pix_fmt,
+            handle->params.out_width, band->rows, video->pix_fmt,
+            flags, NULL, NULL, NULL);
+      band->in        = (const uint8_t*)vid->data + first * vid->pitch;
+      band->in_stride = vid->pitch;
+
+      for (p = 0; p < 4; p++)
+      {
+         /* Planes 1 and 2 are chroma in every planar format */
+         int shift          = (p == 1 || p == 2) ? desc->log2_chroma_h : 0;
+         band->out[p]       = frame->data[p] ? frame->data[p]
+            + (first >> shift) * frame->linesize[p] : NULL;
+         band->out_stride[p] = frame->linesize[p];
+      }
+
+      if (!band->sws)
+         return false;
+   }
+
+   for (i = 0; i < count; i++)
+      if (     i + 1 == count
+            || !tpool_add_work(video->sws_pool, ffmpeg_sws_band_work,
+               &video->sws_bands[i]))
+         ffmpeg_sws_band_work(&video->sws_bands[i]);
+
+   tpool_wait(video->sws_pool);
+   return true;
+}
+
 static void ffmpeg_scale_input(ffmpeg_t *handle,
       const struct record_video_data *vid)
 {
@@ -1286,12 +1523,15 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
    if (handle->video.use_sws)
    {
       int linesize      = vid->pitch;
+      int flags         = shrunk ? SWS_BILINEAR : SWS_POINT;
+
+      if (ffmpeg_sws_scale_bands(handle, vid, flags))
+         return;
 
       handle->video.sws = sws_getCachedContext(handle->video.sws,
             vid->width, vid->height, handle->video.in_pix_fmt,
             handle->params.out_width, handle->params.out_height,
-            handle->video.pix_fmt,
-            shrunk ? SWS_BILINEAR : SWS_POINT, NULL, NULL, NULL);
+            handle->video.pix_fmt, flags, NULL, NULL, NULL);
 
       sws_scale(handle->video.sws, (const uint8_t* const*)&vid->data,
             &linesize, 0, vid->height, handle->video.conv_frame->data,
@@ -1311,18 +1551,98 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
             shrunk);
 }
 
-static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
+static bool ffmpeg_encode_frame(ffmpeg_t *handle, AVFrame *frame)
+{
+   frame->pts = handle->video.frame_cnt;
+
+   if (!encode_video(handle, frame))
+      return false;
+
+   handle->video.frame_cnt++;
+   return true;
+}
+
+/* Whether a frame can be handed to the encoder straight
+ * from its ring slot */
+static bool ffmpeg_video_passthrough(ffmpeg_t *handle,
       const struct record_video_data *vid)
 {
-   if (!vid->is_dupe)
-      ffmpeg_scale_input(handle, vid);
+   return handle->video.pass_frame
+      && vid->width  == handle->params.out_width
+      && vid->height == handle->params.out_height;
+}
 
-   handle->video.conv_frame->pts = handle->video.frame_cnt;
+/* Encodes the oldest frame queued that was not encoded
+ * yet, straight from its slot.
+ *
+ * A frame sent to the encoder as is stays in its slot
+ * until the next one comes, which may be a dupe, or
+ * follow frames that were dropped, of it.
+ *
+ * Returns: false when there was none. */
+static bool ffmpeg_pop_video(ffmpeg_t *handle)
+{
+   unsigned i;
+   struct record_video_data vid;
+   struct ff_video_info *video     = &handle->video;
+   unsigned release                = video->held;
+   AVFrame *last                   = video->held
+      ? video->pass_frame : video->conv_frame;
+   struct ffmpeg_video_slot *slot  = (struct ffmpeg_video_slot*)
+      record_ring_peek(handle->video_ring, video->held);
 
-   if (!encode_video(handle, handle->video.conv_frame))
+   if (!slot)
       return false;
 
-   handle->video.frame_cnt++;
+   for (i = 0; i < slot->repeats; i++)
+      ffmpeg_encode_frame(handle, last);
+
+   vid      = slot->attr;
+   vid.data = FFMPEG_VIDEO_SLOT_DATA(slot);
+
+   if (vid.is_dupe)
+   {
+      /* Copies the held frame out, its slot goes along
+       * with this one */
+      if (video->held)
+      {
+         struct ffmpeg_video_slot *held = (struct ffmpeg_video_slot*)
+            record_ring_peek(handle->video_ring, 0);
+         struct record_video_data prev  = held->attr;
+
+         prev.data   = FFMPEG_VIDEO_SLOT_DATA(held);
+         ffmpeg_scale_input(handle, &prev);
+         video->held = 0;
+      }
+
+      ffmpeg_encode_frame(handle, video->conv_frame);
+      release++;
+   }
+   else if (ffmpeg_video_passthrough(handle, &vid))
+   {
+      AVFrame *frame      = video->pass_frame;
+
+      frame->data[0]      = (uint8_t*)vid.data;
+      frame->linesize[0]  = vid.pitch;
+      frame->width        = vid.width;
+      frame->height       = vid.height;
+      frame->format       = video->pix_fmt;
+
+      /* Non reference counted, the encoder copies what
+       * it keeps before returning */
+      ffmpeg_encode_frame(handle, frame);
+      video->held         = 1;
+   }
+   else
+   {
+      ffmpeg_scale_input(handle, &vid);
+      ffmpeg_encode_frame(handle, video->conv_frame);
+      video->held         = 0;
+      release++;
+   }
+
+   record_ring_release(handle->video_ring, release);
+   record_signal_notify(handle->space);
    return true;
 }
 
@@ -1578,89 +1898,79 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
    return true;
 }
 
-static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
-      size_t audio_buf_size)
+/* Encodes the oldest audio queued, straight from its slot.
+ * Returns false when there was none. */
+static bool ffmpeg_pop_audio(ffmpeg_t *handle)
 {
-   size_t avail = FIFO_READ_AVAIL(handle->audio_fifo);
+   struct record_audio_data aud;
+   struct ffmpeg_audio_slot *slot = (struct ffmpeg_audio_slot*)
+      record_ring_peek(handle->audio_ring, 0);
 
-   if (avail)
-   {
-      struct record_audio_data aud = {0};
+   if (!slot)
+      return false;
 
-      fifo_read(handle->audio_fifo, audio_buf, avail);
+   aud.data   = FFMPEG_AUDIO_SLOT_DATA(slot);
+   aud.frames = slot->frames;
 
-      aud.frames = avail / (sizeof(int16_t) * handle->params.channels);
-      aud.data = audio_buf;
+   ffmpeg_push_audio_thread(handle, &aud, true);
 
-      ffmpeg_push_audio_thread(handle, &aud, false);
+   record_ring_release(handle->audio_ring, 1);
+   record_signal_notify(handle->space);
+   return true;
+}
+
+static void ffmpeg_flush_audio(ffmpeg_t *handle)
+{
+   /* Encode the last, partial frame */
+   if (handle->audio.frames_in_buffer)
+   {
+      encode_audio(handle, false);
+      handle->audio.frame_cnt       += handle->audio.frames_in_buffer;
+      handle->audio.frames_in_buffer = 0;
    }
 
    encode_audio(handle, true);
-   }
+}
 
 static void ffmpeg_flush_video(ffmpeg_t *handle)
 {
-   encode_video(handle, NULL);
+   unsigned i;
+
+   /* Frames dropped after the last one queued */
+   for (i = 0; i < handle->video.repeats; i++)
+      ffmpeg_encode_frame(handle, handle->video.held
+            ? handle->video.pass_frame : handle->video.conv_frame);
+   handle->video.repeats = 0;
 
+   record_ring_release(handle->video_ring, handle->video.held);
+   handle->video.held    = 0;
+
+   encode_video(handle, NULL);
 }
 
 static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
-   void *audio_buf       = NULL;
-   bool did_work         = false;
-   void *video_buf       = av_malloc(2 * handle->params.fb_width *
-         handle->params.fb_height * handle->video.pix_size);
-   size_t audio_buf_size = handle->config.audio_enable ?
-      (handle->audio.codec->frame_size *
-       handle->params.channels * sizeof(int16_t)) : 0;
-
-   if (audio_buf_size)
-      audio_buf = av_malloc(audio_buf_size);
+   bool did_work = false;
+
    /* Try pushing data in an interleaving pattern to
     * ease the work of the muxer a bit. */
-
    do
    {
-      struct record_video_data attr_buf;
-
       did_work = false;
 
-      if (handle->config.audio_enable)
-      {
-         if (FIFO_READ_AVAIL(handle->audio_fifo) >= audio_buf_size)
-         {
-            struct record_audio_data aud = {0};
-
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
-            aud.frames = handle->audio.codec->frame_size;
-            aud.data   = audio_buf;
-            ffmpeg_push_audio_thread(handle, &aud, true);
-
-            did_work = true;
-         }
-      }
-
-      if (FIFO_READ_AVAIL(handle->attr_fifo) >= sizeof(attr_buf))
-      {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
+      if (handle->config.audio_enable && ffmpeg_pop_audio(handle))
+         did_work = true;
 
+      if (ffmpeg_pop_video(handle))
          did_work = true;
-      }
-   }while (did_work);
+   } while (did_work);
 
    /* Flush out last audio. */
    if (handle->config.audio_enable)
-      ffmpeg_flush_audio(handle, audio_buf, audio_buf_size);
+      ffmpeg_flush_audio(handle);
 
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
-
-   av_free(video_buf);
-   av_free(audio_buf);
 }
 
 static bool ffmpeg_finalize(void *data)
@@ -1676,6 +1986,17 @@ static bool ffmpeg_finalize(void *data)
 
    deinit_thread_buf(handle);
 
+   RARCH_LOG("[FFmpeg]: %u frames queued, %u dropped, "
+         "up to %u of %u slots in use.\n",
+         handle->stats.frames, handle->stats.dropped,
+         handle->stats.max_queued, MAX_FRAMES);
+   RARCH_LOG("[FFmpeg]: Waited on the encoder %u times for video "
+         "(%.1f ms), %u times for audio (%.1f ms).\n",
+         handle->stats.video_waits,
+         handle->stats.video_wait_usec / 1000.0,
+         handle->stats.audio_waits,
+         handle->stats.audio_wait_usec / 1000.0);
+
    /* Write final data. */
    av_write_trailer(handle->muxer.ctx);
 
@@ -1684,84 +2005,32 @@ static bool ffmpeg_finalize(void *data)
    return true;
 }
 
-static void ffmpeg_thread(void *data)
+static bool ffmpeg_thread_ready(void *data)
 {
-   size_t audio_buf_size;
-   void *audio_buf = NULL;
-   ffmpeg_t *ff    = (ffmpeg_t*)data;
-   /* For some reason, FFmpeg has a tendency to crash
-    * if we don't overallocate a bit. */
-   void *video_buf = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
+   ffmpeg_t *ff = (ffmpeg_t*)data;
 
-   retro_assert(video_buf);
+   return !ff->alive
+      || record_ring_peek(ff->video_ring, ff->video.held)
+      || (ff->config.audio_enable && record_ring_peek(ff->audio_ring, 0));
+}
 
-   audio_buf_size = ff->config.audio_enable ?
-      (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
-   audio_buf      = audio_buf_size ? av_malloc(audio_buf_size) : NULL;
+static void ffmpeg_thread(void *data)
+{
+   ffmpeg_t *ff = (ffmpeg_t*)data;
 
    while (ff->alive)
    {
-      struct record_video_data attr_buf;
-
-      bool avail_video = false;
-      bool avail_audio = false;
-
-      slock_lock(ff->lock);
-      if (FIFO_READ_AVAIL(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
-
-      if (ff->config.audio_enable)
-         if (FIFO_READ_AVAIL(ff->audio_fifo) >= audio_buf_size)
-            avail_audio = true;
-      slock_unlock(ff->lock);
-
-      if (!avail_video && !avail_audio)
-      {
-         slock_lock(ff->cond_lock);
-         if (ff->can_sleep)
-         {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
-         }
-         else
-            scond_signal(ff->cond);
+      bool did_work = false;
 
-         slock_unlock(ff->cond_lock);
-      }
-
-      if (avail_video && video_buf)
-      {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
-      }
-
-      if (avail_audio && audio_buf)
-      {
-         struct record_audio_data aud = {0};
-
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
+      if (ffmpeg_pop_video(ff))
+         did_work = true;
 
-         aud.frames = ff->audio.codec->frame_size;
-         aud.data   = audio_buf;
+      if (ff->config.audio_enable && ffmpeg_pop_audio(ff))
+         did_work = true;
 
-         ffmpeg_push_audio_thread(ff, &aud, true);
-      }
+      if (!did_work)
+         record_signal_wait(ff->work, ffmpeg_thread_ready, ff);
    }
-
-   av_free(video_buf);
-   av_free(audio_buf);
 }
 
 const record_driver_t record_ffmpeg = {
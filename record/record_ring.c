@@ -0,0 +1,233 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memalign.h>
+#include <retro_atomic.h>
+#include <rthreads/rthreads.h>
+
+#include "record_ring.h"
+
+#define RECORD_RING_ALIGN 64
+
+/* Waiters announce themselves before checking the rings
+ * and producers publish before checking for waiters, with
+ * sequentially consistent accesses, so one of the two
+ * always sees the other. */
+#ifndef RETRO_ATOMIC_LOCK_FREE
+/* Indices go through the ring lock, and notifying
+ * always takes the signal lock */
+#define RECORD_RING_LOCKED
+#endif
+
+struct record_ring
+{
+   uint8_t *slots;
+#ifdef RECORD_RING_LOCKED
+   slock_t *lock;
+#endif
+   size_t slot_size;
+   unsigned mask;
+   /* Written by the producer only */
+   retro_atomic_uint_t head;
+   /* Written by the consumer only */
+   retro_atomic_uint_t tail;
+};
+
+struct record_signal
+{
+   slock_t *lock;
+   scond_t *cond;
+   retro_atomic_uint_t waiting;
+};
+
+#ifdef RECORD_RING_LOCKED
+static unsigned record_ring_get(record_ring_t *ring,
+      retro_atomic_uint_t *p)
+{
+   unsigned v;
+   slock_lock(ring->lock);
+   v = *p;
+   slock_unlock(ring->lock);
+   return v;
+}
+
+static void record_ring_set(record_ring_t *ring,
+      retro_atomic_uint_t *p, unsigned v)
+{
+   slock_lock(ring->lock);
+   *p = v;
+   slock_unlock(ring->lock);
+}
+#else
+#define record_ring_get(ring, p)    retro_atomic_load(p)
+#define record_ring_set(ring, p, v) retro_atomic_store(p, v)
+#endif
+
+record_ring_t *record_ring_new(unsigned slots, size_t slot_size)
+{
+   size_t size;
+   record_ring_t *ring = NULL;
+
+   if (!slots || (slots & (slots - 1)))
+      return NULL;
+
+   if (!(ring = (record_ring_t*)calloc(1, sizeof(*ring))))
+      return NULL;
+
+   ring->slot_size = (slot_size + RECORD_RING_ALIGN - 1)
+      & ~(size_t)(RECORD_RING_ALIGN - 1);
+   ring->mask      = slots - 1;
+   size            = ring->slot_size * slots;
+
+   if (!(ring->slots = (uint8_t*)memalign_alloc(RECORD_RING_ALIGN, size)))
+   {
+      free(ring);
+      return NULL;
+   }
+   memset(ring->slots, 0, size);
+
+#ifdef RECORD_RING_LOCKED
+   if (!(ring->lock = slock_new()))
+   {
+      record_ring_free(ring);
+      return NULL;
+   }
+#endif
+
+   return ring;
+}
+
+void record_ring_free(record_ring_t *ring)
+{
+   if (!ring)
+      return;
+
+#ifdef RECORD_RING_LOCKED
+   if (ring->lock)
+      slock_free(ring->lock);
+#endif
+   memalign_free(ring->slots);
+   free(ring);
+}
+
+void *record_ring_acquire(record_ring_t *ring)
+{
+   unsigned head = (unsigned)ring->head;
+
+   if (head - record_ring_get(ring, &ring->tail) > ring->mask)
+      return NULL;
+
+   return ring->slots + (head & ring->mask) * ring->slot_size;
+}
+
+void record_ring_publish(record_ring_t *ring)
+{
+   /* Makes the slot contents visible along with the new head */
+   record_ring_set(ring, &ring->head, (unsigned)ring->head + 1);
+}
+
+void *record_ring_peek(record_ring_t *ring, unsigned n)
+{
+   unsigned tail = (unsigned)ring->tail;
+
+   if (record_ring_get(ring, &ring->head) - tail <= n)
+      return NULL;
+
+   return ring->slots + ((tail + n) & ring->mask) * ring->slot_size;
+}
+
+void record_ring_release(record_ring_t *ring, unsigned n)
+{
+   if (n)
+      record_ring_set(ring, &ring->tail, (unsigned)ring->tail + n);
+}
+
+unsigned record_ring_count(record_ring_t *ring)
+{
+   unsigned tail = record_ring_get(ring, &ring->tail);
+   return record_ring_get(ring, &ring->head) - tail;
+}
+
+unsigned record_ring_size(const record_ring_t *ring)
+{
+   return ring->mask + 1;
+}
+
+record_signal_t *record_signal_new(void)
+{
+   record_signal_t *signal = (record_signal_t*)calloc(1, sizeof(*signal));
+
+   if (!signal)
+      return NULL;
+
+   signal->lock = slock_new();
+   signal->cond = scond_new();
+
+   if (!signal->lock || !signal->cond)
+   {
+      record_signal_free(signal);
+      return NULL;
+   }
+
+   return signal;
+}
+
+void record_signal_free(record_signal_t *signal)
+{
+   if (!signal)
+      return;
+
+   if (signal->lock)
+      slock_free(signal->lock);
+   if (signal->cond)
+      scond_free(signal->cond);
+   free(signal);
+}
+
+void record_signal_wait(record_signal_t *signal,
+      record_signal_ready_t ready, void *data)
+{
+   slock_lock(signal->lock);
+   retro_atomic_store(&signal->waiting, 1);
+   while (!ready(data))
+      scond_wait(signal->cond, signal->lock);
+   retro_atomic_store(&signal->waiting, 0);
+   slock_unlock(signal->lock);
+}
+
+void record_signal_notify(record_signal_t *signal)
+{
+#ifndef RECORD_RING_LOCKED
+   if (!retro_atomic_load(&signal->waiting))
+      return;
+#endif
+
+   /* The waiter is either asleep or still holds the lock
+    * and will see the change when it checks again */
+   slock_lock(signal->lock);
+   scond_signal(signal->cond);
+   slock_unlock(signal->lock);
+}
+
+void record_signal_broadcast(record_signal_t *signal)
+{
+   slock_lock(signal->lock);
+   scond_broadcast(signal->cond);
+   slock_unlock(signal->lock);
+}
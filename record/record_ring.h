@@ -0,0 +1,94 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RECORD_RING_H
+#define _RECORD_RING_H
+
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Hands recorded frames from the main thread over to an
+ * encoder thread.
+ *
+ * A ring is a fixed number of pre-allocated slots, filled
+ * in place by a single producer and read in place by a
+ * single consumer, neither of which takes a lock to do so.
+ * The consumer may keep slots it has read for as long as it
+ * likes, and gives them back oldest first.
+ *
+ * A signal is where either side sleeps when the other one
+ * has nothing for it. Notifying it only costs a lock when
+ * something is actually asleep on it. */
+
+typedef struct record_ring record_ring_t;
+typedef struct record_signal record_signal_t;
+
+/* Checked with the signal lock held, must not block */
+typedef bool (*record_signal_ready_t)(void *data);
+
+/**
+ * record_ring_new:
+ * @slots               : Number of slots, a power of two.
+ * @slot_size           : Size of a slot in bytes.
+ *
+ * Slots are zeroed and aligned on cache lines.
+ *
+ * Returns: ring, NULL on allocation failure.
+ **/
+record_ring_t *record_ring_new(unsigned slots, size_t slot_size);
+
+void record_ring_free(record_ring_t *ring);
+
+/* Producer. The next slot to fill, NULL when the ring is full.
+ * Does not take it: call again after a wait. */
+void *record_ring_acquire(record_ring_t *ring);
+
+/* Producer. Hands the slot from record_ring_acquire() over */
+void record_ring_publish(record_ring_t *ring);
+
+/* Consumer. The @n-th oldest slot published, NULL when there
+ * are not that many */
+void *record_ring_peek(record_ring_t *ring, unsigned n);
+
+/* Consumer. Gives the @n oldest slots back to the producer */
+void record_ring_release(record_ring_t *ring, unsigned n);
+
+/* Slots published and not released yet */
+unsigned record_ring_count(record_ring_t *ring);
+
+unsigned record_ring_size(const record_ring_t *ring);
+
+record_signal_t *record_signal_new(void);
+
+void record_signal_free(record_signal_t *signal);
+
+/* Sleeps until @ready returns true */
+void record_signal_wait(record_signal_t *signal,
+      record_signal_ready_t ready, void *data);
+
+/* Wakes a waiter up after a ring changed */
+void record_signal_notify(record_signal_t *signal);
+
+/* Wakes a waiter up after anything else @ready looks at,
+ * such as a flag telling it to stop, changed */
+void record_signal_broadcast(record_signal_t *signal);
+
+RETRO_END_DECLS
+
+#endif
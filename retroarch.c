@@ -167,6 +167,9 @@
 #include "msg_hash.h"
 #include "paths.h"
 #include "file_path_special.h"
+#include "frame_telemetry.h"
+#include "startup_trace.h"
+#include "benchmark.h"
 #include "ui/ui_companion_driver.h"
 #include "verbosity.h"
 
@@ -277,7 +280,10 @@ enum
    RA_OPT_MAX_FRAMES_SCREENSHOT_PATH,
    RA_OPT_SET_SHADER,
    RA_OPT_ACCESSIBILITY,
-   RA_OPT_LOAD_MENU_ON_ERROR
+   RA_OPT_LOAD_MENU_ON_ERROR,
+   RA_OPT_STARTUP_TRACE,
+   RA_OPT_BENCHMARK,
+   RA_OPT_BENCHMARK_CRC
 };
 
 /* DRIVERS */
@@ -2291,6 +2297,7 @@ bool command_event(enum event_command cmd, void *data)
             if (!string_is_empty(dir_libretro))
             {
                bool cache_supported = false;
+               int trace_phase      = startup_trace_begin("core_info_init");
 
                core_info_init_list(path_libretro_info,
                      dir_libretro,
@@ -2299,6 +2306,8 @@ bool command_event(enum event_command cmd, void *data)
                      core_info_cache_enable,
                      &cache_supported);
 
+               startup_trace_end(trace_phase);
+
                /* If core info cache is enabled but cache
                 * functionality is unsupported (i.e. because
                 * the core info directory is on read-only
@@ -3674,6 +3683,7 @@ void main_exit(void *args)
    {
       RARCH_LOG("[PERF]: Performance counters (RetroArch):\n");
       runloop_log_counters(p_rarch->perf_counters_rarch, p_rarch->perf_ptr_rarch);
+      frame_telemetry_log();
    }
 
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
@@ -3760,6 +3770,7 @@ int rarch_main(int argc, char *argv[], void *data)
    }
 #endif
 
+   startup_trace_init();
    rtime_init();
 
 #if defined(ANDROID)
@@ -3799,19 +3810,25 @@ int rarch_main(int argc, char *argv[], void *data)
    if (frontend_state_get_ptr()->current_frontend_ctx)
    {
       content_ctx_info_t info;
+      bool ret;
+      int trace_phase      = startup_trace_begin("content_load");
 
       info.argc            = argc;
       info.argv            = argv;
       info.args            = data;
       info.environ_get     = frontend_state_get_ptr()->current_frontend_ctx->environment_get;
 
-      if (!task_push_load_content_from_cli(
-               NULL,
-               NULL,
-               &info,
-               CORE_TYPE_PLAIN,
-               NULL,
-               NULL))
+      ret                  = task_push_load_content_from_cli(
+            NULL,
+            NULL,
+            &info,
+            CORE_TYPE_PLAIN,
+            NULL,
+            NULL);
+
+      startup_trace_end(trace_phase);
+
+      if (!ret)
          return 1;
    }
 
@@ -3844,7 +3861,7 @@ int rarch_main(int argc, char *argv[], void *data)
    main_exit(data);
 #endif
 
-   return 0;
+   return benchmark_exit_status();
 }
 
 #if defined(EMSCRIPTEN)
@@ -4151,7 +4168,7 @@ static void retroarch_print_help(const char *arg0)
           "the device (1 to %d).\n", MAX_USERS);
 
    {
-      char buf[2560];
+      char buf[3072];
       buf[0] = '\0';
       strlcpy(buf, "                        Format is PORT:ID, where ID is a number "
             "corresponding to the particular device.\n", sizeof(buf));
@@ -4217,6 +4234,13 @@ static void retroarch_print_help(const char *arg0)
 #endif
       strlcat(buf, "      --load-menu-on-error\n"
             "                        Open menu instead of quitting if specified core or content fails to load.\n", sizeof(buf));
+      strlcat(buf, "      --startup-trace=FILE\n"
+            "                        Writes a timeline of startup phases to FILE.\n", sizeof(buf));
+      strlcat(buf, "      --benchmark       Runs headless and unthrottled on the null drivers, then\n"
+            "                        reports time spent per frame stage on exit.\n"
+            "                        Use with --max-frames and/or a BSV movie.\n", sizeof(buf));
+      strlcat(buf, "      --benchmark-crc=CRC\n"
+            "                        Fails unless the final savestate has this CRC32.\n", sizeof(buf));
       strlcat(buf, "  -e, --entryslot=NUMBER\n"
             "                        Slot from which to load an entry state\n", sizeof(buf));
       puts(buf);
@@ -4307,6 +4331,9 @@ static bool retroarch_parse_input_and_config(
       { "log-file",           1, NULL, RA_OPT_LOG_FILE },
       { "accessibility",      0, NULL, RA_OPT_ACCESSIBILITY},
       { "load-menu-on-error", 0, NULL, RA_OPT_LOAD_MENU_ON_ERROR },
+      { "startup-trace",      1, NULL, RA_OPT_STARTUP_TRACE },
+      { "benchmark",          0, NULL, RA_OPT_BENCHMARK },
+      { "benchmark-crc",      1, NULL, RA_OPT_BENCHMARK_CRC },
       { "entryslot",          1, NULL, 'e' },
       { NULL, 0, NULL, 0 }
    };
@@ -4878,6 +4905,43 @@ static bool retroarch_parse_input_and_config(
             case RA_OPT_LOAD_MENU_ON_ERROR:
                global->cli_load_menu_on_error = true;
                break;
+            case RA_OPT_STARTUP_TRACE:
+               startup_trace_set_path(optarg);
+               break;
+            case RA_OPT_BENCHMARK:
+               benchmark_enable();
+
+               /* Nothing may wait on a display or an audio
+                * device, and the overridden drivers must not
+                * end up in the user's config */
+               configuration_set_string(settings,
+                     settings->arrays.video_driver, "null");
+               configuration_set_string(settings,
+                     settings->arrays.audio_driver, "null");
+               configuration_set_string(settings,
+                     settings->arrays.input_driver, "null");
+               configuration_set_bool(settings,
+                     settings->bools.video_vsync, false);
+               configuration_set_bool(settings,
+                     settings->bools.video_threaded, false);
+               configuration_set_bool(settings,
+                     settings->bools.vrr_runloop_enable, false);
+               configuration_set_bool(settings,
+                     settings->bools.audio_sync, false);
+               configuration_set_uint(settings,
+                     settings->uints.video_frame_delay, 0);
+               configuration_set_bool(settings,
+                     settings->bools.video_frame_delay_auto, false);
+               configuration_set_bool(settings,
+                     settings->bools.config_save_on_exit, false);
+#ifdef HAVE_BSV_MOVIE
+               input_state_get_ptr()->bsv_movie_state.eof_exit = true;
+#endif
+               break;
+            case RA_OPT_BENCHMARK_CRC:
+               benchmark_set_expected_crc(
+                     (uint32_t)strtoul(optarg, NULL, 16));
+               break;
             case 'e':
                {
                   unsigned entry_state_slot = (unsigned)strtoul(optarg, NULL, 0);
@@ -5006,6 +5070,8 @@ bool retroarch_main_init(int argc, char *argv[])
 #endif
    bool verbosity_enabled       = false;
    bool           init_failed   = false;
+   int trace_main               = startup_trace_begin("retroarch_main_init");
+   int trace_phase              = -1;
    struct rarch_state *p_rarch  = &rarch_st;
    runloop_state_t *runloop_st  = runloop_state_get_ptr();
    input_driver_state_t 
@@ -5041,8 +5107,10 @@ bool retroarch_main_init(int argc, char *argv[])
    /* Have to initialise non-file logging once at the start... */
    retro_main_log_file_init(NULL, false);
 
+   trace_phase       = startup_trace_begin("config_load");
    verbosity_enabled = retroarch_parse_input_and_config(p_rarch,
          global_get_ptr(), argc, argv);
+   startup_trace_end(trace_phase);
 
 #ifdef HAVE_ACCESSIBILITY
    accessibility_enable                = settings->bools.accessibility_enable;
@@ -5169,6 +5237,7 @@ bool retroarch_main_init(int argc, char *argv[])
     * Attempts to find a default driver for
     * all driver types.
     */
+   trace_phase = startup_trace_begin("drivers_find");
    if (!(audio_driver_find_driver(settings,
          "audio driver", verbosity_enabled)))
       retroarch_fail(1, "audio_driver_find()");
@@ -5198,11 +5267,14 @@ bool retroarch_main_init(int argc, char *argv[])
          retroarch_fail(1, "menu_driver_find_driver()");
    }
 #endif
+   startup_trace_end(trace_phase);
+
    /* Enforce stored brightness if needed */
    if (frontend_driver_can_set_screen_brightness())
       frontend_driver_set_screen_brightness(settings->uints.screen_brightness);
 
    /* Attempt to initialize core */
+   trace_phase = startup_trace_begin("core_init");
    if (runloop_st->has_set_core)
    {
       runloop_st->has_set_core = false;
@@ -5213,6 +5285,7 @@ bool retroarch_main_init(int argc, char *argv[])
    else if (!command_event(CMD_EVENT_CORE_INIT,
             &runloop_st->current_core_type))
       init_failed = true;
+   startup_trace_end(trace_phase);
 
    /* Handle core initialization failure */
    if (init_failed)
@@ -5273,7 +5346,9 @@ bool retroarch_main_init(int argc, char *argv[])
 #endif
          );
 #endif
+   trace_phase = startup_trace_begin("drivers_init");
    drivers_init(settings, DRIVERS_CMD_ALL, verbosity_enabled);
+   startup_trace_end(trace_phase);
 #ifdef HAVE_COMMAND
    input_driver_deinit_command(input_st);
    input_driver_init_command(input_st, settings);
@@ -5320,9 +5395,13 @@ bool retroarch_main_init(int argc, char *argv[])
    }
 #endif
 
-#if defined(HAVE_AUDIOMIXER)
-   audio_driver_load_system_sounds();
-#endif
+   /* Work that is not required to present the first
+    * frame (e.g. menu sounds) is deferred until
+    * runloop_iterate() has shown it */
+   runloop_st->startup_deferred_pending = true;
+
+   frame_telemetry_reset();
+   startup_trace_end(trace_main);
 
    return true;
 
@@ -5330,6 +5409,12 @@ error:
    command_event(CMD_EVENT_CORE_DEINIT, NULL);
    runloop_st->is_inited         = false;
 
+   /* No frame will be shown, so write the trace
+    * now; it shows where initialisation stopped */
+   startup_trace_end(trace_main);
+   startup_trace_mark("init_failed");
+   startup_trace_finish();
+
    return false;
 }
 
@@ -5507,14 +5592,14 @@ bool retroarch_ctl(enum rarch_ctl_state state, void *data)
          {
             /* Note: The update_display() callback may read
              * core option values via RETRO_ENVIRONMENT_GET_VARIABLE.
-             * This will reset the 'options updated' flag.
-             * We therefore have to cache the current 'options updated'
-             * state and restore it after the update_display() function
+             * This will mark the current values as read.
+             * We therefore have to cache the current read generation
+             * and restore it after the update_display() function
              * returns */
-            bool values_updated  = runloop_st->core_options->updated;
-            bool display_updated = runloop_st->core_options_callback.update_display();
+            uint32_t read_generation = runloop_st->core_options->read_generation;
+            bool display_updated     = runloop_st->core_options_callback.update_display();
 
-            runloop_st->core_options->updated = values_updated;
+            runloop_st->core_options->read_generation = read_generation;
             return display_updated;
          }
          return false;
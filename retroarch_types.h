@@ -16,6 +16,7 @@
 
 #include "input/input_defines.h"
 #include "disk_control_interface.h"
+#include "memory_map.h"
 
 RETRO_BEGIN_DECLS
 
@@ -179,6 +180,8 @@ typedef struct rarch_memory_descriptor
 typedef struct rarch_memory_map
 {
    rarch_memory_descriptor_t *descriptors;
+   /* Guest address lookup over the descriptors */
+   memory_map_t map;
    unsigned num_descriptors;
 } rarch_memory_map_t;
 
@@ -353,6 +356,7 @@ typedef struct content_file_info
    size_t data_size;
    bool file_in_archive;
    bool persistent_data;
+   bool data_mapped; /* 'data' is a file mapping */
 } content_file_info_t;
 
 typedef struct content_file_list
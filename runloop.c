@@ -88,6 +88,7 @@
 #include <retro_assert.h>
 #include <retro_miscellaneous.h>
 #include <queues/message_queue.h>
+#include <queues/task_queue.h>
 #include <lists/dir_list.h>
 
 #ifdef EMSCRIPTEN
@@ -185,6 +186,9 @@
 #include "msg_hash.h"
 #include "paths.h"
 #include "file_path_special.h"
+#include "frame_telemetry.h"
+#include "benchmark.h"
+#include "startup_trace.h"
 #include "ui/ui_companion_driver.h"
 #include "verbosity.h"
 
@@ -1416,7 +1420,8 @@ bool runloop_environment_cb(unsigned cmd, void *data)
    if (cmd == RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE)
    {
       if (runloop_st->core_options)
-         *(bool*)data = runloop_st->core_options->updated;
+         *(bool*)data = core_option_manager_is_updated(
+               runloop_st->core_options);
       else
          *(bool*)data = false;
 
@@ -1458,10 +1463,10 @@ bool runloop_environment_cb(unsigned cmd, void *data)
             }
 
 #ifdef HAVE_RUNAHEAD
-            if (runloop_st->core_options->updated)
+            if (core_option_manager_is_updated(runloop_st->core_options))
                runloop_st->has_variable_update = true;
 #endif
-            runloop_st->core_options->updated = false;
+            core_option_manager_mark_read(runloop_st->core_options);
 
             if (core_option_manager_get_idx(runloop_st->core_options,
                   var->key, &opt_idx))
@@ -2766,6 +2771,7 @@ bool runloop_environment_cb(unsigned cmd, void *data)
 
             RARCH_LOG("[Environ]: SET_MEMORY_MAPS.\n");
             free((void*)system->mmaps.descriptors);
+            memory_map_free(&system->mmaps.map);
             system->mmaps.descriptors     = 0;
             system->mmaps.num_descriptors = 0;
             descriptors = (rarch_memory_descriptor_t*)
@@ -2783,6 +2789,19 @@ bool runloop_environment_cb(unsigned cmd, void *data)
 
             mmap_preprocess_descriptors(descriptors, mmaps->num_descriptors);
 
+            /* Earlier descriptors win, as with a sequential search */
+            for (i = 0; i < mmaps->num_descriptors; i++)
+               if (!memory_map_add_descriptor(&system->mmaps.map,
+                        &descriptors[i].core))
+                  break;
+            if (     i < mmaps->num_descriptors
+                  || !memory_map_build(&system->mmaps.map))
+            {
+               RARCH_WARN("[Environ]: Failed to index memory map, "
+                     "searching descriptors instead.\n");
+               memory_map_free(&system->mmaps.map);
+            }
+
             if (log_level != RETRO_LOG_DEBUG)
                break;
 
@@ -3516,6 +3535,7 @@ void runloop_system_info_free(void)
       free(sys_info->ports.data);
    if (sys_info->mmaps.descriptors)
       free((void *)sys_info->mmaps.descriptors);
+   memory_map_free(&sys_info->mmaps.map);
 
    sys_info->subsystem.data                           = NULL;
    sys_info->subsystem.size                           = 0;
@@ -5885,14 +5905,16 @@ bool core_options_remove_override(bool game_specific)
          {
             if (string_is_equal(option->vals->elems[j].data, entry->value))
             {
-               option->index = j;
+               if (option->index != j)
+               {
+                  option->index = j;
+                  core_option_manager_mark_changed(coreopts, i);
+               }
                break;
             }
          }
       }
 
-      coreopts->updated = true;
-
 #ifdef HAVE_CHEEVOS
       rcheevos_validate_config_settings();
 #endif
@@ -5958,9 +5980,12 @@ void core_options_reset(void)
       return;
 
    for (i = 0; i < coreopts->size; i++)
+   {
+      if (coreopts->opts[i].index == coreopts->opts[i].default_index)
+         continue;
       coreopts->opts[i].index = coreopts->opts[i].default_index;
-
-   coreopts->updated = true;
+      core_option_manager_mark_changed(coreopts, i);
+   }
 
 #ifdef HAVE_CHEEVOS
    rcheevos_validate_config_settings();
@@ -6480,7 +6505,13 @@ static enum runloop_state_enum runloop_check_state(
          bool quit_runloop           = false;
 #ifdef HAVE_SCREENSHOTS
          unsigned runloop_max_frames = runloop_st->max_frames;
+#endif
+
+         /* Needs the core to still be loaded */
+         if (benchmark_is_enabled())
+            benchmark_finish();
 
+#ifdef HAVE_SCREENSHOTS
          if ((runloop_max_frames != 0)
                && (frame_count >= runloop_max_frames)
                && runloop_st->max_frames_screenshot)
@@ -7157,8 +7188,9 @@ static enum runloop_state_enum runloop_check_state(
       {
 #ifdef HAVE_REWIND
          char s[128];
-         bool rewinding = false;
-         unsigned t     = 0;
+         bool rewinding            = false;
+         unsigned t                = 0;
+         retro_time_t rewind_start = frame_telemetry_begin();
 
          s[0]           = '\0';
 
@@ -7169,6 +7201,8 @@ static enum runloop_state_enum runloop_check_state(
                runloop_st->paused,
                s, sizeof(s), &t);
 
+         frame_telemetry_end(FRAME_TELEMETRY_REWIND, rewind_start);
+
 #if defined(HAVE_GFX_WIDGETS)
          if (widgets_active)
             video_st->widgets_rewinding = rewinding;
@@ -7332,6 +7366,32 @@ static enum runloop_state_enum runloop_check_state(
 
 
 
+/**
+ * runloop_startup_deferred_init:
+ *
+ * Initialises subsystems that are not needed to
+ * present the first frame, then closes the
+ * startup trace.
+ **/
+static void runloop_startup_deferred_init(runloop_state_t *runloop_st)
+{
+#if defined(HAVE_AUDIOMIXER)
+   int trace_phase                      = -1;
+#endif
+
+   runloop_st->startup_deferred_pending = false;
+
+   startup_trace_mark("first_frame");
+
+#if defined(HAVE_AUDIOMIXER)
+   trace_phase = startup_trace_begin("system_sounds");
+   audio_driver_load_system_sounds();
+   startup_trace_end(trace_phase);
+#endif
+
+   startup_trace_finish();
+}
+
 /**
  * runloop_iterate:
  *
@@ -7388,6 +7448,11 @@ int runloop_iterate(void)
    }
 #endif
 
+   if (runloop_st->startup_deferred_pending && video_st->frame_count)
+      runloop_startup_deferred_init(runloop_st);
+
+   frame_telemetry_iterate();
+
    if (runloop_st->frame_time.callback)
    {
       /* Updates frame timing if frame timing callback is in use by the core.
@@ -7502,10 +7567,7 @@ int runloop_iterate(void)
 #endif
 
 #ifdef HAVE_BSV_MOVIE
-   /* Used for rewinding while playback/record. */
-   if (input_st->bsv_movie_state_handle)
-      input_st->bsv_movie_state_handle->frame_pos[input_st->bsv_movie_state_handle->frame_ptr]
-         = intfstream_tell(input_st->bsv_movie_state_handle->file);
+   bsv_movie_begin_frame(input_st);
 #endif
 
    if (     camera_st->cb.caps
@@ -7637,6 +7699,8 @@ int runloop_iterate(void)
    }
 
    {
+      retro_time_t core_run_start       = frame_telemetry_begin();
+      retro_time_t target_usec          = 0;
 #ifdef HAVE_RUNAHEAD
       bool run_ahead_enabled            = settings->bools.run_ahead_enabled;
       unsigned run_ahead_num_frames     = settings->uints.run_ahead_frames;
@@ -7649,14 +7713,26 @@ int runloop_iterate(void)
 #endif
 
       if (want_runahead)
+      {
          do_runahead(
                runloop_st,
                run_ahead_num_frames,
                run_ahead_hide_warnings,
                run_ahead_secondary_instance);
+         frame_telemetry_end(FRAME_TELEMETRY_RUNAHEAD, core_run_start);
+      }
       else
 #endif
          core_run();
+
+      frame_telemetry_end(FRAME_TELEMETRY_CORE_RUN, core_run_start);
+
+      /* Frame pacing is only meaningful at normal speed */
+      if (     !runloop_st->slowmotion
+            && !runloop_st->fastmotion
+            && video_st->av_info.timing.fps > 0.0)
+         target_usec = (retro_time_t)(1000000.0 / video_st->av_info.timing.fps);
+      frame_telemetry_commit(target_usec);
    }
 
    /* Increment runtime tick counter after each call to
@@ -7697,16 +7773,7 @@ int runloop_iterate(void)
    }
 
 #ifdef HAVE_BSV_MOVIE
-   if (input_st->bsv_movie_state_handle)
-   {
-      input_st->bsv_movie_state_handle->frame_ptr    =
-         (input_st->bsv_movie_state_handle->frame_ptr + 1)
-         & input_st->bsv_movie_state_handle->frame_mask;
-
-      input_st->bsv_movie_state_handle->first_rewind =
-         !input_st->bsv_movie_state_handle->did_rewind;
-      input_st->bsv_movie_state_handle->did_rewind   = false;
-   }
+   bsv_movie_end_frame(input_st);
 #endif
 
 #ifdef HAVE_THREADS
@@ -8197,10 +8264,18 @@ bool core_unserialize(retro_ctx_serialize_info_t *info)
 
 bool core_serialize(retro_ctx_serialize_info_t *info)
 {
+   bool ret;
+   retro_time_t serialize_start;
    runloop_state_t *runloop_st  = &runloop_state;
-   if (!info || !runloop_st->current_core.retro_serialize(info->data, info->size))
+   if (!info)
       return false;
-   return true;
+   serialize_start = frame_telemetry_begin();
+   ret             = runloop_st->current_core.retro_serialize(
+         info->data, info->size);
+   /* Save state tasks may serialize from the task thread */
+   if (task_is_on_main_thread())
+      frame_telemetry_end(FRAME_TELEMETRY_SERIALIZE, serialize_start);
+   return ret;
 }
 
 bool core_serialize_size(retro_ctx_size_info_t *info)
@@ -271,6 +271,7 @@ struct runloop
    bool core_shutdown_initiated;
    bool core_running;
    bool perfcnt_enable;
+   bool startup_deferred_pending;
    bool game_options_active;
    bool folder_options_active;
    bool autosave;
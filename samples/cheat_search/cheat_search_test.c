@@ -0,0 +1,542 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Cheat search golden test and benchmark.
+ *
+ * Runs the same sequence of searches through the item
+ * by item search cheat_manager used to do (kept here as
+ * the reference, with one match byte per address) and
+ * through cheat_search_filter(), for every search size
+ * and byte order, and checks that both keep exactly the
+ * same candidates in the same order. Memory is split into
+ * regions of odd sizes so that items straddle them, and
+ * one run is big enough to be split across threads.
+ *
+ * Then times an 'equal' search over 32 MB of memory.
+ *
+ * Usage: ./cheat_search_test [-t threads] [-m megabytes] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <string/stdstring.h>
+
+#include "../../cheat_search.h"
+
+#define TEST_ROUNDS 10
+
+struct test_memory
+{
+   uint8_t *host;          /* regions back to back, padded */
+   uint8_t *prev;
+   uint8_t *matches;       /* reference: one byte per address */
+   uint32_t *bitset;
+   uint8_t **buf_list;
+   unsigned *size_list;
+   unsigned num_buffers;
+   unsigned total;
+   unsigned ref_num_matches;
+   unsigned num_matches;
+   memory_map_t map;
+};
+
+static uint32_t test_seed = 0x2545F491;
+
+static uint32_t test_rand(void)
+{
+   uint32_t x = test_seed;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   return test_seed = x;
+}
+
+/* cheat_manager_setup_search_meta() */
+static void test_search_meta(unsigned bitsize, unsigned *bytes_per_item,
+      unsigned *mask, unsigned *bits)
+{
+   switch (bitsize)
+   {
+      case 0: *bytes_per_item = 1; *bits = 1; *mask = 0x01;       break;
+      case 1: *bytes_per_item = 1; *bits = 2; *mask = 0x03;       break;
+      case 2: *bytes_per_item = 1; *bits = 4; *mask = 0x0F;       break;
+      case 3: *bytes_per_item = 1; *bits = 8; *mask = 0xFF;       break;
+      case 4: *bytes_per_item = 2; *bits = 8; *mask = 0xFFFF;     break;
+      case 5: *bytes_per_item = 4; *bits = 8; *mask = 0xFFFFFFFF; break;
+   }
+}
+
+static unsigned test_translate_address(struct test_memory *mem,
+      unsigned address, unsigned char **curr)
+{
+   unsigned i;
+   unsigned offset = 0;
+
+   for (i = 0; i < mem->num_buffers; i++)
+   {
+      if ((address >= offset) && (address < offset + mem->size_list[i]))
+      {
+         *curr = mem->buf_list[i];
+         break;
+      }
+      else
+         offset += mem->size_list[i];
+   }
+
+   return offset;
+}
+
+/* The search loop of cheat_manager_search(), only with
+ * the top bytes of 32-bit items made unsigned so that
+ * shifting them in does not overflow */
+static void test_reference_search(struct test_memory *mem,
+      const cheat_search_params_t *params)
+{
+   unsigned char *curr         = mem->buf_list[0];
+   unsigned char *prev         = mem->prev;
+   unsigned int idx            = 0;
+   unsigned int curr_val       = 0;
+   unsigned int prev_val       = 0;
+   unsigned int mask           = 0;
+   unsigned int bytes_per_item = 1;
+   unsigned int bits           = 8;
+   unsigned int offset         = 0;
+   bool big_endian             = params->big_endian;
+
+   test_search_meta(params->bit_size, &bytes_per_item, &mask, &bits);
+
+   for (idx = 0; idx < mem->total; idx = idx + bytes_per_item)
+   {
+      unsigned byte_part;
+
+      offset = test_translate_address(mem, idx, &curr);
+
+      switch (bytes_per_item)
+      {
+         case 2:
+            curr_val = big_endian ?
+               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
+               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
+            prev_val = big_endian ?
+               (*(prev + idx) * 256) + *(prev + idx + 1) :
+               *(prev + idx) + (*(prev + idx + 1) * 256);
+            break;
+         case 4:
+            curr_val = big_endian ?
+               ((unsigned)*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
+               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + ((unsigned)*(curr + idx + 3 - offset) * 256 * 256 * 256);
+            prev_val = big_endian ?
+               ((unsigned)*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
+               *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + ((unsigned)*(prev + idx + 3) * 256 * 256 * 256);
+            break;
+         case 1:
+         default:
+            curr_val = *(curr - offset + idx);
+            prev_val = *(prev + idx);
+            break;
+      }
+
+      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
+      {
+         unsigned int curr_subval = (curr_val >> (byte_part * bits)) & mask;
+         unsigned int prev_subval = (prev_val >> (byte_part * bits)) & mask;
+         unsigned int prev_match;
+
+         if (bits < 8)
+            prev_match = *(mem->matches + idx) & (mask << (byte_part * bits));
+         else
+            prev_match = *(mem->matches + idx);
+
+         if (prev_match > 0)
+         {
+            bool match = false;
+            switch (params->type)
+            {
+               case CHEAT_SEARCH_TYPE_EXACT:
+                  match = (curr_subval == params->value);
+                  break;
+               case CHEAT_SEARCH_TYPE_LT:
+                  match = (curr_subval < prev_subval);
+                  break;
+               case CHEAT_SEARCH_TYPE_GT:
+                  match = (curr_subval > prev_subval);
+                  break;
+               case CHEAT_SEARCH_TYPE_LTE:
+                  match = (curr_subval <= prev_subval);
+                  break;
+               case CHEAT_SEARCH_TYPE_GTE:
+                  match = (curr_subval >= prev_subval);
+                  break;
+               case CHEAT_SEARCH_TYPE_EQ:
+                  match = (curr_subval == prev_subval);
+                  break;
+               case CHEAT_SEARCH_TYPE_NEQ:
+                  match = (curr_subval != prev_subval);
+                  break;
+               case CHEAT_SEARCH_TYPE_EQPLUS:
+                  match = (curr_subval == prev_subval + params->value);
+                  break;
+               case CHEAT_SEARCH_TYPE_EQMINUS:
+                  match = (curr_subval == prev_subval - params->value);
+                  break;
+            }
+
+            if (!match)
+            {
+               if (bits < 8)
+                  *(mem->matches + idx) = *(mem->matches + idx) &
+                     ((~(mask << (byte_part * bits))) & 0xFF);
+               else
+                  memset(mem->matches + idx, 0, bytes_per_item);
+               if (mem->ref_num_matches > 0)
+                  mem->ref_num_matches--;
+            }
+         }
+      }
+   }
+}
+
+static void test_search(struct test_memory *mem,
+      const cheat_search_params_t *params, unsigned threads)
+{
+   size_t dropped = cheat_search_filter(params, &mem->map, mem->total,
+         mem->prev, mem->bitset, threads);
+
+   if (dropped < mem->num_matches)
+      mem->num_matches -= (unsigned)dropped;
+   else
+      mem->num_matches  = 0;
+
+   test_reference_search(mem, params);
+}
+
+/* Candidates in the order cheat_manager_add_matches() and
+ * cheat_manager_match_action() used to visit them */
+static bool test_compare(struct test_memory *mem, unsigned bit_size)
+{
+   unsigned idx;
+   unsigned mask, bits, bytes_per_item;
+   size_t num = cheat_search_num_candidates(bit_size, mem->total);
+   size_t n   = cheat_search_next(mem->bitset, num, 0);
+   size_t k   = 0;
+
+   test_search_meta(bit_size, &bytes_per_item, &mask, &bits);
+
+   if (mem->num_matches != mem->ref_num_matches)
+   {
+      fprintf(stderr, "num_matches %u, expected %u\n",
+            mem->num_matches, mem->ref_num_matches);
+      return false;
+   }
+
+   for (idx = 0; idx < mem->total; idx += bytes_per_item)
+   {
+      unsigned byte_part;
+
+      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
+      {
+         bool match = (bits < 8)
+            ? (mem->matches[idx] & (mask << (byte_part * bits))) != 0
+            : mem->matches[idx] != 0;
+         size_t expected = (idx / bytes_per_item) * (8 / bits) + byte_part;
+
+         if (!match)
+            continue;
+
+         /* cheat_search_nth() counts from the start every time,
+          * so only spot check it */
+         if (n != expected || ((k & (k - 1)) == 0
+                  && cheat_search_nth(mem->bitset, num, k) != n))
+         {
+            fprintf(stderr, "candidate %u: got %u, expected %u\n",
+                  (unsigned)k, (unsigned)n, (unsigned)expected);
+            return false;
+         }
+
+         n = cheat_search_next(mem->bitset, num, n + 1);
+         k++;
+      }
+   }
+
+   if (n != num || cheat_search_nth(mem->bitset, num, k) != num)
+   {
+      fprintf(stderr, "extra candidate %u\n", (unsigned)n);
+      return false;
+   }
+
+   return true;
+}
+
+static bool test_memory_init(struct test_memory *mem,
+      const unsigned *sizes, unsigned count, unsigned bit_size)
+{
+   unsigned i;
+   unsigned offset = 0;
+
+   memset(mem, 0, sizeof(*mem));
+
+   for (i = 0; i < count; i++)
+      mem->total += sizes[i];
+
+   mem->host      = (uint8_t*)calloc(mem->total + 4, 1);
+   mem->prev      = (uint8_t*)calloc(mem->total + 4, 1);
+   mem->matches   = (uint8_t*)malloc(mem->total + 4);
+   mem->bitset    = (uint32_t*)malloc(
+         cheat_search_bitset_words(bit_size, mem->total) * sizeof(uint32_t));
+   mem->buf_list  = (uint8_t**)calloc(count, sizeof(uint8_t*));
+   mem->size_list = (unsigned*)calloc(count, sizeof(unsigned));
+
+   if (!mem->host || !mem->prev || !mem->matches || !mem->bitset
+         || !mem->buf_list || !mem->size_list)
+      return false;
+
+   /* Few distinct values, so that searches keep candidates */
+   for (i = 0; i < mem->total; i++)
+      mem->host[i] = (uint8_t)(test_rand() & 0x13);
+
+   for (i = 0; i < count; i++)
+   {
+      mem->buf_list[i]  = mem->host + offset;
+      mem->size_list[i] = sizes[i];
+      if (!memory_map_add(&mem->map, offset, mem->buf_list[i], sizes[i], 0))
+         return false;
+      offset           += sizes[i];
+   }
+   mem->num_buffers = count;
+
+   memcpy(mem->prev, mem->host, mem->total);
+   memset(mem->matches, 0xFF, mem->total + 4);
+   cheat_search_bitset_fill(mem->bitset, bit_size, mem->total);
+   mem->num_matches     = (mem->total * 8) / (1 << bit_size);
+   mem->ref_num_matches = mem->num_matches;
+
+   return memory_map_build(&mem->map);
+}
+
+static void test_memory_free(struct test_memory *mem)
+{
+   memory_map_free(&mem->map);
+   free(mem->host);
+   free(mem->prev);
+   free(mem->matches);
+   free(mem->bitset);
+   free(mem->buf_list);
+   free(mem->size_list);
+}
+
+static void test_mutate(struct test_memory *mem)
+{
+   unsigned i;
+   unsigned changes = mem->total / 8;
+
+   for (i = 0; i < changes; i++)
+   {
+      uint32_t r     = test_rand();
+      unsigned where = (r >> 8) % mem->total;
+
+      switch (r & 3)
+      {
+         case 0:
+            mem->host[where]++;
+            break;
+         case 1:
+            mem->host[where]--;
+            break;
+         case 2:
+            mem->host[where] = (uint8_t)(r >> 24);
+            break;
+         default:
+            break;
+      }
+   }
+}
+
+static bool test_run(const unsigned *sizes, unsigned count,
+      unsigned bit_size, bool big_endian, unsigned threads,
+      unsigned switch_to)
+{
+   unsigned round;
+   struct test_memory mem;
+   cheat_search_params_t params;
+   bool ok = test_memory_init(&mem, sizes, count, bit_size);
+
+   params.bit_size   = bit_size;
+   params.big_endian = big_endian;
+
+   for (round = 0; ok && round < TEST_ROUNDS; round++)
+   {
+      /* Change the search size once, half way through */
+      if (switch_to != bit_size && round == TEST_ROUNDS / 2)
+      {
+         uint32_t *bitset = (uint32_t*)malloc(
+               cheat_search_bitset_words(switch_to, mem.total)
+               * sizeof(uint32_t));
+
+         if (!bitset)
+         {
+            ok = false;
+            break;
+         }
+
+         cheat_search_convert(mem.bitset, params.bit_size,
+               bitset, switch_to, mem.total);
+         free(mem.bitset);
+         mem.bitset      = bitset;
+         params.bit_size = switch_to;
+      }
+
+      test_mutate(&mem);
+
+      params.type = (enum cheat_search_type)
+         ((round + bit_size) % (CHEAT_SEARCH_TYPE_EQMINUS + 1));
+
+      switch (params.type)
+      {
+         case CHEAT_SEARCH_TYPE_EXACT:
+            params.value = mem.host[test_rand() % mem.total]
+               & ((bit_size < 3) ? (0xFF >> (8 - (1 << bit_size))) : 0xFF);
+            break;
+         case CHEAT_SEARCH_TYPE_EQPLUS:
+         case CHEAT_SEARCH_TYPE_EQMINUS:
+            /* Also try values that wrap at 32 bits */
+            params.value = (round & 1) ? 1 : 0xFFFFFFFF;
+            break;
+         default:
+            params.value = 0;
+            break;
+      }
+
+      test_search(&mem, &params, threads);
+      ok = test_compare(&mem, params.bit_size);
+
+      memcpy(mem.prev, mem.host, mem.total);
+   }
+
+   if (!ok)
+      fprintf(stderr, "FAILED: bit size %u, %s endian, %u regions, "
+            "%u threads, switch to %u\n",
+            bit_size, big_endian ? "big" : "little", count, threads,
+            switch_to);
+
+   test_memory_free(&mem);
+   return ok;
+}
+
+static void test_benchmark(unsigned megabytes, unsigned threads)
+{
+   unsigned i;
+   struct test_memory mem;
+   cheat_search_params_t params;
+   unsigned sizes[4];
+   retro_time_t start, usec_ref, usec_new;
+
+   for (i = 0; i < 4; i++)
+      sizes[i] = megabytes * 1024 * 256;
+
+   params.type       = CHEAT_SEARCH_TYPE_EQ;
+   params.value      = 0;
+   params.big_endian = false;
+
+   for (i = 3; i <= 5; i++)
+   {
+      params.bit_size = i;
+
+      if (!test_memory_init(&mem, sizes, 4, i))
+      {
+         test_memory_free(&mem);
+         return;
+      }
+
+      start    = cpu_features_get_time_usec();
+      test_reference_search(&mem, &params);
+      usec_ref = cpu_features_get_time_usec() - start;
+
+      start    = cpu_features_get_time_usec();
+      cheat_search_filter(&params, &mem.map, mem.total, mem.prev,
+            mem.bitset, threads);
+      usec_new = cpu_features_get_time_usec() - start;
+
+      printf("%u MB, %u-bit search: item by item %8.2f ms, "
+            "engine %7.2f ms (x%.0f), match storage %u KB -> %u KB\n",
+            megabytes, 8 << (i - 3), usec_ref / 1000.0,
+            usec_new / 1000.0,
+            usec_new ? (double)usec_ref / usec_new : 0.0,
+            mem.total / 1024,
+            (unsigned)(cheat_search_bitset_words(i, mem.total) * 4 / 1024));
+
+      test_memory_free(&mem);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned bit_size;
+   unsigned threads   = 4;
+   unsigned megabytes = 32;
+   unsigned failed    = 0;
+   unsigned runs      = 0;
+   /* Odd sizes, so that items straddle regions */
+   static const unsigned small[] = { 4099, 1, 3, 2050, 8191, 6 };
+   static const unsigned large[] = { 3 * 1024 * 1024 + 2, 2 * 1024 * 1024 + 5 };
+
+   for (i = 1; i < argc; i++)
+   {
+      if (string_is_equal(argv[i], "-t") && i + 1 < argc)
+         threads   = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (string_is_equal(argv[i], "-m") && i + 1 < argc)
+         megabytes = (unsigned)strtoul(argv[++i], NULL, 0);
+      else
+         break;
+   }
+
+   if (i < argc || !threads || !megabytes)
+   {
+      fprintf(stderr, "Usage: %s [-t threads] [-m megabytes]\n", argv[0]);
+      return 1;
+   }
+
+   for (bit_size = 0; bit_size <= 5; bit_size++)
+   {
+      unsigned be;
+
+      for (be = 0; be < 2; be++)
+      {
+         unsigned to;
+
+         failed += !test_run(small, 6, bit_size, be != 0, 1, bit_size);
+         failed += !test_run(large, 2, bit_size, be != 0, threads, bit_size);
+         runs   += 2;
+
+         for (to = 0; to <= 5; to++)
+         {
+            if (to == bit_size)
+               continue;
+            failed += !test_run(small, 6, bit_size, be != 0, 1, to);
+            runs++;
+         }
+      }
+   }
+
+   printf("%u of %u golden runs passed.\n", runs - failed, runs);
+
+   if (!failed)
+      test_benchmark(megabytes, threads);
+
+   return failed ? 1 : 0;
+}
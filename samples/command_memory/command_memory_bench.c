@@ -0,0 +1,484 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Memory command benchmark client.
+ * Connects to a running RetroArch with network commands
+ * and their stream connections (network_cmd_stream_enable)
+ * enabled, and a core that exposes a memory map, and reads
+ * the same list of addresses over and over:
+ *
+ * - text:   one READ_CORE_MEMORY datagram per address, a
+ *           few dozen in flight, every hex reply parsed.
+ * - binary: one READ frame listing every address over the
+ *           TCP port, see command_protocol.h.
+ *
+ * Both return the same bytes, which is checked first.
+ * With -w, also subscribes to the addresses as a watch
+ * list and counts the CHANGED frames pushed per second.
+ *
+ * Usage: ./command_memory_bench [-h host] [-p port]
+ *           [-a address] [-s bytes] [-n reads] [-t seconds] [-w] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <string/stdstring.h>
+
+#include "../../command_protocol.h"
+
+#define BENCH_TIMEOUT_MS      2000
+#define BENCH_TEXT_IN_FLIGHT  64
+
+struct bench
+{
+   uint8_t *text_data;
+   uint8_t *binary_data;
+   uint8_t *frame;
+   uint8_t *reply;
+   const char *host;
+   struct sockaddr_storage udp_addr;
+   socklen_t udp_addr_len;
+   uint32_t address;
+   unsigned port;
+   unsigned size;
+   unsigned reads;
+   unsigned seconds;
+   int udp_fd;
+   int tcp_fd;
+};
+
+static void bench_put32(uint8_t *data, uint32_t value)
+{
+   data[0] = (uint8_t)(value);
+   data[1] = (uint8_t)(value >> 8);
+   data[2] = (uint8_t)(value >> 16);
+   data[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t bench_get32(const uint8_t *data)
+{
+   return  (uint32_t)data[0]        | ((uint32_t)data[1] << 8)
+         | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static bool bench_wait(int fd)
+{
+   struct pollfd pfd;
+   pfd.fd     = fd;
+   pfd.events = POLLIN;
+   return poll(&pfd, 1, BENCH_TIMEOUT_MS) > 0;
+}
+
+static bool bench_recv_all(int fd, void *data, size_t len)
+{
+   uint8_t *at = (uint8_t*)data;
+
+   while (len)
+   {
+      ssize_t ret;
+
+      if (!bench_wait(fd))
+         return false;
+      if ((ret = recv(fd, at, len, 0)) <= 0)
+         return false;
+
+      at  += ret;
+      len -= ret;
+   }
+
+   return true;
+}
+
+static bool bench_send_all(int fd, const void *data, size_t len)
+{
+   const uint8_t *at = (const uint8_t*)data;
+
+   while (len)
+   {
+      ssize_t ret = send(fd, at, len, MSG_NOSIGNAL);
+      if (ret <= 0)
+         return false;
+      at  += ret;
+      len -= ret;
+   }
+
+   return true;
+}
+
+static int bench_connect(struct bench *bench, int type)
+{
+   int fd = -1;
+   char port[16];
+   struct addrinfo hints, *res = NULL, *ai;
+
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_socktype = type;
+   snprintf(port, sizeof(port), "%u", bench->port);
+
+   if (getaddrinfo(bench->host, port, &hints, &res) != 0)
+      return -1;
+
+   for (ai = res; ai; ai = ai->ai_next)
+   {
+      if ((fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0)
+         continue;
+
+      if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+      {
+         if (type == SOCK_DGRAM)
+         {
+            memcpy(&bench->udp_addr, ai->ai_addr, ai->ai_addrlen);
+            bench->udp_addr_len = ai->ai_addrlen;
+         }
+         break;
+      }
+
+      close(fd);
+      fd = -1;
+   }
+
+   freeaddrinfo(res);
+   return fd;
+}
+
+/* Address of read number @i: consecutive items, wrapping
+ * after 4 KB so that everything stays in one descriptor */
+static uint32_t bench_address(const struct bench *bench, unsigned i)
+{
+   return bench->address + (i * bench->size) % 4096;
+}
+
+static bool bench_text_batch(struct bench *bench)
+{
+   unsigned sent    = 0;
+   unsigned replies = 0;
+
+   /* Datagrams are answered in order */
+   while (replies < bench->reads)
+   {
+      char buf[4096];
+      char *at;
+      unsigned j;
+      ssize_t ret;
+      uint8_t *out;
+
+      /* Keep few enough requests in flight that the
+       * socket buffers do not drop any */
+      for (; sent < bench->reads && sent - replies < BENCH_TEXT_IN_FLIGHT;
+            sent++)
+      {
+         char msg[64];
+         int len = snprintf(msg, sizeof(msg), "READ_CORE_MEMORY %x %u",
+               (unsigned)bench_address(bench, sent), bench->size);
+
+         if (send(bench->udp_fd, msg, len, 0) != len)
+            return false;
+      }
+
+      out = bench->text_data + replies * bench->size;
+
+      if (!bench_wait(bench->udp_fd))
+         return false;
+      if ((ret = recv(bench->udp_fd, buf, sizeof(buf) - 1, 0)) <= 0)
+         return false;
+      buf[ret] = '\0';
+
+      /* READ_CORE_MEMORY <address> <byte> <byte> ... */
+      if (!(at = strchr(buf, ' ')) || !(at = strchr(at + 1, ' ')))
+         return false;
+
+      for (j = 0; j < bench->size; j++)
+         out[j] = (uint8_t)strtoul(at, &at, 16);
+
+      replies++;
+   }
+
+   return true;
+}
+
+static bool bench_binary_batch(struct bench *bench)
+{
+   unsigned i;
+   uint32_t size;
+   const uint8_t *at;
+   uint8_t header[COMMAND_BINARY_HEADER_SIZE];
+   size_t frame_size = COMMAND_BINARY_HEADER_SIZE + bench->reads * 8;
+
+   bench->frame[0] = COMMAND_BINARY_OP_READ;
+   bench->frame[1] = 0;
+   bench->frame[2] = (uint8_t)(bench->reads);
+   bench->frame[3] = (uint8_t)(bench->reads >> 8);
+   bench_put32(bench->frame + 4, bench->reads * 8);
+
+   for (i = 0; i < bench->reads; i++)
+   {
+      bench_put32(bench->frame + COMMAND_BINARY_HEADER_SIZE + i * 8,
+            bench_address(bench, i));
+      bench_put32(bench->frame + COMMAND_BINARY_HEADER_SIZE + i * 8 + 4,
+            bench->size);
+   }
+
+   if (!bench_send_all(bench->tcp_fd, bench->frame, frame_size))
+      return false;
+
+   /* Skip CHANGED frames pushed in between */
+   do
+   {
+      if (!bench_recv_all(bench->tcp_fd, header, sizeof(header)))
+         return false;
+      size = bench_get32(header + 4);
+      if (size > COMMAND_BINARY_MAX_PAYLOAD
+            || !bench_recv_all(bench->tcp_fd, bench->reply, size))
+         return false;
+   } while (header[0] == COMMAND_BINARY_OP_CHANGED);
+
+   if (header[0] != COMMAND_BINARY_OP_READ
+         || header[1] != COMMAND_BINARY_STATUS_OK)
+   {
+      fprintf(stderr, "READ failed with status %u.\n", header[1]);
+      return false;
+   }
+
+   for (i = 0, at = bench->reply; i < bench->reads; i++)
+   {
+      uint32_t len = bench_get32(at);
+
+      if (len != bench->size)
+      {
+         fprintf(stderr, "Address %x is not readable.\n",
+               (unsigned)bench_address(bench, i));
+         return false;
+      }
+
+      memcpy(bench->binary_data + i * bench->size, at + 4, len);
+      at += 4 + len;
+   }
+
+   return true;
+}
+
+static bool bench_run(struct bench *bench, const char *name,
+      bool (*batch)(struct bench*))
+{
+   retro_time_t start = cpu_features_get_time_usec();
+   retro_time_t usec  = 0;
+   unsigned batches   = 0;
+
+   while (usec < (retro_time_t)bench->seconds * 1000000)
+   {
+      if (!batch(bench))
+      {
+         fprintf(stderr, "%s: no reply.\n", name);
+         return false;
+      }
+      batches++;
+      usec = cpu_features_get_time_usec() - start;
+   }
+
+   printf("%-6s %10.0f reads/s %8.1f batches/s %8.3f ms/batch\n", name,
+         (double)batches * bench->reads * 1000000.0 / usec,
+         (double)batches * 1000000.0 / usec,
+         usec / 1000.0 / batches);
+   return true;
+}
+
+static bool bench_watch(struct bench *bench)
+{
+   unsigned i;
+   unsigned frames = 0;
+   unsigned spans  = 0;
+   retro_time_t start;
+   uint8_t header[COMMAND_BINARY_HEADER_SIZE];
+
+   bench->frame[0] = COMMAND_BINARY_OP_WATCH;
+   bench->frame[1] = 0;
+   bench->frame[2] = (uint8_t)(bench->reads);
+   bench->frame[3] = (uint8_t)(bench->reads >> 8);
+   bench_put32(bench->frame + 4, bench->reads * 8);
+
+   for (i = 0; i < bench->reads; i++)
+   {
+      bench_put32(bench->frame + COMMAND_BINARY_HEADER_SIZE + i * 8,
+            bench_address(bench, i));
+      bench_put32(bench->frame + COMMAND_BINARY_HEADER_SIZE + i * 8 + 4,
+            bench->size);
+   }
+
+   if (!bench_send_all(bench->tcp_fd, bench->frame,
+            COMMAND_BINARY_HEADER_SIZE + bench->reads * 8))
+      return false;
+
+   start = cpu_features_get_time_usec();
+
+   while (cpu_features_get_time_usec() - start
+         < (retro_time_t)bench->seconds * 1000000)
+   {
+      uint32_t size;
+
+      if (!bench_recv_all(bench->tcp_fd, header, sizeof(header)))
+         break;
+      size = bench_get32(header + 4);
+      if (size > COMMAND_BINARY_MAX_PAYLOAD
+            || !bench_recv_all(bench->tcp_fd, bench->reply, size))
+         return false;
+
+      if (header[0] == COMMAND_BINARY_OP_WATCH)
+      {
+         if (header[1] != COMMAND_BINARY_STATUS_OK)
+         {
+            fprintf(stderr, "WATCH failed with status %u.\n", header[1]);
+            return false;
+         }
+         continue;
+      }
+
+      if (header[0] == COMMAND_BINARY_OP_CHANGED)
+      {
+         frames++;
+         spans += header[2] | (header[3] << 8);
+      }
+   }
+
+   printf("watch  %10.1f updates/s %8.1f changed spans/update\n",
+         frames * 1000000.0
+         / (cpu_features_get_time_usec() - start),
+         frames ? (double)spans / frames : 0.0);
+
+   /* Clear the watch list again */
+   bench->frame[0] = COMMAND_BINARY_OP_WATCH;
+   memset(bench->frame + 1, 0, COMMAND_BINARY_HEADER_SIZE - 1);
+   return bench_send_all(bench->tcp_fd, bench->frame,
+         COMMAND_BINARY_HEADER_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   char line[16];
+   struct bench bench;
+   bool watch = false;
+   bool ok    = false;
+
+   memset(&bench, 0, sizeof(bench));
+   bench.host    = "127.0.0.1";
+   bench.port    = 55355;
+   bench.address = 0;
+   bench.size    = 4;
+   bench.reads   = 256;
+   bench.seconds = 3;
+   bench.udp_fd  = -1;
+   bench.tcp_fd  = -1;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (string_is_equal(argv[i], "-h") && i + 1 < argc)
+         bench.host    = argv[++i];
+      else if (string_is_equal(argv[i], "-p") && i + 1 < argc)
+         bench.port    = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (string_is_equal(argv[i], "-a") && i + 1 < argc)
+         bench.address = (uint32_t)strtoul(argv[++i], NULL, 16);
+      else if (string_is_equal(argv[i], "-s") && i + 1 < argc)
+         bench.size    = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (string_is_equal(argv[i], "-n") && i + 1 < argc)
+         bench.reads   = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (string_is_equal(argv[i], "-t") && i + 1 < argc)
+         bench.seconds = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (string_is_equal(argv[i], "-w"))
+         watch         = true;
+      else
+         break;
+   }
+
+   /* Text replies must fit in one datagram */
+   if (i < argc || !bench.size || bench.size > 256 || !bench.reads
+         || bench.reads > 0xFFFF || !bench.seconds)
+   {
+      fprintf(stderr, "Usage: %s [-h host] [-p port] [-a address] "
+            "[-s bytes (1-256)] [-n reads] [-t seconds] [-w]\n", argv[0]);
+      return 1;
+   }
+
+   bench.text_data   = (uint8_t*)calloc(bench.reads, bench.size);
+   bench.binary_data = (uint8_t*)calloc(bench.reads, bench.size);
+   bench.frame       = (uint8_t*)malloc(COMMAND_BINARY_HEADER_SIZE
+         + bench.reads * 8);
+   bench.reply       = (uint8_t*)malloc(COMMAND_BINARY_MAX_PAYLOAD);
+
+   if (!bench.text_data || !bench.binary_data || !bench.frame || !bench.reply)
+      goto end;
+
+   if (     (bench.udp_fd = bench_connect(&bench, SOCK_DGRAM))  < 0
+         || (bench.tcp_fd = bench_connect(&bench, SOCK_STREAM)) < 0)
+   {
+      fprintf(stderr, "Could not connect to %s:%u.\n",
+            bench.host, bench.port);
+      goto end;
+   }
+
+   {
+      int on = 1;
+      setsockopt(bench.tcp_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+   }
+
+   if (     !bench_send_all(bench.tcp_fd, COMMAND_BINARY_MODE "\n",
+            STRLEN_CONST(COMMAND_BINARY_MODE "\n"))
+         || !bench_recv_all(bench.tcp_fd, line,
+            STRLEN_CONST("BINARY_MODE 1\n"))
+         || memcmp(line, "BINARY_MODE 1\n", STRLEN_CONST("BINARY_MODE 1\n")))
+   {
+      fprintf(stderr, "Binary mode not supported.\n");
+      goto end;
+   }
+
+   /* Memory may change between the two reads, so only
+    * compare when it holds still */
+   if (!bench_text_batch(&bench) || !bench_binary_batch(&bench))
+   {
+      fprintf(stderr, "No reply, is a core with a memory map running?\n");
+      goto end;
+   }
+
+   if (memcmp(bench.text_data, bench.binary_data, bench.reads * bench.size))
+      printf("Memory changed between text and binary reads.\n");
+
+   printf("%u reads of %u bytes per batch from %x\n",
+         bench.reads, bench.size, (unsigned)bench.address);
+
+   ok =     bench_run(&bench, "text",   bench_text_batch)
+         && bench_run(&bench, "binary", bench_binary_batch)
+         && (!watch || bench_watch(&bench));
+
+end:
+   if (bench.udp_fd >= 0)
+      close(bench.udp_fd);
+   if (bench.tcp_fd >= 0)
+      close(bench.tcp_fd);
+   free(bench.text_data);
+   free(bench.binary_data);
+   free(bench.frame);
+   free(bench.reply);
+   return ok ? 0 : 1;
+}
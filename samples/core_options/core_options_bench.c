@@ -0,0 +1,298 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Core option lookup benchmark.
+ * Replays a trace of RETRO_ENVIRONMENT_GET_VARIABLE
+ * keys against a core option manager and compares
+ * core_option_manager_get_idx() with a linear search.
+ *
+ * Without a trace file, a core with 500 options that
+ * reads all of them every frame is simulated. A trace
+ * can be recorded by running RetroArch with
+ * libretro_log_level = "0" and -v: every line holding
+ * "GET_VARIABLE: <key> = " is replayed (any other line
+ * that is not empty is taken as a bare key). Keys
+ * found in the trace are registered as options.
+ *
+ * Usage: ./core_options_bench [-f frames] [trace.log] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+#include <string/stdstring.h>
+
+#include "../../core_option_manager.h"
+#include "../../msg_hash.h"
+
+#define BENCH_NUM_OPTIONS 500
+
+struct bench_trace
+{
+   char **keys;
+   size_t size;
+   size_t cap;
+};
+
+/* The option manager only needs this to sanitise
+ * ON/OFF value labels */
+const char *msg_hash_to_str(enum msg_hash_enums msg)
+{
+   return "";
+}
+
+/* Lookup as done before the key index was added */
+static bool bench_linear_get_idx(core_option_manager_t *opt,
+      const char *key, size_t *idx)
+{
+   size_t i;
+   uint32_t key_hash = (uint32_t)0x811c9dc5;
+   const char *s     = key;
+   unsigned char c;
+
+   while ((c = (unsigned char)*(s++)) != '\0')
+      key_hash = ((key_hash * (uint32_t)0x01000193) ^ (uint32_t)c);
+   if (!key_hash)
+      key_hash = 1;
+
+   for (i = 0; i < opt->size; i++)
+   {
+      struct core_option *option = &opt->opts[i];
+
+      if ((key_hash == option->key_hash) &&
+          !string_is_empty(option->key) &&
+          string_is_equal(key, option->key))
+      {
+         *idx = i;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static bool bench_trace_push(struct bench_trace *trace, const char *key)
+{
+   if (trace->size == trace->cap)
+   {
+      size_t cap  = trace->cap ? trace->cap * 2 : 256;
+      char **keys = (char**)realloc(trace->keys, cap * sizeof(*keys));
+
+      if (!keys)
+         return false;
+
+      trace->keys = keys;
+      trace->cap  = cap;
+   }
+
+   if (!(trace->keys[trace->size] = strdup(key)))
+      return false;
+
+   trace->size++;
+   return true;
+}
+
+static bool bench_trace_load(struct bench_trace *trace, const char *path)
+{
+   char line[1024];
+   FILE *file = fopen(path, "r");
+
+   if (!file)
+      return false;
+
+   while (fgets(line, sizeof(line), file))
+   {
+      char *key = strstr(line, "GET_VARIABLE: ");
+      char *end;
+
+      if (key)
+      {
+         key += STRLEN_CONST("GET_VARIABLE: ");
+         if (!(end = strstr(key, " = ")))
+            continue;
+      }
+      else
+      {
+         key = line;
+         end = line + strcspn(line, "\r\n");
+      }
+
+      *end = '\0';
+
+      if (!string_is_empty(key) && !bench_trace_push(trace, key))
+         break;
+   }
+
+   fclose(file);
+   return trace->size > 0;
+}
+
+/* Synthetic trace: keys share a long prefix, as is
+ * the case with real cores, and are read in
+ * registration order once per frame */
+static bool bench_trace_generate(struct bench_trace *trace)
+{
+   unsigned i;
+
+   for (i = 0; i < BENCH_NUM_OPTIONS; i++)
+   {
+      char key[64];
+      snprintf(key, sizeof(key), "bench_core_option_%u", i);
+      if (!bench_trace_push(trace, key))
+         return false;
+   }
+
+   return true;
+}
+
+/* Registers every distinct key of the trace
+ * as a two-value option */
+static core_option_manager_t *bench_create_manager(
+      const struct bench_trace *trace)
+{
+   size_t i;
+   size_t size                                  = 0;
+   struct retro_core_options_v2 options;
+   struct retro_core_option_v2_definition *defs = NULL;
+   core_option_manager_t *opt                   = NULL;
+
+   if (!(defs = (struct retro_core_option_v2_definition*)
+            calloc(trace->size + 1, sizeof(*defs))))
+      return NULL;
+
+   for (i = 0; i < trace->size; i++)
+   {
+      size_t j;
+
+      for (j = 0; j < size; j++)
+         if (string_is_equal(defs[j].key, trace->keys[i]))
+            break;
+
+      if (j < size)
+         continue;
+
+      defs[size].key             = trace->keys[i];
+      defs[size].desc            = trace->keys[i];
+      defs[size].values[0].value = "disabled";
+      defs[size].values[1].value = "enabled";
+      defs[size].default_value   = "disabled";
+      size++;
+   }
+
+   options.categories  = NULL;
+   options.definitions = defs;
+
+   /* The path is only used if the options are saved */
+   opt = core_option_manager_new("core_options_bench.opt", NULL,
+         &options, false);
+   free(defs);
+   return opt;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   size_t j;
+   unsigned frame;
+   size_t found_index       = 0;
+   size_t found_linear      = 0;
+   unsigned frames          = 600;
+   retro_time_t usec_index  = 0;
+   retro_time_t usec_linear = 0;
+   retro_time_t start;
+   struct bench_trace trace = {0};
+   core_option_manager_t *opt;
+   bool ret;
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i++)
+   {
+      if (string_is_equal(argv[i], "-f") && i + 1 < argc)
+         frames = (unsigned)strtoul(argv[++i], NULL, 0);
+      else
+         break;
+   }
+
+   if ((i < argc && argv[i][0] == '-') || (i + 1 < argc) || !frames)
+   {
+      fprintf(stderr, "Usage: %s [-f frames] [trace.log]\n", argv[0]);
+      return 1;
+   }
+
+   ret = (i < argc)
+      ? bench_trace_load(&trace, argv[i])
+      : bench_trace_generate(&trace);
+
+   if (!ret || !(opt = bench_create_manager(&trace)))
+   {
+      fprintf(stderr, "Failed to set up trace.\n");
+      return 1;
+   }
+
+   /* Check that both lookups agree before timing them */
+   for (j = 0; j < trace.size; j++)
+   {
+      size_t idx_index  = 0;
+      size_t idx_linear = 0;
+      bool ok_index     = core_option_manager_get_idx(opt,
+            trace.keys[j], &idx_index);
+      bool ok_linear    = bench_linear_get_idx(opt,
+            trace.keys[j], &idx_linear);
+
+      if (ok_index != ok_linear || idx_index != idx_linear)
+      {
+         fprintf(stderr, "Lookup mismatch for \"%s\".\n", trace.keys[j]);
+         return 1;
+      }
+   }
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (j = 0; j < trace.size; j++)
+      {
+         size_t idx;
+         if (bench_linear_get_idx(opt, trace.keys[j], &idx))
+            found_linear += idx;
+      }
+   usec_linear = cpu_features_get_time_usec() - start;
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (j = 0; j < trace.size; j++)
+      {
+         size_t idx;
+         if (core_option_manager_get_idx(opt, trace.keys[j], &idx))
+            found_index += idx;
+      }
+   usec_index = cpu_features_get_time_usec() - start;
+
+   printf("%u options, %u lookups per frame, %u frames\n",
+         (unsigned)opt->size, (unsigned)trace.size, frames);
+   printf("  linear: %9.3f us/frame\n",
+         (double)usec_linear / frames);
+   printf("  index:  %9.3f us/frame (x%.1f)%s\n",
+         (double)usec_index / frames,
+         usec_index ? (double)usec_linear / usec_index : 0.0,
+         found_index == found_linear ? "" : " MISMATCH");
+
+   core_option_manager_free(opt);
+   for (j = 0; j < trace.size; j++)
+      free(trace.keys[j]);
+   free(trace.keys);
+
+   return found_index == found_linear ? 0 : 1;
+}
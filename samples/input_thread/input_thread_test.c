@@ -0,0 +1,549 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Threaded input test.
+ *
+ * Feeds input_thread.c from a pipe, standing in for a
+ * device, and checks that:
+ *
+ * - a scripted session latched once per frame gives the
+ *   same key state every frame as applying the script
+ *   directly, however the events were split between reads;
+ * - a producer far faster than the frame rate, into a
+ *   small queue, loses, repeats and reorders nothing;
+ * - every latched event shows up in the latency stats.
+ *
+ * With -u, a uinput keyboard is created as well and its
+ * evdev node read the way the udev driver does, with
+ * kernel timestamps. This needs write access to
+ * /dev/uinput and is skipped otherwise.
+ *
+ * Usage: ./input_thread_test [-f frames] [-n events] [-u] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include <boolean.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+
+#include "../../input/common/input_thread.h"
+
+#define TEST_KEYS        64
+#define TEST_TIMEOUT     2000000
+#define TEST_FRAME_USEC  2000
+
+typedef struct test_event
+{
+   uint32_t seq;
+   /* Key index, bit 7 set on release */
+   uint32_t key;
+   retro_time_t sent;
+} test_event_t;
+
+typedef struct test_state
+{
+   uint32_t next_seq;
+   unsigned errors;
+   bool keys[TEST_KEYS];
+} test_state_t;
+
+typedef struct test_producer
+{
+   int fd;
+   uint32_t count;
+} test_producer_t;
+
+static uint32_t test_seed = 0x2545f491;
+
+/* Events latched by all tests, the latency stats
+ * must have seen as many */
+static uint64_t test_latched = 0;
+
+static uint32_t test_rand(void)
+{
+   test_seed ^= test_seed << 13;
+   test_seed ^= test_seed >> 17;
+   test_seed ^= test_seed << 5;
+   return test_seed;
+}
+
+/* input_thread.c logs through these */
+void RARCH_LOG(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vprintf(fmt, ap);
+   va_end(ap);
+}
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+static void test_latch(input_thread_t *thread,
+      input_thread_apply_t apply, void *data)
+{
+   test_latched += input_thread_latch(thread, apply, data);
+}
+
+static void test_state_apply(test_state_t *state, const test_event_t *event)
+{
+   if (event->seq != state->next_seq)
+   {
+      if (state->errors++ < 10)
+         printf("  event %u latched, %u expected\n",
+               (unsigned)event->seq, (unsigned)state->next_seq);
+   }
+   state->next_seq = event->seq + 1;
+   state->keys[event->key & 0x7f] = !(event->key & 0x80);
+}
+
+static void test_pipe_drain(input_thread_t *thread, void *data)
+{
+   ssize_t len;
+   test_event_t events[16];
+   int fd = *(int*)data;
+
+   /* Every event is written in one go, so reads
+    * never return part of one */
+   while (input_thread_space(thread) >= 16
+         && (len = read(fd, events, sizeof(events))) > 0)
+   {
+      size_t i;
+      for (i = 0; i < (size_t)len / sizeof(*events); i++)
+         input_thread_push(thread, &events[i], events[i].sent);
+   }
+}
+
+static void test_pipe_apply(const void *event, retro_time_t time,
+      void *data)
+{
+   test_state_apply((test_state_t*)data, (const test_event_t*)event);
+}
+
+static bool test_write_event(int fd, uint32_t seq, uint32_t key)
+{
+   test_event_t event;
+
+   event.seq  = seq;
+   event.key  = key;
+   event.sent = cpu_features_get_time_usec();
+
+   return write(fd, &event, sizeof(event)) == sizeof(event);
+}
+
+static bool test_open_pipe(int fds[2])
+{
+   if (pipe(fds) < 0)
+      return false;
+   fcntl(fds[0], F_SETFL, O_NONBLOCK);
+   return true;
+}
+
+/* Latches until the state has seen @until events */
+static bool test_latch_until(input_thread_t *thread,
+      input_thread_apply_t apply, test_state_t *state, uint32_t until)
+{
+   retro_time_t deadline = cpu_features_get_time_usec() + TEST_TIMEOUT;
+
+   for (;;)
+   {
+      test_latch(thread, apply, state);
+      if (state->next_seq >= until)
+         return true;
+      if (cpu_features_get_time_usec() > deadline)
+         return false;
+      usleep(50);
+   }
+}
+
+static int test_script(unsigned num_frames)
+{
+   int fds[2];
+   unsigned f;
+   uint32_t seq = 0;
+   test_state_t state;
+   test_state_t reference;
+   input_thread_t *thread;
+   int errors = 0;
+
+   memset(&state, 0, sizeof(state));
+   memset(&reference, 0, sizeof(reference));
+
+   if (!test_open_pipe(fds))
+      return 1;
+
+   thread = input_thread_new("script", fds[0], sizeof(test_event_t),
+         256, test_pipe_drain, &fds[0]);
+   if (!thread)
+      return 1;
+
+   for (f = 0; f < num_frames; f++)
+   {
+      unsigned i;
+      unsigned count = test_rand() % 8;
+
+      for (i = 0; i < count; i++)
+      {
+         test_event_t event;
+         uint32_t key = test_rand() & 0xbf;
+
+         if (!test_write_event(fds[1], seq, key))
+            return 1;
+
+         event.seq = seq++;
+         event.key = key;
+         test_state_apply(&reference, &event);
+
+         /* Spread some events over several reads */
+         if (test_rand() & 1)
+            usleep(test_rand() % 200);
+      }
+
+      if (!test_latch_until(thread, test_pipe_apply, &state, seq))
+      {
+         printf("  frame %u: timed out at event %u of %u\n",
+               f, (unsigned)state.next_seq, (unsigned)seq);
+         errors++;
+         break;
+      }
+
+      input_thread_note_present();
+
+      if (memcmp(state.keys, reference.keys, sizeof(state.keys)))
+      {
+         printf("  frame %u: key state differs\n", f);
+         errors++;
+      }
+   }
+
+   input_thread_free(thread);
+   close(fds[0]);
+   close(fds[1]);
+
+   printf("Script: %u frames, %u events, %u errors\n",
+         num_frames, (unsigned)seq, state.errors + errors);
+
+   return state.errors + errors;
+}
+
+static void test_producer_loop(void *data)
+{
+   uint32_t i;
+   test_producer_t *producer = (test_producer_t*)data;
+
+   for (i = 0; i < producer->count; i++)
+      if (!test_write_event(producer->fd, i, i % TEST_KEYS))
+         break;
+}
+
+static int test_flood(uint32_t count)
+{
+   int fds[2];
+   sthread_t *writer;
+   test_state_t state;
+   test_producer_t producer;
+   input_thread_t *thread;
+   unsigned frames       = 0;
+   retro_time_t deadline = cpu_features_get_time_usec()
+         + 30 * TEST_TIMEOUT;
+
+   memset(&state, 0, sizeof(state));
+
+   if (!test_open_pipe(fds))
+      return 1;
+
+   /* A queue much smaller than what arrives per frame */
+   thread = input_thread_new("flood", fds[0], sizeof(test_event_t),
+         64, test_pipe_drain, &fds[0]);
+   if (!thread)
+      return 1;
+
+   producer.fd    = fds[1];
+   producer.count = count;
+   writer         = sthread_create(test_producer_loop, &producer);
+
+   while (state.next_seq < count
+         && cpu_features_get_time_usec() < deadline)
+   {
+      usleep(TEST_FRAME_USEC);
+      test_latch(thread, test_pipe_apply, &state);
+      input_thread_note_present();
+      frames++;
+   }
+
+   sthread_join(writer);
+   input_thread_free(thread);
+   close(fds[0]);
+   close(fds[1]);
+
+   printf("Flood: %u events over %u frames, %u latched, %u errors\n",
+         (unsigned)count, frames, (unsigned)state.next_seq, state.errors);
+
+   return state.errors + (state.next_seq != count);
+}
+
+/* uinput keyboard, read back through its evdev node */
+
+typedef struct test_evdev
+{
+   int fd;
+   unsigned presses;
+   unsigned releases;
+   unsigned errors;
+   int last_code;
+} test_evdev_t;
+
+static void test_evdev_drain(input_thread_t *thread, void *data)
+{
+   ssize_t len;
+   struct input_event events[32];
+   test_evdev_t *evdev = (test_evdev_t*)data;
+
+   while (input_thread_space(thread) >= 32
+         && (len = read(evdev->fd, events, sizeof(events))) > 0)
+   {
+      size_t i;
+      for (i = 0; i < (size_t)len / sizeof(*events); i++)
+         input_thread_push(thread, &events[i],
+               (retro_time_t)events[i].input_event_sec * 1000000
+               + events[i].input_event_usec);
+   }
+}
+
+static void test_evdev_apply(const void *event, retro_time_t time,
+      void *data)
+{
+   const struct input_event *ev = (const struct input_event*)event;
+   test_evdev_t *evdev          = (test_evdev_t*)data;
+
+   if (ev->type != EV_KEY)
+      return;
+
+   /* Keys are pressed and released in turn, Q to P */
+   if (ev->value == 1)
+   {
+      if (ev->code != KEY_Q + evdev->presses % (KEY_P - KEY_Q + 1))
+         evdev->errors++;
+      evdev->presses++;
+      evdev->last_code = ev->code;
+   }
+   else if (ev->value == 0)
+   {
+      if (ev->code != evdev->last_code)
+         evdev->errors++;
+      evdev->releases++;
+   }
+}
+
+static bool test_uinput_emit(int fd, int type, int code, int value)
+{
+   struct input_event ev;
+
+   memset(&ev, 0, sizeof(ev));
+   ev.type  = type;
+   ev.code  = code;
+   ev.value = value;
+
+   return write(fd, &ev, sizeof(ev)) == sizeof(ev);
+}
+
+static int test_uinput_open_node(int uinput)
+{
+   char sysname[64];
+   char path[512];
+   DIR *dir;
+   struct dirent *entry;
+   int fd = -1;
+
+   if (ioctl(uinput, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0)
+      return -1;
+
+   snprintf(path, sizeof(path), "/sys/devices/virtual/input/%s", sysname);
+   if (!(dir = opendir(path)))
+      return -1;
+
+   while ((entry = readdir(dir)))
+   {
+      if (strncmp(entry->d_name, "event", 5))
+         continue;
+      snprintf(path, sizeof(path), "/dev/input/%s", entry->d_name);
+      fd = open(path, O_RDONLY | O_NONBLOCK);
+      break;
+   }
+
+   closedir(dir);
+   return fd;
+}
+
+static int test_uinput(unsigned count)
+{
+   unsigned i;
+   int clock            = CLOCK_MONOTONIC;
+   int uinput           = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+   input_thread_t *thread;
+   struct uinput_setup setup;
+   test_evdev_t evdev;
+   retro_time_t deadline;
+
+   if (uinput < 0)
+   {
+      printf("uinput: skipped (%s)\n", strerror(errno));
+      return 0;
+   }
+
+   memset(&evdev, 0, sizeof(evdev));
+   memset(&setup, 0, sizeof(setup));
+
+   ioctl(uinput, UI_SET_EVBIT, EV_KEY);
+   for (i = KEY_Q; i <= KEY_P; i++)
+      ioctl(uinput, UI_SET_KEYBIT, i);
+
+   setup.id.bustype = BUS_VIRTUAL;
+   strcpy(setup.name, "RetroArch input thread test");
+   if (     ioctl(uinput, UI_DEV_SETUP, &setup) < 0
+         || ioctl(uinput, UI_DEV_CREATE) < 0)
+   {
+      printf("uinput: skipped (%s)\n", strerror(errno));
+      close(uinput);
+      return 0;
+   }
+
+   /* Give udev time to create the node */
+   usleep(200000);
+
+   if ((evdev.fd = test_uinput_open_node(uinput)) < 0)
+   {
+      printf("uinput: skipped, no event node\n");
+      ioctl(uinput, UI_DEV_DESTROY);
+      close(uinput);
+      return 0;
+   }
+
+   ioctl(evdev.fd, EVIOCSCLOCKID, &clock);
+
+   thread = input_thread_new("uinput", evdev.fd,
+         sizeof(struct input_event), 1024, test_evdev_drain, &evdev);
+   if (!thread)
+      return 1;
+
+   for (i = 0; i < count; i++)
+   {
+      int code = KEY_Q + (i % (KEY_P - KEY_Q + 1));
+      test_uinput_emit(uinput, EV_KEY, code, 1);
+      test_uinput_emit(uinput, EV_SYN, SYN_REPORT, 0);
+      test_uinput_emit(uinput, EV_KEY, code, 0);
+      test_uinput_emit(uinput, EV_SYN, SYN_REPORT, 0);
+
+      if (!(i % 16))
+      {
+         usleep(TEST_FRAME_USEC);
+         test_latch(thread, test_evdev_apply, &evdev);
+         input_thread_note_present();
+      }
+   }
+
+   deadline = cpu_features_get_time_usec() + TEST_TIMEOUT;
+   while (evdev.releases < count
+         && cpu_features_get_time_usec() < deadline)
+   {
+      usleep(TEST_FRAME_USEC);
+      test_latch(thread, test_evdev_apply, &evdev);
+   }
+
+   input_thread_free(thread);
+   close(evdev.fd);
+   ioctl(uinput, UI_DEV_DESTROY);
+   close(uinput);
+
+   printf("uinput: %u presses, %u releases, %u errors\n",
+         evdev.presses, evdev.releases, evdev.errors);
+
+   return evdev.errors
+      + (evdev.presses != count) + (evdev.releases != count);
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   input_thread_latency_t latency;
+   unsigned num_frames  = 2000;
+   uint32_t num_events  = 20000;
+   bool use_uinput      = false;
+   int errors           = 0;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-f") && i + 1 < argc)
+         num_frames = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         num_events = (uint32_t)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-u"))
+         use_uinput = true;
+      else
+      {
+         printf("Usage: %s [-f frames] [-n events] [-u]\n", argv[0]);
+         return 1;
+      }
+   }
+
+   errors += test_script(num_frames);
+   errors += test_flood(num_events);
+   if (use_uinput)
+      errors += test_uinput(1000);
+
+   input_thread_get_latency(&latency);
+   printf("Event to poll (usec): p50 %d, p90 %d, p99 %d, max %d\n",
+         (int)latency.event_to_poll[INPUT_THREAD_P50],
+         (int)latency.event_to_poll[INPUT_THREAD_P90],
+         (int)latency.event_to_poll[INPUT_THREAD_P99],
+         (int)latency.event_to_poll[INPUT_THREAD_MAX]);
+   printf("Poll to present (usec): p50 %d, p90 %d, p99 %d, max %d\n",
+         (int)latency.poll_to_present[INPUT_THREAD_P50],
+         (int)latency.poll_to_present[INPUT_THREAD_P90],
+         (int)latency.poll_to_present[INPUT_THREAD_P99],
+         (int)latency.poll_to_present[INPUT_THREAD_MAX]);
+
+   if (latency.events != test_latched)
+   {
+      printf("Latency stats saw %u events, %u latched\n",
+            (unsigned)latency.events, (unsigned)test_latched);
+      errors++;
+   }
+
+   if (errors)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
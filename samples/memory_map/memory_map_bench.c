@@ -0,0 +1,311 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Memory map peek benchmark.
+ * Simulates an achievement set that peeks a fixed list
+ * of addresses every frame and compares memory_map_find()
+ * with the sequential searches it replaced:
+ *
+ * - guest: addresses in the core's own address space,
+ *   matched against the libretro memory descriptors in
+ *   order (network command interface).
+ * - flat:  addresses into the regions laid out back to
+ *   back (achievements and cheat search).
+ *
+ * Layouts resemble the memory maps exposed by PlayStation
+ * and Nintendo 64 cores.
+ *
+ * Usage: ./memory_map_bench [-f frames] [-p peeks] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <libretro.h>
+#include <features/features_cpu.h>
+#include <string/stdstring.h>
+
+#include "../../memory_map.h"
+
+struct bench_region
+{
+   uint32_t start;
+   uint32_t size;
+   uint64_t flags;
+};
+
+struct bench_layout
+{
+   const char *name;
+   const struct bench_region *regions;
+   unsigned count;
+};
+
+/* Main RAM and its KSEG0/KSEG1 mirrors, scratchpad,
+ * hardware registers, BIOS */
+static const struct bench_region bench_psx[] = {
+   { 0x00000000, 0x00200000, RETRO_MEMDESC_SYSTEM_RAM },
+   { 0x1F800000, 0x00000400, 0 },
+   { 0x1F801000, 0x00002000, 0 },
+   { 0x1FC00000, 0x00080000, RETRO_MEMDESC_CONST },
+   { 0x80000000, 0x00200000, RETRO_MEMDESC_SYSTEM_RAM },
+   { 0x9FC00000, 0x00080000, RETRO_MEMDESC_CONST },
+   { 0xA0000000, 0x00200000, RETRO_MEMDESC_SYSTEM_RAM },
+   { 0xBFC00000, 0x00080000, RETRO_MEMDESC_CONST },
+};
+
+/* RDRAM in KSEG0 and KSEG1, RSP memories, PIF RAM,
+ * cartridge ROM and save memory */
+static const struct bench_region bench_n64[] = {
+   { 0x80000000, 0x00800000, RETRO_MEMDESC_SYSTEM_RAM },
+   { 0xA0000000, 0x00800000, RETRO_MEMDESC_SYSTEM_RAM },
+   { 0xA4000000, 0x00001000, 0 },
+   { 0xA4001000, 0x00001000, 0 },
+   { 0xA8000000, 0x00008000, RETRO_MEMDESC_SAVE_RAM },
+   { 0xB0000000, 0x02000000, RETRO_MEMDESC_CONST },
+   { 0xBFC00000, 0x000007C0, RETRO_MEMDESC_CONST },
+   { 0xBFC007C0, 0x00000040, 0 },
+};
+
+static const struct bench_layout bench_layouts[] = {
+   { "psx", bench_psx, sizeof(bench_psx) / sizeof(bench_psx[0]) },
+   { "n64", bench_n64, sizeof(bench_n64) / sizeof(bench_n64[0]) },
+};
+
+/* Descriptor search as done by the command interface */
+static uint8_t *bench_walk_descriptors(
+      const struct retro_memory_descriptor *desc,
+      unsigned count, uint32_t address)
+{
+   const struct retro_memory_descriptor *end = desc + count;
+
+   for (; desc < end; desc++)
+   {
+      if (desc->select == 0)
+      {
+         if (address >= desc->start && address < desc->start + desc->len)
+            return (uint8_t*)desc->ptr + desc->offset
+               + (address - desc->start);
+      }
+      else if (((desc->start ^ address) & desc->select) == 0
+            && address - desc->start < desc->len)
+         return (uint8_t*)desc->ptr + desc->offset
+            + (address - desc->start);
+   }
+
+   return NULL;
+}
+
+/* Region search as done by rc_libretro_memory_find() */
+static uint8_t *bench_walk_flat(uint8_t **data, const uint32_t *size,
+      unsigned count, uint32_t address)
+{
+   unsigned i;
+
+   for (i = 0; i < count; i++)
+   {
+      if (address < size[i])
+         return data[i] ? data[i] + address : NULL;
+      address -= size[i];
+   }
+
+   return NULL;
+}
+
+/* Small xorshift so that runs are repeatable */
+static uint32_t bench_rand(uint32_t *state)
+{
+   uint32_t x = *state;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   return *state = x;
+}
+
+static void bench_report(const char *what, unsigned frames,
+      retro_time_t usec_walk, retro_time_t usec_map, bool match)
+{
+   printf("  %-6s walk: %9.3f us/frame   map: %9.3f us/frame (x%.1f)%s\n",
+         what,
+         (double)usec_walk / frames,
+         (double)usec_map  / frames,
+         usec_map ? (double)usec_walk / usec_map : 0.0,
+         match ? "" : " MISMATCH");
+}
+
+static bool bench_layout_run(const struct bench_layout *layout,
+      unsigned frames, unsigned peeks)
+{
+   unsigned i, frame;
+   retro_time_t start, usec_walk, usec_map;
+   uint32_t seed                          = 0x12345678;
+   uint32_t sum_walk                      = 0;
+   uint32_t sum_map                       = 0;
+   uint32_t flat_size                     = 0;
+   bool match                             = true;
+   memory_map_t guest_map                 = {0};
+   memory_map_t flat_map                  = {0};
+   struct retro_memory_descriptor *desc   = NULL;
+   uint8_t **data                         = NULL;
+   uint32_t *size                         = NULL;
+   uint32_t *guest                        = NULL;
+   uint32_t *flat                         = NULL;
+
+   desc  = (struct retro_memory_descriptor*)calloc(layout->count, sizeof(*desc));
+   data  = (uint8_t**)calloc(layout->count, sizeof(*data));
+   size  = (uint32_t*)calloc(layout->count, sizeof(*size));
+   guest = (uint32_t*)malloc(peeks * sizeof(*guest));
+   flat  = (uint32_t*)malloc(peeks * sizeof(*flat));
+
+   if (!desc || !data || !size || !guest || !flat)
+   {
+      match = false;
+      goto end;
+   }
+
+   for (i = 0; i < layout->count; i++)
+   {
+      const struct bench_region *region = &layout->regions[i];
+
+      if (!(data[i] = (uint8_t*)malloc(region->size)))
+      {
+         match = false;
+         goto end;
+      }
+      memset(data[i], (int)i, region->size);
+
+      size[i]        = region->size;
+      desc[i].flags  = region->flags;
+      desc[i].ptr    = data[i];
+      desc[i].start  = region->start;
+      desc[i].len    = region->size;
+
+      memory_map_add_descriptor(&guest_map, &desc[i]);
+      memory_map_add(&flat_map, flat_size, data[i], size[i], 0);
+      flat_size     += region->size;
+   }
+
+   if (!memory_map_build(&guest_map) || !memory_map_build(&flat_map))
+   {
+      match = false;
+      goto end;
+   }
+
+   /* Achievement sets watch a handful of addresses in each
+    * region; pick regions uniformly so that the later ones,
+    * which the walks reach last, get their share */
+   for (i = 0; i < peeks; i++)
+   {
+      unsigned r       = bench_rand(&seed) % layout->count;
+      uint32_t offset  = bench_rand(&seed) % layout->regions[r].size;
+      uint32_t before  = 0;
+      unsigned j;
+
+      for (j = 0; j < r; j++)
+         before += layout->regions[j].size;
+
+      guest[i] = layout->regions[r].start + offset;
+      flat[i]  = before + offset;
+
+      if (     memory_map_find(&guest_map, guest[i], NULL)
+            != bench_walk_descriptors(desc, layout->count, guest[i])
+            || memory_map_find(&flat_map, flat[i], NULL)
+            != bench_walk_flat(data, size, layout->count, flat[i]))
+      {
+         fprintf(stderr, "Lookup mismatch at peek %u.\n", i);
+         match = false;
+         goto end;
+      }
+   }
+
+   printf("%s: %u regions, %u peeks per frame, %u frames\n",
+         layout->name, layout->count, peeks, frames);
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (i = 0; i < peeks; i++)
+         sum_walk += *bench_walk_descriptors(desc, layout->count, guest[i]);
+   usec_walk = cpu_features_get_time_usec() - start;
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (i = 0; i < peeks; i++)
+         sum_map += *memory_map_find(&guest_map, guest[i], NULL);
+   usec_map = cpu_features_get_time_usec() - start;
+
+   bench_report("guest", frames, usec_walk, usec_map, sum_walk == sum_map);
+   match    = match && sum_walk == sum_map;
+   sum_walk = sum_map = 0;
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (i = 0; i < peeks; i++)
+         sum_walk += *bench_walk_flat(data, size, layout->count, flat[i]);
+   usec_walk = cpu_features_get_time_usec() - start;
+
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+      for (i = 0; i < peeks; i++)
+         sum_map += *memory_map_find(&flat_map, flat[i], NULL);
+   usec_map = cpu_features_get_time_usec() - start;
+
+   bench_report("flat", frames, usec_walk, usec_map, sum_walk == sum_map);
+   match = match && sum_walk == sum_map;
+
+end:
+   memory_map_free(&guest_map);
+   memory_map_free(&flat_map);
+   if (data)
+      for (i = 0; i < layout->count; i++)
+         free(data[i]);
+   free(data);
+   free(size);
+   free(desc);
+   free(guest);
+   free(flat);
+   return match;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned j;
+   unsigned frames = 600;
+   unsigned peeks  = 2000;
+   bool ok         = true;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (string_is_equal(argv[i], "-f") && i + 1 < argc)
+         frames = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (string_is_equal(argv[i], "-p") && i + 1 < argc)
+         peeks  = (unsigned)strtoul(argv[++i], NULL, 0);
+      else
+         break;
+   }
+
+   if (i < argc || !frames || !peeks)
+   {
+      fprintf(stderr, "Usage: %s [-f frames] [-p peeks]\n", argv[0]);
+      return 1;
+   }
+
+   for (j = 0; j < sizeof(bench_layouts) / sizeof(bench_layouts[0]); j++)
+      if (!bench_layout_run(&bench_layouts[j], frames, peeks))
+         ok = false;
+
+   return ok ? 0 : 1;
+}
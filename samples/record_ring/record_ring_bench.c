@@ -0,0 +1,536 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Recorder frame handoff benchmark.
+ *
+ * A synthetic core renders XRGB8888 frames at 60 fps and
+ * hands them to an encoder thread the way the FFmpeg
+ * recorder does. The encoder converts each frame to BGR24,
+ * what the recorder feeds libx264rgb by default, deflates
+ * it and appends it to a local file, standing in for a
+ * software video encoder. For several frame sizes:
+ *
+ * - fifo: the fifos under a lock and condition variable
+ *   the recorder used before, the encoder copying every
+ *   frame out before converting it;
+ * - ring: record_ring, the encoder converting straight
+ *   from the slot, the main thread waiting on a full ring;
+ * - drop: the same, dropping frames on a full ring.
+ *
+ * Reports how long the main thread spends handing each
+ * frame over (mean / max), how often it had to wait for
+ * the encoder and the frames dropped. The encoder checks
+ * that frames come in order, and that every frame is
+ * either encoded or dropped.
+ *
+ * Usage: ./record_ring_bench [-d dir] [-n frames] [-s slots] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <boolean.h>
+#include <retro_atomic.h>
+#include <retro_timers.h>
+#include <features/features_cpu.h>
+#include <queues/fifo_queue.h>
+#include <rthreads/rthreads.h>
+
+#include "../../record/record_ring.h"
+
+#define BENCH_FRAME_USEC 16667
+
+enum bench_mode
+{
+   BENCH_FIFO = 0,
+   BENCH_RING,
+   BENCH_DROP
+};
+
+typedef struct bench_frame
+{
+   unsigned index;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+} bench_frame_t;
+
+typedef struct bench
+{
+   enum bench_mode mode;
+   unsigned width;
+   unsigned height;
+
+   /* fifo */
+   slock_t *lock;
+   slock_t *cond_lock;
+   scond_t *cond;
+   fifo_buffer_t *attr_fifo;
+   fifo_buffer_t *video_fifo;
+   bool can_sleep;
+
+   /* ring */
+   record_ring_t *ring;
+   record_signal_t *work;
+   record_signal_t *space;
+
+   retro_atomic_uint_t alive;
+
+   /* Encoder */
+   FILE *file;
+   uint8_t *frame_buf;
+   uint8_t *bgr;
+   uint8_t *packed;
+   uLongf packed_size;
+   unsigned encoded;
+   unsigned next_index;
+   unsigned errors;
+
+   /* Main thread */
+   retro_time_t push_total;
+   retro_time_t push_max;
+   unsigned pushed;
+   unsigned waits;
+   unsigned dropped;
+} bench_t;
+
+#define BENCH_SLOT_HEADER 64
+
+static bool bench_is_alive(bench_t *bench)
+{
+   return retro_atomic_load(&bench->alive) != 0;
+}
+
+/* What a core renders, the frame index in the first pixel */
+static void bench_render(uint32_t *frame, unsigned width,
+      unsigned height, unsigned index)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++)
+   {
+      uint32_t *row = frame + y * width;
+      for (x = 0; x < width; x++)
+         row[x] = ((x + index) & 0xff) << 16 | ((y + index) & 0xff) << 8
+            | ((x ^ y) & 0xff);
+   }
+
+   frame[0] = index;
+}
+
+static void bench_encode(bench_t *bench, const bench_frame_t *frame,
+      const uint8_t *pixels)
+{
+   unsigned x, y;
+   uint32_t index;
+   uLongf size = bench->packed_size;
+
+   memcpy(&index, pixels, sizeof(index));
+   if (index < bench->next_index)
+   {
+      if (bench->errors++ < 5)
+         printf("  frame %u after frame %u\n", index, bench->next_index - 1);
+   }
+   bench->next_index = index + 1;
+
+   for (y = 0; y < frame->height; y++)
+   {
+      const uint32_t *in = (const uint32_t*)(pixels + y * frame->pitch);
+      uint8_t *out       = bench->bgr + y * frame->width * 3;
+
+      for (x = 0; x < frame->width; x++, out += 3)
+      {
+         out[0] = (uint8_t)(in[x] >>  0);
+         out[1] = (uint8_t)(in[x] >>  8);
+         out[2] = (uint8_t)(in[x] >> 16);
+      }
+   }
+
+   if (compress2(bench->packed, &size, bench->bgr,
+            frame->width * frame->height * 3, 1) != Z_OK
+         || fwrite(&size, sizeof(size), 1, bench->file) != 1
+         || fwrite(bench->packed, 1, size, bench->file) != size)
+      bench->errors++;
+
+   bench->encoded++;
+}
+
+/* The recorder's thread before */
+static void bench_fifo_thread(void *data)
+{
+   bench_t *bench = (bench_t*)data;
+
+   for (;;)
+   {
+      bench_frame_t attr;
+      bool avail;
+
+      slock_lock(bench->lock);
+      avail = FIFO_READ_AVAIL(bench->attr_fifo) >= sizeof(attr);
+      slock_unlock(bench->lock);
+
+      if (!avail)
+      {
+         if (!bench_is_alive(bench))
+            break;
+
+         slock_lock(bench->cond_lock);
+         if (bench->can_sleep)
+         {
+            bench->can_sleep = false;
+            scond_wait(bench->cond, bench->cond_lock);
+            bench->can_sleep = true;
+         }
+         else
+            scond_signal(bench->cond);
+         slock_unlock(bench->cond_lock);
+         continue;
+      }
+
+      slock_lock(bench->lock);
+      fifo_read(bench->attr_fifo, &attr, sizeof(attr));
+      fifo_read(bench->video_fifo, bench->frame_buf,
+            attr.height * attr.pitch);
+      slock_unlock(bench->lock);
+      scond_signal(bench->cond);
+
+      bench_encode(bench, &attr, bench->frame_buf);
+   }
+}
+
+static void bench_fifo_push(bench_t *bench, const bench_frame_t *frame,
+      const uint8_t *pixels)
+{
+   for (;;)
+   {
+      unsigned avail;
+
+      slock_lock(bench->lock);
+      avail = FIFO_WRITE_AVAIL(bench->attr_fifo);
+      slock_unlock(bench->lock);
+
+      if (avail >= sizeof(*frame))
+         break;
+
+      bench->waits++;
+      slock_lock(bench->cond_lock);
+      if (bench->can_sleep)
+      {
+         bench->can_sleep = false;
+         scond_wait(bench->cond, bench->cond_lock);
+         bench->can_sleep = true;
+      }
+      else
+         scond_signal(bench->cond);
+      slock_unlock(bench->cond_lock);
+   }
+
+   slock_lock(bench->lock);
+   fifo_write(bench->attr_fifo, frame, sizeof(*frame));
+   fifo_write(bench->video_fifo, pixels, frame->height * frame->pitch);
+   slock_unlock(bench->lock);
+   scond_signal(bench->cond);
+}
+
+static bool bench_ring_ready(void *data)
+{
+   bench_t *bench = (bench_t*)data;
+   return !bench_is_alive(bench) || record_ring_peek(bench->ring, 0);
+}
+
+static bool bench_space_ready(void *data)
+{
+   bench_t *bench = (bench_t*)data;
+   return record_ring_acquire(bench->ring) != NULL;
+}
+
+static void bench_ring_thread(void *data)
+{
+   bench_t *bench = (bench_t*)data;
+
+   for (;;)
+   {
+      uint8_t *slot = (uint8_t*)record_ring_peek(bench->ring, 0);
+
+      if (!slot)
+      {
+         if (!bench_is_alive(bench))
+            break;
+         record_signal_wait(bench->work, bench_ring_ready, bench);
+         continue;
+      }
+
+      bench_encode(bench, (const bench_frame_t*)slot,
+            slot + BENCH_SLOT_HEADER);
+      record_ring_release(bench->ring, 1);
+      record_signal_notify(bench->space);
+   }
+}
+
+static void bench_ring_push(bench_t *bench, const bench_frame_t *frame,
+      const uint8_t *pixels)
+{
+   uint8_t *slot = (uint8_t*)record_ring_acquire(bench->ring);
+
+   if (!slot)
+   {
+      if (bench->mode == BENCH_DROP)
+      {
+         bench->dropped++;
+         return;
+      }
+
+      bench->waits++;
+      record_signal_wait(bench->space, bench_space_ready, bench);
+      slot = (uint8_t*)record_ring_acquire(bench->ring);
+   }
+
+   memcpy(slot, frame, sizeof(*frame));
+   memcpy(slot + BENCH_SLOT_HEADER, pixels, frame->height * frame->pitch);
+   record_ring_publish(bench->ring);
+   record_signal_notify(bench->work);
+}
+
+static bool bench_init(bench_t *bench, enum bench_mode mode,
+      unsigned width, unsigned height, unsigned slots, const char *path)
+{
+   size_t frame_size = (size_t)width * height * 4;
+
+   memset(bench, 0, sizeof(*bench));
+   bench->mode        = mode;
+   bench->width       = width;
+   bench->height      = height;
+   bench->alive       = 1;
+   bench->can_sleep   = true;
+   bench->packed_size = compressBound(width * height * 3);
+   bench->bgr         = (uint8_t*)malloc(width * height * 3);
+   bench->packed      = (uint8_t*)malloc(bench->packed_size);
+
+   if (!bench->bgr || !bench->packed || !(bench->file = fopen(path, "wb")))
+      return false;
+
+   if (mode == BENCH_FIFO)
+   {
+      bench->lock       = slock_new();
+      bench->cond_lock  = slock_new();
+      bench->cond       = scond_new();
+      bench->attr_fifo  = fifo_new(sizeof(bench_frame_t) * slots);
+      bench->video_fifo = fifo_new(frame_size * slots);
+      bench->frame_buf  = (uint8_t*)malloc(frame_size);
+      return bench->lock && bench->cond_lock && bench->cond
+         && bench->attr_fifo && bench->video_fifo && bench->frame_buf;
+   }
+
+   bench->ring  = record_ring_new(slots, BENCH_SLOT_HEADER + frame_size);
+   bench->work  = record_signal_new();
+   bench->space = record_signal_new();
+   return bench->ring && bench->work && bench->space;
+}
+
+static void bench_deinit(bench_t *bench)
+{
+   if (bench->lock)
+      slock_free(bench->lock);
+   if (bench->cond_lock)
+      slock_free(bench->cond_lock);
+   if (bench->cond)
+      scond_free(bench->cond);
+   if (bench->attr_fifo)
+      fifo_free(bench->attr_fifo);
+   if (bench->video_fifo)
+      fifo_free(bench->video_fifo);
+   record_ring_free(bench->ring);
+   record_signal_free(bench->work);
+   record_signal_free(bench->space);
+   if (bench->file)
+      fclose(bench->file);
+   free(bench->frame_buf);
+   free(bench->bgr);
+   free(bench->packed);
+}
+
+/* Runs one handoff, returns how long the encoder took to
+ * drain after the last frame, in ms */
+static double bench_run(bench_t *bench, unsigned frames)
+{
+   unsigned i;
+   retro_time_t drain;
+   bench_frame_t frame;
+   uint32_t *pixels   = (uint32_t*)malloc(
+         (size_t)bench->width * bench->height * 4);
+   sthread_t *thread  = sthread_create((bench->mode == BENCH_FIFO)
+         ? bench_fifo_thread : bench_ring_thread, bench);
+
+   if (!pixels || !thread)
+   {
+      bench->errors++;
+      free(pixels);
+      return 0.0;
+   }
+
+   frame.width  = bench->width;
+   frame.height = bench->height;
+   frame.pitch  = bench->width * 4;
+
+   for (i = 0; i < frames; i++)
+   {
+      retro_time_t start, left;
+      retro_time_t frame_start = cpu_features_get_time_usec();
+
+      bench_render(pixels, bench->width, bench->height, i);
+      frame.index = i;
+
+      start = cpu_features_get_time_usec();
+      if (bench->mode == BENCH_FIFO)
+         bench_fifo_push(bench, &frame, (const uint8_t*)pixels);
+      else
+         bench_ring_push(bench, &frame, (const uint8_t*)pixels);
+      start = cpu_features_get_time_usec() - start;
+
+      bench->push_total += start;
+      if (start > bench->push_max)
+         bench->push_max = start;
+      bench->pushed++;
+
+      left = BENCH_FRAME_USEC - (cpu_features_get_time_usec() - frame_start);
+      if (left > 1000)
+         retro_sleep((unsigned)(left / 1000));
+   }
+
+   drain = cpu_features_get_time_usec();
+   if (bench->mode == BENCH_FIFO)
+   {
+      slock_lock(bench->cond_lock);
+      retro_atomic_store(&bench->alive, 0);
+      bench->can_sleep = false;
+      slock_unlock(bench->cond_lock);
+      scond_signal(bench->cond);
+   }
+   else
+   {
+      retro_atomic_store(&bench->alive, 0);
+      record_signal_broadcast(bench->work);
+   }
+   sthread_join(thread);
+   drain = cpu_features_get_time_usec() - drain;
+
+   if (bench->encoded + bench->dropped != frames)
+   {
+      printf("  %u frames encoded and %u dropped out of %u\n",
+            bench->encoded, bench->dropped, frames);
+      bench->errors++;
+   }
+
+   free(pixels);
+   return drain / 1000.0;
+}
+
+static int bench_size(unsigned width, unsigned height, unsigned frames,
+      unsigned slots, const char *dir)
+{
+   char path[1024];
+   unsigned i;
+   bench_t bench[3];
+   double drain[3];
+   int errors = 0;
+
+   snprintf(path, sizeof(path), "%s/record_ring_bench.bin", dir);
+
+   for (i = 0; i < 3; i++)
+   {
+      if (!bench_init(&bench[i], (enum bench_mode)i, width, height,
+               slots, path))
+      {
+         printf("  cannot set up the benchmark\n");
+         bench_deinit(&bench[i]);
+         return 1;
+      }
+
+      drain[i] = bench_run(&bench[i], frames);
+      errors  += bench[i].errors;
+      bench_deinit(&bench[i]);
+   }
+
+   remove(path);
+
+   printf("%4ux%-4u |", width, height);
+   for (i = 0; i < 3; i++)
+      printf(" %6.2f / %-7.2f |",
+            bench[i].push_total / 1000.0 / bench[i].pushed,
+            bench[i].push_max / 1000.0);
+   printf(" %4u / %-4u | %7u | %7.1f / %-7.1f\n",
+         bench[BENCH_FIFO].waits, bench[BENCH_RING].waits,
+         bench[BENCH_DROP].dropped,
+         drain[BENCH_FIFO], drain[BENCH_RING]);
+
+   return errors;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   const char *dir = "/tmp";
+   unsigned frames = 120;
+   unsigned slots  = 8;
+   int errors      = 0;
+   static const unsigned sizes[][2] = {
+      { 640, 480 }, { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 }
+   };
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-d") && i + 1 < argc)
+         dir = argv[++i];
+      else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         frames = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+         slots = (unsigned)strtoul(argv[++i], NULL, 0);
+      else
+      {
+         printf("Usage: %s [-d dir] [-n frames] [-s slots]\n", argv[0]);
+         return 1;
+      }
+   }
+
+   if (!frames)
+      frames = 1;
+   if (!slots || (slots & (slots - 1)))
+   {
+      printf("Slots must be a power of two\n");
+      return 1;
+   }
+
+   printf("%u frames at 60 fps, %u slots, %u cores, main thread time"
+         " per frame in ms (mean / max)\n\n",
+         frames, slots, cpu_features_get_core_amount());
+   printf("%9s | %16s | %16s | %16s | %11s | %7s | %17s\n",
+         "Frame", "Fifo", "Ring", "Drop", "Waits", "Dropped", "Drain, ms");
+   printf("%9s | %16s | %16s | %16s | %11s | %7s | %17s\n",
+         "", "", "", "", "fifo / ring", "", "fifo / ring");
+
+   for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+      errors += bench_size(sizes[i][0], sizes[i][1], frames, slots, dir);
+
+   if (errors)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
@@ -0,0 +1,790 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* RGUI blitter golden test and benchmark.
+ *
+ * Draws a scripted menu session (checkerboard background,
+ * border, title, entry list with a moving selection, a
+ * scrolling ticker, mouse cursor, plus random clipped
+ * rectangles and glyphs near the frame edges) twice: once
+ * with the per-pixel routines RGUI used to have, kept here
+ * as the reference, and once the way rgui.c now draws with
+ * the rgui_blit.c primitives. Every frame must be pixel
+ * identical.
+ *
+ * Each frame is then diffed into tiles and upscaled only
+ * where it changed; the result must match a full upscale
+ * of the frame, for several output sizes.
+ *
+ * The SSE2 or NEON paths of rgui_blit.c are tested when
+ * the compiler targets them, the plain C ones otherwise.
+ *
+ * Usage: ./rgui_blit_test [-f frames] [-d dump_dir]
+ * With -d, the frames are written there as PPM files. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+
+#include "../../gfx/drivers_font_renderer/bitmap.h"
+#include "../../menu/drivers/rgui_blit.h"
+
+#define TEST_NUM_GLYPHS 128
+#define TEST_NUM_ENTRIES 40
+
+static bool test_lut[TEST_NUM_GLYPHS][FONT_WIDTH * FONT_HEIGHT];
+static uint8_t test_rows[TEST_NUM_GLYPHS][FONT_HEIGHT];
+
+static uint32_t test_seed = 0x12345679;
+
+static uint32_t test_rand(void)
+{
+   test_seed ^= test_seed << 13;
+   test_seed ^= test_seed >> 17;
+   test_seed ^= test_seed << 5;
+   return test_seed;
+}
+
+static void test_font_init(void)
+{
+   unsigned i, j, k;
+
+   for (i = 0; i < TEST_NUM_GLYPHS; i++)
+   {
+      for (j = 0; j < FONT_WIDTH * FONT_HEIGHT; j++)
+         test_lut[i][j] = (bitmap_bin[FONT_OFFSET(i) + (j >> 3)]
+               & (1 << (j & 7))) != 0;
+
+      for (j = 0; j < FONT_HEIGHT; j++)
+      {
+         uint8_t row = 0;
+         for (k = 0; k < FONT_WIDTH; k++)
+            if (test_lut[i][k + j * FONT_WIDTH])
+               row |= (uint8_t)(1 << k);
+         test_rows[i][j] = row;
+      }
+   }
+}
+
+/* Reference: the routines as they were in rgui.c */
+
+#define RGUI_MAX_FB_WIDTH 426
+
+static void ref_fill_rect(
+      uint16_t *data,
+      unsigned fb_width, unsigned fb_height,
+      unsigned x, unsigned y,
+      unsigned width, unsigned height,
+      uint16_t dark_color, uint16_t light_color,
+      bool thickness)
+{
+   unsigned x_index, y_index;
+   unsigned x_start = x <= fb_width  ? x : fb_width;
+   unsigned y_start = y <= fb_height ? y : fb_height;
+   unsigned x_end   = x + width;
+   unsigned y_end   = y + height;
+   size_t x_size;
+   uint16_t scanline_even[RGUI_MAX_FB_WIDTH]; /* Initial values don't matter here */
+   uint16_t scanline_odd[RGUI_MAX_FB_WIDTH];
+
+   /* Note: unlike rgui_color_rect() and rgui_draw_particle(),
+    * this function is frequently used to fill large areas.
+    * We therefore gain significant performance benefits
+    * from using memcpy() tricks... */
+
+   x_end  = x_end <= fb_width  ? x_end : fb_width;
+   y_end  = y_end <= fb_height ? y_end : fb_height;
+   x_size = (x_end - x_start) * sizeof(uint16_t);
+
+   /* Sanity check */
+   if (x_size == 0)
+      return;
+
+   /* If dark_color and light_color are the same,
+    * perform a solid fill */
+   if (dark_color == light_color)
+   {
+      uint16_t *src = scanline_even + x_start;
+      uint16_t *dst = data + x_start;
+
+      /* Populate source array */
+      for (x_index = x_start; x_index < x_end; x_index++)
+         *(scanline_even + x_index) = dark_color;
+
+      /* Fill destination array */
+      for (y_index = y_start; y_index < y_end; y_index++)
+         memcpy(dst + (y_index * fb_width), src, x_size);
+   }
+   else if (thickness)
+   {
+      uint16_t *src_a      = NULL;
+      uint16_t *src_b      = NULL;
+      uint16_t *src_c      = NULL;
+      uint16_t *src_d      = NULL;
+      uint16_t *dst        = data + x_start;
+
+      /* Determine in which order the source arrays
+       * should be copied */
+      switch (y_start & 0x3)
+      {
+         case 0x1:
+            src_a = scanline_even + x_start;
+            src_b = scanline_odd  + x_start;
+            src_c = src_b;
+            src_d = src_a;
+            break;
+         case 0x2:
+            src_a = scanline_odd  + x_start;
+            src_b = src_a;
+            src_c = scanline_even + x_start;
+            src_d = src_c;
+            break;
+         case 0x3:
+            src_a = scanline_odd  + x_start;
+            src_b = scanline_even + x_start;
+            src_c = src_b;
+            src_d = src_a;
+            break;
+         case 0x0:
+         default:
+            src_a = scanline_even + x_start;
+            src_b = src_a;
+            src_c = scanline_odd  + x_start;
+            src_d = src_c;
+            break;
+      }
+
+      /* Populate source arrays */
+      for (x_index = x_start; x_index < x_end; x_index++)
+      {
+         bool x_is_even = (((x_index >> 1) & 1) == 0);
+         *(scanline_even + x_index) = x_is_even ? dark_color  : light_color;
+         *(scanline_odd  + x_index) = x_is_even ? light_color : dark_color;
+      }
+
+      /* Fill destination array */
+      for (y_index = y_start    ; y_index < y_end; y_index += 4)
+         memcpy(dst + (y_index * fb_width), src_a, x_size);
+
+      for (y_index = y_start + 1; y_index < y_end; y_index += 4)
+         memcpy(dst + (y_index * fb_width), src_b, x_size);
+
+      for (y_index = y_start + 2; y_index < y_end; y_index += 4)
+         memcpy(dst + (y_index * fb_width), src_c, x_size);
+
+      for (y_index = y_start + 3; y_index < y_end; y_index += 4)
+         memcpy(dst + (y_index * fb_width), src_d, x_size);
+   }
+   else
+   {
+      uint16_t *src_a      = NULL;
+      uint16_t *src_b      = NULL;
+      uint16_t *dst        = data + x_start;
+
+      /* Determine in which order the source arrays
+       * should be copied */
+      if ((y_start & 1) == 0)
+      {
+         src_a = scanline_even + x_start;
+         src_b = scanline_odd  + x_start;
+      }
+      else
+      {
+         src_a = scanline_odd  + x_start;
+         src_b = scanline_even + x_start;
+      }
+
+      /* Populate source arrays */
+      for (x_index = x_start; x_index < x_end; x_index++)
+      {
+         bool x_is_even = ((x_index & 1) == 0);
+         *(scanline_even + x_index) = x_is_even ? dark_color  : light_color;
+         *(scanline_odd  + x_index) = x_is_even ? light_color : dark_color;
+      }
+
+      /* Fill destination array */
+      for (y_index = y_start    ; y_index < y_end; y_index += 2)
+         memcpy(dst + (y_index * fb_width), src_a, x_size);
+
+      for (y_index = y_start + 1; y_index < y_end; y_index += 2)
+         memcpy(dst + (y_index * fb_width), src_b, x_size);
+   }
+}
+
+static void ref_color_rect(
+      uint16_t *data,
+      unsigned fb_width, unsigned fb_height,
+      unsigned x, unsigned y,
+      unsigned width, unsigned height,
+      uint16_t color)
+{
+   unsigned x_index, y_index;
+   unsigned x_start = x <= fb_width  ? x : fb_width;
+   unsigned y_start = y <= fb_height ? y : fb_height;
+   unsigned x_end   = x + width;
+   unsigned y_end   = y + height;
+
+   x_end = x_end <= fb_width  ? x_end : fb_width;
+   y_end = y_end <= fb_height ? y_end : fb_height;
+
+   for (y_index = y_start; y_index < y_end; y_index++)
+   {
+      uint16_t *data_ptr = data + (y_index * fb_width);
+      for (x_index = x_start; x_index < x_end; x_index++)
+         *(data_ptr + x_index) = color;
+   }
+}
+
+static void ref_blit_line(uint16_t *data, unsigned fb_width,
+      int x, int y, const char *message,
+      uint16_t color, uint16_t shadow_color, bool shadow)
+{
+   uint16_t color_buf[2];
+   uint16_t shadow_color_buf[2];
+
+   color_buf[0]        = color;
+   color_buf[1]        = shadow_color;
+   shadow_color_buf[0] = shadow_color;
+   shadow_color_buf[1] = shadow_color;
+
+   for (; *message; message++, x += FONT_WIDTH_STRIDE)
+   {
+      unsigned i, j;
+      uint8_t symbol = (uint8_t)*message;
+
+      if (symbol >= TEST_NUM_GLYPHS || symbol == ' ')
+         continue;
+
+      for (j = 0; j < FONT_HEIGHT; j++)
+      {
+         unsigned buff_offset = ((y + j) * fb_width) + x;
+
+         for (i = 0; i < FONT_WIDTH; i++)
+         {
+            uint16_t *ptr = data + buff_offset + i;
+
+            if (!test_lut[symbol][i + j * FONT_WIDTH])
+               continue;
+
+            if (shadow)
+            {
+               memcpy(ptr, color_buf, sizeof(color_buf));
+               memcpy(ptr + fb_width, shadow_color_buf,
+                     sizeof(shadow_color_buf));
+            }
+            else
+               *ptr = color;
+         }
+      }
+   }
+}
+
+/* New: as rgui_fill_rect(), rgui_color_rect() and
+ * blit_line_regular[_shadow]() now are */
+
+static void new_fill_rect(
+      uint16_t *data,
+      unsigned fb_width, unsigned fb_height,
+      unsigned x, unsigned y,
+      unsigned width, unsigned height,
+      uint16_t dark_color, uint16_t light_color,
+      bool thickness)
+{
+   unsigned i, j;
+   unsigned x_start = x <= fb_width  ? x : fb_width;
+   unsigned y_start = y <= fb_height ? y : fb_height;
+   unsigned x_end   = x + width;
+   unsigned y_end   = y + height;
+   uint16_t patterns[16];
+
+   /* Note: unlike rgui_color_rect() and rgui_draw_particle(),
+    * this function is frequently used to fill large areas,
+    * so the rows go through rgui_blit_fill_rect() */
+
+   x_end  = x_end <= fb_width  ? x_end : fb_width;
+   y_end  = y_end <= fb_height ? y_end : fb_height;
+
+   /* Sanity check */
+   if (x_end <= x_start)
+      return;
+
+   /* The checkerboard repeats every 4 pixels both ways */
+   for (j = 0; j < 4; j++)
+   {
+      for (i = 0; i < 4; i++)
+      {
+         unsigned x_index = x_start + i;
+         unsigned y_index = y_start + j;
+         /* Thick checks are 2x2 pixels, thin ones 1x1 */
+         bool is_dark     = thickness
+               ? ((((x_index >> 1) ^ (y_index >> 1)) & 1) == 0)
+               : (((x_index ^ y_index) & 1) == 0);
+         patterns[(j << 2) + i] = is_dark ? dark_color : light_color;
+      }
+   }
+
+   rgui_blit_fill_rect(data + (y_start * fb_width) + x_start,
+         fb_width, x_end - x_start, y_end - y_start, patterns);
+}
+
+static void new_color_rect(
+      uint16_t *data,
+      unsigned fb_width, unsigned fb_height,
+      unsigned x, unsigned y,
+      unsigned width, unsigned height,
+      uint16_t color)
+{
+   unsigned i;
+   unsigned x_start = x <= fb_width  ? x : fb_width;
+   unsigned y_start = y <= fb_height ? y : fb_height;
+   unsigned x_end   = x + width;
+   unsigned y_end   = y + height;
+   uint16_t patterns[16];
+
+   x_end = x_end <= fb_width  ? x_end : fb_width;
+   y_end = y_end <= fb_height ? y_end : fb_height;
+
+   if (x_end <= x_start)
+      return;
+
+   for (i = 0; i < 16; i++)
+      patterns[i] = color;
+
+   rgui_blit_fill_rect(data + (y_start * fb_width) + x_start,
+         fb_width, x_end - x_start, y_end - y_start, patterns);
+}
+
+static void new_blit_line(uint16_t *data, unsigned fb_width,
+      int x, int y, const char *message,
+      uint16_t color, uint16_t shadow_color, bool shadow)
+{
+   for (; *message; message++, x += FONT_WIDTH_STRIDE)
+   {
+      uint8_t symbol = (uint8_t)*message;
+      uint16_t *dst  = data + (y * fb_width) + x;
+      size_t room    = ((x >= 0) && ((unsigned)x < fb_width))
+            ? fb_width - (unsigned)x : 0;
+
+      if (symbol >= TEST_NUM_GLYPHS || symbol == ' ')
+         continue;
+
+      if (shadow)
+         rgui_blit_glyph_shadow(dst, fb_width, room,
+               test_rows[symbol], FONT_HEIGHT, color, shadow_color);
+      else
+         rgui_blit_glyph(dst, fb_width, room,
+               test_rows[symbol], FONT_HEIGHT, color);
+   }
+}
+
+/* Scripted session */
+
+typedef struct
+{
+   void (*fill_rect)(uint16_t*, unsigned, unsigned,
+         unsigned, unsigned, unsigned, unsigned,
+         uint16_t, uint16_t, bool);
+   void (*color_rect)(uint16_t*, unsigned, unsigned,
+         unsigned, unsigned, unsigned, unsigned, uint16_t);
+   void (*blit_line)(uint16_t*, unsigned, int, int,
+         const char*, uint16_t, uint16_t, bool);
+} test_painter_t;
+
+static const test_painter_t ref_painter = {
+   ref_fill_rect, ref_color_rect, ref_blit_line };
+static const test_painter_t new_painter = {
+   new_fill_rect, new_color_rect, new_blit_line };
+
+static const char *test_entries[] = {
+   "Load Core", "Load Content", "Online Updater",
+   "Information", "Configuration File", "Help",
+   "Restart RetroArch", "Quit RetroArch",
+   "Settings: Drivers, Video, Audio, Input, Latency",
+   "~!@#$%^&*()_+{}|:\"<>?`-=[]\\;',./0123456789"
+};
+
+static void test_draw_frame(const test_painter_t *p, uint16_t *fb,
+      unsigned fb_width, unsigned fb_height, unsigned frame,
+      bool shadow, bool thickness)
+{
+   char line[128];
+   unsigned i;
+   unsigned num_rows  = (fb_height - 40) / FONT_HEIGHT_STRIDE;
+   unsigned selection = (frame / 3) % TEST_NUM_ENTRIES;
+   unsigned scroll    = (selection >= num_rows)
+         ? selection - num_rows + 1 : 0;
+   unsigned cursor_x  = 5 + (frame * 7) % (fb_width  - 10);
+   unsigned cursor_y  = 5 + (frame * 3) % (fb_height - 10);
+   uint32_t seed      = test_seed;
+
+   /* Background, border */
+   p->fill_rect(fb, fb_width, fb_height, 0, 0, fb_width, fb_height,
+         0x1082, 0x2104, thickness);
+   p->fill_rect(fb, fb_width, fb_height, 5, 5, fb_width - 10, 5,
+         0x4208, 0x8410, !thickness);
+   p->fill_rect(fb, fb_width, fb_height,
+         5, fb_height - 10, fb_width - 10, 5,
+         0x4208, 0x8410, !thickness);
+   p->fill_rect(fb, fb_width, fb_height, 5, 5, 5, fb_height - 10,
+         0x4208, 0x8410, thickness);
+   p->fill_rect(fb, fb_width, fb_height,
+         fb_width - 10, 5, 5, fb_height - 10,
+         0x4208, 0x8410, thickness);
+
+   /* Title and entries, the selected one with a ticker */
+   p->blit_line(fb, fb_width, 15, 15, "MAIN MENU",
+         0xFFE0, 0x0000, shadow);
+
+   for (i = 0; i < num_rows && scroll + i < TEST_NUM_ENTRIES; i++)
+   {
+      unsigned entry    = scroll + i;
+      const char *label = test_entries[entry % (sizeof(test_entries)
+            / sizeof(test_entries[0]))];
+      int y             = 30 + (int)(i * FONT_HEIGHT_STRIDE);
+
+      if (entry == selection)
+      {
+         size_t len      = strlen(label);
+         unsigned offset = (unsigned)((frame % 16) % (len + 1));
+         snprintf(line, sizeof(line), "> %s", label + offset);
+         p->blit_line(fb, fb_width, 15, y, line,
+               0xFFFF, 0x0841, shadow);
+      }
+      else
+         p->blit_line(fb, fb_width, 27, y, label,
+               0xBDF7, 0x0841, shadow);
+
+      snprintf(line, sizeof(line), "%u", entry * 37 + frame);
+      p->blit_line(fb, fb_width,
+            (int)(fb_width - 15 - strlen(line) * FONT_WIDTH_STRIDE),
+            y, line, 0x07E0, 0x0841, shadow);
+   }
+
+   /* Mouse cursor */
+   p->color_rect(fb, fb_width, fb_height,
+         cursor_x, cursor_y - 5, 1, 11, 0xF800);
+   p->color_rect(fb, fb_width, fb_height,
+         cursor_x - 5, cursor_y, 11, 1, 0xF800);
+
+   /* Random rectangles, clipped at the frame edges, and
+    * glyphs up to (and wrapping past) the right edge */
+   for (i = 0; i < 4; i++)
+   {
+      unsigned x = test_rand() % (fb_width + 20);
+      unsigned y = test_rand() % (fb_height + 20);
+      unsigned w = test_rand() % 64;
+      unsigned h = test_rand() % 32;
+      p->fill_rect(fb, fb_width, fb_height, x, y, w, h,
+            (uint16_t)test_rand(), (uint16_t)test_rand(),
+            (test_rand() & 1) != 0);
+   }
+
+   for (i = 0; i < 4; i++)
+   {
+      int x = (int)(fb_width - 1 - test_rand() % 20);
+      int y = (int)(test_rand() % (fb_height - FONT_HEIGHT_STRIDE - 1));
+      line[0] = (char)(33 + test_rand() % 94);
+      line[1] = '\0';
+      p->blit_line(fb, fb_width, x, y, line,
+            (uint16_t)test_rand(), (uint16_t)test_rand(), shadow);
+   }
+
+   /* Both painters must see the same random numbers */
+   if (p == &ref_painter)
+      test_seed = seed;
+}
+
+static void ref_upscale(const uint16_t *src,
+      unsigned fb_width, unsigned fb_height,
+      uint16_t *dst, unsigned out_width, unsigned out_height)
+{
+   unsigned x_dst, y_dst;
+   uint32_t x_ratio = ((fb_width  << 16) / out_width);
+   uint32_t y_ratio = ((fb_height << 16) / out_height);
+
+   for (y_dst = 0; y_dst < out_height; y_dst++)
+   {
+      unsigned y_src = (y_dst * y_ratio) >> 16;
+      for (x_dst = 0; x_dst < out_width; x_dst++)
+      {
+         unsigned x_src = (x_dst * x_ratio) >> 16;
+         dst[(y_dst * out_width) + x_dst] = src[(y_src * fb_width) + x_src];
+      }
+   }
+}
+
+static bool test_dump(const char *dir, unsigned frame,
+      const uint16_t *fb, unsigned width, unsigned height)
+{
+   char path[1024];
+   size_t i;
+   FILE *file;
+
+   snprintf(path, sizeof(path), "%s/frame_%04u.ppm", dir, frame);
+   if (!(file = fopen(path, "wb")))
+      return false;
+
+   fprintf(file, "P6\n%u %u\n255\n", width, height);
+   for (i = 0; i < (size_t)width * height; i++)
+   {
+      uint8_t rgb[3];
+      rgb[0] = (uint8_t)(((fb[i] >> 11) & 0x1F) << 3);
+      rgb[1] = (uint8_t)(((fb[i] >>  5) & 0x3F) << 2);
+      rgb[2] = (uint8_t)(( fb[i]        & 0x1F) << 3);
+      fwrite(rgb, 1, 3, file);
+   }
+
+   fclose(file);
+   return true;
+}
+
+static int test_size(unsigned fb_width, unsigned fb_height,
+      unsigned num_frames, const char *dump_dir)
+{
+   static const unsigned scales[][2] = {
+      { 2, 2 }, { 3, 3 }, { 4, 3 } };
+   size_t fb_size   = (size_t)fb_width * fb_height;
+   uint16_t *ref    = (uint16_t*)calloc(fb_size, sizeof(uint16_t));
+   uint16_t *fb     = (uint16_t*)calloc(fb_size, sizeof(uint16_t));
+   uint16_t *prev   = (uint16_t*)calloc(fb_size, sizeof(uint16_t));
+   uint16_t *copy   = (uint16_t*)calloc(fb_size, sizeof(uint16_t));
+   uint8_t *dirty   = (uint8_t*)calloc(
+         rgui_blit_num_tiles(fb_width, fb_height), 1);
+   uint16_t *up_ref = (uint16_t*)calloc(fb_size * 12, sizeof(uint16_t));
+   uint16_t *up_new[3];
+   unsigned tiles_x = (fb_width + RGUI_TILE_SIZE - 1) / RGUI_TILE_SIZE;
+   unsigned frame, s;
+   size_t total_dirty = 0;
+   int errors         = 0;
+
+   for (s = 0; s < 3; s++)
+      up_new[s] = (uint16_t*)calloc(fb_size * 12, sizeof(uint16_t));
+
+   for (frame = 0; frame < num_frames && !errors; frame++)
+   {
+      bool shadow    = (frame / 50) % 2 == 0;
+      bool thickness = (frame / 25) % 2 == 0;
+      size_t i, num_dirty;
+      unsigned tx, ty;
+
+      test_draw_frame(&ref_painter, ref, fb_width, fb_height,
+            frame, shadow, thickness);
+      test_draw_frame(&new_painter, fb, fb_width, fb_height,
+            frame, shadow, thickness);
+
+      for (i = 0; i < fb_size; i++)
+      {
+         if (ref[i] != fb[i])
+         {
+            printf("%ux%u frame %u: pixel (%u, %u) is %04x, "
+                  "expected %04x\n", fb_width, fb_height, frame,
+                  (unsigned)(i % fb_width), (unsigned)(i / fb_width),
+                  fb[i], ref[i]);
+            errors++;
+            break;
+         }
+      }
+
+      if (dump_dir && !test_dump(dump_dir, frame, fb,
+               fb_width, fb_height))
+      {
+         printf("Could not write to %s\n", dump_dir);
+         errors++;
+      }
+
+      /* Tiles: the first frame is diffed against black */
+      num_dirty = rgui_blit_update_tiles(fb, copy,
+            fb_width, fb_height, dirty);
+      total_dirty += num_dirty;
+
+      if (memcmp(copy, fb, fb_size * sizeof(uint16_t)))
+      {
+         printf("%ux%u frame %u: tile copy differs\n",
+               fb_width, fb_height, frame);
+         errors++;
+      }
+
+      for (ty = 0; ty * RGUI_TILE_SIZE < fb_height; ty++)
+      {
+         for (tx = 0; tx < tiles_x; tx++)
+         {
+            unsigned x, y;
+            bool changed = false;
+
+            for (y = ty * RGUI_TILE_SIZE;
+                  y < (ty + 1) * RGUI_TILE_SIZE && y < fb_height; y++)
+               for (x = tx * RGUI_TILE_SIZE;
+                     x < (tx + 1) * RGUI_TILE_SIZE && x < fb_width; x++)
+                  changed |= fb[y * fb_width + x] != prev[y * fb_width + x];
+
+            if (changed != (dirty[ty * tiles_x + tx] != 0))
+            {
+               printf("%ux%u frame %u: tile (%u, %u) flagged %d\n",
+                     fb_width, fb_height, frame, tx, ty,
+                     dirty[ty * tiles_x + tx]);
+               errors++;
+            }
+         }
+      }
+
+      memcpy(prev, fb, fb_size * sizeof(uint16_t));
+
+      for (s = 0; s < 3; s++)
+      {
+         unsigned out_width  = fb_width  * scales[s][0];
+         unsigned out_height = fb_height * scales[s][1];
+
+         /* Odd output sizes too */
+         if (s == 2)
+         {
+            out_width  -= 7;
+            out_height -= 5;
+         }
+
+         ref_upscale(fb, fb_width, fb_height,
+               up_ref, out_width, out_height);
+         rgui_blit_upscale(fb, fb_width, fb_height,
+               up_new[s], out_width, out_height,
+               frame ? dirty : NULL);
+
+         if (memcmp(up_ref, up_new[s],
+                  (size_t)out_width * out_height * sizeof(uint16_t)))
+         {
+            printf("%ux%u frame %u: upscale to %ux%u differs\n",
+                  fb_width, fb_height, frame, out_width, out_height);
+            errors++;
+         }
+      }
+   }
+
+   printf("%ux%u: %u frames, %.1f%% of tiles changed per frame%s\n",
+         fb_width, fb_height, frame,
+         100.0 * total_dirty / ((double)frame *
+            rgui_blit_num_tiles(fb_width, fb_height)),
+         errors ? ", FAILED" : "");
+
+   for (s = 0; s < 3; s++)
+      free(up_new[s]);
+   free(up_ref);
+   free(dirty);
+   free(copy);
+   free(prev);
+   free(fb);
+   free(ref);
+   return errors;
+}
+
+static void test_bench(unsigned fb_width, unsigned fb_height,
+      unsigned num_frames)
+{
+   size_t fb_size   = (size_t)fb_width * fb_height;
+   uint16_t *fb     = (uint16_t*)calloc(fb_size, sizeof(uint16_t));
+   uint16_t *copy   = (uint16_t*)calloc(fb_size, sizeof(uint16_t));
+   uint8_t *dirty   = (uint8_t*)calloc(
+         rgui_blit_num_tiles(fb_width, fb_height), 1);
+   uint16_t *up     = (uint16_t*)calloc(fb_size * 9, sizeof(uint16_t));
+   retro_time_t t_ref, t_new, t_up_ref, t_up_new, t0;
+   unsigned frame;
+
+   t_ref = t_new = t_up_ref = t_up_new = 0;
+
+   for (frame = 0; frame < num_frames; frame++)
+   {
+      t0     = cpu_features_get_time_usec();
+      test_draw_frame(&ref_painter, fb, fb_width, fb_height,
+            frame, true, true);
+      t_ref += cpu_features_get_time_usec() - t0;
+
+      t0     = cpu_features_get_time_usec();
+      test_draw_frame(&new_painter, fb, fb_width, fb_height,
+            frame, true, true);
+      t_new += cpu_features_get_time_usec() - t0;
+
+      t0        = cpu_features_get_time_usec();
+      ref_upscale(fb, fb_width, fb_height,
+            up, fb_width * 3, fb_height * 3);
+      t_up_ref += cpu_features_get_time_usec() - t0;
+
+      t0        = cpu_features_get_time_usec();
+      rgui_blit_update_tiles(fb, copy, fb_width, fb_height, dirty);
+      rgui_blit_upscale(fb, fb_width, fb_height,
+            up, fb_width * 3, fb_height * 3, dirty);
+      t_up_new += cpu_features_get_time_usec() - t0;
+   }
+
+   printf("%ux%u, %u frames:\n", fb_width, fb_height, num_frames);
+   printf("  draw:       %8.1f us/frame reference, %8.1f us/frame new\n",
+         (double)t_ref / num_frames, (double)t_new / num_frames);
+   printf("  3x upscale: %8.1f us/frame reference, %8.1f us/frame "
+         "diff + dirty tiles\n",
+         (double)t_up_ref / num_frames, (double)t_up_new / num_frames);
+
+   free(up);
+   free(dirty);
+   free(copy);
+   free(fb);
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned num_frames  = 400;
+   const char *dump_dir = NULL;
+   int errors           = 0;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-f") && i + 1 < argc)
+         num_frames = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+         dump_dir = argv[++i];
+      else
+      {
+         printf("Usage: %s [-f frames] [-d dump_dir]\n", argv[0]);
+         return 1;
+      }
+   }
+
+   if (!num_frames)
+      num_frames = 1;
+
+   test_font_init();
+
+#if defined(__SSE2__)
+   printf("Testing the SSE2 routines\n");
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+   printf("Testing the NEON routines\n");
+#else
+   printf("Testing the plain C routines\n");
+#endif
+
+   errors += test_size(426, 240, num_frames, dump_dir);
+   errors += test_size(320, 240, num_frames, NULL);
+   errors += test_size(257, 192, num_frames, NULL);
+
+   if (errors)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   test_bench(426, 240, 1000);
+
+   printf("OK\n");
+   return 0;
+}
@@ -0,0 +1,256 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Save RAM autosave benchmark.
+ *
+ * Simulates an hour of play (in virtual time) with a
+ * synthetic core that pokes a few random bytes of its
+ * save RAM every second, autosaving every interval the
+ * way task_save.c does, into a real file. Reports for
+ * several save RAM sizes:
+ *
+ * - bytes written per hour, against the whole-file
+ *   rewrite autosave did before;
+ * - how long the autosave thread holds the lock the core
+ *   runs under per autosave, in total and at most at
+ *   once (median over the hour, this is noisy on shared
+ *   machines), against the old whole-buffer compare and
+ *   copy.
+ *
+ * Once written, the file must match the save RAM after
+ * every autosave.
+ *
+ * Usage: ./sram_autosave_bench [-r bytes_per_sec]
+ *                              [-i interval_sec] [-d dir] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
+
+#include "../../sram_blocks.h"
+
+/* As in task_save.c */
+#define BENCH_SCAN_BLOCKS 64
+
+static uint32_t bench_seed = 0x9e3779b9;
+
+static uint32_t bench_rand(void)
+{
+   bench_seed ^= bench_seed << 13;
+   bench_seed ^= bench_seed >> 17;
+   bench_seed ^= bench_seed << 5;
+   return bench_seed;
+}
+
+static int bench_cmp_time(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+   return (x > y) - (x < y);
+}
+
+static bool bench_check_file(const char *path,
+      const uint8_t *sram, size_t size)
+{
+   void *data  = NULL;
+   int64_t len = 0;
+   bool ok;
+
+   if (!filestream_read_file(path, &data, &len))
+      return false;
+
+   ok = (size_t)len == size && !memcmp(data, sram, size);
+   free(data);
+   return ok;
+}
+
+static int bench_size(size_t size, unsigned rate, unsigned interval,
+      const char *dir)
+{
+   char path[1024];
+   unsigned t;
+   sram_blocks_t blocks;
+   uint8_t *sram           = (uint8_t*)malloc(size);
+   uint8_t *old_copy       = (uint8_t*)malloc(size);
+   uint64_t old_bytes      = 0;
+   retro_time_t old_hold   = 0;
+   retro_time_t new_hold   = 0;
+   retro_time_t new_max[3600];
+   retro_time_t write_time = 0;
+   unsigned autosaves      = 0;
+   unsigned errors         = 0;
+
+   if (!sram || !old_copy)
+      return 1;
+
+   snprintf(path, sizeof(path), "%s/sram_autosave_bench.srm", dir);
+   filestream_delete(path);
+
+   memset(sram, 0xff, size);
+   memcpy(old_copy, sram, size);
+   if (!sram_blocks_init(&blocks, sram, size))
+      return 1;
+
+   for (t = 1; t <= 3600; t++)
+   {
+      unsigned i;
+
+      /* The core */
+      for (i = 0; i < rate; i++)
+         sram[bench_rand() % size] = (uint8_t)bench_rand();
+
+      if (t % interval)
+         continue;
+
+      new_max[autosaves++] = 0;
+
+      /* What autosave did before: compare and copy the
+       * whole buffer under the lock, then rewrite all of
+       * the file when anything changed */
+      {
+         retro_time_t start = cpu_features_get_time_usec();
+         bool differ        = memcmp(old_copy, sram, size) != 0;
+
+         if (differ)
+            memcpy(old_copy, sram, size);
+         old_hold += cpu_features_get_time_usec() - start;
+         if (differ)
+            old_bytes += size;
+      }
+
+      /* What it does now */
+      {
+         retro_time_t start;
+         bool changed = false;
+         bool done    = false;
+
+         while (!done)
+         {
+            retro_time_t hold;
+            start   = cpu_features_get_time_usec();
+            changed = sram_blocks_changed(&blocks, sram,
+                  BENCH_SCAN_BLOCKS, &done);
+            hold    = cpu_features_get_time_usec() - start;
+            new_hold += hold;
+            if (hold > new_max[autosaves - 1])
+               new_max[autosaves - 1] = hold;
+         }
+
+         if (changed)
+         {
+            retro_time_t hold;
+            start = cpu_features_get_time_usec();
+            sram_blocks_capture(&blocks, sram);
+            hold  = cpu_features_get_time_usec() - start;
+            new_hold += hold;
+            if (hold > new_max[autosaves - 1])
+               new_max[autosaves - 1] = hold;
+
+            sram_blocks_update(&blocks);
+         }
+
+         if (blocks.num_dirty)
+         {
+            start = cpu_features_get_time_usec();
+            if (!sram_blocks_write(&blocks, path, false))
+               errors++;
+            write_time += cpu_features_get_time_usec() - start;
+         }
+      }
+
+      if (blocks.writes && !bench_check_file(path, sram, size))
+      {
+         if (errors++ < 5)
+            printf("  t=%us: file does not match save RAM\n", t);
+      }
+   }
+
+   qsort(new_max, autosaves, sizeof(*new_max), bench_cmp_time);
+
+   printf("%8u KB | %12.1f | %11.1f | %5u/%-5u | %8d | %8d | %8d | %8.1f\n",
+         (unsigned)(size / 1024),
+         old_bytes / (1024.0 * 1024.0),
+         blocks.bytes_written / (1024.0 * 1024.0),
+         blocks.writes - blocks.full_writes, blocks.full_writes,
+         (int)(old_hold / autosaves), (int)(new_hold / autosaves),
+         (int)new_max[autosaves / 2],
+         blocks.writes ? write_time / 1000.0 / blocks.writes : 0.0);
+
+   sram_blocks_free(&blocks);
+   filestream_delete(path);
+   free(sram);
+   free(old_copy);
+
+   return errors;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned rate     = 4;
+   unsigned interval = 10;
+   const char *dir   = "/tmp";
+   int errors        = 0;
+   static const size_t sizes[] = {
+      32 * 1024, 512 * 1024, 8 * 1024 * 1024, 64 * 1024 * 1024
+   };
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-r") && i + 1 < argc)
+         rate = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+         interval = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+         dir = argv[++i];
+      else
+      {
+         printf("Usage: %s [-r bytes_per_sec] [-i interval_sec] [-d dir]\n",
+               argv[0]);
+         return 1;
+      }
+   }
+
+   if (!interval)
+      interval = 1;
+   if (interval > 3600)
+      interval = 3600;
+
+   printf("%u bytes poked per second, autosave every %u s, one hour\n\n",
+         rate, interval);
+   printf("%11s | %12s | %11s | %11s | %8s | %8s | %8s | %8s\n",
+         "Save RAM", "Old MB/hour", "New MB/hour", "Writes i/f",
+         "Old lock", "New lock", "Longest", "ms/write");
+   printf("%11s | %12s | %11s | %11s | %8s | %8s | %8s | %8s\n",
+         "", "", "", "in place/", "usec per", "usec per", "hold", "");
+   printf("%11s | %12s | %11s | %11s | %8s | %8s | %8s | %8s\n",
+         "", "", "", "full", "autosave", "autosave", "(usec)", "");
+
+   for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+      errors += bench_size(sizes[i], rate, interval, dir);
+
+   if (errors)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
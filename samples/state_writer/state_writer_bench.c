@@ -0,0 +1,420 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Save state writer benchmark.
+ *
+ * Measures how long the main thread stalls per save
+ * state, with a synthetic core that writes every byte of
+ * its state, for several state sizes:
+ *
+ * - before: allocating a zeroed buffer, serializing into
+ *   it and handing it to a thread that writes it out,
+ *   what content_save_state() did with the task thread;
+ * - spaced: one save at a time through the writer;
+ * - spam: a save every 16 ms frame to the same file,
+ *   newer saves replacing pending ones;
+ * - two files: a save every frame for a few frames,
+ *   alternating between two files, so that the main
+ *   thread has to wait for a buffer.
+ *
+ * Every file must hold the last state saved to it.
+ *
+ * Usage: ./state_writer_bench [-d dir] [-u] [-n frames]
+ *   -u: write uncompressed files */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_timers.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
+#include <streams/rzip_stream.h>
+
+#include "../../state_writer.h"
+
+#define BENCH_FRAME_USEC 16667
+
+typedef struct bench_stall
+{
+   retro_time_t total;
+   retro_time_t max;
+   unsigned count;
+} bench_stall_t;
+
+/* Stands in for the task thread the old save path
+ * handed each serialized state to */
+typedef struct bench_task
+{
+   slock_t *lock;
+   scond_t *cond;
+   uint8_t *buf;
+   const char *path;
+   size_t size;
+   bool compress;
+   bool quit;
+} bench_task_t;
+
+static void bench_task_loop(void *data)
+{
+   bench_task_t *task = (bench_task_t*)data;
+
+   slock_lock(task->lock);
+   for (;;)
+   {
+      uint8_t *buf;
+
+      while (!task->buf && !task->quit)
+         scond_wait(task->cond, task->lock);
+      if (!(buf = task->buf))
+         break;
+      slock_unlock(task->lock);
+
+      if (task->compress)
+         rzipstream_write_file(task->path, buf, (int64_t)task->size);
+      else
+         filestream_write_file(task->path, buf, (int64_t)task->size);
+      free(buf);
+
+      slock_lock(task->lock);
+      task->buf = NULL;
+      scond_broadcast(task->cond);
+   }
+   slock_unlock(task->lock);
+}
+
+static void bench_stall_add(bench_stall_t *stall, retro_time_t usec)
+{
+   stall->total += usec;
+   stall->count++;
+   if (usec > stall->max)
+      stall->max = usec;
+}
+
+/* What a core does, one word in eight varying
+ * between saves, the rest compressing well */
+static void bench_serialize(uint8_t *buf, size_t size, unsigned gen)
+{
+   size_t i;
+   uint64_t seed = 0x9e3779b97f4a7c15ULL ^ gen;
+
+   for (i = 0; i + 8 <= size; i += 8)
+   {
+      uint64_t word = (uint64_t)((i >> 12) + gen) * 0x0101010101010101ULL;
+
+      if ((i & 63) == 0)
+      {
+         seed ^= seed << 13;
+         seed ^= seed >> 7;
+         seed ^= seed << 17;
+         word  = seed;
+      }
+
+      memcpy(buf + i, &word, sizeof(word));
+   }
+
+   for (; i < size; i++)
+      buf[i] = (uint8_t)gen;
+}
+
+static bool bench_check(const char *path, size_t size, unsigned gen)
+{
+   bool ok;
+   void *data        = NULL;
+   int64_t len       = 0;
+   uint8_t *expected = (uint8_t*)malloc(size);
+
+   if (!expected || !rzipstream_read_file(path, &data, &len))
+   {
+      free(expected);
+      return false;
+   }
+
+   bench_serialize(expected, size, gen);
+   ok = (size_t)len == size && !memcmp(data, expected, size);
+   free(data);
+   free(expected);
+   return ok;
+}
+
+static bool bench_save(state_writer_t *writer, const char *path,
+      size_t size, unsigned gen, bool compress, bench_stall_t *stall,
+      state_writer_job_t **jobs, unsigned *num_jobs)
+{
+   retro_time_t start = cpu_features_get_time_usec();
+   uint8_t *buf       = (uint8_t*)state_writer_begin(writer, path, size);
+   state_writer_job_t *job;
+
+   if (!buf)
+      return false;
+
+   bench_serialize(buf, size, gen);
+   job = state_writer_commit(writer, compress, false);
+   bench_stall_add(stall, cpu_features_get_time_usec() - start);
+
+   if (!job)
+      return false;
+   jobs[(*num_jobs)++] = job;
+   return true;
+}
+
+/* Frees every job, counting those that failed */
+static unsigned bench_jobs_free(state_writer_job_t **jobs, unsigned num_jobs)
+{
+   unsigned i;
+   unsigned failed = 0;
+
+   for (i = 0; i < num_jobs; i++)
+   {
+      enum state_writer_result result;
+      void *backup       = NULL;
+      size_t backup_size = 0;
+
+      if (     !state_writer_job_done(jobs[i], &result, &backup, &backup_size)
+            || result == STATE_WRITER_FAILED)
+         failed++;
+      free(backup);
+      state_writer_job_free(jobs[i]);
+   }
+
+   return failed;
+}
+
+static void bench_frame_sleep(retro_time_t frame_start)
+{
+   retro_time_t left = BENCH_FRAME_USEC
+      - (cpu_features_get_time_usec() - frame_start);
+   if (left > 1000)
+      retro_sleep((unsigned)(left / 1000));
+}
+
+static void bench_print(const bench_stall_t *stall)
+{
+   printf(" %7.2f / %-7.2f |",
+         stall->count ? stall->total / 1000.0 / stall->count : 0.0,
+         stall->max / 1000.0);
+}
+
+static int bench_size(size_t size, const char *dir, bool compress,
+      unsigned frames)
+{
+   char path[2][1024];
+   unsigned i;
+   state_writer_stats_t stats;
+   retro_time_t drain;
+   bench_stall_t before       = {0};
+   bench_stall_t spaced       = {0};
+   bench_stall_t spam         = {0};
+   bench_stall_t two          = {0};
+   unsigned gen               = 0;
+   unsigned last[2]           = {0};
+   unsigned num_jobs          = 0;
+   unsigned errors            = 0;
+   unsigned spaced_saves      = size > 16 * 1024 * 1024 ? 4 : 8;
+   unsigned two_frames        = frames < 8 ? frames : 8;
+   state_writer_job_t **jobs  = (state_writer_job_t**)
+      calloc(spaced_saves + frames * 2, sizeof(*jobs));
+   state_writer_t *writer     = state_writer_new();
+   bench_task_t task          = {0};
+   sthread_t *task_thread     = NULL;
+
+   if (!jobs || !writer)
+      return 1;
+
+   task.lock     = slock_new();
+   task.cond     = scond_new();
+   task.path     = path[1];
+   task.size     = size;
+   task.compress = compress;
+   if (     !task.lock || !task.cond
+         || !(task_thread = sthread_create(bench_task_loop, &task)))
+      return 1;
+
+   for (i = 0; i < 2; i++)
+   {
+      snprintf(path[i], sizeof(path[i]),
+            "%s/state_writer_bench%u.state", dir, i);
+      filestream_delete(path[i]);
+   }
+
+   /* Before: a fresh zeroed buffer per save, written
+    * out by the task thread */
+   for (i = 0; i < spaced_saves; i++)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+      uint8_t *buf       = (uint8_t*)calloc(size, 1);
+
+      if (!buf)
+         return 1;
+      bench_serialize(buf, size, ++gen);
+
+      slock_lock(task.lock);
+      task.buf = buf;
+      scond_broadcast(task.cond);
+      slock_unlock(task.lock);
+      bench_stall_add(&before, cpu_features_get_time_usec() - start);
+
+      slock_lock(task.lock);
+      while (task.buf)
+         scond_wait(task.cond, task.lock);
+      slock_unlock(task.lock);
+   }
+
+   slock_lock(task.lock);
+   task.quit = true;
+   scond_broadcast(task.cond);
+   slock_unlock(task.lock);
+   sthread_join(task_thread);
+   slock_free(task.lock);
+   scond_free(task.cond);
+
+   if (!bench_check(path[1], size, gen))
+   {
+      printf("  before: file does not match the last save\n");
+      errors++;
+   }
+   filestream_delete(path[1]);
+
+   /* One save at a time */
+   for (i = 0; i < spaced_saves; i++)
+   {
+      last[0] = ++gen;
+      if (!bench_save(writer, path[0], size, gen, compress,
+               &spaced, jobs, &num_jobs))
+         errors++;
+      state_writer_wait(writer);
+   }
+   if (!bench_check(path[0], size, last[0]))
+   {
+      printf("  spaced: file does not match the last save\n");
+      errors++;
+   }
+   errors += bench_jobs_free(jobs, num_jobs);
+   num_jobs = 0;
+
+   /* A save every frame to the same file */
+   for (i = 0; i < frames; i++)
+   {
+      retro_time_t frame_start = cpu_features_get_time_usec();
+      last[0] = ++gen;
+      if (!bench_save(writer, path[0], size, gen, compress,
+               &spam, jobs, &num_jobs))
+         errors++;
+      bench_frame_sleep(frame_start);
+   }
+   drain = cpu_features_get_time_usec();
+   state_writer_wait(writer);
+   drain = cpu_features_get_time_usec() - drain;
+   if (!bench_check(path[0], size, last[0]))
+   {
+      printf("  spam: file does not match the last save\n");
+      errors++;
+   }
+   errors += bench_jobs_free(jobs, num_jobs);
+   num_jobs = 0;
+
+   /* A save every frame, alternating between two files */
+   for (i = 0; i < two_frames; i++)
+   {
+      retro_time_t frame_start = cpu_features_get_time_usec();
+      last[i & 1] = ++gen;
+      if (!bench_save(writer, path[i & 1], size, gen, compress,
+               &two, jobs, &num_jobs))
+         errors++;
+      bench_frame_sleep(frame_start);
+   }
+   state_writer_wait(writer);
+   for (i = 0; i < 2 && two_frames > 1; i++)
+   {
+      if (!bench_check(path[i], size, last[i]))
+      {
+         printf("  two files: file %u does not match the last save\n", i);
+         errors++;
+      }
+   }
+   errors += bench_jobs_free(jobs, num_jobs);
+
+   state_writer_get_stats(writer, &stats);
+   state_writer_free(writer);
+
+   printf("%8u KB |", (unsigned)(size / 1024));
+   bench_print(&before);
+   bench_print(&spaced);
+   bench_print(&spam);
+   bench_print(&two);
+   printf(" %5u/%-5u | %5u | %8.1f\n",
+         stats.written, stats.replaced, stats.waits, drain / 1000.0);
+
+   for (i = 0; i < 2; i++)
+      filestream_delete(path[i]);
+   free(jobs);
+
+   return errors;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   const char *dir = "/tmp";
+   bool compress   = true;
+   unsigned frames = 30;
+   int errors      = 0;
+   static const size_t sizes[] = {
+      64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 100 * 1024 * 1024
+   };
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-d") && i + 1 < argc)
+         dir = argv[++i];
+      else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+         frames = (unsigned)strtoul(argv[++i], NULL, 0);
+      else if (!strcmp(argv[i], "-u"))
+         compress = false;
+      else
+      {
+         printf("Usage: %s [-d dir] [-u] [-n frames]\n", argv[0]);
+         return 1;
+      }
+   }
+
+   if (!frames)
+      frames = 1;
+
+   printf("%s files, %u frames of saves, main thread stall per save"
+         " in ms (mean / max)\n\n",
+         compress ? "Compressed" : "Uncompressed", frames);
+   printf("%11s | %17s | %17s | %17s | %17s | %11s | %5s | %8s\n",
+         "State", "Before", "Spaced", "Spam", "Two files",
+         "Saves", "Waits", "Drain");
+   printf("%11s | %17s | %17s | %17s | %17s | %11s | %5s | %8s\n",
+         "", "", "", "", "", "written/", "", "after");
+   printf("%11s | %17s | %17s | %17s | %17s | %11s | %5s | %8s\n",
+         "", "", "", "", "", "replaced", "", "spam, ms");
+
+   for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+      errors += bench_size(sizes[i], dir, compress, frames);
+
+   if (errors)
+   {
+      printf("FAILED\n");
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
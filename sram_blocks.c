@@ -0,0 +1,358 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define SRAM_BLOCKS_FSYNC
+#endif
+
+#include <compat/strl.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <streams/interface_stream.h>
+#include <vfs/vfs.h>
+
+#include "sram_blocks.h"
+
+/* Above this many dirty blocks, rewriting the whole file
+ * in one go is cheaper than seeking to each of them */
+#define SRAM_BLOCKS_INPLACE_MAX(num_blocks) ((num_blocks) / 2)
+
+#define SRAM_BLOCKS_PRIME1 0x9E3779B185EBCA87ULL
+#define SRAM_BLOCKS_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define SRAM_BLOCKS_PRIME3 0x165667B19E3779F9ULL
+
+#define SRAM_BLOCKS_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t sram_blocks_load64(const uint8_t *p)
+{
+   uint64_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+/* One lane step. Every part of it is a bijection, so
+ * changing a single word always changes the lane, and
+ * the rotation carries high bits back down, so that
+ * changes in the top bits of two words do not cancel. */
+static uint64_t sram_blocks_round(uint64_t acc, uint64_t word)
+{
+   acc += word * SRAM_BLOCKS_PRIME2;
+   acc  = SRAM_BLOCKS_ROTL(acc, 31);
+   return acc * SRAM_BLOCKS_PRIME1;
+}
+
+uint64_t sram_blocks_hash(const void *data, size_t len)
+{
+   size_t i;
+   const uint8_t *p = (const uint8_t*)data;
+   uint64_t h0      = SRAM_BLOCKS_PRIME1 + SRAM_BLOCKS_PRIME2;
+   uint64_t h1      = SRAM_BLOCKS_PRIME2;
+   uint64_t h2      = 0;
+   uint64_t h3      = 0 - SRAM_BLOCKS_PRIME1;
+   uint64_t h;
+
+   /* Four independent lanes, so the multiplies overlap */
+   for (i = 0; i + 32 <= len; i += 32)
+   {
+      h0 = sram_blocks_round(h0, sram_blocks_load64(p + i));
+      h1 = sram_blocks_round(h1, sram_blocks_load64(p + i + 8));
+      h2 = sram_blocks_round(h2, sram_blocks_load64(p + i + 16));
+      h3 = sram_blocks_round(h3, sram_blocks_load64(p + i + 24));
+   }
+
+   for (; i < len; i++)
+      h0 = sram_blocks_round(h0, p[i]);
+
+   h  = SRAM_BLOCKS_ROTL(h0, 1)  + SRAM_BLOCKS_ROTL(h1, 7)
+      + SRAM_BLOCKS_ROTL(h2, 12) + SRAM_BLOCKS_ROTL(h3, 18);
+   h += (uint64_t)len;
+   h ^= h >> 33;
+   h *= SRAM_BLOCKS_PRIME2;
+   h ^= h >> 29;
+   h *= SRAM_BLOCKS_PRIME3;
+   return h ^ (h >> 32);
+}
+
+static size_t sram_blocks_len(const sram_blocks_t *blocks, size_t i)
+{
+   size_t offset = i * SRAM_BLOCK_SIZE;
+   return (blocks->size - offset < SRAM_BLOCK_SIZE)
+      ? blocks->size - offset : SRAM_BLOCK_SIZE;
+}
+
+bool sram_blocks_init(sram_blocks_t *blocks, const void *data, size_t size)
+{
+   size_t i;
+
+   memset(blocks, 0, sizeof(*blocks));
+
+   blocks->size       = size;
+   blocks->num_blocks = (size + SRAM_BLOCK_SIZE - 1) / SRAM_BLOCK_SIZE;
+   blocks->shadow     = (uint8_t*)malloc(size);
+   blocks->staging    = (uint8_t*)malloc(size);
+   blocks->hashes     = (uint64_t*)malloc(
+         blocks->num_blocks * sizeof(*blocks->hashes));
+   blocks->dirty      = (uint8_t*)calloc(blocks->num_blocks, 1);
+
+   if (     !blocks->shadow || !blocks->staging
+         || !blocks->hashes || !blocks->dirty)
+   {
+      sram_blocks_free(blocks);
+      return false;
+   }
+
+   memcpy(blocks->shadow, data, size);
+
+   for (i = 0; i < blocks->num_blocks; i++)
+      blocks->hashes[i] = sram_blocks_hash(
+            blocks->shadow + i * SRAM_BLOCK_SIZE, sram_blocks_len(blocks, i));
+
+   return true;
+}
+
+void sram_blocks_free(sram_blocks_t *blocks)
+{
+   free(blocks->shadow);
+   free(blocks->staging);
+   free(blocks->hashes);
+   free(blocks->dirty);
+   blocks->shadow  = NULL;
+   blocks->staging = NULL;
+   blocks->hashes  = NULL;
+   blocks->dirty   = NULL;
+}
+
+bool sram_blocks_changed(sram_blocks_t *blocks, const void *data,
+      size_t max_blocks, bool *done)
+{
+   const uint8_t *src = (const uint8_t*)data;
+   size_t i           = blocks->scan_pos;
+   size_t end         = (max_blocks < blocks->num_blocks - i)
+      ? i + max_blocks : blocks->num_blocks;
+   bool changed       = false;
+
+   for (; i < end && !changed; i++)
+      changed = sram_blocks_hash(src + i * SRAM_BLOCK_SIZE,
+            sram_blocks_len(blocks, i)) != blocks->hashes[i];
+
+   *done            = changed || i >= blocks->num_blocks;
+   blocks->scan_pos = *done ? 0 : i;
+
+   return changed;
+}
+
+void sram_blocks_capture(sram_blocks_t *blocks, const void *data)
+{
+   memcpy(blocks->staging, data, blocks->size);
+}
+
+size_t sram_blocks_update(sram_blocks_t *blocks)
+{
+   size_t i;
+   size_t changed  = 0;
+   uint8_t *shadow = blocks->staging;
+
+   for (i = 0; i < blocks->num_blocks; i++)
+   {
+      uint64_t hash = sram_blocks_hash(shadow + i * SRAM_BLOCK_SIZE,
+            sram_blocks_len(blocks, i));
+
+      if (hash == blocks->hashes[i])
+         continue;
+
+      blocks->hashes[i] = hash;
+      changed++;
+
+      if (!blocks->dirty[i])
+      {
+         blocks->dirty[i] = 1;
+         blocks->num_dirty++;
+      }
+   }
+
+   /* Blocks still dirty from a failed write are as
+    * recent in the capture as anything else */
+   blocks->staging  = blocks->shadow;
+   blocks->shadow   = shadow;
+   blocks->scan_pos = 0;
+
+   return changed;
+}
+
+static void sram_blocks_sync(RFILE *file)
+{
+#ifdef SRAM_BLOCKS_FSYNC
+   libretro_vfs_implementation_file *handle =
+      filestream_get_vfs_handle(file);
+#endif
+
+   filestream_flush(file);
+
+#ifdef SRAM_BLOCKS_FSYNC
+   if (handle)
+      fsync(handle->fp ? fileno(handle->fp) : handle->fd);
+#endif
+}
+
+static void sram_blocks_clear(sram_blocks_t *blocks)
+{
+   memset(blocks->dirty, 0, blocks->num_blocks);
+   blocks->num_dirty = 0;
+   blocks->synced    = true;
+}
+
+static bool sram_blocks_write_inplace(sram_blocks_t *blocks,
+      const char *path)
+{
+   size_t i;
+   uint64_t written = 0;
+   RFILE *file      = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   if (filestream_get_size(file) != (int64_t)blocks->size)
+   {
+      filestream_close(file);
+      return false;
+   }
+
+   for (i = 0; i < blocks->num_blocks; i++)
+   {
+      size_t run = 0;
+      size_t len;
+
+      if (!blocks->dirty[i])
+         continue;
+
+      /* Neighbouring dirty blocks go in one write */
+      while (i + run < blocks->num_blocks && blocks->dirty[i + run])
+         run++;
+
+      len = (i + run == blocks->num_blocks)
+         ? blocks->size - i * SRAM_BLOCK_SIZE
+         : run * SRAM_BLOCK_SIZE;
+
+      if (     filestream_seek(file, (int64_t)(i * SRAM_BLOCK_SIZE),
+                  RETRO_VFS_SEEK_POSITION_START) < 0
+            || filestream_write(file,
+                  blocks->shadow + i * SRAM_BLOCK_SIZE,
+                  (int64_t)len) != (int64_t)len)
+      {
+         filestream_close(file);
+         /* Part of the file may be newer than the rest */
+         blocks->synced = false;
+         return false;
+      }
+
+      written += len;
+      i       += run - 1;
+   }
+
+   sram_blocks_sync(file);
+   filestream_close(file);
+
+   blocks->bytes_written += written;
+   blocks->writes++;
+   return true;
+}
+
+static bool sram_blocks_write_replace(sram_blocks_t *blocks,
+      const char *path, bool compress)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   bool ok = false;
+
+   strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   if (compress)
+   {
+      intfstream_t *file = intfstream_open_rzip_file(tmp_path,
+            RETRO_VFS_FILE_ACCESS_WRITE);
+
+      if (file)
+      {
+         ok = intfstream_write(file, blocks->shadow, blocks->size)
+            == (int64_t)blocks->size;
+         intfstream_flush(file);
+         intfstream_close(file);
+         free(file);
+      }
+   }
+   else
+   {
+      RFILE *file = filestream_open(tmp_path,
+            RETRO_VFS_FILE_ACCESS_WRITE,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      if (file)
+      {
+         ok = filestream_write(file, blocks->shadow, blocks->size)
+            == (int64_t)blocks->size;
+         sram_blocks_sync(file);
+         filestream_close(file);
+      }
+   }
+
+   /* Not every platform replaces an existing file
+    * on rename, those lose the atomicity */
+   if (ok && filestream_rename(tmp_path, path) != 0)
+   {
+      filestream_delete(path);
+      ok = filestream_rename(tmp_path, path) == 0;
+   }
+
+   if (!ok)
+   {
+      filestream_delete(tmp_path);
+      return false;
+   }
+
+   blocks->bytes_written += blocks->size;
+   blocks->writes++;
+   blocks->full_writes++;
+   return true;
+}
+
+bool sram_blocks_write(sram_blocks_t *blocks, const char *path,
+      bool compress)
+{
+   if (blocks->synced && !blocks->num_dirty)
+      return true;
+
+   if (     blocks->synced
+         && !compress
+         && blocks->num_dirty <= SRAM_BLOCKS_INPLACE_MAX(blocks->num_blocks)
+         && sram_blocks_write_inplace(blocks, path))
+   {
+      sram_blocks_clear(blocks);
+      return true;
+   }
+
+   if (!sram_blocks_write_replace(blocks, path, compress))
+      return false;
+
+   sram_blocks_clear(blocks);
+   return true;
+}
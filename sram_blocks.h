@@ -0,0 +1,134 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SRAM_BLOCKS_H
+#define _SRAM_BLOCKS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Dirty block tracking for save RAM autosave.
+ *
+ * The save RAM is split in fixed blocks, each with the
+ * hash of its last saved contents, kept in a shadow
+ * buffer. Changes are looked for a few blocks at a time.
+ * Once one is found, the whole save RAM is captured with
+ * a single copy, the only step that needs it to hold
+ * still, and the captured blocks whose hash changed are
+ * flagged. A write then updates only the flagged blocks
+ * of the file, in place, or replaces the file atomically
+ * with a temporary one when that is not possible. */
+
+#define SRAM_BLOCK_SIZE 4096
+
+typedef struct sram_blocks
+{
+   uint8_t *shadow;
+   /* Next capture, swapped with the shadow buffer */
+   uint8_t *staging;
+   uint64_t *hashes;
+   uint8_t *dirty;
+   size_t size;
+   size_t num_blocks;
+   size_t num_dirty;
+   /* Block the next sram_blocks_changed() call starts at */
+   size_t scan_pos;
+   /* Totals over the lifetime of the tracker */
+   uint64_t bytes_written;
+   unsigned writes;
+   unsigned full_writes;
+   /* The file matches the shadow buffer outside of
+    * the dirty blocks */
+   bool synced;
+} sram_blocks_t;
+
+/* 64-bit hash of @len bytes of @data */
+uint64_t sram_blocks_hash(const void *data, size_t len);
+
+/**
+ * sram_blocks_init:
+ * @blocks              : Tracker to initialize.
+ * @data                : Save RAM.
+ * @size                : Size of @data in bytes.
+ *
+ * Takes @data as the last saved contents.
+ *
+ * Returns: false on allocation failure.
+ **/
+bool sram_blocks_init(sram_blocks_t *blocks, const void *data, size_t size);
+
+void sram_blocks_free(sram_blocks_t *blocks);
+
+/**
+ * sram_blocks_changed:
+ * @blocks              : Tracker.
+ * @data                : Save RAM.
+ * @max_blocks          : Blocks to hash at most.
+ * @done                : Set once the pass is over, at the first
+ *                        changed block or after the last one.
+ *
+ * Hashes the next @max_blocks blocks of @data, resuming
+ * where the previous call stopped, without copying or
+ * flagging anything. Lets a caller spread change
+ * detection over several short slices.
+ *
+ * Returns: true if one of the hashed blocks changed.
+ **/
+bool sram_blocks_changed(sram_blocks_t *blocks, const void *data,
+      size_t max_blocks, bool *done);
+
+/* Copies all of @data for sram_blocks_update(). @data
+ * must not change meanwhile, so that the file is always
+ * a snapshot of one point in time. */
+void sram_blocks_capture(sram_blocks_t *blocks, const void *data);
+
+/**
+ * sram_blocks_update:
+ * @blocks              : Tracker.
+ *
+ * Makes the last capture the shadow buffer and flags the
+ * blocks whose hash changed. Does not touch the save RAM.
+ *
+ * Returns: number of blocks that changed.
+ **/
+size_t sram_blocks_update(sram_blocks_t *blocks);
+
+/**
+ * sram_blocks_write:
+ * @blocks              : Tracker.
+ * @path                : Save file.
+ * @compress            : Write @path as an RZIP file.
+ *
+ * Brings @path up to date with the shadow buffer. The
+ * dirty blocks of an uncompressed file already in sync
+ * are written in place and flushed to disk, anything
+ * else writes the whole buffer to a temporary file that
+ * then replaces @path. The file is never truncated in
+ * place. Dirty flags are kept on failure, so the next
+ * call tries again.
+ *
+ * Returns: true if @path is up to date.
+ **/
+bool sram_blocks_write(sram_blocks_t *blocks, const char *path,
+      bool compress);
+
+RETRO_END_DECLS
+
+#endif
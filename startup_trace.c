@@ -0,0 +1,200 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+
+#include <libretro.h>
+#include <retro_miscellaneous.h>
+#include <compat/strl.h>
+#include <string/stdstring.h>
+#include <streams/file_stream.h>
+#include <features/features_cpu.h>
+
+#include "startup_trace.h"
+#include "verbosity.h"
+
+typedef struct
+{
+   const char *ident;
+   retro_time_t start;
+   retro_time_t end;    /* -1 while phase is open */
+   unsigned depth;
+   bool mark;
+} startup_trace_phase_t;
+
+typedef struct
+{
+   startup_trace_phase_t phases[STARTUP_TRACE_MAX_PHASES];
+   char path[PATH_MAX_LENGTH];
+   retro_time_t origin;
+   unsigned count;
+   unsigned depth;
+   bool active;
+} startup_trace_state_t;
+
+static startup_trace_state_t startup_trace_st;
+
+void startup_trace_init(void)
+{
+   startup_trace_state_t *st = &startup_trace_st;
+
+   st->origin  = cpu_features_get_time_usec();
+   st->count   = 0;
+   st->depth   = 0;
+   st->path[0] = '\0';
+   st->active  = true;
+}
+
+void startup_trace_set_path(const char *path)
+{
+   startup_trace_state_t *st = &startup_trace_st;
+
+   if (string_is_empty(path))
+      st->path[0] = '\0';
+   else
+      strlcpy(st->path, path, sizeof(st->path));
+}
+
+int startup_trace_begin(const char *ident)
+{
+   startup_trace_state_t *st = &startup_trace_st;
+   startup_trace_phase_t *phase;
+
+   if (!st->active || st->count >= STARTUP_TRACE_MAX_PHASES)
+      return -1;
+
+   phase        = &st->phases[st->count];
+   phase->ident = ident;
+   phase->start = cpu_features_get_time_usec() - st->origin;
+   phase->end   = -1;
+   phase->depth = st->depth++;
+   phase->mark  = false;
+
+   return (int)st->count++;
+}
+
+void startup_trace_end(int phase)
+{
+   startup_trace_state_t *st = &startup_trace_st;
+
+   if (  !st->active
+       || phase < 0
+       || (unsigned)phase >= st->count
+       || st->phases[phase].end >= 0)
+      return;
+
+   st->phases[phase].end = cpu_features_get_time_usec() - st->origin;
+   if (st->depth > 0)
+      st->depth--;
+}
+
+void startup_trace_mark(const char *ident)
+{
+   startup_trace_state_t *st = &startup_trace_st;
+   startup_trace_phase_t *phase;
+
+   if (!st->active || st->count >= STARTUP_TRACE_MAX_PHASES)
+      return;
+
+   phase        = &st->phases[st->count++];
+   phase->ident = ident;
+   phase->start = cpu_features_get_time_usec() - st->origin;
+   phase->end   = phase->start;
+   phase->depth = st->depth;
+   phase->mark  = true;
+}
+
+bool startup_trace_is_active(void)
+{
+   return startup_trace_st.active;
+}
+
+static void startup_trace_write_file(startup_trace_state_t *st)
+{
+   unsigned i;
+   RFILE *file = filestream_open(st->path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+   {
+      RARCH_ERR("[Startup]: Failed to write trace file: \"%s\".\n",
+            st->path);
+      return;
+   }
+
+   filestream_printf(file, "{\"traceEvents\":[\n");
+
+   for (i = 0; i < st->count; i++)
+   {
+      startup_trace_phase_t *phase = &st->phases[i];
+      const char *sep              = (i + 1 < st->count) ? "," : "";
+
+      if (phase->mark)
+         filestream_printf(file,
+               "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"i\","
+               "\"s\":\"g\",\"ts\":%u,\"pid\":1,\"tid\":1}%s\n",
+               phase->ident, (unsigned)phase->start, sep);
+      else
+         filestream_printf(file,
+               "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\","
+               "\"ts\":%u,\"dur\":%u,\"pid\":1,\"tid\":1}%s\n",
+               phase->ident, (unsigned)phase->start,
+               (unsigned)(phase->end - phase->start), sep);
+   }
+
+   filestream_printf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+   filestream_close(file);
+
+   RARCH_LOG("[Startup]: Trace written to \"%s\".\n", st->path);
+}
+
+void startup_trace_finish(void)
+{
+   unsigned i;
+   startup_trace_state_t *st = &startup_trace_st;
+   retro_time_t now;
+
+   if (!st->active)
+      return;
+
+   now        = cpu_features_get_time_usec() - st->origin;
+   st->active = false;
+
+   RARCH_LOG("[Startup]: Timeline (start, duration):\n");
+
+   for (i = 0; i < st->count; i++)
+   {
+      startup_trace_phase_t *phase = &st->phases[i];
+
+      /* Phases interrupted by an error path are
+       * never closed; end them here */
+      if (phase->end < 0)
+         phase->end = now;
+
+      if (phase->mark)
+         RARCH_LOG("[Startup]: %9.2f ms %12s %*s* %s\n",
+               phase->start / 1000.0, "",
+               (int)(phase->depth * 2), "", phase->ident);
+      else
+         RARCH_LOG("[Startup]: %9.2f ms %9.2f ms %*s%s\n",
+               phase->start / 1000.0,
+               (phase->end - phase->start) / 1000.0,
+               (int)(phase->depth * 2), "", phase->ident);
+   }
+
+   if (!string_is_empty(st->path))
+      startup_trace_write_file(st);
+}
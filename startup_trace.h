@@ -0,0 +1,70 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _STARTUP_TRACE_H
+#define _STARTUP_TRACE_H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+#ifndef STARTUP_TRACE_MAX_PHASES
+#define STARTUP_TRACE_MAX_PHASES 64
+#endif
+
+/* Startup trace
+ * Records the duration of each frontend init phase
+ * between process start and the first presented
+ * frame. Once the first frame has been shown the
+ * timeline is printed to the log and, if a path
+ * has been set, written out as a Chrome trace event
+ * file (viewable in chrome://tracing or Perfetto).
+ * Phases may be nested; the trace is recorded once
+ * per process, all calls made after
+ * startup_trace_finish() are ignored. */
+
+/* Resets the trace and sets the reference time
+ * that all timestamps are relative to. Should be
+ * called as early as possible during startup */
+void startup_trace_init(void);
+
+/* Sets the path of the timeline file written by
+ * startup_trace_finish(). NULL or an empty string
+ * disables file output */
+void startup_trace_set_path(const char *path);
+
+/* Opens a phase named 'ident'. 'ident' is not copied,
+ * and must therefore be a string literal.
+ * Returns a handle to be passed to startup_trace_end(),
+ * or -1 if the trace is inactive or full */
+int startup_trace_begin(const char *ident);
+
+/* Closes phase 'phase'. Invalid handles are ignored */
+void startup_trace_end(int phase);
+
+/* Records an instantaneous event named 'ident' */
+void startup_trace_mark(const char *ident);
+
+/* Returns true until startup_trace_finish() is called */
+bool startup_trace_is_active(void);
+
+/* Closes any phases left open, logs the timeline
+ * and writes the trace file (if enabled) */
+void startup_trace_finish(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -0,0 +1,655 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <retro_miscellaneous.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#if defined(HAVE_ZLIB)
+#include <streams/rzip_stream.h>
+#include <streams/trans_stream.h>
+#endif
+
+#include "state_writer.h"
+
+#define STATE_WRITER_SLOTS 2
+
+/* Chunks between the compression and write threads */
+#define STATE_WRITER_CHUNKS 4
+
+/* Uncompressed states are written in slices this big */
+#define STATE_WRITER_SLICE (1024 * 1024)
+
+enum state_writer_slot_state
+{
+   STATE_WRITER_SLOT_FREE = 0,
+   /* Being serialized into by the main thread */
+   STATE_WRITER_SLOT_CAPTURE,
+   STATE_WRITER_SLOT_PENDING,
+   /* Being compressed and written */
+   STATE_WRITER_SLOT_BUSY
+};
+
+struct state_writer_job
+{
+   slock_t *lock;
+   void *backup;
+   size_t backup_size;
+   enum state_writer_result result;
+   bool done;
+};
+
+typedef struct state_writer_slot
+{
+   uint8_t *data;
+   state_writer_job_t *job;
+   size_t capacity;
+   size_t size;
+   unsigned seq;
+   enum state_writer_slot_state state;
+   bool compress;
+   bool backup;
+   char path[PATH_MAX_LENGTH];
+} state_writer_slot_t;
+
+typedef struct state_writer_chunk
+{
+   state_writer_slot_t *slot;
+   const uint8_t *data;
+   /* Compressed output, owned by the chunk */
+   uint8_t *buf;
+   size_t size;
+   bool first;
+   bool last;
+   bool failed;
+} state_writer_chunk_t;
+
+struct state_writer
+{
+   state_writer_slot_t slots[STATE_WRITER_SLOTS];
+   state_writer_chunk_t chunks[STATE_WRITER_CHUNKS];
+   state_writer_stats_t stats;
+   slock_t *lock;
+   /* Each thread sleeps on its own condition, so that
+    * a save only wakes up the thread that has work:
+    * the compression thread for a new capture or room
+    * in the queue, the write thread for a new chunk and
+    * the main thread for a slot freed */
+   scond_t *work_cond;
+   scond_t *chunk_cond;
+   scond_t *cond;
+   sthread_t *compress_thread;
+   sthread_t *write_thread;
+   state_writer_slot_t *capture;
+   /* Chunks queued and written, the queue holds
+    * the difference */
+   unsigned chunk_head;
+   unsigned chunk_tail;
+   unsigned seq;
+   size_t buf_size;
+   bool alive;
+};
+
+static void state_writer_job_finish(state_writer_job_t *job,
+      enum state_writer_result result, void *backup, size_t backup_size)
+{
+   slock_lock(job->lock);
+   job->result      = result;
+   job->backup      = backup;
+   job->backup_size = backup_size;
+   job->done        = true;
+   slock_unlock(job->lock);
+}
+
+bool state_writer_job_done(state_writer_job_t *job,
+      enum state_writer_result *result,
+      void **backup, size_t *backup_size)
+{
+   bool done;
+
+   slock_lock(job->lock);
+   done = job->done;
+   if (done)
+   {
+      *result      = job->result;
+      *backup      = job->backup;
+      *backup_size = job->backup_size;
+      job->backup  = NULL;
+   }
+   slock_unlock(job->lock);
+
+   return done;
+}
+
+void state_writer_job_free(state_writer_job_t *job)
+{
+   if (!job)
+      return;
+
+   if (job->lock)
+      slock_free(job->lock);
+   free(job->backup);
+   free(job);
+}
+
+/* Oldest save waiting, if any */
+static state_writer_slot_t *state_writer_next_pending(
+      state_writer_t *writer)
+{
+   unsigned i;
+   state_writer_slot_t *next = NULL;
+
+   for (i = 0; i < STATE_WRITER_SLOTS; i++)
+   {
+      state_writer_slot_t *slot = &writer->slots[i];
+
+      if (     slot->state == STATE_WRITER_SLOT_PENDING
+            && (!next || (int)(slot->seq - next->seq) < 0))
+         next = slot;
+   }
+
+   return next;
+}
+
+/* Waits for room in the queue, returns the chunk to fill */
+static state_writer_chunk_t *state_writer_chunk_acquire(
+      state_writer_t *writer)
+{
+   state_writer_chunk_t *chunk;
+
+   slock_lock(writer->lock);
+   while (writer->chunk_head - writer->chunk_tail >= STATE_WRITER_CHUNKS)
+      scond_wait(writer->work_cond, writer->lock);
+   chunk = &writer->chunks[writer->chunk_head % STATE_WRITER_CHUNKS];
+   slock_unlock(writer->lock);
+
+   chunk->data   = NULL;
+   chunk->size   = 0;
+   chunk->first  = false;
+   chunk->last   = false;
+   chunk->failed = false;
+   return chunk;
+}
+
+static void state_writer_chunk_publish(state_writer_t *writer)
+{
+   slock_lock(writer->lock);
+   writer->chunk_head++;
+   scond_signal(writer->chunk_cond);
+   slock_unlock(writer->lock);
+}
+
+#if defined(HAVE_ZLIB)
+static bool state_writer_deflate(
+      const struct trans_stream_backend *backend, void *stream,
+      const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size,
+      size_t *written)
+{
+   uint32_t rd = 0;
+   uint32_t wn = 0;
+
+   backend->set_in(stream, in, (uint32_t)in_size);
+   backend->set_out(stream, out, (uint32_t)out_size);
+
+   /* Finishing the stream makes each chunk stand
+    * on its own, as the RZIP format wants */
+   if (!backend->trans(stream, true, &rd, &wn, NULL))
+      return false;
+   if (rd != in_size || !wn || wn > out_size)
+      return false;
+
+   *written = wn;
+   return true;
+}
+#endif
+
+static void state_writer_compress_loop(void *data)
+{
+   state_writer_t *writer = (state_writer_t*)data;
+#if defined(HAVE_ZLIB)
+   const struct trans_stream_backend *backend =
+      trans_stream_get_zlib_deflate_backend();
+   void *stream           = backend->stream_new();
+
+   if (stream)
+      backend->define(stream, "level", RZIP_COMPRESSION_LEVEL);
+#endif
+
+   for (;;)
+   {
+      size_t offset             = 0;
+      state_writer_slot_t *slot = NULL;
+      bool last                 = false;
+
+      slock_lock(writer->lock);
+      while (writer->alive && !(slot = state_writer_next_pending(writer)))
+         scond_wait(writer->work_cond, writer->lock);
+      if (slot)
+         slot->state = STATE_WRITER_SLOT_BUSY;
+      slock_unlock(writer->lock);
+
+      if (!slot)
+         break;
+
+      while (!last)
+      {
+         state_writer_chunk_t *chunk = state_writer_chunk_acquire(writer);
+
+         chunk->slot  = slot;
+         chunk->first = !offset;
+
+#if defined(HAVE_ZLIB)
+         if (slot->compress)
+         {
+            size_t len     = MIN(slot->size - offset,
+                  RZIP_DEFAULT_CHUNK_SIZE);
+            size_t header  = 0;
+            size_t written = 0;
+
+            if (chunk->first)
+            {
+               rzipstream_encode_header(chunk->buf,
+                     RZIP_DEFAULT_CHUNK_SIZE, slot->size);
+               header = RZIP_HEADER_SIZE;
+            }
+
+            if (     !stream
+                  || !state_writer_deflate(backend, stream,
+                        slot->data + offset, len,
+                        chunk->buf + header + RZIP_CHUNK_HEADER_SIZE,
+                        writer->buf_size - header - RZIP_CHUNK_HEADER_SIZE,
+                        &written))
+               chunk->failed = true;
+            else
+            {
+               rzipstream_encode_chunk_header(chunk->buf + header,
+                     (uint32_t)written);
+               chunk->data = chunk->buf;
+               chunk->size = header + RZIP_CHUNK_HEADER_SIZE + written;
+            }
+
+            offset += len;
+         }
+         else
+#endif
+         {
+            /* Written straight from the capture */
+            chunk->data = slot->data + offset;
+            chunk->size = MIN(slot->size - offset, STATE_WRITER_SLICE);
+            offset     += chunk->size;
+         }
+
+         last        = chunk->failed || offset >= slot->size;
+         chunk->last = last;
+         state_writer_chunk_publish(writer);
+      }
+   }
+
+#if defined(HAVE_ZLIB)
+   if (stream)
+      backend->stream_free(stream);
+#endif
+}
+
+static void *state_writer_read_backup(const char *path, size_t *size)
+{
+   void *data  = NULL;
+   int64_t len = 0;
+
+   if (!path_is_valid(path))
+      return NULL;
+
+#if defined(HAVE_ZLIB)
+   /* Handles uncompressed files too */
+   if (!rzipstream_read_file(path, &data, &len))
+#else
+   if (!filestream_read_file(path, &data, &len))
+#endif
+      return NULL;
+
+   *size = (size_t)len;
+   return data;
+}
+
+static void state_writer_finish(state_writer_t *writer,
+      state_writer_slot_t *slot, RFILE *file, const char *tmp_path,
+      bool ok)
+{
+   void *backup       = NULL;
+   size_t backup_size = 0;
+
+   if (file && filestream_close(file) != 0)
+      ok = false;
+
+   if (ok && slot->backup)
+      backup = state_writer_read_backup(slot->path, &backup_size);
+
+   /* Not every platform replaces an existing file
+    * on rename */
+   if (ok && filestream_rename(tmp_path, slot->path) != 0)
+   {
+      filestream_delete(slot->path);
+      ok = filestream_rename(tmp_path, slot->path) == 0;
+   }
+
+   if (!ok)
+   {
+      filestream_delete(tmp_path);
+      free(backup);
+      backup      = NULL;
+      backup_size = 0;
+   }
+
+   /* So that the next capture starts zeroed */
+   memset(slot->data, 0, slot->size);
+
+   state_writer_job_finish(slot->job,
+         ok ? STATE_WRITER_DONE : STATE_WRITER_FAILED, backup, backup_size);
+
+   slock_lock(writer->lock);
+   if (ok)
+   {
+      writer->stats.written++;
+      writer->stats.bytes_written += slot->size;
+   }
+   else
+      writer->stats.failed++;
+   slot->job   = NULL;
+   slot->state = STATE_WRITER_SLOT_FREE;
+   scond_broadcast(writer->cond);
+   slock_unlock(writer->lock);
+}
+
+static void state_writer_write_loop(void *data)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   state_writer_t *writer = (state_writer_t*)data;
+   RFILE *file            = NULL;
+   bool ok                = false;
+
+   tmp_path[0] = '\0';
+
+   for (;;)
+   {
+      state_writer_slot_t *slot;
+      state_writer_chunk_t *chunk;
+      bool last;
+
+      slock_lock(writer->lock);
+      while (writer->alive && writer->chunk_head == writer->chunk_tail)
+         scond_wait(writer->chunk_cond, writer->lock);
+      if (writer->chunk_head == writer->chunk_tail)
+      {
+         slock_unlock(writer->lock);
+         break;
+      }
+      chunk = &writer->chunks[writer->chunk_tail % STATE_WRITER_CHUNKS];
+      slock_unlock(writer->lock);
+
+      slot = chunk->slot;
+      last = chunk->last;
+
+      if (chunk->first)
+      {
+         strlcpy(tmp_path, slot->path, sizeof(tmp_path));
+         strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+         file = filestream_open(tmp_path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE);
+         ok   = file != NULL;
+      }
+
+      if (ok && (chunk->failed || filestream_write(file,
+                  chunk->data, (int64_t)chunk->size) != (int64_t)chunk->size))
+         ok = false;
+
+      /* The compression thread may refill the chunk */
+      slock_lock(writer->lock);
+      writer->chunk_tail++;
+      scond_signal(writer->work_cond);
+      slock_unlock(writer->lock);
+
+      if (last)
+      {
+         state_writer_finish(writer, slot, file, tmp_path, ok);
+         file = NULL;
+      }
+   }
+}
+
+state_writer_t *state_writer_new(void)
+{
+   unsigned i;
+   state_writer_t *writer = (state_writer_t*)calloc(1, sizeof(*writer));
+
+   if (!writer)
+      return NULL;
+
+   writer->alive    = true;
+#if defined(HAVE_ZLIB)
+   /* Room for the file header, a chunk header and
+    * zlib output that can exceed its input */
+   writer->buf_size = RZIP_HEADER_SIZE + RZIP_CHUNK_HEADER_SIZE
+      + RZIP_DEFAULT_CHUNK_SIZE * 2;
+
+   for (i = 0; i < STATE_WRITER_CHUNKS; i++)
+      if (!(writer->chunks[i].buf = (uint8_t*)malloc(writer->buf_size)))
+         goto error;
+#endif
+
+   if (!(writer->lock = slock_new()))
+      goto error;
+   if (!(writer->cond = scond_new()))
+      goto error;
+   if (!(writer->work_cond = scond_new()))
+      goto error;
+   if (!(writer->chunk_cond = scond_new()))
+      goto error;
+   if (!(writer->write_thread = sthread_create(
+               state_writer_write_loop, writer)))
+      goto error;
+   if (!(writer->compress_thread = sthread_create(
+               state_writer_compress_loop, writer)))
+      goto error;
+
+   return writer;
+
+error:
+   state_writer_free(writer);
+   return NULL;
+}
+
+void state_writer_free(state_writer_t *writer)
+{
+   unsigned i;
+
+   if (!writer)
+      return;
+
+   if (writer->lock)
+   {
+      state_writer_wait(writer);
+
+      slock_lock(writer->lock);
+      writer->alive = false;
+      scond_signal(writer->work_cond);
+      scond_signal(writer->chunk_cond);
+      slock_unlock(writer->lock);
+   }
+
+   if (writer->compress_thread)
+      sthread_join(writer->compress_thread);
+   if (writer->write_thread)
+      sthread_join(writer->write_thread);
+
+   if (writer->chunk_cond)
+      scond_free(writer->chunk_cond);
+   if (writer->work_cond)
+      scond_free(writer->work_cond);
+   if (writer->cond)
+      scond_free(writer->cond);
+   if (writer->lock)
+      slock_free(writer->lock);
+
+   for (i = 0; i < STATE_WRITER_CHUNKS; i++)
+      free(writer->chunks[i].buf);
+   for (i = 0; i < STATE_WRITER_SLOTS; i++)
+      free(writer->slots[i].data);
+   free(writer);
+}
+
+void *state_writer_begin(state_writer_t *writer,
+      const char *path, size_t size)
+{
+   unsigned i;
+   retro_time_t start             = 0;
+   state_writer_slot_t *slot      = NULL;
+   state_writer_job_t *replaced   = NULL;
+
+   slock_lock(writer->lock);
+
+   for (;;)
+   {
+      /* A save to the same path that has not started
+       * yet would be overwritten right after anyway */
+      for (i = 0; i < STATE_WRITER_SLOTS && !slot; i++)
+         if (     writer->slots[i].state == STATE_WRITER_SLOT_PENDING
+               && string_is_equal(writer->slots[i].path, path))
+         {
+            slot     = &writer->slots[i];
+            replaced = slot->job;
+         }
+
+      for (i = 0; i < STATE_WRITER_SLOTS && !slot; i++)
+         if (writer->slots[i].state == STATE_WRITER_SLOT_FREE)
+            slot = &writer->slots[i];
+
+      if (slot)
+         break;
+
+      if (!start)
+         start = cpu_features_get_time_usec();
+      scond_wait(writer->cond, writer->lock);
+   }
+
+   slot->state = STATE_WRITER_SLOT_CAPTURE;
+   slot->job   = NULL;
+   if (replaced)
+      writer->stats.replaced++;
+   if (start)
+   {
+      writer->stats.waits++;
+      writer->stats.wait_usec += cpu_features_get_time_usec() - start;
+   }
+   slock_unlock(writer->lock);
+
+   if (replaced)
+      state_writer_job_finish(replaced, STATE_WRITER_REPLACED, NULL, 0);
+
+   if (slot->capacity < size)
+   {
+      free(slot->data);
+      slot->capacity = 0;
+      if (!(slot->data = (uint8_t*)calloc(size, 1)))
+      {
+         slock_lock(writer->lock);
+         slot->state = STATE_WRITER_SLOT_FREE;
+         scond_broadcast(writer->cond);
+         slock_unlock(writer->lock);
+         return NULL;
+      }
+      slot->capacity = size;
+   }
+
+   strlcpy(slot->path, path, sizeof(slot->path));
+   slot->size      = size;
+   writer->capture = slot;
+
+   return slot->data;
+}
+
+state_writer_job_t *state_writer_commit(state_writer_t *writer,
+      bool compress, bool backup)
+{
+   state_writer_slot_t *slot = writer->capture;
+   state_writer_job_t *job   = (state_writer_job_t*)
+      calloc(1, sizeof(*job));
+
+   if (!job || !(job->lock = slock_new()))
+   {
+      free(job);
+      state_writer_cancel(writer);
+      return NULL;
+   }
+
+   writer->capture = NULL;
+
+   slock_lock(writer->lock);
+   slot->job      = job;
+   slot->compress = compress;
+   slot->backup   = backup;
+   slot->seq      = writer->seq++;
+   slot->state    = STATE_WRITER_SLOT_PENDING;
+   writer->stats.saves++;
+   scond_signal(writer->work_cond);
+   slock_unlock(writer->lock);
+
+   return job;
+}
+
+void state_writer_cancel(state_writer_t *writer)
+{
+   state_writer_slot_t *slot = writer->capture;
+
+   if (!slot)
+      return;
+
+   writer->capture = NULL;
+   memset(slot->data, 0, slot->size);
+
+   slock_lock(writer->lock);
+   slot->state = STATE_WRITER_SLOT_FREE;
+   scond_broadcast(writer->cond);
+   slock_unlock(writer->lock);
+}
+
+void state_writer_wait(state_writer_t *writer)
+{
+   unsigned i;
+
+   slock_lock(writer->lock);
+   for (i = 0; i < STATE_WRITER_SLOTS; i++)
+   {
+      /* The capture in progress, if any, is ours */
+      while (     writer->slots[i].state == STATE_WRITER_SLOT_PENDING
+               || writer->slots[i].state == STATE_WRITER_SLOT_BUSY)
+         scond_wait(writer->cond, writer->lock);
+   }
+   slock_unlock(writer->lock);
+}
+
+void state_writer_get_stats(state_writer_t *writer,
+      state_writer_stats_t *stats)
+{
+   slock_lock(writer->lock);
+   *stats = writer->stats;
+   slock_unlock(writer->lock);
+}
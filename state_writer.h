@@ -0,0 +1,139 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _STATE_WRITER_H
+#define _STATE_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Pipelined save state writer.
+ *
+ * The main thread serializes each save state straight
+ * into one of two capture buffers and moves on. A
+ * compression thread turns the oldest pending capture
+ * into RZIP chunks, or plain slices of the buffer, and
+ * hands them over a short queue to a write thread that
+ * streams them to a temporary file, which then replaces
+ * the state file. Either thread waits on the queue when
+ * the other one falls behind.
+ *
+ * A capture for a path that already has a save waiting
+ * takes over its buffer, and the older save is dropped.
+ * The main thread only waits when both buffers hold
+ * saves to other paths. */
+
+enum state_writer_result
+{
+   STATE_WRITER_DONE = 0,
+   STATE_WRITER_FAILED,
+   /* A newer save to the same path took its place */
+   STATE_WRITER_REPLACED
+};
+
+typedef struct state_writer state_writer_t;
+typedef struct state_writer_job state_writer_job_t;
+
+typedef struct state_writer_stats
+{
+   /* Time the main thread spent waiting for a buffer */
+   retro_time_t wait_usec;
+   uint64_t bytes_written;
+   unsigned saves;
+   unsigned written;
+   unsigned replaced;
+   unsigned failed;
+   unsigned waits;
+} state_writer_stats_t;
+
+state_writer_t *state_writer_new(void);
+
+/* Finishes every save, then stops the threads */
+void state_writer_free(state_writer_t *writer);
+
+/**
+ * state_writer_begin:
+ * @writer              : Writer.
+ * @path                : State file.
+ * @size                : Size of the serialized state.
+ *
+ * Picks the buffer the next save to @path is serialized
+ * into. Waits if none is available. The buffer is
+ * zeroed, or holds an older capture of the same state
+ * it replaces. Must be followed by state_writer_commit()
+ * or state_writer_cancel().
+ *
+ * Returns: buffer of at least @size bytes, NULL on
+ * allocation failure.
+ **/
+void *state_writer_begin(state_writer_t *writer,
+      const char *path, size_t size);
+
+/**
+ * state_writer_commit:
+ * @writer              : Writer.
+ * @compress            : Write an RZIP file.
+ * @backup              : Read the contents @path had before
+ *                        the save back, uncompressed.
+ *
+ * Queues the buffer from state_writer_begin().
+ *
+ * Returns: job to follow the save with, to be freed with
+ * state_writer_job_free() once state_writer_job_done()
+ * returns true, or NULL on allocation failure, in which
+ * case nothing is queued.
+ **/
+state_writer_job_t *state_writer_commit(state_writer_t *writer,
+      bool compress, bool backup);
+
+/* Releases the buffer from state_writer_begin() unsaved */
+void state_writer_cancel(state_writer_t *writer);
+
+/* Waits until every save is over */
+void state_writer_wait(state_writer_t *writer);
+
+void state_writer_get_stats(state_writer_t *writer,
+      state_writer_stats_t *stats);
+
+/**
+ * state_writer_job_done:
+ * @job                 : Job from state_writer_commit().
+ * @result              : Outcome of the save.
+ * @backup              : Previous contents of the file, if
+ *                        asked for and there were any. Owned
+ *                        by the caller from then on.
+ * @backup_size         : Size of @backup.
+ *
+ * Does not wait and does not need the writer, which may
+ * have been freed already.
+ *
+ * Returns: true once the save is over, filling in the
+ * rest of the arguments.
+ **/
+bool state_writer_job_done(state_writer_job_t *job,
+      enum state_writer_result *result,
+      void **backup, size_t *backup_size);
+
+void state_writer_job_free(state_writer_job_t *job);
+
+RETRO_END_DECLS
+
+#endif
@@ -46,6 +46,24 @@
 #include "../config.h"
 #endif
 
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <signal.h>
+#define CONTENT_FILE_MMAP
+/* Content files smaller than this are always
+ * read into memory */
+#define CONTENT_FILE_MMAP_MIN_SIZE (1024 * 1024)
+/* Content files mapped at once; further files
+ * are read into memory */
+#define CONTENT_FILE_MMAP_MAX 8
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
 #include <boolean.h>
 
 #include <encodings/crc32.h>
@@ -282,6 +300,216 @@ bool content_file_override_set(
    return true;
 }
 
+#ifdef CONTENT_FILE_MMAP
+/* Truncating a file while it is mapped turns accesses
+ * past its new end into SIGBUS. Live mappings are
+ * registered here, so that the SIGBUS handler can back
+ * the lost pages with zeroes instead: the core reads
+ * garbage rather than taking RetroArch down. Any other
+ * SIGBUS is passed on */
+typedef struct
+{
+   uint8_t *volatile start;
+   volatile size_t len;
+} content_file_mmap_region_t;
+
+static content_file_mmap_region_t content_file_mmap_regions[CONTENT_FILE_MMAP_MAX];
+static struct sigaction content_file_mmap_prev_sigbus;
+static size_t content_file_mmap_page_size               = 0;
+static volatile sig_atomic_t content_file_mmap_truncated = 0;
+
+static void content_file_mmap_sigbus(int sig, siginfo_t *info, void *ctx)
+{
+   size_t i;
+   uint8_t *addr = (uint8_t*)info->si_addr;
+
+   for (i = 0; i < CONTENT_FILE_MMAP_MAX; i++)
+   {
+      uint8_t *start = content_file_mmap_regions[i].start;
+      size_t len     = content_file_mmap_regions[i].len;
+
+      if (start && addr >= start && addr < start + len)
+      {
+         uint8_t *page = (uint8_t*)((uintptr_t)addr
+               & ~(uintptr_t)(content_file_mmap_page_size - 1));
+
+         /* POSIX does not list mmap() as async-signal-safe,
+          * but on the systems HAVE_MMAP is set for (Linux,
+          * Android, the BSDs, macOS) it is a thin wrapper
+          * around the system call that takes no userspace
+          * lock the interrupted thread could be holding.
+          * Userspace fault handlers commonly rely on this */
+         if (mmap(page, (size_t)(start + len - page),
+                  PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                  -1, 0) != MAP_FAILED)
+         {
+            content_file_mmap_truncated = 1;
+            return;
+         }
+      }
+   }
+
+   if (content_file_mmap_prev_sigbus.sa_flags & SA_SIGINFO)
+   {
+      if (content_file_mmap_prev_sigbus.sa_sigaction)
+      {
+         content_file_mmap_prev_sigbus.sa_sigaction(sig, info, ctx);
+         return;
+      }
+   }
+   else if (content_file_mmap_prev_sigbus.sa_handler != SIG_DFL
+         && content_file_mmap_prev_sigbus.sa_handler != SIG_IGN)
+   {
+      content_file_mmap_prev_sigbus.sa_handler(sig);
+      return;
+   }
+
+   /* Fault again with the default action */
+   signal(SIGBUS, SIG_DFL);
+}
+
+static bool content_file_mmap_register(uint8_t *start, size_t len)
+{
+   size_t i;
+
+   if (!content_file_mmap_page_size)
+   {
+      struct sigaction sa;
+      long page_size = sysconf(_SC_PAGESIZE);
+
+      if (page_size <= 0)
+         return false;
+
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_sigaction = content_file_mmap_sigbus;
+      sa.sa_flags     = SA_SIGINFO;
+      sigemptyset(&sa.sa_mask);
+
+      if (sigaction(SIGBUS, &sa, &content_file_mmap_prev_sigbus) != 0)
+         return false;
+
+      content_file_mmap_page_size = (size_t)page_size;
+   }
+
+   for (i = 0; i < CONTENT_FILE_MMAP_MAX; i++)
+   {
+      if (!content_file_mmap_regions[i].start)
+      {
+         /* Length first: the handler only looks
+          * at regions with a start address */
+         content_file_mmap_regions[i].len   = len;
+         content_file_mmap_regions[i].start = start;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/* Returns true if other content is still mapped */
+static bool content_file_mmap_unregister(uint8_t *start)
+{
+   size_t i;
+   bool mapped = false;
+
+   for (i = 0; i < CONTENT_FILE_MMAP_MAX; i++)
+   {
+      if (content_file_mmap_regions[i].start == start)
+         content_file_mmap_regions[i].start = NULL;
+      else if (content_file_mmap_regions[i].start)
+         mapped = true;
+   }
+
+   return mapped;
+}
+
+/* Maps content file into memory. The mapping is
+ * copy-on-write, in case a core writes to the
+ * (nominally const) content buffer, and is followed
+ * by a NUL byte, as a buffer from filestream_read_file()
+ * would be: the file is mapped over an anonymous
+ * mapping one byte longer. Returns NULL if the file
+ * cannot be mapped, or is too small for mapping to
+ * be worthwhile */
+static void *content_file_mmap(const char *path, int64_t *size)
+{
+   struct stat st;
+   void *data = NULL;
+   int fd     = open(path, O_RDONLY);
+
+   if (fd < 0)
+      return NULL;
+
+   if (   (fstat(fd, &st) == 0)
+       && S_ISREG(st.st_mode)
+       && (st.st_size >= CONTENT_FILE_MMAP_MIN_SIZE)
+       && ((uint64_t)st.st_size < (uint64_t)SIZE_MAX))
+   {
+      size_t len = (size_t)st.st_size;
+
+      /* Whatever follows the end of the file in its
+       * last page reads as zero; if the file ends on
+       * a page boundary, the NUL byte comes from the
+       * anonymous page after it */
+      data = mmap(NULL, len + 1, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+      if (data == MAP_FAILED)
+         data = NULL;
+      else if (   (mmap(data, len, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+               || !content_file_mmap_register((uint8_t*)data, len + 1))
+      {
+         munmap(data, len + 1);
+         data = NULL;
+      }
+      else
+         *size = (int64_t)st.st_size;
+   }
+
+   close(fd);
+   return data;
+}
+
+static void content_file_munmap(void *data, size_t size)
+{
+   bool mapped = content_file_mmap_unregister((uint8_t*)data);
+
+   munmap(data, size + 1);
+
+   /* Hand SIGBUS back once no content is mapped,
+    * the handler is installed again with the next
+    * mapping */
+   if (!mapped && content_file_mmap_page_size)
+   {
+      sigaction(SIGBUS, &content_file_mmap_prev_sigbus, NULL);
+      content_file_mmap_page_size = 0;
+   }
+
+   if (content_file_mmap_truncated)
+   {
+      RARCH_ERR("[Content]: Content file was truncated while in use.\n");
+      content_file_mmap_truncated = 0;
+   }
+}
+#endif
+
+static void content_file_data_free(void *data, size_t size,
+      bool mapped)
+{
+   if (!data)
+      return;
+#ifdef CONTENT_FILE_MMAP
+   if (mapped)
+   {
+      content_file_munmap(data, size);
+      return;
+   }
+#endif
+   free(data);
+}
+
 /* Frees any content data that is not flagged
  * as 'persistent'. Should be called after
  * content_file_load() */
@@ -300,10 +528,12 @@ static void content_file_list_free_transient_data(
       if (file_info->data &&
           !file_info->persistent_data)
       {
-         free((void*)file_info->data);
+         content_file_data_free(file_info->data,
+               file_info->data_size, file_info->data_mapped);
 
-         file_info->data      = NULL;
-         file_info->data_size = 0;
+         file_info->data        = NULL;
+         file_info->data_size   = 0;
+         file_info->data_mapped = false;
       }
    }
 }
@@ -356,12 +586,11 @@ static void content_file_list_free_entry(
       file_info->meta = NULL;
    }
 
-   if (file_info->data)
-   {
-      free((void*)file_info->data);
-      file_info->data = NULL;
-   }
-   file_info->data_size = 0;
+   content_file_data_free(file_info->data,
+         file_info->data_size, file_info->data_mapped);
+   file_info->data        = NULL;
+   file_info->data_size   = 0;
+   file_info->data_mapped = false;
 
    file_info->file_in_archive = false;
    file_info->persistent_data = false;
@@ -493,12 +722,14 @@ static const char *content_file_list_append_temporary(
    return NULL;
 }
 
-/* Note: Takes ownership of supplied 'data' buffer */
+/* Note: Takes ownership of supplied 'data' buffer
+ * (a file mapping if 'data_mapped' is true) */
 static bool content_file_list_set_info(
       content_file_list_t *file_list,
       const char *path,
       void *data,
       size_t data_size,
+      bool data_mapped,
       bool persistent_data,
       size_t idx)
 {
@@ -549,6 +780,7 @@ static bool content_file_list_set_info(
 
    file_info->data            = data;
    file_info->data_size       = data_size;
+   file_info->data_mapped     = data_mapped;
    file_info->persistent_data = persistent_data;
 
    /* Assign paths
@@ -690,15 +922,41 @@ static bool content_file_list_set_info(
 #define CONTENT_FILE_ATTR_GET_REQUIRED(attr)      ((attr.i & 4) != 0)
 #define CONTENT_FILE_ATTR_GET_PERSISTENT(attr)    ((attr.i & 8) != 0)
 
+#ifdef CONTENT_FILE_MMAP
+/* Returns true if a soft patch will be applied
+ * to the first content file (patching replaces
+ * the content buffer, so it cannot be mapped) */
+static bool content_file_has_patch(
+      content_information_ctx_t *content_ctx)
+{
+#ifdef HAVE_PATCH
+   if (content_ctx->patch_is_blocked)
+      return false;
+
+   return (!string_is_empty(content_ctx->name_ips)
+            && path_is_valid(content_ctx->name_ips))
+       || (!string_is_empty(content_ctx->name_bps)
+            && path_is_valid(content_ctx->name_bps))
+       || (!string_is_empty(content_ctx->name_ups)
+            && path_is_valid(content_ctx->name_ups));
+#else
+   return false;
+#endif
+}
+#endif
+
 /**
  * content_file_load_into_memory:
  * @content_path : path of the content file.
  * @data         : buffer into which the content file will be read.
  * @data_size    : size of the resultant content buffer.
+ * @data_mapped  : set to true if @data is a file mapping
+ *                 rather than a heap buffer.
  *
  * Reads the content file into memory. Also performs soft patching
  * (see patch_content function) if soft patching has not been
- * blocked by the user.
+ * blocked by the user. Large, uncompressed and unpatched content
+ * files are mapped instead of read, where supported.
  *
  * Returns: true if successful, false on error.
  **/
@@ -710,17 +968,53 @@ static bool content_file_load_into_memory(
       size_t idx,
       enum rarch_content_type first_content_type,
       uint8_t **data,
-      size_t *data_size)
+      size_t *data_size,
+      bool *data_mapped)
 {
    uint8_t *content_data = NULL;
    int64_t content_size  = 0;
 
-   *data      = NULL;
-   *data_size = 0;
+   *data        = NULL;
+   *data_size   = 0;
+   *data_mapped = false;
 
    RARCH_LOG("[Content]: %s: \"%s\".\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), content_path);
 
+#ifdef CONTENT_FILE_MMAP
+   if (    !content_compressed
+       && !(   (idx == 0)
+            && (first_content_type == RARCH_CONTENT_NONE)
+            && content_file_has_patch(content_ctx)))
+   {
+      if ((content_data = (uint8_t*)content_file_mmap(
+                  content_path, &content_size)))
+      {
+         RARCH_LOG("[Content]: Mapped %u bytes.\n",
+               (unsigned)content_size);
+
+         /* CRC calculation is deferred, as for any
+          * other uncompressed, unpatched content */
+         if (idx == 0)
+         {
+            if (first_content_type == RARCH_CONTENT_NONE)
+            {
+               strlcpy(p_content->pending_rom_crc_path, content_path,
+                     sizeof(p_content->pending_rom_crc_path));
+               p_content->pending_rom_crc = true;
+            }
+            else
+               p_content->rom_crc = 0;
+         }
+
+         *data        = content_data;
+         *data_size   = (size_t)content_size;
+         *data_mapped = true;
+         return true;
+      }
+   }
+#endif
+
    /* Read content from file into memory buffer */
 #ifdef HAVE_COMPRESSION
    if (content_compressed)
@@ -770,7 +1064,7 @@ static bool content_file_load_into_memory(
           * actually needed */
          if (content_compressed || has_patch)
          {
-            p_content->rom_crc = encoding_crc32(0, content_data,
+            p_content->rom_crc = encoding_crc32_parallel(0, content_data,
                   (size_t)content_size);
             RARCH_LOG("[Content]: CRC32: 0x%x.\n",
                   (unsigned)p_content->rom_crc);
@@ -984,6 +1278,7 @@ static bool content_file_load(
       const char *content_path = NULL;
       uint8_t *content_data    = NULL;
       size_t content_size      = 0;
+      bool content_mapped      = false;
       const char *valid_exts   = special ?
             special->roms[i].valid_extensions :
                   content_ctx->valid_extensions;
@@ -1021,7 +1316,7 @@ static bool content_file_load(
             if (!content_file_load_into_memory(
                   content_ctx, p_content, content_path,
                   content_compressed, i, first_content_type,
-                  &content_data, &content_size))
+                  &content_data, &content_size, &content_mapped))
             {
                snprintf(msg, sizeof(msg), "%s \"%s\"\n",
                      msg_hash_to_str(MSG_COULD_NOT_READ_CONTENT_FILE),
@@ -1137,12 +1432,11 @@ static bool content_file_load(
       /* Add current entry to content file list */
       if (!content_file_list_set_info(
             p_content->content_list,
-            content_path, content_data, content_size,
+            content_path, content_data, content_size, content_mapped,
             CONTENT_FILE_ATTR_GET_PERSISTENT(content->elems[i].attr), i))
       {
          RARCH_LOG("[Content]: Failed to process content file: \"%s\".\n", content_path);
-         if (content_data)
-            free((void*)content_data);
+         content_file_data_free(content_data, content_size, content_mapped);
          *error_enum = MSG_FAILED_TO_LOAD_CONTENT;
          return false;
       }
@@ -74,7 +74,6 @@ struct bps_data
    size_t source_relative_offset;
    size_t target_relative_offset;
    size_t output_offset;
-   uint32_t modify_checksum;
    uint32_t source_checksum;
    uint32_t target_checksum;
 };
@@ -90,7 +89,6 @@ struct ups_data
    unsigned patch_offset;
    unsigned source_offset;
    unsigned target_offset;
-   unsigned patch_checksum;
    unsigned source_checksum;
    unsigned target_checksum;
 };
@@ -98,35 +96,82 @@ struct ups_data
 typedef enum patch_error (*patch_func_t)(const uint8_t*, uint64_t,
       const uint8_t*, uint64_t, uint8_t**, uint64_t*);
 
+/* Checksums are not updated as the patch is applied,
+ * but computed over whole buffers once the patch has
+ * been applied: the patch checksum covers everything
+ * that has been read up to the embedded checksum,
+ * source and target checksums cover the whole buffers */
+
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data         = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = ~(encoding_crc32(
-         ~bps->modify_checksum, &data, 1));
-   return data;
+   if (bps->modify_offset < bps->modify_length)
+      return bps->modify_data[bps->modify_offset++];
+   return 0x00;
 }
 
-static uint64_t bps_decode(struct bps_data *bps)
+/* Decodes a variable length number. Fails if the
+ * number runs past the end of the patch or does not
+ * fit in 64 bits, which would otherwise leave the
+ * caller reading zeroes forever */
+static bool bps_decode(struct bps_data *bps, uint64_t *out)
 {
    uint64_t data = 0, shift = 1;
+   unsigned i;
 
-   for (;;)
+   for (i = 0; i < 10; i++)
    {
-      uint8_t x  = bps_read(bps);
+      uint8_t x;
+
+      if (bps->modify_offset >= bps->modify_length)
+         return false;
+
+      x          = bps->modify_data[bps->modify_offset++];
       data      += (x & 0x7f) * shift;
       if (x & 0x80)
-         break;
+      {
+         *out = data;
+         return true;
+      }
       shift    <<= 7;
       data      += shift;
    }
 
-   return data;
+   return false;
 }
 
-static void bps_write(struct bps_data *bps, uint8_t data)
+/* Copies 'length' bytes from target offset 'offset'
+ * to the output offset. The two may overlap, with
+ * the source preceding the output, in which case the
+ * data in between is repeated (as a byte at a time
+ * forward copy would do) */
+static void bps_target_copy(struct bps_data *bps,
+      size_t offset, size_t length)
 {
-   bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = ~(encoding_crc32(~bps->target_checksum, &data, 1));
+   uint8_t *out = bps->target_data + bps->output_offset;
+   uint8_t *in  = bps->target_data + offset;
+
+   if (offset < bps->output_offset)
+   {
+      size_t distance = bps->output_offset - offset;
+
+      while (length)
+      {
+         size_t chunk = (length < distance) ? length : distance;
+         memcpy(out, in, chunk);
+         out         += chunk;
+         length      -= chunk;
+         /* Everything copied so far repeats the
+          * pattern, so the distance can double */
+         distance    += chunk;
+      }
+   }
+   else
+   {
+      /* Reads ahead of the output: not produced by
+       * any known encoder, keep the byte order */
+      while (length--)
+         *out++ = *in++;
+   }
 }
 
 static enum patch_error bps_apply_patch(
@@ -137,9 +182,9 @@ static enum patch_error bps_apply_patch(
    size_t i;
    struct bps_data bps;
    uint32_t checksum               = 0;
-   size_t modify_source_size       = 0;
-   size_t modify_target_size       = 0;
-   size_t modify_markup_size       = 0;
+   uint64_t modify_source_size     = 0;
+   uint64_t modify_target_size     = 0;
+   uint64_t modify_markup_size     = 0;
    uint32_t modify_source_checksum = 0;
    uint32_t modify_target_checksum = 0;
    uint32_t modify_modify_checksum = 0;
@@ -156,9 +201,8 @@ static enum patch_error bps_apply_patch(
    bps.modify_offset          = 0;
    bps.source_offset          = 0;
    bps.target_offset          = 0;
-   bps.modify_checksum        = ~0;
    bps.source_checksum        = 0;
-   bps.target_checksum        = ~0;
+   bps.target_checksum        = 0;
    bps.source_relative_offset = 0;
    bps.target_relative_offset = 0;
    bps.output_offset          = 0;
@@ -169,12 +213,18 @@ static enum patch_error bps_apply_patch(
          (bps_read(&bps) != '1'))
       return PATCH_PATCH_INVALID_HEADER;
 
-   modify_source_size  = bps_decode(&bps);
-   modify_target_size  = bps_decode(&bps);
-   modify_markup_size  = bps_decode(&bps);
+   if (     !bps_decode(&bps, &modify_source_size)
+         || !bps_decode(&bps, &modify_target_size)
+         || !bps_decode(&bps, &modify_markup_size))
+      return PATCH_PATCH_INVALID;
 
-   for (i = 0; i < modify_markup_size; i++)
-      bps_read(&bps);
+   if (     bps.modify_offset > bps.modify_length - 12
+         || modify_markup_size > bps.modify_length - 12 - bps.modify_offset)
+      return PATCH_PATCH_INVALID;
+   bps.modify_offset  += (size_t)modify_markup_size;
+
+   if (modify_target_size > (size_t)-1)
+      return PATCH_TARGET_ALLOC_FAILED;
 
    if (modify_source_size > bps.source_length)
       return PATCH_SOURCE_TOO_SMALL;
@@ -189,34 +239,55 @@ static enum patch_error bps_apply_patch(
       free(*target_data);
       bps.target_data   = prov;
       *target_data      = prov;
-      bps.target_length = modify_target_size;
+      bps.target_length = (size_t)modify_target_size;
    }
 
    while (bps.modify_offset < bps.modify_length - 12)
    {
-      size_t length = bps_decode(&bps);
-      unsigned mode = length & 3;
+      uint64_t data;
+      size_t length;
+      unsigned mode;
+
+      if (!bps_decode(&bps, &data))
+         return PATCH_PATCH_INVALID;
 
-      length = (length >> 2) + 1;
+      mode = data & 3;
+
+      if ((data >> 2) >= modify_target_size - bps.output_offset)
+         return PATCH_PATCH_INVALID;
+
+      length = (size_t)(data >> 2) + 1;
 
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-               bps_write(&bps, bps.source_data[bps.output_offset]);
+            if (bps.output_offset + length > bps.source_length)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.source_data  + bps.output_offset, length);
             break;
 
          case TARGET_READ:
-            while (length--)
-               bps_write(&bps, bps_read(&bps));
+            if (     bps.modify_offset > bps.modify_length - 12
+                  || length > bps.modify_length - 12 - bps.modify_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.modify_data  + bps.modify_offset, length);
+            bps.modify_offset += length;
             break;
 
          case SOURCE_COPY:
          case TARGET_COPY:
          {
-            int    offset = (int)bps_decode(&bps);
-            bool negative = offset & 1;
+            uint64_t data;
+            int    offset;
+            bool negative;
+
+            if (!bps_decode(&bps, &data))
+               return PATCH_PATCH_INVALID;
 
+            offset   = (int)data;
+            negative = offset & 1;
             offset >>= 1;
 
             if (negative)
@@ -225,19 +296,27 @@ static enum patch_error bps_apply_patch(
             if (mode == SOURCE_COPY)
             {
                bps.source_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.source_data[bps.source_offset++]);
+               if (     bps.source_offset > bps.source_length
+                     || length > bps.source_length - bps.source_offset)
+                  return PATCH_PATCH_INVALID;
+               memcpy(bps.target_data + bps.output_offset,
+                     bps.source_data  + bps.source_offset, length);
+               bps.source_offset += length;
             }
             else
             {
                bps.target_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.target_data[bps.target_offset++]);
-               break;
+               if (     bps.target_offset > modify_target_size
+                     || length > modify_target_size - bps.target_offset)
+                  return PATCH_PATCH_INVALID;
+               bps_target_copy(&bps, bps.target_offset, length);
+               bps.target_offset += length;
             }
             break;
          }
       }
+
+      bps.output_offset += length;
    }
 
    for (i = 0; i < 32; i += 8)
@@ -245,13 +324,14 @@ static enum patch_error bps_apply_patch(
    for (i = 0; i < 32; i += 8)
       modify_target_checksum |= bps_read(&bps) << i;
 
-   checksum = ~bps.modify_checksum;
+   checksum = encoding_crc32(0, bps.modify_data, bps.modify_offset);
    for (i = 0; i < 32; i += 8)
       modify_modify_checksum |= bps_read(&bps) << i;
 
-   bps.source_checksum = encoding_crc32(0,
+   bps.source_checksum = encoding_crc32_parallel(0,
          bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
+   bps.target_checksum = encoding_crc32_parallel(0,
+         bps.target_data, (size_t)modify_target_size);
 
    if (bps.source_checksum != modify_source_checksum)
       return PATCH_SOURCE_CHECKSUM_INVALID;
@@ -270,56 +350,83 @@ static enum patch_error bps_apply_patch(
 static uint8_t ups_patch_read(struct ups_data *data)
 {
    if (data && data->patch_offset < data->patch_length)
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum =
-         ~(encoding_crc32(~data->patch_checksum, &n, 1));
-      return n;
-   }
+      return data->patch_data[data->patch_offset++];
    return 0x00;
 }
 
-static uint8_t ups_source_read(struct ups_data *data)
+/* Copies 'length' bytes from source to target. Reads
+ * past the end of the source yield zeroes, writes past
+ * the end of the target are dropped */
+static void ups_copy(struct ups_data *data, unsigned length)
 {
-   if (data && data->source_offset < data->source_length)
+   unsigned source_avail = (data->source_offset < data->source_length)
+      ? data->source_length - data->source_offset : 0;
+   unsigned target_avail = (data->target_offset < data->target_length)
+      ? data->target_length - data->target_offset : 0;
+   unsigned copied       = length;
+
+   if (copied > source_avail)
+      copied = source_avail;
+   if (copied > target_avail)
+      copied = target_avail;
+
+   memcpy(data->target_data + data->target_offset,
+         data->source_data  + data->source_offset, copied);
+
+   /* Source exhausted - pad with zeroes */
+   if (length > copied && target_avail > copied)
    {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum =
-         ~(encoding_crc32(~data->source_checksum, &n, 1));
-      return n;
+      unsigned padding = length - copied;
+      if (padding > target_avail - copied)
+         padding = target_avail - copied;
+      memset(data->target_data + data->target_offset + copied,
+            0, padding);
    }
-   return 0x00;
+
+   data->source_offset += (length < source_avail) ? length : source_avail;
+   data->target_offset += length;
 }
 
-static void ups_target_write(struct ups_data *data, uint8_t n)
+static void ups_xor(struct ups_data *data, uint8_t patch_xor)
 {
+   uint8_t n = 0x00;
 
-   if (data && data->target_offset < data->target_length)
-   {
-      data->target_data[data->target_offset] = n;
-      data->target_checksum =
-         ~(encoding_crc32(~data->target_checksum, &n, 1));
-   }
+   if (data->source_offset < data->source_length)
+      n = data->source_data[data->source_offset++];
 
-   if (data)
-      data->target_offset++;
+   if (data->target_offset < data->target_length)
+      data->target_data[data->target_offset] = patch_xor ^ n;
+
+   data->target_offset++;
 }
 
-static uint64_t ups_decode(struct ups_data *data)
+/* Same encoding, and the same failure cases, as
+ * bps_decode() */
+static bool ups_decode(struct ups_data *data, uint64_t *out)
 {
    uint64_t offset = 0, shift = 1;
+   unsigned i;
 
-   for (;;)
+   for (i = 0; i < 10; i++)
    {
-      uint8_t x = ups_patch_read(data);
-      offset   += (x & 0x7f) * shift;
+      uint8_t x;
+
+      if (data->patch_offset >= data->patch_length)
+         return false;
+
+      x       = data->patch_data[data->patch_offset++];
+      offset += (x & 0x7f) * shift;
 
       if (x & 0x80)
-         break;
+      {
+         *out = offset;
+         return true;
+      }
       shift <<= 7;
       offset += shift;
    }
-   return offset;
+
+   return false;
 }
 
 static enum patch_error ups_apply_patch(
@@ -329,8 +436,8 @@ static enum patch_error ups_apply_patch(
 {
    size_t i;
    struct ups_data data;
-   unsigned source_read_length;
-   unsigned target_read_length;
+   uint64_t source_read_length;
+   uint64_t target_read_length;
    uint32_t patch_result_checksum = 0;
    uint32_t patch_read_checksum   = 0;
    uint32_t source_read_checksum  = 0;
@@ -345,9 +452,8 @@ static enum patch_error ups_apply_patch(
    data.patch_offset    = 0;
    data.source_offset   = 0;
    data.target_offset   = 0;
-   data.patch_checksum  = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
+   data.source_checksum = 0;
+   data.target_checksum = 0;
 
    if (data.patch_length < 18)
       return PATCH_PATCH_INVALID;
@@ -360,8 +466,9 @@ static enum patch_error ups_apply_patch(
       )
       return PATCH_PATCH_INVALID;
 
-   source_read_length = (unsigned)ups_decode(&data);
-   target_read_length = (unsigned)ups_decode(&data);
+   if (     !ups_decode(&data, &source_read_length)
+         || !ups_decode(&data, &target_read_length))
+      return PATCH_PATCH_INVALID;
 
    if (     (data.source_length != source_read_length)
          && (data.source_length != target_read_length))
@@ -370,6 +477,10 @@ static enum patch_error ups_apply_patch(
    *targetlength = (data.source_length == source_read_length ?
          target_read_length : source_read_length);
 
+   /* Lengths are tracked as unsigned */
+   if (*targetlength > (unsigned)-1)
+      return PATCH_PATCH_INVALID;
+
    if (data.target_length < *targetlength)
    {
       uint8_t *prov=(uint8_t*)malloc((size_t)*targetlength);
@@ -384,32 +495,40 @@ static enum patch_error ups_apply_patch(
    
    while (data.patch_offset < data.patch_length - 12)
    {
-      unsigned length = (unsigned)ups_decode(&data);
-      while (length--)
-         ups_target_write(&data, ups_source_read(&data));
+      uint64_t length;
+
+      if (!ups_decode(&data, &length))
+         return PATCH_PATCH_INVALID;
+
+      ups_copy(&data, (unsigned)length);
 
       for (;;)
       {
          uint8_t patch_xor = ups_patch_read(&data);
-         ups_target_write(&data, patch_xor ^ ups_source_read(&data));
+         ups_xor(&data, patch_xor);
          if (patch_xor == 0)
             break;
       }
    }
 
-   while (data.source_offset < data.source_length)
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length)
-      ups_target_write(&data, ups_source_read(&data));
+   if (data.source_offset < data.source_length)
+      ups_copy(&data, data.source_length - data.source_offset);
+   if (data.target_offset < data.target_length)
+      ups_copy(&data, data.target_length - data.target_offset);
 
    for (i = 0; i < 4; i++)
       source_read_checksum |= ups_patch_read(&data) << (i * 8);
    for (i = 0; i < 4; i++)
       target_read_checksum |= ups_patch_read(&data) << (i * 8);
 
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
+   /* Every byte of source and target has been visited
+    * exactly once, in order, by now */
+   patch_result_checksum = encoding_crc32(0,
+         data.patch_data, data.patch_offset);
+   data.source_checksum  = encoding_crc32_parallel(0,
+         data.source_data, data.source_length);
+   data.target_checksum  = encoding_crc32_parallel(0,
+         data.target_data, data.target_length);
 
    for (i = 0; i < 4; i++)
       patch_read_checksum |= ups_patch_read(&data) << (i * 8);
@@ -587,8 +706,9 @@ static enum patch_error ips_apply_patch(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-            (*targetdata)[address++] = patchdata[offset++];
+         memcpy(*targetdata + address, patchdata + offset, length);
+         address += length;
+         offset  += length;
       }
       else /* RLE */
       {
@@ -601,8 +721,8 @@ static enum patch_error ips_apply_patch(
          if (length == 0) /* Illegal */
             break;
 
-         while (length--)
-            (*targetdata)[address++] = patchdata[offset];
+         memset(*targetdata + address, patchdata[offset], length);
+         address += length;
 
          offset++;
       }
@@ -650,11 +770,15 @@ static bool apply_patch_content(uint8_t **buf,
       }
    }
    else
+   {
+      /* Content is left unpatched */
+      free(patched_content);
       RARCH_ERR("%s %s: %s #%u\n",
             msg_hash_to_str(MSG_FAILED_TO_PATCH),
             patch_desc,
             msg_hash_to_str(MSG_ERROR),
             (unsigned)err);
+   }
 
    return true;
 }
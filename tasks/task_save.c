@@ -35,8 +35,10 @@
 #include <rthreads/rthreads.h>
 #include <file/file_path.h>
 #include <retro_miscellaneous.h>
+#include <retro_timers.h>
 #include <string/stdstring.h>
 #include <time/rtime.h>
+#include <features/features_cpu.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../core.h"
@@ -53,6 +55,10 @@
 #include "../content.h"
 #include "../core.h"
 #include "../file_path_special.h"
+#include "../sram_blocks.h"
+#ifdef HAVE_THREADS
+#include "../state_writer.h"
+#endif
 #include "../configuration.h"
 #include "../msg_hash.h"
 #include "../retroarch.h"
@@ -68,6 +74,12 @@
 #define SAVE_STATE_CHUNK 4096
 #endif
 
+/* Save RAM blocks an autosave hashes per lock */
+#define AUTOSAVE_SCAN_BLOCKS 64
+
+/* How often a save state task checks on its save */
+#define SAVE_STATE_POLL_USEC 5000
+
 #define RASTATE_VERSION 1
 #define RASTATE_MEM_BLOCK "MEM "
 #define RASTATE_CHEEVOS_BLOCK "ACHV"
@@ -109,6 +121,10 @@ typedef struct
    ssize_t written;
    ssize_t bytes_read;
    int state_slot;
+#ifdef HAVE_THREADS
+   /* Save queued on the save state writer */
+   state_writer_job_t *job;
+#endif
    char path[PATH_MAX_LENGTH];
    bool load_to_backup_buffer;
    bool autoload;
@@ -132,14 +148,13 @@ struct autosave_st
 
 struct autosave
 {
-   void *buffer;
+   sram_blocks_t blocks;
    const void *retro_buffer;
    const char *path;
    slock_t *lock;
    slock_t *cond_lock;
    scond_t *cond;
    sthread_t *thread;
-   size_t bufsize;
    unsigned interval;
    volatile bool quit;
    bool compress_files;
@@ -164,6 +179,9 @@ static struct ram_save_state_buf ram_buf;
 #ifdef HAVE_THREADS
 /* TODO/FIXME - global state - perhaps move outside this file */
 static struct autosave_st autosave_state;
+
+/* Compresses and writes save states off the main thread */
+static state_writer_t *save_state_writer = NULL;
 #endif
 
 /* TODO/FIXME - global state - perhaps move outside this file */
@@ -192,36 +210,33 @@ static void autosave_thread(void *data)
 
    while (!save->quit)
    {
-      bool differ;
-
-      slock_lock(save->lock);
-      differ = string_is_not_equal_fast(save->buffer, save->retro_buffer,
-            save->bufsize);
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
-      slock_unlock(save->lock);
+      bool changed = false;
+      bool done    = false;
 
-      if (differ)
+      /* The core runs with the lock held, so looking for
+       * changes only takes it for a few blocks at a time */
+      while (!done && !save->quit)
       {
-         intfstream_t *file = NULL;
-
-         /* Should probably deal with this more elegantly. */
-         if (save->compress_files)
-            file = intfstream_open_rzip_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE);
-         else
-            file = intfstream_open_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+         slock_lock(save->lock);
+         changed = sram_blocks_changed(&save->blocks, save->retro_buffer,
+               AUTOSAVE_SCAN_BLOCKS, &done);
+         slock_unlock(save->lock);
+      }
 
-         if (file)
-         {
-            intfstream_write(file, save->buffer, save->bufsize);
-            intfstream_flush(file);
-            intfstream_close(file);
-            free(file);
-         }
+      /* Then everything is copied under one lock, so the
+       * file never mixes two frames, and hashed without it */
+      if (changed)
+      {
+         slock_lock(save->lock);
+         sram_blocks_capture(&save->blocks, save->retro_buffer);
+         slock_unlock(save->lock);
+         sram_blocks_update(&save->blocks);
       }
 
+      if (save->blocks.num_dirty)
+         sram_blocks_write(&save->blocks, save->path,
+               save->compress_files);
+
       slock_lock(save->cond_lock);
 
       if (!save->quit)
@@ -255,30 +270,22 @@ static autosave_t *autosave_new(const char *path,
       const void *data, size_t size,
       unsigned interval, bool compress)
 {
-   void       *buf               = NULL;
    autosave_t *handle            = (autosave_t*)malloc(sizeof(*handle));
    if (!handle)
       return NULL;
 
    handle->quit                  = false;
-   handle->bufsize               = size;
    handle->interval              = interval;
    handle->compress_files        = compress;
    handle->retro_buffer          = data;
    handle->path                  = path;
 
-   buf                           = malloc(size);
-
-   if (!buf)
+   if (!sram_blocks_init(&handle->blocks, data, size))
    {
       free(handle);
       return NULL;
    }
 
-   handle->buffer                = buf;
-
-   memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
-
    handle->lock                  = slock_new();
    handle->cond_lock             = slock_new();
    handle->cond                  = scond_new();
@@ -305,9 +312,7 @@ static void autosave_free(autosave_t *handle)
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
-   if (handle->buffer)
-      free(handle->buffer);
-   handle->buffer = NULL;
+   sram_blocks_free(&handle->blocks);
 }
 
 bool autosave_init(void)
@@ -720,6 +725,82 @@ static void *content_get_serialized_data(size_t* serial_size)
    return data;
 }
 
+/**
+ * task_save_handler_error:
+ * @task : the task to finish
+ * @state : the state associated with this task
+ *
+ * Report that the save state could not be written
+ * and finish the task.
+ **/
+static void task_save_handler_error(retro_task_t *task,
+      save_task_state_t *state)
+{
+   size_t err_size = 8192 * sizeof(char);
+   char *err       = (char*)malloc(err_size);
+   err[0]          = '\0';
+
+   if (state->undo_save)
+   {
+      RARCH_ERR("[State]: %s \"%s\".\n",
+         msg_hash_to_str(MSG_FAILED_TO_UNDO_SAVE_STATE),
+         undo_save_buf.path);
+
+      snprintf(err, err_size - 1, "%s \"%s\".",
+               msg_hash_to_str(MSG_FAILED_TO_UNDO_SAVE_STATE),
+               "RAM");
+   }
+   else
+      snprintf(err, err_size - 1,
+            "%s %s",
+            msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO), state->path);
+
+   task_set_error(task, strdup(err));
+   free(err);
+   task_save_handler_finished(task, state);
+}
+
+/**
+ * task_save_handler_done:
+ * @task : the task to finish
+ * @state : the state associated with this task
+ *
+ * Report that the save state was written and finish
+ * the task.
+ **/
+static void task_save_handler_done(retro_task_t *task,
+      save_task_state_t *state)
+{
+   char *msg = NULL;
+
+   task_free_title(task);
+
+   if (state->undo_save)
+      msg = strdup(msg_hash_to_str(MSG_RESTORED_OLD_SAVE_STATE));
+   else if (state->state_slot < 0)
+      msg = strdup(msg_hash_to_str(MSG_SAVED_STATE_TO_SLOT_AUTO));
+   else
+   {
+      char new_msg[128];
+      new_msg[0] = '\0';
+
+      snprintf(new_msg, sizeof(new_msg), msg_hash_to_str(MSG_SAVED_STATE_TO_SLOT),
+            state->state_slot);
+      msg = strdup(new_msg);
+   }
+
+   if (!task_get_mute(task) && msg)
+   {
+      task_set_title(task, msg);
+      msg = NULL;
+   }
+
+   task_save_handler_finished(task, state);
+
+   if (!string_is_empty(msg))
+      free(msg);
+}
+
 /**
  * task_save_handler:
  * @task : the task being worked on
@@ -767,65 +848,109 @@ static void task_save_handler(retro_task_t *task)
 
    if (task_get_cancelled(task) || written != remaining)
    {
-      size_t err_size = 8192 * sizeof(char);
-      char *err       = (char*)malloc(err_size);
-      err[0]          = '\0';
-
-      if (state->undo_save)
-      {
-         RARCH_ERR("[State]: %s \"%s\".\n",
-            msg_hash_to_str(MSG_FAILED_TO_UNDO_SAVE_STATE),
-            undo_save_buf.path);
-
-         snprintf(err, err_size - 1, "%s \"%s\".",
-                  msg_hash_to_str(MSG_FAILED_TO_UNDO_SAVE_STATE),
-                  "RAM");
-      }
-      else
-         snprintf(err, err_size - 1,
-               "%s %s",
-               msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO), state->path);
-
-      task_set_error(task, strdup(err));
-      free(err);
-      task_save_handler_finished(task, state);
+      task_save_handler_error(task, state);
       return;
    }
 
    if (state->written == state->size)
+      task_save_handler_done(task, state);
+}
+
+#ifdef HAVE_THREADS
+/**
+ * task_save_writer_handler:
+ * @task : the task being worked on
+ *
+ * Check whether the save state writer is done with the
+ * save of this task.
+ **/
+static void task_save_writer_handler(retro_task_t *task)
+{
+   enum state_writer_result result = STATE_WRITER_FAILED;
+   void *backup                    = NULL;
+   size_t backup_size              = 0;
+   save_task_state_t *state        = (save_task_state_t*)task->state;
+
+   if (!state_writer_job_done(state->job, &result, &backup, &backup_size))
    {
-      char       *msg      = NULL;
+      /* Check again later rather than spinning the task thread */
+      task->when = cpu_features_get_time_usec() + SAVE_STATE_POLL_USEC;
+      return;
+   }
 
-      task_free_title(task);
+   state_writer_job_free(state->job);
+   state->job       = NULL;
+   /* Goes to undo_save_buf in the callback, on the main thread */
+   state->undo_data = backup;
+   state->undo_size = (ssize_t)backup_size;
 
-      if (state->undo_save)
-         msg = strdup(msg_hash_to_str(MSG_RESTORED_OLD_SAVE_STATE));
-      else if (state->state_slot < 0)
-         msg = strdup(msg_hash_to_str(MSG_SAVED_STATE_TO_SLOT_AUTO));
-      else
-      {
-         char new_msg[128];
-         new_msg[0] = '\0';
+   switch (result)
+   {
+      case STATE_WRITER_DONE:
+         task_save_handler_done(task, state);
+         break;
+      case STATE_WRITER_REPLACED:
+         /* A newer save to the same file reports for both */
+         task_free_title(task);
+         state->thumbnail_enable = false;
+         task_save_handler_finished(task, state);
+         break;
+      default:
+         task_save_handler_error(task, state);
+         break;
+   }
+}
 
-         snprintf(new_msg, sizeof(new_msg), msg_hash_to_str(MSG_SAVED_STATE_TO_SLOT),
-               state->state_slot);
-         msg = strdup(new_msg);
-      }
+/* Starts the save state writer if needed. */
+static bool content_save_state_writer_available(void)
+{
+   if (!save_state_writer)
+      save_state_writer = state_writer_new();
+   return save_state_writer != NULL;
+}
 
-      if (!task_get_mute(task) && msg)
-      {
-         task_set_title(task, msg);
-         msg = NULL;
-      }
+/**
+ * content_queue_save_state:
+ * @path : file path of the save state
+ * @data : the save state data to write, or NULL to
+ *         serialize the core straight into the writer
+ * @size : the total size of @data, set to the size of
+ *         the serialized state when @data is NULL
+ * @compress_files : write a compressed file
+ * @backup : read the previous file back for undo
+ *
+ * Capture a save state on the save state writer, which
+ * then saves it in the background.
+ *
+ * Returns: the queued save, NULL on failure.
+ **/
+static state_writer_job_t *content_queue_save_state(const char *path,
+      const void *data, size_t *size, bool compress_files, bool backup)
+{
+   rastate_size_info_t info;
+   void *buffer;
 
-      task_save_handler_finished(task, state);
+   if (!data)
+   {
+      if (!content_get_rastate_size(&info))
+         return NULL;
+      *size = info.total_size;
+   }
 
-      if (!string_is_empty(msg))
-         free(msg);
+   if (!(buffer = state_writer_begin(save_state_writer, path, *size)))
+      return NULL;
 
-      return;
+   if (data)
+      memcpy(buffer, data, *size);
+   else if (!content_write_serialized_state(buffer, &info))
+   {
+      state_writer_cancel(save_state_writer);
+      return NULL;
    }
+
+   return state_writer_commit(save_state_writer, compress_files, backup);
 }
+#endif
 
 /**
  * task_push_undo_save_state:
@@ -858,8 +983,23 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
    state->compress_files         = compress_files;
 
    task->type                    = TASK_TYPE_BLOCKING;
-   task->state                   = state;
    task->handler                 = task_save_handler;
+
+#ifdef HAVE_THREADS
+   if (content_save_state_writer_available())
+   {
+      /* Copied, undo_save_state_cb() still frees the buffer,
+       * as does the error path if queueing fails */
+      if (!data || !(state->job = content_queue_save_state(path, data,
+                  &size, compress_files, false)))
+         goto error;
+      state->data                = NULL;
+      task->type                 = TASK_TYPE_NONE;
+      task->handler              = task_save_writer_handler;
+   }
+#endif
+
+   task->state                   = state;
    task->callback                = undo_save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_UNDOING_SAVE_STATE));
 
@@ -869,7 +1009,16 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
 
 error:
    if (data)
+   {
+      /* Never leave the undo buffer pointing at freed memory */
+      if (data == undo_save_buf.data)
+      {
+         undo_save_buf.path[0] = '\0';
+         undo_save_buf.size    = 0;
+         undo_save_buf.data    = NULL;
+      }
       free(data);
+   }
    if (state)
       free(state);
    if (task)
@@ -1298,6 +1447,17 @@ static void save_state_cb(retro_task_t *task,
    free(path);
 #endif
 
+   /* Previous contents of the file, read back by the
+    * save state writer for content_undo_save_state() */
+   if (state->undo_data)
+   {
+      if (undo_save_buf.data)
+         free(undo_save_buf.data);
+      undo_save_buf.data = state->undo_data;
+      undo_save_buf.size = state->undo_size;
+      strlcpy(undo_save_buf.path, state->path, sizeof(undo_save_buf.path));
+   }
+
    free(state);
 }
 
@@ -1368,6 +1528,91 @@ error:
    }
 }
 
+#ifdef HAVE_THREADS
+/**
+ * task_push_save_state_writer:
+ * @path : file path of the save state
+ * @autosave : whether this is an automatic save
+ *
+ * Serialize the content state onto the save state writer
+ * and create a task to report on the save. Returns as
+ * soon as the state is captured.
+ *
+ * Returns: true if successful, false otherwise.
+ **/
+static bool task_push_save_state_writer(const char *path, bool autosave)
+{
+   size_t serial_size              = 0;
+   bool backup                     = false;
+   retro_task_t       *task        = task_init();
+   save_task_state_t *state        = (save_task_state_t*)calloc(1, sizeof(*state));
+   settings_t     *settings        = config_get_ptr();
+   bool savestate_thumbnail_enable = settings->bools.savestate_thumbnail_enable;
+   int state_slot                  = settings->ints.state_slot;
+#if defined(HAVE_ZLIB)
+   bool compress_files             = settings->bools.savestate_file_compression;
+#else
+   bool compress_files             = false;
+#endif
+
+   if (!task || !state)
+      goto error;
+
+   if (path_is_valid(path) && !autosave)
+   {
+      /* The writer reads the file back right before
+       * replacing it, to allow undo_save_state() to work */
+      RARCH_LOG("[State]: %s ...\n",
+            msg_hash_to_str(MSG_FILE_ALREADY_EXISTS_SAVING_TO_BACKUP_BUFFER));
+      backup = true;
+   }
+
+   if (!(state->job = content_queue_save_state(path, NULL, &serial_size,
+               compress_files, backup)))
+   {
+      RARCH_ERR("[State]: %s \"%s\".\n",
+            msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
+            path);
+      goto error;
+   }
+
+   RARCH_LOG("[State]: %s \"%s\", %u %s.\n",
+         msg_hash_to_str(MSG_SAVING_STATE),
+         path,
+         (unsigned)serial_size,
+         msg_hash_to_str(MSG_BYTES));
+
+   strlcpy(state->path, path, sizeof(state->path));
+   state->size                   = serial_size;
+   state->autosave               = autosave;
+   state->mute                   = autosave; /* don't show OSD messages if we are auto-saving */
+   state->thumbnail_enable       = savestate_thumbnail_enable;
+   state->state_slot             = state_slot;
+   state->has_valid_framebuffer  = video_driver_cached_frame_has_valid_framebuffer();
+   state->compress_files         = compress_files;
+
+   /* Not blocking, saves queue up on the writer */
+   task->type              = TASK_TYPE_NONE;
+   task->state             = state;
+   task->handler           = task_save_writer_handler;
+   task->callback          = save_state_cb;
+   task->title             = strdup(msg_hash_to_str(MSG_SAVING_STATE));
+   task->mute              = state->mute;
+
+   task_queue_push(task);
+
+   return true;
+
+error:
+   if (state)
+      free(state);
+   if (task)
+      free(task);
+
+   return false;
+}
+#endif
+
 /**
  * content_load_and_save_state_cb:
  * @path      : path that state will be loaded from.
@@ -1480,6 +1725,15 @@ bool content_save_state(const char *path, bool save_to_disk, bool autosave)
       return false;
    serial_size = info.size;
 
+#ifdef HAVE_THREADS
+   /* Serialized straight into the save state writer,
+    * which also takes care of the undo backup */
+   if (     save_to_disk
+         && !save_state_in_background
+         && content_save_state_writer_available())
+      return task_push_save_state_writer(path, autosave);
+#endif
+
    if (!save_state_in_background)
    {
       data = content_get_serialized_data(&serial_size);
@@ -1570,6 +1824,10 @@ static bool task_save_state_finder(retro_task_t *task, void *user_data)
 
    if (task->handler == task_save_handler)
       return true;
+#ifdef HAVE_THREADS
+   if (task->handler == task_save_writer_handler)
+      return true;
+#endif
 
    return false;
 }
@@ -1590,6 +1848,24 @@ static bool content_save_state_in_progress(void* data)
 
 void content_wait_for_save_state_task(void)
 {
+#ifdef HAVE_THREADS
+   if (save_state_writer)
+   {
+      state_writer_wait(save_state_writer);
+
+      /* Writer tasks check on their save through task->when,
+       * which task_queue_wait() stops at. Their saves are
+       * over, they only have to get their turn and report. */
+      while (content_save_state_in_progress(NULL))
+      {
+         task_queue_check();
+         retro_sleep(1);
+      }
+
+      /* Run the callbacks of the tasks that just finished */
+      task_queue_check();
+   }
+#endif
    task_queue_wait(content_save_state_in_progress, NULL);
 }
 
@@ -1619,6 +1895,12 @@ bool content_load_state(const char *path,
    if (!task || !state)
       goto error;
 
+#ifdef HAVE_THREADS
+   /* The file may still be being written */
+   if (save_state_writer)
+      state_writer_wait(save_state_writer);
+#endif
+
    strlcpy(state->path, path, sizeof(state->path));
    state->load_to_backup_buffer = load_to_backup_buffer;
    state->autoload              = autoload;
@@ -1668,6 +1950,12 @@ bool content_rename_state(const char *origin, const char *dest)
 */
 bool content_reset_savestate_backups(void)
 {
+#ifdef HAVE_THREADS
+   /* Finishes pending saves and releases the capture buffers */
+   state_writer_free(save_state_writer);
+   save_state_writer = NULL;
+#endif
+
    if (undo_save_buf.data)
    {
       free(undo_save_buf.data);
@@ -0,0 +1,97 @@
+#!/usr/bin/env bash
+# Runs a netplay host and client over the loopback interface and checks
+# that savestates are transferred without errors.
+
+RETROARCH=./retroarch
+PORT=55435
+SECONDS_RUN=10
+
+die() {
+   echo "$@" >&2
+   exit 1
+}
+
+while getopts "r:p:t:" opt; do
+   case "$opt" in
+      r) RETROARCH="$OPTARG" ;;
+      p) PORT="$OPTARG" ;;
+      t) SECONDS_RUN="$OPTARG" ;;
+      *) die "Usage: $0 [-r retroarch] [-p port] [-t seconds] core content" ;;
+   esac
+done
+shift $((OPTIND - 1))
+
+[ $# -eq 2 ] || die "Usage: $0 [-r retroarch] [-p port] [-t seconds] core content"
+CORE="$1"
+CONTENT="$2"
+
+[ -x "$RETROARCH" ] || die "$RETROARCH is not executable"
+
+DIR="$(mktemp -d)"
+CMD_PORT=$((PORT + 1))
+
+# Null drivers, so that both instances can run headless and
+# unthrottled, and frequent CRC checks to catch desyncs early
+write_config() {
+   cat > "$DIR/$1.cfg" <<CFG
+video_driver = "null"
+audio_driver = "null"
+input_driver = "null"
+config_save_on_exit = "false"
+savestate_directory = "$DIR/$1-states"
+netplay_check_frames = "30"
+network_cmd_enable = "$2"
+network_cmd_port = "$CMD_PORT"
+CFG
+   mkdir -p "$DIR/$1-states"
+}
+
+write_config host true
+write_config client false
+
+timeout $((SECONDS_RUN + 4)) "$RETROARCH" --config "$DIR/host.cfg" \
+   -L "$CORE" "$CONTENT" --host --port "$PORT" --verbose \
+   > "$DIR/host.log" 2>&1 &
+HOST_PID=$!
+sleep 2
+
+timeout "$SECONDS_RUN" "$RETROARCH" --config "$DIR/client.cfg" \
+   -L "$CORE" "$CONTENT" --connect 127.0.0.1 --port "$PORT" --verbose \
+   > "$DIR/client.log" 2>&1 &
+CLIENT_PID=$!
+
+# Have the host load a savestate made a few seconds earlier
+sleep $((SECONDS_RUN / 3))
+printf SAVE_STATE > "/dev/udp/127.0.0.1/$CMD_PORT"
+sleep $((SECONDS_RUN / 3))
+printf LOAD_STATE > "/dev/udp/127.0.0.1/$CMD_PORT"
+
+wait "$CLIENT_PID"
+wait "$HOST_PID"
+
+FAILED=0
+
+if grep -q "\[ERROR\] \[Netplay\]" "$DIR/host.log" "$DIR/client.log"; then
+   grep "\[ERROR\] \[Netplay\]" "$DIR/host.log" "$DIR/client.log"
+   FAILED=1
+fi
+
+if ! grep -q "joined as player 2" "$DIR/client.log"; then
+   echo "Client never joined."
+   FAILED=1
+fi
+
+SENT=$(grep -c "Sent savestate" "$DIR/host.log")
+LOADED=$(grep -c "Loaded savestate" "$DIR/client.log")
+
+echo "Incremental savestates sent: $SENT, loaded: $LOADED"
+grep "Sent savestate" "$DIR/host.log" | sed 's/^/   /'
+
+if [ "$SENT" -ne "$LOADED" ]; then
+   echo "Not every savestate sent was loaded."
+   FAILED=1
+fi
+
+echo "Logs: $DIR"
+[ "$FAILED" -eq 0 ] && echo "PASS" || echo "FAIL"
+exit "$FAILED"